@@ -57,6 +57,110 @@
 #include <time.h>
 #include <pthread.h>
 #include <assert.h>
+#include "abstract_atomic.h"
+
+static uint64_t commits_requested;
+static uint64_t commits_fsal;
+
+/**
+ * @brief Commit a file, sharing one FSAL_commit among concurrent callers
+ *
+ * COMMITs and stable writes of a file that arrive while an
+ * FSAL_commit of the file is running wait for it to finish.  If it
+ * covered their writes they are done, otherwise the first of them
+ * runs the next one for all the others.  Writes are numbered by
+ * cache_inode_rdwr in write_seq; an FSAL_commit covers the writes
+ * numbered when it started, and on success moves synced_seq up to
+ * them.  A caller whose writes are already covered returns at once.
+ *
+ * A lone committer touches only the counters of the entry.  The cold
+ * part of the file, with the lock and condition to sleep on, is only
+ * allocated when a second committer has to wait.  The committer
+ * clears commit_running before it looks for the cold part, and a
+ * waiter publishes the cold part before it looks at commit_running,
+ * so one of them always sees the other.
+ *
+ * A caller whose shared FSAL_commit failed runs one of its own, and
+ * returns its status.  The FSAL_commit is of the whole file, a range
+ * COMMIT shares it as well.
+ *
+ * The caller holds the content lock, for read is enough.
+ *
+ * @param[in] entry The file
+ * @param[in] fd    A descriptor of the file open for writing
+ *
+ * @return The status of the FSAL_commit covering the caller's writes.
+ */
+
+fsal_status_t
+cache_inode_group_commit(cache_entry_t *entry, fsal_file_t *fd)
+{
+     struct cache_inode_file__ *file = &entry->object.file;
+     cache_inode_file_cold_t *cold;
+     fsal_status_t fsal_status = {0, 0};
+     uint64_t seq, running_seq;
+
+     atomic_inc_uint64_t(&commits_requested);
+
+     /* The writes done by now */
+     seq = atomic_fetch_uint64_t(&file->write_seq);
+
+     while (atomic_fetch_uint64_t(&file->synced_seq) < seq) {
+          if (__sync_bool_compare_and_swap(&file->commit_running,
+                                           FALSE, TRUE)) {
+               /* Run the next one, for whoever comes meanwhile */
+               running_seq = atomic_fetch_uint64_t(&file->write_seq);
+               atomic_inc_uint64_t(&commits_fsal);
+               fsal_status = FSAL_commit(fd, 0, 0);
+               /* Only the committer moves synced_seq */
+               if (!FSAL_IS_ERROR(fsal_status) &&
+                   (running_seq >
+                    atomic_fetch_uint64_t(&file->synced_seq))) {
+                    atomic_store_uint64_t(&file->synced_seq, running_seq);
+               }
+               atomic_store_uint32_t(&file->commit_running, FALSE);
+               __sync_synchronize();
+
+               cold = *(cache_inode_file_cold_t * volatile *) &file->cold;
+               if (cold != NULL) {
+                    pthread_mutex_lock(&cold->commit_mtx);
+                    pthread_cond_broadcast(&cold->commit_cond);
+                    pthread_mutex_unlock(&cold->commit_mtx);
+               }
+               return fsal_status;
+          }
+
+          /* Someone else's is running, wait for it */
+          if ((cold = cache_inode_file_cold_get(entry)) == NULL) {
+               atomic_inc_uint64_t(&commits_fsal);
+               return FSAL_commit(fd, 0, 0);
+          }
+          __sync_synchronize();
+
+          pthread_mutex_lock(&cold->commit_mtx);
+          while (atomic_fetch_uint32_t(&file->commit_running) &&
+                 (atomic_fetch_uint64_t(&file->synced_seq) < seq)) {
+               pthread_cond_wait(&cold->commit_cond, &cold->commit_mtx);
+          }
+          pthread_mutex_unlock(&cold->commit_mtx);
+     }
+
+     return fsal_status;
+}
+
+/**
+ * @brief Get the counts of commits
+ *
+ * @param[out] requested COMMITs and stable writes committed
+ * @param[out] fsal      FSAL_commits run for them
+ */
+
+void
+cache_inode_commit_get_stats(uint64_t *requested, uint64_t *fsal)
+{
+     *requested = atomic_fetch_uint64_t(&commits_requested);
+     *fsal = atomic_fetch_uint64_t(&commits_fsal);
+}
 
 /**
  * @brief Commits a write operation to stable storage
@@ -91,6 +195,8 @@ cache_inode_commit(cache_entry_t *entry,
      bool_t content_locked = FALSE;
      /* True if we opened our own file descriptor */
      bool_t opened = FALSE;
+     /* The file descriptor to commit */
+     fsal_file_t *fd = NULL;
 
      if ((uint64_t)count > ~(uint64_t)offset)
          return NFS4ERR_INVAL;
@@ -106,10 +212,12 @@ cache_inode_commit(cache_entry_t *entry,
         the filesystem write buffer so execute a normal fsal_commit()
         call. */
      if (stability == CACHE_INODE_UNSAFE_WRITE_TO_FS_BUFFER) {
-          if (!is_open_for_write(entry)) {
+          /* A file open for reading only gets a descriptor for
+             writing beside the cached one */
+          if (!cache_inode_fd(entry)) {
                pthread_rwlock_unlock(&entry->content_lock);
                pthread_rwlock_wrlock(&entry->content_lock);
-               if (!is_open_for_write(entry)) {
+               if (!cache_inode_fd(entry)) {
                     if (cache_inode_open(entry,
                                          FSAL_O_WRONLY,
                                          context,
@@ -122,9 +230,12 @@ cache_inode_commit(cache_entry_t *entry,
                }
           }
 
-          fsal_status = FSAL_commit(&(entry->object.file.open_fd.fd),
-                                    offset,
-                                    count);
+          if (cache_inode_io_fd_get(entry, FSAL_O_WRONLY, context, &fd,
+                                    status) != CACHE_INODE_SUCCESS) {
+               goto out;
+          }
+          fsal_status = cache_inode_group_commit(entry, fd);
+          cache_inode_io_fd_put(entry, fd);
           if (FSAL_IS_ERROR(fsal_status)) {
                LogMajor(COMPONENT_CACHE_INODE,
                         "cache_inode_rdwr: fsal_commit() failed: "
@@ -163,7 +274,11 @@ cache_inode_commit(cache_entry_t *entry,
            * buffer. This means we will either be writing to the
            * buffer, or writing a stable write to the file system if
            * the buffer is already full. */
-          udata = &entry->object.file.unstable_data;
+          if (entry->object.file.cold == NULL) {
+               *status = CACHE_INODE_SUCCESS;
+               goto out;
+          }
+          udata = &entry->object.file.cold->unstable_data;
           if (udata->buffer == NULL) {
                *status = CACHE_INODE_SUCCESS;
                goto out;
@@ -181,6 +296,7 @@ cache_inode_commit(cache_entry_t *entry,
                                          NULL,
                                          context,
                                          CACHE_INODE_SAFE_WRITE_TO_FS,
+                                         0,
                                          status);
                if (status != CACHE_INODE_SUCCESS) {
                     goto out;
@@ -203,6 +319,7 @@ cache_inode_commit(cache_entry_t *entry,
                                 NULL,
                                 context,
                                 CACHE_INODE_SAFE_WRITE_TO_FS,
+                                0,
                                 status);
           }
      }
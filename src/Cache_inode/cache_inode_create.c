@@ -50,6 +50,7 @@
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
 #include "cache_inode_weakref.h"
+#include "cache_inode_negative.h"
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/param.h>
@@ -201,7 +202,10 @@ cache_inode_create(cache_entry_t *parent,
           entry = NULL;
           goto out;
      }
+     cache_inode_negative_remove(parent, name);
+
      fsal_data.fh_desc.start = (caddr_t) &object_handle;
+     fsal_data.hash = 0;
      fsal_data.fh_desc.len = 0;
      FSAL_ExpandHandle(context->export_context,
                        FSAL_DIGEST_SIZEOF,
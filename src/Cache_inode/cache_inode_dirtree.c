@@ -0,0 +1,802 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2010, The Linux Box Corporation
+ * Contributor : Matt Benjamin <matt@linuxbox.com>
+ *
+ * Some portions Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file cache_inode_dirtree.c
+ * @brief B+-tree of the dirents of a directory, with a name index
+ *
+ * Every node has room for DIRTREE_ORDER cookies.  An internal node
+ * with n cookies has n + 1 children, child i holding the cookies from
+ * keys[i - 1] included to keys[i] excluded.  A leaf holds, next to its
+ * cookies, the dirents they stand for and a pointer to the next leaf.
+ * Full nodes are split on the way down an insertion, so that there is
+ * always room in the parent for the new separator.  Nodes are never
+ * merged: removals are rare next to insertions (most are turned into
+ * deleted dirents, which stay in the tree), and an empty leaf costs
+ * no more than a skip in a readdir.
+ *
+ * The name index is an open addressing hash table, linearly probed,
+ * of the cookies of active dirents, whose size is a power of two kept
+ * below 3/4 full.  The cookie being already a good hash of the name,
+ * a multiplication spreads it over the table.
+ *
+ * Everything here is done under the content lock of the directory,
+ * held for write by those functions that change the tree.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "log.h"
+#include "fsal.h"
+#include "cache_inode.h"
+#include "cache_inode_dirtree.h"
+#include "murmur3.h"
+#include "abstract_mem.h"
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/param.h>
+#include <time.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define DIRTREE_ORDER 32
+#define DIRTREE_NAMES_MIN_BITS 6
+#define DIRTREE_MAX_PROBES 64
+#define DIRTREE_MAX_DELETED 65535
+
+#define MIN_COOKIE_VAL 3
+
+struct cache_inode_dirtree_node
+{
+    uint32_t leaf; /*< Nonzero for a leaf */
+    uint32_t n; /*< Cookies in keys */
+    uint64_t keys[DIRTREE_ORDER]; /*< Sorted cookies */
+    union {
+        struct cache_inode_dirtree_node *child[DIRTREE_ORDER + 1];
+        struct {
+            cache_inode_dir_entry_t *dirent[DIRTREE_ORDER];
+            struct cache_inode_dirtree_node *next; /*< Next leaf */
+        } l;
+    } u;
+};
+
+struct cache_inode_dirtree_name
+{
+    uint64_t k; /*< Cookie, 0 for a free slot */
+    cache_inode_dir_entry_t *dirent;
+};
+
+static inline cache_inode_dir_tree_t *
+dirtree_of(cache_entry_t *entry)
+{
+    return entry->object.dir.tree;
+}
+
+/* Index of the first of the n keys not less than k */
+
+static inline uint32_t
+dirtree_lower_bound(const uint64_t *keys, uint32_t n, uint64_t k)
+{
+    uint32_t lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (keys[mid] < k)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/* Index of the first of the n keys greater than k */
+
+static inline uint32_t
+dirtree_upper_bound(const uint64_t *keys, uint32_t n, uint64_t k)
+{
+    uint32_t lo = 0, hi = n, mid;
+
+    while (lo < hi) {
+        mid = (lo + hi) / 2;
+        if (keys[mid] <= k)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static struct cache_inode_dirtree_node *
+dirtree_node_new(uint32_t leaf)
+{
+    struct cache_inode_dirtree_node *node;
+
+    node = gsh_malloc(sizeof(struct cache_inode_dirtree_node));
+    if (node == NULL)
+        return NULL;
+    node->leaf = leaf;
+    node->n = 0;
+    if (leaf)
+        node->u.l.next = NULL;
+    return node;
+}
+
+/* The leaf where k is, or would be */
+
+static inline struct cache_inode_dirtree_node *
+dirtree_find_leaf(cache_inode_dir_tree_t *tree, uint64_t k)
+{
+    struct cache_inode_dirtree_node *node = tree->root;
+
+    while (node && !node->leaf)
+        node = node->u.child[dirtree_upper_bound(node->keys, node->n, k)];
+    return node;
+}
+
+/*
+ * Split the full child i of parent, which has room for one more
+ * separator.
+ */
+
+static int
+dirtree_split_child(cache_inode_dir_tree_t *tree,
+                    struct cache_inode_dirtree_node *parent, uint32_t i)
+{
+    struct cache_inode_dirtree_node *left = parent->u.child[i];
+    struct cache_inode_dirtree_node *right;
+    uint32_t mid = DIRTREE_ORDER / 2;
+    uint64_t sep;
+
+    right = dirtree_node_new(left->leaf);
+    if (right == NULL)
+        return -1;
+
+    if (left->leaf) {
+        /* The separator stays in the right leaf, as its first key */
+        right->n = left->n - mid;
+        memcpy(right->keys, &left->keys[mid], right->n * sizeof(uint64_t));
+        memcpy(right->u.l.dirent, &left->u.l.dirent[mid],
+               right->n * sizeof(cache_inode_dir_entry_t *));
+        right->u.l.next = left->u.l.next;
+        left->u.l.next = right;
+        sep = right->keys[0];
+        /* Dirents moved, cursors must find their place again */
+        tree->version++;
+    } else {
+        /* The separator moves up */
+        sep = left->keys[mid];
+        right->n = left->n - mid - 1;
+        memcpy(right->keys, &left->keys[mid + 1],
+               right->n * sizeof(uint64_t));
+        memcpy(right->u.child, &left->u.child[mid + 1],
+               (right->n + 1) * sizeof(struct cache_inode_dirtree_node *));
+    }
+    left->n = mid;
+
+    memmove(&parent->keys[i + 1], &parent->keys[i],
+            (parent->n - i) * sizeof(uint64_t));
+    memmove(&parent->u.child[i + 2], &parent->u.child[i + 1],
+            (parent->n - i) * sizeof(struct cache_inode_dirtree_node *));
+    parent->keys[i] = sep;
+    parent->u.child[i + 1] = right;
+    parent->n++;
+
+    return 0;
+}
+
+/* Put v in the tree, k not being there already */
+
+static int
+dirtree_tree_insert(cache_inode_dir_tree_t *tree, cache_inode_dir_entry_t *v)
+{
+    struct cache_inode_dirtree_node *node, *root;
+    uint64_t k = v->hk.k;
+    uint32_t i;
+
+    if (tree->root == NULL) {
+        tree->root = dirtree_node_new(TRUE);
+        if (tree->root == NULL)
+            return -1;
+    }
+
+    if (tree->root->n == DIRTREE_ORDER) {
+        root = dirtree_node_new(FALSE);
+        if (root == NULL)
+            return -1;
+        root->u.child[0] = tree->root;
+        if (dirtree_split_child(tree, root, 0) != 0) {
+            gsh_free(root);
+            return -1;
+        }
+        tree->root = root;
+    }
+
+    node = tree->root;
+    while (!node->leaf) {
+        i = dirtree_upper_bound(node->keys, node->n, k);
+        if (node->u.child[i]->n == DIRTREE_ORDER) {
+            if (dirtree_split_child(tree, node, i) != 0)
+                return -1;
+            if (k >= node->keys[i])
+                i++;
+        }
+        node = node->u.child[i];
+    }
+
+    i = dirtree_lower_bound(node->keys, node->n, k);
+    memmove(&node->keys[i + 1], &node->keys[i],
+            (node->n - i) * sizeof(uint64_t));
+    memmove(&node->u.l.dirent[i + 1], &node->u.l.dirent[i],
+            (node->n - i) * sizeof(cache_inode_dir_entry_t *));
+    node->keys[i] = k;
+    node->u.l.dirent[i] = v;
+    node->n++;
+    tree->version++;
+
+    return 0;
+}
+
+/* Take k out of the tree, leaving the leaf as it is otherwise */
+
+static void
+dirtree_tree_remove(cache_inode_dir_tree_t *tree, uint64_t k)
+{
+    struct cache_inode_dirtree_node *leaf = dirtree_find_leaf(tree, k);
+    uint32_t i;
+
+    if (leaf == NULL)
+        return;
+    i = dirtree_lower_bound(leaf->keys, leaf->n, k);
+    if (i == leaf->n || leaf->keys[i] != k)
+        return;
+
+    leaf->n--;
+    memmove(&leaf->keys[i], &leaf->keys[i + 1],
+            (leaf->n - i) * sizeof(uint64_t));
+    memmove(&leaf->u.l.dirent[i], &leaf->u.l.dirent[i + 1],
+            (leaf->n - i) * sizeof(cache_inode_dir_entry_t *));
+    tree->version++;
+}
+
+static void
+dirtree_free_nodes(struct cache_inode_dirtree_node *node)
+{
+    uint32_t i;
+
+    if (node->leaf) {
+        for (i = 0; i < node->n; i++)
+            pool_free(cache_inode_dir_entry_pool, node->u.l.dirent[i]);
+    } else {
+        for (i = 0; i <= node->n; i++)
+            dirtree_free_nodes(node->u.child[i]);
+    }
+    gsh_free(node);
+}
+
+/* The cookie a name hashes to, before probing */
+
+static inline uint64_t
+dirtree_hash_name(fsal_name_t *name)
+{
+    uint32_t hk[4];
+    uint64_t k;
+
+    MurmurHash3_x64_128(name->name, name->len, 67, hk);
+    memcpy(&k, hk, 8);
+    return k;
+}
+
+/* The name index */
+
+static inline uint32_t
+dirtree_name_slot(cache_inode_dir_tree_t *tree, uint64_t k)
+{
+    return (uint32_t) ((k * 0x9E3779B97F4A7C15ULL) >>
+                       (64 - tree->names_bits));
+}
+
+static void
+dirtree_name_put(cache_inode_dir_tree_t *tree, cache_inode_dir_entry_t *v)
+{
+    uint32_t mask = (1U << tree->names_bits) - 1;
+    uint32_t i = dirtree_name_slot(tree, v->hk.k);
+
+    while (tree->names[i].k != 0)
+        i = (i + 1) & mask;
+    tree->names[i].k = v->hk.k;
+    tree->names[i].dirent = v;
+}
+
+/* Make room in the name index for one more dirent */
+
+static int
+dirtree_names_reserve(cache_inode_dir_tree_t *tree)
+{
+    struct cache_inode_dirtree_name *old = tree->names;
+    uint32_t old_size = old ? (1U << tree->names_bits) : 0;
+    uint32_t bits = old ? tree->names_bits + 1 : DIRTREE_NAMES_MIN_BITS;
+    uint32_t i;
+
+    if ((tree->names_count + 1) * 4 <= old_size * 3)
+        return 0;
+
+    tree->names = gsh_calloc(1U << bits,
+                             sizeof(struct cache_inode_dirtree_name));
+    if (tree->names == NULL) {
+        tree->names = old;
+        return -1;
+    }
+    tree->names_bits = bits;
+
+    for (i = 0; i < old_size; i++)
+        if (old[i].k != 0)
+            dirtree_name_put(tree, old[i].dirent);
+    gsh_free(old);
+
+    return 0;
+}
+
+static inline cache_inode_dir_entry_t *
+dirtree_name_get(cache_inode_dir_tree_t *tree, uint64_t k)
+{
+    uint32_t mask, i;
+
+    if (tree->names == NULL)
+        return NULL;
+
+    mask = (1U << tree->names_bits) - 1;
+    for (i = dirtree_name_slot(tree, k); tree->names[i].k != 0;
+         i = (i + 1) & mask)
+        if (tree->names[i].k == k)
+            return tree->names[i].dirent;
+
+    return NULL;
+}
+
+/* Backward shift deletion, so that probing never needs tombstones */
+
+static void
+dirtree_name_del(cache_inode_dir_tree_t *tree, uint64_t k)
+{
+    uint32_t mask, i, j, home;
+
+    if (tree->names == NULL)
+        return;
+
+    mask = (1U << tree->names_bits) - 1;
+    for (i = dirtree_name_slot(tree, k); tree->names[i].k != k;
+         i = (i + 1) & mask)
+        if (tree->names[i].k == 0)
+            return;
+
+    for (j = (i + 1) & mask; tree->names[j].k != 0; j = (j + 1) & mask) {
+        home = dirtree_name_slot(tree, tree->names[j].k);
+        /* Move j back to i unless its home lies in (i, j] */
+        if (((j - home) & mask) >= ((j - i) & mask)) {
+            tree->names[i] = tree->names[j];
+            i = j;
+        }
+    }
+    tree->names[i].k = 0;
+    tree->names[i].dirent = NULL;
+    tree->names_count--;
+}
+
+void cache_inode_dirtree_init(cache_entry_t *entry)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+
+    tree->root = NULL;
+    tree->names = NULL;
+    tree->names_bits = 0;
+    tree->names_count = 0;
+    init_glist(&tree->deleted);
+    tree->ndeleted = 0;
+    tree->version = 0;
+    tree->collisions = 0;
+}
+
+/* Drop the oldest deleted dirent, so that persisted cookies do not
+   grow without bound */
+
+static void
+dirtree_drop_oldest_deleted(cache_inode_dir_tree_t *tree)
+{
+    cache_inode_dir_entry_t *v;
+
+    v = glist_first_entry(&tree->deleted, cache_inode_dir_entry_t, deleted);
+    if (v == NULL)
+        return;
+    glist_del(&v->deleted);
+    tree->ndeleted--;
+    dirtree_tree_remove(tree, v->hk.k);
+    pool_free(cache_inode_dir_entry_pool, v);
+}
+
+static inline int
+cache_inode_dirtree_insert_impl(cache_entry_t *entry,
+                                cache_inode_dir_entry_t *v,
+                                int j,
+                                cache_inode_dir_entry_t **dirent)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    struct cache_inode_dirtree_node *leaf;
+    cache_inode_dir_entry_t *v_exist;
+    uint32_t i;
+    int code = 0;
+
+    leaf = dirtree_find_leaf(tree, v->hk.k);
+    if (leaf) {
+        i = dirtree_lower_bound(leaf->keys, leaf->n, v->hk.k);
+        if (i < leaf->n && leaf->keys[i] == v->hk.k) {
+            v_exist = leaf->u.l.dirent[i];
+            if (!(v_exist->flags & DIR_ENTRY_FLAG_DELETED))
+                /* taken, keep trying at the next j */
+                return -1;
+
+            /* reuse the deleted dirent, so that its cookie stays
+             * valid */
+            glist_del(&v_exist->deleted);
+            tree->ndeleted--;
+            FSAL_namecpy(&v_exist->name, &v->name);
+            v_exist->entry = v->entry;
+            v_exist->flags &= ~DIR_ENTRY_FLAG_DELETED;
+            v = v_exist;
+            code = 1; /* tell client to dispose v */
+        }
+    }
+
+    if (code == 0 && dirtree_tree_insert(tree, v) != 0)
+        return -2;
+
+    /* Room was made before, this cannot fail */
+    dirtree_name_put(tree, v);
+    tree->names_count++;
+
+    v->hk.p = j;
+    if (tree->collisions < v->hk.p)
+        tree->collisions = v->hk.p;
+    *dirent = v;
+
+    LogDebug(COMPONENT_CACHE_INODE,
+             "inserted new dirent on entry=%p cookie=%"PRIu64
+             " collisions %d",
+             entry, v->hk.k, tree->collisions);
+
+    return code;
+}
+
+/**
+ * @brief Insert a dirent
+ *
+ * The cookie is the hash of the name, probed quadratically (with
+ * coefficient 2, since the tree takes any 64 bit key) past the cookies
+ * already taken.  A deleted dirent holding the cookie is reused, so
+ * that a readdir resuming from it finds the name again.
+ *
+ * On return, the stored key is in v->hk.k, the iteration count in
+ * v->hk.p.
+ *
+ * @param[in]  entry  The directory, its content lock held for write
+ * @param[in]  v      The dirent, its name and entry set
+ * @param[out] dirent The dirent now in the tree: v, or the reused one
+ *
+ * @retval 0 if v was inserted.
+ * @retval 1 if a deleted dirent was reused instead, v is to be freed.
+ * @retval -1 if v could not be inserted.
+ */
+
+int cache_inode_dirtree_insert(cache_entry_t *entry,
+                               cache_inode_dir_entry_t *v,
+                               cache_inode_dir_entry_t **dirent)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    int j, code;
+
+    if (dirtree_names_reserve(tree) != 0) {
+        LogCrit(COMPONENT_CACHE_INODE,
+                "cache_inode_dirtree_insert: no memory for the name index "
+                "(%s)", v->name.name);
+        return -1;
+    }
+
+    v->hk.k = dirtree_hash_name(&v->name);
+
+    for (j = 0; j < DIRTREE_MAX_PROBES; j++) {
+        v->hk.k = (v->hk.k + (j * 2));
+
+        /* reject values 0, 1 and 2 */
+        if (v->hk.k < MIN_COOKIE_VAL)
+            continue;
+
+        code = cache_inode_dirtree_insert_impl(entry, v, j, dirent);
+        if (code >= 0)
+            return code;
+        if (code == -2) {
+            LogCrit(COMPONENT_CACHE_INODE,
+                    "cache_inode_dirtree_insert: no memory for the tree "
+                    "(%s)", v->name.name);
+            return -1;
+        }
+    }
+
+    LogCrit(COMPONENT_CACHE_INODE,
+            "cache_inode_dirtree_insert: could not insert at j=%d (%s)",
+            j, v->name.name);
+
+    return -1;
+}
+
+/**
+ * @brief Look an active dirent up by name
+ *
+ * The probes made are those of the insertion, up to the longest
+ * sequence any insertion in this directory needed.
+ *
+ * @param[in] entry The directory, its content lock held
+ * @param[in] name  The name
+ *
+ * @return The dirent, or NULL if the name is not cached.
+ */
+
+cache_inode_dir_entry_t *
+cache_inode_dirtree_lookup_name(cache_entry_t *entry, fsal_name_t *name)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    cache_inode_dir_entry_t *v;
+    uint64_t k = dirtree_hash_name(name);
+    uint32_t j;
+
+    for (j = 0; j <= tree->collisions; j++) {
+        k = (k + (j * 2));
+        if (k < MIN_COOKIE_VAL)
+            continue;
+        v = dirtree_name_get(tree, k);
+        /* ensure that v is related to name */
+        if (v && !FSAL_namecmp(name, &v->name)) {
+            assert(!(v->flags & DIR_ENTRY_FLAG_DELETED));
+            return v;
+        }
+    }
+
+    LogFullDebug(COMPONENT_CACHE_INODE,
+                 "cache_inode_dirtree_lookup_name: entry not found at j=%u "
+                 "(%s)",
+                 j, name->name);
+
+    return NULL;
+}
+
+/**
+ * @brief Mark a dirent deleted
+ *
+ * The dirent leaves the name index but stays in the tree, with its
+ * cookie, until reused or, past DIRTREE_MAX_DELETED of them, dropped
+ * as the oldest.
+ *
+ * @param[in] entry The directory, its content lock held for write
+ * @param[in] v     An active dirent of it
+ */
+
+void
+cache_inode_dirtree_set_deleted(cache_entry_t *entry,
+                                cache_inode_dir_entry_t *v)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+
+    assert(! (v->flags & DIR_ENTRY_FLAG_DELETED));
+
+    dirtree_name_del(tree, v->hk.k);
+
+    v->flags |= DIR_ENTRY_FLAG_DELETED;
+    v->name.len = 0;
+    v->entry.ptr = (void*)0xdeaddeaddeaddead;
+    v->entry.gen = 0;
+
+    glist_add_tail(&tree->deleted, &v->deleted);
+    tree->ndeleted++;
+
+    /* XXX we must not allow persist-cookies to overrun resource
+     * management processes (ie, more coming in CIR/LRU) */
+    if (tree->ndeleted > DIRTREE_MAX_DELETED)
+        dirtree_drop_oldest_deleted(tree);
+}
+
+/**
+ * @brief Free all the dirents of a directory
+ *
+ * The tree version goes on, so that no cursor outlives the dirents.
+ *
+ * @param[in] entry The directory, its content lock held for write
+ */
+
+void cache_inode_dirtree_release(cache_entry_t *entry)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+
+    if (tree->root) {
+        dirtree_free_nodes(tree->root);
+        tree->root = NULL;
+    }
+    if (tree->names) {
+        gsh_free(tree->names);
+        tree->names = NULL;
+    }
+    tree->names_bits = 0;
+    tree->names_count = 0;
+    init_glist(&tree->deleted);
+    tree->ndeleted = 0;
+    tree->version++;
+}
+
+/* Move the cursor from leaf, pos to the first active dirent there or
+   after */
+
+static cache_inode_dir_entry_t *
+dirtree_cursor_settle(cache_inode_dir_tree_t *tree,
+                      cache_inode_dir_cursor_t *cursor,
+                      struct cache_inode_dirtree_node *leaf,
+                      uint32_t pos)
+{
+    cache_inode_dir_entry_t *v;
+
+    while (leaf) {
+        for (; pos < leaf->n; pos++) {
+            v = leaf->u.l.dirent[pos];
+            if (v->flags & DIR_ENTRY_FLAG_DELETED)
+                continue;
+            cursor->leaf = leaf;
+            cursor->pos = pos;
+            cursor->version = tree->version;
+            cursor->cookie = v->hk.k;
+            return v;
+        }
+        leaf = leaf->u.l.next;
+        pos = 0;
+    }
+
+    cursor->leaf = NULL;
+    return NULL;
+}
+
+/**
+ * @brief Start a readdir from the beginning
+ *
+ * @param[in]  entry  The directory, its content lock held
+ * @param[out] cursor The position of the dirent returned
+ *
+ * @return The first active dirent, NULL if there is none.
+ */
+
+cache_inode_dir_entry_t *
+cache_inode_dirtree_first(cache_entry_t *entry,
+                          cache_inode_dir_cursor_t *cursor)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    struct cache_inode_dirtree_node *node = tree->root;
+
+    while (node && !node->leaf)
+        node = node->u.child[0];
+
+    return dirtree_cursor_settle(tree, cursor, node, 0);
+}
+
+/**
+ * @brief Resume a readdir from a cookie
+ *
+ * @param[in]  entry  The directory, its content lock held
+ * @param[in]  k      The cookie
+ * @param[in]  flags  CACHE_INODE_FLAG_NEXT_ACTIVE for the dirent
+ *                    following an active k, rather than k itself
+ * @param[out] cursor The position of the dirent returned
+ *
+ * @return The dirent of k, or the next active one if k is deleted or
+ *         CACHE_INODE_FLAG_NEXT_ACTIVE is given.  NULL if k was never
+ *         a cookie or there is no next active dirent.
+ */
+
+cache_inode_dir_entry_t *
+cache_inode_dirtree_seek(cache_entry_t *entry,
+                         uint64_t k,
+                         uint32_t flags,
+                         cache_inode_dir_cursor_t *cursor)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    struct cache_inode_dirtree_node *leaf = dirtree_find_leaf(tree, k);
+    cache_inode_dir_entry_t *v = NULL;
+    uint32_t pos;
+
+    cursor->leaf = NULL;
+    if (leaf == NULL)
+        goto out;
+
+    pos = dirtree_lower_bound(leaf->keys, leaf->n, k);
+    if (pos == leaf->n || leaf->keys[pos] != k)
+        goto out;
+
+    if (!(leaf->u.l.dirent[pos]->flags & DIR_ENTRY_FLAG_DELETED) &&
+        !(flags & CACHE_INODE_FLAG_NEXT_ACTIVE)) {
+        v = dirtree_cursor_settle(tree, cursor, leaf, pos);
+        goto out;
+    }
+
+    /* client wants the cookie -after- the last we sent, and the Linux
+     * 3.0 and 3.1.0-rc7 clients misbehave if we resend the last one.
+     * A deleted dirent stands for its least upper bound. */
+    v = dirtree_cursor_settle(tree, cursor, leaf, pos + 1);
+
+out:
+    if (v == NULL)
+        LogFullDebug(COMPONENT_NFS_READDIR,
+                     "seek to cookie=%"PRIu64" fail (no next entry)", k);
+    return v;
+}
+
+/**
+ * @brief Step a readdir to the next active dirent
+ *
+ * If the tree changed since the cursor was set, the next dirent is
+ * found again from the cookie of the last one returned.
+ *
+ * @param[in]     entry  The directory, its content lock held
+ * @param[in,out] cursor The cursor
+ *
+ * @return The next active dirent, NULL at the end of the directory.
+ */
+
+cache_inode_dir_entry_t *
+cache_inode_dirtree_next(cache_entry_t *entry,
+                         cache_inode_dir_cursor_t *cursor)
+{
+    cache_inode_dir_tree_t *tree = dirtree_of(entry);
+    struct cache_inode_dirtree_node *leaf;
+    uint32_t pos;
+
+    if (cursor->leaf == NULL)
+        return NULL;
+
+    if (cursor->version == tree->version)
+        return dirtree_cursor_settle(tree, cursor, cursor->leaf,
+                                     cursor->pos + 1);
+
+    leaf = dirtree_find_leaf(tree, cursor->cookie);
+    if (leaf == NULL) {
+        cursor->leaf = NULL;
+        return NULL;
+    }
+    pos = dirtree_upper_bound(leaf->keys, leaf->n, cursor->cookie);
+
+    return dirtree_cursor_settle(tree, cursor, leaf, pos);
+}
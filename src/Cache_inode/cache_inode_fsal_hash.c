@@ -48,6 +48,7 @@
 #include <unistd.h>             /* for using gethostname */
 #include <stdlib.h>             /* for using exit */
 #include <strings.h>
+#include <string.h>
 #include <sys/types.h>
 
 /**
@@ -67,7 +68,9 @@ uint32_t cache_inode_fsal_hash_func(hash_parameter_t * p_hparam,
 {
     unsigned long h = 0;
     char printbuf[512];
-    fsal_handle_t *pfsal_handle = (fsal_handle_t *) (buffclef->pdata);
+    cache_inode_fsal_data_t *fsdata =
+         (cache_inode_fsal_data_t *) buffclef->pdata;
+    fsal_handle_t *pfsal_handle = (fsal_handle_t *) fsdata->fh_desc.start;
 
     h = FSAL_Handle_to_HashIndex(pfsal_handle, 0,
                                  p_hparam->alphabet_length,
@@ -105,9 +108,11 @@ uint64_t cache_inode_fsal_rbt_func(hash_parameter_t * p_hparam,
      */
     uint32_t h = 0;
     char printbuf[512];
-    fsal_handle_t *pfsal_handle = (fsal_handle_t *) (buffclef->pdata);
+    cache_inode_fsal_data_t *fsdata =
+         (cache_inode_fsal_data_t *) buffclef->pdata;
+    fsal_handle_t *pfsal_handle = (fsal_handle_t *) fsdata->fh_desc.start;
 
-    h = Lookup3_hash_buff((char *)pfsal_handle, buffclef->len );
+    h = Lookup3_hash_buff((char *)pfsal_handle, fsdata->fh_desc.len);
 
     if(isFullDebug(COMPONENT_HASHTABLE) && isFullDebug(COMPONENT_CACHE_INODE))
         {
@@ -127,7 +132,9 @@ unsigned long __cache_inode_fsal_rbt_func(hash_parameter_t * p_hparam,
      * producing same value as decimal_simple_hash_func
      */
     unsigned long h = 0;
-    fsal_handle_t *pfsal_handle = (fsal_handle_t *) (buffclef->pdata);
+    cache_inode_fsal_data_t *fsdata =
+         (cache_inode_fsal_data_t *) buffclef->pdata;
+    fsal_handle_t *pfsal_handle = (fsal_handle_t *) fsdata->fh_desc.start;
     char printbuf[512];
 
     h = FSAL_Handle_to_RBTIndex(pfsal_handle, 0);
@@ -158,7 +165,7 @@ unsigned long __cache_inode_fsal_rbt_func(hash_parameter_t * p_hparam,
  */
 
 static int cache_inode_fsal_rbt_both_on_fsal(hash_parameter_t * p_hparam,
-                                             hash_buffer_t    * buffclef,
+                                             cache_inode_fsal_data_t * fsdata,
                                              uint32_t * phashval,
                                              uint64_t * prbtval)
 {
@@ -169,7 +176,7 @@ static int cache_inode_fsal_rbt_both_on_fsal(hash_parameter_t * p_hparam,
     unsigned int FSALindex = 0;
     unsigned int FSALrbt = 0;
 
-    fsal_handle_t *pfsal_handle = (fsal_handle_t *) (buffclef->pdata);
+    fsal_handle_t *pfsal_handle = (fsal_handle_t *) fsdata->fh_desc.start;
 
     /**
      * @todo ACE: This is a temporary hack so we don't have to change
@@ -193,7 +200,7 @@ static int cache_inode_fsal_rbt_both_on_fsal(hash_parameter_t * p_hparam,
 
     if(isFullDebug(COMPONENT_HASHTABLE) && isFullDebug(COMPONENT_CACHE_INODE))
       {
-          snprintHandle(printbuf, 512, buffclef->pdata);
+          snprintHandle(printbuf, 512, pfsal_handle);
           LogFullDebug(COMPONENT_CACHE_INODE,
                        "hash_func rbt both: buff = (Handle=%s, Cookie=%"PRIu64"), hashvalue=%u rbtvalue=%u",
                        printbuf, 0UL, FSALindex, FSALrbt);
@@ -204,16 +211,16 @@ static int cache_inode_fsal_rbt_both_on_fsal(hash_parameter_t * p_hparam,
 } /*  cache_inode_fsal_rbt_both */
 
 static int cache_inode_fsal_rbt_both_locally(hash_parameter_t * p_hparam,
-                                             hash_buffer_t    * buffclef,
+                                             cache_inode_fsal_data_t * fsdata,
                                              uint32_t * phashval,
                                              uint64_t * prbtval)
 {
     char printbuf[512];
     uint32_t h1 = 0 ;
     uint32_t h2 = 0 ;
-    fsal_handle_t *pfsal_handle = (fsal_handle_t *) (buffclef->pdata);
+    fsal_handle_t *pfsal_handle = (fsal_handle_t *) fsdata->fh_desc.start;
 
-    Lookup3_hash_buff_dual((char *)pfsal_handle, buffclef->len,
+    Lookup3_hash_buff_dual((char *)pfsal_handle, fsdata->fh_desc.len,
                            &h1, &h2  );
 
     h1 = h1 % p_hparam->index_size ;
@@ -234,23 +241,114 @@ static int cache_inode_fsal_rbt_both_locally(hash_parameter_t * p_hparam,
 } /*  cache_inode_fsal_rbt_both */
 
 
+/**
+ *
+ * cache_inode_fsal_data_hash: Hashes a handle once for all.
+ *
+ * Computes the partition index and the rbt value of the handle in
+ * fsdata, and keeps both in fsdata->hash, so that the lookup, the
+ * insertion and the removal of the entry do not hash it again.  The
+ * handle descriptor must be filled in.
+ *
+ * @param fsdata [INOUT] the key to hash.
+ *
+ * @return 1 if successful, 0 if failed
+ *
+ */
+
+int cache_inode_fsal_data_hash(cache_inode_fsal_data_t *fsdata)
+{
+  uint32_t index = 0;
+  uint64_t rbt = 0;
+  int rc;
+
+  if(cache_inode_params.use_fsal_hash == FALSE )
+    rc = cache_inode_fsal_rbt_both_locally(&cache_inode_params.hparam,
+                                           fsdata, &index, &rbt);
+  else
+    rc = cache_inode_fsal_rbt_both_on_fsal(&cache_inode_params.hparam,
+                                           fsdata, &index, &rbt);
+  if(rc == 0)
+    {
+      fsdata->hash = 0;
+      return 0;
+    }
+
+  /* Both values are 32 bits wide.  The rbt value is nudged off 0,
+     which marks a key not hashed yet: it is computed the same way for
+     every key, so equal handles still get equal values. */
+  fsdata->hash = ((uint64_t) index << 32) | (uint32_t) rbt;
+  if(fsdata->hash == 0)
+    fsdata->hash = 1;
+
+  return 1;
+}
+
 int cache_inode_fsal_rbt_both( hash_parameter_t * p_hparam,
                                hash_buffer_t    * buffclef,
                                uint32_t * phashval, uint64_t * prbtval )
 {
-  if(cache_inode_params.use_fsal_hash == FALSE )
-    return cache_inode_fsal_rbt_both_locally( p_hparam, buffclef, phashval, prbtval ) ;
-  else
-    return cache_inode_fsal_rbt_both_on_fsal( p_hparam, buffclef, phashval, prbtval ) ;
+  cache_inode_fsal_data_t *fsdata =
+       (cache_inode_fsal_data_t *) buffclef->pdata;
+  cache_inode_fsal_data_t local;
+
+  /* Keys built by hand may not be hashed yet.  Hash a copy, so that
+     a caller reusing its key with another handle is not misled. */
+  if(fsdata->hash == 0)
+    {
+      local.fh_desc = fsdata->fh_desc;
+      if(!cache_inode_fsal_data_hash(&local))
+        return 0;
+      fsdata = &local;
+    }
+
+  *phashval = (uint32_t) (fsdata->hash >> 32) % p_hparam->index_size;
+  *prbtval = (uint32_t) fsdata->hash;
+
+  return 1;
 }
 
 
+/**
+ *
+ * cache_inode_fsal_flatten: Flat copy of a key, for lockless lookups.
+ *
+ * Hashed locally, two handles are the same if and only if their
+ * descriptors have the same bytes, which are the flat key.  The
+ * hash of the FSAL may equate handles of different bytes, they have
+ * no flat key.
+ *
+ * @param buffclef [IN] the key.
+ * @param flat [OUT] its flat copy.
+ * @param size [IN] the room in flat.
+ *
+ * @return the length of the copy, 0 if none.
+ *
+ */
+
+size_t cache_inode_fsal_flatten(hash_buffer_t * buffclef,
+                                char *flat, size_t size)
+{
+  cache_inode_fsal_data_t *fsdata =
+       (cache_inode_fsal_data_t *) buffclef->pdata;
+
+  if(cache_inode_params.use_fsal_hash != FALSE ||
+     fsdata->fh_desc.len == 0 || fsdata->fh_desc.len > size)
+    return 0;
+
+  memcpy(flat, fsdata->fh_desc.start, fsdata->fh_desc.len);
+
+  return fsdata->fh_desc.len;
+}
 
 int display_key(hash_buffer_t * pbuff, char *str)
 {
     char buffer[128];
 
-    snprintHandle(buffer, 128, pbuff->pdata);
+    cache_inode_fsal_data_t *fsdata =
+         (cache_inode_fsal_data_t *) pbuff->pdata;
+
+    snprintHandle(buffer, 128, fsdata->fh_desc.start);
 
     return snprintf(str, HASHTABLE_DISPLAY_STRLEN,
                     "(Handle=%s, Cookie=%"PRIu64")", buffer, 0UL);
@@ -49,6 +49,7 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_inflight.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -57,6 +58,73 @@
 #include <pthread.h>
 #include <assert.h>
 
+/**
+ * @brief Fetch an object from the FSAL and cache it
+ *
+ * @param[in]  fsdata  File system data
+ * @param[in]  context FSAL credentials
+ * @param[out] status  Returned status
+ *
+ * @return The new entry, with a reference, or NULL on failure.
+ */
+
+static cache_entry_t *
+cache_inode_get_miss(cache_inode_fsal_data_t *fsdata,
+                     fsal_op_context_t *context,
+                     cache_inode_status_t *status)
+{
+     fsal_status_t fsal_status = {0, 0};
+     cache_inode_create_arg_t create_arg = {
+          .newly_created_dir = FALSE
+     };
+     cache_inode_file_type_t type = UNASSIGNED;
+     fsal_attrib_list_t fsal_attributes;
+     fsal_handle_t *file_handle;
+
+     file_handle = (fsal_handle_t *) fsdata->fh_desc.start;
+     /* First, call FSAL to know what the object is */
+     fsal_attributes.asked_attributes = cache_inode_params.attrmask;
+     fsal_status
+          = FSAL_getattrs(file_handle, context, &fsal_attributes);
+     if (FSAL_IS_ERROR(fsal_status)) {
+          *status = cache_inode_error_convert(fsal_status);
+          LogDebug(COMPONENT_CACHE_INODE,
+                   "cache_inode_get: cache_inode_status=%u "
+                   "fsal_status=%u,%u ", *status,
+                   fsal_status.major,
+                   fsal_status.minor);
+          return NULL;
+     }
+
+     /* The type has to be set in the attributes */
+     if (!FSAL_TEST_MASK(fsal_attributes.supported_attributes,
+                         FSAL_ATTR_TYPE)) {
+          *status = CACHE_INODE_FSAL_ERROR;
+          return NULL;
+     }
+
+     /* Get the cache_inode file type */
+     type = cache_inode_fsal_type_convert(fsal_attributes.type);
+     if (type == SYMBOLIC_LINK) {
+          fsal_attributes.asked_attributes = cache_inode_params.attrmask;
+          fsal_status =
+               FSAL_readlink(file_handle, context,
+                             &create_arg.link_content,
+                             &fsal_attributes);
+
+          if (FSAL_IS_ERROR(fsal_status)) {
+               *status = cache_inode_error_convert(fsal_status);
+               return NULL;
+          }
+     }
+
+     return cache_inode_new_entry(fsdata,
+                                  &fsal_attributes,
+                                  type,
+                                  &create_arg,
+                                  status);
+}
+
 /**
  *
  * @brief Gets an entry by using its fsdata as a key and caches it if needed.
@@ -89,24 +157,25 @@ cache_inode_get(cache_inode_fsal_data_t *fsdata,
 {
      hash_buffer_t key, value;
      cache_entry_t *entry = NULL;
-     fsal_status_t fsal_status = {0, 0};
-     cache_inode_create_arg_t create_arg = {
-          .newly_created_dir = FALSE
-     };
-     cache_inode_file_type_t type = UNASSIGNED;
      hash_error_t hrc = 0;
-     fsal_attrib_list_t fsal_attributes;
-     fsal_handle_t *file_handle;
      struct hash_latch latch;
+     cache_inode_fsal_data_t keydata;
+     cache_inode_inflight_t *inflight = NULL;
+     bool_t coalesced = FALSE;
 
      /* Set the return default to CACHE_INODE_SUCCESS */
      *status = CACHE_INODE_SUCCESS;
 
-     /* Turn the input to a hash key on our own.
+     /* Turn the input to a hash key on our own.  Handles decoded
+        from a request come hashed already.
       */
-     key.pdata = fsdata->fh_desc.start;
-     key.len = fsdata->fh_desc.len;
+     keydata = *fsdata;
+     if (keydata.hash == 0)
+          (void) cache_inode_fsal_data_hash(&keydata);
+     key.pdata = &keydata;
+     key.len = sizeof(keydata);
 
+again:
      hrc = HashTable_GetLatch(fh_to_cache_entry_ht, &key, &value,
                               FALSE,
                               &latch);
@@ -152,52 +221,31 @@ cache_inode_get(cache_inode_fsal_data_t *fsdata,
      }
 
      if (!entry) {
-          /* Cache miss, allocate a new entry */
-          file_handle = (fsal_handle_t *) fsdata->fh_desc.start;
-          /* First, call FSAL to know what the object is */
-          fsal_attributes.asked_attributes = cache_inode_params.attrmask;
-          fsal_status
-               = FSAL_getattrs(file_handle, context, &fsal_attributes);
-          if (FSAL_IS_ERROR(fsal_status)) {
-               *status = cache_inode_error_convert(fsal_status);
-               LogDebug(COMPONENT_CACHE_INODE,
-                        "cache_inode_get: cache_inode_status=%u "
-                        "fsal_status=%u,%u ", *status,
-                        fsal_status.major,
-                        fsal_status.minor);
-               return NULL;
-          }
-
-          /* The type has to be set in the attributes */
-          if (!FSAL_TEST_MASK(fsal_attributes.supported_attributes,
-                              FSAL_ATTR_TYPE)) {
-               *status = CACHE_INODE_FSAL_ERROR;
-               return NULL;
-          }
-
-          /* Get the cache_inode file type */
-          type = cache_inode_fsal_type_convert(fsal_attributes.type);
-          if (type == SYMBOLIC_LINK) {
-               fsal_attributes.asked_attributes = cache_inode_params.attrmask;
-               fsal_status =
-                    FSAL_readlink(file_handle, context,
-                                  &create_arg.link_content,
-                                  &fsal_attributes);
+          /* Cache miss.  If another thread is already fetching the
+             same object, wait for it and look again. */
+          if (!coalesced) {
+               switch (cache_inode_inflight_begin(NULL,
+                                                  keydata.fh_desc.start,
+                                                  keydata.fh_desc.len,
+                                                  &inflight,
+                                                  status)) {
+               case CACHE_INODE_INFLIGHT_WAITED:
+                    if (*status != CACHE_INODE_SUCCESS)
+                         return NULL;
+                    coalesced = TRUE;
+                    goto again;
 
-               if (FSAL_IS_ERROR(fsal_status)) {
-                    *status = cache_inode_error_convert(fsal_status);
-                    return NULL;
+               case CACHE_INODE_INFLIGHT_LEAD:
+               case CACHE_INODE_INFLIGHT_ALONE:
+                    break;
                }
           }
-          if ((entry
-               = cache_inode_new_entry(fsdata,
-                                       &fsal_attributes,
-                                       type,
-                                       &create_arg,
-                                       status)) == NULL) {
-               return NULL;
-          }
 
+          entry = cache_inode_get_miss(fsdata, context, status);
+          if (inflight != NULL)
+               cache_inode_inflight_end(inflight, *status);
+          if (entry == NULL)
+               return NULL;
      }
 
      *status = CACHE_INODE_SUCCESS;
@@ -0,0 +1,253 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_inflight.c
+ * @brief  Coalescing of concurrent cache misses
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "nlm_list.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "cache_inode.h"
+#include "cache_inode_inflight.h"
+
+/* Number of buckets, each with its own lock */
+#define INFLIGHT_BUCKETS 127
+
+struct cache_inode_inflight
+{
+  struct glist_head q; /*< Link in the bucket */
+  cache_entry_t *parent; /*< Directory of a lookup, NULL for a get */
+  uint32_t refcount; /*< The thread doing the work and its waiters */
+  bool_t done; /*< The work is over */
+  cache_inode_status_t status; /*< Its result */
+  size_t len; /*< Length of the key */
+  char key[]; /*< Handle for a get, name for a lookup */
+};
+
+struct inflight_bucket
+{
+  pthread_mutex_t mtx;
+  pthread_cond_t cv; /*< Signalled when work of the bucket is done */
+  struct glist_head q;
+};
+
+static struct inflight_bucket inflight_buckets[INFLIGHT_BUCKETS];
+
+/* Calls done, and calls spared by waiting for another thread */
+static uint64_t inflight_get_lead;
+static uint64_t inflight_get_coalesced;
+static uint64_t inflight_lookup_lead;
+static uint64_t inflight_lookup_coalesced;
+
+/**
+ * @brief Initialize the table of calls in flight
+ */
+
+void
+cache_inode_inflight_init(void)
+{
+  int i;
+
+  for(i = 0; i < INFLIGHT_BUCKETS; i++)
+    {
+      pthread_mutex_init(&inflight_buckets[i].mtx, NULL);
+      pthread_cond_init(&inflight_buckets[i].cv, NULL);
+      init_glist(&inflight_buckets[i].q);
+    }
+}
+
+static struct inflight_bucket *
+inflight_bucket(cache_entry_t *parent, const void *key, size_t len)
+{
+  const unsigned char *p = key;
+  uint64_t h = 14695981039346656037ULL ^ (uintptr_t) parent;
+  size_t i;
+
+  /* FNV-1a */
+  for(i = 0; i < len; i++)
+    {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+
+  return &inflight_buckets[h % INFLIGHT_BUCKETS];
+}
+
+/**
+ * @brief Tell whether a result holds for every caller
+ */
+
+static bool_t
+inflight_shareable(cache_inode_status_t status)
+{
+  return (status == CACHE_INODE_SUCCESS ||
+          status == CACHE_INODE_NOT_FOUND ||
+          status == CACHE_INODE_FSAL_ESTALE);
+}
+
+static void
+inflight_unref(cache_inode_inflight_t *inflight)
+{
+  if(--inflight->refcount == 0)
+    gsh_free(inflight);
+}
+
+/**
+ * @brief Register a call about to be made, or wait for the same one
+ *
+ * On CACHE_INODE_INFLIGHT_WAITED, a status of CACHE_INODE_SUCCESS
+ * means the object should now be in the cache and the caller is to
+ * look for it again.
+ *
+ * A thread waiting for a lookup keeps the lock it holds on the
+ * directory.  It is a read lock, as the thread doing the lookup
+ * holds one too for as long as the lookup lasts.
+ *
+ * @param[in]  parent   Directory of a lookup, NULL for a get
+ * @param[in]  key      Name looked up, or handle got
+ * @param[in]  len      Length of the key
+ * @param[out] inflight The record to end, on CACHE_INODE_INFLIGHT_LEAD
+ * @param[out] status   The result, on CACHE_INODE_INFLIGHT_WAITED
+ *
+ * @return What the caller is to do.
+ */
+
+cache_inode_inflight_role_t
+cache_inode_inflight_begin(cache_entry_t *parent,
+                           const void *key, size_t len,
+                           cache_inode_inflight_t **inflight,
+                           cache_inode_status_t *status)
+{
+  struct inflight_bucket *bucket = inflight_bucket(parent, key, len);
+  cache_inode_inflight_t *cur;
+  struct glist_head *glist;
+
+  *inflight = NULL;
+
+  pthread_mutex_lock(&bucket->mtx);
+
+  glist_for_each(glist, &bucket->q)
+    {
+      cur = glist_entry(glist, cache_inode_inflight_t, q);
+      if(cur->parent != parent || cur->len != len ||
+         memcmp(cur->key, key, len) != 0)
+        continue;
+
+      cur->refcount++;
+      while(!cur->done)
+        pthread_cond_wait(&bucket->cv, &bucket->mtx);
+      *status = cur->status;
+      inflight_unref(cur);
+      pthread_mutex_unlock(&bucket->mtx);
+
+      if(!inflight_shareable(*status))
+        return CACHE_INODE_INFLIGHT_ALONE;
+
+      if(parent == NULL)
+        atomic_inc_uint64_t(&inflight_get_coalesced);
+      else
+        atomic_inc_uint64_t(&inflight_lookup_coalesced);
+      return CACHE_INODE_INFLIGHT_WAITED;
+    }
+
+  cur = gsh_malloc(sizeof(cache_inode_inflight_t) + len);
+  if(cur == NULL)
+    {
+      pthread_mutex_unlock(&bucket->mtx);
+      return CACHE_INODE_INFLIGHT_ALONE;
+    }
+
+  cur->parent = parent;
+  cur->refcount = 1;
+  cur->done = FALSE;
+  cur->status = CACHE_INODE_SUCCESS;
+  cur->len = len;
+  memcpy(cur->key, key, len);
+  glist_add_tail(&bucket->q, &cur->q);
+
+  pthread_mutex_unlock(&bucket->mtx);
+
+  if(parent == NULL)
+    atomic_inc_uint64_t(&inflight_get_lead);
+  else
+    atomic_inc_uint64_t(&inflight_lookup_lead);
+
+  *inflight = cur;
+  return CACHE_INODE_INFLIGHT_LEAD;
+}
+
+/**
+ * @brief Publish the result of a call and wake its waiters
+ *
+ * On success, the entry must already be in the cache (and, for a
+ * lookup, in the directory) so that the waiters find it there.
+ *
+ * @param[in] inflight The record returned by cache_inode_inflight_begin
+ * @param[in] status   Result of the call
+ */
+
+void
+cache_inode_inflight_end(cache_inode_inflight_t *inflight,
+                         cache_inode_status_t status)
+{
+  struct inflight_bucket *bucket =
+    inflight_bucket(inflight->parent, inflight->key, inflight->len);
+
+  pthread_mutex_lock(&bucket->mtx);
+  glist_del(&inflight->q);
+  inflight->status = status;
+  inflight->done = TRUE;
+  if(inflight->refcount > 1)
+    pthread_cond_broadcast(&bucket->cv);
+  inflight_unref(inflight);
+  pthread_mutex_unlock(&bucket->mtx);
+}
+
+/**
+ * @brief Get the number of calls done and spared
+ *
+ * @param[out] get_lead         Gets that went to the FSAL
+ * @param[out] get_coalesced    Gets served by another thread's call
+ * @param[out] lookup_lead      Lookups that went to the FSAL
+ * @param[out] lookup_coalesced Lookups served by another thread's call
+ */
+
+void
+cache_inode_inflight_get_stats(uint64_t *get_lead,
+                               uint64_t *get_coalesced,
+                               uint64_t *lookup_lead,
+                               uint64_t *lookup_coalesced)
+{
+  *get_lead = atomic_fetch_uint64_t(&inflight_get_lead);
+  *get_coalesced = atomic_fetch_uint64_t(&inflight_get_coalesced);
+  *lookup_lead = atomic_fetch_uint64_t(&inflight_lookup_lead);
+  *lookup_coalesced = atomic_fetch_uint64_t(&inflight_lookup_coalesced);
+}
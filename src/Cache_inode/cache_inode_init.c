@@ -50,6 +50,8 @@
 #include "sal_data.h"
 #include "cache_inode_lru.h"
 #include "cache_inode_weakref.h"
+#include "cache_inode_inflight.h"
+#include "slab_pool.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -74,17 +76,29 @@ hash_table_t *cache_inode_init(cache_inode_parameter_t param,
                                cache_inode_status_t *status)
 {
   hash_table_t *ht = NULL;
+  static char *entry_pool_names[CACHE_INODE_HANDLE_SIZES] = {
+    "Entry Pool (small handles)",
+    "Entry Pool (medium handles)",
+    "Entry Pool"
+  };
+  unsigned int class;
 
-  cache_inode_entry_pool = pool_init("Entry Pool",
-                                     sizeof(cache_entry_t),
-                                     pool_basic_substrate,
-                                     NULL, NULL, NULL);
-  if(!(cache_inode_entry_pool))
+  /* The handle ends the entry, cut to the size of the pool */
+  for(class = 0; class < CACHE_INODE_HANDLE_SIZES; class++)
     {
-      LogCrit(COMPONENT_CACHE_INODE,
-              "Can't init Entry Pool");
-      *status = CACHE_INODE_INVALID_ARGUMENT;
-      return NULL;
+      cache_inode_entry_pools[class] =
+           pool_init(entry_pool_names[class],
+                     offsetof(cache_entry_t, handle) +
+                     cache_inode_handle_sizes[class],
+                     pool_slab_substrate,
+                     NULL, NULL, NULL);
+      if(!(cache_inode_entry_pools[class]))
+        {
+          LogCrit(COMPONENT_CACHE_INODE,
+                  "Can't init %s", entry_pool_names[class]);
+          *status = CACHE_INODE_INVALID_ARGUMENT;
+          return NULL;
+        }
     }
   cache_inode_symlink_pool = pool_init("Symlink Pool",
                                        sizeof(cache_inode_symlink_t),
@@ -100,7 +114,7 @@ hash_table_t *cache_inode_init(cache_inode_parameter_t param,
 
   cache_inode_dir_entry_pool = pool_init("Directory entry pool",
                                          sizeof(cache_inode_dir_entry_t),
-                                         pool_basic_substrate,
+                                         pool_slab_substrate,
                                          NULL, NULL, NULL);
   if(!(cache_inode_dir_entry_pool))
     {
@@ -110,6 +124,30 @@ hash_table_t *cache_inode_init(cache_inode_parameter_t param,
       return NULL;
     }
 
+  cache_inode_file_cold_pool = pool_init("File cold pool",
+                                         sizeof(cache_inode_file_cold_t),
+                                         pool_basic_substrate,
+                                         NULL, NULL, NULL);
+  if(!(cache_inode_file_cold_pool))
+    {
+      LogCrit(COMPONENT_CACHE_INODE,
+              "Can't init File Cold Pool");
+      *status = CACHE_INODE_INVALID_ARGUMENT;
+      return NULL;
+    }
+
+  cache_inode_dir_tree_pool = pool_init("Directory tree pool",
+                                        sizeof(cache_inode_dir_tree_t),
+                                        pool_basic_substrate,
+                                        NULL, NULL, NULL);
+  if(!(cache_inode_dir_tree_pool))
+    {
+      LogCrit(COMPONENT_CACHE_INODE,
+              "Can't init Dir Tree Pool");
+      *status = CACHE_INODE_INVALID_ARGUMENT;
+      return NULL;
+    }
+
 
 
   ht = HashTable_Init(&param.hparam);
@@ -121,6 +159,7 @@ hash_table_t *cache_inode_init(cache_inode_parameter_t param,
   LogInfo(COMPONENT_CACHE_INODE, "Hash Table initiated");
 
   cache_inode_weakref_init();
+  cache_inode_inflight_init();
 
   return ht;
 }                               /* cache_inode_init */
@@ -43,6 +43,7 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_negative.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -90,10 +91,11 @@ cache_inode_invalidate(cache_inode_fsal_data_t *fsal_data,
      FSAL_ExpandHandle(NULL,  /* pcontext but not used... */
                        FSAL_DIGEST_SIZEOF,
                        &fsal_data->fh_desc);
+     (void) cache_inode_fsal_data_hash(fsal_data);
 
      /* Turn the input to a hash key */
-     key.pdata = fsal_data->fh_desc.start;
-     key.len = fsal_data->fh_desc.len;
+     key.pdata = fsal_data;
+     key.len = sizeof(*fsal_data);
 
      if ((rc = HashTable_GetLatch(fh_to_cache_entry_ht,
                                   &key,
@@ -132,17 +134,20 @@ cache_inode_invalidate(cache_inode_fsal_data_t *fsal_data,
         without invalidating content (since any change in content
         really ought to modify mtime, at least.) */
 
-     if (flags == CACHE_INODE_INVALIDATE_CLEARBITS)
+     if (flags & CACHE_INODE_INVALIDATE_CLEARBITS) {
        atomic_clear_uint32_t_bits(&entry->flags,
                                   CACHE_INODE_TRUST_ATTRS |
                                   CACHE_INODE_DIR_POPULATED |
                                   CACHE_INODE_TRUST_CONTENT);
+       /* A name may have appeared, as on an FSAL_UP create */
+       cache_inode_negative_flush(entry);
+     }
 
      /* The main reason for holding the lock at this point is so we
         don't clear the trust bits while someone is populating the
         directory or refreshing attributes. */
 
-     if ((flags == CACHE_INODE_INVALIDATE_CLOSE) &&
+     if ((flags & CACHE_INODE_INVALIDATE_CLOSE) &&
          (entry->type == REGULAR_FILE)) {
           cache_inode_close(entry,
                             (CACHE_INODE_FLAG_REALLYCLOSE |
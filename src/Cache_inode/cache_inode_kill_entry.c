@@ -81,27 +81,19 @@
 void
 cache_inode_kill_entry(cache_entry_t *entry)
 {
-     cache_inode_fsal_data_t fsaldata;
      hash_buffer_t key;
      hash_buffer_t val;
      int rc = 0;
 
-     memset(&fsaldata, 0, sizeof(fsaldata));
-
      LogInfo(COMPONENT_CACHE_INODE,
              "Using cache_inode_kill_entry for entry %p", entry);
 
      cache_inode_unpinnable(entry);
      state_wipe_file(entry);
 
-     fsaldata.fh_desc = entry->fh_desc;
-     FSAL_ExpandHandle(NULL,
-                       FSAL_DIGEST_SIZEOF,
-                       &fsaldata.fh_desc);
-
-     /* Use the handle to build the key */
-     key.pdata = fsaldata.fh_desc.start;
-     key.len = fsaldata.fh_desc.len;
+     /* The entry holds the very key it was inserted with */
+     key.pdata = &entry->fsdata;
+     key.len = sizeof(entry->fsdata);
 
      val.pdata = entry;
      val.len = sizeof(cache_entry_t);
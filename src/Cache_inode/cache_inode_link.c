@@ -49,6 +49,7 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_negative.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -186,6 +187,8 @@ cache_inode_status_t cache_inode_link(cache_entry_t *entry,
 #endif /* _USE_NFS4_ACL */
      }
 
+     cache_inode_negative_remove(dest_dir, name);
+
      cache_inode_fixup_md(entry);
      *attr = entry->attributes;
      pthread_rwlock_unlock(&entry->attr_lock);
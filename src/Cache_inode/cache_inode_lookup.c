@@ -49,9 +49,11 @@
 #include "HashTable.h"
 #include "fsal.h"
 #include "cache_inode.h"
-#include "cache_inode_avl.h"
+#include "cache_inode_dirtree.h"
 #include "cache_inode_weakref.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_inflight.h"
+#include "cache_inode_negative.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -60,6 +62,112 @@
 #include <pthread.h>
 #include <assert.h>
 
+/**
+ * @brief Look a name up in the FSAL and cache the result
+ *
+ * The directory must be locked, as for cache_inode_lookup_impl.
+ *
+ * @param[in]  parent        The directory to search
+ * @param[in]  name          The name to be looked up
+ * @param[in]  context       FSAL credentials
+ * @param[in]  broken_dirent Dirent for the name whose weak reference
+ *                           is broken, if any
+ * @param[out] status        Returned status
+ *
+ * @return The cache entry corresponding to name or NULL on error.
+ */
+
+static cache_entry_t *
+cache_inode_lookup_miss(cache_entry_t *parent,
+                        fsal_name_t *name,
+                        fsal_op_context_t *context,
+                        cache_inode_dir_entry_t *broken_dirent,
+                        cache_inode_status_t *status)
+{
+     cache_entry_t *entry = NULL;
+     fsal_status_t fsal_status = {0, 0};
+     fsal_handle_t object_handle;
+     fsal_attrib_list_t object_attributes;
+     cache_inode_create_arg_t create_arg = {
+          .newly_created_dir = FALSE
+     };
+     cache_inode_file_type_t type = UNASSIGNED;
+     cache_inode_status_t cache_status = CACHE_INODE_SUCCESS;
+     cache_inode_fsal_data_t new_entry_fsdata;
+     uint32_t negative_gen = cache_inode_negative_gen(parent);
+
+     memset(&new_entry_fsdata, 0, sizeof(new_entry_fsdata));
+     memset(&object_handle, 0, sizeof(object_handle));
+
+     memset(&object_attributes, 0, sizeof(fsal_attrib_list_t));
+     object_attributes.asked_attributes = cache_inode_params.attrmask;
+     fsal_status =
+          FSAL_lookup(&parent->handle,
+                      name, context, &object_handle,
+                      &object_attributes);
+     if (FSAL_IS_ERROR(fsal_status)) {
+          if (fsal_status.major == ERR_FSAL_STALE) {
+               cache_inode_kill_entry(parent);
+          } else if (fsal_status.major == ERR_FSAL_NOENT) {
+               cache_inode_negative_insert(parent, name, negative_gen);
+          }
+          *status = cache_inode_error_convert(fsal_status);
+          return NULL;
+     }
+
+     type = cache_inode_fsal_type_convert(object_attributes.type);
+
+     /* If entry is a symlink, cache its target */
+     if(type == SYMBOLIC_LINK) {
+          fsal_status =
+               FSAL_readlink(&object_handle,
+                             context,
+                             &create_arg.link_content,
+                             &object_attributes);
+
+          if(FSAL_IS_ERROR(fsal_status)) {
+               *status = cache_inode_error_convert(fsal_status);
+               return NULL;
+          }
+     }
+
+     /* Allocation of a new entry in the cache */
+     new_entry_fsdata.fh_desc.start = (caddr_t) &object_handle;
+     new_entry_fsdata.fh_desc.len = 0;
+     FSAL_ExpandHandle(context->export_context,
+                       FSAL_DIGEST_SIZEOF,
+                       &new_entry_fsdata.fh_desc);
+
+     if((entry = cache_inode_new_entry(&new_entry_fsdata,
+                                       &object_attributes,
+                                       type,
+                                       &create_arg,
+                                       status)) == NULL) {
+          return NULL;
+     }
+
+     if (broken_dirent) {
+          /* Directory entry existed, but the weak reference
+             was broken.  Just update with the new one. */
+          broken_dirent->entry = entry->weakref;
+     } else {
+          /* Entry was found in the FSAL, add this entry to the
+             parent directory */
+          cache_status = cache_inode_add_cached_dirent(parent,
+                                                       name,
+                                                       entry,
+                                                       NULL,
+                                                       status);
+          if(cache_status != CACHE_INODE_SUCCESS &&
+             cache_status != CACHE_INODE_ENTRY_EXISTS) {
+               return NULL;
+          }
+     }
+
+     *status = CACHE_INODE_SUCCESS;
+     return entry;
+} /* cache_inode_lookup_miss */
+
 /**
  *
  * @brief Do the work of looking up a name in a directory.
@@ -88,24 +196,11 @@ cache_inode_lookup_impl(cache_entry_t *parent,
                         fsal_op_context_t *context,
                         cache_inode_status_t *status)
 {
-     cache_inode_dir_entry_t dirent_key;
      cache_inode_dir_entry_t *dirent = NULL;
      cache_entry_t *entry = NULL;
-     fsal_status_t fsal_status = {0, 0};
-     fsal_handle_t object_handle;
-     fsal_attrib_list_t object_attributes;
-     cache_inode_create_arg_t create_arg = {
-          .newly_created_dir = FALSE
-     };
-     cache_inode_file_type_t type = UNASSIGNED;
-     cache_inode_status_t cache_status = CACHE_INODE_SUCCESS;
-     cache_inode_fsal_data_t new_entry_fsdata;
      cache_inode_dir_entry_t *broken_dirent = NULL;
-
-     memset(&dirent_key, 0, sizeof(dirent_key));
-     memset(&new_entry_fsdata, 0, sizeof(new_entry_fsdata));
-     memset(&object_handle, 0, sizeof(object_handle));
-     memset(&object_attributes, 0, sizeof(object_attributes));
+     cache_inode_inflight_t *inflight = NULL;
+     bool_t coalesced = FALSE;
 
      /* Set the return default to CACHE_INODE_SUCCESS */
      *status = CACHE_INODE_SUCCESS;
@@ -141,14 +236,13 @@ cache_inode_lookup_impl(cache_entry_t *parent,
           goto out;
      } else {
           int write_locked = 0;
-          /* We first try avltree_lookup by name.  If that fails, we
+          /* We first try the dirent tree by name.  If that fails, we
            * dispatch to the FSAL. */
-          FSAL_namecpy(&dirent_key.name, name);
+     again:
           for (write_locked = 0; write_locked < 2; ++write_locked) {
                /* If the dirent cache is untrustworthy, don't even ask it */
                if (parent->flags & CACHE_INODE_TRUST_CONTENT) {
-                    dirent = cache_inode_avl_qp_lookup_s(parent,
-                                                         &dirent_key, 1);
+                    dirent = cache_inode_dirtree_lookup_name(parent, name);
                     if (dirent) {
                          /* Getting a weakref itself increases the refcount. */
                          entry = cache_inode_weakref_get(&dirent->entry,
@@ -176,8 +270,7 @@ cache_inode_lookup_impl(cache_entry_t *parent,
                        still invalid.  Empty it out and mark it valid
                        in preparation for caching the result of this
                        lookup. */
-                    cache_inode_release_dirents(parent,
-                                                CACHE_INODE_AVL_BOTH);
+                    cache_inode_release_dirents(parent);
                     atomic_set_uint32_t_bits(&parent->flags,
                                              CACHE_INODE_TRUST_CONTENT);
                } else {
@@ -187,72 +280,39 @@ cache_inode_lookup_impl(cache_entry_t *parent,
                }
           }
           assert(entry == NULL);
-          LogDebug(COMPONENT_CACHE_INODE, "Cache Miss detected");
-     }
-
-     memset(&object_attributes, 0, sizeof(fsal_attrib_list_t));
-     object_attributes.asked_attributes = cache_inode_params.attrmask;
-     fsal_status =
-          FSAL_lookup(&parent->handle,
-                      name, context, &object_handle,
-                      &object_attributes);
-     if (FSAL_IS_ERROR(fsal_status)) {
-          if (fsal_status.major == ERR_FSAL_STALE) {
-               cache_inode_kill_entry(parent);
+          /* The name may be known not to exist even though the
+             directory is not fully cached. */
+          if (broken_dirent == NULL &&
+              cache_inode_negative_lookup(parent, name)) {
+               *status = CACHE_INODE_NOT_FOUND;
+               goto out;
           }
-          *status = cache_inode_error_convert(fsal_status);
-          return NULL;
+          LogDebug(COMPONENT_CACHE_INODE, "Cache Miss detected");
      }
 
-     type = cache_inode_fsal_type_convert(object_attributes.type);
+     /* If another thread is already looking the same name up, wait
+        for it and look in the directory again. */
+     if (!coalesced) {
+          switch (cache_inode_inflight_begin(parent, name->name,
+                                             name->len, &inflight,
+                                             status)) {
+          case CACHE_INODE_INFLIGHT_WAITED:
+               if (*status != CACHE_INODE_SUCCESS)
+                    return NULL;
+               coalesced = TRUE;
+               broken_dirent = NULL;
+               goto again;
 
-     /* If entry is a symlink, cache its target */
-     if(type == SYMBOLIC_LINK) {
-          fsal_status =
-               FSAL_readlink(&object_handle,
-                             context,
-                             &create_arg.link_content,
-                             &object_attributes);
-
-          if(FSAL_IS_ERROR(fsal_status)) {
-               *status = cache_inode_error_convert(fsal_status);
-               return NULL;
+          case CACHE_INODE_INFLIGHT_LEAD:
+          case CACHE_INODE_INFLIGHT_ALONE:
+               break;
           }
      }
 
-     /* Allocation of a new entry in the cache */
-     new_entry_fsdata.fh_desc.start = (caddr_t) &object_handle;
-     new_entry_fsdata.fh_desc.len = 0;
-     FSAL_ExpandHandle(context->export_context,
-                       FSAL_DIGEST_SIZEOF,
-                       &new_entry_fsdata.fh_desc);
-
-     if((entry = cache_inode_new_entry(&new_entry_fsdata,
-                                       &object_attributes,
-                                       type,
-                                       &create_arg,
-                                       status)) == NULL) {
-          return NULL;
-     }
-
-     if (broken_dirent) {
-          /* Directory entry existed, but the weak reference
-             was broken.  Just update with the new one. */
-          broken_dirent->entry = entry->weakref;
-          cache_status = CACHE_INODE_SUCCESS;
-     } else {
-          /* Entry was found in the FSAL, add this entry to the
-             parent directory */
-          cache_status = cache_inode_add_cached_dirent(parent,
-                                                       name,
-                                                       entry,
-                                                       NULL,
-                                                       status);
-          if(cache_status != CACHE_INODE_SUCCESS &&
-             cache_status != CACHE_INODE_ENTRY_EXISTS) {
-               return NULL;
-          }
-     }
+     entry = cache_inode_lookup_miss(parent, name, context,
+                                     broken_dirent, status);
+     if (inflight != NULL)
+          cache_inode_inflight_end(inflight, *status);
 
 out:
 
@@ -46,11 +46,14 @@
 #include <sys/resource.h>
 #include <stdio.h>
 #include "nlm_list.h"
+#include "slab_pool.h"
 #include "fsal.h"
 #include "nfs_core.h"
 #include "log.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_lru_ghost.h"
+#include "cache_inode_negative.h"
 
 /**
  *
@@ -75,6 +78,16 @@
  * under ordinary circumstances, so are kept on a separate lru_pinned
  * list to retain constant time.
  *
+ * Entries enter L1 and reach L2 once used again, as in CAR [Bansal
+ * and Modha 2004].  Taking an initial reference does not move the
+ * entry: it sets lru.referenced, which needs no lock.  The queues are
+ * only reordered when an entry is reclaimed: the entry at the cold
+ * end of the chosen queue is moved to the warm end of L2 if it was
+ * referenced (or is in use), and evicted otherwise.  Evicted entries
+ * are remembered by the hash of their handle (see
+ * cache_inode_lru_ghost.h) to adapt the target size of L1 when they
+ * come back.
+ *
  * The locking discipline for this module is complex, because an entry
  * LRU can either be found through the cache entry in which it is
  * embedded (through a hash table or weakref lookup) or one can be
@@ -89,33 +102,42 @@
  * through their queue.  Therefore, we introduce the following rules
  * for accessing LRU entries:
  *
- *    - The LRU refcount may be increased by a thread holding either
- *      the entry lock or the lock for the queue holding the entry.
+ *    - The LRU refcount is only changed atomically, and needs no
+ *      lock.  A reference may be taken only while the refcount is
+ *      not 0, by compare and swap (lru_try_ref).  Once the refcount
+ *      is 0 the entry is dead and stays so until it is recycled.
  *    - The entry flags may be set or inspected only by a thread
  *      holding the lock on that entry.
  *    - An entry may only be removed from or inserted into a queue by
  *      a thread holding a lock on both the entry and the queue.
- *    - A thread may only decrement the reference count while holding
- *      the entry lock.
- *    - A thread that wishes to decrement the reference count must
- *      check that the reference count is greater than
- *      LRU_SENTINEL_REFCOUNT and, if not, acquire the queue lock
- *      before decrementing it.  When the reference count falls to 0,
- *      the controlling thread will have already acquired the queue
- *      lock.  It must then set the LRU_ENTRY_CONDEMNED bit on the
- *      entry's flags, and remove it from the queue.  It must then
- *      drop both the entry and queue lock, call pthread_yield, and
- *      reacquire the entry lock before continuing with disposal.
+ *    - The thread whose decrement brings the reference count to 0
+ *      owns the entry.  It must lock the entry, then its queue, set
+ *      the LRU_ENTRY_CONDEMNED bit on the entry's flags, and remove
+ *      it from the queue.  It must then drop both the entry and
+ *      queue lock and call pthread_yield before continuing with
+ *      disposal.
+ *    - The reclaim may only bring the reference count to 0 from
+ *      LRU_SENTINEL_REFCOUNT plus its own reference, by compare and
+ *      swap, holding both the entry and queue locks.  If that fails
+ *      someone took a reference meanwhile and the entry is left
+ *      alone.
  *    - A thread wishing to operate on an entry picked from a given
  *      queue fragment must lock that queue fragment, find the entry,
- *      and increase its reference count by one.  It must then store a
- *      pointer to the entry and release the queue lock before
- *      acquiring the entry lock.  If the LRU_ENTRY_CONDEMNED bit is
- *      set, it must relinquish its lock on the entry and attempt no
+ *      and try to take a reference on it, skipping it if the
+ *      reference count is already 0.  It must then store a pointer
+ *      to the entry and release the queue lock before acquiring the
+ *      entry lock.  If the LRU_ENTRY_CONDEMNED or LRU_ENTRY_KILLED
+ *      bit is set, it must release its reference and attempt no
  *      further access to it.  Otherwise, it must examine the flags
  *      and lane stored in the entry to determine the current queue
  *      fragment containing it, rather than assuming that the original
  *      location is still valid.
+ *
+ * Taking and releasing a reference, which requests do several times
+ * per operation, therefore costs one atomic operation on the entry
+ * and, for an initial reference, setting lru.referenced if it is
+ * not already set.  The queue locks are only taken by the reclaim,
+ * the LRU thread, pinning, and the thread disposing of an entry.
  */
 
 /* Forward Declaration */
@@ -150,21 +172,42 @@ struct lru_q_
 {
      struct lru_q_base lru;
      struct lru_q_base lru_pinned; /* uncollectable, due to state */
+     uint64_t hits; /* Initial references made by the threads of the
+                       lane, kept here rather than in one shared
+                       counter */
      CACHE_PAD(0);
 };
 
 /**
- * A multi-level LRU algorithm inspired by MQ [Zhou].  Transition from
- * L1 to L2 implies various checks (open files, etc) have been
- * performed, so ensures they are performed only once.  A
- * correspondence to the "scan resistance" property of 2Q and MQ is
- * accomplished by recycling/clean loads onto the LRU of L1.  Async
- * processing onto L2 constrains oscillation in this algorithm.
+ * L1 holds the entries used once since they were cached, L2 those
+ * used more than once.  The target size of L1 is adapted as in ARC
+ * [Megiddo and Modha 2003], so that a scan touching many entries
+ * once only recycles L1.
  */
 
 static struct lru_q_ LRU_1[LRU_N_Q_LANES];
 static struct lru_q_ LRU_2[LRU_N_Q_LANES];
 
+/* Entries evicted lately.  NULL if it could not be allocated, in
+   which case the target size of L1 stays where it is. */
+static lru_ghost_t *lru_ghost;
+
+/* Target size of L1 */
+static uint64_t lru_target_l1;
+
+/* Lane where the next reclaim starts looking */
+static uint32_t lru_reclaim_lane;
+
+/* Entries a reclaim examines in each queue before giving up on it */
+#define LRU_CLOCK_SWEEP (4 * LRU_N_Q_LANES)
+
+static uint64_t lru_misses;
+static uint64_t lru_promotions;
+static uint64_t lru_evictions_l1;
+static uint64_t lru_evictions_l2;
+static uint64_t lru_ghost_hits_l1;
+static uint64_t lru_ghost_hits_l2;
+
 /**
  * This is a global counter of files opened by cache_inode.  This is
  * preliminary expected to go away.  Problems with this method are
@@ -276,12 +319,66 @@ lru_lane_of_entry(cache_entry_t *entry)
     return (uint32_t) (((uintptr_t) entry) % LRU_N_Q_LANES);
 }
 
+/**
+ * @brief Find the lane whose hit counter a thread uses
+ *
+ * Hits are counted by thread rather than by entry, so that threads
+ * hammering the same entry do not share a counter as well.
+ *
+ * @return The lane of the calling thread.
+ */
+
+static inline uint32_t
+lru_lane_of_thread(void)
+{
+     static uint32_t next_lane;
+     static __thread int32_t lane = -1;
+
+     if (lane < 0) {
+          lane = atomic_inc_uint32_t(&next_lane) % LRU_N_Q_LANES;
+     }
+
+     return lane;
+}
+
+/**
+ * @brief Take a reference unless the entry is dead
+ *
+ * The reference count is incremented by compare and swap, unless it
+ * is 0.  No lock is needed; the caller must only make sure the entry
+ * cannot be freed meanwhile, by holding its queue lock or the hash
+ * table partition lock it was found under.
+ *
+ * @param[in] lru  The entry
+ *
+ * @retval TRUE if the reference was taken.
+ * @retval FALSE if the reference count was 0.
+ */
+
+static inline bool_t
+lru_try_ref(cache_inode_lru_t *lru)
+{
+     int64_t refcount = atomic_fetch_int64_t(&lru->refcount);
+     int64_t seen = 0;
+
+     while (refcount != 0) {
+          seen = __sync_val_compare_and_swap(&lru->refcount, refcount,
+                                             refcount + 1);
+          if (seen == refcount) {
+               return TRUE;
+          }
+          refcount = seen;
+     }
+
+     return FALSE;
+}
+
 /**
  * @brief Insert an entry into the specified queue fragment
  *
  * This function determines the queue corresponding to the supplied
- * lane and flags, inserts the entry into that queue, and updates the
- * entry to holds the flags and lane.
+ * lane and flags, inserts the entry at the MRU end of that queue, and
+ * updates the entry to holds the flags and lane.
  *
  * The caller MUST have a lock on the entry and MUST NOT hold a lock
  * on the queue.
@@ -301,7 +398,7 @@ lru_insert_entry(cache_inode_lru_t *lru, uint32_t flags, uint32_t lane)
 
      d = lru_select_queue(flags, lane);
      pthread_mutex_lock(&d->mtx);
-     glist_add(&d->q, &lru->q);
+     glist_add_tail(&d->q, &lru->q);
      ++(d->size);
      pthread_mutex_unlock(&d->mtx);
 
@@ -349,8 +446,8 @@ lru_remove_entry(cache_inode_lru_t *lru)
  * @brief Move an entry from one queue fragment to another
  *
  * This function moves an entry from the queue containing it to the
- * queue specified by the lane and flags.  The entry MUST be locked
- * and no queue locks may be held.
+ * MRU end of the queue specified by the lane and flags.  The entry
+ * MUST be locked and no queue locks may be held.
  *
  * @param[in] lru   The entry to move
  * @param[in] flags As accepted by lru_select_queue
@@ -395,16 +492,7 @@ lru_move_entry(cache_inode_lru_t *lru,
      glist_del(&lru->q);
      --(s->size);
 
-     /* When moving from L2 to L1, add to the LRU, otherwise add to
-        the MRU.  (In general we don't want to promote things except
-        on initial reference, but promoting things on move makes more
-        sense than demoting them.) */
-     if ((lru->flags & LRU_ENTRY_L2) &&
-         !(flags & LRU_ENTRY_L2)) {
-          glist_add_tail(&d->q, &lru->q);
-     } else {
-          glist_add(&d->q, &lru->q);
-     }
+     glist_add_tail(&d->q, &lru->q);
      ++(d->size);
 
      pthread_mutex_unlock(&s->mtx);
@@ -460,11 +548,15 @@ cache_inode_lru_clean(cache_entry_t *entry)
 /**
  * @brief Try to pull an entry off the queue
  *
- * This function examines the end of the specified queue and if the
- * entry found there can be re-used, it returns with the entry
+ * This function examines the cold end of the specified queue and if
+ * the entry found there can be re-used, it returns with the entry
  * locked.  Otherwise, it returns NULL.  The caller MUST NOT hold a
  * lock on the queue when this function is called.
  *
+ * An entry referenced since it was last examined, or in use, is
+ * moved to the warm end of L2 instead.  An evicted entry is
+ * remembered in the ghost table.
+ *
  * This function follows the locking discipline detailed above.  it
  * returns an lru entry removed from the queue system and which we are
  * permitted to dispose or recycle.
@@ -476,6 +568,7 @@ static inline cache_inode_lru_t *
 lru_try_reap_entry(struct lru_q_base *q)
 {
      cache_inode_lru_t *lru = NULL;
+     uint32_t from = LRU_GHOST_L1;
 
      pthread_mutex_lock(&q->mtx);
      lru = glist_first_entry(&q->q, cache_inode_lru_t, q);
@@ -484,41 +577,68 @@ lru_try_reap_entry(struct lru_q_base *q)
           return NULL;
      }
 
-     atomic_inc_int64_t(&lru->refcount);
+     if (!lru_try_ref(lru)) {
+          /* Its last reference is being released, the thread that
+             released it will take it off the queue. */
+          pthread_mutex_unlock(&q->mtx);
+          return NULL;
+     }
      pthread_mutex_unlock(&q->mtx);
      pthread_mutex_lock(&lru->mtx);
      if ((lru->flags & LRU_ENTRY_CONDEMNED) ||
          (lru->flags & LRU_ENTRY_KILLED)) {
+          /* Without the sentinel, ours may be the last reference.
+             This unlocks the entry. */
+          cache_inode_lru_unref(container_of(lru, cache_entry_t, lru),
+                                LRU_FLAG_LOCKED);
+          return NULL;
+     }
+     /* From here on the entry is not killed, and cannot be while we
+        hold its lock, so the sentinel keeps our decrements from
+        bringing the reference count to 0. */
+     if ((lru->flags & LRU_ENTRY_PINNED) ||
+         (lru->lane == LRU_NO_LANE)) {
+          /* Someone moved it to the pin queue while we were
+             waiting. */
           atomic_dec_int64_t(&lru->refcount);
           pthread_mutex_unlock(&lru->mtx);
           return NULL;
      }
-     if ((lru->refcount > (LRU_SENTINEL_REFCOUNT + 1)) ||
-         (lru->flags & LRU_ENTRY_PINNED)) {
-          /* Any more than the sentinel and our reference count
-             and someone else has a reference.  Plus someone may
-             have moved it to the pin queue while we were waiting. */
+     if ((atomic_fetch_int64_t(&lru->refcount) >
+          (LRU_SENTINEL_REFCOUNT + 1)) ||
+         atomic_fetch_uint32_t(&lru->referenced)) {
+          /* Any more than the sentinel and our reference count and
+             someone else has a reference.  Either way the entry is
+             in use: give it another round, in L2. */
+          if (!(lru->flags & LRU_ENTRY_L2)) {
+               atomic_inc_uint64_t(&lru_promotions);
+          }
+          atomic_store_uint32_t(&lru->referenced, 0);
+          lru_move_entry(lru, LRU_ENTRY_L2, lru->lane);
           atomic_dec_int64_t(&lru->refcount);
           pthread_mutex_unlock(&lru->mtx);
           return NULL;
      }
      /* At this point, we have legitimate access to the entry,
         and we go through the disposal/recycling discipline. */
+     if (lru->flags & LRU_ENTRY_L2) {
+          from = LRU_GHOST_L2;
+     }
 
      /* Make sure the entry is still where we think it is. */
      q = lru_select_queue(lru->flags, lru->lane);
      pthread_mutex_lock(&q->mtx);
-     if (lru->refcount > LRU_SENTINEL_REFCOUNT + 1) {
-          /* Someone took a reference while we were waiting for the
-             queue.  */
+     /* Drop the refcount to 0, unless someone took a reference since
+        we looked, which they may do without any lock. */
+     if (!__sync_bool_compare_and_swap(&lru->refcount,
+                                       LRU_SENTINEL_REFCOUNT + 1, 0)) {
           atomic_dec_int64_t(&lru->refcount);
           pthread_mutex_unlock(&lru->mtx);
           pthread_mutex_unlock(&q->mtx);
           return NULL;
      }
-     /* Drop the refcount to 0, set the flag to tell other threads to
-        stop access immediately. */
-     lru->refcount = 0;
+     /* Set the flag to tell other threads to stop access
+        immediately. */
      lru->flags = LRU_ENTRY_CONDEMNED;
      glist_del(&lru->q);
      --(q->size);
@@ -529,9 +649,70 @@ lru_try_reap_entry(struct lru_q_base *q)
      pthread_mutex_unlock(&q->mtx);
      pthread_yield();
 
+     if (from == LRU_GHOST_L1) {
+          atomic_inc_uint64_t(&lru_evictions_l1);
+     } else {
+          atomic_inc_uint64_t(&lru_evictions_l2);
+     }
+     if (lru_ghost) {
+          lru_ghost_add(lru_ghost,
+                        container_of(lru, cache_entry_t, lru)->fsdata.hash,
+                        from);
+     }
+
      return lru;
 }
 
+/**
+ * @brief Find an entry to recycle
+ *
+ * This function chooses the queue to evict from, L1 if it is above
+ * its target size and L2 otherwise, and sweeps the cold ends of its
+ * lanes.  If nothing can be evicted there, it sweeps the other
+ * queue.
+ *
+ * @return An entry as returned by lru_try_reap_entry, or NULL.
+ */
+
+static cache_inode_lru_t *
+lru_reclaim_entry(void)
+{
+     /* Entries in L1 and L2.  The sizes are read without the queue
+        locks: they only guide the choice of a queue. */
+     uint64_t l1 = 0;
+     uint64_t l2 = 0;
+     uint32_t flags = 0;
+     uint32_t start = 0;
+     uint32_t lane = 0;
+     int pass = 0;
+     int i = 0;
+     cache_inode_lru_t *lru = NULL;
+
+     for (lane = 0; lane < LRU_N_Q_LANES; ++lane) {
+          l1 += LRU_1[lane].lru.size;
+          l2 += LRU_2[lane].lru.size;
+     }
+
+     if (!lru_ghost_evict_l1(l1, l2,
+                             atomic_fetch_uint64_t(&lru_target_l1))) {
+          flags = LRU_ENTRY_L2;
+     }
+
+     start = atomic_inc_uint32_t(&lru_reclaim_lane);
+     for (pass = 0; pass < 2; ++pass) {
+          for (i = 0; i < LRU_CLOCK_SWEEP; ++i) {
+               lane = (start + i) % LRU_N_Q_LANES;
+               lru = lru_try_reap_entry(lru_select_queue(flags, lane));
+               if (lru) {
+                    return lru;
+               }
+          }
+          flags ^= LRU_ENTRY_L2;
+     }
+
+     return NULL;
+}
+
 static const uint32_t S_NSECS = 1000000000UL; /* nsecs in 1s */
 static const uint32_t MS_NSECS = 1000000UL; /* nsecs in 1ms */
 
@@ -566,6 +747,100 @@ lru_thread_delay_ms(unsigned long ms)
      return woke;
 }
 
+/* Entries whose FD is closed under one hold of a queue lock */
+#define LRU_FD_BATCH 64
+
+/**
+ * @brief Close the FDs of the coldest entries of a queue
+ *
+ * This function picks, from the cold end of the queue, entries with
+ * an open FD that were not used since the reclaim last came by (any
+ * entry, in extremis) and closes their FD.  It takes a reference on
+ * each entry while it holds the queue lock, then locks the entries
+ * one by one, as required by the lock discipline.  As closed entries
+ * are skipped, the next batch starts again from the cold end.
+ *
+ * @param[in]     q        The queue fragment
+ * @param[in]     work     Most entries to process
+ * @param[in]     extremis Whether to close FDs of used entries too
+ * @param[in,out] closed   Incremented for each FD closed
+ *
+ * @return The number of entries processed.
+ */
+
+static size_t
+lru_reap_fds(struct lru_q_base *q,
+             size_t work,
+             bool_t extremis,
+             size_t *closed)
+{
+     /* Entries of the current batch */
+     cache_inode_lru_t *batch[LRU_FD_BATCH];
+     /* Most entries to look at, including those skipped */
+     size_t window = MAX(lru_state.per_lane_work,
+                         lru_state.biggest_window / LRU_N_Q_LANES);
+     size_t workdone = 0;
+     size_t scanned = 0;
+     size_t n = 0;
+     size_t i = 0;
+     struct glist_head *glist = NULL;
+     cache_inode_lru_t *lru = NULL;
+     cache_entry_t *entry = NULL;
+     cache_inode_status_t cache_status = CACHE_INODE_SUCCESS;
+
+     do {
+          n = 0;
+          scanned = 0;
+          pthread_mutex_lock(&q->mtx);
+          glist_for_each(glist, &q->q) {
+               if ((n == LRU_FD_BATCH) || (workdone + n == work) ||
+                   (scanned++ == window)) {
+                    break;
+               }
+               lru = glist_entry(glist, cache_inode_lru_t, q);
+               /* Read without the entry lock, checked again below */
+               if (!cache_inode_fd(container_of(lru, cache_entry_t,
+                                                lru))) {
+                    continue;
+               }
+               if (!extremis && atomic_fetch_uint32_t(&lru->referenced)) {
+                    continue;
+               }
+               if (lru_try_ref(lru)) {
+                    batch[n++] = lru;
+               }
+          }
+          pthread_mutex_unlock(&q->mtx);
+
+          for (i = 0; i < n; ++i) {
+               lru = batch[i];
+               entry = container_of(lru, cache_entry_t, lru);
+               pthread_mutex_lock(&lru->mtx);
+               if (!(lru->flags & (LRU_ENTRY_CONDEMNED |
+                                   LRU_ENTRY_PINNED |
+                                   LRU_ENTRY_KILLED)) &&
+                   (lru->lane != LRU_NO_LANE) &&
+                   cache_inode_fd(entry)) {
+                    cache_inode_close(entry,
+                                      CACHE_INODE_FLAG_REALLYCLOSE,
+                                      &cache_status);
+                    if (cache_status != CACHE_INODE_SUCCESS) {
+                         LogCrit(COMPONENT_CACHE_INODE_LRU,
+                                 "Error closing file in LRU thread.");
+                    } else {
+                         ++(*closed);
+                    }
+               }
+               /* Ours may be the last reference, if the entry was
+                  killed meanwhile.  This unlocks the entry. */
+               cache_inode_lru_unref(entry, LRU_FLAG_LOCKED);
+          }
+          workdone += n;
+     } while ((n == LRU_FD_BATCH) && (workdone < work));
+
+     return workdone;
+}
+
 /**
  * @brief Function that executes in the lru thread
  *
@@ -581,13 +856,10 @@ lru_thread_delay_ms(unsigned long ms)
  *
  *  - If the number of open FDs is between the low and high water
  *    mark, make one pass through the queues, and exit.  Each pass
- *    consists of taking an entry from L1, examining to see if it is a
- *    regular file not bearing state with an open FD, closing the open
- *    FD if it is, and then moving it to L2.  The advantage of the two
- *    level system is twofold: First, seldom used entries congregate
- *    in L2 and the promotion behaviour provides some scan
- *    resistance.  Second, once an entry is examined, it is moved to
- *    L2, so we won't examine the same cache entry repeatedly.
+ *    consists of closing the FDs of regular files not bearing state,
+ *    starting from the cold end of L1, then of L2, and skipping
+ *    entries used since the reclaim last came by.  Entries are not
+ *    moved, so that the order the reclaim relies on is kept.
  *
  *  - If the number of open FDs is greater than the high water mark,
  *    we consider ourselves to be in extremis.  In this case we make a
@@ -620,6 +892,8 @@ lru_thread(void *arg __attribute__((unused)))
 {
      /* Index */
      size_t lane = 0;
+     /* Entry pool index */
+     unsigned int class;
      /* Temporary holder for flags */
      uint32_t tmpflags = lru_state.flags;
      /* True if we are taking extreme measures to reclaim FDs. */
@@ -677,6 +951,10 @@ lru_thread(void *arg __attribute__((unused)))
                   LogFullDebug(COMPONENT_CACHE_INODE_LRU,
                                "Entry count below low water mark.  "
                                "Disabling reclaim.");
+                  /* Give the memory of the reclaimed entries back */
+                  for (class = 0; class < CACHE_INODE_HANDLE_SIZES;
+                       class++)
+                       pool_slab_reap(cache_inode_entry_pools[class]);
                }
           } else {
               if (t_count > lru_state.entries_hiwat) {
@@ -742,8 +1020,6 @@ lru_thread(void *arg __attribute__((unused)))
                          /* The amount of work done on this lane on
                             this pass. */
                          size_t workdone = 0;
-                         /* The current entry being examined. */
-                         cache_inode_lru_t *lru = NULL;
                          /* Number of entries closed in this run. */
                          size_t closed = 0;
 
@@ -752,76 +1028,14 @@ lru_thread(void *arg __attribute__((unused)))
                                   lru_state.per_lane_work,
                                   lane);
 
-                         pthread_mutex_lock(&LRU_1[lane].lru.mtx);
-                         while ((workdone < lru_state.per_lane_work) &&
-                                (lru = glist_first_entry(&LRU_1[lane].lru.q,
-                                                         cache_inode_lru_t,
-                                                         q))) {
-                              cache_inode_status_t cache_status
-                                   = CACHE_INODE_SUCCESS;
-                              cache_entry_t *entry
-                                   = container_of(lru, cache_entry_t, lru);
-
-                              /* We currently hold the lane queue
-                                 fragment mutex.  Due to lock
-                                 ordering, we are forbidden from
-                                 acquiring the LRU mutex directly.
-                                 therefore, we increase the reference
-                                 count of the entry and drop the
-                                 queue fragment mutex. */
-
-                              atomic_inc_int64_t(&lru->refcount);
-                              pthread_mutex_unlock(&LRU_1[lane].lru.mtx);
-
-                              /* Acquire the entry mutex.  If the entry
-                                 is condemned, removed, pinned, or in
-                                 L2, we have no interest in it. Also
-                                 decrement the refcount (since we just
-                                 incremented it.) */
-
-                              pthread_mutex_lock(&lru->mtx);
-                              atomic_dec_int64_t(&lru->refcount);
-                              if ((lru->flags & LRU_ENTRY_CONDEMNED) ||
-                                  (lru->flags & LRU_ENTRY_PINNED) ||
-                                  (lru->flags & LRU_ENTRY_L2) ||
-                                  (lru->flags & LRU_ENTRY_KILLED) ||
-                                  (lru->lane == LRU_NO_LANE)) {
-                                   /* Drop the entry lock, thenr
-                                      eacquire the queue lock so we
-                                      can make another trip through
-                                      the loop. */
-                                   pthread_mutex_unlock(&lru->mtx);
-                                   pthread_mutex_lock(&LRU_1[lane].lru.mtx);
-                                   /* By definition, if any of these
-                                      flags are set, the entry isn't
-                                      in this queue fragment any more. */
-                                   continue;
-                              }
-
-                              if (cache_inode_fd(entry)) {
-                                   cache_inode_close(
-                                        entry,
-                                        CACHE_INODE_FLAG_REALLYCLOSE,
-                                        &cache_status);
-                                   if (cache_status != CACHE_INODE_SUCCESS) {
-                                        LogCrit(COMPONENT_CACHE_INODE_LRU,
-                                                "Error closing file in "
-                                                "LRU thread.");
-                                   } else
-                                     ++closed;
-                              }
-                              /* Move the entry to L2 whatever the
-                                 result of examining it.*/
-                              lru_move_entry(lru, LRU_ENTRY_L2,
-                                             lru->lane);
-                              pthread_mutex_unlock(&lru->mtx);
-                              ++workdone;
-                              /* Reacquire the lock on the queue
-                                 fragment for the next run through
-                                 the loop. */
-                              pthread_mutex_lock(&LRU_1[lane].lru.mtx);
-                         }
-                         pthread_mutex_unlock(&LRU_1[lane].lru.mtx);
+                         /* Entries used once go first */
+                         workdone = lru_reap_fds(&LRU_1[lane].lru,
+                                                 lru_state.per_lane_work,
+                                                 extremis, &closed);
+                         workdone += lru_reap_fds(&LRU_2[lane].lru,
+                                                  lru_state.per_lane_work
+                                                  - workdone,
+                                                  extremis, &closed);
                          LogDebug(COMPONENT_CACHE_INODE_LRU,
                                   "Actually processed %zd entries on lane %zd "
                                   "closing %zd descriptors",
@@ -982,7 +1196,20 @@ cache_inode_lru_pkginit(void)
      pthread_mutex_init(&lru_mtx, NULL);
      pthread_cond_init(&lru_cv, NULL);
 
+     /* Remember as many evicted entries as the cache holds, as ARC
+        does.  L1 starts with no room of its own, and gets some as the
+        entries it loses come back. */
+     lru_target_l1 = 0;
+     lru_ghost = lru_ghost_create(lru_state.entries_hiwat);
+     if (lru_ghost == NULL) {
+          LogCrit(COMPONENT_CACHE_INODE_LRU,
+                  "Unable to allocate the table of evicted entries.  "
+                  "The size of L1 will not adapt.");
+          lru_target_l1 = lru_state.entries_hiwat / 2;
+     }
+
      for (ix = 0; ix < LRU_N_Q_LANES; ++ix) {
+          LRU_1[ix].hits = 0;
           /* L1, unpinned */
           lru_init_queue(&LRU_1[ix].lru);
           /* L1, pinned */
@@ -1038,6 +1265,46 @@ cache_inode_lru_pkgshutdown(void)
      pthread_mutex_unlock(&lru_mtx);
 }
 
+/**
+ * @brief Drop the trust in every cached entry
+ *
+ * Used when an upcall source has lost track of changes (e.g. an
+ * inotify queue overflow) and cannot say which handles are stale.
+ * Entries stay cached; their attributes and contents are fetched
+ * again on next use.
+ */
+
+void
+cache_inode_lru_invalidate_all(void)
+{
+     struct lru_q_base *queues[4];
+     struct glist_head *glist = NULL;
+     cache_inode_lru_t *lru = NULL;
+     cache_entry_t *entry = NULL;
+     size_t lane = 0;
+     int i = 0;
+
+     for (lane = 0; lane < LRU_N_Q_LANES; ++lane) {
+          queues[0] = &LRU_1[lane].lru;
+          queues[1] = &LRU_1[lane].lru_pinned;
+          queues[2] = &LRU_2[lane].lru;
+          queues[3] = &LRU_2[lane].lru_pinned;
+          for (i = 0; i < 4; ++i) {
+               pthread_mutex_lock(&queues[i]->mtx);
+               glist_for_each(glist, &queues[i]->q) {
+                    lru = glist_entry(glist, cache_inode_lru_t, q);
+                    entry = container_of(lru, cache_entry_t, lru);
+                    atomic_clear_uint32_t_bits(&entry->flags,
+                                               CACHE_INODE_TRUST_ATTRS |
+                                               CACHE_INODE_DIR_POPULATED |
+                                               CACHE_INODE_TRUST_CONTENT);
+                    cache_inode_negative_flush(entry);
+               }
+               pthread_mutex_unlock(&queues[i]->mtx);
+          }
+     }
+}
+
 /**
  * @brief Re-use or allocate an entry
  *
@@ -1046,45 +1313,34 @@ cache_inode_lru_pkgshutdown(void)
  * On success, this function always returns an entry with two
  * references (one for the sentinel, one to allow the caller's use.)
  *
- * @param[in] status  Returned status
- * @param[in] flags   Flags governing call
+ * A recycled entry whose handle would not fit is freed, and a new
+ * one allocated from the pool of the handle.
+ *
+ * @param[in] status     Returned status
+ * @param[in] flags      Flags governing call
+ * @param[in] handle_len Length of the handle the entry is for
  *
  * @return CACHE_INODE_SUCCESS or error.
  */
 
 cache_entry_t *
 cache_inode_lru_get(cache_inode_status_t *status,
-                    uint32_t flags)
+                    uint32_t flags,
+                    size_t handle_len)
 {
-     /* The lane from which we harvest (or into which we store) the
-        new entry.  Usually the lane assigned to this thread. */
-     uint32_t lane = 0;
      /* The LRU entry */
      cache_inode_lru_t *lru = NULL;
      /* The Cache entry being created */
      cache_entry_t *entry = NULL;
+     /* The pool of the handle */
+     unsigned int class = cache_inode_handle_class(handle_len);
 
      /* If we are in reclaim state, try to find an entry to recycle. */
      pthread_mutex_lock(&lru_mtx);
      if (lru_state.flags & LRU_STATE_RECLAIMING) {
           pthread_mutex_unlock(&lru_mtx);
 
-          /* Search through logical L2 entry. */
-          for (lane = 0; lane < LRU_N_Q_LANES; ++lane) {
-               lru = lru_try_reap_entry(&LRU_2[lane].lru);
-               if (lru)
-                    break;
-          }
-
-          /* Search through logical L1 if nothing was found in L2
-             (fall through, otherwise.) */
-          if (!lru) {
-               for (lane = 0; lane < LRU_N_Q_LANES; ++lane) {
-                    lru = lru_try_reap_entry(&LRU_1[lane].lru);
-                    if (lru)
-                         break;
-               }
-          }
+          lru = lru_reclaim_entry();
 
           /* If we found an entry, we hold a lock on it and it is
              ready to be recycled. */
@@ -1096,21 +1352,30 @@ cache_inode_lru_get(cache_inode_status_t *status,
                                  entry);
                }
                cache_inode_lru_clean(entry);
+               if (entry->handle_size < cache_inode_handle_sizes[class]) {
+                    pthread_mutex_destroy(&entry->lru.mtx);
+                    pool_free(cache_inode_entry_pools[
+                                   cache_inode_handle_class(
+                                        entry->handle_size)],
+                              entry);
+                    lru = NULL;
+               }
           }
      } else {
           pthread_mutex_unlock(&lru_mtx);
      }
 
      if (!lru) {
-          entry = pool_alloc(cache_inode_entry_pool, NULL);
+          entry = pool_alloc(cache_inode_entry_pools[class], NULL);
           if(entry == NULL) {
                LogCrit(COMPONENT_CACHE_INODE_LRU,
                        "can't allocate a new entry from cache pool");
                *status = CACHE_INODE_MALLOC_ERROR;
                goto out;
           }
+          entry->handle_size = cache_inode_handle_sizes[class];
           if (pthread_mutex_init(&entry->lru.mtx, NULL) != 0) {
-               pool_free(cache_inode_entry_pool, entry);
+               pool_free(cache_inode_entry_pools[class], entry);
                LogCrit(COMPONENT_CACHE_INODE_LRU,
                        "pthread_mutex_init of lru.mtx returned %d (%s)",
                        errno,
@@ -1127,6 +1392,7 @@ cache_inode_lru_get(cache_inode_status_t *status,
      entry->lru.refcount = 2;
      entry->lru.pin_refcnt = 0;
      entry->lru.flags = 0;
+     entry->lru.referenced = 0;
      pthread_mutex_lock(&entry->lru.mtx);
      lru_insert_entry(&entry->lru, 0,
                       lru_lane_of_entry(entry));
@@ -1164,7 +1430,9 @@ cache_inode_inc_pin_ref(cache_entry_t *entry)
      }
 
      if (!entry->lru.pin_refcnt && !(entry->lru.flags & LRU_ENTRY_PINNED)) {
-          lru_move_entry(&entry->lru, LRU_ENTRY_PINNED,
+          lru_move_entry(&entry->lru,
+                         LRU_ENTRY_PINNED |
+                         (entry->lru.flags & LRU_ENTRY_L2),
                          entry->lru.lane);
      }
      entry->lru.pin_refcnt++;
@@ -1218,7 +1486,9 @@ cache_inode_dec_pin_ref(cache_entry_t *entry)
      assert(entry->lru.refcount > 1);
      entry->lru.pin_refcnt--;
      if (!entry->lru.pin_refcnt && (entry->lru.flags & LRU_ENTRY_PINNED)) {
-          lru_move_entry(&entry->lru, 0, entry->lru.lane);
+          lru_move_entry(&entry->lru,
+                         entry->lru.flags & LRU_ENTRY_L2,
+                         entry->lru.lane);
      }
 
      /* Also release an LRU reference */
@@ -1229,6 +1499,58 @@ cache_inode_dec_pin_ref(cache_entry_t *entry)
      return CACHE_INODE_SUCCESS;
 }
 
+/**
+ * @brief Place a new entry according to its history
+ *
+ * This function is called once the handle of an entry got from
+ * cache_inode_lru_get is known.  An entry evicted lately goes to L2
+ * and moves the target size of L1: up if it was evicted from L1,
+ * down if it was evicted from L2.  Other entries stay in L1.
+ *
+ * @param[in] entry  The new entry
+ */
+
+void
+cache_inode_lru_admit(cache_entry_t *entry)
+{
+     uint32_t from = LRU_GHOST_NONE;
+     uint64_t target = 0;
+
+     atomic_inc_uint64_t(&lru_misses);
+
+     if (!lru_ghost) {
+          return;
+     }
+
+     from = lru_ghost_take(lru_ghost, entry->fsdata.hash);
+     if (from == LRU_GHOST_NONE) {
+          return;
+     }
+
+     if (from == LRU_GHOST_L1) {
+          atomic_inc_uint64_t(&lru_ghost_hits_l1);
+     } else {
+          atomic_inc_uint64_t(&lru_ghost_hits_l2);
+     }
+
+     /* Concurrent admissions may each adapt the same old target,
+        losing a step; that is harmless. */
+     target = lru_ghost_adapt(lru_ghost, from,
+                              atomic_fetch_uint64_t(&lru_target_l1),
+                              lru_state.entries_hiwat);
+     atomic_store_uint64_t(&lru_target_l1, target);
+
+     pthread_mutex_lock(&entry->lru.mtx);
+     if (!(entry->lru.flags & (LRU_ENTRY_L2 | LRU_ENTRY_CONDEMNED)) &&
+         (entry->lru.lane != LRU_NO_LANE)) {
+          lru_move_entry(&entry->lru,
+                         LRU_ENTRY_L2 |
+                         (entry->lru.flags & LRU_ENTRY_PINNED),
+                         entry->lru.lane);
+     }
+     pthread_mutex_unlock(&entry->lru.mtx);
+}
+
 /**
  * @brief Get a reference
  *
@@ -1236,6 +1558,9 @@ cache_inode_dec_pin_ref(cache_entry_t *entry)
  * entry is still live.  Terrible things will happen if you call this
  * function and don't check its return value.
  *
+ * No lock is taken: the reference count is incremented by compare
+ * and swap and the entry is marked as referenced for the reclaim.
+ *
  * @param[in] entry  The entry on which to get a reference
  * @param[in] flags  Flags indicating the type of reference sought
  *
@@ -1247,48 +1572,30 @@ cache_inode_status_t
 cache_inode_lru_ref(cache_entry_t *entry,
                     uint32_t flags)
 {
-     pthread_mutex_lock(&entry->lru.mtx);
-
-     /* Refuse to grant a reference if we're below the sentinel value
-        or the entry is being removed or recycled. */
-     if ((entry->lru.refcount == 0) ||
-         (entry->lru.flags & LRU_ENTRY_CONDEMNED)) {
-          pthread_mutex_unlock(&entry->lru.mtx);
-          return CACHE_INODE_DEAD_ENTRY;
-     }
-
-     /* These shouldn't ever be set */
-     flags &= ~(LRU_ENTRY_PINNED | LRU_ENTRY_L2);
-
      /* Initial and Scan are mutually exclusive. */
 
      assert(!((flags & LRU_REQ_INITIAL) &&
               (flags & LRU_REQ_SCAN)));
 
-     atomic_inc_int64_t(&entry->lru.refcount);
+     /* Refuse to grant a reference if we're below the sentinel value,
+        which means the entry is being removed or recycled. */
+     if (!lru_try_ref(&entry->lru)) {
+          return CACHE_INODE_DEAD_ENTRY;
+     }
 
-     /* Move an entry forward if this is an initial reference. */
+     /* Note the use of the entry if this is an initial reference.
+        The reclaim moves it when it comes by.  A scan is not a use,
+        so that a READDIR does not push out the entries used by
+        others. */
 
      if (flags & LRU_REQ_INITIAL) {
-          lru_move_entry(&entry->lru,
-                         /* Pinned stays pinned */
-                         flags | (entry->lru.flags &
-                                  LRU_ENTRY_PINNED),
-                         entry->lru.lane);
-     } else if ((flags & LRU_REQ_SCAN) &&
-                (entry->lru.flags & LRU_ENTRY_L2)) {
-          lru_move_entry(&entry->lru,
-                         /* Pinned stays pinned, L2 stays in L2. A
-                            reference got for SCAN must not be used
-                            to open an FD. */
-                         flags | (entry->lru.flags &
-                                  LRU_ENTRY_PINNED) |
-                         LRU_ENTRY_L2,
-                         entry->lru.lane);
+          /* Do not dirty the cache line if the bit is already set */
+          if (!atomic_fetch_uint32_t(&entry->lru.referenced)) {
+               atomic_store_uint32_t(&entry->lru.referenced, 1);
+          }
+          atomic_inc_uint64_t(&LRU_1[lru_lane_of_thread()].hits);
      }
 
-     pthread_mutex_unlock(&entry->lru.mtx);
-
      return CACHE_INODE_SUCCESS;
 }
 
@@ -1322,7 +1629,8 @@ void cache_inode_lru_kill(cache_entry_t *entry)
  *
  * This function relinquishes a reference on the given cache entry.
  * It follows the disposal/recycling lock discipline given at the
- * beginning of the file.
+ * beginning of the file: only the thread releasing the last
+ * reference takes any lock.
  *
  * The supplied entry is always either unlocked or destroyed by the
  * time this function returns.
@@ -1337,51 +1645,45 @@ void
 cache_inode_lru_unref(cache_entry_t *entry,
                       uint32_t flags)
 {
-     if (!(flags & LRU_FLAG_LOCKED)) {
-          pthread_mutex_lock(&entry->lru.mtx);
-     }
+     int64_t refcount = atomic_dec_int64_t(&entry->lru.refcount);
+     struct lru_q_base *q = NULL;
 
-     assert(entry->lru.refcount >= 1);
+     assert(refcount >= 0);
 
-     if (entry->lru.refcount == 1) {
-          struct lru_q_base *q
-               = lru_select_queue(entry->lru.flags,
-                                  entry->lru.lane);
-          pthread_mutex_lock(&q->mtx);
-          atomic_dec_int64_t(&entry->lru.refcount);
-          if (entry->lru.refcount == 0) {
-               /* Refcount has fallen to zero.  Remove the entry from
-                  the queue and mark it as dead. */
-               entry->lru.flags = LRU_ENTRY_CONDEMNED;
-               glist_del(&entry->lru.q);
-               --(q->size);
-               entry->lru.lane = LRU_NO_LANE;
-               /* Give other threads a chance to see that */
+     if (refcount > 0) {
+          if (flags & LRU_FLAG_LOCKED) {
                pthread_mutex_unlock(&entry->lru.mtx);
-               pthread_mutex_unlock(&q->mtx);
-               pthread_yield();
-               /* We should not need to hold the LRU mutex at this
-                  point.  The hash table locks will ensure that by
-                  the time this function completes successfully,
-                  other threads will either have received
-                  CACHE_INDOE_DEAD_ENTRY in the attempt to gain a
-                  reference, or we will have removed the hash table
-                  entry. */
-               cache_inode_lru_clean(entry);
-
-               pthread_mutex_destroy(&entry->lru.mtx);
-               pool_free(cache_inode_entry_pool, entry);
-               return;
-          } else {
-               pthread_mutex_unlock(&q->mtx);
           }
-     } else {
-          /* We may decrement the reference count without the queue
-             lock, since it cannot go to 0. */
-          atomic_dec_int64_t(&entry->lru.refcount);
+          return;
      }
 
+     /* Refcount has fallen to zero.  Nobody can take a reference any
+        more, nor will the reclaim condemn the entry: it is ours.
+        Remove the entry from the queue and mark it as dead. */
+     if (!(flags & LRU_FLAG_LOCKED)) {
+          pthread_mutex_lock(&entry->lru.mtx);
+     }
+     q = lru_select_queue(entry->lru.flags, entry->lru.lane);
+     pthread_mutex_lock(&q->mtx);
+     entry->lru.flags = LRU_ENTRY_CONDEMNED;
+     glist_del(&entry->lru.q);
+     --(q->size);
+     entry->lru.lane = LRU_NO_LANE;
+     /* Give other threads a chance to see that */
      pthread_mutex_unlock(&entry->lru.mtx);
+     pthread_mutex_unlock(&q->mtx);
+     pthread_yield();
+     /* We should not need to hold the LRU mutex at this point.  The
+        hash table locks will ensure that by the time this function
+        completes successfully, other threads will either have
+        received CACHE_INDOE_DEAD_ENTRY in the attempt to gain a
+        reference, or we will have removed the hash table entry. */
+     cache_inode_lru_clean(entry);
+
+     pthread_mutex_destroy(&entry->lru.mtx);
+     pool_free(cache_inode_entry_pools[
+                    cache_inode_handle_class(entry->handle_size)],
+               entry);
 }
 
 /**
@@ -1399,3 +1701,27 @@ void lru_wake_thread(uint32_t flags)
      if (lru_thread_state.flags & LRU_SLEEPING)
           pthread_cond_signal(&lru_cv);
 }
+
+/**
+ * @brief Get the use and replacement counts of the LRU
+ *
+ * @param[out] stats The counts
+ */
+
+void
+cache_inode_lru_get_stats(struct cache_inode_lru_stats *stats)
+{
+     uint32_t lane = 0;
+
+     stats->hits = 0;
+     for (lane = 0; lane < LRU_N_Q_LANES; ++lane) {
+          stats->hits += atomic_fetch_uint64_t(&LRU_1[lane].hits);
+     }
+     stats->misses = atomic_fetch_uint64_t(&lru_misses);
+     stats->promotions = atomic_fetch_uint64_t(&lru_promotions);
+     stats->evictions_l1 = atomic_fetch_uint64_t(&lru_evictions_l1);
+     stats->evictions_l2 = atomic_fetch_uint64_t(&lru_evictions_l2);
+     stats->ghost_hits_l1 = atomic_fetch_uint64_t(&lru_ghost_hits_l1);
+     stats->ghost_hits_l2 = atomic_fetch_uint64_t(&lru_ghost_hits_l2);
+     stats->target_l1 = atomic_fetch_uint64_t(&lru_target_l1);
+}
@@ -0,0 +1,234 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_lru_ghost.c
+ * @brief  Entries recently evicted from the cache inode LRU
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <pthread.h>
+#include "abstract_mem.h"
+#include "cache_inode_lru_ghost.h"
+
+/* Slots of a set */
+#define GHOST_WAYS 4
+
+struct ghost_slot
+{
+     uint64_t hash; /*< Hash of the handle */
+     uint64_t seq; /*< When it was evicted, 0 for an empty slot */
+     uint32_t queue; /*< LRU_GHOST_L1 or LRU_GHOST_L2 */
+};
+
+struct lru_ghost
+{
+     pthread_mutex_t mtx;
+     uint64_t nb_sets;
+     uint64_t seq; /*< Last sequence number given */
+     uint64_t size[3]; /*< Slots used, by queue */
+     struct ghost_slot slots[];
+};
+
+static struct ghost_slot *
+ghost_set(lru_ghost_t *ghost, uint64_t hash)
+{
+     /* The hash of a handle has the partition index in its high half,
+        which takes few values.  Mix both halves. */
+     hash ^= hash >> 29;
+     hash *= 0xbf58476d1ce4e5b9ULL;
+     hash ^= hash >> 32;
+
+     return &ghost->slots[(hash % ghost->nb_sets) * GHOST_WAYS];
+}
+
+/**
+ * @brief Create a table of evicted entries
+ *
+ * @param[in] capacity Number of entries remembered
+ *
+ * @return The table, or NULL if out of memory.
+ */
+
+lru_ghost_t *
+lru_ghost_create(uint64_t capacity)
+{
+     lru_ghost_t *ghost;
+     uint64_t nb_sets = (capacity + GHOST_WAYS - 1) / GHOST_WAYS;
+
+     if (nb_sets == 0)
+          nb_sets = 1;
+
+     ghost = gsh_calloc(1, sizeof(lru_ghost_t) +
+                        nb_sets * GHOST_WAYS * sizeof(struct ghost_slot));
+     if (ghost == NULL)
+          return NULL;
+
+     pthread_mutex_init(&ghost->mtx, NULL);
+     ghost->nb_sets = nb_sets;
+
+     return ghost;
+}
+
+/**
+ * @brief Free a table of evicted entries
+ *
+ * @param[in] ghost The table
+ */
+
+void
+lru_ghost_destroy(lru_ghost_t *ghost)
+{
+     pthread_mutex_destroy(&ghost->mtx);
+     gsh_free(ghost);
+}
+
+/**
+ * @brief Remember an evicted entry
+ *
+ * @param[in] ghost The table
+ * @param[in] hash  Hash of the handle of the entry, 0 if unknown
+ * @param[in] queue Queue it was evicted from
+ */
+
+void
+lru_ghost_add(lru_ghost_t *ghost, uint64_t hash, uint32_t queue)
+{
+     struct ghost_slot *set, *victim;
+     int i;
+
+     if (hash == 0)
+          return;
+
+     set = ghost_set(ghost, hash);
+
+     pthread_mutex_lock(&ghost->mtx);
+     victim = &set[0];
+     for (i = 0; i < GHOST_WAYS; i++) {
+          if ((set[i].seq != 0 && set[i].hash == hash) ||
+              set[i].seq == 0) {
+               victim = &set[i];
+               break;
+          }
+          if (set[i].seq < victim->seq)
+               victim = &set[i];
+     }
+     if (victim->seq != 0)
+          ghost->size[victim->queue]--;
+     victim->hash = hash;
+     victim->seq = ++ghost->seq;
+     victim->queue = queue;
+     ghost->size[queue]++;
+     pthread_mutex_unlock(&ghost->mtx);
+}
+
+/**
+ * @brief Forget an entry coming back into the cache
+ *
+ * @param[in] ghost The table
+ * @param[in] hash  Hash of the handle of the entry
+ *
+ * @return The queue it was evicted from, or LRU_GHOST_NONE if it is
+ *         not remembered.
+ */
+
+uint32_t
+lru_ghost_take(lru_ghost_t *ghost, uint64_t hash)
+{
+     struct ghost_slot *set;
+     uint32_t queue = LRU_GHOST_NONE;
+     int i;
+
+     if (hash == 0)
+          return LRU_GHOST_NONE;
+
+     set = ghost_set(ghost, hash);
+
+     pthread_mutex_lock(&ghost->mtx);
+     for (i = 0; i < GHOST_WAYS; i++) {
+          if (set[i].seq != 0 && set[i].hash == hash) {
+               queue = set[i].queue;
+               set[i].seq = 0;
+               ghost->size[queue]--;
+               break;
+          }
+     }
+     pthread_mutex_unlock(&ghost->mtx);
+
+     return queue;
+}
+
+/**
+ * @brief Move the target size of L1 after an entry came back
+ *
+ * An entry evicted from L1 asks for a bigger L1, one evicted from L2
+ * for a smaller one.  The step is bigger when the other queue's
+ * evicted entries are more numerous, as in ARC.
+ *
+ * @param[in] ghost    The table
+ * @param[in] queue    Queue the entry was evicted from
+ * @param[in] target   Current target size of L1
+ * @param[in] capacity Number of entries in the cache
+ *
+ * @return The new target.
+ */
+
+uint64_t
+lru_ghost_adapt(lru_ghost_t *ghost, uint32_t queue,
+                uint64_t target, uint64_t capacity)
+{
+     uint64_t l1, l2, step;
+
+     /* The entry coming back was already taken out of its queue,
+        hence the + 1 */
+     lru_ghost_sizes(ghost, &l1, &l2);
+
+     if (queue == LRU_GHOST_L1) {
+          step = (l2 > l1) ? l2 / (l1 + 1) : 1;
+          target = (target + step > capacity) ? capacity : target + step;
+     } else if (queue == LRU_GHOST_L2) {
+          step = (l1 > l2) ? l1 / (l2 + 1) : 1;
+          target = (target > step) ? target - step : 0;
+     }
+
+     return target;
+}
+
+/**
+ * @brief Get the number of entries remembered
+ *
+ * @param[in]  ghost The table
+ * @param[out] l1    Entries evicted from L1
+ * @param[out] l2    Entries evicted from L2
+ */
+
+void
+lru_ghost_sizes(lru_ghost_t *ghost, uint64_t *l1, uint64_t *l2)
+{
+     pthread_mutex_lock(&ghost->mtx);
+     *l1 = ghost->size[LRU_GHOST_L1];
+     *l2 = ghost->size[LRU_GHOST_L2];
+     pthread_mutex_unlock(&ghost->mtx);
+}
@@ -44,9 +44,10 @@
 #include "HashTable.h"
 #include "fsal.h"
 #include "cache_inode.h"
-#include "cache_inode_avl.h"
+#include "cache_inode_dirtree.h"
 #include "cache_inode_lru.h"
 #include "cache_inode_weakref.h"
+#include "cache_inode_refresh.h"
 #include "nfs4_acls.h"
 
 #include <unistd.h>
@@ -60,9 +61,21 @@
 cache_inode_gc_policy_t cache_inode_gc_policy;
 cache_inode_parameter_t cache_inode_params;
 
-pool_t *cache_inode_entry_pool;
+/* Most handles of the FSALs storing them at their length fit the
+   first two */
+const size_t cache_inode_handle_sizes[CACHE_INODE_HANDLE_SIZES] = {
+     32, 64, sizeof(fsal_handle_t)
+};
+
+pool_t *cache_inode_entry_pools[CACHE_INODE_HANDLE_SIZES];
 pool_t *cache_inode_symlink_pool;
 pool_t *cache_inode_dir_entry_pool;
+pool_t *cache_inode_file_cold_pool;
+pool_t *cache_inode_dir_tree_pool;
+
+/* Cold parts of files and dirent trees in use */
+static uint64_t cache_inode_files_cold;
+static uint64_t cache_inode_dirs;
 
 const char *cache_inode_err_str(cache_inode_status_t err)
 {
@@ -183,8 +196,32 @@ int cache_inode_compare_key_fsal(hash_buffer_t *buff1,
         return -1;              /* left member is the greater one */
       }
 
-      rc = FSAL_handlecmp((fsal_handle_t *)buff1->pdata,
-                          (fsal_handle_t *)buff2->pdata,
+      cache_inode_fsal_data_t *fsdata1 =
+        (cache_inode_fsal_data_t *) buff1->pdata;
+      cache_inode_fsal_data_t *fsdata2 =
+        (cache_inode_fsal_data_t *) buff2->pdata;
+
+      /* Handles hashed apart cannot be the same */
+      if(fsdata1->hash != 0 && fsdata2->hash != 0 &&
+         fsdata1->hash != fsdata2->hash)
+        return 1;
+
+      /* Hashed locally, the key is hashed over the bytes of its
+         descriptor, so equal handles have equal bytes: compare those,
+         not the whole fsal_handle_t.  The hash of the FSAL may equate
+         handles of different bytes, the FSAL compares them. */
+      if(cache_inode_params.use_fsal_hash == FALSE &&
+         fsdata1->fh_desc.len != 0 && fsdata2->fh_desc.len != 0)
+        {
+          if(fsdata1->fh_desc.len != fsdata2->fh_desc.len ||
+             memcmp(fsdata1->fh_desc.start, fsdata2->fh_desc.start,
+                    fsdata1->fh_desc.len) != 0)
+            return 1;
+          return 0;
+        }
+
+      rc = FSAL_handlecmp((fsal_handle_t *) fsdata1->fh_desc.start,
+                          (fsal_handle_t *) fsdata2->fh_desc.start,
                           &fsal_status);
       if((rc != 0) || FSAL_IS_ERROR(fsal_status))
         {
@@ -197,6 +234,29 @@ int cache_inode_compare_key_fsal(hash_buffer_t *buff1,
 } /* cache_inode_compare_key_fsal */
 
 
+/**
+ *
+ * @brief Find the pool of the entry of a handle
+ *
+ * @param[in] len Length of the handle
+ *
+ * @return Index of the smallest of cache_inode_handle_sizes that may
+ *         hold the handle.
+ */
+unsigned int cache_inode_handle_class(size_t len)
+{
+  unsigned int class;
+
+  if(!FSAL_HandleExactLen())
+    return CACHE_INODE_HANDLE_SIZES - 1;
+
+  for(class = 0; class < CACHE_INODE_HANDLE_SIZES - 1; class++)
+    if(len <= cache_inode_handle_sizes[class])
+      break;
+
+  return class;
+} /* cache_inode_handle_class */
+
 /**
  *
  * @brief Set the fsal_time in a pentry struct to the current time.
@@ -251,6 +311,7 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
 {
      cache_entry_t *entry = NULL;
      cache_entry_t *new_entry = NULL;
+     cache_inode_fsal_data_t keydata;
      hash_buffer_t key, value;
      int rc = 0;
      bool_t lrurefed = FALSE;
@@ -263,8 +324,13 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
 
      assert(attr);
 
-     key.pdata = fsdata->fh_desc.start;
-     key.len = fsdata->fh_desc.len;
+     /* Hash the handle once for the lookups and the insertion below */
+     keydata = *fsdata;
+     if (keydata.hash == 0)
+          (void) cache_inode_fsal_data_hash(&keydata);
+
+     key.pdata = &keydata;
+     key.len = sizeof(keydata);
 
      /* Check if the entry doesn't already exists */
      /* This is slightly ugly, since we make two tries in the event
@@ -303,7 +369,7 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
      HashTable_ReleaseLatched(fh_to_cache_entry_ht, &latch);
 
      /* Pull an entry off the LRU */
-     new_entry = cache_inode_lru_get(status, 0);
+     new_entry = cache_inode_lru_get(status, 0, fsdata->fh_desc.len);
      if (new_entry == NULL) {
           LogCrit(COMPONENT_CACHE_INODE,
                   "cache_inode_new_entry: cache_inode_lru_get failed");
@@ -349,22 +415,29 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
         just returned. */
      lrurefed = TRUE;
 
-     memset(&entry->handle, 0, sizeof(entry->handle));
+     memset(&entry->handle, 0, entry->handle_size);
      memcpy(&entry->handle,
             fsdata->fh_desc.start,
             fsdata->fh_desc.len);
-     entry->fh_desc.start = (caddr_t) &entry->handle;
-     entry->fh_desc.len = fsdata->fh_desc.len;
+     entry->fsdata.fh_desc.start = (caddr_t) &entry->handle;
+     entry->fsdata.fh_desc.len = fsdata->fh_desc.len;
+     entry->fsdata.hash = keydata.hash;
+
+     /* Now that it has a handle, place it in the LRU according to its
+        history */
+     cache_inode_lru_admit(entry);
 
      /* Enroll the object in the weakref table */
 
      entry->weakref =
           cache_inode_weakref_insert(entry);
-     assert(entry->weakref.ptr != 0); /* A NULL pointer here would
-                                         indicate a programming
-                                         error, such as an old entry
-                                         not being unenrolled from
-                                         the table. */
+     if (entry->weakref.ptr == NULL) {
+          LogCrit(COMPONENT_CACHE_INODE,
+                  "cache_inode_new_entry: unable to enroll the entry "
+                  "in the weakref table");
+          *status = CACHE_INODE_MALLOC_ERROR;
+          goto out;
+     }
      weakrefed = TRUE;
 
      /* Initialize the entry locks */
@@ -392,18 +465,18 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
                    "cache_inode_new_entry: Adding a REGULAR_FILE, entry=%p",
                    entry);
 
-          /* No locks, yet. */
-          init_glist(&entry->object.file.lock_list);
-#ifdef _USE_NLM
-          init_glist(&entry->object.file.nlm_share_list);   /* No associated NLM shares yet */
-#endif
+          /* No locks, shares or unstable data, yet. */
+          entry->object.file.cold = NULL;
+          /* Writes done before the entry was made are not numbered:
+             the first commit has to run */
+          entry->object.file.write_seq = 1;
+          entry->object.file.synced_seq = 0;
+          entry->object.file.commit_running = FALSE;
 
           entry->object.file.open_fd.openflags = FSAL_O_CLOSED;
           memset(&(entry->object.file.open_fd.fd), 0, sizeof(fsal_file_t));
-          memset(&(entry->object.file.unstable_data), 0,
-                 sizeof(cache_inode_unstable_data_t));
-          memset(&(entry->object.file.share_state), 0,
-                 sizeof(cache_inode_share_t));
+          memset(&entry->object.file.readahead, 0,
+                 sizeof(cache_inode_readahead_t));
           break;
 
      case DIRECTORY:
@@ -424,14 +497,25 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
                                           CACHE_INODE_DIR_POPULATED);
           }
 
-          entry->object.dir.avl.collisions = 0;
+          entry->object.dir.tree =
+               pool_alloc(cache_inode_dir_tree_pool, NULL);
+          if (entry->object.dir.tree == NULL) {
+               LogDebug(COMPONENT_CACHE_INODE,
+                        "Can't allocate entry dirents from tree pool");
+
+               *status = CACHE_INODE_MALLOC_ERROR;
+               goto out;
+          }
+          atomic_inc_uint64_t(&cache_inode_dirs);
           entry->object.dir.nbactive = 0;
           entry->object.dir.referral = NULL;
           entry->object.dir.parent.ptr = NULL;
           entry->object.dir.parent.gen = 0;
           entry->object.dir.root = FALSE;
-          /* init avl tree */
-          cache_inode_avl_init(entry);
+          entry->object.dir.negative = NULL;
+          entry->object.dir.negative_gen = 0;
+          /* init dirent tree */
+          cache_inode_dirtree_init(entry);
           break;
      case SYMBOLIC_LINK:
           LogDebug(COMPONENT_CACHE_INODE,
@@ -479,8 +563,8 @@ cache_inode_new_entry(cache_inode_fsal_data_t *fsdata,
      cache_inode_fixup_md(entry);
 
      /* Adding the entry in the hash table */
-     key.pdata = entry->fh_desc.start;
-     key.len = entry->fh_desc.len;
+     key.pdata = &entry->fsdata;
+     key.len = sizeof(entry->fsdata);
 
      value.pdata = entry;
      value.len = sizeof(cache_entry_t);
@@ -511,6 +595,10 @@ out:
                     cache_inode_release_symlink(entry);
                     break;
 
+               case DIRECTORY:
+                    cache_inode_release_dir_tree(entry);
+                    break;
+
                default:
                     break;
                }
@@ -782,7 +870,7 @@ cache_inode_types_are_rename_compatible(cache_entry_t *src,
  */
 void cache_inode_print_dir(cache_entry_t *entry)
 {
-  struct avltree_node *dirent_node;
+  cache_inode_dir_cursor_t cursor;
   cache_inode_dir_entry_t *dirent;
   int i = 0;
 
@@ -793,10 +881,9 @@ void cache_inode_print_dir(cache_entry_t *entry)
       return;
     }
 
-  dirent_node = avltree_first(&entry->object.dir.avl.t);
-  do {
-      dirent = avltree_container_of(dirent_node, cache_inode_dir_entry_t,
-                                    node_hk);
+  for (dirent = cache_inode_dirtree_first(entry, &cursor);
+       dirent != NULL;
+       dirent = cache_inode_dirtree_next(entry, &cursor)) {
       LogFullDebug(COMPONENT_CACHE_INODE,
                    "Name = %s, DIRECTORY entry = (%p, %"PRIu64") i=%d",
                    dirent->name.name,
@@ -804,7 +891,7 @@ void cache_inode_print_dir(cache_entry_t *entry)
                    dirent->entry.gen,
                    i);
       i++;
-  } while ((dirent_node = avltree_next(dirent_node)));
+  }
 
   LogFullDebug(COMPONENT_CACHE_INODE, "------------------");
 } /* cache_inode_print_dir */
@@ -827,70 +914,159 @@ void cache_inode_release_symlink(cache_entry_t *entry)
      }
 }
 
+/**
+ * @brief Get the cold part of a file, allocating it if need be
+ *
+ * The part is allocated the first time a file is locked, shared,
+ * written to the unstable buffer, used in two open modes at once or
+ * committed.  Several threads may race to allocate it, holding
+ * different locks, so it is published with a compare and swap.
+ *
+ * @param[in] entry The file
+ *
+ * @return The cold part, NULL if it could not be allocated.
+ */
+cache_inode_file_cold_t *cache_inode_file_cold_get(cache_entry_t *entry)
+{
+    cache_inode_file_cold_t *cold;
+
+    assert(entry->type == REGULAR_FILE);
+
+    cold = entry->object.file.cold;
+    if (cold != NULL)
+        return cold;
+
+    cold = pool_alloc(cache_inode_file_cold_pool, NULL);
+    if (cold == NULL)
+     {
+        LogCrit(COMPONENT_CACHE_INODE,
+                "Can't allocate file cold part from pool");
+        return NULL;
+     }
+
+    init_glist(&cold->lock_list);
+#ifdef _USE_NLM
+    init_glist(&cold->nlm_share_list);
+#endif
+    memset(&cold->unstable_data, 0, sizeof(cache_inode_unstable_data_t));
+    memset(&cold->share_state, 0, sizeof(cache_inode_share_t));
+    memset(cold->io_fds, 0, sizeof(cold->io_fds));
+    cold->io_fds_open = 0;
+    pthread_mutex_init(&cold->io_fds_mtx, NULL);
+    pthread_mutex_init(&cold->commit_mtx, NULL);
+    pthread_cond_init(&cold->commit_cond, NULL);
+
+    if (!__sync_bool_compare_and_swap(&entry->object.file.cold, NULL, cold))
+     {
+        pthread_mutex_destroy(&cold->io_fds_mtx);
+        pthread_mutex_destroy(&cold->commit_mtx);
+        pthread_cond_destroy(&cold->commit_cond);
+        pool_free(cache_inode_file_cold_pool, cold);
+        return entry->object.file.cold;
+     }
+
+    atomic_inc_uint64_t(&cache_inode_files_cold);
+    return cold;
+}
+
+/**
+ * @brief Release the cold part of a file
+ *
+ * The file must hold no lock or share any more.  Data left in the
+ * unstable buffer is dropped, descriptors left open are closed.
+ *
+ * @param[in] entry The file
+ */
+void cache_inode_release_file_cold(cache_entry_t *entry)
+{
+    cache_inode_file_cold_t *cold = entry->object.file.cold;
+
+    assert(entry->type == REGULAR_FILE);
+    if (cold)
+     {
+        assert(glist_empty(&cold->lock_list));
+        if (cold->unstable_data.buffer != NULL)
+            gsh_free(cold->unstable_data.buffer);
+        cache_inode_close_io_fds(entry);
+        assert(cold->io_fds_open == 0);
+        assert(!entry->object.file.commit_running);
+        pthread_mutex_destroy(&cold->io_fds_mtx);
+        pthread_mutex_destroy(&cold->commit_mtx);
+        pthread_cond_destroy(&cold->commit_cond);
+        pool_free(cache_inode_file_cold_pool, cold);
+        entry->object.file.cold = NULL;
+        atomic_dec_uint64_t(&cache_inode_files_cold);
+     }
+}
+
+/**
+ * @brief Release the dirent tree of a directory
+ *
+ * The cached dirents are released with it.
+ *
+ * @param[in] entry The directory
+ */
+void cache_inode_release_dir_tree(cache_entry_t *entry)
+{
+    assert(entry->type == DIRECTORY);
+    if (entry->object.dir.tree)
+     {
+        cache_inode_release_dirents(entry);
+        pool_free(cache_inode_dir_tree_pool, entry->object.dir.tree);
+        entry->object.dir.tree = NULL;
+        atomic_dec_uint64_t(&cache_inode_dirs);
+     }
+}
+
+/**
+ * @brief Get the memory used by entries and their cold parts
+ *
+ * @param[out] entry_size    Size of an entry
+ * @param[out] embedded_size Size an entry would have with its cold
+ *                           parts inside it
+ * @param[out] files_cold    Files with a cold part allocated
+ * @param[out] dirs          Directories, each with its dirent tree
+ */
+void cache_inode_memory_get_stats(size_t *entry_size,
+                                  size_t *embedded_size,
+                                  uint64_t *files_cold,
+                                  uint64_t *dirs)
+{
+    /* The type specific part, with the cold parts in place of the
+       pointers to them */
+    size_t file = sizeof(struct cache_inode_file__) -
+         sizeof(cache_inode_file_cold_t *) + sizeof(cache_inode_file_cold_t);
+    size_t dir = sizeof(struct cache_inode_dir__) -
+         sizeof(cache_inode_dir_tree_t *) + sizeof(cache_inode_dir_tree_t);
+
+    *entry_size = sizeof(cache_entry_t);  /* With a whole fsal_handle_t */
+    *embedded_size = sizeof(cache_entry_t) - sizeof(cache_inode_fsobj_t) +
+         (file > dir ? file : dir);
+    *files_cold = atomic_fetch_uint64_t(&cache_inode_files_cold);
+    *dirs = atomic_fetch_uint64_t(&cache_inode_dirs);
+}
+
 /**
  * @brief Release cached directory content
  *
  * This function releases the cached directory entries on a directory
- * cache entry.
+ * cache entry, deleted ones included.
  *
  * @param[in] entry Directory to have entries be released
- * @param[in] which Caches to clear (dense, sparse, or both)
  *
  */
-void cache_inode_release_dirents(cache_entry_t *entry,
-                                 cache_inode_avl_which_t which)
+void cache_inode_release_dirents(cache_entry_t *entry)
 {
-    struct avltree_node *dirent_node = NULL;
-    struct avltree_node *next_dirent_node = NULL;
-    struct avltree *tree = NULL;
-    cache_inode_dir_entry_t *dirent = NULL;
-
     /* Won't see this */
     if (entry->type != DIRECTORY)
         return;
 
-    switch (which)
-    {
-    case CACHE_INODE_AVL_NAMES:
-        tree = &entry->object.dir.avl.t;
-        break;
-
-    case CACHE_INODE_AVL_COOKIES:
-        tree = &entry->object.dir.avl.c;
-        break;
-
-    case CACHE_INODE_AVL_BOTH:
-        cache_inode_release_dirents(entry, CACHE_INODE_AVL_NAMES);
-        cache_inode_release_dirents(entry, CACHE_INODE_AVL_COOKIES);
-        /* tree == NULL */
-        break;
-
-    default:
-        /* tree == NULL */
-        break;
-    }
+    cache_inode_dirtree_release(entry);
 
-    if (tree) {
-          dirent_node = avltree_first(tree);
-
-          while( dirent_node )
-           {
-             next_dirent_node = avltree_next(dirent_node);
-             dirent = avltree_container_of(dirent_node,
-                                           cache_inode_dir_entry_t,
-                                           node_hk);
-             avltree_remove(dirent_node, tree);
-             pool_free(cache_inode_dir_entry_pool, dirent);
-             dirent_node = next_dirent_node;
-           }
-
-          if (tree == &entry->object.dir.avl.t) {
-              entry->object.dir.nbactive = 0;
-              atomic_clear_uint32_t_bits(&entry->flags,
-                                         (CACHE_INODE_TRUST_CONTENT |
-                                          CACHE_INODE_DIR_POPULATED));
-          }
-    }
+    entry->object.dir.nbactive = 0;
+    atomic_clear_uint32_t_bits(&entry->flags,
+                               (CACHE_INODE_TRUST_CONTENT |
+                                CACHE_INODE_DIR_POPULATED));
 }
 
 /**
@@ -909,15 +1085,43 @@ cache_inode_file_holds_state(cache_entry_t *entry)
 {
      return (entry != NULL) &&
              ((entry->type == REGULAR_FILE &&
-               !glist_empty(&entry->object.file.lock_list)) ||
+               entry->object.file.cold != NULL &&
+               !glist_empty(&entry->object.file.cold->lock_list)) ||
               !glist_empty(&entry->state_list));
 } /* cache_inode_file_holds_state */
 
+/**
+ * @brief Tell whether cached attributes may still be used
+ *
+ * The attribute lock must be held.
+ *
+ * @param[in] entry        The entry
+ * @param[in] current_time The time now
+ * @param[in] period       How long attributes are good for
+ *
+ * @return TRUE if the attributes were fetched less than period ago,
+ *         or never expire, and nothing else requires a refresh.
+ */
+
+static inline bool_t
+cache_inode_attrs_trusted(cache_entry_t *entry,
+                          time_t current_time,
+                          time_t period)
+{
+     return ((cache_inode_params.expire_type_attr == CACHE_INODE_EXPIRE_NEVER) ||
+             (current_time - entry->attr_time < period)) &&
+          (entry->flags & CACHE_INODE_TRUST_ATTRS) &&
+          !((cache_inode_params.getattr_dir_invalidation) &&
+            (entry->type == DIRECTORY));
+}
+
 /**
  * @brief Conditionally refresh attributes
  *
  * This function tests whether we should still trust the current
- * attributes and, if not, refresh them.
+ * attributes and, if not, refresh them.  Attributes close to expiry
+ * are queued for a background refresh.  Attributes expired by less
+ * than Attr_Stale_Bound are queued likewise, and used meanwhile.
  *
  * @param[in] entry   The entry to refresh
  * @param[in] context FSAL credentials
@@ -931,8 +1135,6 @@ cache_inode_check_trust(cache_entry_t *entry,
 {
      time_t current_time = 0;
      cache_inode_status_t status = CACHE_INODE_SUCCESS;
-     time_t oldmtime = 0;
-     fsal_status_t fsal_status = {0, 0};
 
      if ((entry->type == FS_JUNCTION) ||
          (entry->type == UNASSIGNED) ||
@@ -948,31 +1150,70 @@ cache_inode_check_trust(cache_entry_t *entry,
      pthread_rwlock_rdlock(&entry->attr_lock);
      current_time = time(NULL);
 
-     oldmtime = entry->attributes.mtime.seconds;
-
      /* Do we need a refresh? */
-     if (((cache_inode_params.expire_type_attr == CACHE_INODE_EXPIRE_NEVER) ||
-          (current_time - entry->attr_time <
-           cache_inode_params.grace_period_attr)) &&
-         (entry->flags & CACHE_INODE_TRUST_ATTRS) &&
-         !((cache_inode_params.getattr_dir_invalidation)&&
-           (entry->type == DIRECTORY))) {
-          goto unlock;
+     if (cache_inode_attrs_trusted(entry, current_time,
+                                   cache_inode_params.grace_period_attr)) {
+          cache_inode_refresh_hint(entry, context);
+          pthread_rwlock_unlock(&entry->attr_lock);
+          goto out;
+     }
+
+     /* Serve stale while revalidating, if not too stale */
+     if ((cache_inode_params.expire_type_attr == CACHE_INODE_EXPIRE) &&
+         (cache_inode_params.attr_stale_bound != 0) &&
+         cache_inode_attrs_trusted(entry, current_time,
+                                   cache_inode_params.grace_period_attr +
+                                   cache_inode_params.attr_stale_bound) &&
+         cache_inode_refresh_queue(entry, context)) {
+          cache_inode_refresh_note_stale();
+          pthread_rwlock_unlock(&entry->attr_lock);
+          goto out;
      }
 
      pthread_rwlock_unlock(&entry->attr_lock);
 
+     status = cache_inode_revalidate(entry, context,
+                                     cache_inode_params.grace_period_attr);
+
+out:
+     return status;
+}
+
+/**
+ * @brief Refresh attributes unless they are recent enough
+ *
+ * This function takes the attribute lock for write and, unless
+ * someone else refreshed the attributes less than period ago,
+ * refreshes them.  A symbolic link whose content expired is read
+ * again, and a directory whose mtime moved forward loses its cached
+ * dirents.  It is used by cache_inode_check_trust on expiry, and by
+ * the background refresh ahead of it.
+ *
+ * @param[in] entry   The entry to refresh
+ * @param[in] context FSAL credentials
+ * @param[in] period  Attributes fetched less than this ago are kept
+ *
+ * @return CACHE_INODE_SUCCESS or other status codes.
+ */
+
+cache_inode_status_t
+cache_inode_revalidate(cache_entry_t *entry,
+                       fsal_op_context_t *context,
+                       time_t period)
+{
+     time_t current_time = 0;
+     cache_inode_status_t status = CACHE_INODE_SUCCESS;
+     time_t oldmtime = 0;
+     fsal_status_t fsal_status = {0, 0};
+
      /* Update the atributes */
      pthread_rwlock_wrlock(&entry->attr_lock);
      current_time = time(NULL);
 
+     oldmtime = entry->attributes.mtime.seconds;
+
      /* Make sure no one else has first */
-     if (((cache_inode_params.expire_type_attr == CACHE_INODE_EXPIRE_NEVER) ||
-          (current_time - entry->attr_time <
-           cache_inode_params.grace_period_attr)) &&
-         (entry->flags & CACHE_INODE_TRUST_ATTRS) &&
-         !((cache_inode_params.getattr_dir_invalidation) &&
-           (entry->type == DIRECTORY))) {
+     if (cache_inode_attrs_trusted(entry, current_time, period)) {
           goto unlock;
      }
 
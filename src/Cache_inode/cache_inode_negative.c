@@ -0,0 +1,347 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_negative.c
+ * @brief  Names known not to exist in a directory
+ *
+ * The names are kept as 64 bit hashes in a small set-associative
+ * table: a name can only live in the NEGATIVE_WAYS slots of its set,
+ * and replaces the oldest of them.  The table is allocated with the
+ * first name remembered and protected by its own mutex, so that
+ * lookups holding the directory read lock can update it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "cache_inode.h"
+#include "cache_inode_negative.h"
+
+/* Slots of a set */
+#define NEGATIVE_WAYS 4
+
+struct negative_slot
+{
+  uint64_t hash; /*< Hash of the name, 0 for an empty slot */
+  time_t when; /*< When the FSAL said it did not exist */
+};
+
+struct cache_inode_negative
+{
+  pthread_mutex_t mtx;
+  uint32_t nb_sets;
+  struct negative_slot slots[];
+};
+
+static uint64_t negative_hits;
+static uint64_t negative_misses;
+static uint64_t negative_inserts;
+static uint64_t negative_invalidations;
+
+static bool_t
+negative_enabled(void)
+{
+  return (cache_inode_params.grace_period_negative != 0 &&
+          cache_inode_params.negative_cache_size != 0);
+}
+
+static uint64_t
+negative_hash(fsal_name_t *name)
+{
+  uint64_t h = 14695981039346656037ULL;
+  unsigned int i;
+
+  /* FNV-1a */
+  for(i = 0; i < name->len; i++)
+    {
+      h ^= (unsigned char) name->name[i];
+      h *= 1099511628211ULL;
+    }
+
+  /* Names differing in their last bytes are common (a.h, b.h...),
+     mix them into the bits choosing the set. */
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+
+  /* 0 marks an empty slot */
+  return h ? h : 1;
+}
+
+static struct negative_slot *
+negative_set(struct cache_inode_negative *neg, uint64_t hash)
+{
+  return &neg->slots[((hash >> 32) % neg->nb_sets) * NEGATIVE_WAYS];
+}
+
+/**
+ * @brief Get the generation of a directory
+ *
+ * To be read before asking the FSAL about a name, and given to
+ * cache_inode_negative_insert.
+ *
+ * @param[in] directory The directory
+ *
+ * @return The generation.
+ */
+
+uint32_t
+cache_inode_negative_gen(cache_entry_t *directory)
+{
+  return atomic_fetch_uint32_t(&directory->object.dir.negative_gen);
+}
+
+/**
+ * @brief Tell whether a name is known not to exist
+ *
+ * @param[in] directory The directory, at least read locked
+ * @param[in] name      The name
+ *
+ * @retval TRUE if the FSAL recently said the name did not exist.
+ * @retval FALSE otherwise.
+ */
+
+bool_t
+cache_inode_negative_lookup(cache_entry_t *directory,
+                            fsal_name_t *name)
+{
+  struct cache_inode_negative *neg = directory->object.dir.negative;
+  struct negative_slot *set;
+  uint64_t hash;
+  time_t now;
+  bool_t found = FALSE;
+  int i;
+
+  if(!negative_enabled())
+    return FALSE;
+
+  if(neg != NULL)
+    {
+      hash = negative_hash(name);
+      set = negative_set(neg, hash);
+      now = time(NULL);
+
+      pthread_mutex_lock(&neg->mtx);
+      for(i = 0; i < NEGATIVE_WAYS; i++)
+        {
+          if(set[i].hash != hash)
+            continue;
+          if(now - set[i].when < cache_inode_params.grace_period_negative)
+            found = TRUE;
+          else
+            set[i].hash = 0;
+          break;
+        }
+      pthread_mutex_unlock(&neg->mtx);
+    }
+
+  if(found)
+    atomic_inc_uint64_t(&negative_hits);
+  else
+    atomic_inc_uint64_t(&negative_misses);
+
+  return found;
+}
+
+/**
+ * @brief Remember that a name does not exist
+ *
+ * Nothing is remembered if the directory changed since gen was read.
+ *
+ * @param[in] directory The directory, at least read locked
+ * @param[in] name      The name the FSAL did not find
+ * @param[in] gen       Generation read before asking the FSAL
+ */
+
+void
+cache_inode_negative_insert(cache_entry_t *directory,
+                            fsal_name_t *name,
+                            uint32_t gen)
+{
+  struct cache_inode_negative *neg = directory->object.dir.negative;
+  struct negative_slot *set, *victim;
+  uint32_t nb_sets;
+  uint64_t hash;
+  int i;
+
+  if(!negative_enabled())
+    return;
+
+  if(neg == NULL)
+    {
+      nb_sets = (cache_inode_params.negative_cache_size + NEGATIVE_WAYS - 1)
+        / NEGATIVE_WAYS;
+      neg = gsh_calloc(1, sizeof(struct cache_inode_negative) +
+                       nb_sets * NEGATIVE_WAYS *
+                       sizeof(struct negative_slot));
+      if(neg == NULL)
+        return;
+      pthread_mutex_init(&neg->mtx, NULL);
+      neg->nb_sets = nb_sets;
+
+      /* Other lookups may hold the read lock as well */
+      if(!__sync_bool_compare_and_swap(&directory->object.dir.negative,
+                                       NULL, neg))
+        {
+          pthread_mutex_destroy(&neg->mtx);
+          gsh_free(neg);
+          neg = directory->object.dir.negative;
+        }
+    }
+
+  hash = negative_hash(name);
+  set = negative_set(neg, hash);
+
+  pthread_mutex_lock(&neg->mtx);
+  if(cache_inode_negative_gen(directory) == gen)
+    {
+      /* Among slots of the same age, let the hash pick */
+      victim = &set[hash % NEGATIVE_WAYS];
+      for(i = 0; i < NEGATIVE_WAYS; i++)
+        {
+          if(set[i].hash == hash || set[i].hash == 0)
+            {
+              victim = &set[i];
+              break;
+            }
+          if(set[i].when < victim->when)
+            victim = &set[i];
+        }
+      victim->hash = hash;
+      victim->when = time(NULL);
+      atomic_inc_uint64_t(&negative_inserts);
+    }
+  pthread_mutex_unlock(&neg->mtx);
+}
+
+/**
+ * @brief Forget a name that has just been created
+ *
+ * @param[in] directory The directory
+ * @param[in] name      The new name
+ */
+
+void
+cache_inode_negative_remove(cache_entry_t *directory,
+                            fsal_name_t *name)
+{
+  struct cache_inode_negative *neg;
+  struct negative_slot *set;
+  uint64_t hash;
+  int i;
+
+  if(directory->type != DIRECTORY)
+    return;
+
+  atomic_inc_uint32_t(&directory->object.dir.negative_gen);
+
+  neg = directory->object.dir.negative;
+  if(neg == NULL)
+    return;
+
+  hash = negative_hash(name);
+  set = negative_set(neg, hash);
+
+  pthread_mutex_lock(&neg->mtx);
+  for(i = 0; i < NEGATIVE_WAYS; i++)
+    if(set[i].hash == hash)
+      {
+        set[i].hash = 0;
+        atomic_inc_uint64_t(&negative_invalidations);
+      }
+  pthread_mutex_unlock(&neg->mtx);
+}
+
+/**
+ * @brief Forget every name of a directory
+ *
+ * @param[in] directory The directory
+ */
+
+void
+cache_inode_negative_flush(cache_entry_t *directory)
+{
+  struct cache_inode_negative *neg;
+
+  if(directory->type != DIRECTORY)
+    return;
+
+  atomic_inc_uint32_t(&directory->object.dir.negative_gen);
+
+  neg = directory->object.dir.negative;
+  if(neg == NULL)
+    return;
+
+  pthread_mutex_lock(&neg->mtx);
+  memset(neg->slots, 0,
+         neg->nb_sets * NEGATIVE_WAYS * sizeof(struct negative_slot));
+  pthread_mutex_unlock(&neg->mtx);
+
+  atomic_inc_uint64_t(&negative_invalidations);
+}
+
+/**
+ * @brief Free the names of a directory being cleaned up
+ *
+ * @param[in] directory The directory, no longer reachable
+ */
+
+void
+cache_inode_negative_release(cache_entry_t *directory)
+{
+  struct cache_inode_negative *neg = directory->object.dir.negative;
+
+  if(neg == NULL)
+    return;
+
+  directory->object.dir.negative = NULL;
+  pthread_mutex_destroy(&neg->mtx);
+  gsh_free(neg);
+}
+
+/**
+ * @brief Get the use counts of the negative cache
+ *
+ * @param[out] hits          Lookups answered from the cache
+ * @param[out] misses        Lookups that had to ask the FSAL
+ * @param[out] inserts       Names remembered
+ * @param[out] invalidations Names or directories forgotten
+ */
+
+void
+cache_inode_negative_get_stats(uint64_t *hits, uint64_t *misses,
+                               uint64_t *inserts,
+                               uint64_t *invalidations)
+{
+  *hits = atomic_fetch_uint64_t(&negative_hits);
+  *misses = atomic_fetch_uint64_t(&negative_misses);
+  *inserts = atomic_fetch_uint64_t(&negative_inserts);
+  *invalidations = atomic_fetch_uint64_t(&negative_invalidations);
+}
@@ -317,6 +317,8 @@ cache_inode_close(cache_entry_t *entry,
           }
           if (!FSAL_IS_ERROR(fsal_status))
               atomic_dec_size_t(&open_fd_count);
+
+          cache_inode_close_io_fds(entry);
      }
 
      *status = CACHE_INODE_SUCCESS;
@@ -331,3 +333,206 @@ out:
 
      return *status;
 }
+
+/**
+ * @brief Get a file descriptor for an I/O
+ *
+ * The file must be open.  Its cached descriptor, open_fd, serves the
+ * I/O if it is open read/write or in the mode asked for.  Otherwise,
+ * rather than closing open_fd to reopen it in that mode, which would
+ * need the content lock for write and close it under the feet of the
+ * other users of the file, a descriptor in that mode is taken from
+ * the set kept in the cold part of the file, and opened there if need
+ * be.  Descriptors of the set count against the FD limits of the LRU
+ * like open_fd, and are closed along with it.
+ *
+ * The caller holds the content lock, for read is enough, and gives
+ * the descriptor back with cache_inode_io_fd_put.
+ *
+ * @param[in]  entry     The file
+ * @param[in]  openflags FSAL_O_RDONLY, FSAL_O_WRONLY or
+ *                       FSAL_O_WRONLY | FSAL_O_SYNC
+ * @param[in]  context   FSAL operation context
+ * @param[out] fd        The descriptor
+ * @param[out] status    Operation status
+ *
+ * @return CACHE_INODE_SUCCESS or errors on failure
+ */
+
+cache_inode_status_t
+cache_inode_io_fd_get(cache_entry_t *entry,
+                      fsal_openflags_t openflags,
+                      fsal_op_context_t *context,
+                      fsal_file_t **fd,
+                      cache_inode_status_t *status)
+{
+     /* Error return from FSAL */
+     fsal_status_t fsal_status = {0, 0};
+     fsal_openflags_t loflags = entry->object.file.open_fd.openflags;
+     cache_inode_file_cold_t *cold;
+     cache_inode_io_fd_t *io_fd;
+     cache_inode_io_fd_mode_t mode;
+
+     *fd = NULL;
+
+     if (loflags == FSAL_O_CLOSED) {
+          *status = CACHE_INODE_INVALID_ARGUMENT;
+          return *status;
+     }
+
+     if ((loflags == FSAL_O_RDWR) || (loflags == openflags)) {
+          *fd = &entry->object.file.open_fd.fd;
+          *status = CACHE_INODE_SUCCESS;
+          return *status;
+     }
+
+     if (openflags == FSAL_O_RDONLY) {
+          mode = CACHE_INODE_IO_FD_READ;
+     } else if (openflags == FSAL_O_WRONLY) {
+          mode = CACHE_INODE_IO_FD_WRITE;
+     } else if (openflags == (FSAL_O_WRONLY | FSAL_O_SYNC)) {
+          mode = CACHE_INODE_IO_FD_SYNC_WRITE;
+     } else {
+          *status = CACHE_INODE_INVALID_ARGUMENT;
+          return *status;
+     }
+
+     if ((cold = cache_inode_file_cold_get(entry)) == NULL) {
+          *status = CACHE_INODE_MALLOC_ERROR;
+          return *status;
+     }
+
+     pthread_mutex_lock(&cold->io_fds_mtx);
+
+     io_fd = &cold->io_fds[mode];
+     if (io_fd->file.openflags == FSAL_O_CLOSED) {
+          if (!cache_inode_lru_fds_available()) {
+               *status = CACHE_INODE_DELAY;
+               goto unlock;
+          }
+
+          fsal_status = FSAL_open(&(entry->handle),
+                                  context,
+                                  openflags,
+                                  &io_fd->file.fd,
+                                  NULL);
+          if (FSAL_IS_ERROR(fsal_status)) {
+               *status = cache_inode_error_convert(fsal_status);
+               LogDebug(COMPONENT_CACHE_INODE,
+                        "cache_inode_io_fd_get: returning %d(%s) from "
+                        "FSAL_open", *status, cache_inode_err_str(*status));
+               if (fsal_status.major == ERR_FSAL_STALE) {
+                    cache_inode_kill_entry(entry);
+               }
+               goto unlock;
+          }
+
+          io_fd->file.openflags = openflags;
+          cold->io_fds_open++;
+          atomic_inc_size_t(&open_fd_count);
+
+          LogDebug(COMPONENT_CACHE_INODE,
+                   "cache_inode_io_fd_get: pentry %p: openflags = %d "
+                   "besides %d, open_fd_count = %zd", entry, openflags,
+                   loflags, open_fd_count);
+     }
+
+     /* Used again before its last user could close it */
+     io_fd->closing = FALSE;
+     io_fd->refcount++;
+     *fd = &io_fd->file.fd;
+     *status = CACHE_INODE_SUCCESS;
+
+unlock:
+
+     pthread_mutex_unlock(&cold->io_fds_mtx);
+
+     return *status;
+} /* cache_inode_io_fd_get */
+
+/* Close a descriptor of the set, with io_fds_mtx held */
+static void
+cache_inode_io_fd_close(cache_entry_t *entry,
+                        cache_inode_file_cold_t *cold,
+                        cache_inode_io_fd_t *io_fd)
+{
+     fsal_status_t fsal_status;
+
+     fsal_status = FSAL_close(&io_fd->file.fd);
+     if (FSAL_IS_ERROR(fsal_status) &&
+         (fsal_status.major != ERR_FSAL_NOT_OPENED)) {
+          LogCrit(COMPONENT_CACHE_INODE,
+                  "cache_inode_io_fd_close: entry %p: FSAL_close "
+                  "returned %d", entry, fsal_status.major);
+     }
+     if (!FSAL_IS_ERROR(fsal_status))
+         atomic_dec_size_t(&open_fd_count);
+
+     io_fd->file.openflags = FSAL_O_CLOSED;
+     io_fd->closing = FALSE;
+     cold->io_fds_open--;
+}
+
+/**
+ * @brief Give back a descriptor from cache_inode_io_fd_get
+ *
+ * @param[in] entry The file
+ * @param[in] fd    The descriptor
+ */
+
+void
+cache_inode_io_fd_put(cache_entry_t *entry, fsal_file_t *fd)
+{
+     cache_inode_file_cold_t *cold = entry->object.file.cold;
+     cache_inode_io_fd_t *io_fd;
+
+     if ((fd == NULL) || (fd == &entry->object.file.open_fd.fd)) {
+          return;
+     }
+
+     io_fd = container_of(fd, cache_inode_io_fd_t, file.fd);
+
+     pthread_mutex_lock(&cold->io_fds_mtx);
+     assert(io_fd->refcount != 0);
+     if ((--io_fd->refcount == 0) && io_fd->closing) {
+          cache_inode_io_fd_close(entry, cold, io_fd);
+     }
+     pthread_mutex_unlock(&cold->io_fds_mtx);
+}
+
+/**
+ * @brief Close the descriptors a file keeps besides open_fd
+ *
+ * Called when open_fd is really closed.  A descriptor still in use is
+ * closed by its last user.
+ *
+ * @param[in] entry The file
+ */
+
+void
+cache_inode_close_io_fds(cache_entry_t *entry)
+{
+     cache_inode_file_cold_t *cold = entry->object.file.cold;
+     int mode;
+
+     if (cold == NULL) {
+          return;
+     }
+
+     pthread_mutex_lock(&cold->io_fds_mtx);
+     for (mode = 0;
+          (mode < CACHE_INODE_IO_FD_MODES) && (cold->io_fds_open != 0);
+          mode++) {
+          cache_inode_io_fd_t *io_fd = &cold->io_fds[mode];
+
+          if (io_fd->file.openflags == FSAL_O_CLOSED) {
+               continue;
+          }
+          if (io_fd->refcount != 0) {
+               io_fd->closing = TRUE;
+          } else {
+               cache_inode_io_fd_close(entry, cold, io_fd);
+          }
+     }
+     pthread_mutex_unlock(&cold->io_fds_mtx);
+}
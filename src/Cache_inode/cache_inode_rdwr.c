@@ -59,6 +59,116 @@
 #include <time.h>
 #include <pthread.h>
 #include <assert.h>
+#include "abstract_atomic.h"
+
+/* The first window of a sequential stream, unless twice its READs are
+   more */
+#define CACHE_INODE_READAHEAD_MIN (128 * 1024)
+
+static uint64_t readahead_sequential;
+static uint64_t readahead_hits;
+static uint64_t readahead_hints;
+static uint64_t readahead_hinted_bytes;
+
+/**
+ * @brief Follow the READs of a file and hint the FSAL ahead of them
+ *
+ * A READ that starts where the previous one of the file ended is
+ * sequential.  The first sequential READ hints a window past its end,
+ * twice its size but at least CACHE_INODE_READAHEAD_MIN; once half
+ * the hinted range has been read, the range is extended by a window
+ * twice as large, up to the maximum of the export.  Any other READ
+ * ends the stream.
+ *
+ * Concurrent READs of the file race on next: only the one that swaps
+ * it updates the window, the others are not counted.  Two streams in
+ * one file look random and get no hints.
+ *
+ * @param[in] entry The file
+ * @param[in] fd    The descriptor the READ used
+ * @param[in] offset Where the READ started
+ * @param[in] size  Bytes read
+ * @param[in] eof   Whether the READ reached the end of file
+ * @param[in] max   Largest window, from the export
+ */
+
+static void
+cache_inode_readahead(cache_entry_t *entry,
+                      fsal_file_t *fd,
+                      uint64_t offset,
+                      size_t size,
+                      bool_t eof,
+                      size_t max)
+{
+     cache_inode_readahead_t *ra = &entry->object.file.readahead;
+     uint64_t end = offset + size;
+     uint64_t next = atomic_fetch_uint64_t(&ra->next);
+     uint64_t ahead, window, from;
+     fsal_status_t fsal_status;
+
+     if (!__sync_bool_compare_and_swap(&ra->next, next, end)) {
+          return;
+     }
+
+     if ((offset != next) || (size == 0)) {
+          atomic_store_uint64_t(&ra->window, 0);
+          atomic_store_uint64_t(&ra->ahead, 0);
+          return;
+     }
+
+     atomic_inc_uint64_t(&readahead_sequential);
+     ahead = atomic_fetch_uint64_t(&ra->ahead);
+     window = atomic_fetch_uint64_t(&ra->window);
+     if (end <= ahead) {
+          atomic_inc_uint64_t(&readahead_hits);
+     }
+
+     if (eof) {
+          return;
+     }
+
+     if (window == 0) {
+          window = MAX(2 * size, CACHE_INODE_READAHEAD_MIN);
+     }
+     window = MIN(window, max);
+
+     /* Still half a window ahead of the reads */
+     if (end + window / 2 <= ahead) {
+          return;
+     }
+
+     from = MAX(ahead, end);
+     fsal_status = FSAL_read_hint(fd, from, end + window - from);
+     if (!FSAL_IS_ERROR(fsal_status)) {
+          atomic_inc_uint64_t(&readahead_hints);
+          atomic_add_uint64_t(&readahead_hinted_bytes,
+                              end + window - from);
+     }
+
+     atomic_store_uint64_t(&ra->ahead, end + window);
+     atomic_store_uint64_t(&ra->window, MIN(2 * window, max));
+}
+
+/**
+ * @brief Get the readahead statistics
+ *
+ * @param[out] sequential   Sequential READs seen
+ * @param[out] hits         Those within a range hinted before
+ * @param[out] hints        Hints given to the FSAL
+ * @param[out] hinted_bytes Bytes they covered
+ */
+
+void
+cache_inode_readahead_get_stats(uint64_t *sequential,
+                                uint64_t *hits,
+                                uint64_t *hints,
+                                uint64_t *hinted_bytes)
+{
+     *sequential = atomic_fetch_uint64_t(&readahead_sequential);
+     *hits = atomic_fetch_uint64_t(&readahead_hits);
+     *hints = atomic_fetch_uint64_t(&readahead_hints);
+     *hinted_bytes = atomic_fetch_uint64_t(&readahead_hinted_bytes);
+}
 
 /**
  * @brief Reads/Writes through the cache layer
@@ -73,10 +183,14 @@
  * @param[in]     io_size      Amount of data to be read or written
  * @param[out]    bytes_moved  The length of data successfuly read or written
  * @param[in,out] buffer       Where in memory to read or write data
+ *                             (an int receiving a descriptor of the
+ *                             file, for CACHE_INODE_READ_PIPE)
  * @param[out]    eof          Whether a READ encountered the end of file.  May
  *                             be NULL for writes.
  * @param[in]     context      FSAL credentials
  * @param[in]     stable       The stability of the write to perform
+ * @param[in]     readahead    For reads, the most bytes to hint the FSAL
+ *                             ahead of a sequential stream, 0 for none
  * @param[out]    status       Status of operation
  *
  * @return CACHE_INODE_SUCCESS or various errors
@@ -92,19 +206,25 @@ cache_inode_rdwr(cache_entry_t *entry,
                  bool_t *eof,
                  fsal_op_context_t *context,
                  cache_inode_stability_t stable,
+                 size_t readahead,
                  cache_inode_status_t *status)
 {
      /* Error return from FSAL calls */
      fsal_status_t fsal_status = {0, 0};
      /* Required open mode to successfully read or write */
      fsal_openflags_t openflags = FSAL_O_CLOSED;
+     /* Open mode of the file descriptor used */
      fsal_openflags_t loflags;
+     /* The file descriptor used */
+     fsal_file_t *fd = NULL;
      /* TRUE if we have taken the content lock on 'entry' */
      bool_t content_locked = FALSE;
      /* TRUE if we have taken the attribute lock on 'entry' */
      bool_t attributes_locked = FALSE;
      /* TRUE if we opened a previously closed FD */
      bool_t opened = FALSE;
+     /* Holds the unstable buffer */
+     cache_inode_file_cold_t *cold = NULL;
      /* We need this until Jim Lieb redoes the FSAL interface.  But
         there's no reason to make users of cache_inode deal with it. */
      fsal_seek_t seek_descriptor = {
@@ -113,7 +233,7 @@ cache_inode_rdwr(cache_entry_t *entry,
      };
 
      /* Set flags for a read or write, as appropriate */
-     if (io_direction == CACHE_INODE_READ) {
+     if (io_direction != CACHE_INODE_WRITE) {
           openflags = FSAL_O_RDONLY;
      } else {
           openflags = FSAL_O_WRONLY;
@@ -132,19 +252,24 @@ cache_inode_rdwr(cache_entry_t *entry,
           pthread_rwlock_wrlock(&entry->content_lock);
           content_locked = TRUE;
 
+          if ((cold = cache_inode_file_cold_get(entry)) == NULL) {
+               *status = CACHE_INODE_MALLOC_ERROR;
+               goto out;
+          }
+
           /* Is the unstable_data buffer allocated? */
-          if ((entry->object.file.unstable_data.buffer == NULL) &&
+          if ((cold->unstable_data.buffer == NULL) &&
               (io_size <= CACHE_INODE_UNSTABLE_BUFFERSIZE)) {
-               if ((entry->object.file.unstable_data.buffer =
+               if ((cold->unstable_data.buffer =
                     gsh_malloc(CACHE_INODE_UNSTABLE_BUFFERSIZE)) == NULL) {
                     *status = CACHE_INODE_MALLOC_ERROR;
                     goto out;
                }
 
-               entry->object.file.unstable_data.offset = offset;
-               entry->object.file.unstable_data.length = io_size;
+               cold->unstable_data.offset = offset;
+               cold->unstable_data.length = io_size;
 
-               memcpy(entry->object.file.unstable_data.buffer,
+               memcpy(cold->unstable_data.buffer,
                       buffer, io_size);
 
                pthread_rwlock_wrlock(&entry->attr_lock);
@@ -152,11 +277,11 @@ cache_inode_rdwr(cache_entry_t *entry,
                cache_inode_set_time_current(&entry->attributes.mtime);
                *bytes_moved = io_size;
           } else {
-               if ((entry->object.file.unstable_data.offset < offset) &&
+               if ((cold->unstable_data.offset < offset) &&
                    (io_size + offset < CACHE_INODE_UNSTABLE_BUFFERSIZE)) {
-                    entry->object.file.unstable_data.length =
+                    cold->unstable_data.length =
                          io_size + offset;
-                    memcpy(entry->object.file.unstable_data.buffer +
+                    memcpy(cold->unstable_data.buffer +
                            offset, buffer, io_size);
 
                     pthread_rwlock_wrlock(&entry->attr_lock);
@@ -181,18 +306,15 @@ cache_inode_rdwr(cache_entry_t *entry,
      if (stable == CACHE_INODE_SAFE_WRITE_TO_FS ||
          stable == CACHE_INODE_UNSAFE_WRITE_TO_FS_BUFFER) {
           /* Write through the FSAL.  We need a write lock only
-             if we need to open or close a file descriptor. */
+             if we need to open or close the cached file descriptor.
+             If it is open in another mode, a descriptor in the mode
+             of this I/O is taken beside it. */
           pthread_rwlock_rdlock(&entry->content_lock);
           content_locked = TRUE;
-          loflags = entry->object.file.open_fd.openflags;
-          if ((!cache_inode_fd(entry)) ||
-              (loflags && loflags != FSAL_O_RDWR && loflags != openflags)) {
+          if (!cache_inode_fd(entry)) {
                pthread_rwlock_unlock(&entry->content_lock);
                pthread_rwlock_wrlock(&entry->content_lock);
-               loflags = entry->object.file.open_fd.openflags;
-               if ((!cache_inode_fd(entry)) ||
-                   (loflags && loflags != FSAL_O_RDWR &&
-                    loflags != openflags)) {
+               if (!cache_inode_fd(entry)) {
                     if (cache_inode_open(entry,
                                          openflags,
                                          context,
@@ -205,36 +327,66 @@ cache_inode_rdwr(cache_entry_t *entry,
                }
           }
 
-          /* Call FSAL_read or FSAL_write */
+          if (cache_inode_io_fd_get(entry, openflags, context, &fd,
+                                    status) != CACHE_INODE_SUCCESS) {
+               goto out;
+          }
+          if (fd == &entry->object.file.open_fd.fd) {
+               loflags = entry->object.file.open_fd.openflags;
+          } else {
+               loflags = openflags;
+          }
+
+          /* Call FSAL_read, FSAL_read_splice or FSAL_write */
           if (io_direction == CACHE_INODE_READ) {
                fsal_status
-                    = FSAL_read(&(entry->object.file.open_fd.fd),
+                    = FSAL_read(fd,
                                 &seek_descriptor,
                                 io_size,
                                 buffer,
                                 bytes_moved,
                                 eof);
+          } else if (io_direction == CACHE_INODE_READ_PIPE) {
+               fsal_status
+                    = FSAL_read_splice(fd,
+                                       &seek_descriptor,
+                                       io_size,
+                                       (int *) buffer,
+                                       bytes_moved,
+                                       eof);
           } else {
                fsal_status
-                    = FSAL_write(&(entry->object.file.open_fd.fd),
+                    = FSAL_write(fd,
                                  context,
                                  &seek_descriptor,
                                  io_size,
                                  buffer,
                                  bytes_moved);
 
+               /* Number the write for cache_inode_group_commit */
+               if (!FSAL_IS_ERROR(fsal_status)) {
+                    atomic_inc_uint64_t(&entry->object.file.write_seq);
+               }
+
                /* Alright, the unstable write is complete. Now if it was
                   supposed to be a stable write we can sync to the hard
-                  drive. */
+                  drive, along with the other writes of the file. */
 
-               if (stable == CACHE_INODE_SAFE_WRITE_TO_FS &&
-                   !(entry->object.file.open_fd.openflags & FSAL_O_SYNC)) {
-                    fsal_status
-                         = FSAL_commit(&(entry->object.file.open_fd.fd),
-                                  offset, io_size);
+               if (!FSAL_IS_ERROR(fsal_status) &&
+                   stable == CACHE_INODE_SAFE_WRITE_TO_FS &&
+                   !(loflags & FSAL_O_SYNC)) {
+                    fsal_status = cache_inode_group_commit(entry, fd);
                }
           }
 
+          if ((io_direction != CACHE_INODE_WRITE) && (readahead != 0) &&
+              !FSAL_IS_ERROR(fsal_status)) {
+               cache_inode_readahead(entry, fd, offset, *bytes_moved,
+                                     (eof != NULL) && *eof, readahead);
+          }
+
+          cache_inode_io_fd_put(entry, fd);
+
           LogFullDebug(COMPONENT_FSAL,
                        "cache_inode_rdwr: FSAL IO operation returned "
                        "%d, asked_size=%zu, effective_size=%zu",
@@ -260,6 +412,7 @@ cache_inode_rdwr(cache_entry_t *entry,
                }
 
                if ((fsal_status.major != ERR_FSAL_NOT_OPENED)
+                   && (fsal_status.major != ERR_FSAL_NOTSUPP)
                    && (entry->object.file.open_fd.openflags
                        != FSAL_O_CLOSED)) {
                     cache_inode_status_t cstatus;
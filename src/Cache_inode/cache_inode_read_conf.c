@@ -48,6 +48,7 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "config_parsing.h"
+#include "nfs_core.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -134,6 +135,10 @@ cache_inode_read_conf_hash_parameter(config_file_t config,
         {
           param->hparam.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&param->hparam, key_value);
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -279,6 +284,34 @@ cache_inode_read_conf_parameter(config_file_t config,
           if(err != CACHE_INODE_SUCCESS)
             return err;
         }
+      else if(!strcasecmp(key_name, "Negative_Expiration_Time"))
+        {
+          param->grace_period_negative = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Negative_Cache_Size"))
+        {
+          param->negative_cache_size = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Attr_Refresh_Ahead"))
+        {
+          param->attr_refresh_ahead = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Attr_Stale_Bound"))
+        {
+          param->attr_stale_bound = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Attr_Refresh_Threads"))
+        {
+          param->attr_refresh_threads = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Attr_Refresh_Batch"))
+        {
+          param->attr_refresh_batch = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Attr_Refresh_Queue_Size"))
+        {
+          param->attr_refresh_queue_size = atoi(key_value);
+        }
       else if(!strcasecmp(key_name, "Use_Getattr_Directory_Invalidation"))
         {
           param->getattr_dir_invalidation = StrToBoolean(key_value);
@@ -487,6 +520,20 @@ void cache_inode_print_conf_parameter(FILE *output,
           param->grace_period_link);
   fprintf(output, "CacheInode: Directory_Expiration_Time    = %jd\n",
           param->grace_period_dirent);
+  fprintf(output, "CacheInode: Negative_Expiration_Time     = %jd\n",
+          param->grace_period_negative);
+  fprintf(output, "CacheInode: Negative_Cache_Size          = %u\n",
+          param->negative_cache_size);
+  fprintf(output, "CacheInode: Attr_Refresh_Ahead           = %jd\n",
+          param->attr_refresh_ahead);
+  fprintf(output, "CacheInode: Attr_Stale_Bound             = %jd\n",
+          param->attr_stale_bound);
+  fprintf(output, "CacheInode: Attr_Refresh_Threads         = %u\n",
+          param->attr_refresh_threads);
+  fprintf(output, "CacheInode: Attr_Refresh_Batch           = %u\n",
+          param->attr_refresh_batch);
+  fprintf(output, "CacheInode: Attr_Refresh_Queue_Size      = %u\n",
+          param->attr_refresh_queue_size);
   fprintf(output, "CacheInode: Use_Test_Access              = %s\n",
           (param->use_test_access ? "TRUE" : "FALSE"));
 } /* cache_inode_print_conf_parameter */
@@ -50,8 +50,10 @@
 #include "fsal.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
-#include "cache_inode_avl.h"
+#include "cache_inode_dirtree.h"
 #include "cache_inode_weakref.h"
+#include "cache_inode_negative.h"
+#include "cache_inode_refresh.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -86,7 +88,8 @@ cache_inode_invalidate_all_cached_dirent(cache_entry_t *entry,
      }
 
      /* Get ride of entries cached in the DIRECTORY */
-     cache_inode_release_dirents(entry, CACHE_INODE_AVL_BOTH);
+     cache_inode_release_dirents(entry);
+     cache_inode_negative_flush(entry);
 
      /* Mark directory as not populated */
      atomic_clear_uint32_t_bits(&entry->flags, (CACHE_INODE_DIR_POPULATED |
@@ -128,7 +131,7 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
                                   fsal_name_t *newname,
                                   cache_inode_dirent_op_t dirent_op)
 {
-     cache_inode_dir_entry_t dirent_key[1], *dirent, *dirent2, *dirent3;
+     cache_inode_dir_entry_t *dirent, *dirent2, *dirent3;
      cache_inode_status_t status = CACHE_INODE_SUCCESS;
      int code = 0;
 
@@ -150,9 +153,8 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
        goto out;
      }
 
-     FSAL_namecpy(&dirent_key->name, name);
-     dirent = cache_inode_avl_qp_lookup_s(directory, dirent_key, 1);
-     if ((!dirent) || (dirent->flags & DIR_ENTRY_FLAG_DELETED)) {
+     dirent = cache_inode_dirtree_lookup_name(directory, name);
+     if (!dirent) {
        if (!((directory->flags & CACHE_INODE_TRUST_CONTENT) &&
              (directory->flags & CACHE_INODE_DIR_POPULATED))) {
          /* We cannot serve negative lookups. */
@@ -172,14 +174,12 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
      switch (dirent_op) {
      case CACHE_INODE_DIRENT_OP_REMOVE:
          /* mark deleted */
-         avl_dirent_set_deleted(directory, dirent);
+         cache_inode_dirtree_set_deleted(directory, dirent);
          directory->object.dir.nbactive--;
          break;
 
      case CACHE_INODE_DIRENT_OP_RENAME:
-         FSAL_namecpy(&dirent_key->name, newname);
-         dirent2 = cache_inode_avl_qp_lookup_s(directory,
-                                               dirent_key, 1);
+         dirent2 = cache_inode_dirtree_lookup_name(directory, newname);
          if (dirent2) {
              /* rename would cause a collision */
              if (directory->flags &
@@ -190,13 +190,19 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
                  status = CACHE_INODE_ENTRY_EXISTS;
              }
          } else {
-             /* try to rename--no longer in-place */
-             avl_dirent_set_deleted(directory, dirent);
+             /* try to rename--no longer in-place.  The new name
+              * goes in first, so that a failure leaves the old one
+              * as it was. */
              dirent3 = pool_alloc(cache_inode_dir_entry_pool, NULL);
+             if (dirent3 == NULL) {
+                 status = CACHE_INODE_MALLOC_ERROR;
+                 break;
+             }
              FSAL_namecpy(&dirent3->name, newname);
              dirent3->flags = DIR_ENTRY_FLAG_NONE;
              dirent3->entry = dirent->entry;
-             code = cache_inode_avl_qp_insert(directory, dirent3);
+             code = cache_inode_dirtree_insert(directory, dirent3,
+                                               &dirent2);
              switch (code) {
              case 0:
                  /* CACHE_INODE_SUCCESS */
@@ -207,14 +213,9 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
                   pool_free(cache_inode_dir_entry_pool, dirent3);
                  /* CACHE_INODE_SUCCESS */
                  break;
-             case -1:
-                 /* collision, tree state unchanged (unlikely) */
-                 status = CACHE_INODE_ENTRY_EXISTS;
-                 /* dirent is on persist tree, undelete it */
-                 avl_dirent_clear_deleted(directory, dirent);
+             default:
                  /* dirent3 was never inserted */
                  pool_free(cache_inode_dir_entry_pool, dirent3);
-             default:
                  LogCrit(COMPONENT_NFS_READDIR,
                          "DIRECTORY: insert error renaming dirent "
                          "(%s, %s)",
@@ -222,6 +223,8 @@ cache_inode_operate_cached_dirent(cache_entry_t *directory,
                  status = CACHE_INODE_INSERT_ERROR;
                  break;
              }
+             if (status == CACHE_INODE_SUCCESS)
+                 cache_inode_dirtree_set_deleted(directory, dirent);
          } /* !found */
          break;
 
@@ -264,6 +267,7 @@ cache_inode_add_cached_dirent(cache_entry_t *parent,
                               cache_inode_status_t *status)
 {
      cache_inode_dir_entry_t *new_dir_entry = NULL;
+     cache_inode_dir_entry_t *dirent = NULL;
      int code = 0;
 
      *status = CACHE_INODE_SUCCESS;
@@ -274,7 +278,7 @@ cache_inode_add_cached_dirent(cache_entry_t *parent,
           return *status;
      }
 
-     /* in cache inode avl, we always insert on pentry_parent */
+     /* in the dirent tree, we always insert on pentry_parent */
      new_dir_entry = pool_alloc(cache_inode_dir_entry_pool, NULL);
      if(new_dir_entry == NULL) {
           *status = CACHE_INODE_MALLOC_ERROR;
@@ -286,8 +290,8 @@ cache_inode_add_cached_dirent(cache_entry_t *parent,
      FSAL_namecpy(&new_dir_entry->name, name);
      new_dir_entry->entry = entry->weakref;
 
-     /* add to avl */
-     code = cache_inode_avl_qp_insert(parent, new_dir_entry);
+     /* add to the tree */
+     code = cache_inode_dirtree_insert(parent, new_dir_entry, &dirent);
      switch (code) {
      case 0:
          /* CACHE_INODE_SUCCESS */
@@ -308,7 +312,7 @@ cache_inode_add_cached_dirent(cache_entry_t *parent,
      }
 
      if (dir_entry) {
-         *dir_entry = new_dir_entry;
+         *dir_entry = dirent;
      }
 
      /* we're going to succeed */
@@ -502,6 +506,7 @@ cache_inode_readdir_populate(cache_entry_t *directory,
           new_entry_fsdata.fh_desc.start
             = (caddr_t)(&array_dirent[iter].handle);
           new_entry_fsdata.fh_desc.len = 0;
+          new_entry_fsdata.hash = 0;
           FSAL_ExpandHandle(context->export_context,
                             FSAL_DIGEST_SIZEOF,
                             &new_entry_fsdata.fh_desc);
@@ -609,8 +614,8 @@ cache_inode_readdir(cache_entry_t *directory,
 {
      /* The entry being examined */
      cache_inode_dir_entry_t *dirent = NULL;
-     /* The node in the tree being traversed */
-     struct avltree_node *dirent_node;
+     /* The position in the tree being traversed */
+     cache_inode_dir_cursor_t cursor;
      /* The access mask corresponding to permission to list directory
         entries */
      const fsal_accessflags_t access_mask
@@ -666,19 +671,20 @@ cache_inode_readdir(cache_entry_t *directory,
       * 2. cookie is 0 (first cookie) -- ok
       * 3. cookie is > than highest dirent position (error)
       * 4. cookie <= highest dirent position but > highest cached cookie
-      *    (currently equivalent to #2, because we pre-populate the cookie avl)
+      *    (currently equivalent to #2, because we pre-populate the cookie tree)
       * 5. cookie is in cached range -- ok */
 
      if (cookie > 0) {
-          /* N.B., cache_inode_avl_qp_insert_s ensures k > 2 */
+          /* N.B., cache_inode_dirtree_insert ensures k > 2 */
           if (cookie < 3) {
                *status = CACHE_INODE_BAD_COOKIE;
                goto unlock_dir;
           }
 
           /* we assert this can now succeed */
-          dirent = cache_inode_avl_lookup_k(directory, cookie,
-                                            CACHE_INODE_FLAG_NEXT_ACTIVE);
+          dirent = cache_inode_dirtree_seek(directory, cookie,
+                                            CACHE_INODE_FLAG_NEXT_ACTIVE,
+                                            &cursor);
           if (!dirent) {
                LogFullDebug(COMPONENT_NFS_READDIR,
                             "%s: seek to cookie=%"PRIu64" fail",
@@ -689,11 +695,10 @@ cache_inode_readdir(cache_entry_t *directory,
 
           /* dirent is the NEXT entry to return, since we sent
            * CACHE_INODE_FLAG_NEXT_ACTIVE */
-          dirent_node = &dirent->node_hk;
 
      } else {
           /* initial readdir */
-         dirent_node = avltree_first(&directory->object.dir.avl.t);
+          dirent = cache_inode_dirtree_first(directory, &cursor);
      }
 
      LogFullDebug(COMPONENT_NFS_READDIR,
@@ -701,21 +706,17 @@ cache_inode_readdir(cache_entry_t *directory,
                   "cookie=%"PRIu64" collisions %d",
                   directory,
                   cookie,
-                  directory->object.dir.avl.collisions);
+                  directory->object.dir.tree->collisions);
 
      /* Now satisfy the request from the cached readdir--stop when either
       * the requested sequence or dirent sequence is exhausted */
      *nbfound = 0;
      *eod_met = FALSE;
 
-     while (in_result && dirent_node) {
+     while (in_result && dirent) {
           cache_entry_t *entry = NULL;
           cache_inode_status_t lookup_status = 0;
 
-          dirent = avltree_container_of(dirent_node,
-                                        cache_inode_dir_entry_t,
-                                        node_hk);
-
           if ((entry
                = cache_inode_weakref_get(&dirent->entry,
                                          LRU_REQ_SCAN))
@@ -733,6 +734,8 @@ cache_inode_readdir(cache_entry_t *directory,
                             going. */
                          atomic_clear_uint32_t_bits(&directory->flags,
                                                     CACHE_INODE_TRUST_CONTENT);
+                         dirent = cache_inode_dirtree_next(directory,
+                                                           &cursor);
                          continue;
                     } else {
                          /* Something is more seriously wrong,
@@ -756,6 +759,12 @@ cache_inode_readdir(cache_entry_t *directory,
               goto unlock_dir;
             }
 
+          /* The client is likely to ask for these attributes next:
+             have them refreshed in the background if they are about
+             to expire, rather than one by one as it asks.  The
+             attribute lock taken above is still held. */
+          cache_inode_refresh_hint(entry, context);
+
           in_result = cb(cb_opaque,
                          dirent->name.name,
                          &entry->handle,
@@ -767,13 +776,13 @@ cache_inode_readdir(cache_entry_t *directory,
           if (!in_result) {
                break;
           }
-          dirent_node = avltree_next(dirent_node);
+          dirent = cache_inode_dirtree_next(directory, &cursor);
      }
 
      /* We have reached the last node and every node traversed was
         added to the result */;
 
-     if (!dirent_node && in_result) {
+     if (!dirent && in_result) {
           *eod_met = TRUE;
      } else {
           *eod_met = FALSE;
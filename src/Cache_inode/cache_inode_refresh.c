@@ -0,0 +1,371 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_refresh.c
+ * @brief  Background refresh of cached attributes
+ *
+ * The queue is a single list under a mutex: queuing is rare next to
+ * the lookups that decide on it, since an entry is queued once per
+ * expiration at most.  Each thread takes a batch of entries under one
+ * hold of the mutex and refreshes them in turn, without it.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <pthread.h>
+#include "log.h"
+#include "nlm_list.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "nfs_core.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+#include "cache_inode_refresh.h"
+
+struct refresh_req
+{
+  struct glist_head q; /*< Link in the queue */
+  cache_entry_t *entry; /*< The entry, with a reference */
+  fsal_op_context_t context; /*< Credentials of the request that
+                                 queued it */
+};
+
+static pthread_mutex_t refresh_mtx = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t refresh_cv = PTHREAD_COND_INITIALIZER;
+static struct glist_head refresh_q = { &refresh_q, &refresh_q };
+static uint32_t refresh_count; /*< Length of refresh_q */
+static bool_t refresh_shutdown;
+
+static pthread_t *refresh_threads;
+static uint32_t refresh_nthreads;
+
+/* Entries queued, refused because the queue was full, successfully
+   refreshed, the batches they were taken in, and uses of expired
+   attributes while queued */
+static uint64_t refresh_queued;
+static uint64_t refresh_refused;
+static uint64_t refresh_refreshed;
+static uint64_t refresh_batches;
+static uint64_t refresh_stale_served;
+
+/* Drop a request, letting the entry be queued again */
+
+static void
+refresh_req_free(struct refresh_req *req)
+{
+  atomic_clear_uint32_t_bits(&req->entry->flags, CACHE_INODE_REFRESH_QUEUED);
+  cache_inode_lru_unref(req->entry, LRU_FLAG_NONE);
+  gsh_free(req);
+}
+
+static void
+refresh_one(struct refresh_req *req)
+{
+  time_t grace = cache_inode_params.grace_period_attr;
+  time_t ahead = cache_inode_params.attr_refresh_ahead;
+  cache_inode_status_t status;
+
+  /* Anything queued is at least this old, unless refreshed since */
+  status = cache_inode_revalidate(req->entry, &req->context,
+                                  grace > ahead ? grace - ahead : 0);
+  if(status == CACHE_INODE_SUCCESS)
+    atomic_inc_uint64_t(&refresh_refreshed);
+  else
+    LogDebug(COMPONENT_CACHE_INODE,
+             "Background refresh of entry %p failed: %s",
+             req->entry, cache_inode_err_str(status));
+
+  refresh_req_free(req);
+}
+
+static void *
+refresh_thread(void *arg __attribute__((unused)))
+{
+  struct glist_head batch;
+  struct glist_head *glist, *glistn;
+  struct refresh_req *req;
+  uint32_t n;
+
+  SetNameFunction("refresh_thread");
+
+  while(1)
+    {
+      pthread_mutex_lock(&refresh_mtx);
+      while(glist_empty(&refresh_q) && !refresh_shutdown)
+        pthread_cond_wait(&refresh_cv, &refresh_mtx);
+      if(refresh_shutdown)
+        {
+          pthread_mutex_unlock(&refresh_mtx);
+          break;
+        }
+
+      init_glist(&batch);
+      for(n = 0;
+          n < cache_inode_params.attr_refresh_batch &&
+            !glist_empty(&refresh_q);
+          n++)
+        {
+          req = glist_first_entry(&refresh_q, struct refresh_req, q);
+          glist_del(&req->q);
+          glist_add_tail(&batch, &req->q);
+        }
+      refresh_count -= n;
+      pthread_mutex_unlock(&refresh_mtx);
+
+      atomic_inc_uint64_t(&refresh_batches);
+
+      glist_for_each_safe(glist, glistn, &batch)
+        {
+          req = glist_entry(glist, struct refresh_req, q);
+          glist_del(&req->q);
+          refresh_one(req);
+        }
+    }
+
+  return NULL;
+}
+
+/**
+ * @brief Start the refresh threads
+ *
+ * No thread is started if neither Attr_Refresh_Ahead nor
+ * Attr_Stale_Bound is set, nor if attributes do not expire: nothing
+ * is ever queued then.
+ */
+
+void
+cache_inode_refresh_pkginit(void)
+{
+  pthread_attr_t attr_thr;
+  uint32_t i;
+  int code;
+
+  if(cache_inode_params.expire_type_attr != CACHE_INODE_EXPIRE ||
+     (cache_inode_params.attr_refresh_ahead == 0 &&
+      cache_inode_params.attr_stale_bound == 0) ||
+     cache_inode_params.attr_refresh_threads == 0)
+    return;
+
+  if(cache_inode_params.attr_refresh_batch == 0)
+    cache_inode_params.attr_refresh_batch = 1;
+
+  refresh_threads = gsh_calloc(cache_inode_params.attr_refresh_threads,
+                               sizeof(pthread_t));
+  if(refresh_threads == NULL)
+    {
+      LogCrit(COMPONENT_CACHE_INODE,
+              "Unable to allocate the attribute refresh threads, "
+              "attributes will be refreshed on expiry only");
+      return;
+    }
+
+  if(pthread_attr_init(&attr_thr) != 0)
+    LogCrit(COMPONENT_CACHE_INODE, "can't init pthread's attributes");
+
+  if(pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM) != 0)
+    LogCrit(COMPONENT_CACHE_INODE, "can't set pthread's scope");
+
+  if(pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_JOINABLE) != 0)
+    LogCrit(COMPONENT_CACHE_INODE, "can't set pthread's join state");
+
+  if(pthread_attr_setstacksize(&attr_thr, THREAD_STACK_SIZE) != 0)
+    LogCrit(COMPONENT_CACHE_INODE, "can't set pthread's stack size");
+
+  for(i = 0; i < cache_inode_params.attr_refresh_threads; i++)
+    {
+      code = pthread_create(&refresh_threads[i], &attr_thr,
+                            refresh_thread, NULL);
+      if(code != 0)
+        {
+          LogCrit(COMPONENT_CACHE_INODE,
+                  "Unable to start attribute refresh thread %u, "
+                  "error code %d", i, code);
+          break;
+        }
+    }
+  refresh_nthreads = i;
+
+  LogInfo(COMPONENT_CACHE_INODE,
+          "%u attribute refresh threads started, refresh ahead %jd s, "
+          "stale bound %jd s", refresh_nthreads,
+          (intmax_t) cache_inode_params.attr_refresh_ahead,
+          (intmax_t) cache_inode_params.attr_stale_bound);
+}
+
+/**
+ * @brief Stop the refresh threads and empty the queue
+ */
+
+void
+cache_inode_refresh_pkgshutdown(void)
+{
+  struct refresh_req *req;
+  uint32_t i;
+
+  pthread_mutex_lock(&refresh_mtx);
+  refresh_shutdown = TRUE;
+  pthread_cond_broadcast(&refresh_cv);
+  pthread_mutex_unlock(&refresh_mtx);
+
+  for(i = 0; i < refresh_nthreads; i++)
+    pthread_join(refresh_threads[i], NULL);
+  refresh_nthreads = 0;
+  gsh_free(refresh_threads);
+  refresh_threads = NULL;
+
+  while((req = glist_first_entry(&refresh_q, struct refresh_req, q)) != NULL)
+    {
+      glist_del(&req->q);
+      refresh_req_free(req);
+    }
+  refresh_count = 0;
+}
+
+/**
+ * @brief Queue an entry for a background refresh
+ *
+ * The caller holds a reference on the entry, and may hold its
+ * attribute lock.
+ *
+ * @param[in] entry   The entry
+ * @param[in] context FSAL credentials for the refresh
+ *
+ * @return TRUE if the entry is queued (by this call or an earlier
+ *         one), FALSE if it is to be refreshed by the caller.
+ */
+
+bool_t
+cache_inode_refresh_queue(cache_entry_t *entry,
+                          fsal_op_context_t *context)
+{
+  struct refresh_req *req;
+
+  if(refresh_nthreads == 0)
+    return FALSE;
+
+  /* Only the caller that sets the bit queues the entry */
+  if(__sync_fetch_and_or(&entry->flags, CACHE_INODE_REFRESH_QUEUED) &
+     CACHE_INODE_REFRESH_QUEUED)
+    return TRUE;
+
+  if(cache_inode_lru_ref(entry, LRU_FLAG_NONE) != CACHE_INODE_SUCCESS)
+    {
+      atomic_clear_uint32_t_bits(&entry->flags, CACHE_INODE_REFRESH_QUEUED);
+      return FALSE;
+    }
+
+  req = gsh_malloc(sizeof(struct refresh_req));
+  if(req == NULL)
+    goto refuse;
+  req->entry = entry;
+  req->context = *context;
+
+  pthread_mutex_lock(&refresh_mtx);
+  if(refresh_count >= cache_inode_params.attr_refresh_queue_size ||
+     refresh_shutdown)
+    {
+      pthread_mutex_unlock(&refresh_mtx);
+      gsh_free(req);
+      goto refuse;
+    }
+  glist_add_tail(&refresh_q, &req->q);
+  refresh_count++;
+  pthread_cond_signal(&refresh_cv);
+  pthread_mutex_unlock(&refresh_mtx);
+
+  atomic_inc_uint64_t(&refresh_queued);
+  return TRUE;
+
+refuse:
+  atomic_inc_uint64_t(&refresh_refused);
+  atomic_clear_uint32_t_bits(&entry->flags, CACHE_INODE_REFRESH_QUEUED);
+  cache_inode_lru_unref(entry, LRU_FLAG_NONE);
+  return FALSE;
+}
+
+/**
+ * @brief Queue an entry whose attributes are close to expiry
+ *
+ * The caller holds a reference on the entry and its attribute lock,
+ * and found the attributes trustworthy.  Nothing is done unless they
+ * expire within Attr_Refresh_Ahead.  attr_time is read once, so a
+ * caller without the lock at worst queues a refresh for nothing.
+ *
+ * @param[in] entry   The entry
+ * @param[in] context FSAL credentials for the refresh
+ */
+
+void
+cache_inode_refresh_hint(cache_entry_t *entry,
+                         fsal_op_context_t *context)
+{
+  time_t grace = cache_inode_params.grace_period_attr;
+  time_t attr_time;
+
+  if(cache_inode_params.attr_refresh_ahead == 0 ||
+     cache_inode_params.expire_type_attr != CACHE_INODE_EXPIRE ||
+     (entry->flags & CACHE_INODE_REFRESH_QUEUED))
+    return;
+
+  attr_time = *(volatile time_t *) &entry->attr_time;
+  if(time(NULL) - attr_time + cache_inode_params.attr_refresh_ahead
+     >= grace)
+    (void) cache_inode_refresh_queue(entry, context);
+}
+
+/**
+ * @brief Count a use of expired attributes pending their refresh
+ */
+
+void
+cache_inode_refresh_note_stale(void)
+{
+  atomic_inc_uint64_t(&refresh_stale_served);
+}
+
+/**
+ * @brief Get the counts of the background refresh
+ *
+ * @param[out] queued       Entries queued
+ * @param[out] refused      Entries not queued, the queue being full
+ * @param[out] refreshed    Entries successfully refreshed in the background
+ * @param[out] batches      Batches they were refreshed in
+ * @param[out] stale_served Uses of expired attributes while queued
+ */
+
+void
+cache_inode_refresh_get_stats(uint64_t *queued,
+                              uint64_t *refused,
+                              uint64_t *refreshed,
+                              uint64_t *batches,
+                              uint64_t *stale_served)
+{
+  *queued = atomic_fetch_uint64_t(&refresh_queued);
+  *refused = atomic_fetch_uint64_t(&refresh_refused);
+  *refreshed = atomic_fetch_uint64_t(&refresh_refreshed);
+  *batches = atomic_fetch_uint64_t(&refresh_batches);
+  *stale_served = atomic_fetch_uint64_t(&refresh_stale_served);
+}
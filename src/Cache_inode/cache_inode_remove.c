@@ -25,6 +25,7 @@
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
 #include "cache_inode_weakref.h"
+#include "cache_inode_negative.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -108,11 +109,11 @@ cache_inode_clean_internal(cache_entry_t *entry)
      hash_buffer_t key, val;
      hash_error_t rc = 0;
 
-     if (entry->fh_desc.start == 0)
+     if (entry->fsdata.fh_desc.start == 0)
          return CACHE_INODE_SUCCESS;
 
-     key.pdata = entry->fh_desc.start;
-     key.len = entry->fh_desc.len;
+     key.pdata = &entry->fsdata;
+     key.len = sizeof(entry->fsdata);
 
 
      val.pdata = entry;
@@ -139,6 +140,15 @@ cache_inode_clean_internal(cache_entry_t *entry)
           pthread_rwlock_wrlock(&entry->content_lock);
           cache_inode_release_symlink(entry);
           pthread_rwlock_unlock(&entry->content_lock);
+     } else if (entry->type == DIRECTORY) {
+          pthread_rwlock_wrlock(&entry->content_lock);
+          cache_inode_negative_release(entry);
+          cache_inode_release_dir_tree(entry);
+          pthread_rwlock_unlock(&entry->content_lock);
+     } else if (entry->type == REGULAR_FILE) {
+          pthread_rwlock_wrlock(&entry->content_lock);
+          cache_inode_release_file_cold(entry);
+          pthread_rwlock_unlock(&entry->content_lock);
      }
 
      return CACHE_INODE_SUCCESS;
@@ -47,6 +47,7 @@
 #include "HashTable.h"
 #include "fsal.h"
 #include "cache_inode.h"
+#include "cache_inode_negative.h"
 
 #include <unistd.h>
 #include <sys/types.h>
@@ -378,6 +379,8 @@ cache_inode_status_t cache_inode_rename(cache_entry_t *dir_src,
       goto out;
     }
 
+  cache_inode_negative_remove(dir_dest, newname);
+
   /* Manage the returned attributes */
   if(attr_src != NULL)
     *attr_src = dir_src->attributes;
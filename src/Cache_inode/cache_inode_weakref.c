@@ -74,7 +74,7 @@ static gweakref_table_t *cache_inode_wt = NULL;
  */
 void cache_inode_weakref_init()
 {
-    cache_inode_wt = gweakref_init(17, 32767 /* unlike in ht, desire prime */);
+    cache_inode_wt = gweakref_init(WEAKREF_PARTITIONS);
 }
 
 /**
@@ -98,9 +98,9 @@ gweakref_t cache_inode_weakref_insert(cache_entry_t *entry)
  * @brief Get a reference from the weakref
  *
  * Attempt to get a reference on a weakref.  In order to prevent a
- * race condition, the function retains the read lock on the table
- * (blocking any delete) and acquires the mutex on the lru entry
- * before releasing it.  If the entry has type RECYCLED or
+ * race condition, the function keeps the slot of the entry held
+ * (blocking any delete, hence the recycling of the entry) until it
+ * has taken its reference.  If the entry has type RECYCLED or
  * cache_inode_lru_ref fails (which it will if the refcount has
  * dropped to 0) it will act as if the entry has not existed.
  *
@@ -117,17 +117,16 @@ gweakref_t cache_inode_weakref_insert(cache_entry_t *entry)
 cache_entry_t *cache_inode_weakref_get(gweakref_t *ref,
                                        uint32_t flags)
 {
-    pthread_rwlock_t *lock = NULL;
     cache_entry_t *entry =
-        (cache_entry_t *) gweakref_lookupex(cache_inode_wt, ref, &lock);
+        (cache_entry_t *) gweakref_lookupex(cache_inode_wt, ref);
 
     if (entry) {
         if (cache_inode_lru_ref(entry, flags)
             != CACHE_INODE_SUCCESS) {
-            pthread_rwlock_unlock(lock);
+            gweakref_release(cache_inode_wt, ref);
             return NULL;
         }
-        pthread_rwlock_unlock(lock);
+        gweakref_release(cache_inode_wt, ref);
     }
 
     return (entry);
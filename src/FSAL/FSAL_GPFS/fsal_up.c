@@ -76,6 +76,7 @@ fsal_status_t GPFSFSAL_UP_GetEvents( struct glist_head * pevent_head,
     }
 
   pfsal_data.fh_desc.start = (caddr_t)tmp_handlep;
+  pfsal_data.hash = 0;
   pfsal_data.fh_desc.len = sizeof(*tmp_handlep);
   phandle = (gpfsfsal_handle_t *) pfsal_data.fh_desc.start;
 
@@ -137,6 +138,7 @@ fsal_status_t GPFSFSAL_UP_GetEvents( struct glist_head * pevent_head,
 
   event_fsal_data = &pevent->event_data.event_context.fsal_data;
   event_fsal_data->fh_desc.start = (caddr_t)tmp_handlep;
+  event_fsal_data->hash = 0;
   event_fsal_data->fh_desc.len = sizeof(*tmp_handlep);
   GPFSFSAL_ExpandHandle(NULL, FSAL_DIGEST_SIZEOF, &(event_fsal_data->fh_desc));
   switch (reason)
@@ -0,0 +1,368 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_attrs.c
+ * \brief   Attributes functions.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "FSAL/access_check.h"
+
+/**
+ * mem_getattrs_locked:
+ * Optionally fills the attributes of an inode the caller holds
+ * locked.  On error, the special bit FSAL_ATTR_RDATTR_ERR is set in
+ * the mask, as every FSAL call returning post operation attributes
+ * does.
+ */
+fsal_status_t mem_getattrs_locked(struct mem_inode *inode,
+                                  fsal_attrib_list_t * p_object_attributes)
+{
+  fsal_status_t status;
+
+  if(!p_object_attributes)
+    ReturnCode(ERR_FSAL_NO_ERROR, 0);
+
+  status = mem2fsal_attributes(inode, p_object_attributes);
+  if(FSAL_IS_ERROR(status))
+    {
+      FSAL_CLEAR_MASK(p_object_attributes->asked_attributes);
+      FSAL_SET_MASK(p_object_attributes->asked_attributes, FSAL_ATTR_RDATTR_ERR);
+    }
+
+  return status;
+}
+
+/**
+ * FSAL_getattrs:
+ * Get attributes for the object specified by its filehandle.
+ *
+ * \param filehandle (input):
+ *        The handle of the object to get parameters.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param object_attributes (mandatory input/output):
+ *        The retrieved attributes for the object.
+ *        As input, it defines the attributes that the caller
+ *        wants to retrieve (by positioning flags into this structure)
+ *        and the output is built considering this input
+ *        (it fills the structure according to the flags it contains).
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occured.
+ */
+fsal_status_t MEMFSAL_getattrs(fsal_handle_t * p_filehandle,       /* IN */
+                               fsal_op_context_t * p_context,      /* IN */
+                               fsal_attrib_list_t * p_object_attributes /* IN/OUT */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity checks.
+   * note : object_attributes is mandatory in FSAL_getattrs.
+   */
+  if(!p_filehandle || !p_context || !p_object_attributes)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_getattrs);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_filehandle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_getattrs);
+
+  pthread_rwlock_rdlock(&inode->lock);
+  status = mem_getattrs_locked(inode, p_object_attributes);
+  pthread_rwlock_unlock(&inode->lock);
+
+  mem_inode_put(inode);
+
+  ReturnStatus(status, INDEX_FSAL_getattrs);
+}
+
+/**
+ * FSAL_getattrs_descriptor:
+ * Get attributes for the object specified by its descriptor or by it's filehandle.
+ *
+ * \param p_file_descriptor (input):
+ *        The file descriptor of the object to get parameters.
+ * \param p_filehandle (input):
+ *        The handle of the object to get parameters.
+ * \param p_context (input):
+ *        Authentication context for the operation (user,...).
+ * \param p_object_attributes (mandatory input/output):
+ *        The retrieved attributes for the object.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occured.
+ */
+fsal_status_t MEMFSAL_getattrs_descriptor(fsal_file_t * p_file_descriptor,     /* IN */
+                                          fsal_handle_t * p_filehandle,        /* IN */
+                                          fsal_op_context_t * p_context,       /* IN */
+                                          fsal_attrib_list_t * p_object_attributes /* IN/OUT */
+    )
+{
+  memfsal_file_t *p_file = (memfsal_file_t *) p_file_descriptor;
+  fsal_status_t status;
+
+  if(!p_file_descriptor || !p_context || !p_object_attributes)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_getattrs);
+
+  if(p_file->inode == NULL)
+    return MEMFSAL_getattrs(p_filehandle, p_context, p_object_attributes);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  pthread_rwlock_rdlock(&p_file->inode->lock);
+  status = mem_getattrs_locked(p_file->inode, p_object_attributes);
+  pthread_rwlock_unlock(&p_file->inode->lock);
+
+  ReturnStatus(status, INDEX_FSAL_getattrs);
+}
+
+/**
+ * FSAL_setattrs:
+ * Set attributes for the object specified by its filehandle.
+ *
+ * \param filehandle (input):
+ *        The handle of the object to get parameters.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param attrib_set (mandatory input):
+ *        The attributes to be set for the object.
+ *        It defines the attributes that the caller
+ *        wants to set and their values.
+ * \param object_attributes (optionnal input/output):
+ *        The post operation attributes for the object.
+ *        As input, it defines the attributes that the caller
+ *        wants to retrieve (by positioning flags into this structure)
+ *        and the output is built considering this input
+ *        (it fills the structure according to the flags it contains).
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occured.
+ *
+ * The size is not set here: cache_inode calls FSAL_truncate for it.
+ */
+fsal_status_t MEMFSAL_setattrs(fsal_handle_t * p_filehandle,       /* IN */
+                               fsal_op_context_t * p_context,      /* IN */
+                               fsal_attrib_list_t * p_attrib_set,  /* IN */
+                               fsal_attrib_list_t * p_object_attributes    /* [ IN/OUT ] */
+    )
+{
+  memfsal_op_context_t *mem_context = (memfsal_op_context_t *) p_context;
+  fsal_attrib_list_t attrs;
+  fsal_status_t status;
+  struct mem_inode *inode;
+  struct stat *p_buffstat;
+  int changed = FALSE;
+  int i;
+
+  /* sanity checks.
+   * note : object_attributes is optional.
+   */
+  if(!p_filehandle || !p_context || !p_attrib_set)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_setattrs);
+
+  /* local copy of attributes */
+  attrs = *p_attrib_set;
+
+  /* Is it allowed to change times ? */
+
+  if(!global_fs_info.cansettime)
+    {
+
+      if(attrs.asked_attributes
+         & (FSAL_ATTR_ATIME | FSAL_ATTR_CREATION | FSAL_ATTR_CTIME | FSAL_ATTR_MTIME))
+        {
+          /* handled as an unsettable attribute. */
+          Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_setattrs);
+        }
+    }
+
+  /* apply umask, if mode attribute is to be changed */
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_MODE))
+    {
+      attrs.mode &= (~global_fs_info.umask);
+    }
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_filehandle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_setattrs);
+
+  pthread_rwlock_wrlock(&inode->lock);
+  p_buffstat = &inode->attrs;
+
+  /***********
+   *  CHMOD  *
+   ***********/
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_MODE))
+    {
+
+      /* The POSIX chmod call don't affect the symlink object, but
+       * the entry it points to. So we must ignore it.
+       */
+      if(!S_ISLNK(p_buffstat->st_mode))
+        {
+
+          /* For modifying mode, user must be root or the owner */
+          if((mem_context->credential.user != 0)
+             && (mem_context->credential.user != p_buffstat->st_uid))
+            {
+              LogFullDebug(COMPONENT_FSAL,
+                           "Permission denied for CHMOD opeartion: current owner=%d, credential=%d",
+                           p_buffstat->st_uid, mem_context->credential.user);
+              status.major = ERR_FSAL_PERM;
+              status.minor = 0;
+              goto out;
+            }
+
+          p_buffstat->st_mode = (p_buffstat->st_mode & S_IFMT) |
+              fsal2unix_mode(attrs.mode);
+          changed = TRUE;
+        }
+
+    }
+
+  /***********
+   *  CHOWN  *
+   ***********/
+  /* Only root can change uid and A normal user must be in the group he wants to set */
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_OWNER))
+    {
+
+      /* For modifying owner, user must be root or current owner==wanted==client */
+      if((mem_context->credential.user != 0) &&
+         ((mem_context->credential.user != p_buffstat->st_uid) ||
+          (mem_context->credential.user != attrs.owner)))
+        {
+          LogFullDebug(COMPONENT_FSAL,
+                       "Permission denied for CHOWN opeartion: current owner=%d, credential=%d, new owner=%d",
+                       p_buffstat->st_uid, mem_context->credential.user, attrs.owner);
+          status.major = ERR_FSAL_PERM;
+          status.minor = 0;
+          goto out;
+        }
+    }
+
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_GROUP))
+    {
+      int in_grp = 0;
+
+      /* For modifying group, user must be root or current owner */
+      if((mem_context->credential.user != 0)
+         && (mem_context->credential.user != p_buffstat->st_uid))
+        {
+          status.major = ERR_FSAL_PERM;
+          status.minor = 0;
+          goto out;
+        }
+
+      /* set in_grp */
+      if(mem_context->credential.group == attrs.group)
+        in_grp = 1;
+      else
+        for(i = 0; i < mem_context->credential.nbgroups; i++)
+          {
+            if((in_grp = (attrs.group == mem_context->credential.alt_groups[i])))
+              break;
+          }
+
+      /* it must also be in target group */
+      if(mem_context->credential.user != 0 && !in_grp)
+        {
+          LogFullDebug(COMPONENT_FSAL,
+                       "Permission denied for CHOWN operation: current group=%d, credential=%d, new group=%d",
+                       p_buffstat->st_gid, mem_context->credential.group, attrs.group);
+          status.major = ERR_FSAL_PERM;
+          status.minor = 0;
+          goto out;
+        }
+    }
+
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_OWNER))
+    p_buffstat->st_uid = attrs.owner;
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_GROUP))
+    p_buffstat->st_gid = attrs.group;
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_OWNER | FSAL_ATTR_GROUP))
+    changed = TRUE;
+
+  /***********
+   *  UTIME  *
+   ***********/
+
+  /* user must be the owner or have read access to modify 'atime' */
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_ATIME)
+     && (mem_context->credential.user != 0)
+     && (mem_context->credential.user != p_buffstat->st_uid)
+     && ((status = fsal_check_access(p_context, FSAL_R_OK, p_buffstat, NULL)).major
+         != ERR_FSAL_NO_ERROR))
+    goto out;
+
+  /* user must be the owner or have write access to modify 'mtime' */
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_MTIME)
+     && (mem_context->credential.user != 0)
+     && (mem_context->credential.user != p_buffstat->st_uid)
+     && ((status = fsal_check_access(p_context, FSAL_W_OK, p_buffstat, NULL)).major
+         != ERR_FSAL_NO_ERROR))
+    goto out;
+
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_ATIME))
+    {
+      p_buffstat->st_atim.tv_sec = attrs.atime.seconds;
+      p_buffstat->st_atim.tv_nsec = attrs.atime.nseconds;
+      changed = TRUE;
+    }
+  if(FSAL_TEST_MASK(attrs.asked_attributes, FSAL_ATTR_MTIME))
+    {
+      p_buffstat->st_mtim.tv_sec = attrs.mtime.seconds;
+      p_buffstat->st_mtim.tv_nsec = attrs.mtime.nseconds;
+      changed = TRUE;
+    }
+
+  if(changed)
+    mem_inode_touch(inode, FALSE);
+
+  /* Optionaly fills output attributes. */
+  mem_getattrs_locked(inode, p_object_attributes);
+
+  status.major = ERR_FSAL_NO_ERROR;
+  status.minor = 0;
+
+ out:
+  pthread_rwlock_unlock(&inode->lock);
+  mem_inode_put(inode);
+
+  ReturnStatus(status, INDEX_FSAL_setattrs);
+}
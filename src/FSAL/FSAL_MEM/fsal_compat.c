@@ -0,0 +1,117 @@
+/*
+ * vim:expandtab:shiftwidth=4:tabstop=4:
+ */
+
+/**
+ * \file    fsal_compat.c
+ * \brief   FSAL glue functions
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_glue.h"
+#include "fsal_internal.h"
+#include "FSAL/common_methods.h"
+
+fsal_functions_t fsal_mem_functions = {
+  .fsal_access = MEMFSAL_access,
+  .fsal_getattrs = MEMFSAL_getattrs,
+  .fsal_getattrs_descriptor = MEMFSAL_getattrs_descriptor,
+  .fsal_setattrs = MEMFSAL_setattrs,
+  .fsal_buildexportcontext = MEMFSAL_BuildExportContext,
+  .fsal_cleanupexportcontext = COMMON_CleanUpExportContext_noerror,
+  .fsal_initclientcontext = COMMON_InitClientContext,
+  .fsal_getclientcontext = COMMON_GetClientContext,
+  .fsal_create = MEMFSAL_create,
+  .fsal_mkdir = MEMFSAL_mkdir,
+  .fsal_link = MEMFSAL_link,
+  .fsal_mknode = MEMFSAL_mknode,
+  .fsal_opendir = MEMFSAL_opendir,
+  .fsal_readdir = MEMFSAL_readdir,
+  .fsal_closedir = MEMFSAL_closedir,
+  .fsal_open_by_name = MEMFSAL_open_by_name,
+  .fsal_open = MEMFSAL_open,
+  .fsal_read = MEMFSAL_read,
+  .fsal_write = MEMFSAL_write,
+  .fsal_commit = MEMFSAL_commit,
+  .fsal_close = MEMFSAL_close,
+  .fsal_open_by_fileid = COMMON_open_by_fileid,
+  .fsal_close_by_fileid = COMMON_close_by_fileid,
+  .fsal_dynamic_fsinfo = MEMFSAL_dynamic_fsinfo,
+  .fsal_init = MEMFSAL_Init,
+  .fsal_terminate = COMMON_terminate_noerror,
+  .fsal_test_access = MEMFSAL_test_access,
+  .fsal_setattr_access = COMMON_setattr_access_notsupp,
+  .fsal_rename_access = COMMON_rename_access,
+  .fsal_create_access = COMMON_create_access,
+  .fsal_unlink_access = COMMON_unlink_access,
+  .fsal_link_access = COMMON_link_access,
+  .fsal_merge_attrs = COMMON_merge_attrs,
+  .fsal_lookup = MEMFSAL_lookup,
+  .fsal_lookuppath = MEMFSAL_lookupPath,
+  .fsal_lookupjunction = MEMFSAL_lookupJunction,
+  .fsal_lock_op = MEMFSAL_lock_op,
+  .fsal_cleanobjectresources = COMMON_CleanObjectResources,
+  .fsal_set_quota = COMMON_set_quota_noquota,
+  .fsal_get_quota = COMMON_get_quota_noquota,
+  .fsal_check_quota = COMMON_check_quota,
+  .fsal_rcp = MEMFSAL_rcp,
+  .fsal_rename = MEMFSAL_rename,
+  .fsal_get_stats = MEMFSAL_get_stats,
+  .fsal_readlink = MEMFSAL_readlink,
+  .fsal_symlink = MEMFSAL_symlink,
+  .fsal_handlecmp = MEMFSAL_handlecmp,
+  .fsal_handle_to_hashindex = MEMFSAL_Handle_to_HashIndex,
+  .fsal_handle_to_rbtindex = MEMFSAL_Handle_to_RBTIndex,
+  .fsal_handle_to_hash_both = NULL,
+  .fsal_digesthandle = MEMFSAL_DigestHandle,
+  .fsal_expandhandle = MEMFSAL_ExpandHandle,
+  .fsal_setdefault_fsal_parameter = COMMON_SetDefault_FSAL_parameter,
+  .fsal_setdefault_fs_common_parameter = COMMON_SetDefault_FS_common_parameter,
+  .fsal_setdefault_fs_specific_parameter = MEMFSAL_SetDefault_FS_specific_parameter,
+  .fsal_load_fsal_parameter_from_conf = COMMON_load_FSAL_parameter_from_conf,
+  .fsal_load_fs_common_parameter_from_conf =
+      COMMON_load_FS_common_parameter_from_conf,
+  .fsal_load_fs_specific_parameter_from_conf =
+      MEMFSAL_load_FS_specific_parameter_from_conf,
+  .fsal_truncate = MEMFSAL_truncate,
+  .fsal_unlink = MEMFSAL_unlink,
+  .fsal_getfsname = MEMFSAL_GetFSName,
+  .fsal_getxattrattrs = MEMFSAL_GetXAttrAttrs,
+  .fsal_listxattrs = MEMFSAL_ListXAttrs,
+  .fsal_getxattrvaluebyid = MEMFSAL_GetXAttrValueById,
+  .fsal_getxattridbyname = MEMFSAL_GetXAttrIdByName,
+  .fsal_getxattrvaluebyname = MEMFSAL_GetXAttrValueByName,
+  .fsal_setxattrvalue = MEMFSAL_SetXAttrValue,
+  .fsal_setxattrvaluebyid = MEMFSAL_SetXAttrValueById,
+  .fsal_removexattrbyid = MEMFSAL_RemoveXAttrById,
+  .fsal_removexattrbyname = MEMFSAL_RemoveXAttrByName,
+  .fsal_getextattrs = COMMON_getextattrs_notsupp,
+  .fsal_getfileno = MEMFSAL_GetFileno,
+  .fsal_share_op = COMMON_share_op_notsupp
+};
+
+fsal_const_t fsal_mem_consts = {
+  .fsal_handle_t_size = sizeof(memfsal_handle_t),
+  .fsal_op_context_t_size = sizeof(memfsal_op_context_t),
+  .fsal_export_context_t_size = sizeof(memfsal_export_context_t),
+  .fsal_file_t_size = sizeof(memfsal_file_t),
+  .fsal_cookie_t_size = sizeof(memfsal_cookie_t),
+  .fsal_cred_t_size = sizeof(struct user_credentials),
+  .fs_specific_initinfo_t_size = sizeof(memfs_specific_initinfo_t),
+  .fsal_dir_t_size = sizeof(memfsal_dir_t),
+  .fsal_handle_exact_len = TRUE
+};
+
+fsal_functions_t FSAL_GetFunctions(void)
+{
+  return fsal_mem_functions;
+}                               /* FSAL_GetFunctions */
+
+fsal_const_t FSAL_GetConsts(void)
+{
+  return fsal_mem_consts;
+}                               /* FSAL_GetConsts */
@@ -0,0 +1,94 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_context.c
+ * \brief   FSAL export context handling functions.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include <string.h>
+
+/**
+ * @defgroup FSALCredFunctions Credential handling functions.
+ *
+ * Those functions handle security contexts (credentials).
+ *
+ * @{
+ */
+
+/**
+ * build the export entry
+ *
+ * The store starts empty at every start of the server, so the export
+ * path is made if it does not exist yet: an export of FSAL_MEM is a
+ * scratch area, world writable with the sticky bit as /tmp.
+ */
+fsal_status_t MEMFSAL_BuildExportContext(fsal_export_context_t * context,   /* OUT */
+                                         fsal_path_t * p_export_path,   /* IN */
+                                         char *fs_specific_options      /* IN */
+    )
+{
+  memfsal_export_context_t * p_export_context = (memfsal_export_context_t *) context;
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity check */
+  if(p_export_context == NULL)
+    {
+      LogCrit(COMPONENT_FSAL, "NULL mandatory argument passed to %s()", __FUNCTION__);
+      Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_BuildExportContext);
+    }
+
+  if((fs_specific_options != NULL) && (fs_specific_options[0] != '\0'))
+    {
+      LogCrit(COMPONENT_FSAL,
+              "FSAL BUILD CONTEXT: ERROR: MEM takes no FS specific options (%s)",
+              fs_specific_options);
+      Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_BuildExportContext);
+    }
+
+  status = mem_walk_path(p_export_path != NULL ? p_export_path->path : "/",
+                         TRUE, &inode);
+  if(FSAL_IS_ERROR(status))
+    {
+      LogCrit(COMPONENT_FSAL,
+              "FSAL BUILD CONTEXT: ERROR: cannot make %s in memory: %s",
+              p_export_path != NULL ? p_export_path->path : "/",
+              label_fsal_err(status.major));
+      ReturnStatus(status, INDEX_FSAL_BuildExportContext);
+    }
+
+  mem_inode_to_handle(inode, (fsal_handle_t *) &p_export_context->root_handle);
+  mem_inode_put(inode);
+
+  p_export_context->fe_static_fs_info = &global_fs_info;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_BuildExportContext);
+}
+
+/* @} */
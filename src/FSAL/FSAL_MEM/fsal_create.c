@@ -0,0 +1,468 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_create.c
+ * \brief   Filesystem objects creation functions.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "FSAL/access_check.h"
+#include "abstract_mem.h"
+#include <string.h>
+#include <sys/sysmacros.h>
+
+/**
+ * mem_create_node:
+ * Makes an object of any type in a directory, for the calls below
+ * and FSAL_symlink.
+ *
+ * \param p_parent_directory_handle (input):
+ *        Handle of the parent directory.
+ * \param p_name (input):
+ *        Name of the object.
+ * \param p_context (input):
+ *        Authentication context for the operation (user,...).
+ * \param unix_mode (input):
+ *        Type and permissions of the object, umask applied.
+ * \param rdev (input):
+ *        Device of a special file.
+ * \param link_content (input):
+ *        Content of a symbolic link, NULL for the other types.
+ * \param p_object_handle (output):
+ *        Handle of the object.
+ * \param p_object_attributes (optional input/output):
+ *        Attributes of the object.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t mem_create_node(fsal_handle_t * p_parent_directory_handle,
+                              fsal_name_t * p_name,
+                              fsal_op_context_t * p_context,
+                              mode_t unix_mode, dev_t rdev,
+                              const char *link_content,
+                              fsal_handle_t * p_object_handle,
+                              fsal_attrib_list_t * p_object_attributes)
+{
+  fsal_status_t status;
+  struct mem_inode *dir, *inode;
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_parent_directory_handle, &dir);
+  if(FSAL_IS_ERROR(status))
+    return status;
+
+  pthread_rwlock_wrlock(&dir->lock);
+
+  if(!S_ISDIR(dir->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_NOTDIR;
+      status.minor = 0;
+      goto out;
+    }
+
+  /* the directory may have been removed */
+  if(dir->attrs.st_nlink == 0)
+    {
+      status.major = ERR_FSAL_STALE;
+      status.minor = 0;
+      goto out;
+    }
+
+  /* Check the user can write in the directory */
+  status = fsal_check_access(p_context, FSAL_W_OK | FSAL_X_OK, &dir->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  if(mem_dir_lookup(dir, p_name->name) != NULL)
+    {
+      status.major = ERR_FSAL_EXIST;
+      status.minor = EEXIST;
+      goto out;
+    }
+
+  status = mem_inode_new(p_context, unix_mode, rdev, dir, &inode);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  if(link_content != NULL)
+    {
+      inode->link = gsh_strdup(link_content);
+      if(inode->link == NULL)
+        {
+          status.major = ERR_FSAL_NOMEM;
+          status.minor = ENOMEM;
+        }
+      else
+        inode->attrs.st_size = strlen(link_content);
+    }
+
+  if(!FSAL_IS_ERROR(status))
+    status = mem_dir_add(dir, p_name->name, inode);
+
+  if(FSAL_IS_ERROR(status))
+    {
+      inode->attrs.st_nlink = 0;
+      mem_inode_unlinked(inode);
+      mem_inode_put(inode);
+      goto out;
+    }
+
+  pthread_rwlock_rdlock(&inode->lock);
+  mem_inode_to_handle(inode, p_object_handle);
+  mem_getattrs_locked(inode, p_object_attributes);
+  pthread_rwlock_unlock(&inode->lock);
+
+  mem_inode_put(inode);
+
+ out:
+  pthread_rwlock_unlock(&dir->lock);
+  mem_inode_put(dir);
+
+  return status;
+}
+
+/**
+ * FSAL_create:
+ * Create a regular file.
+ *
+ * \param parent_directory_handle (input):
+ *        Handle of the parent directory where the file is to be created.
+ * \param p_filename (input):
+ *        Pointer to the name of the file to be created.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param accessmode (input):
+ *        Mode for the file to be created.
+ *        (the umask defined into the FSAL configuration file
+ *        will be applied on it).
+ * \param object_handle (output):
+ *        Pointer to the handle of the created file.
+ * \param object_attributes (optional input/output):
+ *        The attributes of the created file.
+ *        As input, it defines the attributes that the caller
+ *        wants to retrieve (by positioning flags into this structure)
+ *        and the output is built considering this input
+ *        (it fills the structure according to the flags it contains).
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_create(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_filename,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_accessmode_t accessmode,      /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT */
+                             fsal_attrib_list_t * p_object_attributes   /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  mode_t unix_mode;
+
+  /* sanity checks.
+   * note : object_attributes is optional.
+   */
+  if(!p_parent_directory_handle || !p_context || !p_object_handle || !p_filename)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_create);
+
+  /* convert fsal mode to unix mode. */
+  unix_mode = fsal2unix_mode(accessmode);
+
+  /* Apply umask */
+  unix_mode = unix_mode & ~global_fs_info.umask;
+
+  status = mem_create_node(p_parent_directory_handle, p_filename, p_context,
+                           S_IFREG | unix_mode, 0, NULL,
+                           p_object_handle, p_object_attributes);
+
+  ReturnStatus(status, INDEX_FSAL_create);
+}
+
+/**
+ * FSAL_mkdir:
+ * Create a directory.
+ *
+ * \param parent_directory_handle (input):
+ *        Handle of the parent directory where
+ *        the subdirectory is to be created.
+ * \param p_dirname (input):
+ *        Pointer to the name of the directory to be created.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param accessmode (input):
+ *        Mode for the directory to be created.
+ *        (the umask defined into the FSAL configuration file
+ *        will be applied on it).
+ * \param object_handle (output):
+ *        Pointer to the handle of the created directory.
+ * \param object_attributes (optionnal input/output):
+ *        The attributes of the created directory.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_mkdir(fsal_handle_t * p_parent_directory_handle,       /* IN */
+                            fsal_name_t * p_dirname,    /* IN */
+                            fsal_op_context_t * p_context,   /* IN */
+                            fsal_accessmode_t accessmode,       /* IN */
+                            fsal_handle_t * p_object_handle, /* OUT */
+                            fsal_attrib_list_t * p_object_attributes    /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  mode_t unix_mode;
+
+  /* sanity checks.
+   * note : object_attributes is optional.
+   */
+  if(!p_parent_directory_handle || !p_context || !p_object_handle || !p_dirname)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_mkdir);
+
+  /* convert FSAL mode to unix mode. */
+  unix_mode = fsal2unix_mode(accessmode);
+
+  /* Apply umask */
+  unix_mode = unix_mode & ~global_fs_info.umask;
+
+  status = mem_create_node(p_parent_directory_handle, p_dirname, p_context,
+                           S_IFDIR | unix_mode, 0, NULL,
+                           p_object_handle, p_object_attributes);
+
+  ReturnStatus(status, INDEX_FSAL_mkdir);
+}
+
+/**
+ * FSAL_link:
+ * Create a hardlink.
+ *
+ * \param target_handle (input):
+ *        Handle of the target object.
+ * \param dir_handle (input):
+ *        Pointer to the directory handle where
+ *        the hardlink is to be created.
+ * \param p_link_name (input):
+ *        Pointer to the name of the hardlink to be created.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param attributes (optionnal input/output):
+ *        The post_operation attributes of the linked object.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_link(fsal_handle_t * p_target_handle,  /* IN */
+                           fsal_handle_t * p_dir_handle,     /* IN */
+                           fsal_name_t * p_link_name,   /* IN */
+                           fsal_op_context_t * p_context,    /* IN */
+                           fsal_attrib_list_t * p_attributes    /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *dir, *target;
+
+  /* sanity checks.
+   * note : attributes is optional.
+   */
+  if(!p_target_handle || !p_dir_handle || !p_context || !p_link_name)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_link);
+
+  /* Tests if hardlinking is allowed by configuration. */
+
+  if(!global_fs_info.link_support)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_link);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_target_handle, &target);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_link);
+
+  status = mem_handle_to_inode(p_dir_handle, &dir);
+  if(FSAL_IS_ERROR(status))
+    {
+      mem_inode_put(target);
+      ReturnStatus(status, INDEX_FSAL_link);
+    }
+
+  /* A directory is not linked, so the target comes after the
+   * directory in the lock order whatever it is */
+  pthread_rwlock_wrlock(&dir->lock);
+
+  if(!S_ISDIR(dir->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_NOTDIR;
+      status.minor = 0;
+      goto out_dir;
+    }
+
+  if(dir->attrs.st_nlink == 0)
+    {
+      status.major = ERR_FSAL_STALE;
+      status.minor = 0;
+      goto out_dir;
+    }
+
+  status = fsal_check_access(p_context, FSAL_W_OK | FSAL_X_OK, &dir->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    goto out_dir;
+
+  if(S_ISDIR(target->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_ISDIR;
+      status.minor = 0;
+      goto out_dir;
+    }
+
+  pthread_rwlock_wrlock(&target->lock);
+
+  if(target->attrs.st_nlink == 0)
+    {
+      status.major = ERR_FSAL_STALE;
+      status.minor = 0;
+    }
+  else if(target->attrs.st_nlink >= global_fs_info.maxlink)
+    {
+      status.major = ERR_FSAL_MLINK;
+      status.minor = EMLINK;
+    }
+  else
+    status = mem_dir_add(dir, p_link_name->name, target);
+
+  if(!FSAL_IS_ERROR(status))
+    {
+      target->attrs.st_nlink++;
+      mem_inode_touch(target, FALSE);
+
+      /* optionnaly get attributes */
+      mem_getattrs_locked(target, p_attributes);
+    }
+
+  pthread_rwlock_unlock(&target->lock);
+
+ out_dir:
+  pthread_rwlock_unlock(&dir->lock);
+  mem_inode_put(dir);
+  mem_inode_put(target);
+
+  ReturnStatus(status, INDEX_FSAL_link);
+}
+
+/**
+ * FSAL_mknode:
+ * Create a special object in the filesystem.
+ *
+ * \param parentdir_handle (input):
+ *        Handle of the parent directory where the node is to be created.
+ * \param p_node_name (input):
+ *        Pointer to the name of the node to be created.
+ * \param p_context (input):
+ *        Authentication context for the operation (user,...).
+ * \param accessmode (input):
+ *        Mode for the node to be created.
+ * \param nodetype (input):
+ *        Type of the node to be created.
+ * \param dev (input):
+ *        Device numbers of a block or character special file.
+ * \param p_object_handle (output):
+ *        Handle of the created node.
+ * \param node_attributes (optionnal input/output):
+ *        The attributes of the created node.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_mknode(fsal_handle_t * parentdir_handle,       /* IN */
+                             fsal_name_t * p_node_name, /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_accessmode_t accessmode,      /* IN */
+                             fsal_nodetype_t nodetype,  /* IN */
+                             fsal_dev_t * dev,  /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT (handle to the created node) */
+                             fsal_attrib_list_t * node_attributes       /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  mode_t unix_mode = 0;
+  dev_t unix_dev = 0;
+
+  /* sanity checks.
+   * note : link_attributes is optional.
+   */
+  if(!parentdir_handle || !p_context || !p_node_name || !p_object_handle)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_mknode);
+
+  unix_mode = fsal2unix_mode(accessmode);
+
+  /* Apply umask */
+  unix_mode = unix_mode & ~global_fs_info.umask;
+
+  switch (nodetype)
+    {
+    case FSAL_TYPE_BLK:
+      if(!dev)
+        Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_mknode);
+      unix_mode |= S_IFBLK;
+      unix_dev = makedev(dev->major, dev->minor);
+      break;
+
+    case FSAL_TYPE_CHR:
+      if(!dev)
+        Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_mknode);
+      unix_mode |= S_IFCHR;
+      unix_dev = makedev(dev->major, dev->minor);
+      break;
+
+    case FSAL_TYPE_SOCK:
+      unix_mode |= S_IFSOCK;
+      break;
+
+    case FSAL_TYPE_FIFO:
+      unix_mode |= S_IFIFO;
+      break;
+
+    default:
+      LogMajor(COMPONENT_FSAL, "Invalid node type in FSAL_mknode: %d", nodetype);
+      Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_mknode);
+    }
+
+  status = mem_create_node(parentdir_handle, p_node_name, p_context,
+                           unix_mode, unix_dev, NULL,
+                           p_object_handle, node_attributes);
+
+  ReturnStatus(status, INDEX_FSAL_mknode);
+}
@@ -0,0 +1,280 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_dirs.c
+ * \brief   Directory browsing operations.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "FSAL/access_check.h"
+#include <string.h>
+
+/**
+ * FSAL_opendir :
+ *     Opens a directory for reading its content.
+ *
+ * \param dir_handle (input)
+ *         the handle of the directory to be opened.
+ * \param cred (input)
+ *         Permission context for the operation (user,...).
+ * \param dir_descriptor (output)
+ *         pointer to an allocated structure that will receive
+ *         directory stream informations, on successfull completion.
+ * \param dir_attributes (optional output)
+ *         On successfull completion,the structure pointed
+ *         by dir_attributes receives the new directory attributes.
+ *         May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_opendir(fsal_handle_t * p_dir_handle,  /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_dir_t * dir_desc, /* OUT */
+                              fsal_attrib_list_t * p_dir_attributes     /* [ IN/OUT ] */
+    )
+{
+  memfsal_dir_t * p_dir_descriptor = (memfsal_dir_t *) dir_desc;
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity checks
+   * note : dir_attributes is optionnal.
+   */
+  if(!p_dir_handle || !p_context || !p_dir_descriptor)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_opendir);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_dir_handle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_opendir);
+
+  pthread_rwlock_rdlock(&inode->lock);
+
+  if(!S_ISDIR(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_NOTDIR;
+      status.minor = ENOTDIR;
+      goto out;
+    }
+
+  /* Test access rights for this directory */
+  status = fsal_check_access(p_context, FSAL_R_OK, &inode->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  mem_getattrs_locked(inode, p_dir_attributes);
+
+ out:
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(FSAL_IS_ERROR(status))
+    {
+      mem_inode_put(inode);
+      ReturnStatus(status, INDEX_FSAL_opendir);
+    }
+
+  /* if everything is OK, fills the dir_desc structure,
+   * keeping the reference on the inode until closedir */
+
+  p_dir_descriptor->inode = inode;
+  memcpy(&(p_dir_descriptor->context), p_context, sizeof(memfsal_op_context_t));
+  memset(&(p_dir_descriptor->handle), 0, sizeof(memfsal_handle_t));
+  memcpy(&(p_dir_descriptor->handle), p_dir_handle,
+         sizeof(((memfsal_handle_t *) p_dir_handle)->data));
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_opendir);
+}
+
+/**
+ * FSAL_readdir :
+ *     Read the entries of an opened directory.
+ *
+ * The cookie of an entry is given to it when it is added to the
+ * directory and never reused, so a readdir resumed from a cookie goes
+ * on after that entry even if entries were removed meanwhile.
+ *
+ * \param dir_descriptor (input):
+ *        Pointer to the directory descriptor filled by FSAL_opendir.
+ * \param start_position (input):
+ *        Cookie that indicates the first object to be read during
+ *        this readdir operation.
+ *        This should be :
+ *        - FSAL_READDIR_FROM_BEGINNING for reading the content
+ *          of the directory from the beginning.
+ *        - The end_position parameter returned by the previous
+ *          call to FSAL_readdir.
+ * \param get_attr_mask (input)
+ *        Specify the set of attributes to be retrieved for directory entries.
+ * \param buffersize (input)
+ *        The size (in bytes) of the buffer where
+ *        the direntries are to be stored.
+ * \param pdirent (output)
+ *        Adresse of the buffer where the direntries are to be stored.
+ * \param end_position (output)
+ *        Cookie that indicates the current position in the directory.
+ * \param nb_entries (output)
+ *        Pointer to the number of entries read during the call.
+ * \param end_of_dir (output)
+ *        Pointer to a boolean that indicates if the end of dir
+ *        has been reached during the call.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_readdir(fsal_dir_t * dir_descriptor,      /* IN */
+                              fsal_cookie_t startposition,      /* IN */
+                              fsal_attrib_mask_t get_attr_mask, /* IN */
+                              fsal_mdsize_t buffersize,         /* IN */
+                              fsal_dirent_t * p_pdirent,        /* OUT */
+                              fsal_cookie_t * end_position,     /* OUT */
+                              fsal_count_t * p_nb_entries,      /* OUT */
+                              fsal_boolean_t * p_end_of_dir     /* OUT */
+    )
+{
+  memfsal_dir_t * p_dir_descriptor = (memfsal_dir_t *) dir_descriptor;
+  memfsal_cookie_t * p_end_position = (memfsal_cookie_t *) end_position;
+  struct mem_inode *dir, *inode;
+  struct mem_dirent *dirent;
+  fsal_count_t max_dir_entries;
+  fsal_status_t st;
+  uint64_t cookie;
+
+  /*****************/
+  /* sanity checks */
+  /*****************/
+
+  if(!p_dir_descriptor || !p_pdirent || !p_end_position || !p_nb_entries || !p_end_of_dir)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_readdir);
+
+  max_dir_entries = (buffersize / sizeof(fsal_dirent_t));
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  dir = p_dir_descriptor->inode;
+  cookie = ((memfsal_cookie_t *) &startposition)->data.cookie;
+
+  *p_nb_entries = 0;
+  *p_end_of_dir = FALSE;
+
+  pthread_rwlock_rdlock(&dir->lock);
+
+  dirent = mem_dir_next(dir, cookie);
+
+  while(dirent != NULL && *p_nb_entries < max_dir_entries)
+    {
+      fsal_dirent_t *p_entry = &p_pdirent[*p_nb_entries];
+
+      /* The directory is locked, so the entry holds its inode in the
+       * table: it cannot be missing. */
+      inode = mem_inode_get(dirent->id);
+      if(inode == NULL)
+        {
+          LogCrit(COMPONENT_FSAL, "Entry %s of directory %"PRIu64
+                  " has no inode %"PRIu64, dirent->name, dir->id, dirent->id);
+          dirent = mem_dir_next(dir, dirent->cookie);
+          continue;
+        }
+
+      st = FSAL_str2name(dirent->name, FSAL_MAX_NAME_LEN, &p_entry->name);
+      if(FSAL_IS_ERROR(st))
+        {
+          mem_inode_put(inode);
+          pthread_rwlock_unlock(&dir->lock);
+          ReturnStatus(st, INDEX_FSAL_readdir);
+        }
+
+      pthread_rwlock_rdlock(&inode->lock);
+
+      mem_inode_to_handle(inode, &p_entry->handle);
+
+      p_entry->attributes.asked_attributes = get_attr_mask;
+      st = mem2fsal_attributes(inode, &p_entry->attributes);
+
+      pthread_rwlock_unlock(&inode->lock);
+      mem_inode_put(inode);
+
+      if(FSAL_IS_ERROR(st))
+        {
+          pthread_rwlock_unlock(&dir->lock);
+          FSAL_CLEAR_MASK(p_entry->attributes.asked_attributes);
+          FSAL_SET_MASK(p_entry->attributes.asked_attributes, FSAL_ATTR_RDATTR_ERR);
+          ReturnStatus(st, INDEX_FSAL_readdir);
+        }
+
+      ((memfsal_cookie_t *) (&p_entry->cookie))->data.cookie = dirent->cookie;
+      p_entry->nextentry = NULL;
+      if(*p_nb_entries)
+        p_pdirent[*p_nb_entries - 1].nextentry = p_entry;
+
+      memcpy((char *)p_end_position, (char *)&p_entry->cookie,
+             sizeof(memfsal_cookie_t));
+
+      (*p_nb_entries)++;
+
+      dirent = mem_dir_next(dir, dirent->cookie);
+    }
+
+  if(dirent == NULL)
+    *p_end_of_dir = TRUE;
+
+  pthread_rwlock_unlock(&dir->lock);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_readdir);
+}
+
+/**
+ * FSAL_closedir :
+ * Free the resources allocated for reading directory entries.
+ *
+ * \param dir_descriptor (input):
+ *        Pointer to a directory descriptor filled by FSAL_opendir.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_closedir(fsal_dir_t * p_dir_desc /* IN */
+    )
+{
+  memfsal_dir_t * p_dir_descriptor = (memfsal_dir_t *) p_dir_desc;
+
+  /* sanity checks */
+  if(!p_dir_descriptor || !p_dir_descriptor->inode)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_closedir);
+
+  mem_inode_put(p_dir_descriptor->inode);
+
+  /* fill dir_descriptor with zeros */
+  memset(p_dir_descriptor, 0, sizeof(memfsal_dir_t));
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_closedir);
+}
@@ -0,0 +1,496 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_fileop.c
+ * \brief   Files operations.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "FSAL/access_check.h"
+#include "fsal_convert.h"
+#include <string.h>
+
+/**
+ * FSAL_open_byname:
+ * Open a regular file for reading/writing its data content.
+ *
+ * \param dirhandle (input):
+ *        Handle of the directory that contain the file to be read/modified.
+ * \param filename (input):
+ *        Name of the file to be read/modified
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param openflags (input):
+ *        Flags that indicates behavior for file opening and access.
+ * \param file_descriptor (output):
+ *        The file descriptor to be used for FSAL_read/write operations.
+ * \param file_attributes (optionnal input/output):
+ *        Post operation attributes.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR     (no error)
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_open_by_name(fsal_handle_t * dirhandle,        /* IN */
+                                   fsal_name_t * filename,      /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_openflags_t openflags,  /* IN */
+                                   fsal_file_t * file_descriptor,    /* OUT */
+                                   fsal_attrib_list_t * file_attributes /* [ IN/OUT ] */ )
+{
+  fsal_status_t fsal_status;
+  fsal_handle_t filehandle;
+
+  if(!dirhandle || !filename || !p_context || !file_descriptor)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_open_by_name);
+
+  fsal_status = FSAL_lookup(dirhandle, filename, p_context, &filehandle, file_attributes);
+  if(FSAL_IS_ERROR(fsal_status))
+    return fsal_status;
+
+  return FSAL_open(&filehandle, p_context, openflags, file_descriptor, file_attributes);
+}
+
+/**
+ * FSAL_open:
+ * Open a regular file for reading/writing its data content.
+ *
+ * The descriptor keeps a reference on the inode, so an opened file
+ * stays readable and writable after its last name is removed, as on a
+ * local file system.
+ *
+ * \param filehandle (input):
+ *        Handle of the file to be read/modified.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param openflags (input):
+ *        Flags that indicates behavior for file opening and access.
+ *        This is an inclusive OR of the following values
+ *        ( such of them are not compatible) :
+ *        - FSAL_O_RDONLY: opening file for reading only.
+ *        - FSAL_O_RDWR: opening file for reading and writing.
+ *        - FSAL_O_WRONLY: opening file for writting only.
+ *        - FSAL_O_APPEND: always write at the end of the file.
+ *        - FSAL_O_TRUNC: truncate the file to 0 on opening.
+ * \param file_descriptor (output):
+ *        The file descriptor to be used for FSAL_read/write operations.
+ * \param file_attributes (optionnal input/output):
+ *        Post operation attributes.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_open(fsal_handle_t * p_filehandle,     /* IN */
+                           fsal_op_context_t * p_context,    /* IN */
+                           fsal_openflags_t openflags,  /* IN */
+                           fsal_file_t * file_desc,  /* OUT */
+                           fsal_attrib_list_t * p_file_attributes       /* [ IN/OUT ] */
+    )
+{
+  memfsal_file_t * p_file_descriptor = (memfsal_file_t *) file_desc;
+  fsal_status_t status;
+  struct mem_inode *inode;
+  fsal_accessflags_t access_mask;
+  int rc, posix_flags = 0;
+
+  /* sanity checks.
+   * note : file_attributes is optional.
+   */
+  if(!p_filehandle || !p_context || !p_file_descriptor)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_open);
+
+  /* check the flags the way the other FSALs do */
+  rc = fsal2posix_openflags(openflags, &posix_flags);
+
+  /* flags conflicts. */
+  if(rc)
+    {
+      LogWarn(COMPONENT_FSAL, "Invalid/conflicting flags : %#X", openflags);
+      Return(rc, 0, INDEX_FSAL_open);
+    }
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_filehandle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_open);
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  if(S_ISDIR(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_ISDIR;
+      status.minor = EISDIR;
+      goto out;
+    }
+  else if(!S_ISREG(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_INVAL;
+      status.minor = EINVAL;
+      goto out;
+    }
+
+  /* a read-write open needs both rights */
+  if(openflags & FSAL_O_RDWR)
+    access_mask = FSAL_R_OK | FSAL_W_OK;
+  else if(openflags & FSAL_O_RDONLY)
+    access_mask = FSAL_R_OK;
+  else
+    access_mask = FSAL_W_OK;
+
+  status = fsal_check_access(p_context, access_mask | FSAL_OWNER_OK,
+                             &inode->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  if(openflags & FSAL_O_TRUNC)
+    {
+      status = mem_file_truncate(inode, 0);
+      if(FSAL_IS_ERROR(status))
+        goto out;
+    }
+
+  inode->opens++;
+
+  mem_getattrs_locked(inode, p_file_attributes);
+
+ out:
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(FSAL_IS_ERROR(status))
+    {
+      mem_inode_put(inode);
+      ReturnStatus(status, INDEX_FSAL_open);
+    }
+
+  p_file_descriptor->inode = inode;
+  p_file_descriptor->openflags = openflags;
+  p_file_descriptor->current_offset = 0;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_open);
+}
+
+/**
+ * mem_seek:
+ * Finds where a read or a write starts, the inode being locked.
+ */
+static fsal_status_t mem_seek(memfsal_file_t * p_file_descriptor,
+                              fsal_seek_t * p_seek_descriptor,
+                              uint64_t * p_offset)
+{
+  int64_t base;
+
+  if(!p_seek_descriptor)
+    {
+      *p_offset = p_file_descriptor->current_offset;
+      ReturnCode(ERR_FSAL_NO_ERROR, 0);
+    }
+
+  switch (p_seek_descriptor->whence)
+    {
+    case FSAL_SEEK_SET:
+      base = 0;
+      break;
+
+    case FSAL_SEEK_CUR:
+      base = p_file_descriptor->current_offset;
+      break;
+
+    case FSAL_SEEK_END:
+      base = p_file_descriptor->inode->attrs.st_size;
+      break;
+
+    default:
+      ReturnCode(ERR_FSAL_INVAL, EINVAL);
+    }
+
+  if(base + (int64_t) p_seek_descriptor->offset < 0)
+    {
+      LogFullDebug(COMPONENT_FSAL,
+                   "Error in seek operation (whence=%d, offset=%lld)",
+                   p_seek_descriptor->whence,
+                   (long long) p_seek_descriptor->offset);
+      ReturnCode(ERR_FSAL_INVAL, EINVAL);
+    }
+
+  *p_offset = base + p_seek_descriptor->offset;
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+/**
+ * FSAL_read:
+ * Perform a read operation on an opened file.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param seek_descriptor (optional input):
+ *        Specifies the position where data is to be read.
+ *        If not specified, data will be read at the current position.
+ * \param buffer_size (input):
+ *        Amount (in bytes) of data to be read.
+ * \param buffer (output):
+ *        Address where the read data is to be stored in memory.
+ * \param read_amount (output):
+ *        Pointer to the amount of data (in bytes) that have been read
+ *        during this call.
+ * \param end_of_file (output):
+ *        Pointer to a boolean that indicates whether the end of file
+ *        has been reached during this call.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_read(fsal_file_t * file_desc,  /* IN */
+                           fsal_seek_t * p_seek_descriptor,     /* [IN] */
+                           fsal_size_t buffer_size,     /* IN */
+                           caddr_t buffer,      /* OUT */
+                           fsal_size_t * p_read_amount, /* OUT */
+                           fsal_boolean_t * p_end_of_file       /* OUT */
+    )
+{
+  memfsal_file_t * p_file_descriptor = (memfsal_file_t *) file_desc;
+  struct mem_inode *inode;
+  fsal_status_t status;
+  uint64_t offset;
+
+  /* sanity checks. */
+
+  if(!p_file_descriptor || !p_file_descriptor->inode || !buffer ||
+     !p_read_amount || !p_end_of_file)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_read);
+
+  mem_latency(MEM_LATENCY_READ);
+
+  inode = p_file_descriptor->inode;
+
+  pthread_rwlock_rdlock(&inode->lock);
+
+  status = mem_seek(p_file_descriptor, p_seek_descriptor, &offset);
+  if(FSAL_IS_ERROR(status))
+    {
+      pthread_rwlock_unlock(&inode->lock);
+      ReturnStatus(status, INDEX_FSAL_read);
+    }
+
+  *p_read_amount = mem_file_read(inode, offset, buffer_size, buffer);
+  *p_end_of_file = (offset + *p_read_amount >= (uint64_t) inode->attrs.st_size);
+
+  pthread_rwlock_unlock(&inode->lock);
+
+  /* reads at a given position do not move the current one, as pread */
+  if(!p_seek_descriptor || p_seek_descriptor->whence != FSAL_SEEK_SET)
+    p_file_descriptor->current_offset = offset + *p_read_amount;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_read);
+}
+
+/**
+ * FSAL_write:
+ * Perform a write operation on an opened file.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param p_context (input):
+ *        Authentication context for the operation (user,...).
+ * \param seek_descriptor (optional input):
+ *        Specifies the position where data is to be written.
+ *        If not specified, data will be written at the current position.
+ * \param buffer_size (input):
+ *        Amount (in bytes) of data to be written.
+ * \param buffer (input):
+ *        Address in memory of the data to write to file.
+ * \param write_amount (output):
+ *        Pointer to the amount of data (in bytes) that have been written
+ *        during this call.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - ERR_FSAL_NOSPC: Max_Size is reached, nothing was written.
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_write(fsal_file_t * file_desc, /* IN */
+                            fsal_op_context_t * p_context,   /* IN */
+                            fsal_seek_t * p_seek_descriptor,    /* IN */
+                            fsal_size_t buffer_size,    /* IN */
+                            caddr_t buffer,     /* IN */
+                            fsal_size_t * p_write_amount        /* OUT */
+    )
+{
+  memfsal_file_t * p_file_descriptor = (memfsal_file_t *) file_desc;
+  struct mem_inode *inode;
+  fsal_status_t status;
+  uint64_t offset;
+
+  /* sanity checks. */
+  if(!p_file_descriptor || !p_file_descriptor->inode || !buffer || !p_write_amount)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_write);
+
+  if(!(p_file_descriptor->openflags & (FSAL_O_WRONLY | FSAL_O_RDWR)))
+    Return(ERR_FSAL_PERM, 0, INDEX_FSAL_write);
+
+  *p_write_amount = 0;
+
+  mem_latency(MEM_LATENCY_WRITE);
+
+  inode = p_file_descriptor->inode;
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  if(p_file_descriptor->openflags & FSAL_O_APPEND)
+    offset = inode->attrs.st_size;
+  else
+    {
+      status = mem_seek(p_file_descriptor, p_seek_descriptor, &offset);
+      if(FSAL_IS_ERROR(status))
+        {
+          pthread_rwlock_unlock(&inode->lock);
+          ReturnStatus(status, INDEX_FSAL_write);
+        }
+    }
+
+  LogFullDebug(COMPONENT_FSAL,
+               "Write operation (inode=%"PRIu64", offset=%"PRIu64", size=%llu)",
+               inode->id, offset, (unsigned long long) buffer_size);
+
+  status = mem_file_write(inode, offset, buffer_size, buffer, p_write_amount);
+
+  /* a write that ran out of room part way returns what it wrote */
+  if(FSAL_IS_ERROR(status) && *p_write_amount != 0)
+    {
+      status.major = ERR_FSAL_NO_ERROR;
+      status.minor = 0;
+    }
+
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(FSAL_IS_ERROR(status))
+    {
+      LogDebug(COMPONENT_FSAL,
+               "Write operation of size %llu at offset %"PRIu64" failed: %s",
+               (unsigned long long) buffer_size, offset,
+               label_fsal_err(status.major));
+      ReturnStatus(status, INDEX_FSAL_write);
+    }
+
+  if(!p_seek_descriptor || p_seek_descriptor->whence != FSAL_SEEK_SET)
+    p_file_descriptor->current_offset = offset + *p_write_amount;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_write);
+}
+
+/**
+ * FSAL_close:
+ * Free the resources allocated by the FSAL_open call.
+ *
+ * The locks of the file go with its last close, as the POSIX locks of
+ * a process do when it closes its descriptor.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_close(fsal_file_t * file_desc  /* IN */
+    )
+{
+  memfsal_file_t * p_file_descriptor = (memfsal_file_t *) file_desc;
+  struct mem_inode *inode;
+  struct glist_head *glist, *glistn;
+
+  /* sanity checks. */
+  if(!p_file_descriptor)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_close);
+
+  inode = p_file_descriptor->inode;
+  if(inode == NULL)
+    Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_close);
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  if(--inode->opens == 0)
+    {
+      glist_for_each_safe(glist, glistn, &inode->locks)
+        {
+          glist_del(glist);
+          gsh_free(glist_entry(glist, struct mem_lock, list));
+        }
+    }
+
+  pthread_rwlock_unlock(&inode->lock);
+
+  mem_inode_put(inode);
+
+  memset(p_file_descriptor, 0, sizeof(memfsal_file_t));
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_close);
+}
+
+unsigned int MEMFSAL_GetFileno(fsal_file_t * pfile)
+{
+  struct mem_inode *inode = ((memfsal_file_t *) pfile)->inode;
+
+  return inode != NULL ? (unsigned int)inode->id : 0;
+}
+
+/**
+ * FSAL_commit:
+ * This function is used for processing stable writes and COMMIT requests.
+ *
+ * The data is as stable as it will ever be once written, so this only
+ * waits the Commit_Latency of the configuration.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param offset:
+ *        The starting offset for the portion of file to be synced
+ * \param length:
+ *        The length for the portion of file to be synced.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - Another error code if an error occurred during this call.
+ */
+fsal_status_t MEMFSAL_commit(fsal_file_t * p_file_descriptor,
+                             fsal_off_t    offset,
+                             fsal_size_t   length )
+{
+  /* sanity checks. */
+  if(!p_file_descriptor)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_commit);
+
+  if(((memfsal_file_t *)p_file_descriptor)->inode == NULL)
+    Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_commit); /* Nothing to sync, the file is not opened */
+
+  mem_latency(MEM_LATENCY_COMMIT);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_commit);
+}
@@ -0,0 +1,99 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_fsinfo.c
+ * \brief   functions for retrieving filesystem info.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include <unistd.h>
+
+/* Files reported when Max_Files sets no limit */
+#define MEM_DEFAULT_FILES (1ULL << 32)
+
+/**
+ * FSAL_dynamic_fsinfo:
+ * Return dynamic filesystem info such as
+ * used size, free size, number of objects...
+ *
+ * Without Max_Size, the store may grow as large as the physical
+ * memory of the server, which is what is reported.
+ *
+ * \param filehandle (input):
+ *        Handle of an object in the filesystem
+ *        whom info is to be retrieved.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param dynamicinfo (output):
+ *        Pointer to the static info of the filesystem.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - ERR_FSAL_FAULT: NULL pointer passed as input parameter.
+ */
+fsal_status_t MEMFSAL_dynamic_fsinfo(fsal_handle_t * p_filehandle,   /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_dynamicfsinfo_t * p_dynamicinfo       /* OUT */
+    )
+{
+  fsal_u64_t bytes_used, files_used;
+
+  /* sanity checks. */
+  if(!p_filehandle || !p_dynamicinfo || !p_context)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_dynamic_fsinfo);
+
+  mem_store_usage(&bytes_used, &files_used);
+
+  if(global_mem_info.max_size != 0)
+    p_dynamicinfo->total_bytes = global_mem_info.max_size;
+  else
+    p_dynamicinfo->total_bytes =
+        (fsal_u64_t) sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE);
+
+  if(bytes_used > p_dynamicinfo->total_bytes)
+    p_dynamicinfo->free_bytes = 0;
+  else
+    p_dynamicinfo->free_bytes = p_dynamicinfo->total_bytes - bytes_used;
+  p_dynamicinfo->avail_bytes = p_dynamicinfo->free_bytes;
+
+  if(global_mem_info.max_files != 0)
+    p_dynamicinfo->total_files = global_mem_info.max_files;
+  else
+    p_dynamicinfo->total_files = MEM_DEFAULT_FILES;
+
+  if(files_used > p_dynamicinfo->total_files)
+    p_dynamicinfo->free_files = 0;
+  else
+    p_dynamicinfo->free_files = p_dynamicinfo->total_files - files_used;
+  p_dynamicinfo->avail_files = p_dynamicinfo->free_files;
+
+  p_dynamicinfo->time_delta.seconds = 1;
+  p_dynamicinfo->time_delta.nseconds = 0;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_dynamic_fsinfo);
+}
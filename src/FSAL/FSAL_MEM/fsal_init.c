@@ -0,0 +1,81 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright CEA/DAM/DIF  (2008)
+ * contributeur : Philippe DENIEL   philippe.deniel@cea.fr
+ *                Thomas LEIBOVICI  thomas.leibovici@cea.fr
+ *
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ------------- 
+ */
+
+/**
+ *
+ * \file    fsal_init.c
+ * \brief   Initialization functions.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+
+/**
+ * FSAL_Init : Initializes the FileSystem Abstraction Layer.
+ *
+ * \param init_info (input, fsal_parameter_t *) :
+ *        Pointer to a structure that contains
+ *        all initialization parameters for the FSAL.
+ *        Specifically, it contains settings about
+ *        the filesystem on which the FSAL is based,
+ *        security settings, logging policy and outputs,
+ *        and other general FSAL options.
+ *
+ * \return Major error codes :
+ *         ERR_FSAL_NO_ERROR     (initialisation OK)
+ *         ERR_FSAL_FAULT        (init_info pointer is null)
+ *         ERR_FSAL_SERVERFAULT  (misc FSAL error)
+ *         ERR_FSAL_ALREADY_INIT (The FS is already initialized)
+ *         ERR_FSAL_BAD_INIT     (FS specific init error,
+ *                                minor error code gives the reason
+ *                                for this error.)
+ *         ERR_FSAL_SEC_INIT     (Security context init error).
+ */
+fsal_status_t MEMFSAL_Init(fsal_parameter_t * init_info /* IN */
+    )
+{
+  fsal_status_t status;
+
+  /* sanity check.  */
+  if(!init_info)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_Init);
+
+  /* proceeds FSAL internal initialization */
+
+  status = fsal_internal_init_global(&(init_info->fsal_info),
+                                     &(init_info->fs_common_info),
+                                     & (init_info->fs_specific_info));
+
+  if(FSAL_IS_ERROR(status))
+    Return(status.major, status.minor, INDEX_FSAL_Init);
+
+  /* Regular exit */
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_Init);
+
+}
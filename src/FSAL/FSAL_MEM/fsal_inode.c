@@ -0,0 +1,720 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ *
+ * \file    fsal_inode.c
+ * \brief   The in-memory store of FSAL_MEM
+ *
+ * Inodes are kept in a table of partitions, each an AVL tree by inode
+ * number under its own lock, so that looking up handles from many
+ * workers does not serialize on one lock.  File data are kept in
+ * pages of MEM_PAGE_SIZE bytes in an AVL tree by page index; a page
+ * that was never written is a hole and reads as zeroes.
+ *
+ * An inode is freed when its last reference goes: the table holds
+ * one as long as the inode has links, open files and the FSAL calls
+ * in progress hold the others.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <time.h>
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "abstract_atomic.h"
+#include "abstract_mem.h"
+
+#define MEM_PARTITIONS 64
+
+/* Size a directory entry adds to its directory, as tmpfs counts */
+#define MEM_DIRENT_SIZE 20
+
+struct mem_partition
+{
+  pthread_rwlock_t lock;
+  struct avltree inodes;
+};
+
+static struct mem_partition mem_table[MEM_PARTITIONS];
+static uint64_t mem_next_id = MEM_ROOT_ID - 1;
+static uint32_t mem_generation;
+
+static uint64_t mem_bytes_used;
+static uint64_t mem_files_used;
+
+pthread_mutex_t mem_rename_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static int mem_inode_cmp(const struct avltree_node *a, const struct avltree_node *b)
+{
+  struct mem_inode *ia = avltree_container_of(a, struct mem_inode, node);
+  struct mem_inode *ib = avltree_container_of(b, struct mem_inode, node);
+
+  if(ia->id != ib->id)
+    return ia->id < ib->id ? -1 : 1;
+  return 0;
+}
+
+static int mem_page_cmp(const struct avltree_node *a, const struct avltree_node *b)
+{
+  struct mem_page *pa = avltree_container_of(a, struct mem_page, node);
+  struct mem_page *pb = avltree_container_of(b, struct mem_page, node);
+
+  if(pa->index != pb->index)
+    return pa->index < pb->index ? -1 : 1;
+  return 0;
+}
+
+static int mem_name_cmp(const struct avltree_node *a, const struct avltree_node *b)
+{
+  struct mem_dirent *da = avltree_container_of(a, struct mem_dirent, node_name);
+  struct mem_dirent *db = avltree_container_of(b, struct mem_dirent, node_name);
+
+  return strcmp(da->name, db->name);
+}
+
+static int mem_cookie_cmp(const struct avltree_node *a, const struct avltree_node *b)
+{
+  struct mem_dirent *da = avltree_container_of(a, struct mem_dirent, node_cookie);
+  struct mem_dirent *db = avltree_container_of(b, struct mem_dirent, node_cookie);
+
+  if(da->cookie != db->cookie)
+    return da->cookie < db->cookie ? -1 : 1;
+  return 0;
+}
+
+static inline struct mem_partition *mem_partition_of(uint64_t id)
+{
+  return &mem_table[id % MEM_PARTITIONS];
+}
+
+static void mem_now(struct timespec *ts)
+{
+  if(clock_gettime(CLOCK_REALTIME, ts) != 0)
+    {
+      ts->tv_sec = time(NULL);
+      ts->tv_nsec = 0;
+    }
+}
+
+static void mem_table_insert(struct mem_inode *inode)
+{
+  struct mem_partition *part = mem_partition_of(inode->id);
+
+  pthread_rwlock_wrlock(&part->lock);
+  avltree_insert(&inode->node, &part->inodes);
+  pthread_rwlock_unlock(&part->lock);
+}
+
+/**
+ * mem_store_init:
+ * Creates the table and the root directory of the store.
+ *
+ * \return 0 or an errno.
+ */
+int mem_store_init(void)
+{
+  struct mem_inode *root;
+  fsal_status_t status;
+  int i, rc;
+
+  for(i = 0; i < MEM_PARTITIONS; i++)
+    {
+      rc = pthread_rwlock_init(&mem_table[i].lock, NULL);
+      if(rc != 0)
+        return rc;
+      avltree_init(&mem_table[i].inodes, mem_inode_cmp, 0);
+    }
+
+  /* Handles from an earlier run of the server must come out stale */
+  mem_generation = (uint32_t) time(NULL);
+
+  status = mem_inode_new(NULL, S_IFDIR | 0755, 0, NULL, &root);
+  if(FSAL_IS_ERROR(status))
+    return ENOMEM;
+
+  /* The root is its own parent, and never unlinked */
+  mem_inode_put(root);
+
+  return 0;
+}
+
+uint32_t mem_store_generation(void)
+{
+  return mem_generation;
+}
+
+/**
+ * mem_inode_get:
+ * Finds an inode by number and takes a reference on it.
+ *
+ * \return The inode, or NULL if there is none (anymore).
+ */
+struct mem_inode *mem_inode_get(uint64_t id)
+{
+  struct mem_partition *part = mem_partition_of(id);
+  struct mem_inode key;
+  struct avltree_node *node;
+  struct mem_inode *inode = NULL;
+
+  key.id = id;
+
+  pthread_rwlock_rdlock(&part->lock);
+  node = avltree_lookup(&key.node, &part->inodes);
+  if(node != NULL)
+    {
+      inode = avltree_container_of(node, struct mem_inode, node);
+      atomic_inc_uint32_t(&inode->refcount);
+    }
+  pthread_rwlock_unlock(&part->lock);
+
+  return inode;
+}
+
+/**
+ * mem_inode_put:
+ * Releases a reference on an inode, freeing the inode with the last.
+ */
+void mem_inode_put(struct mem_inode *inode)
+{
+  struct avltree_node *node;
+  struct glist_head *glist, *glistn;
+  uint64_t pages = 0;
+
+  if(atomic_dec_uint32_t(&inode->refcount) != 0)
+    return;
+
+  while((node = avltree_first(&inode->pages)) != NULL)
+    {
+      avltree_remove(node, &inode->pages);
+      gsh_free(avltree_container_of(node, struct mem_page, node));
+      pages++;
+    }
+  if(pages != 0)
+    atomic_sub_uint64_t(&mem_bytes_used, pages * MEM_PAGE_SIZE);
+
+  /* A directory is only unlinked empty, but the names of a directory
+   * that never made it into the namespace are freed all the same */
+  while((node = avltree_first(&inode->names)) != NULL)
+    {
+      struct mem_dirent *dirent =
+          avltree_container_of(node, struct mem_dirent, node_name);
+
+      avltree_remove(&dirent->node_name, &inode->names);
+      avltree_remove(&dirent->node_cookie, &inode->cookies);
+      gsh_free(dirent);
+    }
+
+  glist_for_each_safe(glist, glistn, &inode->locks)
+    {
+      glist_del(glist);
+      gsh_free(glist_entry(glist, struct mem_lock, list));
+    }
+
+  if(inode->link != NULL)
+    gsh_free(inode->link);
+
+  pthread_rwlock_destroy(&inode->lock);
+  gsh_free(inode);
+
+  atomic_dec_uint64_t(&mem_files_used);
+}
+
+/**
+ * mem_handle_to_inode:
+ * Finds the inode a handle stands for and takes a reference on it.
+ *
+ * \return ERR_FSAL_STALE if the object was removed, or if the handle
+ *         comes from an earlier run of the server.
+ */
+fsal_status_t mem_handle_to_inode(fsal_handle_t * p_handle,
+                                  struct mem_inode **pp_inode)
+{
+  memfsal_handle_t *p_mem_handle = (memfsal_handle_t *) p_handle;
+
+  if(p_mem_handle->data.generation != mem_generation)
+    ReturnCode(ERR_FSAL_STALE, 0);
+
+  *pp_inode = mem_inode_get(p_mem_handle->data.id);
+  if(*pp_inode == NULL)
+    ReturnCode(ERR_FSAL_STALE, 0);
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+void mem_inode_to_handle(struct mem_inode *inode, fsal_handle_t * p_handle)
+{
+  memfsal_handle_t *p_mem_handle = (memfsal_handle_t *) p_handle;
+
+  memset(p_mem_handle, 0, sizeof(memfsal_handle_t));
+  p_mem_handle->data.id = inode->id;
+  p_mem_handle->data.generation = mem_generation;
+  p_mem_handle->data.type = posix2fsal_type(inode->attrs.st_mode);
+}
+
+/**
+ * mem_inode_new:
+ * Creates an inode, owned by the credential of the context.
+ *
+ * The new inode has one link (two for a directory) that the caller
+ * is expected to make, with the parent directory write locked.
+ *
+ * \param p_context (input):
+ *        The credential to own the inode, NULL for root.
+ * \param mode (input):
+ *        Type and permissions of the inode.
+ * \param rdev (input):
+ *        Device of a special file.
+ * \param parent (input):
+ *        The directory to link the inode in, NULL for the root.
+ * \param pp_inode (output):
+ *        The new inode, referenced.
+ *
+ * \return ERR_FSAL_NOSPC past Max_Files, ERR_FSAL_NOMEM.
+ */
+fsal_status_t mem_inode_new(fsal_op_context_t * p_context, mode_t mode,
+                            dev_t rdev, struct mem_inode *parent,
+                            struct mem_inode **pp_inode)
+{
+  memfsal_op_context_t *mem_context = (memfsal_op_context_t *) p_context;
+  struct mem_inode *inode;
+  uint64_t files;
+
+  files = atomic_inc_uint64_t(&mem_files_used);
+  if(global_mem_info.max_files != 0 && files > global_mem_info.max_files)
+    {
+      atomic_dec_uint64_t(&mem_files_used);
+      ReturnCode(ERR_FSAL_NOSPC, ENOSPC);
+    }
+
+  inode = gsh_calloc(1, sizeof(struct mem_inode));
+  if(inode == NULL)
+    {
+      atomic_dec_uint64_t(&mem_files_used);
+      ReturnCode(ERR_FSAL_NOMEM, ENOMEM);
+    }
+
+  if(pthread_rwlock_init(&inode->lock, NULL) != 0)
+    {
+      gsh_free(inode);
+      atomic_dec_uint64_t(&mem_files_used);
+      ReturnCode(ERR_FSAL_NOMEM, ENOMEM);
+    }
+
+  inode->id = atomic_inc_uint64_t(&mem_next_id);
+  inode->refcount = 2;          /* the table's and the caller's */
+  avltree_init(&inode->pages, mem_page_cmp, 0);
+  avltree_init(&inode->names, mem_name_cmp, 0);
+  avltree_init(&inode->cookies, mem_cookie_cmp, 0);
+  init_glist(&inode->locks);
+
+  /* Cookies 1 and 2 would stand for "." and ".." */
+  inode->next_cookie = 3;
+  inode->parent = parent != NULL ? parent->id : inode->id;
+
+  inode->attrs.st_ino = inode->id;
+  inode->attrs.st_mode = mode;
+  inode->attrs.st_nlink = S_ISDIR(mode) ? 2 : 1;
+  inode->attrs.st_rdev = rdev;
+  inode->attrs.st_blksize = MEM_PAGE_SIZE;
+  if(mem_context != NULL)
+    {
+      inode->attrs.st_uid = mem_context->credential.user;
+      inode->attrs.st_gid = mem_context->credential.group;
+    }
+
+  /* BSD group semantics under a set-group-ID directory */
+  if(parent != NULL && (parent->attrs.st_mode & S_ISGID))
+    {
+      inode->attrs.st_gid = parent->attrs.st_gid;
+      if(S_ISDIR(mode))
+        inode->attrs.st_mode |= S_ISGID;
+    }
+
+  mem_now(&inode->attrs.st_atim);
+  inode->attrs.st_mtim = inode->attrs.st_atim;
+  inode->attrs.st_ctim = inode->attrs.st_atim;
+  inode->change = 1;
+
+  mem_table_insert(inode);
+
+  *pp_inode = inode;
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+/**
+ * mem_inode_unlinked:
+ * Removes an inode that lost its last link from the table, and drops
+ * the reference of the table.  The caller still holds one.
+ */
+void mem_inode_unlinked(struct mem_inode *inode)
+{
+  struct mem_partition *part = mem_partition_of(inode->id);
+
+  pthread_rwlock_wrlock(&part->lock);
+  avltree_remove(&inode->node, &part->inodes);
+  pthread_rwlock_unlock(&part->lock);
+
+  mem_inode_put(inode);
+}
+
+/**
+ * mem_inode_touch:
+ * Records a change of an inode, of its data as well if mtime is set.
+ * The inode is write locked.
+ */
+void mem_inode_touch(struct mem_inode *inode, int mtime)
+{
+  mem_now(&inode->attrs.st_ctim);
+  if(mtime)
+    inode->attrs.st_mtim = inode->attrs.st_ctim;
+  inode->change++;
+}
+
+/**
+ * mem_dir_lookup:
+ * Finds a name in a directory that is locked.
+ *
+ * \return The entry, or NULL.
+ */
+struct mem_dirent *mem_dir_lookup(struct mem_inode *dir, const char *name)
+{
+  char buf[sizeof(struct mem_dirent) + FSAL_MAX_NAME_LEN + 1];
+  struct mem_dirent *key = (struct mem_dirent *) buf;
+  struct avltree_node *node;
+
+  if(strlen(name) > FSAL_MAX_NAME_LEN)
+    return NULL;
+  strcpy(key->name, name);
+
+  node = avltree_lookup(&key->node_name, &dir->names);
+  if(node == NULL)
+    return NULL;
+
+  return avltree_container_of(node, struct mem_dirent, node_name);
+}
+
+/**
+ * mem_dir_add:
+ * Links an inode under a name in a directory that is write locked.
+ * The link count of the inode is for the caller to update.
+ *
+ * \return ERR_FSAL_EXIST if the name is taken.
+ */
+fsal_status_t mem_dir_add(struct mem_inode *dir, const char *name,
+                          struct mem_inode *inode)
+{
+  struct mem_dirent *dirent;
+  size_t len = strlen(name);
+
+  dirent = gsh_malloc(sizeof(struct mem_dirent) + len + 1);
+  if(dirent == NULL)
+    ReturnCode(ERR_FSAL_NOMEM, ENOMEM);
+
+  memcpy(dirent->name, name, len + 1);
+  dirent->id = inode->id;
+  dirent->is_dir = S_ISDIR(inode->attrs.st_mode);
+
+  if(avltree_insert(&dirent->node_name, &dir->names) != NULL)
+    {
+      gsh_free(dirent);
+      ReturnCode(ERR_FSAL_EXIST, EEXIST);
+    }
+
+  dirent->cookie = dir->next_cookie++;
+  avltree_insert(&dirent->node_cookie, &dir->cookies);
+
+  if(dirent->is_dir)
+    dir->attrs.st_nlink++;
+  dir->attrs.st_size += MEM_DIRENT_SIZE;
+  mem_inode_touch(dir, TRUE);
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+/**
+ * mem_dir_remove:
+ * Removes an entry from a directory that is write locked.  The link
+ * count of the inode it named is for the caller to update.
+ */
+void mem_dir_remove(struct mem_inode *dir, struct mem_dirent *dirent)
+{
+  avltree_remove(&dirent->node_name, &dir->names);
+  avltree_remove(&dirent->node_cookie, &dir->cookies);
+
+  if(dirent->is_dir)
+    dir->attrs.st_nlink--;
+  dir->attrs.st_size -= MEM_DIRENT_SIZE;
+  mem_inode_touch(dir, TRUE);
+
+  gsh_free(dirent);
+}
+
+/**
+ * mem_dir_next:
+ * Finds the entry that follows a cookie in a directory that is
+ * locked.  Cookies only grow, so an entry removed between two calls
+ * does not make the next one skip or repeat entries.
+ *
+ * \return The entry, or NULL at the end of the directory.
+ */
+struct mem_dirent *mem_dir_next(struct mem_inode *dir, uint64_t cookie)
+{
+  struct avltree_node *node = dir->cookies.root;
+  struct mem_dirent *next = NULL;
+
+  while(node != NULL)
+    {
+      struct mem_dirent *dirent =
+          avltree_container_of(node, struct mem_dirent, node_cookie);
+
+      if(dirent->cookie > cookie)
+        {
+          next = dirent;
+          node = node->left;
+        }
+      else
+        node = node->right;
+    }
+
+  return next;
+}
+
+int mem_dir_is_empty(struct mem_inode *dir)
+{
+  return avltree_first(&dir->names) == NULL;
+}
+
+/**
+ * mem_dir_is_ancestor:
+ * Tells whether a directory is, or is under, another one.  The
+ * caller holds mem_rename_mutex, so that no directory moves meanwhile.
+ */
+int mem_dir_is_ancestor(uint64_t ancestor, struct mem_inode *dir)
+{
+  uint64_t id = dir->id;
+
+  while(id != ancestor)
+    {
+      struct mem_inode *inode;
+      uint64_t parent;
+
+      if(id == MEM_ROOT_ID)
+        return FALSE;
+
+      inode = mem_inode_get(id);
+      if(inode == NULL)
+        return FALSE;
+      parent = inode->parent;
+      mem_inode_put(inode);
+
+      id = parent;
+    }
+
+  return TRUE;
+}
+
+static struct mem_page *mem_page_lookup(struct mem_inode *inode, uint64_t index)
+{
+  struct mem_page key;
+  struct avltree_node *node;
+
+  key.index = index;
+  node = avltree_lookup(&key.node, &inode->pages);
+  if(node == NULL)
+    return NULL;
+
+  return avltree_container_of(node, struct mem_page, node);
+}
+
+/**
+ * mem_file_read:
+ * Reads from a file that is locked, holes reading as zeroes.
+ *
+ * \return The number of bytes read, short at the end of the file.
+ */
+fsal_size_t mem_file_read(struct mem_inode *inode, uint64_t offset,
+                          fsal_size_t size, caddr_t buffer)
+{
+  uint64_t file_size = inode->attrs.st_size;
+  fsal_size_t done = 0;
+
+  if(offset >= file_size)
+    return 0;
+  if(size > file_size - offset)
+    size = file_size - offset;
+
+  while(done < size)
+    {
+      uint64_t pos = offset + done;
+      size_t in_page = pos % MEM_PAGE_SIZE;
+      size_t len = MEM_PAGE_SIZE - in_page;
+      struct mem_page *page;
+
+      if(len > size - done)
+        len = size - done;
+
+      page = mem_page_lookup(inode, pos / MEM_PAGE_SIZE);
+      if(page != NULL)
+        memcpy(buffer + done, page->data + in_page, len);
+      else
+        memset(buffer + done, 0, len);
+
+      done += len;
+    }
+
+  return size;
+}
+
+/**
+ * mem_file_write:
+ * Writes to a file that is write locked, allocating pages as needed.
+ *
+ * \return ERR_FSAL_NOSPC past Max_Size, ERR_FSAL_FBIG past the
+ *         largest offset.  On error, what was written is kept and
+ *         counted in *p_written.
+ */
+fsal_status_t mem_file_write(struct mem_inode *inode, uint64_t offset,
+                             fsal_size_t size, caddr_t buffer,
+                             fsal_size_t * p_written)
+{
+  fsal_size_t done = 0;
+  int major = ERR_FSAL_NO_ERROR, minor = 0;
+
+  *p_written = 0;
+
+  if(offset + size < offset || offset + size > global_fs_info.maxfilesize)
+    ReturnCode(ERR_FSAL_FBIG, EFBIG);
+
+  while(done < size)
+    {
+      uint64_t pos = offset + done;
+      size_t in_page = pos % MEM_PAGE_SIZE;
+      size_t len = MEM_PAGE_SIZE - in_page;
+      struct mem_page *page;
+
+      if(len > size - done)
+        len = size - done;
+
+      page = mem_page_lookup(inode, pos / MEM_PAGE_SIZE);
+      if(page == NULL)
+        {
+          uint64_t bytes = atomic_add_uint64_t(&mem_bytes_used, MEM_PAGE_SIZE);
+
+          if(global_mem_info.max_size != 0 && bytes > global_mem_info.max_size)
+            {
+              atomic_sub_uint64_t(&mem_bytes_used, MEM_PAGE_SIZE);
+              major = ERR_FSAL_NOSPC;
+              minor = ENOSPC;
+              break;
+            }
+
+          page = gsh_malloc(sizeof(struct mem_page));
+          if(page == NULL)
+            {
+              atomic_sub_uint64_t(&mem_bytes_used, MEM_PAGE_SIZE);
+              major = ERR_FSAL_NOMEM;
+              minor = ENOMEM;
+              break;
+            }
+
+          /* Only the part not about to be written needs zeroing */
+          page->index = pos / MEM_PAGE_SIZE;
+          if(in_page != 0)
+            memset(page->data, 0, in_page);
+          if(in_page + len != MEM_PAGE_SIZE)
+            memset(page->data + in_page + len, 0, MEM_PAGE_SIZE - in_page - len);
+
+          avltree_insert(&page->node, &inode->pages);
+          inode->attrs.st_blocks += MEM_PAGE_SIZE / S_BLKSIZE;
+        }
+
+      memcpy(page->data + in_page, buffer + done, len);
+      done += len;
+    }
+
+  if(done != 0)
+    {
+      if(offset + done > (uint64_t) inode->attrs.st_size)
+        inode->attrs.st_size = offset + done;
+      mem_inode_touch(inode, TRUE);
+    }
+
+  *p_written = done;
+
+  ReturnCode(major, minor);
+}
+
+/**
+ * mem_file_truncate:
+ * Sets the size of a file that is write locked.  The pages past the
+ * new size are freed and the end of the last page is zeroed, so that
+ * growing the file again reads zeroes there.
+ */
+fsal_status_t mem_file_truncate(struct mem_inode *inode, uint64_t size)
+{
+  struct avltree_node *node;
+  struct mem_page *page;
+  uint64_t first_dropped = (size + MEM_PAGE_SIZE - 1) / MEM_PAGE_SIZE;
+  uint64_t pages = 0;
+
+  if(size > global_fs_info.maxfilesize)
+    ReturnCode(ERR_FSAL_FBIG, EFBIG);
+
+  if(size < (uint64_t) inode->attrs.st_size)
+    {
+      while((node = avltree_last(&inode->pages)) != NULL)
+        {
+          page = avltree_container_of(node, struct mem_page, node);
+          if(page->index < first_dropped)
+            break;
+          avltree_remove(node, &inode->pages);
+          gsh_free(page);
+          pages++;
+        }
+
+      if(pages != 0)
+        {
+          atomic_sub_uint64_t(&mem_bytes_used, pages * MEM_PAGE_SIZE);
+          inode->attrs.st_blocks -= pages * (MEM_PAGE_SIZE / S_BLKSIZE);
+        }
+
+      if(size % MEM_PAGE_SIZE != 0)
+        {
+          page = mem_page_lookup(inode, size / MEM_PAGE_SIZE);
+          if(page != NULL)
+            memset(page->data + size % MEM_PAGE_SIZE, 0,
+                   MEM_PAGE_SIZE - size % MEM_PAGE_SIZE);
+        }
+    }
+
+  inode->attrs.st_size = size;
+  mem_inode_touch(inode, TRUE);
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+void mem_store_usage(fsal_u64_t * bytes, fsal_u64_t * files)
+{
+  *bytes = atomic_fetch_uint64_t(&mem_bytes_used);
+  *files = atomic_fetch_uint64_t(&mem_files_used);
+}
@@ -0,0 +1,357 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_internal.c
+ * \brief   Defines the datas that are to be
+ *          accessed as extern by the fsal modules
+ *
+ */
+#define FSAL_INTERNAL_C
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include  "fsal.h"
+#include "fsal_internal.h"
+#include "SemN.h"
+#include "fsal_convert.h"
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include "abstract_mem.h"
+
+/* Below this, a latency is spun rather than slept: a sleep
+ * oversleeps by the timer slack, tens of microseconds */
+#define MEM_LATENCY_SPIN_MAX 100
+
+/* static filesystem info.
+ * The access is thread-safe because
+ * it is read-only, except during initialization.
+ */
+fsal_staticfsinfo_t global_fs_info;
+
+/* FS specific parameters */
+memfs_specific_initinfo_t global_mem_info;
+
+/* filesystem info for MEM */
+static fsal_staticfsinfo_t default_mem_info = {
+  0xFFFFFFFFFFFFFFFFLL,         /* max file size (64bits) */
+  _POSIX_LINK_MAX,              /* max links */
+  FSAL_MAX_NAME_LEN,            /* max filename */
+  FSAL_MAX_PATH_LEN,            /* max pathlen */
+  TRUE,                         /* no_trunc */
+  TRUE,                         /* chown restricted */
+  FALSE,                        /* case insensitivity */
+  TRUE,                         /* case preserving */
+  FSAL_EXPTYPE_PERSISTENT,      /* FH expire type */
+  TRUE,                         /* hard link support */
+  TRUE,                         /* symlink support */
+  TRUE,                         /* lock management */
+  FALSE,                        /* lock owners */
+  FALSE,                        /* async blocking locks */
+  FALSE,                        /* named attributes */
+  TRUE,                         /* handles are unique and persistent */
+  {10, 0},                      /* Duration of lease at FS in seconds */
+  FSAL_ACLSUPPORT_ALLOW,        /* ACL support */
+  TRUE,                         /* can change times */
+  TRUE,                         /* homogenous */
+  MEM_SUPPORTED_ATTRIBUTES,     /* supported attributes */
+  0,                            /* maxread size */
+  0,                            /* maxwrite size */
+  0,                            /* default umask */
+  0,                            /* cross junctions */
+  0400,                         /* default access rights for xattrs: root=RW, owner=R */
+  0,                            /* default access check support in FSAL */
+  0,                            /* default share reservation support in FSAL */
+  0                             /* default share reservation support with open owners in FSAL */
+};
+
+/* variables for limiting the calls to the filesystem */
+static int limit_calls = FALSE;
+semaphore_t sem_fs_calls;
+
+/* threads keys for stats */
+static pthread_key_t key_stats;
+static pthread_once_t once_key = PTHREAD_ONCE_INIT;
+
+/* init keys */
+static void init_keys(void)
+{
+  if(pthread_key_create(&key_stats, NULL) == -1)
+    LogError(COMPONENT_FSAL, ERR_SYS, ERR_PTHREAD_KEY_CREATE, errno);
+
+  return;
+}                               /* init_keys */
+
+/* the per thread statistics, allocated on first use */
+static fsal_statistics_t *fsal_internal_thread_stats(void)
+{
+  fsal_statistics_t *bythread_stat = NULL;
+
+  /* first, we init the keys if this is the first time */
+  if(pthread_once(&once_key, init_keys) != 0)
+    {
+      LogError(COMPONENT_FSAL, ERR_SYS, ERR_PTHREAD_ONCE, errno);
+      return NULL;
+    }
+
+  /* we get the specific value */
+  bythread_stat = (fsal_statistics_t *) pthread_getspecific(key_stats);
+
+  /* we allocate stats if this is the first time */
+  if(bythread_stat == NULL)
+    {
+      bythread_stat = gsh_calloc(1, sizeof(fsal_statistics_t));
+
+      if(bythread_stat == NULL)
+        {
+          LogError(COMPONENT_FSAL, ERR_SYS, ERR_MALLOC, ENOMEM);
+          return NULL;
+        }
+
+      /* set the specific value */
+      pthread_setspecific(key_stats, (void *)bythread_stat);
+    }
+
+  return bythread_stat;
+}
+
+/**
+ * fsal_increment_nbcall:
+ * Updates fonction call statistics.
+ *
+ * \param function_index (input):
+ *        Index of the function whom number of call is to be incremented.
+ * \param status (input):
+ *        Status the function returned.
+ *
+ * \return Nothing.
+ */
+void fsal_increment_nbcall(int function_index, fsal_status_t status)
+{
+  fsal_statistics_t *bythread_stat = NULL;
+
+  /* verify index */
+
+  if(function_index >= FSAL_NB_FUNC)
+    return;
+
+  bythread_stat = fsal_internal_thread_stats();
+  if(bythread_stat == NULL)
+    return;
+
+  /* we increment the values */
+
+  bythread_stat->func_stats.nb_call[function_index]++;
+
+  if(!FSAL_IS_ERROR(status))
+    bythread_stat->func_stats.nb_success[function_index]++;
+  else if(status.major == ERR_FSAL_DELAY)       /* Error is retryable */
+    bythread_stat->func_stats.nb_err_retryable[function_index]++;
+  else
+    bythread_stat->func_stats.nb_err_unrecover[function_index]++;
+
+  return;
+}
+
+/**
+ * fsal_internal_getstats:
+ * (For internal use in the FSAL).
+ * Retrieve call statistics for current thread.
+ *
+ * \param output_stats (output):
+ *        Pointer to the call statistics structure.
+ *
+ * \return Nothing.
+ */
+void fsal_internal_getstats(fsal_statistics_t * output_stats)
+{
+  fsal_statistics_t *bythread_stat = NULL;
+
+  bythread_stat = fsal_internal_thread_stats();
+
+  if(output_stats && bythread_stat)
+    (*output_stats) = (*bythread_stat);
+
+  return;
+}
+
+/**
+ *  Used to limit the number of simultaneous calls to Filesystem.
+ */
+void TakeTokenFSCall()
+{
+  /* no limits */
+  if(limit_calls == FALSE)
+    return;
+
+  /* there is a limit */
+  semaphore_P(&sem_fs_calls);
+
+}
+
+void ReleaseTokenFSCall()
+{
+  /* no limits */
+  if(limit_calls == FALSE)
+    return;
+
+  /* there is a limit */
+  semaphore_V(&sem_fs_calls);
+
+}
+
+/**
+ * mem_latency:
+ * Delays the calling worker by the latency configured for a class of
+ * operations, as a filesystem of that speed would.  Short latencies
+ * are spun on the clock, so that they are kept to the microsecond.
+ */
+void mem_latency(mem_latency_class_t latency_class)
+{
+  unsigned int usec;
+  struct timespec start, now, ts;
+
+  switch (latency_class)
+    {
+    case MEM_LATENCY_METADATA:
+      usec = global_mem_info.metadata_latency;
+      break;
+    case MEM_LATENCY_READ:
+      usec = global_mem_info.read_latency;
+      break;
+    case MEM_LATENCY_WRITE:
+      usec = global_mem_info.write_latency;
+      break;
+    case MEM_LATENCY_COMMIT:
+      usec = global_mem_info.commit_latency;
+      break;
+    default:
+      usec = 0;
+    }
+
+  if(usec == 0)
+    return;
+
+  if(usec > MEM_LATENCY_SPIN_MAX)
+    {
+      ts.tv_sec = usec / 1000000;
+      ts.tv_nsec = (usec % 1000000) * 1000;
+      while(nanosleep(&ts, &ts) != 0 && errno == EINTR) ;
+      return;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  do
+    clock_gettime(CLOCK_MONOTONIC, &now);
+  while((now.tv_sec - start.tv_sec) * 1000000 +
+        (now.tv_nsec - start.tv_nsec) / 1000 < (long)usec);
+}
+
+/*
+ *  This function initializes shared variables of the fsal.
+ */
+fsal_status_t fsal_internal_init_global(fsal_init_info_t * fsal_info,
+                                        fs_common_initinfo_t * fs_common_info,
+                                        fs_specific_initinfo_t * fs_specific_info)
+{
+  int rc;
+
+  /* sanity check */
+  if(!fsal_info || !fs_common_info || !fs_specific_info)
+    ReturnCode(ERR_FSAL_FAULT, 0);
+
+  /* inits FS call semaphore */
+  if(fsal_info->max_fs_calls > 0)
+    {
+      limit_calls = TRUE;
+
+      rc = semaphore_init(&sem_fs_calls, fsal_info->max_fs_calls);
+
+      if(rc != 0)
+        ReturnCode(ERR_FSAL_SERVERFAULT, rc);
+
+      LogDebug(COMPONENT_FSAL,
+                        "FSAL INIT: Max simultaneous calls to filesystem is limited to %u.",
+                        fsal_info->max_fs_calls);
+
+    }
+  else
+    {
+      LogDebug(COMPONENT_FSAL,
+                        "FSAL INIT: Max simultaneous calls to filesystem is unlimited.");
+    }
+
+  /* setting default values. */
+  global_fs_info = default_mem_info;
+
+  display_fsinfo(&default_mem_info);
+
+  /* Analyzing fs_common_info struct */
+
+  if((fs_common_info->behaviors.maxfilesize != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.maxlink != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.maxnamelen != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.maxpathlen != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.no_trunc != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.case_insensitive != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.case_preserving != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.named_attr != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.lease_time != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.supported_attrs != FSAL_INIT_FS_DEFAULT) ||
+     (fs_common_info->behaviors.homogenous != FSAL_INIT_FS_DEFAULT))
+    ReturnCode(ERR_FSAL_NOTSUPP, 0);
+
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, symlink_support);
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, link_support);
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, lock_support);
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, lock_support_owner);
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, lock_support_async_block);
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, cansettime);
+
+  SET_INTEGER_PARAM(global_fs_info, fs_common_info, maxread);
+  SET_INTEGER_PARAM(global_fs_info, fs_common_info, maxwrite);
+
+  SET_BITMAP_PARAM(global_fs_info, fs_common_info, umask);
+
+  SET_BOOLEAN_PARAM(global_fs_info, fs_common_info, auth_exportpath_xdev);
+
+  SET_BITMAP_PARAM(global_fs_info, fs_common_info, xattr_access_rights);
+
+  LogDebug(COMPONENT_FSAL,
+                    "FSAL INIT: Supported attributes mask = 0x%llX.",
+                    global_fs_info.supported_attrs);
+
+  global_mem_info = *fs_specific_info;
+
+  LogInfo(COMPONENT_FSAL,
+          "FSAL INIT: MEM latencies (usec): metadata %u, read %u, write %u, commit %u",
+          global_mem_info.metadata_latency, global_mem_info.read_latency,
+          global_mem_info.write_latency, global_mem_info.commit_latency);
+
+  rc = mem_store_init();
+  if(rc != 0)
+    ReturnCode(ERR_FSAL_SERVERFAULT, rc);
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
@@ -0,0 +1,479 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ *
+ * \file    fsal_internal.h
+ * \brief   Extern definitions for variables that are
+ *          defined in fsal_internal.c, and the in-memory store.
+ *
+ */
+
+#include "fsal.h"
+#include <sys/stat.h>
+#include <pthread.h>
+#include "avltree.h"
+#include "nlm_list.h"
+#include "FSAL/common_functions.h"
+
+/* defined the set of attributes supported with POSIX */
+#define MEM_SUPPORTED_ATTRIBUTES (                                       \
+          FSAL_ATTR_SUPPATTR | FSAL_ATTR_TYPE     | FSAL_ATTR_SIZE      | \
+          FSAL_ATTR_FSID     |  FSAL_ATTR_FILEID  | \
+          FSAL_ATTR_MODE     | FSAL_ATTR_NUMLINKS | FSAL_ATTR_OWNER     | \
+          FSAL_ATTR_GROUP    | FSAL_ATTR_ATIME    | FSAL_ATTR_RAWDEV    | \
+          FSAL_ATTR_CTIME    | FSAL_ATTR_MTIME    | FSAL_ATTR_SPACEUSED | \
+          FSAL_ATTR_CHGTIME  )
+
+/* the following variables must not be defined in fsal_internal.c */
+#ifndef FSAL_INTERNAL_C
+
+/* static filesystem info.
+ * read access only.
+ */
+extern fsal_staticfsinfo_t global_fs_info;
+
+/* FS specific parameters, read only after initialization. */
+extern memfs_specific_initinfo_t global_mem_info;
+
+#endif
+
+/**
+ *  This function initializes shared variables of the FSAL.
+ */
+fsal_status_t fsal_internal_init_global(fsal_init_info_t * fsal_info,
+                                        fs_common_initinfo_t * fs_common_info,
+                                        fs_specific_initinfo_t * fs_specific_info);
+
+/**
+ *  Increments the number of calls for a function.
+ */
+void fsal_increment_nbcall(int function_index, fsal_status_t status);
+
+/**
+ * Retrieves current thread statistics.
+ */
+void fsal_internal_getstats(fsal_statistics_t * output_stats);
+
+/**
+ *  Used to limit the number of simultaneous calls to Filesystem.
+ */
+void TakeTokenFSCall();
+void ReleaseTokenFSCall();
+
+/**
+ * Artificial latency, so that the FSAL can stand for a slower
+ * filesystem in a benchmark.
+ */
+typedef enum mem_latency_class
+{
+  MEM_LATENCY_METADATA,
+  MEM_LATENCY_READ,
+  MEM_LATENCY_WRITE,
+  MEM_LATENCY_COMMIT
+} mem_latency_class_t;
+
+void mem_latency(mem_latency_class_t latency_class);
+
+/*
+ * The in-memory store (fsal_inode.c).
+ *
+ * Objects are found by inode number in a partitioned table; a handle
+ * is the inode number and the generation of the store, so handles do
+ * not survive a restart of the server.  Each inode has a read/write
+ * lock protecting everything in it.  Locks are taken from a directory
+ * to its entries, never the other way around; renames across
+ * directories are serialized by one mutex, as in Linux, so that the
+ * ancestry of the two directories cannot change under them.
+ */
+
+#define MEM_PAGE_SIZE 4096
+#define MEM_ROOT_ID 1
+
+struct mem_page
+{
+  struct avltree_node node;     /* in mem_inode.pages, by index */
+  uint64_t index;
+  char data[MEM_PAGE_SIZE];
+};
+
+struct mem_dirent
+{
+  struct avltree_node node_name;        /* in mem_inode.names */
+  struct avltree_node node_cookie;      /* in mem_inode.cookies */
+  uint64_t cookie;
+  uint64_t id;                  /* inode of the entry */
+  int is_dir;                   /* its ".." links to the directory */
+  char name[];
+};
+
+struct mem_lock
+{
+  struct glist_head list;       /* in mem_inode.locks */
+  void *owner;
+  fsal_lock_t type;
+  uint64_t start;
+  uint64_t end;                 /* last byte, UINT64_MAX for EOF */
+};
+
+struct mem_inode
+{
+  struct avltree_node node;     /* in its table partition */
+  uint64_t id;
+  uint32_t refcount;            /* the table holds one while linked */
+  pthread_rwlock_t lock;
+  struct stat attrs;
+  uint64_t change;              /* bumped on every change */
+
+  /* regular files */
+  struct avltree pages;
+  uint32_t opens;
+  struct glist_head locks;
+
+  /* symbolic links */
+  char *link;
+
+  /* directories */
+  struct avltree names;
+  struct avltree cookies;
+  uint64_t next_cookie;
+  uint64_t parent;              /* changed with the rename mutex held */
+};
+
+int mem_store_init(void);
+uint32_t mem_store_generation(void);
+
+struct mem_inode *mem_inode_get(uint64_t id);
+void mem_inode_put(struct mem_inode *inode);
+fsal_status_t mem_handle_to_inode(fsal_handle_t * p_handle,
+                                  struct mem_inode **pp_inode);
+void mem_inode_to_handle(struct mem_inode *inode, fsal_handle_t * p_handle);
+
+fsal_status_t mem_inode_new(fsal_op_context_t * p_context, mode_t mode,
+                            dev_t rdev, struct mem_inode *parent,
+                            struct mem_inode **pp_inode);
+void mem_inode_unlinked(struct mem_inode *inode);
+
+void mem_inode_touch(struct mem_inode *inode, int mtime);
+
+struct mem_dirent *mem_dir_lookup(struct mem_inode *dir, const char *name);
+fsal_status_t mem_dir_add(struct mem_inode *dir, const char *name,
+                          struct mem_inode *inode);
+void mem_dir_remove(struct mem_inode *dir, struct mem_dirent *dirent);
+struct mem_dirent *mem_dir_next(struct mem_inode *dir, uint64_t cookie);
+int mem_dir_is_empty(struct mem_inode *dir);
+fsal_status_t mem_dir_unlink(fsal_op_context_t * p_context,
+                             struct mem_inode *dir, struct mem_dirent *dirent);
+
+fsal_status_t mem_create_node(fsal_handle_t * p_parent_directory_handle,
+                              fsal_name_t * p_name,
+                              fsal_op_context_t * p_context,
+                              mode_t unix_mode, dev_t rdev,
+                              const char *link_content,
+                              fsal_handle_t * p_object_handle,
+                              fsal_attrib_list_t * p_object_attributes);
+
+fsal_status_t mem_walk_path(const char *path, int create,
+                            struct mem_inode **pp_inode);
+
+extern pthread_mutex_t mem_rename_mutex;
+int mem_dir_is_ancestor(uint64_t ancestor, struct mem_inode *dir);
+
+fsal_size_t mem_file_read(struct mem_inode *inode, uint64_t offset,
+                          fsal_size_t size, caddr_t buffer);
+fsal_status_t mem_file_write(struct mem_inode *inode, uint64_t offset,
+                             fsal_size_t size, caddr_t buffer,
+                             fsal_size_t * p_written);
+fsal_status_t mem_file_truncate(struct mem_inode *inode, uint64_t size);
+
+void mem_store_usage(fsal_u64_t * bytes, fsal_u64_t * files);
+
+/**
+ * Conversions (fsal_convert.c).
+ */
+fsal_status_t mem2fsal_attributes(struct mem_inode *inode,
+                                  fsal_attrib_list_t * p_fsalattr_out);
+
+fsal_status_t mem_getattrs_locked(struct mem_inode *inode,
+                                  fsal_attrib_list_t * p_object_attributes);
+
+/* All the call to FSAL to be wrapped */
+fsal_status_t MEMFSAL_access(fsal_handle_t * p_object_handle,        /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_accessflags_t access_type,    /* IN */
+                             fsal_attrib_list_t * p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_getattrs(fsal_handle_t * p_filehandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * p_object_attributes /* IN/OUT */ );
+
+fsal_status_t MEMFSAL_getattrs_descriptor(fsal_file_t * p_file_descriptor,     /* IN */
+                                          fsal_handle_t * p_filehandle,        /* IN */
+                                          fsal_op_context_t * p_context,       /* IN */
+                                          fsal_attrib_list_t * p_object_attributes /* IN/OUT */ );
+
+fsal_status_t MEMFSAL_setattrs(fsal_handle_t * p_filehandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_attrib_list_t * p_attrib_set,       /* IN */
+                               fsal_attrib_list_t *
+                               p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_BuildExportContext(fsal_export_context_t * p_export_context,   /* OUT */
+                                         fsal_path_t * p_export_path,   /* IN */
+                                         char *fs_specific_options /* IN */ );
+
+fsal_status_t MEMFSAL_create(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_filename,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_accessmode_t accessmode,      /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT */
+                             fsal_attrib_list_t * p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_mkdir(fsal_handle_t * p_parent_directory_handle,       /* IN */
+                            fsal_name_t * p_dirname,    /* IN */
+                            fsal_op_context_t * p_context,   /* IN */
+                            fsal_accessmode_t accessmode,       /* IN */
+                            fsal_handle_t * p_object_handle, /* OUT */
+                            fsal_attrib_list_t * p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_link(fsal_handle_t * p_target_handle,  /* IN */
+                           fsal_handle_t * p_dir_handle,     /* IN */
+                           fsal_name_t * p_link_name,   /* IN */
+                           fsal_op_context_t * p_context,    /* IN */
+                           fsal_attrib_list_t * p_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_mknode(fsal_handle_t * parentdir_handle,       /* IN */
+                             fsal_name_t * p_node_name, /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_accessmode_t accessmode,      /* IN */
+                             fsal_nodetype_t nodetype,  /* IN */
+                             fsal_dev_t * dev,  /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT (handle to the created node) */
+                             fsal_attrib_list_t * node_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_opendir(fsal_handle_t * p_dir_handle,  /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_dir_t * p_dir_descriptor, /* OUT */
+                              fsal_attrib_list_t * p_dir_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_readdir(fsal_dir_t * p_dir_descriptor, /* IN */
+                              fsal_cookie_t start_position,  /* IN */
+                              fsal_attrib_mask_t get_attr_mask, /* IN */
+                              fsal_mdsize_t buffersize, /* IN */
+                              fsal_dirent_t * p_pdirent,        /* OUT */
+                              fsal_cookie_t * p_end_position,        /* OUT */
+                              fsal_count_t * p_nb_entries,      /* OUT */
+                              fsal_boolean_t * p_end_of_dir /* OUT */ );
+
+fsal_status_t MEMFSAL_closedir(fsal_dir_t * p_dir_descriptor /* IN */ );
+
+fsal_status_t MEMFSAL_open_by_name(fsal_handle_t * dirhandle,        /* IN */
+                                   fsal_name_t * filename,      /* IN */
+                                   fsal_op_context_t * p_context,    /* IN */
+                                   fsal_openflags_t openflags,  /* IN */
+                                   fsal_file_t * file_descriptor,    /* OUT */
+                                   fsal_attrib_list_t *
+                                   file_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_open(fsal_handle_t * p_filehandle,     /* IN */
+                           fsal_op_context_t * p_context,    /* IN */
+                           fsal_openflags_t openflags,  /* IN */
+                           fsal_file_t * p_file_descriptor,  /* OUT */
+                           fsal_attrib_list_t * p_file_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_read(fsal_file_t * p_file_descriptor,  /* IN */
+                           fsal_seek_t * p_seek_descriptor,     /* [IN] */
+                           fsal_size_t buffer_size,     /* IN */
+                           caddr_t buffer,      /* OUT */
+                           fsal_size_t * p_read_amount, /* OUT */
+                           fsal_boolean_t * p_end_of_file /* OUT */ );
+
+fsal_status_t MEMFSAL_write(fsal_file_t * p_file_descriptor, /* IN */
+                            fsal_op_context_t * p_context,   /* IN */
+                            fsal_seek_t * p_seek_descriptor,    /* IN */
+                            fsal_size_t buffer_size,    /* IN */
+                            caddr_t buffer,     /* IN */
+                            fsal_size_t * p_write_amount /* OUT */ );
+
+fsal_status_t MEMFSAL_close(fsal_file_t * p_file_descriptor /* IN */ );
+
+fsal_status_t MEMFSAL_dynamic_fsinfo(fsal_handle_t * p_filehandle,   /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_dynamicfsinfo_t * p_dynamicinfo /* OUT */ );
+
+fsal_status_t MEMFSAL_Init(fsal_parameter_t * init_info /* IN */ );
+
+fsal_status_t MEMFSAL_test_access(fsal_op_context_t * p_context,     /* IN */
+                                  fsal_accessflags_t access_type,       /* IN */
+                                  fsal_attrib_list_t * p_object_attributes /* IN */ );
+
+fsal_status_t MEMFSAL_lookup(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_filename,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT */
+                             fsal_attrib_list_t * p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_lookupPath(fsal_path_t * p_path,  /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_handle_t * object_handle,      /* OUT */
+                                 fsal_attrib_list_t *
+                                 p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_lookupJunction(fsal_handle_t * p_junction_handle,      /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_handle_t * p_fsoot_handle, /* OUT */
+                                     fsal_attrib_list_t *
+                                     p_fsroot_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_lock_op( fsal_file_t           * p_file_descriptor,   /* IN */
+                               fsal_handle_t         * p_filehandle,        /* IN */
+                               fsal_op_context_t     * p_context,           /* IN */
+                               void                  * p_owner,             /* IN */
+                               fsal_lock_op_t          lock_op,             /* IN */
+                               fsal_lock_param_t       request_lock,        /* IN */
+                               fsal_lock_param_t     * conflicting_lock     /* OUT */ );
+
+fsal_status_t MEMFSAL_rcp(fsal_handle_t * filehandle,        /* IN */
+                          fsal_op_context_t * p_context,     /* IN */
+                          fsal_path_t * p_local_path,   /* IN */
+                          fsal_rcpflag_t transfer_opt /* IN */ );
+
+fsal_status_t MEMFSAL_rename(fsal_handle_t * p_old_parentdir_handle, /* IN */
+                             fsal_name_t * p_old_name,  /* IN */
+                             fsal_handle_t * p_new_parentdir_handle, /* IN */
+                             fsal_name_t * p_new_name,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t * p_src_dir_attributes, /* [ IN/OUT ] */
+                             fsal_attrib_list_t * p_tgt_dir_attributes /* [ IN/OUT ] */ );
+
+void MEMFSAL_get_stats(fsal_statistics_t * stats,       /* OUT */
+                       fsal_boolean_t reset /* IN */ );
+
+fsal_status_t MEMFSAL_readlink(fsal_handle_t * p_linkhandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_path_t * p_link_content,    /* OUT */
+                               fsal_attrib_list_t * p_link_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_symlink(fsal_handle_t * p_parent_directory_handle,     /* IN */
+                              fsal_name_t * p_linkname, /* IN */
+                              fsal_path_t * p_linkcontent,      /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_accessmode_t accessmode,     /* IN (ignored) */
+                              fsal_handle_t * p_link_handle, /* OUT */
+                              fsal_attrib_list_t * p_link_attributes /* [ IN/OUT ] */ );
+
+int MEMFSAL_handlecmp(fsal_handle_t * handle1, fsal_handle_t * handle2,
+                      fsal_status_t * status);
+
+unsigned int MEMFSAL_Handle_to_HashIndex(fsal_handle_t * p_handle,
+                                         unsigned int cookie,
+                                         unsigned int alphabet_len,
+                                         unsigned int index_size);
+
+unsigned int MEMFSAL_Handle_to_RBTIndex(fsal_handle_t * p_handle, unsigned int cookie);
+
+fsal_status_t MEMFSAL_DigestHandle(fsal_export_context_t * p_expcontext,     /* IN */
+                                   fsal_digesttype_t output_type,       /* IN */
+                                   fsal_handle_t * p_in_fsal_handle, /* IN */
+                                   struct fsal_handle_desc *fh_desc /* OUT */ );
+
+fsal_status_t MEMFSAL_ExpandHandle(fsal_export_context_t * p_expcontext,     /* IN */
+                                   fsal_digesttype_t in_type,   /* IN */
+                                   struct fsal_handle_desc *fh_desc     /* IN OUT */ );
+
+fsal_status_t MEMFSAL_SetDefault_FS_specific_parameter(fsal_parameter_t * out_parameter);
+
+fsal_status_t MEMFSAL_load_FS_specific_parameter_from_conf(config_file_t in_config,
+                                                           fsal_parameter_t *
+                                                           out_parameter);
+
+fsal_status_t MEMFSAL_truncate(fsal_handle_t * p_filehandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_size_t length,      /* IN */
+                               fsal_file_t * file_descriptor,        /* Unused in this FSAL */
+                               fsal_attrib_list_t *
+                               p_object_attributes /* [ IN/OUT ] */ );
+
+fsal_status_t MEMFSAL_unlink(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_object_name,       /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t *
+                             p_parent_directory_attributes /* [IN/OUT ] */ );
+
+char *MEMFSAL_GetFSName();
+
+fsal_status_t MEMFSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,  /* IN */
+                                    fsal_op_context_t * p_context,   /* IN */
+                                    unsigned int xattr_id,      /* IN */
+                                    fsal_attrib_list_t * p_attrs);
+
+fsal_status_t MEMFSAL_ListXAttrs(fsal_handle_t * p_objecthandle,     /* IN */
+                                 unsigned int cookie,   /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_xattrent_t * xattrs_tab,  /* IN/OUT */
+                                 unsigned int xattrs_tabsize,   /* IN */
+                                 unsigned int *p_nb_returned,   /* OUT */
+                                 int *end_of_list /* OUT */ );
+
+fsal_status_t MEMFSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        unsigned int xattr_id,  /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        caddr_t buffer_addr,    /* IN/OUT */
+                                        size_t buffer_size,     /* IN */
+                                        size_t * p_output_size /* OUT */ );
+
+fsal_status_t MEMFSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,       /* IN */
+                                       const fsal_name_t * xattr_name,  /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       unsigned int *pxattr_id /* OUT */ );
+
+fsal_status_t MEMFSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,    /* IN */
+                                          const fsal_name_t * xattr_name,       /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,  /* IN/OUT */
+                                          size_t buffer_size,   /* IN */
+                                          size_t * p_output_size /* OUT */ );
+
+fsal_status_t MEMFSAL_SetXAttrValue(fsal_handle_t * p_objecthandle,  /* IN */
+                                    const fsal_name_t * xattr_name,     /* IN */
+                                    fsal_op_context_t * p_context,   /* IN */
+                                    caddr_t buffer_addr,        /* IN */
+                                    size_t buffer_size, /* IN */
+                                    int create /* IN */ );
+
+fsal_status_t MEMFSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        unsigned int xattr_id,  /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        caddr_t buffer_addr,    /* IN */
+                                        size_t buffer_size /* IN */ );
+
+fsal_status_t MEMFSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      unsigned int xattr_id) /* IN */ ;
+
+fsal_status_t MEMFSAL_RemoveXAttrByName(fsal_handle_t * p_objecthandle,      /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        const fsal_name_t * xattr_name) /* IN */ ;
+
+unsigned int MEMFSAL_GetFileno(fsal_file_t * pfile);
+
+fsal_status_t MEMFSAL_commit( fsal_file_t * p_file_descriptor,
+                            fsal_off_t    offset,
+                            fsal_size_t   size ) ;
@@ -0,0 +1,270 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_lock.c
+ * \brief   Locking operations.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "abstract_mem.h"
+
+/**
+ * mem_lock_conflict:
+ * Finds a lock of another owner that conflicts with a range, in a
+ * file the caller holds locked.  All the locks made without an owner
+ * belong to the same one, as those of a process do.
+ */
+static struct mem_lock *mem_lock_conflict(struct mem_inode *inode, void *owner,
+                                          fsal_lock_t type,
+                                          uint64_t start, uint64_t end)
+{
+  struct glist_head *glist;
+
+  glist_for_each(glist, &inode->locks)
+    {
+      struct mem_lock *lock = glist_entry(glist, struct mem_lock, list);
+
+      if(lock->owner == owner || lock->start > end || lock->end < start)
+        continue;
+
+      if(lock->type == FSAL_LOCK_W || type == FSAL_LOCK_W)
+        return lock;
+    }
+
+  return NULL;
+}
+
+/**
+ * mem_lock_remove:
+ * Releases a range from the locks of an owner, which do not overlap
+ * each other.  A lock strictly containing the range is split in two,
+ * the second half taken from *pp_spare.
+ */
+static void mem_lock_remove(struct mem_inode *inode, void *owner,
+                            uint64_t start, uint64_t end,
+                            struct mem_lock **pp_spare)
+{
+  struct glist_head *glist, *glistn;
+
+  glist_for_each_safe(glist, glistn, &inode->locks)
+    {
+      struct mem_lock *lock = glist_entry(glist, struct mem_lock, list);
+
+      if(lock->owner != owner || lock->start > end || lock->end < start)
+        continue;
+
+      if(lock->start >= start && lock->end <= end)
+        {
+          glist_del(&lock->list);
+          gsh_free(lock);
+        }
+      else if(lock->start < start && lock->end > end)
+        {
+          struct mem_lock *tail = *pp_spare;
+
+          *pp_spare = NULL;
+          *tail = *lock;
+          tail->start = end + 1;
+          glist_add_tail(&inode->locks, &tail->list);
+          lock->end = start - 1;
+        }
+      else if(lock->start < start)
+        lock->end = start - 1;
+      else
+        lock->start = end + 1;
+    }
+}
+
+/**
+ * MEMFSAL_lock_op:
+ * Lock/unlock/test a lock for a region in a file.
+ *
+ * The locks are kept with the inode, and conflict only between
+ * different owners.  They are all dropped on the last close of the
+ * file.
+ *
+ * \param p_file_descriptor (input):
+ *        File descriptor of the file to lock.
+ * \param p_filehandle (input):
+ *        File handle of the file to lock.
+ * \param p_context (input):
+ *        Context
+ * \param p_owner (input):
+ *        Owner for the requested lock, NULL for the owner of all the
+ *        locks when lock owners are not supported.
+ * \param lock_op (input):
+ *        Can be either FSAL_OP_LOCKT, FSAL_OP_LOCK, FSAL_OP_UNLOCK.
+ *        The operations are test if a file region is locked, lock a file region, unlock a
+ *        file region.
+ * \param request_lock (input):
+ *        The type, start and length of the region, a length of 0
+ *        running to the end of the file.
+ * \param conflicting_lock (output):
+ *        The lock standing in the way of FSAL_OP_LOCKT or FSAL_OP_LOCK,
+ *        FSAL_NO_LOCK if there is none.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - ERR_FSAL_FAULT: One of the in put parameters is NULL.
+ *      - ERR_FSAL_DELAY: lock_op was FSAL_OP_LOCK and the region is locked
+ *        by another owner.
+ *      - ERR_FSAL_NOTSUPP: blocking locks are not supported.
+ */
+fsal_status_t MEMFSAL_lock_op( fsal_file_t           * p_file_descriptor,   /* IN */
+                               fsal_handle_t         * p_filehandle,        /* IN */
+                               fsal_op_context_t     * p_context,           /* IN */
+                               void                  * p_owner,             /* IN */
+                               fsal_lock_op_t          lock_op,             /* IN */
+                               fsal_lock_param_t       request_lock,        /* IN */
+                               fsal_lock_param_t     * conflicting_lock)    /* OUT */
+{
+  memfsal_file_t * pfd = (memfsal_file_t *) p_file_descriptor;
+  struct mem_inode *inode;
+  struct mem_lock *conflict, *lock = NULL, *spare = NULL;
+  uint64_t start, end;
+  fsal_status_t status;
+
+  if(p_file_descriptor == NULL || p_filehandle == NULL || p_context == NULL ||
+     pfd->inode == NULL)
+    {
+      if(p_file_descriptor == NULL || pfd->inode == NULL)
+        LogDebug(COMPONENT_FSAL, "p_file_descriptor argument is NULL.");
+      if(p_filehandle == NULL)
+        LogDebug(COMPONENT_FSAL, "p_filehandle argument is NULL.");
+      if(p_context == NULL)
+        LogDebug(COMPONENT_FSAL, "p_context argument is NULL.");
+      Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lock_op);
+    }
+
+  if(conflicting_lock == NULL && lock_op == FSAL_OP_LOCKT)
+    {
+      LogDebug(COMPONENT_FSAL, "conflicting_lock argument can't"
+               " be NULL with lock_op  = LOCKT");
+      Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lock_op);
+    }
+
+  LogFullDebug(COMPONENT_FSAL, "Locking: op:%d type:%d start:%"PRIu64" length:%zu ", lock_op,
+               request_lock.lock_type, request_lock.lock_start, request_lock.lock_length);
+
+  if(lock_op != FSAL_OP_LOCKT && lock_op != FSAL_OP_LOCK && lock_op != FSAL_OP_UNLOCK)
+    {
+      LogDebug(COMPONENT_FSAL, "ERROR: Lock operation requested was not TEST, READ, or WRITE.");
+      Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_lock_op);
+    }
+
+  if(request_lock.lock_type != FSAL_LOCK_R && request_lock.lock_type != FSAL_LOCK_W)
+    {
+      LogDebug(COMPONENT_FSAL, "ERROR: The requested lock type was not read or write.");
+      Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_lock_op);
+    }
+
+  start = request_lock.lock_start;
+  if(request_lock.lock_length == 0 ||
+     start + request_lock.lock_length - 1 < start)
+    end = UINT64_MAX;
+  else
+    end = start + request_lock.lock_length - 1;
+
+  /* Allocate before locking: a lock and the half of a split one */
+  if(lock_op != FSAL_OP_LOCKT)
+    {
+      spare = gsh_malloc(sizeof(struct mem_lock));
+      if(lock_op == FSAL_OP_LOCK)
+        lock = gsh_malloc(sizeof(struct mem_lock));
+      if(spare == NULL || (lock_op == FSAL_OP_LOCK && lock == NULL))
+        {
+          if(spare != NULL)
+            gsh_free(spare);
+          if(lock != NULL)
+            gsh_free(lock);
+          Return(ERR_FSAL_NOMEM, ENOMEM, INDEX_FSAL_lock_op);
+        }
+    }
+
+  inode = pfd->inode;
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  if(lock_op == FSAL_OP_UNLOCK)
+    conflict = NULL;
+  else
+    conflict = mem_lock_conflict(inode, p_owner, request_lock.lock_type,
+                                 start, end);
+
+  if(conflicting_lock != NULL)
+    {
+      if(conflict != NULL)
+        {
+          conflicting_lock->lock_length =
+              conflict->end == UINT64_MAX ? 0 : conflict->end - conflict->start + 1;
+          conflicting_lock->lock_start = conflict->start;
+          conflicting_lock->lock_type = conflict->type;
+        }
+      else
+        {
+          conflicting_lock->lock_length = 0;
+          conflicting_lock->lock_start = 0;
+          conflicting_lock->lock_type = FSAL_NO_LOCK;
+        }
+    }
+
+  status.major = ERR_FSAL_NO_ERROR;
+  status.minor = 0;
+
+  if(lock_op == FSAL_OP_LOCK)
+    {
+      if(conflict != NULL)
+        {
+          status.major = ERR_FSAL_DELAY;
+          status.minor = EAGAIN;
+        }
+      else
+        {
+          /* A new lock of an owner replaces what it had on the range */
+          mem_lock_remove(inode, p_owner, start, end, &spare);
+
+          lock->owner = p_owner;
+          lock->type = request_lock.lock_type;
+          lock->start = start;
+          lock->end = end;
+          glist_add_tail(&inode->locks, &lock->list);
+          lock = NULL;
+        }
+    }
+  else if(lock_op == FSAL_OP_UNLOCK)
+    mem_lock_remove(inode, p_owner, start, end, &spare);
+
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(spare != NULL)
+    gsh_free(spare);
+  if(lock != NULL)
+    gsh_free(lock);
+
+  ReturnStatus(status, INDEX_FSAL_lock_op);
+}
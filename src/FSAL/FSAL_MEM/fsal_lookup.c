@@ -0,0 +1,372 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_lookup.c
+ * \brief   Lookup operations.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "FSAL/access_check.h"
+#include <string.h>
+
+/**
+ * mem_walk_path:
+ * Finds the directory an absolute path names, as root would, making
+ * the missing directories on the way if asked to.  Those are owned
+ * by root and open to everyone, as /tmp is.
+ *
+ * \param path (input):
+ *        The path, from the root of the store.
+ * \param create (input):
+ *        Whether to make the missing directories.
+ * \param pp_inode (output):
+ *        The directory, referenced.
+ *
+ * \return - ERR_FSAL_NO_ERROR, if no error.
+ *         - Another error code else.
+ */
+fsal_status_t mem_walk_path(const char *path, int create,
+                            struct mem_inode **pp_inode)
+{
+  char component[FSAL_MAX_NAME_LEN + 1];
+  struct mem_inode *dir, *child;
+  struct mem_dirent *dirent;
+  fsal_status_t status;
+  const char *end;
+  uint64_t id;
+  size_t len;
+
+  if(path[0] != '/')
+    ReturnCode(ERR_FSAL_INVAL, 0);
+
+  dir = mem_inode_get(MEM_ROOT_ID);
+  if(dir == NULL)
+    ReturnCode(ERR_FSAL_SERVERFAULT, 0);
+
+  while(*path != '\0')
+    {
+      while(*path == '/')
+        path++;
+      if(*path == '\0')
+        break;
+
+      end = strchrnul(path, '/');
+      len = end - path;
+      if(len > FSAL_MAX_NAME_LEN)
+        {
+          mem_inode_put(dir);
+          ReturnCode(ERR_FSAL_NAMETOOLONG, 0);
+        }
+      memcpy(component, path, len);
+      component[len] = '\0';
+      path = end;
+
+      if(!strcmp(component, "."))
+        continue;
+
+      pthread_rwlock_rdlock(&dir->lock);
+
+      if(!S_ISDIR(dir->attrs.st_mode))
+        {
+          pthread_rwlock_unlock(&dir->lock);
+          mem_inode_put(dir);
+          ReturnCode(ERR_FSAL_NOTDIR, 0);
+        }
+
+      if(!strcmp(component, ".."))
+        id = dir->parent;
+      else if((dirent = mem_dir_lookup(dir, component)) != NULL)
+        id = dirent->id;
+      else if(!create)
+        {
+          pthread_rwlock_unlock(&dir->lock);
+          mem_inode_put(dir);
+          ReturnCode(ERR_FSAL_NOENT, 0);
+        }
+      else
+        {
+          /* make it, unless it was made meanwhile */
+          pthread_rwlock_unlock(&dir->lock);
+          pthread_rwlock_wrlock(&dir->lock);
+
+          dirent = mem_dir_lookup(dir, component);
+          if(dirent != NULL)
+            id = dirent->id;
+          else
+            {
+              status = mem_inode_new(NULL, S_IFDIR | S_ISVTX | 0777, 0, dir, &child);
+              if(!FSAL_IS_ERROR(status))
+                {
+                  status = mem_dir_add(dir, component, child);
+                  if(FSAL_IS_ERROR(status))
+                    {
+                      child->attrs.st_nlink = 0;
+                      mem_inode_unlinked(child);
+                      mem_inode_put(child);
+                    }
+                }
+              if(FSAL_IS_ERROR(status))
+                {
+                  pthread_rwlock_unlock(&dir->lock);
+                  mem_inode_put(dir);
+                  return status;
+                }
+              LogEvent(COMPONENT_FSAL, "MEM: made directory %s", component);
+              id = child->id;
+              mem_inode_put(child);
+            }
+        }
+
+      pthread_rwlock_unlock(&dir->lock);
+
+      child = mem_inode_get(id);
+      mem_inode_put(dir);
+      if(child == NULL)
+        ReturnCode(ERR_FSAL_NOENT, 0);
+      dir = child;
+    }
+
+  *pp_inode = dir;
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
+/**
+ * FSAL_lookup :
+ * Looks up for an object into a directory.
+ *
+ * Note : if parent handle and filename are NULL,
+ *        this retrieves root's handle.
+ *
+ * \param parent_directory_handle (input)
+ *        Handle of the parent directory to search the object in.
+ * \param filename (input)
+ *        The name of the object to find.
+ * \param p_context (input)
+ *        Authentication context for the operation (user,...).
+ * \param object_handle (output)
+ *        The handle of the object corresponding to filename.
+ * \param object_attributes (optional input/output)
+ *        Pointer to the attributes of the object we found.
+ *        As input, it defines the attributes that the caller
+ *        wants to retrieve (by positioning flags into this structure)
+ *        and the output is built considering this input
+ *        (it fills the structure according to the flags it contains).
+ *
+ * \return - ERR_FSAL_NO_ERROR, if no error.
+ *         - Another error code else.
+ *
+ */
+fsal_status_t MEMFSAL_lookup(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_filename,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_handle_t * p_object_handle,        /* OUT */
+                             fsal_attrib_list_t * p_object_attributes   /* [ IN/OUT ] */
+    )
+{
+  memfsal_op_context_t *mem_context = (memfsal_op_context_t *)p_context;
+  fsal_status_t status;
+  struct mem_inode *dir, *inode;
+  struct mem_dirent *dirent;
+  uint64_t id;
+
+  /* sanity checks
+   * note : object_attributes is optionnal
+   *        parent_directory_handle may be null for getting FS root.
+   */
+  if(!p_object_handle || !p_context)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lookup);
+
+  /* filename AND parent handle are NULL => lookup "/" */
+  if((p_parent_directory_handle && !p_filename)
+     || (!p_parent_directory_handle && p_filename))
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lookup);
+
+  /* get information about root */
+  if(!p_parent_directory_handle)
+    {
+      /* Copy the root handle */
+      memcpy(p_object_handle, &mem_context->export_context->root_handle,
+             sizeof(memfsal_handle_t));
+
+      /* get attributes, if asked */
+      if(p_object_attributes)
+        {
+          status = MEMFSAL_getattrs(p_object_handle, p_context, p_object_attributes);
+          if(FSAL_IS_ERROR(status))
+            {
+              FSAL_CLEAR_MASK(p_object_attributes->asked_attributes);
+              FSAL_SET_MASK(p_object_attributes->asked_attributes, FSAL_ATTR_RDATTR_ERR);
+            }
+        }
+      /* Done */
+      Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_lookup);
+    }
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_parent_directory_handle, &dir);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_lookup);
+
+  pthread_rwlock_rdlock(&dir->lock);
+
+  /* Be careful about junction crossing, symlinks, hardlinks,... */
+  if(!S_ISDIR(dir->attrs.st_mode))
+    {
+      pthread_rwlock_unlock(&dir->lock);
+      mem_inode_put(dir);
+      Return(ERR_FSAL_NOTDIR, 0, INDEX_FSAL_lookup);
+    }
+
+  /* check rights to enter into the directory */
+  status = fsal_check_access(p_context, FSAL_X_OK, &dir->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    {
+      pthread_rwlock_unlock(&dir->lock);
+      mem_inode_put(dir);
+      ReturnStatus(status, INDEX_FSAL_lookup);
+    }
+
+  if(!strcmp(p_filename->name, "."))
+    id = dir->id;
+  else if(!strcmp(p_filename->name, ".."))
+    id = dir->parent;
+  else if((dirent = mem_dir_lookup(dir, p_filename->name)) != NULL)
+    id = dirent->id;
+  else
+    {
+      pthread_rwlock_unlock(&dir->lock);
+      mem_inode_put(dir);
+      Return(ERR_FSAL_NOENT, 0, INDEX_FSAL_lookup);
+    }
+
+  pthread_rwlock_unlock(&dir->lock);
+  mem_inode_put(dir);
+
+  /* the entry may have gone since */
+  inode = mem_inode_get(id);
+  if(inode == NULL)
+    Return(ERR_FSAL_NOENT, 0, INDEX_FSAL_lookup);
+
+  pthread_rwlock_rdlock(&inode->lock);
+  mem_inode_to_handle(inode, p_object_handle);
+  mem_getattrs_locked(inode, p_object_attributes);
+  pthread_rwlock_unlock(&inode->lock);
+
+  mem_inode_put(inode);
+
+  /* lookup complete ! */
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_lookup);
+
+}
+
+/**
+ * FSAL_lookupPath :
+ * Looks up for an object into the namespace.
+ *
+ * Note : if path equals "/",
+ *        this retrieves root's handle.
+ *
+ * \param path (input)
+ *        The path of the object to find.
+ * \param p_context (input)
+ *        Authentication context for the operation (user,...).
+ * \param object_handle (output)
+ *        The handle of the object corresponding to filename.
+ * \param object_attributes (optional input/output)
+ *        Pointer to the attributes of the object we found.
+ *        As input, it defines the attributes that the caller
+ *        wants to retrieve (by positioning flags into this structure)
+ *        and the output is built considering this input
+ *        (it fills the structure according to the flags it contains).
+ *        It can be NULL (increases performances).
+ */
+
+fsal_status_t MEMFSAL_lookupPath(fsal_path_t * p_path,  /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_handle_t * object_handle,      /* OUT */
+                                 fsal_attrib_list_t * p_object_attributes       /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity checks
+   * note : object_attributes is optional.
+   */
+
+  if(!object_handle || !p_context || !p_path)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_lookupPath);
+
+  /* test whether the path begins with a slash */
+
+  if(p_path->path[0] != '/')
+    Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_lookupPath);
+
+  status = mem_walk_path(p_path->path, FALSE, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_lookupPath);
+
+  pthread_rwlock_rdlock(&inode->lock);
+  mem_inode_to_handle(inode, object_handle);
+  mem_getattrs_locked(inode, p_object_attributes);
+  pthread_rwlock_unlock(&inode->lock);
+
+  mem_inode_put(inode);
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_lookupPath);
+
+}
+
+/**
+ * FSAL_lookupJunction :
+ * Get the fileset root for a junction.
+ * There are no junctions in the store.
+ *
+ * \param p_junction_handle (input)
+ *        Handle of the junction to be looked up.
+ * \param p_context (input)
+ *        Authentication context for the operation (user,...).
+ * \param p_fsroot_handle (output)
+ *        The handle of root directory of the fileset.
+ * \param p_fsroot_attributes (optional input/output)
+ *        Pointer to the attributes of the root directory
+ *        for the fileset.
+ *
+ * \return - ERR_FSAL_NO_ERROR, if no error.
+ *         - Another error code else.
+ *
+ */
+fsal_status_t MEMFSAL_lookupJunction(fsal_handle_t * p_junction_handle,      /* IN */
+                                     fsal_op_context_t * p_context,  /* IN */
+                                     fsal_handle_t * p_fsoot_handle, /* OUT */
+                                     fsal_attrib_list_t * p_fsroot_attributes   /* [ IN/OUT ] */
+    )
+{
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_lookupJunction);
+}
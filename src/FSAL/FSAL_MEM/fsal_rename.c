@@ -0,0 +1,256 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_rename.c
+ * \brief   object renaming/moving function.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "FSAL/access_check.h"
+#include "fsal_convert.h"
+
+/**
+ * mem_rename_check_dir:
+ * Checks the user may change the entries of a directory locked by the
+ * caller.
+ */
+static fsal_status_t mem_rename_check_dir(fsal_op_context_t * p_context,
+                                          struct mem_inode *dir)
+{
+  if(!S_ISDIR(dir->attrs.st_mode))
+    ReturnCode(ERR_FSAL_NOTDIR, ENOTDIR);
+
+  if(dir->attrs.st_nlink == 0)
+    ReturnCode(ERR_FSAL_STALE, 0);
+
+  return fsal_check_access(p_context, FSAL_W_OK | FSAL_X_OK, &dir->attrs, NULL);
+}
+
+/**
+ * FSAL_rename:
+ * Change name and/or parent dir of a filesystem object.
+ *
+ * Both directories are write locked for the whole operation.  When
+ * they differ, the rename mutex keeps the tree from changing shape
+ * while the operation checks the object is not moved under itself and
+ * locks the directory that is an ancestor of the other first, or the
+ * one with the lower inode number if neither is.
+ *
+ * \param old_parentdir_handle (input):
+ *        Source parent directory of the object is to be moved/renamed.
+ * \param p_old_name (input):
+ *        Pointer to the current name of the object to be moved/renamed.
+ * \param new_parentdir_handle (input):
+ *        Target parent directory for the object.
+ * \param p_new_name (input):
+ *        Pointer to the new name for the object.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param src_dir_attributes (optionnal input/output):
+ *        Post operation attributes for the source directory.
+ *        May be NULL.
+ * \param tgt_dir_attributes (optionnal input/output):
+ *        Post operation attributes for the target directory.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_rename(fsal_handle_t * p_old_parentdir_handle, /* IN */
+                             fsal_name_t * p_old_name,  /* IN */
+                             fsal_handle_t * p_new_parentdir_handle, /* IN */
+                             fsal_name_t * p_new_name,  /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t * p_src_dir_attributes, /* [ IN/OUT ] */
+                             fsal_attrib_list_t * p_tgt_dir_attributes  /* [ IN/OUT ] */
+    )
+{
+  uid_t user;
+  fsal_status_t status;
+  struct mem_inode *src_dir, *tgt_dir, *inode = NULL;
+  struct mem_dirent *src_dirent, *tgt_dirent;
+  int same_dir, cross_locked = FALSE;
+
+  /* sanity checks.
+   * note : src/tgt_dir_attributes are optional.
+   */
+  if(!p_old_parentdir_handle || !p_new_parentdir_handle
+     || !p_old_name || !p_new_name || !p_context)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_rename);
+
+  user = ((memfsal_op_context_t *)p_context)->credential.user;
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_old_parentdir_handle, &src_dir);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_rename);
+
+  status = mem_handle_to_inode(p_new_parentdir_handle, &tgt_dir);
+  if(FSAL_IS_ERROR(status))
+    {
+      mem_inode_put(src_dir);
+      ReturnStatus(status, INDEX_FSAL_rename);
+    }
+
+  same_dir = (src_dir == tgt_dir);
+
+  if(same_dir)
+    pthread_rwlock_wrlock(&src_dir->lock);
+  else
+    {
+      struct mem_inode *first, *second;
+
+      pthread_mutex_lock(&mem_rename_mutex);
+      cross_locked = TRUE;
+
+      if(mem_dir_is_ancestor(src_dir->id, tgt_dir))
+        first = src_dir, second = tgt_dir;
+      else if(mem_dir_is_ancestor(tgt_dir->id, src_dir))
+        first = tgt_dir, second = src_dir;
+      else if(src_dir->id < tgt_dir->id)
+        first = src_dir, second = tgt_dir;
+      else
+        first = tgt_dir, second = src_dir;
+
+      pthread_rwlock_wrlock(&first->lock);
+      pthread_rwlock_wrlock(&second->lock);
+    }
+
+  /* client must be able to modify both directories */
+  status = mem_rename_check_dir(p_context, src_dir);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  if(!same_dir)
+    {
+      status = mem_rename_check_dir(p_context, tgt_dir);
+      if(FSAL_IS_ERROR(status))
+        goto out;
+    }
+
+  src_dirent = mem_dir_lookup(src_dir, p_old_name->name);
+  if(src_dirent == NULL)
+    {
+      status.major = ERR_FSAL_NOENT;
+      status.minor = ENOENT;
+      goto out;
+    }
+
+  /* A directory cannot be moved under itself */
+  if(!same_dir && src_dirent->is_dir &&
+     mem_dir_is_ancestor(src_dirent->id, tgt_dir))
+    {
+      status.major = ERR_FSAL_INVAL;
+      status.minor = EINVAL;
+      goto out;
+    }
+
+  inode = mem_inode_get(src_dirent->id);
+  if(inode == NULL)
+    {
+      status.major = ERR_FSAL_STALE;
+      status.minor = 0;
+      goto out;
+    }
+
+  /* Sticky bit on the source directory => the user who wants to move
+   * the file must own it or its parent dir */
+  pthread_rwlock_rdlock(&inode->lock);
+  if((src_dir->attrs.st_mode & S_ISVTX)
+     && src_dir->attrs.st_uid != user
+     && inode->attrs.st_uid != user && user != 0)
+    {
+      status.major = ERR_FSAL_ACCESS;
+      status.minor = 0;
+    }
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  tgt_dirent = mem_dir_lookup(tgt_dir, p_new_name->name);
+  if(tgt_dirent != NULL)
+    {
+      /* Renaming a name onto another name of the same object does
+       * nothing */
+      if(tgt_dirent->id == src_dirent->id)
+        goto attrs;
+
+      if(src_dirent->is_dir && !tgt_dirent->is_dir)
+        {
+          status.major = ERR_FSAL_NOTDIR;
+          status.minor = ENOTDIR;
+          goto out;
+        }
+
+      if(!src_dirent->is_dir && tgt_dirent->is_dir)
+        {
+          status.major = ERR_FSAL_ISDIR;
+          status.minor = EISDIR;
+          goto out;
+        }
+
+      status = mem_dir_unlink(p_context, tgt_dir, tgt_dirent);
+      if(FSAL_IS_ERROR(status))
+        goto out;
+    }
+
+  /* The new name comes before the old one goes, so that the object is
+   * never left without a name if it fails */
+  status = mem_dir_add(tgt_dir, p_new_name->name, inode);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  mem_dir_remove(src_dir, src_dirent);
+
+  pthread_rwlock_wrlock(&inode->lock);
+  if(S_ISDIR(inode->attrs.st_mode))
+    inode->parent = tgt_dir->id;
+  mem_inode_touch(inode, FALSE);
+  pthread_rwlock_unlock(&inode->lock);
+
+ attrs:
+  /* Post operation attributes of the directories */
+  mem_getattrs_locked(src_dir, p_src_dir_attributes);
+  mem_getattrs_locked(tgt_dir, p_tgt_dir_attributes);
+
+ out:
+  if(!same_dir)
+    pthread_rwlock_unlock(&tgt_dir->lock);
+  pthread_rwlock_unlock(&src_dir->lock);
+  if(cross_locked)
+    pthread_mutex_unlock(&mem_rename_mutex);
+
+  if(inode != NULL)
+    mem_inode_put(inode);
+  mem_inode_put(tgt_dir);
+  mem_inode_put(src_dir);
+
+  ReturnStatus(status, INDEX_FSAL_rename);
+}
@@ -0,0 +1,148 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_symlinks.c
+ * \brief   symlinks operations.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include <string.h>
+
+/**
+ * FSAL_readlink:
+ * Read the content of a symbolic link.
+ *
+ * \param linkhandle (input):
+ *        Handle of the link to be read.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param p_link_content (output):
+ *        Pointer to an fsal path structure where
+ *        the link content is to be stored..
+ * \param link_attributes (optionnal input/output):
+ *        The post operation attributes of the symlink link.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_readlink(fsal_handle_t * p_linkhandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_path_t * p_link_content,    /* OUT */
+                               fsal_attrib_list_t * p_link_attributes   /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity checks.
+   * note : link_attributes is optional.
+   */
+  if(!p_linkhandle || !p_context || !p_link_content)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_readlink);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_linkhandle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_readlink);
+
+  pthread_rwlock_rdlock(&inode->lock);
+
+  if(!S_ISLNK(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_INVAL;
+      status.minor = EINVAL;
+    }
+  else
+    status = FSAL_str2path(inode->link, FSAL_MAX_PATH_LEN, p_link_content);
+
+  if(!FSAL_IS_ERROR(status))
+    mem_getattrs_locked(inode, p_link_attributes);
+
+  pthread_rwlock_unlock(&inode->lock);
+  mem_inode_put(inode);
+
+  ReturnStatus(status, INDEX_FSAL_readlink);
+}
+
+/**
+ * FSAL_symlink:
+ * Create a symbolic link.
+ *
+ * \param parent_directory_handle (input):
+ *        Handle of the parent directory where the link is to be created.
+ * \param p_linkname (input):
+ *        Name of the link to be created.
+ * \param p_linkcontent (input):
+ *        Content of the link to be created.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param accessmode (ignored input):
+ *        Mode of the link to be created.
+ *        It has no sense in UNIX filesystems.
+ * \param link_handle (output):
+ *        Pointer to the handle of the created symlink.
+ * \param link_attributes (optionnal input/output):
+ *        Attributes of the newly created symlink.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_symlink(fsal_handle_t * p_parent_directory_handle,     /* IN */
+                              fsal_name_t * p_linkname, /* IN */
+                              fsal_path_t * p_linkcontent,      /* IN */
+                              fsal_op_context_t * p_context, /* IN */
+                              fsal_accessmode_t accessmode,     /* IN (ignored) */
+                              fsal_handle_t * p_link_handle, /* OUT */
+                              fsal_attrib_list_t * p_link_attributes    /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+
+  /* sanity checks.
+   * note : link_attributes is optional.
+   */
+  if(!p_parent_directory_handle || !p_context ||
+     !p_link_handle || !p_linkname || !p_linkcontent)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_symlink);
+
+  /* Tests if symlinking is allowed by configuration. */
+
+  if(!global_fs_info.symlink_support)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_symlink);
+
+  status = mem_create_node(p_parent_directory_handle, p_linkname, p_context,
+                           S_IFLNK | 0777, 0, p_linkcontent->path,
+                           p_link_handle, p_link_attributes);
+
+  ReturnStatus(status, INDEX_FSAL_symlink);
+}
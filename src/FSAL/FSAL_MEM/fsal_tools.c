@@ -0,0 +1,393 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_tools.c
+ * \brief   miscelaneous FSAL tools.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include "config_parsing.h"
+#include "common_utils.h"
+#include <string.h>
+#include <stddef.h>
+
+/* case unsensitivity */
+#define STRCMP   strcasecmp
+
+char *MEMFSAL_GetFSName()
+{
+  return "MEM";
+}
+
+/**
+ * FSAL_handlecmp:
+ * Compare 2 handles.
+ *
+ * \param handle1 (input):
+ *        The first handle to be compared.
+ * \param handle2 (input):
+ *        The second handle to be compared.
+ * \param status (output):
+ *        The status of the compare operation.
+ *
+ * \return - 0 if handles are the same.
+ *         - A non null value else.
+ *         - Segfault if status is a NULL pointer.
+ */
+
+int MEMFSAL_handlecmp(fsal_handle_t * handle_1, fsal_handle_t * handle_2,
+                      fsal_status_t * status)
+{
+  memfsal_handle_t * handle1 = (memfsal_handle_t *)handle_1;
+  memfsal_handle_t * handle2 = (memfsal_handle_t *)handle_2;
+
+  *status = FSAL_STATUS_NO_ERROR;
+
+  if(!handle1 || !handle2)
+    {
+      status->major = ERR_FSAL_FAULT;
+      return -1;
+    }
+
+  if(handle1->data.id != handle2->data.id)
+    return -2;
+
+  if(handle1->data.generation != handle2->data.generation)
+    return -3;
+
+  return 0;
+}
+
+/**
+ * FSAL_Handle_to_HashIndex
+ * This function is used for hashing a FSAL handle
+ * in order to dispatch entries into the hash table array.
+ *
+ * \param p_handle      The handle to be hashed
+ * \param cookie        Makes it possible to have different hash value for the
+ *                      same handle, when cookie changes.
+ * \param alphabet_len  Parameter for polynomial hashing algorithm
+ * \param index_size    The range of hash value will be [0..index_size-1]
+ *
+ * \return The hash value
+ */
+unsigned int MEMFSAL_Handle_to_HashIndex(fsal_handle_t *handle,
+                                         unsigned int cookie,
+                                         unsigned int alphabet_len,
+                                         unsigned int index_size)
+{
+  memfsal_handle_t * p_handle = (memfsal_handle_t *)handle;
+  unsigned int sum = cookie;
+
+  /* inode numbers are consecutive, both halves go into the sum */
+  sum = (3 * sum + 5 * (unsigned int)p_handle->data.id + 1999) % index_size;
+  sum = (3 * sum + 5 * (unsigned int)(p_handle->data.id >> 32) + 1999) % index_size;
+
+  return sum;
+}
+
+/*
+ * FSAL_Handle_to_RBTIndex
+ * This function is used for generating a RBT node ID
+ * in order to identify entries into the RBT.
+ *
+ * \param p_handle      The handle to be hashed
+ * \param cookie        Makes it possible to have different hash value for the
+ *                      same handle, when cookie changes.
+ *
+ * \return The hash value
+ */
+
+unsigned int MEMFSAL_Handle_to_RBTIndex(fsal_handle_t *handle, unsigned int cookie)
+{
+  memfsal_handle_t * p_handle = (memfsal_handle_t *)handle;
+  unsigned int h = cookie;
+
+  h = (857 * h ^ (unsigned int)p_handle->data.id) % 715827883;
+  h = (857 * h ^ (unsigned int)(p_handle->data.id >> 32)) % 715827883;
+
+  return h;
+}
+
+/**
+ * FSAL_DigestHandle :
+ *  Convert an memfsal_handle_t to a buffer
+ *  to be included into NFS handles,
+ *  or another digest.
+ *
+ * \param output_type (input):
+ *        Indicates the type of digest to do.
+ * \param in_fsal_handle (input):
+ *        The handle to be converted to digest.
+ * \param fh_desc (output):
+ *        The descriptor for the buffer where the digest is to be stored.
+ *
+ * \return The major code is ERR_FSAL_NO_ERROR is no error occured.
+ *         Else, it is a non null value.
+ */
+fsal_status_t MEMFSAL_DigestHandle(fsal_export_context_t * p_expcontext,     /* IN */
+                                   fsal_digesttype_t output_type,       /* IN */
+                                   fsal_handle_t *in_fsal_handle, /* IN */
+                                   struct fsal_handle_desc *fh_desc     /* IN/OUT */
+    )
+{
+  memfsal_handle_t * p_in_fsal_handle = (memfsal_handle_t *)in_fsal_handle;
+  size_t fh_size;
+  uint32_t ino32;
+
+  /* sanity checks */
+  if(!p_in_fsal_handle || !fh_desc || !fh_desc->start || !p_expcontext)
+    ReturnCode(ERR_FSAL_FAULT, 0);
+
+  switch (output_type)
+    {
+
+      /* NFS handle digest */
+    case FSAL_DIGEST_NFSV2:
+    case FSAL_DIGEST_NFSV3:
+    case FSAL_DIGEST_NFSV4:
+      fh_size = sizeof(p_in_fsal_handle->data);
+      if(fh_desc->len < fh_size)
+        {
+          LogMajor(COMPONENT_FSAL,
+                   "MEM DigestHandle: space too small for handle.  need %lu, have %lu",
+                   fh_size, fh_desc->len);
+          ReturnCode(ERR_FSAL_TOOSMALL, 0);
+        }
+      memcpy(fh_desc->start, &p_in_fsal_handle->data, fh_size);
+      fh_desc->len = fh_size;
+      break;
+
+    case FSAL_DIGEST_FILEID2:
+      ino32 = (uint32_t) p_in_fsal_handle->data.id;
+      memcpy(fh_desc->start, &ino32, FSAL_DIGEST_SIZE_FILEID2);
+      fh_desc->len = FSAL_DIGEST_SIZE_FILEID2;
+      break;
+
+    case FSAL_DIGEST_FILEID3:
+      memcpy(fh_desc->start, &p_in_fsal_handle->data.id, FSAL_DIGEST_SIZE_FILEID3);
+      fh_desc->len = FSAL_DIGEST_SIZE_FILEID3;
+      break;
+
+    case FSAL_DIGEST_FILEID4:
+      memcpy(fh_desc->start, &p_in_fsal_handle->data.id, FSAL_DIGEST_SIZE_FILEID4);
+      fh_desc->len = FSAL_DIGEST_SIZE_FILEID4;
+      break;
+
+    default:
+      ReturnCode(ERR_FSAL_SERVERFAULT, 0);
+
+    }
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+
+}
+
+/**
+ * FSAL_ExpandHandle :
+ *  Convert a buffer extracted from NFS handles
+ *  to an FSAL handle.
+ * The handle has a fixed size, all we do is checking it.
+ *
+ * \param in_type (input):
+ *        Indicates the type of digest to be expanded.
+ * \param fh_desc (input/output):
+ *        digest descriptor.  returns length to be copied
+ *
+ * \return The major code is ERR_FSAL_NO_ERROR is no error occured.
+ *         Else, it is a non null value.
+ */
+fsal_status_t MEMFSAL_ExpandHandle(fsal_export_context_t * p_expcontext,     /* IN not used */
+                                   fsal_digesttype_t in_type,   /* IN */
+                                   struct fsal_handle_desc *fh_desc  /* IN/OUT */ )
+{
+  size_t fh_size = sizeof(((memfsal_handle_t *) 0)->data);
+
+  /* sanity checks */
+  if(!fh_desc || !fh_desc->start)
+    ReturnCode(ERR_FSAL_FAULT, 0);
+
+  if(in_type == FSAL_DIGEST_NFSV2)
+    {
+      if(fh_desc->len < fh_size)
+        {
+          LogMajor(COMPONENT_FSAL,
+                   "MEM ExpandHandle: V2 size too small for handle.  should be %lu, got %lu",
+                   fh_size, fh_desc->len);
+          ReturnCode(ERR_FSAL_SERVERFAULT, 0);
+        }
+    }
+  else if(in_type != FSAL_DIGEST_SIZEOF && fh_desc->len != fh_size)
+    {
+      LogMajor(COMPONENT_FSAL,
+               "MEM ExpandHandle: size mismatch for handle.  should be %lu, got %lu",
+               fh_size, fh_desc->len);
+      ReturnCode(ERR_FSAL_SERVERFAULT, 0);
+    }
+  fh_desc->len = fh_size;  /* pass back the actual size */
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+
+}
+
+/**
+ * Those routines set the default parameters
+ * for FSAL init structure.
+ * \return ERR_FSAL_NO_ERROR (no error) ,
+ *         ERR_FSAL_FAULT (null pointer given as parameter),
+ *         ERR_FSAL_SERVERFAULT (unexpected error)
+ */
+
+fsal_status_t MEMFSAL_SetDefault_FS_specific_parameter(fsal_parameter_t * out_parameter)
+{
+  /* defensive programming... */
+  if(out_parameter == NULL)
+    ReturnCode(ERR_FSAL_FAULT, 0);
+
+  /* set default values for all parameters of fs_specific_info:
+   * no latency, no limit but the memory of the machine */
+
+  memset(&out_parameter->fs_specific_info, 0, sizeof(memfs_specific_initinfo_t));
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+
+}
+
+/**
+ * FSAL_load_FS_specific_parameter_from_conf:
+ *
+ * Initializes the FS specific part of the FSAL init parameter
+ * structure from a configuration structure.
+ *
+ * \param in_config (input):
+ *        Structure that represents the parsed configuration file.
+ * \param out_parameter (ouput)
+ *        FSAL initialization structure filled according
+ *        to the configuration file given as parameter.
+ *
+ * \return ERR_FSAL_NO_ERROR (no error) ,
+ *         ERR_FSAL_INVAL (invalid parameter),
+ *         ERR_FSAL_SERVERFAULT (unexpected error)
+ *         ERR_FSAL_FAULT (null pointer given as parameter),
+ */
+
+/* load specific filesystem configuration options */
+fsal_status_t MEMFSAL_load_FS_specific_parameter_from_conf(config_file_t in_config,
+                                                           fsal_parameter_t *
+                                                           out_parameter)
+{
+  int err;
+  int var_max, var_index;
+  char *key_name;
+  char *key_value;
+  config_item_t block;
+  memfs_specific_initinfo_t *initinfo = &out_parameter->fs_specific_info;
+
+  block = config_FindItemByName(in_config, CONF_LABEL_FS_SPECIFIC);
+
+  /* the block is optional */
+  if(block == NULL)
+    ReturnCode(ERR_FSAL_NO_ERROR, 0);
+  else if(config_ItemType(block) != CONFIG_ITEM_BLOCK)
+    {
+      LogCrit(COMPONENT_CONFIG,
+              "FSAL LOAD PARAMETER: Item \"%s\" is expected to be a block",
+              CONF_LABEL_FS_SPECIFIC);
+      ReturnCode(ERR_FSAL_INVAL, 0);
+    }
+
+  var_max = config_GetNbItems(block);
+
+  for(var_index = 0; var_index < var_max; var_index++)
+    {
+      config_item_t item;
+      unsigned int *p_latency = NULL;
+      fsal_u64_t *p_limit = NULL;
+
+      item = config_GetItemByIndex(block, var_index);
+
+      err = config_GetKeyValue(item, &key_name, &key_value);
+      if(err)
+        {
+          LogCrit(COMPONENT_CONFIG,
+                  "FSAL LOAD PARAMETER: ERROR reading key[%d] from section \"%s\" of configuration file.",
+                  var_index, CONF_LABEL_FS_SPECIFIC);
+          ReturnCode(ERR_FSAL_SERVERFAULT, err);
+        }
+
+      /* does the variable exists ? */
+      if(!STRCMP(key_name, "Metadata_Latency"))
+        p_latency = &initinfo->metadata_latency;
+      else if(!STRCMP(key_name, "Read_Latency"))
+        p_latency = &initinfo->read_latency;
+      else if(!STRCMP(key_name, "Write_Latency"))
+        p_latency = &initinfo->write_latency;
+      else if(!STRCMP(key_name, "Commit_Latency"))
+        p_latency = &initinfo->commit_latency;
+      else if(!STRCMP(key_name, "Max_Size"))
+        p_limit = &initinfo->max_size;
+      else if(!STRCMP(key_name, "Max_Files"))
+        p_limit = &initinfo->max_files;
+      else
+        {
+          LogCrit(COMPONENT_CONFIG,
+                  "FSAL LOAD PARAMETER: ERROR: Unknown or unsettable key: %s (item %s)",
+                  key_name, CONF_LABEL_FS_SPECIFIC);
+          ReturnCode(ERR_FSAL_INVAL, 0);
+        }
+
+      if(p_latency != NULL)
+        {
+          int usec = s_read_int(key_value);
+
+          if(usec < 0)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "FSAL LOAD PARAMETER: ERROR: Unexpected value for %s: microseconds expected.",
+                      key_name);
+              ReturnCode(ERR_FSAL_INVAL, 0);
+            }
+          *p_latency = usec;
+        }
+      else
+        {
+          unsigned long long limit;
+
+          if(s_read_int64(key_value, &limit) != 0)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "FSAL LOAD PARAMETER: ERROR: Unexpected value for %s: positive integer or 0 expected.",
+                      key_name);
+              ReturnCode(ERR_FSAL_INVAL, 0);
+            }
+          *p_limit = limit;
+        }
+    }
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+
+}                               /* FSAL_load_FS_specific_parameter_from_conf */
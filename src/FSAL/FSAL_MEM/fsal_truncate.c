@@ -0,0 +1,101 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_truncate.c
+ * \brief   Truncate function.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+
+/**
+ * FSAL_truncate:
+ * Modify the data length of a regular file.
+ *
+ * As with the other FSALs, the permission to do it was checked by
+ * the caller.
+ *
+ * \param filehandle (input):
+ *        Handle of the file is to be truncated.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param length (input):
+ *        The new data length for the file.
+ * \param object_attributes (optionnal input/output):
+ *        The post operation attributes of the file.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_truncate(fsal_handle_t * p_filehandle, /* IN */
+                               fsal_op_context_t * p_context,        /* IN */
+                               fsal_size_t length,      /* IN */
+                               fsal_file_t * file_descriptor,        /* Unused in this FSAL */
+                               fsal_attrib_list_t * p_object_attributes /* [ IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *inode;
+
+  /* sanity checks.
+   * note : object_attributes is optional.
+   */
+  if(!p_filehandle || !p_context)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_truncate);
+
+  mem_latency(MEM_LATENCY_WRITE);
+
+  status = mem_handle_to_inode(p_filehandle, &inode);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_truncate);
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  if(S_ISDIR(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_ISDIR;
+      status.minor = EISDIR;
+    }
+  else if(!S_ISREG(inode->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_INVAL;
+      status.minor = EINVAL;
+    }
+  else
+    status = mem_file_truncate(inode, length);
+
+  /* Optionally retrieve attributes */
+  if(!FSAL_IS_ERROR(status))
+    mem_getattrs_locked(inode, p_object_attributes);
+
+  pthread_rwlock_unlock(&inode->lock);
+  mem_inode_put(inode);
+
+  ReturnStatus(status, INDEX_FSAL_truncate);
+}
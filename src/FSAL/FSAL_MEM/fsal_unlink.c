@@ -0,0 +1,176 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_unlink.c
+ * \brief   object removing function.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+#include "FSAL/access_check.h"
+#include "fsal_convert.h"
+
+/**
+ * mem_dir_unlink:
+ * Removes an entry from a directory the caller holds write locked,
+ * for FSAL_unlink and for the target of FSAL_rename.  The inode of the
+ * entry goes with its last link, or with its last reference if it is
+ * still opened.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - ERR_FSAL_ACCESS       (sticky directory of another user)
+ *        - ERR_FSAL_NOTEMPTY     (the entry is a directory with entries)
+ */
+fsal_status_t mem_dir_unlink(fsal_op_context_t * p_context,
+                             struct mem_inode *dir, struct mem_dirent *dirent)
+{
+  uid_t user = ((memfsal_op_context_t *)p_context)->credential.user;
+  fsal_status_t status;
+  struct mem_inode *inode;
+  int gone;
+
+  inode = mem_inode_get(dirent->id);
+  if(inode == NULL)
+    ReturnCode(ERR_FSAL_STALE, 0);
+
+  pthread_rwlock_wrlock(&inode->lock);
+
+  /* Sticky bit on the directory => the user who wants to delete the file
+   * must own it or its parent dir */
+  if((dir->attrs.st_mode & S_ISVTX)
+     && dir->attrs.st_uid != user
+     && inode->attrs.st_uid != user && user != 0)
+    {
+      status.major = ERR_FSAL_ACCESS;
+      status.minor = 0;
+      goto out;
+    }
+
+  if(S_ISDIR(inode->attrs.st_mode) && !mem_dir_is_empty(inode))
+    {
+      status.major = ERR_FSAL_NOTEMPTY;
+      status.minor = ENOTEMPTY;
+      goto out;
+    }
+
+  mem_dir_remove(dir, dirent);
+
+  /* a directory has only one name, and its "." goes with it */
+  if(S_ISDIR(inode->attrs.st_mode))
+    inode->attrs.st_nlink = 0;
+  else
+    inode->attrs.st_nlink--;
+  mem_inode_touch(inode, FALSE);
+
+  status.major = ERR_FSAL_NO_ERROR;
+  status.minor = 0;
+
+ out:
+  gone = !FSAL_IS_ERROR(status) && inode->attrs.st_nlink == 0;
+
+  pthread_rwlock_unlock(&inode->lock);
+
+  if(gone)
+    mem_inode_unlinked(inode);
+  mem_inode_put(inode);
+
+  return status;
+}
+
+/**
+ * FSAL_unlink:
+ * Remove a filesystem object .
+ *
+ * \param parentdir_handle (input):
+ *        Handle of the parent directory of the object to be deleted.
+ * \param p_object_name (input):
+ *        Name of the object to be removed.
+ * \param cred (input):
+ *        Authentication context for the operation (user,...).
+ * \param parentdir_attributes (optionnal input/output):
+ *        Post operation attributes of the parent directory.
+ *        May be NULL.
+ *
+ * \return Major error codes :
+ *        - ERR_FSAL_NO_ERROR     (no error)
+ *        - Another error code if an error occurred.
+ */
+fsal_status_t MEMFSAL_unlink(fsal_handle_t * p_parent_directory_handle,      /* IN */
+                             fsal_name_t * p_object_name,       /* IN */
+                             fsal_op_context_t * p_context,  /* IN */
+                             fsal_attrib_list_t * p_parent_directory_attributes /* [IN/OUT ] */
+    )
+{
+  fsal_status_t status;
+  struct mem_inode *dir;
+  struct mem_dirent *dirent;
+
+  /* sanity checks. */
+  if(!p_parent_directory_handle || !p_context || !p_object_name)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_unlink);
+
+  mem_latency(MEM_LATENCY_METADATA);
+
+  status = mem_handle_to_inode(p_parent_directory_handle, &dir);
+  if(FSAL_IS_ERROR(status))
+    ReturnStatus(status, INDEX_FSAL_unlink);
+
+  pthread_rwlock_wrlock(&dir->lock);
+
+  if(!S_ISDIR(dir->attrs.st_mode))
+    {
+      status.major = ERR_FSAL_NOTDIR;
+      status.minor = ENOTDIR;
+      goto out;
+    }
+
+  /* client must be able to lookup the parent directory and modify it */
+  status = fsal_check_access(p_context, FSAL_W_OK | FSAL_X_OK, &dir->attrs, NULL);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  dirent = mem_dir_lookup(dir, p_object_name->name);
+  if(dirent == NULL)
+    {
+      status.major = ERR_FSAL_NOENT;
+      status.minor = ENOENT;
+      goto out;
+    }
+
+  status = mem_dir_unlink(p_context, dir, dirent);
+  if(FSAL_IS_ERROR(status))
+    goto out;
+
+  /* Post operation attributes of the parent directory */
+  mem_getattrs_locked(dir, p_parent_directory_attributes);
+
+ out:
+  pthread_rwlock_unlock(&dir->lock);
+  mem_inode_put(dir);
+
+  ReturnStatus(status, INDEX_FSAL_unlink);
+}
@@ -0,0 +1,206 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file    fsal_xattrs.c
+ * \brief   Extended attributes functions.
+ *
+ * The store keeps no extended attributes: objects have none, and
+ * none can be set.
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_internal.h"
+
+/**
+ * Get the attributes of an extended attribute from its index.
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param p_context pointer to the current security context.
+ * \param xattr_cookie xattr's cookie (as returned by listxattrs).
+ * \param p_attrs xattr's attributes.
+ */
+fsal_status_t MEMFSAL_GetXAttrAttrs(fsal_handle_t * p_objecthandle,  /* IN */
+                                    fsal_op_context_t * p_context,   /* IN */
+                                    unsigned int xattr_id,      /* IN */
+                                    fsal_attrib_list_t * p_attrs
+                                          /**< IN/OUT xattr attributes (if supported) */
+    )
+{
+  /* sanity checks */
+  if(!p_objecthandle || !p_context || !p_attrs)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrAttrs);
+
+  Return(ERR_FSAL_NOENT, ENOENT, INDEX_FSAL_GetXAttrAttrs);
+}
+
+/**
+ * Retrieves the list of extended attributes for an object in the filesystem.
+ *
+ * \param p_objecthandle Handle of the object we want to get extended attributes.
+ * \param cookie index of the next entry to be returned.
+ * \param p_context pointer to the current security context.
+ * \param xattrs_tab a table for storing extended attributes list to.
+ * \param xattrs_tabsize the maximum number of xattr entries that xattrs_tab
+ *            can contain.
+ * \param p_nb_returned the number of xattr entries actually stored in xattrs_tab.
+ * \param end_of_list this boolean indicates that the end of xattrs list has been reached.
+ */
+fsal_status_t MEMFSAL_ListXAttrs(fsal_handle_t * p_objecthandle,     /* IN */
+                                 unsigned int cookie,   /* IN */
+                                 fsal_op_context_t * p_context,      /* IN */
+                                 fsal_xattrent_t * xattrs_tab,  /* IN/OUT */
+                                 unsigned int xattrs_tabsize,   /* IN */
+                                 unsigned int *p_nb_returned,   /* OUT */
+                                 int *end_of_list       /* OUT */
+    )
+{
+  /* sanity checks */
+  if(!p_objecthandle || !p_context || !xattrs_tab || !p_nb_returned || !end_of_list)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_ListXAttrs);
+
+  *p_nb_returned = 0;
+  *end_of_list = TRUE;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_ListXAttrs);
+}
+
+/**
+ * Get the value of an extended attribute from its index.
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param xattr_id index of the attribute (as returned by listxattrs).
+ * \param p_context pointer to the current security context.
+ * \param buffer_addr address of the buffer where the xattr value is to be stored.
+ * \param buffer_size size of the buffer where the xattr value is to be stored.
+ * \param p_output_size size of the data actually stored into the buffer.
+ */
+fsal_status_t MEMFSAL_GetXAttrValueById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        unsigned int xattr_id,  /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        caddr_t buffer_addr,    /* IN/OUT */
+                                        size_t buffer_size,     /* IN */
+                                        size_t * p_output_size  /* OUT */
+    )
+{
+  /* sanity checks */
+  if(!p_objecthandle || !p_context || !p_output_size || !buffer_addr)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrValue);
+
+  Return(ERR_FSAL_NOENT, ENOENT, INDEX_FSAL_GetXAttrValue);
+}
+
+/**
+ * Get the index of an xattr based on its name
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param xattr_name the name of the attribute to be read.
+ * \param pxattr_id found xattr_id
+ */
+fsal_status_t MEMFSAL_GetXAttrIdByName(fsal_handle_t * p_objecthandle,       /* IN */
+                                       const fsal_name_t * xattr_name,  /* IN */
+                                       fsal_op_context_t * p_context,        /* IN */
+                                       unsigned int *pxattr_id  /* OUT */
+    )
+{
+  /* sanity checks */
+  if(!p_objecthandle || !xattr_name || !pxattr_id)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrValue);
+
+  Return(ERR_FSAL_NOENT, ENOENT, INDEX_FSAL_GetXAttrValue);
+}
+
+/**
+ * Get the value of an extended attribute from its name.
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param xattr_name the name of the attribute to be read.
+ * \param p_context pointer to the current security context.
+ * \param buffer_addr address of the buffer where the xattr value is to be stored.
+ * \param buffer_size size of the buffer where the xattr value is to be stored.
+ * \param p_output_size size of the data actually stored into the buffer.
+ */
+fsal_status_t MEMFSAL_GetXAttrValueByName(fsal_handle_t * p_objecthandle,    /* IN */
+                                          const fsal_name_t * xattr_name,       /* IN */
+                                          fsal_op_context_t * p_context,     /* IN */
+                                          caddr_t buffer_addr,  /* IN/OUT */
+                                          size_t buffer_size,   /* IN */
+                                          size_t * p_output_size        /* OUT */
+    )
+{
+  /* sanity checks */
+  if(!p_objecthandle || !p_context || !p_output_size || !buffer_addr || !xattr_name)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_GetXAttrValue);
+
+  Return(ERR_FSAL_NOENT, ENOENT, INDEX_FSAL_GetXAttrValue);
+}
+
+fsal_status_t MEMFSAL_SetXAttrValue(fsal_handle_t * p_objecthandle,  /* IN */
+                                    const fsal_name_t * xattr_name,     /* IN */
+                                    fsal_op_context_t * p_context,   /* IN */
+                                    caddr_t buffer_addr,        /* IN */
+                                    size_t buffer_size, /* IN */
+                                    int create  /* IN */
+    )
+{
+  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_SetXAttrValue);
+}
+
+fsal_status_t MEMFSAL_SetXAttrValueById(fsal_handle_t * p_objecthandle,      /* IN */
+                                        unsigned int xattr_id,  /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        caddr_t buffer_addr,    /* IN */
+                                        size_t buffer_size      /* IN */
+    )
+{
+  Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_SetXAttrValue);
+}
+
+/**
+ *  Removes a xattr by Id
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param p_context pointer to the current security context.
+ * \param xattr_id xattr's id
+ */
+fsal_status_t MEMFSAL_RemoveXAttrById(fsal_handle_t * p_objecthandle,        /* IN */
+                                      fsal_op_context_t * p_context, /* IN */
+                                      unsigned int xattr_id)    /* IN */
+{
+  ReturnCode(ERR_FSAL_NOTSUPP, 0);
+}
+
+/**
+ *  Removes a xattr by Name
+ *
+ * \param p_objecthandle Handle of the object you want to get attribute for.
+ * \param p_context pointer to the current security context.
+ * \param xattr_name xattr's name
+ */
+fsal_status_t MEMFSAL_RemoveXAttrByName(fsal_handle_t * p_objecthandle,      /* IN */
+                                        fsal_op_context_t * p_context,       /* IN */
+                                        const fsal_name_t * xattr_name) /* IN */
+{
+  ReturnCode(ERR_FSAL_NOTSUPP, 0);
+}
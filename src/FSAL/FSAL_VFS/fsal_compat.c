@@ -91,6 +91,14 @@ fsal_functions_t fsal_vfs_functions = {
   .fsal_removexattrbyname = VFSFSAL_RemoveXAttrByName,
   .fsal_getextattrs = COMMON_getextattrs_notsupp,
   .fsal_getfileno = VFSFSAL_GetFileno,
+  .fsal_read_splice = VFSFSAL_read_splice,
+  .fsal_read_hint = VFSFSAL_read_hint,
+#ifdef _USE_FSAL_UP
+  .fsal_up_init = VFSFSAL_UP_Init,
+  .fsal_up_addfilter = VFSFSAL_UP_AddFilter,
+  .fsal_up_getevents = VFSFSAL_UP_GetEvents,
+  .fsal_up_shutdown = VFSFSAL_UP_Shutdown,
+#endif /* _USE_FSAL_UP */
   .fsal_share_op = COMMON_share_op_notsupp
 };
 
@@ -102,7 +110,8 @@ fsal_const_t fsal_vfs_consts = {
   .fsal_cookie_t_size = sizeof(vfsfsal_cookie_t),
   .fsal_cred_t_size = sizeof(struct user_credentials),
   .fs_specific_initinfo_t_size = sizeof(vfsfs_specific_initinfo_t),
-  .fsal_dir_t_size = sizeof(vfsfsal_dir_t)
+  .fsal_dir_t_size = sizeof(vfsfsal_dir_t),
+  .fsal_handle_exact_len = TRUE
 };
 
 fsal_functions_t FSAL_GetFunctions(void)
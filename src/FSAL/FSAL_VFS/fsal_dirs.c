@@ -92,7 +92,10 @@ fsal_status_t VFSFSAL_opendir(fsal_handle_t * p_dir_handle,  /* IN */
   /* if everything is OK, fills the dir_desc structure : */
 
   memcpy(&(p_dir_descriptor->context), p_context, sizeof(vfsfsal_op_context_t));
-  memcpy(&(p_dir_descriptor->handle), p_dir_handle, sizeof(vfsfsal_handle_t));
+  memset(&(p_dir_descriptor->handle), 0, sizeof(vfsfsal_handle_t));
+  memcpy(&(p_dir_descriptor->handle), p_dir_handle,
+         vfs_sizeof_handle((struct file_handle *)
+                           &((vfsfsal_handle_t *) p_dir_handle)->data.vfs_handle));
 
   if(p_dir_attributes)
     {
@@ -39,6 +39,7 @@
 #include "fsal_internal.h"
 #include "FSAL/access_check.h"
 #include "fsal_convert.h"
+#include <fcntl.h>
 
 /**
  * FSAL_open_byname:
@@ -337,6 +338,98 @@ fsal_status_t VFSFSAL_read(fsal_file_t * file_desc,        /* IN */
 
 }
 
+/**
+ * FSAL_read_splice:
+ * Size a read operation on an opened file, for the caller to splice
+ * the data from the file itself.
+ *
+ * Nothing is read: the amount and end of file are those a read would
+ * give now, and the caller splices the data from the descriptor it
+ * gets when it needs them, the file possibly having changed meanwhile.
+ *
+ * \param file_descriptor (input):
+ *        The file descriptor returned by FSAL_open.
+ * \param seek_descriptor (input):
+ *        Specifies the position where data is to be read, with
+ *        FSAL_SEEK_SET.
+ * \param read_size (input):
+ *        Amount (in bytes) of data to be read.
+ * \param p_file_fd (output):
+ *        A new descriptor of the file, which the caller closes, when
+ *        read_amount is not 0.
+ * \param read_amount (output):
+ *        Pointer to the amount of data (in bytes) that a read would
+ *        get.
+ * \param end_of_file (output):
+ *        Pointer to a boolean that indicates whether such a read
+ *        reaches the end of file.
+ *
+ * \return Major error codes:
+ *      - ERR_FSAL_NO_ERROR: no error.
+ *      - ERR_FSAL_NOTSUPP: the file cannot be spliced, use FSAL_read.
+ *      - Another error code if an error occured during this call.
+ */
+fsal_status_t VFSFSAL_read_splice(fsal_file_t * file_desc,      /* IN */
+                                  fsal_seek_t * p_seek_descriptor,      /* [IN] */
+                                  fsal_size_t read_size,        /* IN */
+                                  int * p_file_fd,      /* OUT */
+                                  fsal_size_t * p_read_amount,  /* OUT */
+                                  fsal_boolean_t * p_end_of_file        /* OUT */
+    )
+{
+  vfsfsal_file_t * p_file_descriptor = (vfsfsal_file_t *) file_desc;
+  struct stat buffstat;
+  fsal_off_t offset;
+  int rc, errsv;
+
+  /* sanity checks. */
+
+  if(!p_file_descriptor || !p_seek_descriptor || !p_file_fd ||
+     !p_read_amount || !p_end_of_file)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_read);
+
+  if(p_seek_descriptor->whence != FSAL_SEEK_SET)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_read);
+
+  offset = p_seek_descriptor->offset;
+  *p_read_amount = 0;
+  *p_end_of_file = FALSE;
+
+  TakeTokenFSCall();
+  rc = fstat(p_file_descriptor->fd, &buffstat);
+  errsv = errno;
+  ReleaseTokenFSCall();
+
+  if(rc != 0)
+    Return(posix2fsal_error(errsv), errsv, INDEX_FSAL_read);
+
+  /* Only the page cache of regular files can be spliced */
+  if(!S_ISREG(buffstat.st_mode))
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_read);
+
+  if(offset < (fsal_off_t) buffstat.st_size)
+    {
+      *p_read_amount = buffstat.st_size - offset;
+      if(*p_read_amount > read_size)
+        *p_read_amount = read_size;
+    }
+  *p_end_of_file = offset + *p_read_amount >= (fsal_off_t) buffstat.st_size;
+
+  if(*p_read_amount == 0)
+    Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_read);
+
+  *p_file_fd = fcntl(p_file_descriptor->fd, F_DUPFD_CLOEXEC, 0);
+  if(*p_file_fd < 0)
+    {
+      errsv = errno;
+      *p_read_amount = 0;
+      Return(posix2fsal_error(errsv), errsv, INDEX_FSAL_read);
+    }
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_read);
+
+}
+
 /**
  * FSAL_write:
  * Perform a write operation on an opened file.
@@ -33,6 +33,7 @@
  */
 
 #include "fsal.h"
+#include "fsal_up.h"
 #include <sys/stat.h>
 #include "FSAL/common_functions.h"
 
@@ -211,6 +212,17 @@ fsal_status_t VFSFSAL_read(fsal_file_t * p_file_descriptor,  /* IN */
                            fsal_size_t * p_read_amount, /* OUT */
                            fsal_boolean_t * p_end_of_file /* OUT */ );
 
+fsal_status_t VFSFSAL_read_splice(fsal_file_t * p_file_descriptor,   /* IN */
+                                  fsal_seek_t * p_seek_descriptor,      /* [IN] */
+                                  fsal_size_t read_size,        /* IN */
+                                  int * p_file_fd,      /* OUT */
+                                  fsal_size_t * p_read_amount,  /* OUT */
+                                  fsal_boolean_t * p_end_of_file /* OUT */ );
+
+fsal_status_t VFSFSAL_read_hint(fsal_file_t * p_file_descriptor,     /* IN */
+                                fsal_off_t offset,      /* IN */
+                                fsal_size_t length /* IN */ );
+
 fsal_status_t VFSFSAL_write(fsal_file_t * p_file_descriptor, /* IN */
                             fsal_op_context_t * p_context,   /* IN */
                             fsal_seek_t * p_seek_descriptor,    /* IN */
@@ -386,3 +398,16 @@ unsigned int VFSFSAL_GetFileno(fsal_file_t * pfile);
 fsal_status_t VFSFSAL_commit( fsal_file_t * p_file_descriptor,
                             fsal_off_t    offset,
                             fsal_size_t   size ) ;
+
+#ifdef _USE_FSAL_UP
+fsal_status_t VFSFSAL_UP_Init( fsal_up_event_bus_parameter_t * pebparam,      /* IN */
+                               fsal_up_event_bus_context_t * pupebcontext     /* OUT */);
+fsal_status_t VFSFSAL_UP_AddFilter( fsal_up_event_bus_filter_t * pupebfilter,  /* IN */
+                                    fsal_up_event_bus_context_t * pupebcontext /* INOUT */ );
+fsal_status_t VFSFSAL_UP_GetEvents( struct glist_head * pevent_head,           /* OUT */
+                                    fsal_count_t * event_nb,                   /* IN */
+                                    fsal_time_t timeout,                       /* IN */
+                                    fsal_count_t * peventfound,                /* OUT */
+                                    fsal_up_event_bus_context_t * pupebcontext /* IN */ );
+fsal_status_t VFSFSAL_UP_Shutdown( fsal_up_event_bus_context_t * pupebcontext /* INOUT */ );
+#endif /* _USE_FSAL_UP */
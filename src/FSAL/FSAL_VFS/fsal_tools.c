@@ -83,7 +83,9 @@ int VFSFSAL_handlecmp(fsal_handle_t * handle_1, fsal_handle_t * handle_2,
   if(handle1->data.vfs_handle.handle_bytes != handle2->data.vfs_handle.handle_bytes)
     return -2;
 
-  if(memcmp(&handle1->data.vfs_handle, &handle2->data.vfs_handle, sizeof( vfs_file_handle_t) ) )
+  /* Only the bytes of the handle, it may be stored in no more */
+  if(memcmp(&handle1->data.vfs_handle, &handle2->data.vfs_handle,
+            vfs_sizeof_handle((struct file_handle *)&handle1->data.vfs_handle)))
     return -3;
 
   return 0;
@@ -0,0 +1,755 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ *
+ * \file    fsal_up.c
+ * \brief   FSAL Upcall Interface
+ *
+ * Changes made to the exported filesystem by local processes are
+ * turned into FSAL UP events, so that cached attributes and dirents
+ * need not expire to be coherent with them.
+ *
+ * fanotify is used when the kernel supports reporting file handles
+ * (Linux 5.1): the whole filesystem is marked once, and every event
+ * carries the handle of the object changed, or of the directory whose
+ * content changed.  Changes made by this process are ignored, the
+ * cache knows of them already.  Otherwise inotify is used, with a
+ * watch on every directory of the filesystem, which is bound by
+ * fs.inotify.max_user_watches.  inotify does not tell who made a
+ * change, so our own changes are reported as well.
+ *
+ */
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "fsal.h"
+#include "fsal_up.h"
+#include "fsal_internal.h"
+#include "fsal_convert.h"
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <poll.h>
+#include <dirent.h>
+#include <sys/time.h>
+#ifdef HAVE_SYS_FANOTIFY_H
+#include <sys/fanotify.h>
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+
+#ifdef _USE_FSAL_UP
+
+#if defined(HAVE_SYS_FANOTIFY_H) && defined(FAN_REPORT_FID) && \
+    defined(FAN_MARK_FILESYSTEM)
+#define VFS_UP_FANOTIFY
+#endif
+
+#define VFS_UP_BUFSIZE     65536
+#define VFS_UP_WD_BUCKETS  1024
+
+#define VFS_UP_INOTIFY_MASK (IN_MODIFY | IN_ATTRIB | IN_CREATE | IN_DELETE | \
+                             IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | \
+                             IN_ONLYDIR | IN_DONT_FOLLOW | IN_EXCL_UNLINK)
+
+/* A directory watched through inotify */
+typedef struct vfs_up_watch__
+{
+  struct glist_head wd_list;
+  struct glist_head scan_list;  /* while its subdirectories are watched */
+  int wd;
+  vfs_file_handle_t handle;
+} vfs_up_watch_t;
+
+/* The event source of one filesystem */
+typedef struct vfs_up_source__
+{
+  int notify_fd;
+  bool_t fanotify;
+  int mount_root_fd;
+  pid_t self;
+  dev_t dev;
+  /* inotify only: watches by descriptor */
+  struct glist_head wd_buckets[VFS_UP_WD_BUCKETS];
+  unsigned int nb_watches;
+  bool_t watches_exhausted;
+  /* Last event queued by the current call, to skip repeats */
+  unsigned int last_type;
+  vfs_file_handle_t last_handle;
+  char buf[VFS_UP_BUFSIZE];
+} vfs_up_source_t;
+
+/**
+ * vfs_up_push_event:
+ * Queue an event on a handle reported by the kernel.
+ * An event identical to the previous one of the call is dropped:
+ * the cache entry is invalidated already.
+ */
+static void vfs_up_push_event(vfs_up_source_t * src,
+                              struct glist_head *pevent_head,
+                              fsal_count_t * event_nb,
+                              fsal_up_event_bus_context_t * pupebcontext,
+                              vfs_file_handle_t * handle,
+                              unsigned int event_type,
+                              int upu_flags)
+{
+  vfsfsal_handle_t *phandle;
+  cache_inode_fsal_data_t *event_fsal_data;
+  fsal_up_event_t *pevent;
+  size_t hlen = vfs_sizeof_handle((struct file_handle *)handle);
+
+  if(src->last_type == event_type &&
+     memcmp(&src->last_handle, handle, hlen) == 0)
+    return;
+
+  phandle = gsh_calloc(1, sizeof(vfsfsal_handle_t));
+  if(phandle == NULL)
+    {
+      LogCrit(COMPONENT_FSAL, "Error: Could not malloc ... ENOMEM");
+      return;
+    }
+  memcpy(&phandle->data.vfs_handle, handle, hlen);
+
+  pthread_mutex_lock(pupebcontext->event_pool_lock);
+  pevent = pool_alloc(pupebcontext->event_pool, NULL);
+  pthread_mutex_unlock(pupebcontext->event_pool_lock);
+  if(pevent == NULL)
+    {
+      LogCrit(COMPONENT_FSAL, "Error: Could not allocate an FSAL UP event");
+      gsh_free(phandle);
+      return;
+    }
+  memset(&pevent->event_data, 0, sizeof(pevent->event_data));
+
+  event_fsal_data = &pevent->event_data.event_context.fsal_data;
+  event_fsal_data->fh_desc.start = (caddr_t)phandle;
+  event_fsal_data->hash = 0;
+  event_fsal_data->fh_desc.len = sizeof(*phandle);
+  VFSFSAL_ExpandHandle(NULL, FSAL_DIGEST_SIZEOF, &(event_fsal_data->fh_desc));
+
+  pevent->event_type = event_type;
+  if(event_type == FSAL_UP_EVENT_UPDATE)
+    pevent->event_data.type.update.upu_flags = upu_flags;
+
+  glist_add_tail(pevent_head, &pevent->event_list);
+  (*event_nb)++;
+
+  src->last_type = event_type;
+  memcpy(&src->last_handle, handle, hlen);
+}
+
+/**
+ * vfs_up_push_invalidate_all:
+ * Queue an event on no handle, for when the kernel dropped events:
+ * which entries they were about is not known.
+ */
+static void vfs_up_push_invalidate_all(struct glist_head *pevent_head,
+                                       fsal_count_t * event_nb,
+                                       fsal_up_event_bus_context_t * pupebcontext)
+{
+  fsal_up_event_t *pevent;
+
+  pthread_mutex_lock(pupebcontext->event_pool_lock);
+  pevent = pool_alloc(pupebcontext->event_pool, NULL);
+  pthread_mutex_unlock(pupebcontext->event_pool_lock);
+  if(pevent == NULL)
+    {
+      LogCrit(COMPONENT_FSAL, "Error: Could not allocate an FSAL UP event");
+      return;
+    }
+  memset(&pevent->event_data, 0, sizeof(pevent->event_data));
+
+  pevent->event_type = FSAL_UP_EVENT_INVALIDATE_ALL;
+  glist_add_tail(pevent_head, &pevent->event_list);
+  (*event_nb)++;
+}
+
+#ifdef VFS_UP_FANOTIFY
+
+static int vfs_up_fanotify_init(vfs_up_source_t * src)
+{
+  uint64_t mask = FAN_MODIFY | FAN_ATTRIB | FAN_CREATE | FAN_DELETE |
+                  FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE_SELF | FAN_ONDIR;
+
+  /* The queue is unbounded: an overflow would lose changes we have no
+   * other way of learning of. */
+  src->notify_fd = fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_FID |
+                                 FAN_UNLIMITED_QUEUE | FAN_CLOEXEC |
+                                 FAN_NONBLOCK, O_RDONLY);
+  if(src->notify_fd < 0)
+    return errno;
+
+  if(fanotify_mark(src->notify_fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM,
+                   mask, src->mount_root_fd, NULL) != 0)
+    {
+      int rc = errno;
+
+      close(src->notify_fd);
+      src->notify_fd = -1;
+      return rc;
+    }
+
+  src->fanotify = TRUE;
+  return 0;
+}
+
+/* One fanotify event is one event on the reported handle: all the
+ * FSAL UP handlers invalidate the entry the same way, but an unlinked
+ * object also has its file descriptors closed. */
+static void vfs_up_fanotify_parse(vfs_up_source_t * src, ssize_t len,
+                                  struct glist_head *pevent_head,
+                                  fsal_count_t * event_nb,
+                                  fsal_up_event_bus_context_t * pupebcontext)
+{
+  struct fanotify_event_metadata *md;
+  struct fanotify_event_info_fid *fid;
+  struct file_handle *fh;
+  unsigned int event_type;
+  int upu_flags = 0;
+
+  for(md = (struct fanotify_event_metadata *)src->buf;
+      FAN_EVENT_OK(md, len);
+      md = FAN_EVENT_NEXT(md, len))
+    {
+      if(md->vers != FANOTIFY_METADATA_VERSION)
+        {
+          LogCrit(COMPONENT_FSAL,
+                  "Error: fanotify metadata version %u, expected %u",
+                  md->vers, FANOTIFY_METADATA_VERSION);
+          return;
+        }
+      upu_flags = 0;
+
+      if(md->mask & FAN_Q_OVERFLOW)
+        {
+          LogCrit(COMPONENT_FSAL,
+                  "fanotify queue overflow, every cached entry is "
+                  "invalidated");
+          vfs_up_push_invalidate_all(pevent_head, event_nb, pupebcontext);
+          continue;
+        }
+
+      if(md->pid == src->self)
+        continue;
+
+      fid = (struct fanotify_event_info_fid *)(md + 1);
+      if((char *)(fid + 1) > (char *)md + md->event_len ||
+         fid->hdr.info_type != FAN_EVENT_INFO_TYPE_FID)
+        continue;
+
+      fh = (struct file_handle *)fid->handle;
+      if(fh->handle_bytes > VFS_HANDLE_LEN)
+        {
+          LogDebug(COMPONENT_FSAL,
+                   "fanotify handle of %u bytes is too large, ignored",
+                   fh->handle_bytes);
+          continue;
+        }
+
+      if(md->mask & FAN_DELETE_SELF)
+        {
+          event_type = FSAL_UP_EVENT_UPDATE;
+          upu_flags = FSAL_UP_NLINK;
+        }
+      else if(md->mask & FAN_CREATE)
+        event_type = FSAL_UP_EVENT_CREATE;
+      else if(md->mask & FAN_DELETE)
+        event_type = FSAL_UP_EVENT_UNLINK;
+      else if(md->mask & (FAN_MOVED_FROM | FAN_MOVED_TO))
+        event_type = FSAL_UP_EVENT_RENAME;
+      else if(md->mask & FAN_ATTRIB)
+        {
+          event_type = FSAL_UP_EVENT_UPDATE;
+          upu_flags = FSAL_UP_MODE | FSAL_UP_OWN | FSAL_UP_TIMES;
+        }
+      else if(md->mask & FAN_MODIFY)
+        {
+          event_type = FSAL_UP_EVENT_UPDATE;
+          upu_flags = FSAL_UP_SIZE | FSAL_UP_TIMES;
+        }
+      else
+        continue;
+
+      LogFullDebug(COMPONENT_FSAL,
+                   "fanotify mask %llx pid %d: event %u",
+                   (unsigned long long)md->mask, (int)md->pid, event_type);
+
+      vfs_up_push_event(src, pevent_head, event_nb, pupebcontext,
+                        (vfs_file_handle_t *)fh, event_type, upu_flags);
+    }
+}
+
+#endif /* VFS_UP_FANOTIFY */
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+static vfs_up_watch_t *vfs_up_watch_lookup(vfs_up_source_t * src, int wd)
+{
+  struct glist_head *glist;
+  vfs_up_watch_t *watch;
+
+  glist_for_each(glist, &src->wd_buckets[wd % VFS_UP_WD_BUCKETS])
+    {
+      watch = glist_entry(glist, vfs_up_watch_t, wd_list);
+      if(watch->wd == wd)
+        return watch;
+    }
+
+  return NULL;
+}
+
+static void vfs_up_watch_forget(vfs_up_source_t * src, int wd)
+{
+  vfs_up_watch_t *watch = vfs_up_watch_lookup(src, wd);
+
+  if(watch == NULL)
+    return;
+
+  glist_del(&watch->wd_list);
+  gsh_free(watch);
+  src->nb_watches--;
+}
+
+/**
+ * vfs_up_watch_add:
+ * Watch one directory.  Returns the new watch, or NULL if it is not
+ * watched or was already.  The descriptor is left open.
+ */
+static vfs_up_watch_t *vfs_up_watch_add(vfs_up_source_t * src, int dirfd)
+{
+  char path[64];
+  vfs_up_watch_t *watch;
+  int wd, mnt_id;
+
+  if(src->watches_exhausted)
+    return NULL;
+
+  snprintf(path, sizeof(path), "/proc/self/fd/%d", dirfd);
+  wd = inotify_add_watch(src->notify_fd, path, VFS_UP_INOTIFY_MASK);
+  if(wd < 0)
+    {
+      if(errno == ENOSPC)
+        {
+          LogCrit(COMPONENT_FSAL,
+                  "inotify watch limit reached after %u directories, "
+                  "raise fs.inotify.max_user_watches: changes made outside "
+                  "of the server to other directories are missed",
+                  src->nb_watches);
+          src->watches_exhausted = TRUE;
+        }
+      return NULL;
+    }
+
+  /* Already watched, reached again through a rename */
+  if(vfs_up_watch_lookup(src, wd) != NULL)
+    return NULL;
+
+  watch = gsh_calloc(1, sizeof(vfs_up_watch_t));
+  if(watch == NULL)
+    {
+      inotify_rm_watch(src->notify_fd, wd);
+      return NULL;
+    }
+  watch->wd = wd;
+  watch->handle.handle_bytes = VFS_HANDLE_LEN;
+  if(vfs_fd_to_handle(dirfd, &watch->handle, &mnt_id) != 0)
+    {
+      gsh_free(watch);
+      inotify_rm_watch(src->notify_fd, wd);
+      return NULL;
+    }
+  glist_add_tail(&src->wd_buckets[wd % VFS_UP_WD_BUCKETS], &watch->wd_list);
+  src->nb_watches++;
+
+  return watch;
+}
+
+/**
+ * vfs_up_watch_tree:
+ * Watch a directory and every directory under it on the same
+ * filesystem.  The tree is walked breadth first from the handles of
+ * the watches, so that one directory only is open at a time however
+ * deep the tree.  The descriptor is closed on return.
+ */
+static void vfs_up_watch_tree(vfs_up_source_t * src, int dirfd)
+{
+  struct glist_head scan;
+  vfs_up_watch_t *watch, *child;
+  struct dirent *dentry;
+  struct stat st;
+  DIR *dir;
+  int fd;
+
+  init_glist(&scan);
+
+  watch = vfs_up_watch_add(src, dirfd);
+  close(dirfd);
+  if(watch == NULL)
+    return;
+  glist_add_tail(&scan, &watch->scan_list);
+
+  while(!glist_empty(&scan))
+    {
+      watch = glist_first_entry(&scan, vfs_up_watch_t, scan_list);
+      glist_del(&watch->scan_list);
+
+      if(src->watches_exhausted)
+        continue;
+
+      dirfd = vfs_open_by_handle(src->mount_root_fd, &watch->handle,
+                                 O_RDONLY | O_DIRECTORY);
+      if(dirfd < 0)
+        continue;
+
+      dir = fdopendir(dirfd);
+      if(dir == NULL)
+        {
+          close(dirfd);
+          continue;
+        }
+
+      while((dentry = readdir(dir)) != NULL)
+        {
+          if(dentry->d_type != DT_DIR && dentry->d_type != DT_UNKNOWN)
+            continue;
+          if(!strcmp(dentry->d_name, ".") || !strcmp(dentry->d_name, ".."))
+            continue;
+
+          fd = openat(dirfd, dentry->d_name,
+                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+          if(fd < 0)
+            continue;
+
+          /* Stay on the exported filesystem */
+          if(fstat(fd, &st) == 0 && st.st_dev == src->dev)
+            {
+              child = vfs_up_watch_add(src, fd);
+              if(child != NULL)
+                glist_add_tail(&scan, &child->scan_list);
+            }
+          close(fd);
+        }
+
+      closedir(dir);
+    }
+}
+
+static int vfs_up_inotify_init(vfs_up_source_t * src)
+{
+  int fd;
+
+  src->notify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if(src->notify_fd < 0)
+    return errno;
+
+  fd = openat(src->mount_root_fd, ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if(fd < 0)
+    {
+      int rc = errno;
+
+      close(src->notify_fd);
+      src->notify_fd = -1;
+      return rc;
+    }
+
+  vfs_up_watch_tree(src, fd);
+
+  LogEvent(COMPONENT_FSAL, "FSAL_UP: watching %u directories with inotify",
+           src->nb_watches);
+  return 0;
+}
+
+/* Changes to the content of a directory are events on it, changes to
+ * the attributes of an object are events on the object, whose handle
+ * is found by name in the directory. */
+static void vfs_up_inotify_parse(vfs_up_source_t * src, ssize_t len,
+                                 struct glist_head *pevent_head,
+                                 fsal_count_t * event_nb,
+                                 fsal_up_event_bus_context_t * pupebcontext)
+{
+  struct inotify_event *ie;
+  vfs_up_watch_t *watch;
+  vfs_file_handle_t handle;
+  unsigned int event_type;
+  int upu_flags = 0;
+  char *ptr;
+  int dirfd, fd;
+
+  for(ptr = src->buf; ptr < src->buf + len;
+      ptr += sizeof(struct inotify_event) + ie->len)
+    {
+      ie = (struct inotify_event *)ptr;
+
+      if(ie->mask & IN_Q_OVERFLOW)
+        {
+          LogCrit(COMPONENT_FSAL,
+                  "inotify queue overflow, every cached entry is "
+                  "invalidated");
+          vfs_up_push_invalidate_all(pevent_head, event_nb, pupebcontext);
+          continue;
+        }
+
+      if(ie->mask & IN_IGNORED)
+        {
+          vfs_up_watch_forget(src, ie->wd);
+          continue;
+        }
+
+      watch = vfs_up_watch_lookup(src, ie->wd);
+      if(watch == NULL)
+        continue;
+
+      if(ie->mask & IN_DELETE_SELF)
+        {
+          vfs_up_push_event(src, pevent_head, event_nb, pupebcontext,
+                            &watch->handle, FSAL_UP_EVENT_UPDATE,
+                            FSAL_UP_NLINK);
+          continue;
+        }
+
+      if(ie->mask & (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))
+        {
+          if(ie->mask & IN_CREATE)
+            event_type = FSAL_UP_EVENT_CREATE;
+          else if(ie->mask & IN_DELETE)
+            event_type = FSAL_UP_EVENT_UNLINK;
+          else
+            event_type = FSAL_UP_EVENT_RENAME;
+
+          vfs_up_push_event(src, pevent_head, event_nb, pupebcontext,
+                            &watch->handle, event_type, 0);
+
+          /* A new directory, or one moved in, is to be watched too */
+          if((ie->mask & IN_ISDIR) && (ie->mask & (IN_CREATE | IN_MOVED_TO))
+             && ie->len != 0)
+            {
+              dirfd = vfs_open_by_handle(src->mount_root_fd, &watch->handle,
+                                         O_RDONLY | O_DIRECTORY);
+              if(dirfd < 0)
+                continue;
+              fd = openat(dirfd, ie->name,
+                          O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+              close(dirfd);
+              if(fd >= 0)
+                vfs_up_watch_tree(src, fd);
+            }
+          continue;
+        }
+
+      if(ie->mask & IN_ATTRIB)
+        upu_flags = FSAL_UP_MODE | FSAL_UP_OWN | FSAL_UP_TIMES;
+      else if(ie->mask & IN_MODIFY)
+        upu_flags = FSAL_UP_SIZE | FSAL_UP_TIMES;
+      else
+        continue;
+
+      if(ie->len == 0)
+        {
+          /* The watched directory itself */
+          vfs_up_push_event(src, pevent_head, event_nb, pupebcontext,
+                            &watch->handle, FSAL_UP_EVENT_UPDATE, upu_flags);
+          continue;
+        }
+
+      dirfd = vfs_open_by_handle(src->mount_root_fd, &watch->handle,
+                                 O_PATH | O_NOACCESS);
+      if(dirfd < 0)
+        continue;
+      memset(&handle, 0, sizeof(handle));
+      handle.handle_bytes = VFS_HANDLE_LEN;
+      if(vfs_name_by_handle_at(dirfd, ie->name, &handle) == 0)
+        vfs_up_push_event(src, pevent_head, event_nb, pupebcontext,
+                          &handle, FSAL_UP_EVENT_UPDATE, upu_flags);
+      close(dirfd);
+    }
+}
+
+#endif /* HAVE_SYS_INOTIFY_H */
+
+fsal_status_t VFSFSAL_UP_Init( fsal_up_event_bus_parameter_t * pebparam,      /* IN */
+                                  fsal_up_event_bus_context_t * pupebcontext     /* OUT */)
+{
+  vfsfsal_export_context_t *p_export_context;
+  vfs_up_source_t *src;
+  struct stat st;
+  int rc = ENOSYS;
+  unsigned int i;
+
+  if(pupebcontext == NULL)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_UP_init);
+
+  p_export_context =
+    (vfsfsal_export_context_t *)&pupebcontext->FS_export_context;
+
+  src = gsh_calloc(1, sizeof(vfs_up_source_t));
+  if(src == NULL)
+    Return(ERR_FSAL_NOMEM, ENOMEM, INDEX_FSAL_UP_init);
+
+  src->notify_fd = -1;
+  src->mount_root_fd = p_export_context->mount_root_fd;
+  src->self = getpid();
+  for(i = 0; i < VFS_UP_WD_BUCKETS; i++)
+    init_glist(&src->wd_buckets[i]);
+
+  if(fstat(src->mount_root_fd, &st) != 0)
+    {
+      rc = errno;
+      gsh_free(src);
+      Return(posix2fsal_error(rc), rc, INDEX_FSAL_UP_init);
+    }
+  src->dev = st.st_dev;
+
+#ifdef VFS_UP_FANOTIFY
+  rc = vfs_up_fanotify_init(src);
+  if(rc == 0)
+    LogEvent(COMPONENT_FSAL, "FSAL_UP: watching filesystem %s with fanotify",
+             p_export_context->fstype);
+  else
+    LogEvent(COMPONENT_FSAL, "FSAL_UP: fanotify is not available (%s), "
+             "falling back to inotify", strerror(rc));
+#endif
+
+#ifdef HAVE_SYS_INOTIFY_H
+  if(src->notify_fd < 0)
+    rc = vfs_up_inotify_init(src);
+#endif
+
+  if(src->notify_fd < 0)
+    {
+      LogCrit(COMPONENT_FSAL, "FSAL_UP: no event source for filesystem %s: %s",
+              p_export_context->fstype, strerror(rc));
+      gsh_free(src);
+      Return(ERR_FSAL_NOTSUPP, rc, INDEX_FSAL_UP_init);
+    }
+
+  pupebcontext->fsal_data = src;
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_init);
+}
+
+fsal_status_t VFSFSAL_UP_Shutdown( fsal_up_event_bus_context_t * pupebcontext /* INOUT */ )
+{
+  vfs_up_source_t *src;
+  vfs_up_watch_t *watch;
+  unsigned int i;
+
+  if(pupebcontext == NULL)
+    Return(ERR_FSAL_FAULT, 0, INDEX_FSAL_UP_shutdown);
+
+  src = pupebcontext->fsal_data;
+  if(src == NULL)
+    Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_shutdown);
+
+  /* Closing the descriptor drops the watches in the kernel */
+  if(src->notify_fd >= 0)
+    close(src->notify_fd);
+
+  for(i = 0; i < VFS_UP_WD_BUCKETS; i++)
+    while(!glist_empty(&src->wd_buckets[i]))
+      {
+        watch = glist_first_entry(&src->wd_buckets[i], vfs_up_watch_t,
+                                  wd_list);
+        glist_del(&watch->wd_list);
+        gsh_free(watch);
+      }
+
+  gsh_free(src);
+  pupebcontext->fsal_data = NULL;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_shutdown);
+}
+
+fsal_status_t VFSFSAL_UP_AddFilter( fsal_up_event_bus_filter_t * pupebfilter,  /* IN */
+                                       fsal_up_event_bus_context_t * pupebcontext /* INOUT */ )
+{
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_addfilter);
+}
+
+fsal_status_t VFSFSAL_UP_GetEvents( struct glist_head * pevent_head,             /* OUT */
+                                    fsal_count_t * event_nb,                     /* IN */
+                                    fsal_time_t timeout,                         /* IN */
+                                    fsal_count_t * peventfound,                  /* OUT */
+                                    fsal_up_event_bus_context_t * pupebcontext   /* IN */ )
+{
+  vfs_up_source_t *src;
+  struct pollfd pfd;
+  ssize_t len;
+  int msec, rc;
+
+  if(pupebcontext == NULL || event_nb == NULL)
+    {
+      LogDebug(COMPONENT_FSAL, "Error: VFSFSAL_UP_GetEvents() received"
+               " unexpectedly NULL arguments.");
+      Return(ERR_FSAL_INVAL, 0, INDEX_FSAL_UP_getevents);
+    }
+
+  /* FSAL_UP_Init failed */
+  src = pupebcontext->fsal_data;
+  if(src == NULL)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_UP_getevents);
+
+  if(timeout.seconds == 0 && timeout.nseconds == 0)
+    msec = -1;
+  else
+    msec = timeout.seconds * 1000 + timeout.nseconds / 1000000;
+
+  pfd.fd = src->notify_fd;
+  pfd.events = POLLIN;
+  pfd.revents = 0;
+
+  rc = poll(&pfd, 1, msec);
+  if(rc == 0)
+    Return(ERR_FSAL_TIMEOUT, 0, INDEX_FSAL_UP_getevents);
+  if(rc < 0)
+    {
+      rc = errno;
+      if(rc == EINTR)
+        Return(ERR_FSAL_INTERRUPT, rc, INDEX_FSAL_UP_getevents);
+      Return(posix2fsal_error(rc), rc, INDEX_FSAL_UP_getevents);
+    }
+
+  len = read(src->notify_fd, src->buf, sizeof(src->buf));
+  if(len < 0)
+    {
+      rc = errno;
+      if(rc == EAGAIN || rc == EINTR)
+        Return(ERR_FSAL_INTERRUPT, rc, INDEX_FSAL_UP_getevents);
+      LogCrit(COMPONENT_FSAL, "Error: reading FSAL_UP events failed: %s",
+              strerror(rc));
+      Return(posix2fsal_error(rc), rc, INDEX_FSAL_UP_getevents);
+    }
+
+  src->last_type = 0;
+#ifdef VFS_UP_FANOTIFY
+  if(src->fanotify)
+    vfs_up_fanotify_parse(src, len, pevent_head, event_nb, pupebcontext);
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+  if(!src->fanotify)
+    vfs_up_inotify_parse(src, len, pevent_head, event_nb, pupebcontext);
+#endif
+
+  if(peventfound != NULL)
+    *peventfound = *event_nb;
+
+  Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_getevents);
+}
+
+#endif /* _USE_FSAL_UP */
@@ -66,7 +66,7 @@ const char *fsal_function_names[] = {
   "FSAL_close_by_fileid", "FSAL_setattr_access", "FSAL_merge_attrs", "FSAL_rename_access",
   "FSAL_unlink_access", "FSAL_link_access", "FSAL_create_access", "FSAL_unused_49", "FSAL_CleanUpExportContext",
   "FSAL_getextattrs", "FSAL_commit", "FSAL_getattrs_descriptor", "FSAL_lock_op",
-  "FSAL_UP_init", "FSAL_UP_addfilter", "FSAL_UP_getevents", "FSAL_unused_58",
+  "FSAL_UP_init", "FSAL_UP_addfilter", "FSAL_UP_getevents", "FSAL_UP_shutdown",
   "FSAL_layoutget", "FSAL_layoutreturn", "FSAL_layoutcommit", "FSAL_getdeviceinfo",
   "FSAL_getdevicelist", "FSAL_ds_read", "FSAL_ds_write", "FSAL_ds_commit", "FSAL_share_op"
 };
@@ -157,6 +157,10 @@ family_error_t __attribute__ ((__unused__)) tab_errstatus_FSAL[] =
   {
   ERR_FSAL_BLOCKED, "ERR_FSAL_BLOCKED", "Lock Blocked"},
   {
+  ERR_FSAL_TIMEOUT, "ERR_FSAL_TIMEOUT", "Timeout"},
+  {
+  ERR_FSAL_FILE_OPEN, "ERR_FSAL_FILE_OPEN", "File open"},
+  {
   ERR_NULL, "ERR_NULL", ""}
 };
 
@@ -285,6 +285,31 @@ fsal_status_t FSAL_read(fsal_file_t * p_file_descriptor,        /* IN */
                                   buffer, p_read_amount, p_end_of_file);
 }
 
+fsal_status_t FSAL_read_splice(fsal_file_t * p_file_descriptor, /* IN */
+                               fsal_seek_t * p_seek_descriptor, /* [IN] */
+                               fsal_size_t read_size,   /* IN */
+                               int * p_file_fd, /* OUT */
+                               fsal_size_t * p_read_amount,     /* OUT */
+                               fsal_boolean_t * p_end_of_file /* OUT */ )
+{
+  if (fsal_functions.fsal_read_splice == NULL)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_read);
+  else
+    return fsal_functions.fsal_read_splice(p_file_descriptor, p_seek_descriptor,
+                                           read_size, p_file_fd, p_read_amount,
+                                           p_end_of_file);
+}
+
+fsal_status_t FSAL_read_hint(fsal_file_t * p_file_descriptor,   /* IN */
+                             fsal_off_t offset, /* IN */
+                             fsal_size_t length /* IN */ )
+{
+  if (fsal_functions.fsal_read_hint == NULL)
+    Return(ERR_FSAL_NOTSUPP, 0, INDEX_FSAL_read);
+  else
+    return fsal_functions.fsal_read_hint(p_file_descriptor, offset, length);
+}
+
 fsal_status_t FSAL_write(fsal_file_t * p_file_descriptor,       /* IN */
                          fsal_op_context_t * p_context,         /* IN */
                          fsal_seek_t * p_seek_descriptor,       /* IN */
@@ -776,6 +801,14 @@ fsal_status_t FSAL_UP_GetEvents( struct glist_head * pevent_head,            /*
     return fsal_functions.fsal_up_getevents(pevent_head, event_nb, timeout,
                                             peventfound, pupebcontext);
 }
+
+fsal_status_t FSAL_UP_Shutdown( fsal_up_event_bus_context_t * pupebcontext /* INOUT */ )
+{
+  if (fsal_functions.fsal_up_shutdown == NULL)
+    Return(ERR_FSAL_NO_ERROR, 0, INDEX_FSAL_UP_shutdown);
+  else
+    return fsal_functions.fsal_up_shutdown(pupebcontext);
+}
 #endif /* _USE_FSAL_UP */
 
 int FSAL_LoadLibrary(char *path)
@@ -788,11 +821,24 @@ void FSAL_LoadFunctions(void)
   fsal_functions = FSAL_GetFunctions();
 }
 
+/* Put a layer over the loaded functions: the layer is given the table it
+ * sits on and returns the one the glue calls from then on. */
+void FSAL_StackFunctions(fsal_functions_t (*layer) (fsal_functions_t lower))
+{
+  fsal_functions = layer(fsal_functions);
+}
+
 void FSAL_LoadConsts(void)
 {
   fsal_consts = FSAL_GetConsts();
 }
 
+/* Whether handles may be stored in just the length the FSAL gives */
+fsal_boolean_t FSAL_HandleExactLen(void)
+{
+  return fsal_consts.fsal_handle_exact_len != 0;
+}
+
 #ifdef _USE_PNFS_MDS
 void FSAL_LoadMDSFunctions(void)
 {
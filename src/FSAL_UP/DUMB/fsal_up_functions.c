@@ -36,6 +36,7 @@
 #include "log.h"
 #include "fsal.h"
 #include "cache_inode.h"
+#include "cache_inode_lru.h"
 #include "HashTable.h"
 #include "fsal_up.h"
 #include "sal_functions.h"
@@ -98,6 +99,17 @@ fsal_status_t dumb_fsal_up_update(fsal_up_event_data_t * pevdata)
   ReturnCode(ERR_FSAL_NO_ERROR, 0);
 }
 
+/* The FSAL lost track of changes: nothing cached can be trusted */
+fsal_status_t dumb_fsal_up_invalidate_all(fsal_up_event_data_t * pevdata)
+{
+  LogDebug(COMPONENT_FSAL_UP,
+           "FSAL_UP_DUMB: calling cache_inode_lru_invalidate_all()");
+
+  cache_inode_lru_invalidate_all();
+
+  ReturnCode(ERR_FSAL_NO_ERROR, 0);
+}
+
 #define INVALIDATE_STUB {                     \
     return dumb_fsal_up_invalidate_step1(pevdata);  \
   } while(0);
@@ -236,7 +248,8 @@ fsal_up_event_functions_t dumb_event_func = {
   .fsal_up_close = dumb_fsal_up_close,
   .fsal_up_setattr = dumb_fsal_up_setattr,
   .fsal_up_update = dumb_fsal_up_update,
-  .fsal_up_invalidate = dumb_fsal_up_invalidate_step1
+  .fsal_up_invalidate = dumb_fsal_up_invalidate_step1,
+  .fsal_up_invalidate_all = dumb_fsal_up_invalidate_all
 };
 
 fsal_up_event_functions_t *get_fsal_up_dumb_functions()
@@ -31,22 +31,111 @@
 #include <stdio.h>
 #include <string.h>
 #include <pthread.h>
+#include <sys/time.h>
 #include "nfs_core.h"
 #include "log.h"
 #include "fsal_up.h"
 #include "err_fsal.h"
 #include "nfs_tcb.h"
+#include "abstract_atomic.h"
+#include "murmur3.h"
 
 extern fsal_status_t dumb_fsal_up_invalidate_step2(fsal_up_event_data_t *);
 
 static int fsal_up_thread_exists(exportlist_t *entry);
-static struct glist_head       fsal_up_process_queue;
-nfs_tcb_t                      fsal_up_process_tcb;
+
+/* Events are processed by several threads, each draining its own
+ * queue.  An event goes to the queue its file handle hashes to, so
+ * that the events on a file are processed in the order they came.
+ * An event identical to one still queued for the same handle is
+ * dropped, which is most of them during mass invalidations. */
+
+#define FSAL_UP_PENDING_BUCKETS 256
+
+typedef struct fsal_up_shard__
+{
+  nfs_tcb_t tcb;                 /* Its mutex protects the rest */
+  struct glist_head queue;
+  struct glist_head pending[FSAL_UP_PENDING_BUCKETS]; /* Queued events
+                                                          by handle */
+  uint32_t depth;
+  uint32_t max_depth;
+  pthread_t thr;
+} fsal_up_shard_t;
+
+static fsal_up_shard_t *fsal_up_shards;
+static uint32_t fsal_up_nb_shards;
+
+static uint64_t fsal_up_queued;
+static uint64_t fsal_up_coalesced;
+static uint64_t fsal_up_processed;
+static uint64_t fsal_up_batches;
+static uint64_t fsal_up_max_lag;
+
+static uint64_t fsal_up_now_msec(void)
+{
+  struct timeval now;
+
+  gettimeofday(&now, NULL);
+  return (uint64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+}
+
+static void fsal_up_event_free(fsal_up_event_t *fupevent)
+{
+  gsh_free(fupevent->event_data.event_context.fsal_data.fh_desc.start);
+  pthread_mutex_lock(&nfs_param.fsal_up_param.event_pool_lock);
+  pool_free(nfs_param.fsal_up_param.event_pool, fupevent);
+  pthread_mutex_unlock(&nfs_param.fsal_up_param.event_pool_lock);
+}
+
+/* Look for an event still queued that the new one would repeat.  An
+ * update replaces the data of the queued one, keeping a drop to no
+ * links, so that the fds are closed all the same. */
+static bool_t fsal_up_coalesce(fsal_up_shard_t *shard, fsal_up_event_t *arg)
+{
+  struct glist_head *glist;
+  fsal_up_event_t *queued;
+  struct fsal_handle_desc *fh, *qfh;
+  fsal_up_event_data_update_t *upd, *qupd;
+
+  fh = &arg->event_data.event_context.fsal_data.fh_desc;
+
+  glist_for_each(glist,
+                 &shard->pending[arg->event_hash % FSAL_UP_PENDING_BUCKETS])
+    {
+      queued = glist_entry(glist, fsal_up_event_t, event_pending);
+      qfh = &queued->event_data.event_context.fsal_data.fh_desc;
+
+      if(queued->event_hash != arg->event_hash ||
+         queued->event_type != arg->event_type ||
+         queued->event_process_func != arg->event_process_func ||
+         qfh->len != fh->len ||
+         memcmp(qfh->start, fh->start, fh->len) != 0)
+        continue;
+
+      if(arg->event_type == FSAL_UP_EVENT_UPDATE)
+        {
+          upd = &arg->event_data.type.update;
+          qupd = &queued->event_data.type.update;
+          if(upd->upu_flags & FSAL_UP_NLINK)
+            qupd->upu_stat_buf = upd->upu_stat_buf;
+          else if(!(qupd->upu_flags & FSAL_UP_NLINK))
+            qupd->upu_stat_buf = upd->upu_stat_buf;
+          qupd->upu_flags |= upd->upu_flags;
+        }
+
+      return TRUE;
+    }
+
+  return FALSE;
+}
 
 fsal_status_t  schedule_fsal_up_event_process(fsal_up_event_t *arg)
 {
   int rc;
   fsal_status_t ret = {0, 0};
+  fsal_up_shard_t *shard;
+  struct fsal_handle_desc *fh;
 
   /* Events which needs quick response, and locking events wich
      has its own queue gets processed here, rest will be queued. */
@@ -55,10 +144,7 @@ fsal_status_t  schedule_fsal_up_event_process(fsal_up_event_t *arg)
     {
       arg->event_process_func(&arg->event_data);
 
-      gsh_free(arg->event_data.event_context.fsal_data.fh_desc.start);
-      pthread_mutex_lock(&nfs_param.fsal_up_param.event_pool_lock);
-      pool_free(nfs_param.fsal_up_param.event_pool, arg);
-      pthread_mutex_unlock(&nfs_param.fsal_up_param.event_pool_lock);
+      fsal_up_event_free(arg);
       return ret;
     }
 
@@ -70,41 +156,104 @@ fsal_status_t  schedule_fsal_up_event_process(fsal_up_event_t *arg)
       arg->event_process_func = dumb_fsal_up_invalidate_step2;
     }
 
+  fh = &arg->event_data.event_context.fsal_data.fh_desc;
+  MurmurHash3_x86_32(fh->start, fh->len, 911, &arg->event_hash);
+  shard = &fsal_up_shards[arg->event_hash % fsal_up_nb_shards];
+
   /* Now queue them for further process. */
-  LogFullDebug(COMPONENT_FSAL_UP, "Schedule %p", arg);
+  LogFullDebug(COMPONENT_FSAL_UP, "Schedule %p on queue %u", arg,
+               (unsigned int) (shard - fsal_up_shards));
 
-  P(fsal_up_process_tcb.tcb_mutex);
-  glist_add_tail(&fsal_up_process_queue, &arg->event_list);
-  rc = pthread_cond_signal(&fsal_up_process_tcb.tcb_condvar);
+  P(shard->tcb.tcb_mutex);
+  if(fsal_up_coalesce(shard, arg))
+    {
+      V(shard->tcb.tcb_mutex);
+      atomic_inc_uint64_t(&fsal_up_coalesced);
+      fsal_up_event_free(arg);
+      return ret;
+    }
+
+  arg->event_queued = fsal_up_now_msec();
+  glist_add_tail(&shard->queue, &arg->event_list);
+  glist_add_tail(&shard->pending[arg->event_hash % FSAL_UP_PENDING_BUCKETS],
+                 &arg->event_pending);
+  shard->depth++;
+  if(shard->depth > shard->max_depth)
+    shard->max_depth = shard->depth;
+  rc = pthread_cond_signal(&shard->tcb.tcb_condvar);
   LogFullDebug(COMPONENT_FSAL_UP,"Signaling tcb_condvar\n");
   if (rc == -1)
     {
       LogDebug(COMPONENT_FSAL_UP,
                    "Unable to signal FSAL_UP Process Thread");
       glist_del(&arg->event_list);
+      glist_del(&arg->event_pending);
+      shard->depth--;
       ret.major = ERR_FSAL_FAULT;
     }
-  V(fsal_up_process_tcb.tcb_mutex);
+  V(shard->tcb.tcb_mutex);
+
+  if(ret.major == 0)
+    atomic_inc_uint64_t(&fsal_up_queued);
   return ret;
 }
 
-/* This thread processes FSAL UP events. */
-void *fsal_up_process_thread(void *UnUsedArg)
+/* Process a batch of events taken off the queue at once, then return
+ * them to the pool under one hold of its lock. */
+static void fsal_up_process_batch(struct glist_head *batch)
 {
+  struct glist_head *glist, *glistn;
+  fsal_up_event_t *fupevent;
+  uint64_t lag, max_lag, n = 0;
+
+  glist_for_each(glist, batch)
+    {
+      fupevent = glist_entry(glist, fsal_up_event_t, event_list);
+
+      lag = fsal_up_now_msec() - fupevent->event_queued;
+      max_lag = atomic_fetch_uint64_t(&fsal_up_max_lag);
+      while(lag > max_lag &&
+            !__sync_bool_compare_and_swap(&fsal_up_max_lag, max_lag, lag))
+        max_lag = atomic_fetch_uint64_t(&fsal_up_max_lag);
+
+      fupevent->event_process_func(&fupevent->event_data);
+      gsh_free(fupevent->event_data.event_context.fsal_data.fh_desc.start);
+      n++;
+    }
+
+  pthread_mutex_lock(&nfs_param.fsal_up_param.event_pool_lock);
+  glist_for_each_safe(glist, glistn, batch)
+    {
+      fupevent = glist_entry(glist, fsal_up_event_t, event_list);
+      glist_del(&fupevent->event_list);
+      pool_free(nfs_param.fsal_up_param.event_pool, fupevent);
+    }
+  pthread_mutex_unlock(&nfs_param.fsal_up_param.event_pool_lock);
+
+  atomic_add_uint64_t(&fsal_up_processed, n);
+  atomic_inc_uint64_t(&fsal_up_batches);
+}
+
+/* This thread processes FSAL UP events, of the queue it is given. */
+void *fsal_up_process_thread(void *Arg)
+{
+  fsal_up_shard_t          * shard = Arg;
   struct timeval             now;
   struct timespec            timeout;
   fsal_up_event_t          * fupevent;
+  struct glist_head          batch;
+  uint32_t                   n;
   int                        rc;
+  char                       thr_name[40];
 
-  SetNameFunction("fsal_up_process_thread");
-
-  init_glist(&fsal_up_process_queue);
-  tcb_new(&fsal_up_process_tcb, "FSAL_UP Process Thread");
+  snprintf(thr_name, sizeof(thr_name), "fsal_up_process_thread#%u",
+           (unsigned int) (shard - fsal_up_shards));
+  SetNameFunction(thr_name);
 
-  if (mark_thread_existing(&fsal_up_process_tcb) == PAUSE_EXIT)
+  if (mark_thread_existing(&shard->tcb) == PAUSE_EXIT)
     {
       /* Oops, that didn't last long... exit. */
-      mark_thread_done(&fsal_up_process_tcb);
+      mark_thread_done(&shard->tcb);
       LogDebug(COMPONENT_INIT,
                "FSAL_UP Process Thread: Exiting before initialization");
       return NULL;
@@ -117,68 +266,145 @@ void *fsal_up_process_thread(void *UnUsedArg)
   while(1)
     {
       /* Check without tcb lock*/
-      if ((fsal_up_process_tcb.tcb_state != STATE_AWAKE) ||
-          glist_empty(&fsal_up_process_queue))
+      if ((shard->tcb.tcb_state != STATE_AWAKE) ||
+          glist_empty(&shard->queue))
         {
           while(1)
             {
-              P(fsal_up_process_tcb.tcb_mutex);
-              if ((fsal_up_process_tcb.tcb_state == STATE_AWAKE) &&
-                  !glist_empty(&fsal_up_process_queue))
+              P(shard->tcb.tcb_mutex);
+              if ((shard->tcb.tcb_state == STATE_AWAKE) &&
+                  !glist_empty(&shard->queue))
                 {
-                  V(fsal_up_process_tcb.tcb_mutex);
+                  V(shard->tcb.tcb_mutex);
                   LogDebug(COMPONENT_INIT, "FSAL_UP Process Thread: breaking..1");
                   break;
                 }
-              switch(thread_sm_locked(&fsal_up_process_tcb))
+              switch(thread_sm_locked(&shard->tcb))
                 {
                   case THREAD_SM_RECHECK:
-                  V(fsal_up_process_tcb.tcb_mutex);
+                  V(shard->tcb.tcb_mutex);
                   continue;
 
                   case THREAD_SM_BREAK:
-                  if (glist_empty(&fsal_up_process_queue))
+                  if (glist_empty(&shard->queue))
                     {
                       gettimeofday(&now, NULL);
                       timeout.tv_sec = 10 + now.tv_sec;
                       timeout.tv_nsec = 0;
-                      rc = pthread_cond_timedwait(&fsal_up_process_tcb.tcb_condvar,
-                                                  &fsal_up_process_tcb.tcb_mutex,
+                      rc = pthread_cond_timedwait(&shard->tcb.tcb_condvar,
+                                                  &shard->tcb.tcb_mutex,
                                                   &timeout);
                       LogFullDebug(COMPONENT_INIT,
                                    "FSAL_UP Process Thread: wokeup:%d", rc);
                     }
-                  V(fsal_up_process_tcb.tcb_mutex);
+                  V(shard->tcb.tcb_mutex);
                   continue;
 
                   case THREAD_SM_EXIT:
-                  V(fsal_up_process_tcb.tcb_mutex);
+                  V(shard->tcb.tcb_mutex);
                   return NULL;
                 }
              }
           }
-        P(fsal_up_process_tcb.tcb_mutex);
-        fupevent = glist_first_entry(&fsal_up_process_queue,
-                                     fsal_up_event_t,
-                                     event_list);
-        if(fupevent != NULL)
+
+        /* Pull a batch of events off of the list; events coming for
+           them from now on are queued anew. */
+        init_glist(&batch);
+        P(shard->tcb.tcb_mutex);
+        for(n = 0; n < nfs_param.core_param.fsal_up_process_batch; n++)
           {
-            /* Pull the event off of the list */
+            fupevent = glist_first_entry(&shard->queue,
+                                         fsal_up_event_t,
+                                         event_list);
+            if(fupevent == NULL)
+              break;
             glist_del(&fupevent->event_list);
+            glist_del(&fupevent->event_pending);
+            glist_add_tail(&batch, &fupevent->event_list);
+          }
+        shard->depth -= n;
 
-            /* Release the mutex */
-            V(fsal_up_process_tcb.tcb_mutex);
-            fupevent->event_process_func(&fupevent->event_data);
-            gsh_free(fupevent->event_data.event_context.fsal_data.fh_desc.start);
-            pthread_mutex_lock(&nfs_param.fsal_up_param.event_pool_lock);
-            pool_free(nfs_param.fsal_up_param.event_pool, fupevent);
-            pthread_mutex_unlock(&nfs_param.fsal_up_param.event_pool_lock);
+        /* Release the mutex */
+        V(shard->tcb.tcb_mutex);
 
-            continue;
-          }
-        V(fsal_up_process_tcb.tcb_mutex);
+        if(n != 0)
+          fsal_up_process_batch(&batch);
+    }
+  tcb_remove(&shard->tcb);
+}
+
+/* Start one thread per queue. */
+void create_fsal_up_process_threads()
+{
+  pthread_attr_t attr_thr;
+  uint32_t i;
+  int rc;
+
+  memset(&attr_thr, 0, sizeof(attr_thr));
+
+  if(pthread_attr_init(&attr_thr) != 0)
+    LogDebug(COMPONENT_THREAD, "can't init pthread's attributes");
+
+  if(pthread_attr_setscope(&attr_thr, PTHREAD_SCOPE_SYSTEM) != 0)
+    LogDebug(COMPONENT_THREAD, "can't set pthread's scope");
+
+  if(pthread_attr_setdetachstate(&attr_thr, PTHREAD_CREATE_JOINABLE) != 0)
+    LogDebug(COMPONENT_THREAD, "can't set pthread's join state");
+
+  if(pthread_attr_setstacksize(&attr_thr, THREAD_STACK_SIZE) != 0)
+    LogDebug(COMPONENT_THREAD, "can't set pthread's stack size");
+
+  for(i = 0; i < fsal_up_nb_shards; i++)
+    {
+      if((rc = pthread_create(&fsal_up_shards[i].thr, &attr_thr,
+                              fsal_up_process_thread,
+                              &fsal_up_shards[i])) != 0)
+        {
+          LogFatal(COMPONENT_THREAD,
+                   "Could not create fsal_up_process_thread, error = %d (%s)",
+                   errno, strerror(errno));
+        }
+    }
+
+  LogEvent(COMPONENT_THREAD,
+           "%u fsal_up_process_threads were started successfully",
+           fsal_up_nb_shards);
+}
+
+/**
+ * @brief Get the counts of the FSAL UP event processing
+ *
+ * The lag is the time an event waited in its queue: that of the oldest
+ * event queued now, and the longest any event waited.
+ *
+ * @param[out] stats The counts
+ */
+
+void fsal_up_process_get_stats(struct fsal_up_process_stats *stats)
+{
+  fsal_up_event_t *fupevent;
+  uint64_t now = fsal_up_now_msec();
+  uint32_t i;
+
+  memset(stats, 0, sizeof(*stats));
+  stats->queued = atomic_fetch_uint64_t(&fsal_up_queued);
+  stats->coalesced = atomic_fetch_uint64_t(&fsal_up_coalesced);
+  stats->processed = atomic_fetch_uint64_t(&fsal_up_processed);
+  stats->batches = atomic_fetch_uint64_t(&fsal_up_batches);
+  stats->max_lag = atomic_fetch_uint64_t(&fsal_up_max_lag);
+
+  for(i = 0; i < fsal_up_nb_shards; i++)
+    {
+      P(fsal_up_shards[i].tcb.tcb_mutex);
+      stats->depth += fsal_up_shards[i].depth;
+      if(fsal_up_shards[i].max_depth > stats->max_depth)
+        stats->max_depth = fsal_up_shards[i].max_depth;
+      fupevent = glist_first_entry(&fsal_up_shards[i].queue,
+                                   fsal_up_event_t, event_list);
+      if(fupevent != NULL && now - fupevent->event_queued > stats->lag)
+        stats->lag = now - fupevent->event_queued;
+      V(fsal_up_shards[i].tcb.tcb_mutex);
     }
-  tcb_remove(&fsal_up_process_tcb);
 }
 
 void create_fsal_up_threads()
@@ -271,6 +497,9 @@ void constructor_fsal_up_event_t(void *ptr,
 /* One pool can be used for all FSAL_UP used for exports. */
 void nfs_Init_FSAL_UP()
 {
+  char name[40];
+  uint32_t i, j;
+
   memset(&nfs_param.fsal_up_param, 0, sizeof(nfs_param.fsal_up_param));
 
   /* DEBUGGING */
@@ -293,6 +522,35 @@ void nfs_Init_FSAL_UP()
       LogCrit(COMPONENT_FSAL_UP, "FSAL_UP: Could not initialize event pool"
               " mutex.");
 
+  /* The queues are ready before any FSAL UP thread schedules events,
+   * their processing threads start later. */
+  fsal_up_nb_shards = nfs_param.core_param.nb_fsal_up_process;
+  if(fsal_up_nb_shards == 0)
+    fsal_up_nb_shards = 1;
+  if(nfs_param.core_param.fsal_up_process_batch == 0)
+    nfs_param.core_param.fsal_up_process_batch = 1;
+
+  fsal_up_shards = gsh_calloc(fsal_up_nb_shards, sizeof(fsal_up_shard_t));
+  if(fsal_up_shards == NULL)
+    {
+      LogError(COMPONENT_INIT, ERR_SYS, ERR_MALLOC, errno);
+      Fatal();
+    }
+
+  for(i = 0; i < fsal_up_nb_shards; i++)
+    {
+      init_glist(&fsal_up_shards[i].queue);
+      for(j = 0; j < FSAL_UP_PENDING_BUCKETS; j++)
+        init_glist(&fsal_up_shards[i].pending[j]);
+      snprintf(name, sizeof(name), "FSAL_UP Process Thread #%u", i);
+      if(tcb_new(&fsal_up_shards[i].tcb, name) != 0)
+        {
+          LogCrit(COMPONENT_INIT,
+                  "Error while initializing FSAL UP queue %u", i);
+          Fatal();
+        }
+    }
+
   return;
 }
 
@@ -354,6 +612,13 @@ fsal_status_t process_event(fsal_up_event_t *myevent, fsal_up_event_functions_t
       LogDebug(COMPONENT_FSAL_UP, "FSAL_UP: Process INVALIDATE event");
       myevent->event_process_func = event_func->fsal_up_invalidate;
       break;
+    case FSAL_UP_EVENT_INVALIDATE_ALL:
+      /* On no handle, so on no shard: done here */
+      LogDebug(COMPONENT_FSAL_UP, "FSAL_UP: Process INVALIDATE ALL event");
+      if(event_func->fsal_up_invalidate_all != NULL)
+        event_func->fsal_up_invalidate_all(&myevent->event_data);
+      fsal_up_event_free(myevent);
+      ReturnCode(ERR_FSAL_NO_ERROR, 0);
     default:
       LogDebug(COMPONENT_FSAL_UP, "Unknown FSAL UP event type found: %d",
               myevent->event_type);
@@ -424,6 +689,12 @@ fsal_up_event_bus_filter_t *find_filter(char filtername[MAX_FILTER_NAMELEN])
   return NULL;
 }
 
+/* Release what FSAL_UP_Init set up, however the thread ends */
+static void fsal_up_thread_cleanup(void *arg)
+{
+  FSAL_UP_Shutdown((fsal_up_event_bus_context_t *)arg);
+}
+
 void *fsal_up_thread(void *Arg)
 {
   fsal_status_t status;
@@ -505,6 +776,8 @@ void *fsal_up_thread(void *Arg)
   /* Set the timeout for getting events. */
   timeout = fsal_up_args->export_entry->fsal_up_timeout;
 
+  pthread_cleanup_push(fsal_up_thread_cleanup, &fsal_up_context);
+
   /* Start querying for events and processing. */
   while(1)
     {
@@ -537,7 +810,7 @@ void *fsal_up_thread(void *Arg)
                       fsal_up_args->export_entry->filesystem_id.major,
                       fsal_up_args->export_entry->filesystem_id.minor,
                       fsal_up_args->export_entry->id);
-              return NULL;
+              break;
             }
           else
             {
@@ -577,6 +850,8 @@ void *fsal_up_thread(void *Arg)
                fsal_up_args->export_entry->id);
     }
 
+  pthread_cleanup_pop(1);
+
   gsh_free(Arg);
   return NULL;
 }                               /* fsal_up_thread */
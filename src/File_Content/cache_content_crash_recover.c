@@ -150,7 +150,8 @@ cache_content_status_t cache_content_crash_recover(unsigned short exportid,
                           dirent_export.d_name);
 
                   /* Populating the cache_inode... */
-                  fsal_data.fh_desc = inode_entry.fh_desc;
+                  fsal_data.fh_desc = inode_entry.fsdata.fh_desc;
+                  fsal_data.hash = 0;
 
                   if((pentry = cache_inode_get(&fsal_data,
                                                &fsal_attr,
@@ -34,6 +34,22 @@
  * determines which of the partitions (each containing a tree and each
  * separately locked), and a hash which acts as the key within an
  * individual Red-Black Tree.
+ *
+ * Tables created with HT_FLAG_OPEN_ADDR keep each partition in an
+ * open addressing array (linear probing, backward shift deletion)
+ * instead of a tree.  Writers still take the partition lock, and bump
+ * a sequence count around every change.  Lookups that do not latch
+ * the table (HashTable_Get and its users) read the slots without any
+ * lock and retry if the sequence count moved.  Such a reader never
+ * follows the key pointer of a slot, since the key may be freed as
+ * soon as its entry is removed: it matches the full hash, then the
+ * copy of the key kept in the slot, and takes the partition lock if
+ * the key is too long for the copy or the bytes differ (keys the
+ * compare function finds equal may differ, in their padding say).
+ * Slots replaced when a partition grows are freed once every lockless
+ * reader that may have seen them is done.  A reader only writes to a
+ * record of its own thread, the epoch it started in, so readers on
+ * different CPUs share no cache line.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -46,6 +62,8 @@
 #include "RW_Lock.h"
 #include "HashTable.h"
 #include "log.h"
+#include "slab_pool.h"
+#include "abstract_atomic.h"
 #include <assert.h>
 
 #ifndef TRUE
@@ -272,6 +290,659 @@ compute(struct hash_table *ht, struct hash_buff *key,
      return HASHTABLE_SUCCESS;
 }
 
+
+/**
+ * @brief Initial number of slots of an open addressing partition
+ */
+#define HASH_OA_MIN_SLOTS 16
+
+/**
+ * @brief Lockless attempts before a reader takes the partition lock
+ */
+#define HASH_OA_READ_TRIES 4
+
+/**
+ * @brief Reader record of a thread
+ *
+ * Records are never freed: the record of a thread that exited is
+ * taken over by the next thread needing one.
+ */
+
+struct hash_oa_reader {
+     uint64_t epoch; /*< Epoch its lookup started in, 0 if none */
+     uint32_t in_use; /*< Owned by a running thread */
+     struct hash_oa_reader *next; /*< Next in oa_reader_list */
+} __attribute__((aligned(64)));
+
+/* Bumped whenever slots are replaced, starts at 1 as 0 means idle */
+static uint64_t oa_epoch = 1;
+/* Every record, new ones are pushed at the head */
+static struct hash_oa_reader *oa_reader_list = NULL;
+
+static pthread_once_t oa_reader_once = PTHREAD_ONCE_INIT;
+static pthread_key_t oa_reader_key;
+static __thread struct hash_oa_reader *oa_reader = NULL;
+
+/**
+ * @brief Give the record of an exiting thread back
+ */
+static void
+oa_reader_release(void *arg)
+{
+     struct hash_oa_reader *reader = arg;
+
+     atomic_store_uint64_t(&reader->epoch, 0);
+     atomic_store_uint32_t(&reader->in_use, 0);
+}
+
+static void
+oa_reader_init(void)
+{
+     (void) pthread_key_create(&oa_reader_key, oa_reader_release);
+}
+
+/**
+ * @brief Find the record of this thread, taking one on first use
+ *
+ * @return The record, NULL if none could be allocated.
+ */
+static struct hash_oa_reader *
+oa_reader_get(void)
+{
+     struct hash_oa_reader *reader = oa_reader;
+
+     if (likely(reader != NULL))
+          return reader;
+
+     pthread_once(&oa_reader_once, oa_reader_init);
+
+     for (reader = *(struct hash_oa_reader * volatile *) &oa_reader_list;
+          reader != NULL;
+          reader = reader->next)
+          if (!atomic_fetch_uint32_t(&reader->in_use) &&
+              __sync_bool_compare_and_swap(&reader->in_use, 0, 1))
+               break;
+
+     if (reader == NULL) {
+          reader = gsh_calloc(1, sizeof(struct hash_oa_reader));
+          if (reader == NULL)
+               return NULL;
+          reader->in_use = 1;
+          do {
+               reader->next = oa_reader_list;
+          } while (!__sync_bool_compare_and_swap(&oa_reader_list,
+                                                 reader->next, reader));
+     }
+
+     (void) pthread_setspecific(oa_reader_key, reader);
+     oa_reader = reader;
+
+     return reader;
+}
+
+/**
+ * @brief Whether no lookup started before an epoch is still going
+ */
+static int
+oa_readers_past(uint64_t epoch)
+{
+     struct hash_oa_reader *reader;
+     uint64_t started;
+
+     for (reader = *(struct hash_oa_reader * volatile *) &oa_reader_list;
+          reader != NULL;
+          reader = reader->next) {
+          started = atomic_fetch_uint64_t(&reader->epoch);
+          if (started != 0 && started < epoch)
+               return FALSE;
+     }
+
+     return TRUE;
+}
+
+/**
+ * @brief Hash stored in a slot, 0 is kept to mark empty slots
+ */
+static inline uint64_t
+oa_hash(uint64_t rbt_hash)
+{
+     return (rbt_hash != 0) ? rbt_hash : 1;
+}
+
+/**
+ * @brief First slot probed for a hash
+ *
+ * The hash functions of many tables are weak in their low bits, so
+ * the hash is mixed (Fibonacci hashing) and its high bits are kept.
+ */
+static inline uint32_t
+oa_home(const struct hash_oa_slots *slots, uint64_t hash)
+{
+     return (hash * 0x9e3779b97f4a7c15ULL) >> slots->shift;
+}
+
+/**
+ * @brief Allocate empty slots
+ *
+ * @param[in] size Number of slots, a power of 2
+ *
+ * @return The slots or NULL.
+ */
+static struct hash_oa_slots *
+oa_slots_new(uint32_t size)
+{
+     struct hash_oa_slots *slots;
+     uint32_t n;
+
+     slots = gsh_calloc(1, sizeof(struct hash_oa_slots) +
+                        size * (sizeof(uint64_t) +
+                                sizeof(struct hash_data) +
+                                sizeof(struct hash_oa_key)));
+     if (slots == NULL)
+          return NULL;
+
+     slots->size = size;
+     slots->shift = 64;
+     for (n = size; n > 1; n >>= 1)
+          slots->shift--;
+     slots->hashes = (uint64_t *) (slots + 1);
+     slots->data = (struct hash_data *) (slots->hashes + size);
+     slots->keys = (struct hash_oa_key *) (slots->data + size);
+
+     return slots;
+}
+
+/**
+ * @brief Free slots along with the ones they replaced
+ */
+static void
+oa_slots_free(struct hash_oa_slots *slots)
+{
+     struct hash_oa_slots *retired;
+
+     while (slots != NULL) {
+          retired = slots->retired;
+          gsh_free(slots);
+          slots = retired;
+     }
+}
+
+/**
+ * @brief Make the flat copy of a key
+ *
+ * @param[in]  ht   The hash table
+ * @param[in]  key  The key
+ * @param[out] flat Its flat copy, of length 0 if it does not fit
+ */
+static inline void
+oa_flatten(struct hash_table *ht,
+           struct hash_buff *key,
+           struct hash_oa_key *flat)
+{
+     if (ht->parameter.key_flatten != NULL) {
+          flat->len = ht->parameter.key_flatten(key, flat->bytes,
+                                                HASH_OA_KEY_INLINE);
+     } else if (key->len <= HASH_OA_KEY_INLINE) {
+          memcpy(flat->bytes, key->pdata, key->len);
+          flat->len = key->len;
+     } else {
+          flat->len = 0;
+     }
+}
+
+/**
+ * @brief Set the key and value of a slot
+ *
+ * Inside oa_write_begin and oa_write_end.
+ */
+static inline void
+oa_slot_set(struct hash_table *ht,
+            struct hash_oa_slots *slots, uint32_t slot,
+            struct hash_buff *key, struct hash_buff *val)
+{
+     slots->data[slot].buffkey = *key;
+     slots->data[slot].buffval = *val;
+     oa_flatten(ht, key, &slots->keys[slot]);
+}
+
+/**
+ * @brief Empty a slot
+ */
+static inline void
+oa_slot_clear(struct hash_oa_slots *slots, uint32_t slot)
+{
+     slots->hashes[slot] = 0;
+     memset(&slots->data[slot], 0, sizeof(struct hash_data));
+     slots->keys[slot].len = 0;
+}
+
+/**
+ * @brief Move a slot, hash included
+ */
+static inline void
+oa_slot_move(struct hash_oa_slots *to, uint32_t j,
+             struct hash_oa_slots *from, uint32_t i)
+{
+     to->hashes[j] = from->hashes[i];
+     to->data[j] = from->data[i];
+     to->keys[j] = from->keys[i];
+}
+
+/**
+ * @brief Free the slots a partition replaced, if no reader is left
+ *
+ * A lockless reader stores the epoch it starts in before it loads
+ * the slots, and the epoch is bumped after the new slots are
+ * published, so a reader that started in that epoch or later walks
+ * the new slots.  The old ones are freed once no earlier reader is
+ * left, in any partition: a long lookup elsewhere keeps them a little
+ * longer, which as sizes double at most doubles their memory.
+ *
+ * The partition lock must be held for writing.
+ */
+static void
+oa_reclaim(struct hash_partition *partition)
+{
+     struct hash_oa_slots *slots = partition->oa;
+
+     if (slots->retired == NULL)
+          return;
+
+     __sync_synchronize();
+     if (!oa_readers_past(slots->retired_epoch))
+          return;
+
+     oa_slots_free(slots->retired);
+     slots->retired = NULL;
+}
+
+/**
+ * @brief Start and end a change of the slots
+ *
+ * The partition lock must be held for writing.  Lockless readers
+ * retry while the sequence count is odd or if it moved.
+ */
+static inline void
+oa_write_begin(struct hash_partition *partition)
+{
+     atomic_inc_uint32_t(&partition->oa_seq);
+     __sync_synchronize();
+}
+
+static inline void
+oa_write_end(struct hash_partition *partition)
+{
+     __sync_synchronize();
+     atomic_inc_uint32_t(&partition->oa_seq);
+}
+
+/**
+ * @brief Locate a key in an open addressing partition
+ *
+ * The partition lock must be held.
+ *
+ * @param[in]  ht    The hash table
+ * @param[in]  slots The slots of the partition
+ * @param[in]  key   The key to look up
+ * @param[in]  hash  Its hash, as given by oa_hash
+ * @param[out] slot  The slot of the key if found, otherwise the empty
+ *                   slot where it would be inserted
+ *
+ * @return TRUE if the key was found.
+ */
+static int
+oa_locate(struct hash_table *ht,
+          struct hash_oa_slots *slots,
+          struct hash_buff *key,
+          uint64_t hash,
+          uint32_t *slot)
+{
+     uint32_t mask = slots->size - 1;
+     uint32_t i = oa_home(slots, hash);
+
+     /* The load factor is kept below 1, there is an empty slot */
+     while (slots->hashes[i] != 0) {
+          if (slots->hashes[i] == hash &&
+              ht->parameter.compare_key(key,
+                                        &slots->data[i].buffkey) == 0) {
+               *slot = i;
+               return TRUE;
+          }
+          i = (i + 1) & mask;
+     }
+
+     *slot = i;
+     return FALSE;
+} /* oa_locate */
+
+/**
+ * @brief Look up a key without taking the partition lock
+ *
+ * @param[in]  ht        The hash table
+ * @param[in]  partition The partition of the key
+ * @param[in]  key       The key to look up
+ * @param[in]  hash      Its hash, as given by oa_hash
+ * @param[out] val       The value found, may be NULL
+ * @param[out] rc        HASHTABLE_SUCCESS or HASHTABLE_ERROR_NO_SUCH_KEY
+ *
+ * @return TRUE if *rc holds the answer, FALSE if the writers kept
+ *         interfering and the lock must be taken.
+ */
+static int
+oa_get_lockless(struct hash_table *ht,
+                struct hash_partition *partition,
+                struct hash_buff *key,
+                uint64_t hash,
+                struct hash_buff *val,
+                hash_error_t *rc)
+{
+     struct hash_oa_slots *slots;
+     struct hash_data snap;
+     struct hash_buff found = { NULL, 0 };
+     struct hash_oa_key flat, copy;
+     struct hash_oa_reader *reader;
+     uint32_t seq, i, mask, probes;
+     uint64_t h;
+     int tries, answered = FALSE, unsure;
+
+     /* Only flat copies are compared, never the stored keys */
+     oa_flatten(ht, key, &flat);
+     if (flat.len == 0)
+          return FALSE;
+
+     reader = oa_reader_get();
+     if (reader == NULL)
+          return FALSE;
+
+     /* Keeps the slots we walk from being freed, see oa_reclaim */
+     atomic_store_uint64_t(&reader->epoch, atomic_fetch_uint64_t(&oa_epoch));
+     __sync_synchronize();
+
+     for (tries = 0; tries < HASH_OA_READ_TRIES && !answered; tries++) {
+          seq = atomic_fetch_uint32_t(&partition->oa_seq);
+          if (seq & 1)
+               continue;
+
+          slots = *(struct hash_oa_slots * volatile *) &partition->oa;
+          mask = slots->size - 1;
+          i = oa_home(slots, hash);
+          *rc = HASHTABLE_ERROR_NO_SUCH_KEY;
+          unsure = FALSE;
+
+          /* Bounded, the slots may change under us */
+          for (probes = 0; probes < slots->size; probes++) {
+               h = ((volatile uint64_t *) slots->hashes)[i];
+               if (h == 0)
+                    break;
+               if (h == hash) {
+                    snap = slots->data[i];
+                    copy = slots->keys[i];
+                    __sync_synchronize();
+                    if (atomic_fetch_uint32_t(&partition->oa_seq) != seq)
+                         break;
+                    if (copy.len == flat.len &&
+                        memcmp(copy.bytes, flat.bytes, flat.len) == 0) {
+                         found = snap.buffval;
+                         *rc = HASHTABLE_SUCCESS;
+                         break;
+                    }
+                    /* Flattened keys differ only if the keys do, so
+                     * the search goes on.  Raw bytes may differ for
+                     * keys compare_key finds equal. */
+                    if (copy.len == 0 ||
+                        ht->parameter.key_flatten == NULL) {
+                         unsure = TRUE;
+                         break;
+                    }
+               }
+               i = (i + 1) & mask;
+          }
+
+          __sync_synchronize();
+          if (atomic_fetch_uint32_t(&partition->oa_seq) != seq)
+               continue;
+          if (unsure)
+               break;
+
+          if (*rc == HASHTABLE_SUCCESS && val != NULL)
+               *val = found;
+          answered = TRUE;
+     }
+
+     __sync_synchronize();
+     atomic_store_uint64_t(&reader->epoch, 0);
+
+     return answered;
+} /* oa_get_lockless */
+
+/**
+ * @brief Double the slots of a partition
+ *
+ * The new slots are filled before being published.  The old ones are
+ * kept while a lockless reader may still be walking them, see
+ * oa_reclaim.
+ *
+ * The partition lock must be held for writing.
+ */
+static hash_error_t
+oa_grow(struct hash_partition *partition)
+{
+     struct hash_oa_slots *old = partition->oa;
+     struct hash_oa_slots *new;
+     uint32_t i, j, mask;
+
+     new = oa_slots_new(old->size * 2);
+     if (new == NULL)
+          return HASHTABLE_INSERT_MALLOC_ERROR;
+
+     mask = new->size - 1;
+     for (i = 0; i < old->size; i++) {
+          if (old->hashes[i] == 0)
+               continue;
+          for (j = oa_home(new, old->hashes[i]); new->hashes[j] != 0;
+               j = (j + 1) & mask)
+               ;
+          oa_slot_move(new, j, old, i);
+     }
+     new->retired = old;
+
+     oa_write_begin(partition);
+     partition->oa = new;
+     oa_write_end(partition);
+
+     /* Readers from now on walk the new slots */
+     new->retired_epoch = atomic_inc_uint64_t(&oa_epoch);
+
+     oa_reclaim(partition);
+
+     return HASHTABLE_SUCCESS;
+} /* oa_grow */
+
+/**
+ * @brief Remove the entry in a slot
+ *
+ * The entries following it in the probe sequence are shifted back,
+ * so that no tombstone is needed.  The partition lock must be held
+ * for writing and the change must be bracketed by oa_write_begin and
+ * oa_write_end.
+ */
+static void
+oa_remove(struct hash_oa_slots *slots, uint32_t slot)
+{
+     uint32_t mask = slots->size - 1;
+     uint32_t i = slot, j, k;
+
+     for (j = (i + 1) & mask; slots->hashes[j] != 0; j = (j + 1) & mask) {
+          k = oa_home(slots, slots->hashes[j]);
+          /* Leave it if its home is cyclically in (i, j] */
+          if ((i <= j) ? ((i < k) && (k <= j)) : ((i < k) || (k <= j)))
+               continue;
+          oa_slot_move(slots, i, slots, j);
+          i = j;
+     }
+
+     oa_slot_clear(slots, i);
+} /* oa_remove */
+
+
+/**
+ * @brief Open addressing part of HashTable_SetLatched
+ *
+ * Same parameters and return values, the latch is not released.
+ */
+static hash_error_t
+oa_set_latched(struct hash_table *ht,
+               struct hash_buff *key,
+               struct hash_buff *val,
+               struct hash_latch *latch,
+               int overwrite,
+               struct hash_buff *stored_key,
+               struct hash_buff *stored_val)
+{
+     struct hash_partition *partition = &ht->partitions[latch->index];
+     struct hash_oa_slots *slots = partition->oa;
+     uint64_t hash = oa_hash(latch->rbt_hash);
+     hash_error_t rc = HASHTABLE_SUCCESS;
+     uint32_t slot = latch->slot;
+
+     if (latch->found) {
+          if (!overwrite)
+               return HASHTABLE_ERROR_KEY_ALREADY_EXISTS;
+
+          if (stored_key)
+               *stored_key = slots->data[slot].buffkey;
+          if (stored_val)
+               *stored_val = slots->data[slot].buffval;
+
+          oa_write_begin(partition);
+          oa_slot_set(ht, slots, slot, key, val);
+          oa_write_end(partition);
+          oa_reclaim(partition);
+
+          return HASHTABLE_OVERWRITTEN;
+     }
+
+     /* Keep the load factor under 3/4 */
+     if ((partition->count + 1) * 4 > (size_t) slots->size * 3) {
+          rc = oa_grow(partition);
+          if (rc != HASHTABLE_SUCCESS)
+               return rc;
+          slots = partition->oa;
+          for (slot = oa_home(slots, hash); slots->hashes[slot] != 0;
+               slot = (slot + 1) & (slots->size - 1))
+               ;
+     }
+
+     oa_write_begin(partition);
+     oa_slot_set(ht, slots, slot, key, val);
+     slots->hashes[slot] = hash;
+     oa_write_end(partition);
+     oa_reclaim(partition);
+
+     ++partition->count;
+
+     return HASHTABLE_SUCCESS;
+} /* oa_set_latched */
+
+/**
+ * @brief Open addressing part of HashTable_DeleteLatched
+ *
+ * Same parameters, the latch is not released.
+ */
+static void
+oa_delete_latched(struct hash_table *ht,
+                  struct hash_latch *latch,
+                  struct hash_buff *stored_key,
+                  struct hash_buff *stored_val)
+{
+     struct hash_partition *partition = &ht->partitions[latch->index];
+     struct hash_oa_slots *slots = partition->oa;
+
+     if (stored_key)
+          *stored_key = slots->data[latch->slot].buffkey;
+     if (stored_val)
+          *stored_val = slots->data[latch->slot].buffval;
+
+     oa_write_begin(partition);
+     oa_remove(slots, latch->slot);
+     oa_write_end(partition);
+     oa_reclaim(partition);
+
+     --partition->count;
+} /* oa_delete_latched */
+
+
+/**
+ * @brief Open addressing part of HashTable_Delall, for one partition
+ *
+ * @return 0 on success, -1 if free_func failed.
+ */
+static int
+oa_delall(struct hash_table *ht,
+          struct hash_partition *partition,
+          int (*free_func)(struct hash_buff,
+                           struct hash_buff))
+{
+     struct hash_oa_slots *slots;
+     struct hash_data data;
+     uint32_t i;
+     int rc = 0;
+
+     pthread_rwlock_wrlock(&partition->lock);
+     slots = partition->oa;
+
+     oa_write_begin(partition);
+     for (i = 0; i < slots->size && rc == 0; i++) {
+          if (slots->hashes[i] == 0)
+               continue;
+          data = slots->data[i];
+          oa_slot_clear(slots, i);
+          --partition->count;
+          if (free_func(data.buffkey, data.buffval) == 0)
+               rc = -1;
+     }
+     oa_write_end(partition);
+     oa_reclaim(partition);
+
+     pthread_rwlock_unlock(&partition->lock);
+
+     return rc;
+} /* oa_delall */
+
+
+/**
+ * @brief Open addressing part of HashTable_Log, for one partition
+ */
+static void
+oa_log(log_components_t component,
+       struct hash_table *ht,
+       struct hash_partition *partition,
+       uint32_t index)
+{
+     struct hash_oa_slots *slots = partition->oa;
+     char dispkey[HASHTABLE_DISPLAY_STRLEN];
+     char dispval[HASHTABLE_DISPLAY_STRLEN];
+     uint32_t i;
+
+     LogFullDebug(component,
+                  "The partition in position %"PRIu32
+                  " contains: %zu entries in %"PRIu32" slots",
+                  index, partition->count, slots->size);
+
+     for (i = 0; i < slots->size; i++) {
+          if (slots->hashes[i] == 0)
+               continue;
+
+          ht->parameter.key_to_str(&slots->data[i].buffkey, dispkey);
+          ht->parameter.val_to_str(&slots->data[i].buffval, dispval);
+
+          LogFullDebug(component,
+                       "%s => %s; index=%"PRIu32" slot=%"PRIu32
+                       " hash=%"PRIu64,
+                       dispkey, dispval, index, i, slots->hashes[i]);
+     }
+} /* oa_log */
+
 /*}@ */
 
 /**
@@ -350,8 +1021,15 @@ HashTable_Init(struct hash_param *hparam)
                goto deconstruct;
           }
 
-          /* Allocate a cache if requested */
-          if (hparam->flags & HT_FLAG_CACHE) {
+          if (hparam->flags & HT_FLAG_OPEN_ADDR) {
+               /* The slots are already what the cache would be */
+               partition->oa = oa_slots_new(HASH_OA_MIN_SLOTS);
+               if (!(partition->oa)) {
+                    pthread_rwlock_destroy(&partition->lock);
+                    goto deconstruct;
+               }
+          } else if (hparam->flags & HT_FLAG_CACHE) {
+               /* Allocate a cache if requested */
                partition->cache = gsh_calloc(1, CACHE_PAGE_SIZE(ht));
                if (!(partition->cache)) {
                     pthread_rwlock_destroy(&partition->lock);
@@ -361,14 +1039,14 @@ HashTable_Init(struct hash_param *hparam)
           completed++;
      }
 
-     ht->node_pool = pool_init(NULL, sizeof(rbt_node_t),
-                               pool_basic_substrate,
+     ht->node_pool = pool_init(ht->parameter.ht_name, sizeof(rbt_node_t),
+                               pool_slab_substrate,
                                NULL, NULL, NULL);
      if (!(ht->node_pool)) {
           goto deconstruct;
      }
-     ht->data_pool = pool_init(NULL, sizeof(hash_data_t),
-                               pool_basic_substrate,
+     ht->data_pool = pool_init(ht->parameter.ht_name, sizeof(hash_data_t),
+                               pool_slab_substrate,
                                NULL, NULL, NULL);
      if (!(ht->data_pool))
           goto deconstruct;
@@ -381,6 +1059,7 @@ deconstruct:
      while (completed != 0) {
           if (hparam->flags & HT_FLAG_CACHE)
               gsh_free(ht->partitions[completed - 1].cache);
+          oa_slots_free(ht->partitions[completed - 1].oa);
 
           pthread_rwlock_destroy(
                &(ht->partitions[completed - 1].lock));
@@ -425,6 +1104,8 @@ HashTable_Destroy(struct hash_table *ht,
                gsh_free(ht->partitions[index].cache);
                ht->partitions[index].cache = NULL;
           }
+          oa_slots_free(ht->partitions[index].oa);
+          ht->partitions[index].oa = NULL;
 
           pthread_rwlock_destroy(&(ht->partitions[index].lock));
      }
@@ -467,8 +1148,12 @@ HashTable_GetLatch(struct hash_table *ht,
 {
      /* The index specifying the partition to search */
      uint32_t index = 0;
+     /* The partition to search */
+     struct hash_partition *partition = NULL;
      /* The node found for the key */
      struct rbt_node *locator = NULL;
+     /* The slot found for the key, open addressing */
+     uint32_t slot = 0;
      /* The buffer descritpros for the key and value for the found entry */
      struct hash_data *data = NULL;
      /* The hash value to be searched for within the Red-Black tree */
@@ -500,18 +1185,35 @@ HashTable_GetLatch(struct hash_table *ht,
                        index, rbt_hash, latch);
      }
 
+     partition = &ht->partitions[index];
+
+     /* Nothing to keep latched, try without the lock first */
+     if (partition->oa != NULL && latch == NULL &&
+         oa_get_lockless(ht, partition, key, oa_hash(rbt_hash), val, &rc))
+          goto out;
+
      /* Acquire mutex */
      if (may_write) {
-          pthread_rwlock_wrlock(&(ht->partitions[index].lock));
+          pthread_rwlock_wrlock(&(partition->lock));
      } else {
-          pthread_rwlock_rdlock(&(ht->partitions[index].lock));
+          pthread_rwlock_rdlock(&(partition->lock));
      }
 
-     rc = Key_Locate(ht, key, index, rbt_hash, &locator);
+     if (partition->oa != NULL) {
+          if (oa_locate(ht, partition->oa, key, oa_hash(rbt_hash), &slot)) {
+               data = &partition->oa->data[slot];
+               rc = HASHTABLE_SUCCESS;
+          } else {
+               rc = HASHTABLE_ERROR_NO_SUCH_KEY;
+          }
+     } else {
+          rc = Key_Locate(ht, key, index, rbt_hash, &locator);
+          if (rc == HASHTABLE_SUCCESS)
+               data = RBT_OPAQ(locator);
+     }
 
      if (rc == HASHTABLE_SUCCESS) {
           /* Key was found */
-          data = RBT_OPAQ(locator);
           if (val) {
                val->pdata = data->buffval.pdata;
                val->len = data->buffval.len;
@@ -540,10 +1242,13 @@ HashTable_GetLatch(struct hash_table *ht,
           latch->index = index;
           latch->rbt_hash = rbt_hash;
           latch->locator = locator;
+          latch->slot = slot;
+          latch->found = (rc == HASHTABLE_SUCCESS);
      } else {
-          pthread_rwlock_unlock(&ht->partitions[index].lock);
+          pthread_rwlock_unlock(&partition->lock);
      }
 
+out:
      if(rc != HASHTABLE_SUCCESS &&
         isDebug(COMPONENT_HASHTABLE) &&
         isFullDebug(ht->parameter.ht_log_component))
@@ -647,6 +1352,12 @@ HashTable_SetLatched(struct hash_table *ht,
                        latch->index, latch->rbt_hash);
      }
 
+     if (ht->partitions[latch->index].oa != NULL) {
+          rc = oa_set_latched(ht, key, val, latch, overwrite,
+                              stored_key, stored_val);
+          goto out;
+     }
+
      /* In the case of collision */
      if (latch->locator) {
           if (!overwrite) {
@@ -771,6 +1482,13 @@ HashTable_DeleteLatched(struct hash_table *ht,
      /* Its partition */
      struct hash_partition *partition = &ht->partitions[latch->index];
 
+     if (partition->oa != NULL) {
+          if (latch->found)
+               oa_delete_latched(ht, latch, stored_key, stored_val);
+          HashTable_ReleaseLatched(ht, latch);
+          return HASHTABLE_SUCCESS;
+     }
+
      if (!latch->locator) {
          HashTable_ReleaseLatched(ht, latch);
          return HASHTABLE_SUCCESS;
@@ -836,6 +1554,7 @@ HashTable_DeleteLatched(struct hash_table *ht,
      RBT_UNLINK(&partition->rbt, latch->locator);
      pool_free(ht->data_pool, data);
      pool_free(ht->node_pool, latch->locator);
+     --partition->count;
 
      HashTable_ReleaseLatched(ht, latch);
      return HASHTABLE_SUCCESS;
@@ -867,6 +1586,12 @@ HashTable_Delall(struct hash_table *ht,
           /* Pointer to node in tree for removal */
           struct rbt_node *cursor = NULL;
 
+          if (ht->partitions[index].oa != NULL) {
+               if (oa_delall(ht, &ht->partitions[index], free_func) != 0)
+                    return HASHTABLE_ERROR_DELALL_FAIL;
+               continue;
+          }
+
           pthread_rwlock_wrlock(&ht->partitions[index].lock);
 
           /* Continue until there are no more entries in the red-black
@@ -936,16 +1661,18 @@ HashTable_GetStats(struct hash_table *ht,
      hstat->entries = 0;
 
      for (i = 0; i < ht->parameter.index_size; i++) {
-          if (ht->partitions[i].rbt.rbt_num_node > hstat->max_rbt_num_node)
-               hstat->max_rbt_num_node
-                    = ht->partitions[i].rbt.rbt_num_node;
+          /* Entries of the partition, whatever its structure */
+          size_t nb = (ht->partitions[i].oa != NULL) ?
+               ht->partitions[i].count :
+               ht->partitions[i].rbt.rbt_num_node;
+
+          if (nb > hstat->max_rbt_num_node)
+               hstat->max_rbt_num_node = nb;
 
-          if (ht->partitions[i].rbt.rbt_num_node < hstat->min_rbt_num_node)
-               hstat->min_rbt_num_node
-                    = ht->partitions[i].rbt.rbt_num_node;
+          if (nb < hstat->min_rbt_num_node)
+               hstat->min_rbt_num_node = nb;
 
-          hstat->average_rbt_num_node
-               += ht->partitions[i].rbt.rbt_num_node;
+          hstat->average_rbt_num_node += nb;
 
           hstat->entries += ht->partitions[i].count;
      }
@@ -1020,6 +1747,10 @@ HashTable_Log(log_components_t component,
                   nb_entries);
 
      for (i = 0; i < ht->parameter.index_size; i++) {
+          if (ht->partitions[i].oa != NULL) {
+               oa_log(component, ht, &ht->partitions[i], i);
+               continue;
+          }
           root = &ht->partitions[i].rbt;
           LogFullDebug(component,
                        "The partition in position %"PRIu32
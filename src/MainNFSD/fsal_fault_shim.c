@@ -0,0 +1,1023 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file fsal_fault_shim.c
+ * \brief Latency and fault injection layer over the FSAL
+ *
+ * \section DESCRIPTION
+ *
+ * The shim is stacked over the loaded FSAL functions at init time and
+ * passes every call through to them, except that each operation it
+ * intercepts first consults a rule: the call may wait in a stall, be
+ * delayed by a latency drawn from a fixed, lognormal or Pareto (heavy
+ * tail) distribution, or fail with a chosen FSAL error at a rate given in
+ * calls per million.  Rules are set live over DBus.
+ *
+ * Rules are read without the lock until an operation is armed, so an
+ * idle shim leaves the FSAL calls as they were but for a test.  Each
+ * operation has its own lock, so that armed operations do not wait on
+ * one another.
+ *
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
+#include "fsal.h"
+#include "log.h"
+#include "common_utils.h"
+#include "fsal_fault_shim.h"
+#ifdef USE_DBUS
+#include "ganesha_dbus.h"
+#endif                          /* USE_DBUS */
+
+struct fsal_shim_rule
+{
+  int armed;                    /* something to inject, read unlocked */
+  fsal_shim_latency_t latency;
+  double param1;
+  double param2;
+  uint32_t err_per_million;
+  fsal_errors_t error;
+  int stalled;
+  struct timespec stall_end;    /* tv_sec 0: until released */
+  fsal_shim_stats_t stats;
+  pthread_mutex_t mutex;        /* protects all of the above */
+  pthread_cond_t cond;          /* signalled when a stall changes */
+};
+
+static const char *fsal_shim_op_names[FSAL_SHIM_NB_OP] = {
+  [FSAL_SHIM_LOOKUP] = "lookup",
+  [FSAL_SHIM_GETATTRS] = "getattrs",
+  [FSAL_SHIM_SETATTRS] = "setattrs",
+  [FSAL_SHIM_ACCESS] = "access",
+  [FSAL_SHIM_CREATE] = "create",
+  [FSAL_SHIM_MKDIR] = "mkdir",
+  [FSAL_SHIM_LINK] = "link",
+  [FSAL_SHIM_RENAME] = "rename",
+  [FSAL_SHIM_UNLINK] = "unlink",
+  [FSAL_SHIM_SYMLINK] = "symlink",
+  [FSAL_SHIM_READLINK] = "readlink",
+  [FSAL_SHIM_OPENDIR] = "opendir",
+  [FSAL_SHIM_READDIR] = "readdir",
+  [FSAL_SHIM_CLOSEDIR] = "closedir",
+  [FSAL_SHIM_OPEN] = "open",
+  [FSAL_SHIM_READ] = "read",
+  [FSAL_SHIM_WRITE] = "write",
+  [FSAL_SHIM_COMMIT] = "commit",
+  [FSAL_SHIM_CLOSE] = "close",
+  [FSAL_SHIM_TRUNCATE] = "truncate",
+  [FSAL_SHIM_LOCK_OP] = "lock_op"
+};
+
+static struct fsal_shim_rule shim_rules[FSAL_SHIM_NB_OP];
+
+/* The functions the shim sits on */
+static fsal_functions_t shim_lower;
+
+static __thread unsigned int shim_seed;
+
+const char *fsal_shim_op_name(fsal_shim_op_t op)
+{
+  if(op < 0 || op >= FSAL_SHIM_NB_OP)
+    return "unknown";
+  return fsal_shim_op_names[op];
+}
+
+/**
+ * fsal_shim_op_by_name: the operation of a name, FSAL_SHIM_ALL_OPS for
+ * "all", or -2 if there is none such.
+ */
+int fsal_shim_op_by_name(const char *name)
+{
+  int op;
+
+  if(!strcmp(name, "all"))
+    return FSAL_SHIM_ALL_OPS;
+
+  for(op = 0; op < FSAL_SHIM_NB_OP; op++)
+    if(!strcmp(name, fsal_shim_op_names[op]))
+      return op;
+
+  return -2;
+}
+
+/* Uniform in (0, 1), never 0 so that it can be given to log() */
+static double fsal_shim_uniform(void)
+{
+  if(shim_seed == 0)
+    shim_seed = (unsigned int)time(NULL) ^ (unsigned int)pthread_self() ^ 1;
+
+  return (rand_r(&shim_seed) + 1.0) / (RAND_MAX + 2.0);
+}
+
+static uint64_t fsal_shim_draw(fsal_shim_latency_t latency,
+                               double param1, double param2)
+{
+  double usec = 0.0;
+  double u1, u2;
+
+  switch (latency)
+    {
+    case FSAL_SHIM_LATENCY_NONE:
+      return 0;
+
+    case FSAL_SHIM_LATENCY_FIXED:
+      usec = param1;
+      break;
+
+    case FSAL_SHIM_LATENCY_LOGNORMAL:
+      /* Box-Muller for the normal deviate */
+      u1 = fsal_shim_uniform();
+      u2 = fsal_shim_uniform();
+      usec = param1 * exp(param2 * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+      break;
+
+    case FSAL_SHIM_LATENCY_PARETO:
+      usec = param1 / pow(fsal_shim_uniform(), 1.0 / param2);
+      break;
+    }
+
+  if(usec >= (double)FSAL_SHIM_MAX_DELAY_USEC)
+    return FSAL_SHIM_MAX_DELAY_USEC;
+
+  return (uint64_t) usec;
+}
+
+/* Called with the mutex of the rule held */
+static void fsal_shim_rearm(struct fsal_shim_rule *rule)
+{
+  rule->armed = rule->latency != FSAL_SHIM_LATENCY_NONE ||
+      rule->err_per_million != 0 || rule->stalled;
+}
+
+/**
+ * fsal_shim_enter: apply the rule of an operation before it goes down.
+ *
+ * Waits out a stall and the drawn latency.  Returns TRUE if the call is
+ * to fail, with the status it fails with in *p_status.
+ */
+static int fsal_shim_enter(fsal_shim_op_t op, fsal_status_t * p_status)
+{
+  struct fsal_shim_rule *rule = &shim_rules[op];
+  uint64_t delay;
+  int fail = FALSE;
+  struct timespec ts;
+
+  if(!rule->armed)
+    return FALSE;
+
+  P(rule->mutex);
+
+  rule->stats.calls++;
+
+  if(rule->stalled)
+    {
+      rule->stats.stalls++;
+      while(rule->stalled)
+        {
+          if(rule->stall_end.tv_sec == 0)
+            pthread_cond_wait(&rule->cond, &rule->mutex);
+          else if(pthread_cond_timedwait(&rule->cond, &rule->mutex,
+                                         &rule->stall_end) == ETIMEDOUT)
+            {
+              rule->stalled = FALSE;
+              fsal_shim_rearm(rule);
+              pthread_cond_broadcast(&rule->cond);
+            }
+        }
+    }
+
+  if(rule->err_per_million != 0 &&
+     fsal_shim_uniform() * 1000000.0 < rule->err_per_million)
+    {
+      rule->stats.errors++;
+      p_status->major = rule->error;
+      p_status->minor = 0;
+      fail = TRUE;
+    }
+
+  delay = fsal_shim_draw(rule->latency, rule->param1, rule->param2);
+  rule->stats.delayed_usec += delay;
+
+  V(rule->mutex);
+
+  if(delay != 0)
+    {
+      ts.tv_sec = delay / 1000000;
+      ts.tv_nsec = (delay % 1000000) * 1000;
+      while(nanosleep(&ts, &ts) != 0 && errno == EINTR) ;
+    }
+
+  return fail;
+}
+
+#define SHIM_CALL( _op_, _call_ ) do {                  \
+    fsal_status_t _st_;                                 \
+    if(fsal_shim_enter(_op_, &_st_))                    \
+      return _st_;                                      \
+    return shim_lower._call_;                           \
+  } while(0)
+
+/* Calls that release a descriptor always reach the FSAL, or an injected
+ * error would leak it: the error replaces the status they return. */
+#define SHIM_CALL_RELEASE( _op_, _call_ ) do {          \
+    fsal_status_t _st_, _lower_st_;                     \
+    int _fail_ = fsal_shim_enter(_op_, &_st_);          \
+    _lower_st_ = shim_lower._call_;                     \
+    return _fail_ ? _st_ : _lower_st_;                  \
+  } while(0)
+
+static fsal_status_t shim_lookup(fsal_handle_t * p_parent_directory_handle,
+                                 fsal_name_t * p_filename,
+                                 fsal_op_context_t * p_context,
+                                 fsal_handle_t * p_object_handle,
+                                 fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_LOOKUP,
+            fsal_lookup(p_parent_directory_handle, p_filename, p_context,
+                        p_object_handle, p_object_attributes));
+}
+
+static fsal_status_t shim_getattrs(fsal_handle_t * p_filehandle,
+                                   fsal_op_context_t * p_context,
+                                   fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_GETATTRS,
+            fsal_getattrs(p_filehandle, p_context, p_object_attributes));
+}
+
+static fsal_status_t shim_setattrs(fsal_handle_t * p_filehandle,
+                                   fsal_op_context_t * p_context,
+                                   fsal_attrib_list_t * p_attrib_set,
+                                   fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_SETATTRS,
+            fsal_setattrs(p_filehandle, p_context, p_attrib_set,
+                          p_object_attributes));
+}
+
+static fsal_status_t shim_access(fsal_handle_t * p_object_handle,
+                                 fsal_op_context_t * p_context,
+                                 fsal_accessflags_t access_type,
+                                 fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_ACCESS,
+            fsal_access(p_object_handle, p_context, access_type,
+                        p_object_attributes));
+}
+
+static fsal_status_t shim_create(fsal_handle_t * p_parent_directory_handle,
+                                 fsal_name_t * p_filename,
+                                 fsal_op_context_t * p_context,
+                                 fsal_accessmode_t accessmode,
+                                 fsal_handle_t * p_object_handle,
+                                 fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_CREATE,
+            fsal_create(p_parent_directory_handle, p_filename, p_context,
+                        accessmode, p_object_handle, p_object_attributes));
+}
+
+static fsal_status_t shim_mkdir(fsal_handle_t * p_parent_directory_handle,
+                                fsal_name_t * p_dirname,
+                                fsal_op_context_t * p_context,
+                                fsal_accessmode_t accessmode,
+                                fsal_handle_t * p_object_handle,
+                                fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_MKDIR,
+            fsal_mkdir(p_parent_directory_handle, p_dirname, p_context,
+                       accessmode, p_object_handle, p_object_attributes));
+}
+
+static fsal_status_t shim_link(fsal_handle_t * p_target_handle,
+                               fsal_handle_t * p_dir_handle,
+                               fsal_name_t * p_link_name,
+                               fsal_op_context_t * p_context,
+                               fsal_attrib_list_t * p_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_LINK,
+            fsal_link(p_target_handle, p_dir_handle, p_link_name, p_context,
+                      p_attributes));
+}
+
+static fsal_status_t shim_rename(fsal_handle_t * p_old_parentdir_handle,
+                                 fsal_name_t * p_old_name,
+                                 fsal_handle_t * p_new_parentdir_handle,
+                                 fsal_name_t * p_new_name,
+                                 fsal_op_context_t * p_context,
+                                 fsal_attrib_list_t * p_src_dir_attributes,
+                                 fsal_attrib_list_t * p_tgt_dir_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_RENAME,
+            fsal_rename(p_old_parentdir_handle, p_old_name,
+                        p_new_parentdir_handle, p_new_name, p_context,
+                        p_src_dir_attributes, p_tgt_dir_attributes));
+}
+
+static fsal_status_t shim_unlink(fsal_handle_t * p_parent_directory_handle,
+                                 fsal_name_t * p_object_name,
+                                 fsal_op_context_t * p_context,
+                                 fsal_attrib_list_t * p_parent_directory_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_UNLINK,
+            fsal_unlink(p_parent_directory_handle, p_object_name, p_context,
+                        p_parent_directory_attributes));
+}
+
+static fsal_status_t shim_symlink(fsal_handle_t * p_parent_directory_handle,
+                                  fsal_name_t * p_linkname,
+                                  fsal_path_t * p_linkcontent,
+                                  fsal_op_context_t * p_context,
+                                  fsal_accessmode_t accessmode,
+                                  fsal_handle_t * p_link_handle,
+                                  fsal_attrib_list_t * p_link_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_SYMLINK,
+            fsal_symlink(p_parent_directory_handle, p_linkname, p_linkcontent,
+                         p_context, accessmode, p_link_handle,
+                         p_link_attributes));
+}
+
+static fsal_status_t shim_readlink(fsal_handle_t * p_linkhandle,
+                                   fsal_op_context_t * p_context,
+                                   fsal_path_t * p_link_content,
+                                   fsal_attrib_list_t * p_link_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_READLINK,
+            fsal_readlink(p_linkhandle, p_context, p_link_content,
+                          p_link_attributes));
+}
+
+static fsal_status_t shim_opendir(fsal_handle_t * p_dir_handle,
+                                  fsal_op_context_t * p_context,
+                                  fsal_dir_t * p_dir_descriptor,
+                                  fsal_attrib_list_t * p_dir_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_OPENDIR,
+            fsal_opendir(p_dir_handle, p_context, p_dir_descriptor,
+                         p_dir_attributes));
+}
+
+static fsal_status_t shim_readdir(fsal_dir_t * p_dir_descriptor,
+                                  fsal_cookie_t start_position,
+                                  fsal_attrib_mask_t get_attr_mask,
+                                  fsal_mdsize_t buffersize,
+                                  fsal_dirent_t * p_pdirent,
+                                  fsal_cookie_t * p_end_position,
+                                  fsal_count_t * p_nb_entries,
+                                  fsal_boolean_t * p_end_of_dir)
+{
+  SHIM_CALL(FSAL_SHIM_READDIR,
+            fsal_readdir(p_dir_descriptor, start_position, get_attr_mask,
+                         buffersize, p_pdirent, p_end_position, p_nb_entries,
+                         p_end_of_dir));
+}
+
+static fsal_status_t shim_closedir(fsal_dir_t * p_dir_descriptor)
+{
+  SHIM_CALL_RELEASE(FSAL_SHIM_CLOSEDIR, fsal_closedir(p_dir_descriptor));
+}
+
+static fsal_status_t shim_open(fsal_handle_t * p_filehandle,
+                               fsal_op_context_t * p_context,
+                               fsal_openflags_t openflags,
+                               fsal_file_t * p_file_descriptor,
+                               fsal_attrib_list_t * p_file_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_OPEN,
+            fsal_open(p_filehandle, p_context, openflags, p_file_descriptor,
+                      p_file_attributes));
+}
+
+static fsal_status_t shim_read(fsal_file_t * p_file_descriptor,
+                               fsal_seek_t * p_seek_descriptor,
+                               fsal_size_t buffer_size,
+                               caddr_t buffer,
+                               fsal_size_t * p_read_amount,
+                               fsal_boolean_t * p_end_of_file)
+{
+  SHIM_CALL(FSAL_SHIM_READ,
+            fsal_read(p_file_descriptor, p_seek_descriptor, buffer_size,
+                      buffer, p_read_amount, p_end_of_file));
+}
+
+/* A READ spliced from the file is still a read of the backend */
+static fsal_status_t shim_read_splice(fsal_file_t * p_file_descriptor,
+                                      fsal_seek_t * p_seek_descriptor,
+                                      fsal_size_t read_size,
+                                      int * p_file_fd,
+                                      fsal_size_t * p_read_amount,
+                                      fsal_boolean_t * p_end_of_file)
+{
+  SHIM_CALL(FSAL_SHIM_READ,
+            fsal_read_splice(p_file_descriptor, p_seek_descriptor, read_size,
+                             p_file_fd, p_read_amount, p_end_of_file));
+}
+
+static fsal_status_t shim_write(fsal_file_t * p_file_descriptor,
+                                fsal_op_context_t * p_context,
+                                fsal_seek_t * p_seek_descriptor,
+                                fsal_size_t buffer_size,
+                                caddr_t buffer,
+                                fsal_size_t * p_write_amount)
+{
+  SHIM_CALL(FSAL_SHIM_WRITE,
+            fsal_write(p_file_descriptor, p_context, p_seek_descriptor,
+                       buffer_size, buffer, p_write_amount));
+}
+
+static fsal_status_t shim_commit(fsal_file_t * p_file_descriptor,
+                                 fsal_off_t offset,
+                                 fsal_size_t size)
+{
+  SHIM_CALL(FSAL_SHIM_COMMIT, fsal_commit(p_file_descriptor, offset, size));
+}
+
+static fsal_status_t shim_close(fsal_file_t * p_file_descriptor)
+{
+  SHIM_CALL_RELEASE(FSAL_SHIM_CLOSE, fsal_close(p_file_descriptor));
+}
+
+static fsal_status_t shim_truncate(fsal_handle_t * p_filehandle,
+                                   fsal_op_context_t * p_context,
+                                   fsal_size_t length,
+                                   fsal_file_t * file_descriptor,
+                                   fsal_attrib_list_t * p_object_attributes)
+{
+  SHIM_CALL(FSAL_SHIM_TRUNCATE,
+            fsal_truncate(p_filehandle, p_context, length, file_descriptor,
+                          p_object_attributes));
+}
+
+static fsal_status_t shim_lock_op(fsal_file_t * p_file_descriptor,
+                                  fsal_handle_t * p_filehandle,
+                                  fsal_op_context_t * p_context,
+                                  void * p_owner,
+                                  fsal_lock_op_t lock_op,
+                                  fsal_lock_param_t request_lock,
+                                  fsal_lock_param_t * conflicting_lock)
+{
+  SHIM_CALL(FSAL_SHIM_LOCK_OP,
+            fsal_lock_op(p_file_descriptor, p_filehandle, p_context, p_owner,
+                         lock_op, request_lock, conflicting_lock));
+}
+
+static fsal_functions_t fsal_shim_stack(fsal_functions_t lower)
+{
+  fsal_functions_t upper = lower;
+
+  shim_lower = lower;
+
+  upper.fsal_lookup = shim_lookup;
+  upper.fsal_getattrs = shim_getattrs;
+  upper.fsal_setattrs = shim_setattrs;
+  upper.fsal_access = shim_access;
+  upper.fsal_create = shim_create;
+  upper.fsal_mkdir = shim_mkdir;
+  upper.fsal_link = shim_link;
+  upper.fsal_rename = shim_rename;
+  upper.fsal_unlink = shim_unlink;
+  upper.fsal_symlink = shim_symlink;
+  upper.fsal_readlink = shim_readlink;
+  upper.fsal_opendir = shim_opendir;
+  upper.fsal_readdir = shim_readdir;
+  upper.fsal_closedir = shim_closedir;
+  upper.fsal_open = shim_open;
+  upper.fsal_read = shim_read;
+  upper.fsal_write = shim_write;
+  upper.fsal_commit = shim_commit;
+  upper.fsal_close = shim_close;
+  upper.fsal_truncate = shim_truncate;
+
+  /* Optional entries stay absent if the FSAL has none */
+  if(lower.fsal_read_splice != NULL)
+    upper.fsal_read_splice = shim_read_splice;
+  if(lower.fsal_lock_op != NULL)
+    upper.fsal_lock_op = shim_lock_op;
+
+  return upper;
+}
+
+static int fsal_shim_range(int op, int *p_first, int *p_last)
+{
+  if(op == FSAL_SHIM_ALL_OPS)
+    {
+      *p_first = 0;
+      *p_last = FSAL_SHIM_NB_OP - 1;
+      return 0;
+    }
+
+  if(op < 0 || op >= FSAL_SHIM_NB_OP)
+    return EINVAL;
+
+  *p_first = *p_last = op;
+  return 0;
+}
+
+int fsal_shim_set_latency(int op, fsal_shim_latency_t latency,
+                          double param1, double param2)
+{
+  int first, last;
+
+  if(fsal_shim_range(op, &first, &last))
+    return EINVAL;
+
+  switch (latency)
+    {
+    case FSAL_SHIM_LATENCY_NONE:
+      break;
+    case FSAL_SHIM_LATENCY_FIXED:
+      if(param1 < 0.0)
+        return EINVAL;
+      break;
+    case FSAL_SHIM_LATENCY_LOGNORMAL:
+      if(param1 <= 0.0 || param2 < 0.0)
+        return EINVAL;
+      break;
+    case FSAL_SHIM_LATENCY_PARETO:
+      if(param1 <= 0.0 || param2 <= 0.0)
+        return EINVAL;
+      break;
+    default:
+      return EINVAL;
+    }
+
+  for(op = first; op <= last; op++)
+    {
+      P(shim_rules[op].mutex);
+      shim_rules[op].latency = latency;
+      shim_rules[op].param1 = param1;
+      shim_rules[op].param2 = param2;
+      fsal_shim_rearm(&shim_rules[op]);
+      V(shim_rules[op].mutex);
+    }
+
+  LogEvent(COMPONENT_FSAL, "FSAL shim: latency %d (%f, %f) on %s",
+           latency, param1, param2,
+           first == last ? fsal_shim_op_name(first) : "all operations");
+  return 0;
+}
+
+int fsal_shim_set_errors(int op, uint32_t per_million, fsal_errors_t error)
+{
+  int first, last;
+
+  if(fsal_shim_range(op, &first, &last))
+    return EINVAL;
+
+  if(per_million > 1000000 || (per_million != 0 && error == ERR_FSAL_NO_ERROR))
+    return EINVAL;
+
+  for(op = first; op <= last; op++)
+    {
+      P(shim_rules[op].mutex);
+      shim_rules[op].err_per_million = per_million;
+      shim_rules[op].error = error;
+      fsal_shim_rearm(&shim_rules[op]);
+      V(shim_rules[op].mutex);
+    }
+
+  LogEvent(COMPONENT_FSAL, "FSAL shim: %u per million %s on %s",
+           per_million, label_fsal_err(error),
+           first == last ? fsal_shim_op_name(first) : "all operations");
+  return 0;
+}
+
+/**
+ * fsal_shim_stall: hold the calls of an operation for msec milliseconds,
+ * or until released if msec is 0.
+ */
+int fsal_shim_stall(int op, uint32_t msec)
+{
+  int first, last;
+  struct timespec end;
+
+  if(fsal_shim_range(op, &first, &last))
+    return EINVAL;
+
+  end.tv_sec = 0;
+  end.tv_nsec = 0;
+  if(msec != 0)
+    {
+      clock_gettime(CLOCK_REALTIME, &end);
+      end.tv_sec += msec / 1000;
+      end.tv_nsec += (msec % 1000) * 1000000;
+      if(end.tv_nsec >= 1000000000)
+        {
+          end.tv_sec++;
+          end.tv_nsec -= 1000000000;
+        }
+    }
+
+  for(op = first; op <= last; op++)
+    {
+      P(shim_rules[op].mutex);
+      shim_rules[op].stalled = TRUE;
+      shim_rules[op].stall_end = end;
+      fsal_shim_rearm(&shim_rules[op]);
+      /* Waiters already stalled pick up the new end */
+      pthread_cond_broadcast(&shim_rules[op].cond);
+      V(shim_rules[op].mutex);
+    }
+
+  LogEvent(COMPONENT_FSAL, "FSAL shim: stall %s for %u msec",
+           first == last ? fsal_shim_op_name(first) : "all operations", msec);
+  return 0;
+}
+
+int fsal_shim_release(int op)
+{
+  int first, last;
+
+  if(fsal_shim_range(op, &first, &last))
+    return EINVAL;
+
+  for(op = first; op <= last; op++)
+    {
+      P(shim_rules[op].mutex);
+      shim_rules[op].stalled = FALSE;
+      fsal_shim_rearm(&shim_rules[op]);
+      pthread_cond_broadcast(&shim_rules[op].cond);
+      V(shim_rules[op].mutex);
+    }
+
+  LogEvent(COMPONENT_FSAL, "FSAL shim: released %s",
+           first == last ? fsal_shim_op_name(first) : "all operations");
+  return 0;
+}
+
+/* Drop the rule of an operation, its counters are kept */
+int fsal_shim_clear(int op)
+{
+  int first, last;
+
+  if(fsal_shim_range(op, &first, &last))
+    return EINVAL;
+
+  for(op = first; op <= last; op++)
+    {
+      P(shim_rules[op].mutex);
+      shim_rules[op].latency = FSAL_SHIM_LATENCY_NONE;
+      shim_rules[op].err_per_million = 0;
+      shim_rules[op].stalled = FALSE;
+      shim_rules[op].armed = FALSE;
+      pthread_cond_broadcast(&shim_rules[op].cond);
+      V(shim_rules[op].mutex);
+    }
+
+  LogEvent(COMPONENT_FSAL, "FSAL shim: cleared %s",
+           first == last ? fsal_shim_op_name(first) : "all operations");
+  return 0;
+}
+
+void fsal_shim_get_stats(fsal_shim_op_t op, fsal_shim_stats_t * p_stats)
+{
+  P(shim_rules[op].mutex);
+  *p_stats = shim_rules[op].stats;
+  V(shim_rules[op].mutex);
+}
+
+#ifdef USE_DBUS
+
+/* XML data to answer org.freedesktop.DBus.Introspectable.Introspect requests */
+static const char* introspection_xml =
+"<!DOCTYPE node PUBLIC \"-//freedesktop//DTD D-BUS Object Introspection 1.0//EN\"\n"
+"\"http://www.freedesktop.org/standards/dbus/1.0/introspect.dtd\">\n"
+"<node>\n"
+"  <interface name=\"org.freedesktop.DBus.Introspectable\">\n"
+"    <method name=\"Introspect\">\n"
+"      <arg name=\"data\" direction=\"out\" type=\"s\"/>\n"
+"    </method>\n"
+"  </interface>\n"
+"  <interface name=\"org.ganesha.nfsd.fsalshim\">\n"
+"    <method name=\"set_latency\">\n"
+"      <arg name=\"op\" direction=\"in\" type=\"s\"/>\n"
+"      <arg name=\"distribution\" direction=\"in\" type=\"s\"/>\n"
+"      <arg name=\"param1\" direction=\"in\" type=\"d\"/>\n"
+"      <arg name=\"param2\" direction=\"in\" type=\"d\"/>\n"
+"    </method>\n"
+"    <method name=\"set_errors\">\n"
+"      <arg name=\"op\" direction=\"in\" type=\"s\"/>\n"
+"      <arg name=\"per_million\" direction=\"in\" type=\"u\"/>\n"
+"      <arg name=\"fsal_error\" direction=\"in\" type=\"u\"/>\n"
+"    </method>\n"
+"    <method name=\"stall\">\n"
+"      <arg name=\"op\" direction=\"in\" type=\"s\"/>\n"
+"      <arg name=\"msec\" direction=\"in\" type=\"u\"/>\n"
+"    </method>\n"
+"    <method name=\"release\">\n"
+"      <arg name=\"op\" direction=\"in\" type=\"s\"/>\n"
+"    </method>\n"
+"    <method name=\"clear\">\n"
+"      <arg name=\"op\" direction=\"in\" type=\"s\"/>\n"
+"    </method>\n"
+"    <method name=\"get_stats\">\n"
+"      <arg name=\"stats\" direction=\"out\" type=\"a(stttt)\"/>\n"
+"    </method>\n"
+"  </interface>\n"
+"</node>\n"
+;
+
+static const char *fsal_shim_latency_names[] = {
+  [FSAL_SHIM_LATENCY_NONE] = "none",
+  [FSAL_SHIM_LATENCY_FIXED] = "fixed",
+  [FSAL_SHIM_LATENCY_LOGNORMAL] = "lognormal",
+  [FSAL_SHIM_LATENCY_PARETO] = "pareto"
+};
+
+static DBusHandlerResult
+fsal_shim_reply(DBusConnection *conn, DBusMessage *msg, int rc)
+{
+  static uint32_t serial = 1;
+  DBusMessage* reply;
+
+  if(rc == 0)
+    reply = dbus_message_new_method_return(msg);
+  else
+    reply = dbus_message_new_error(msg, DBUS_ERROR_INVALID_ARGS,
+                                   strerror(rc));
+
+  if (! dbus_connection_send(conn, reply, &serial)) {
+      LogCrit(COMPONENT_DBUS, "reply failed");
+  }
+
+  dbus_connection_flush(conn);
+  dbus_message_unref(reply);
+  serial++;
+
+  return (DBUS_HANDLER_RESULT_HANDLED);
+}
+
+static DBusHandlerResult
+fsal_shim_dbus_set_latency(DBusConnection *conn, DBusMessage *msg)
+{
+  const char *op_name, *latency_name;
+  double param1, param2;
+  int op, latency;
+
+  if(!dbus_message_get_args(msg, NULL,
+                            DBUS_TYPE_STRING, &op_name,
+                            DBUS_TYPE_STRING, &latency_name,
+                            DBUS_TYPE_DOUBLE, &param1,
+                            DBUS_TYPE_DOUBLE, &param2,
+                            DBUS_TYPE_INVALID))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  for(latency = FSAL_SHIM_LATENCY_PARETO; latency > FSAL_SHIM_LATENCY_NONE;
+      latency--)
+    if(!strcmp(latency_name, fsal_shim_latency_names[latency]))
+      break;
+
+  if(latency == FSAL_SHIM_LATENCY_NONE &&
+     strcmp(latency_name, fsal_shim_latency_names[FSAL_SHIM_LATENCY_NONE]))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  op = fsal_shim_op_by_name(op_name);
+
+  return fsal_shim_reply(conn, msg,
+                         fsal_shim_set_latency(op, latency, param1, param2));
+}
+
+/* Whether an error code from the bus is one of fsal_errors_t */
+static int fsal_shim_known_error(uint32_t error)
+{
+  int i;
+
+  for(i = 0; tab_errstatus_FSAL[i].numero != ERR_NULL; i++)
+    if(tab_errstatus_FSAL[i].numero == (int)error)
+      return TRUE;
+
+  return FALSE;
+}
+
+static DBusHandlerResult
+fsal_shim_dbus_set_errors(DBusConnection *conn, DBusMessage *msg)
+{
+  const char *op_name;
+  uint32_t per_million, error;
+
+  if(!dbus_message_get_args(msg, NULL,
+                            DBUS_TYPE_STRING, &op_name,
+                            DBUS_TYPE_UINT32, &per_million,
+                            DBUS_TYPE_UINT32, &error,
+                            DBUS_TYPE_INVALID))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  if(!fsal_shim_known_error(error))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  return fsal_shim_reply(conn, msg,
+                         fsal_shim_set_errors(fsal_shim_op_by_name(op_name),
+                                              per_million,
+                                              (fsal_errors_t) error));
+}
+
+static DBusHandlerResult
+fsal_shim_dbus_stall(DBusConnection *conn, DBusMessage *msg)
+{
+  const char *op_name;
+  uint32_t msec;
+
+  if(!dbus_message_get_args(msg, NULL,
+                            DBUS_TYPE_STRING, &op_name,
+                            DBUS_TYPE_UINT32, &msec,
+                            DBUS_TYPE_INVALID))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  return fsal_shim_reply(conn, msg,
+                         fsal_shim_stall(fsal_shim_op_by_name(op_name), msec));
+}
+
+/* release and clear, which only take the operation */
+static DBusHandlerResult
+fsal_shim_dbus_by_op(DBusConnection *conn, DBusMessage *msg,
+                     int (*action) (int op))
+{
+  const char *op_name;
+
+  if(!dbus_message_get_args(msg, NULL,
+                            DBUS_TYPE_STRING, &op_name,
+                            DBUS_TYPE_INVALID))
+    return fsal_shim_reply(conn, msg, EINVAL);
+
+  return fsal_shim_reply(conn, msg, action(fsal_shim_op_by_name(op_name)));
+}
+
+static DBusHandlerResult
+fsal_shim_dbus_get_stats(DBusConnection *conn, DBusMessage *msg)
+{
+  static uint32_t serial = 1;
+  DBusMessage* reply;
+  DBusMessageIter iter, sub_iter, struct_iter;
+  fsal_shim_stats_t stats;
+  const char *name;
+  int op;
+
+  reply = dbus_message_new_method_return(msg);
+  dbus_message_iter_init_append(reply, &iter);
+
+  dbus_message_iter_open_container(&iter, DBUS_TYPE_ARRAY, "(stttt)",
+                                   &sub_iter);
+  for(op = 0; op < FSAL_SHIM_NB_OP; op++)
+    {
+      fsal_shim_get_stats(op, &stats);
+      name = fsal_shim_op_names[op];
+
+      dbus_message_iter_open_container(&sub_iter, DBUS_TYPE_STRUCT, NULL,
+                                       &struct_iter);
+      dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_STRING, &name);
+      dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+                                     &stats.calls);
+      dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+                                     &stats.errors);
+      dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+                                     &stats.delayed_usec);
+      dbus_message_iter_append_basic(&struct_iter, DBUS_TYPE_UINT64,
+                                     &stats.stalls);
+      dbus_message_iter_close_container(&sub_iter, &struct_iter);
+    }
+  dbus_message_iter_close_container(&iter, &sub_iter);
+
+  if (! dbus_connection_send(conn, reply, &serial)) {
+      LogCrit(COMPONENT_DBUS, "reply failed");
+  }
+
+  dbus_connection_flush(conn);
+  dbus_message_unref(reply);
+  serial++;
+
+  return (DBUS_HANDLER_RESULT_HANDLED);
+}
+
+static DBusHandlerResult
+fsal_shim_introspection(DBusConnection *conn, DBusMessage *msg)
+{
+  static uint32_t serial = 1;
+  DBusMessage* reply;
+  DBusMessageIter iter;
+
+  /* create a reply from the message */
+  reply = dbus_message_new_method_return(msg);
+  dbus_message_iter_init_append(reply, &iter);
+  dbus_message_iter_append_basic( &iter, DBUS_TYPE_STRING,
+                                  &introspection_xml );
+
+  /* send the reply && flush the connection */
+  if (! dbus_connection_send(conn, reply, &serial)) {
+      LogCrit(COMPONENT_DBUS, "reply failed");
+  }
+
+  dbus_connection_flush(conn);
+  dbus_message_unref(reply);
+  serial++;
+
+  return (DBUS_HANDLER_RESULT_HANDLED);
+}
+
+static DBusHandlerResult
+fsal_shim_entrypoint(DBusConnection *conn, DBusMessage *msg,
+                     void *user_data)
+{
+    const char *interface = dbus_message_get_interface(msg);
+    const char *method = dbus_message_get_member(msg);
+
+    if ((interface && (! strcmp(interface, DBUS_INTERFACE_INTROSPECTABLE))) ||
+        (method && (! strcmp(method, "Introspect")))) {
+        return(fsal_shim_introspection(conn, msg));
+    }
+
+    if (method) {
+        if (! strcmp(method, "set_latency"))
+            return(fsal_shim_dbus_set_latency(conn, msg));
+
+        if (! strcmp(method, "set_errors"))
+            return(fsal_shim_dbus_set_errors(conn, msg));
+
+        if (! strcmp(method, "stall"))
+            return(fsal_shim_dbus_stall(conn, msg));
+
+        if (! strcmp(method, "release"))
+            return(fsal_shim_dbus_by_op(conn, msg, fsal_shim_release));
+
+        if (! strcmp(method, "clear"))
+            return(fsal_shim_dbus_by_op(conn, msg, fsal_shim_clear));
+
+        if (! strcmp(method, "get_stats"))
+            return(fsal_shim_dbus_get_stats(conn, msg));
+    }
+
+    return (DBUS_HANDLER_RESULT_NOT_YET_HANDLED);
+}
+
+#endif                          /* USE_DBUS */
+
+/*
+ * Stack the shim over the FSAL.  Must be called before the workers start
+ * calling the FSAL.
+ */
+/**
+ * fsal_shim_pkginit: stack the shim over the FSAL functions, right after
+ * they are loaded so that no layer above ever calls them directly.
+ */
+void fsal_shim_pkginit(void)
+{
+  int op;
+
+  for(op = 0; op < FSAL_SHIM_NB_OP; op++)
+    {
+      pthread_mutex_init(&shim_rules[op].mutex, NULL);
+      pthread_cond_init(&shim_rules[op].cond, NULL);
+    }
+
+  FSAL_StackFunctions(fsal_shim_stack);
+
+#ifndef USE_DBUS
+  LogCrit(COMPONENT_FSAL,
+          "FSAL fault shim stacked over %s, but it cannot be driven without DBUS",
+          FSAL_GetFSName());
+#endif                          /* !USE_DBUS */
+}
+
+#ifdef USE_DBUS
+/**
+ * fsal_shim_dbus_pkginit: let the rules be set over DBus, once it is up.
+ */
+void fsal_shim_dbus_pkginit(void)
+{
+  (void) gsh_dbus_register_path("FSALShim", fsal_shim_entrypoint);
+  LogEvent(COMPONENT_FSAL, "FSAL fault shim stacked over %s",
+           FSAL_GetFSName());
+}
+#endif                          /* USE_DBUS */
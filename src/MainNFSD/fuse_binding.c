@@ -49,6 +49,9 @@
 #include <pthread.h>
 #include <signal.h>             /* for sigaction */
 #include <errno.h>
+#ifdef _USE_FSAL_SHIM
+#include "fsal_fault_shim.h"
+#endif
 
 /* parameters for NFSd startup and default values */
 
@@ -267,6 +270,10 @@ int ganefuse_main(int argc, char *argv[],
 
   /* Get the FSAL functions */
   FSAL_LoadFunctions();
+#ifdef _USE_FSAL_SHIM
+  /* Stacked before anything else gets to call the FSAL */
+  fsal_shim_pkginit();
+#endif
 
   /* Get the FSAL consts */
   FSAL_LoadConsts();
@@ -50,12 +50,15 @@
 #include "nfs_core.h"
 #include "cache_inode.h"
 #include "cache_inode_lru.h"
+#include "cache_inode_refresh.h"
 #include "err_cache_inode.h"
 #include "nfs_file_handle.h"
 #include "nfs_exports.h"
 #include "nfs_tools.h"
 #include "nfs_proto_functions.h"
 #include "nfs_dupreq.h"
+#include "slab_pool.h"
+#include "nfs_arena.h"
 #include "config_parsing.h"
 #include "SemN.h"
 #include "external_tools.h"
@@ -67,6 +70,9 @@
 #ifdef _USE_CB_SIMULATOR
 #include "nfs_rpc_callback_simulator.h"
 #endif
+#ifdef _USE_FSAL_SHIM
+#include "fsal_fault_shim.h"
+#endif
 #include <sys/time.h>
 #include <sys/resource.h>
 #include <unistd.h>
@@ -113,7 +119,6 @@ pthread_t fcc_gc_thrid;
 pthread_t sigmgr_thrid;
 pthread_t reaper_thrid;
 pthread_t gsh_dbus_thrid;
-pthread_t upp_thrid;
 nfs_tcb_t gccb;
 
 #ifdef _USE_9P
@@ -231,7 +236,14 @@ void nfs_print_param_config()
   printf("\tMNT_Program = %u ;\n", nfs_param.core_param.program[P_NFS]);
   printf("\tNb_Worker = %u ; \n", nfs_param.core_param.nb_worker);
   printf("\tb_Call_Before_Queue_Avg = %u ; \n", nfs_param.core_param.nb_call_before_queue_avg);
+  printf("\tNb_Slow_Worker = %u ; \n", nfs_param.core_param.nb_slow_worker);
+  printf("\tSlow_IO_Size = %u ; \n", nfs_param.core_param.slow_io_size);
+  printf("\tSlow_Readdir_Size = %u ; \n", nfs_param.core_param.slow_readdir_size);
   printf("\tNb_MaxConcurrentGC = %u ; \n", nfs_param.core_param.nb_max_concurrent_gc);
+#ifdef _USE_FSAL_UP
+  printf("\tNb_FSAL_UP_Process = %u ; \n", nfs_param.core_param.nb_fsal_up_process);
+  printf("\tFSAL_UP_Process_Batch = %u ; \n", nfs_param.core_param.fsal_up_process_batch);
+#endif
   printf("\tDupReq_Expiration = %lu ; \n", nfs_param.core_param.expiration_dupreq);
   printf("\tCore_Dump_Size = %ld ; \n", nfs_param.core_param.core_dump_size);
   printf("\tNb_Max_Fd = %d ; \n", nfs_param.core_param.nb_max_fd);
@@ -262,6 +274,11 @@ void nfs_print_param_config()
   else
     printf("\tDrop_Delay_Errors = FALSE ;\n");
 
+  if(nfs_param.core_param.read_splice)
+    printf("\tRead_Splice = TRUE ; \n");
+  else
+    printf("\tRead_Splice = FALSE ;\n");
+
   printf("}\n\n");
 
   printf("NFS_Worker_Param\n{\n");
@@ -277,6 +294,9 @@ void nfs_set_param_default()
   /* Core parameters */
   nfs_param.core_param.nb_worker = NB_WORKER_THREAD_DEFAULT;
   nfs_param.core_param.nb_call_before_queue_avg = NB_REQUEST_BEFORE_QUEUE_AVG;
+  nfs_param.core_param.nb_slow_worker = NB_SLOW_WORKER_DEFAULT;
+  nfs_param.core_param.slow_io_size = SLOW_IO_SIZE_DEFAULT;
+  nfs_param.core_param.slow_readdir_size = SLOW_READDIR_SIZE_DEFAULT;
   nfs_param.core_param.nb_max_concurrent_gc = NB_MAX_CONCURRENT_GC;
   nfs_param.core_param.expiration_dupreq = DUPREQ_EXPIRATION;
   nfs_param.core_param.port[P_NFS] = NFS_PORT;
@@ -325,6 +345,13 @@ void nfs_set_param_default()
 #endif
 
   nfs_param.core_param.clustered = FALSE;
+#ifdef _USE_FSAL_UP
+  nfs_param.core_param.nb_fsal_up_process = NB_FSAL_UP_PROCESS_DEFAULT;
+  nfs_param.core_param.fsal_up_process_batch = FSAL_UP_PROCESS_BATCH_DEFAULT;
+#endif
+  nfs_param.core_param.numa_aware = FALSE;
+  nfs_param.core_param.read_splice = FALSE;
+  nfs_param.core_param.numa_nb_ifaces = 0;
 
   /* Worker parameters : LRU dupreq */
   nfs_param.worker_param.lru_dupreq.nb_call_gc_invalid = 100;
@@ -607,6 +634,7 @@ void nfs_set_param_default()
   cache_inode_params.hparam.hash_func_rbt = NULL;
   cache_inode_params.hparam.hash_func_both = cache_inode_fsal_rbt_both;
   cache_inode_params.hparam.compare_key = cache_inode_compare_key_fsal;
+  cache_inode_params.hparam.key_flatten = cache_inode_fsal_flatten;
   cache_inode_params.hparam.key_to_str = display_cache;
   cache_inode_params.hparam.val_to_str = display_cache;
   cache_inode_params.hparam.ht_name = "Cache Inode";
@@ -643,6 +671,13 @@ void nfs_set_param_default()
   cache_inode_params.grace_period_attr   = 0;
   cache_inode_params.grace_period_link   = 0;
   cache_inode_params.grace_period_dirent = 0;
+  cache_inode_params.grace_period_negative = 5;
+  cache_inode_params.negative_cache_size = 64;
+  cache_inode_params.attr_refresh_ahead = 0;
+  cache_inode_params.attr_stale_bound = 0;
+  cache_inode_params.attr_refresh_threads = 2;
+  cache_inode_params.attr_refresh_batch = 64;
+  cache_inode_params.attr_refresh_queue_size = 4096;
   cache_inode_params.expire_type_attr    = CACHE_INODE_EXPIRE_NEVER;
   cache_inode_params.expire_type_link    = CACHE_INODE_EXPIRE_NEVER;
   cache_inode_params.expire_type_dirent  = CACHE_INODE_EXPIRE_NEVER;
@@ -1143,6 +1178,18 @@ int nfs_check_param_consistency()
       return 1;
     }
 
+  /* Some workers must be left for the other requests */
+  if(nfs_param.core_param.nb_slow_worker != 0 &&
+     nfs_param.core_param.nb_slow_worker >= nfs_param.core_param.nb_worker)
+    {
+      LogCrit(COMPONENT_INIT,
+              "BAD PARAMETER: Nb_Slow_Worker (%u) must be smaller than "
+              "Nb_Worker (%u)",
+              nfs_param.core_param.nb_slow_worker,
+              nfs_param.core_param.nb_worker);
+      return 1;
+    }
+
 #if 0
 /* XXXX this seems somewhat the obvious of what I would have reasoned.
  * Where we had a thread for every connection (but sharing a single
@@ -1430,16 +1477,8 @@ static void nfs_Start_threads(void)
 #endif
 
 #ifdef _USE_FSAL_UP
-  /* Starting the fsal_up_process thread */
- if((rc =
-     pthread_create(&upp_thrid, &attr_thr, fsal_up_process_thread, NULL)) != 0)
-   {
-     LogFatal(COMPONENT_THREAD,
-              "Could not create fsal_up_process_thread, error = %d (%s)",
-              errno, strerror(errno));
-   }
- LogEvent(COMPONENT_THREAD,
-          "fsal_up_process_thread was started successfully");
+  /* Starting the fsal_up_process threads */
+  create_fsal_up_process_threads();
 
   create_fsal_up_threads();
 #endif /* _USE_FSAL_UP */
@@ -1470,6 +1509,13 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
   char GssError[MAXNAMLEN];
 #endif
 
+  /* NUMA topology, needed before any worker, channel or NUMA pool */
+  nfs_numa_init(nfs_param.core_param.numa_aware,
+                nfs_param.core_param.nb_worker,
+                nfs_param.core_param.nb_slow_worker,
+                nfs_param.core_param.numa_ifaces,
+                nfs_param.core_param.numa_nb_ifaces);
+
   /* FSAL Initialisation */
   fsal_status = FSAL_Init(&nfs_param.fsal_param);
   if(FSAL_IS_ERROR(fsal_status))
@@ -1482,6 +1528,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
 #ifdef USE_DBUS
   /* DBUS init */
   gsh_dbus_pkginit();
+#ifdef _USE_FSAL_SHIM
+  fsal_shim_dbus_pkginit();
+#endif
 #endif
 
   /* Cache Inode Initialisation */
@@ -1515,6 +1564,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
      cache_inode_init() so the GC policy has been set */
   cache_inode_lru_pkginit();
 
+  /* Background attribute refresh, once the parameters are read */
+  cache_inode_refresh_pkginit();
+
 #ifdef _USE_NFS4_1
   nfs41_session_pool = pool_init("NFSv4.1 session pool",
                                  sizeof(nfs41_session_t),
@@ -1538,7 +1590,7 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
 
   request_data_pool = pool_init("Request Data Pool",
                                 sizeof(nfs_request_data_t),
-                                pool_basic_substrate,
+                                pool_numa_substrate,
                                 NULL,
                                 constructor_nfs_request_data_t,
                                 NULL);
@@ -1552,7 +1604,7 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
 
   dupreq_pool = pool_init("Duplicate Request Pool",
                           sizeof(dupreq_entry_t),
-                          pool_basic_substrate,
+                          pool_slab_substrate,
                           NULL, NULL, NULL);
   if(!(dupreq_pool))
     {
@@ -1562,6 +1614,9 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
       Fatal();
     }
 
+  /* Arenas holding the NFSv4 COMPOUND results */
+  nfs_arena_pkginit();
+
   ip_stats_pool = pool_init("IP Stats Cache Pool",
                             sizeof(nfs_ip_stats_t),
                             pool_basic_substrate,
@@ -1671,6 +1726,7 @@ static void nfs_Init(const nfs_start_info_t * p_start_info)
 
       /* Set the index (mostly used for debug purpose */
       workers_data[i].worker_index = i;
+      workers_data[i].numa_node = nfs_numa_worker_node(i);
 
       /* Fill in workers fields (semaphores and other stangenesses */
       if(nfs_Init_worker_data(&(workers_data[i])) != 0)
@@ -2102,6 +2158,9 @@ void nfs_start(nfs_start_info_t * p_start_info)
   LogEvent(COMPONENT_MAIN,
            "NFS EXIT: regular exit");
 
+  /* Stop the background attribute refresh, dropping its references */
+  cache_inode_refresh_pkgshutdown();
+
   /* if not in grace period, clean up the old state directory */
   if(!nfs_in_grace())
     nfs4_clean_old_recov_dir();
@@ -51,6 +51,9 @@
 #ifdef _PNFS
 #include "fsal_pnfs.h"
 #endif /* _PNFS */
+#ifdef _USE_FSAL_SHIM
+#include "fsal_fault_shim.h"
+#endif
 
 /* parameters for NFSd startup and default values */
 
@@ -307,6 +310,10 @@ int main(int argc, char *argv[])
 
   /* Get the FSAL functions */
   FSAL_LoadFunctions();
+#ifdef _USE_FSAL_SHIM
+  /* Stacked before anything else gets to call the FSAL */
+  fsal_shim_pkginit();
+#endif
 
   /* Get the FSAL consts */
   FSAL_LoadConsts();
@@ -85,16 +85,18 @@ static pthread_mutex_t lock_worker_selection = PTHREAD_MUTEX_INITIALIZER;
 struct rpc_evchan {
     uint32_t chan_id;
     pthread_t thread_id;
+    uint32_t numa_node; /* node index of TCP channels, else NODE_ANY */
 };
 
 #define N_TCP_EVENT_CHAN  3 /* we don't really want to have too many, relative to the
-                             * number of available cores. */
+                             * number of available cores. (per NUMA node) */
 #define UDP_EVENT_CHAN    0 /* put udp on a dedicated channel */
 #define TCP_RDVS_CHAN     1 /* accepts new tcp connections */
 #define TCP_EVCHAN_0      2
-#define N_EVENT_CHAN N_TCP_EVENT_CHAN + 2
+#define N_EVENT_CHAN_MAX (N_TCP_EVENT_CHAN * NFS_NUMA_MAX_NODES + 2)
 
-static struct rpc_evchan rpc_evchan[N_EVENT_CHAN];
+static struct rpc_evchan rpc_evchan[N_EVENT_CHAN_MAX];
+static uint32_t n_event_chan; /* TCP_EVCHAN_0 + N_TCP_EVENT_CHAN per node */
 
 static u_int nfs_rpc_rdvs(SVCXPRT *xprt, SVCXPRT *newxprt, const u_int flags,
                           void *u_data);
@@ -508,8 +510,15 @@ void nfs_Init_svc()
       LogCrit(COMPONENT_INIT, "Failed redirecting TI-RPC __free");
 #endif /* TIRPC_SET_ALLOCATORS */
 
-    for (ix = 0; ix < N_EVENT_CHAN; ++ix) {
+    /* One group of TCP channels per NUMA node, the node of channel
+     * TCP_EVCHAN_0 + i being i / N_TCP_EVENT_CHAN */
+    n_event_chan = TCP_EVCHAN_0 + N_TCP_EVENT_CHAN * nfs_numa_nb_nodes();
+
+    for (ix = 0; ix < n_event_chan; ++ix) {
         rpc_evchan[ix].chan_id = 0;
+        rpc_evchan[ix].numa_node =
+            (ix < TCP_EVCHAN_0) ? NFS_NUMA_NODE_ANY
+                                : (ix - TCP_EVCHAN_0) / N_TCP_EVENT_CHAN;
         if ((code = svc_rqst_new_evchan(&rpc_evchan[ix].chan_id, NULL /* u_data */,
                                         SVC_RQST_FLAG_NONE)))
             LogFatal(COMPONENT_DISPATCH,
@@ -695,11 +704,11 @@ void nfs_rpc_dispatch_threads(pthread_attr_t *attr_thr)
     int ix, code = 0;
 
     /* Start event channel service threads */
-    for (ix = 0; ix < N_EVENT_CHAN; ++ix) {
+    for (ix = 0; ix < n_event_chan; ++ix) {
         if((code = pthread_create(&rpc_evchan[ix].thread_id,
                                   attr_thr,
                                   rpc_dispatcher_thread,
-                                  (void *) &rpc_evchan[ix].chan_id)) != 0) {
+                                  (void *) &rpc_evchan[ix])) != 0) {
             LogFatal(COMPONENT_THREAD,
                    "Could not create rpc_dispatcher_thread #%u, error = %d (%s)",
                      ix, errno, strerror(errno));
@@ -707,7 +716,7 @@ void nfs_rpc_dispatch_threads(pthread_attr_t *attr_thr)
     }
     LogEvent(COMPONENT_THREAD,
              "%d rpc dispatcher threads were started successfully",
-             N_EVENT_CHAN); 
+             n_event_chan);
 }
 
 /*
@@ -717,23 +726,42 @@ void nfs_rpc_dispatch_threads(pthread_attr_t *attr_thr)
  * Register newxprt on a TCP event channel.  Balancing events/channels could
  * become involved.  To start with, just cycle through them as new connections
  * are accepted.
+ *
+ * With NUMA awareness, the connection is first given a node: the one its
+ * local address is bound to in the configuration, or the next one in
+ * turn.  It then cycles through that node's channels only, and all of its
+ * requests will be served by that node's workers.
  */
 static u_int nfs_rpc_rdvs(SVCXPRT *xprt, SVCXPRT *newxprt, const u_int flags,
                           void *u_data)
 {
-    static uint32_t next_chan = TCP_EVCHAN_0;
-    pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
-    uint32_t tchan;
+    static uint32_t next_node = 0;
+    static pthread_mutex_t mtx = PTHREAD_MUTEX_INITIALIZER;
+    gsh_xprt_private_t *xu;
+    nfs_numa_node_t *node;
+    uint32_t tchan, node_idx;
+
+    /* setup private data (freed when xprt is destroyed) */
+    newxprt->xp_u1 = xu = alloc_gsh_xprt_private(XPRT_PRIVATE_FLAG_REF);
+    xu->flags |= XPRT_PRIVATE_FLAG_STREAM;
+
+    node_idx = nfs_numa_fd_node(newxprt->xp_fd);
 
     pthread_mutex_lock(&mtx);
 
-    tchan = next_chan;
-    assert((next_chan >= TCP_EVCHAN_0) && (next_chan < N_EVENT_CHAN));
-    if (++next_chan >= N_EVENT_CHAN)
-        next_chan = TCP_EVCHAN_0;
+    if (node_idx == NFS_NUMA_NODE_ANY) {
+        node_idx = next_node;
+        if (++next_node >= nfs_numa_nb_nodes())
+            next_node = 0;
+    }
+    node = nfs_numa_get_node(node_idx);
+
+    tchan = TCP_EVCHAN_0 + node_idx * N_TCP_EVENT_CHAN + node->next_chan;
+    assert((tchan >= TCP_EVCHAN_0) && (tchan < n_event_chan));
+    if (++node->next_chan >= N_TCP_EVENT_CHAN)
+        node->next_chan = 0;
 
-    /* setup private data (freed when xprt is destroyed) */
-    newxprt->xp_u1 = alloc_gsh_xprt_private(XPRT_PRIVATE_FLAG_REF);
+    xu->numa_node = node_idx;
 
     pthread_mutex_unlock(&mtx);
 
@@ -801,8 +829,16 @@ worker_available(unsigned long worker_index, unsigned int avg_number_pending)
   return rc;
 }
 
-unsigned int
-nfs_core_select_worker_queue(unsigned int avoid_index)
+/**
+ * Selects the smallest request queue among the nb_worker workers
+ * starting at first_worker.  *last is the round-robin cursor of that
+ * range; lock_worker_selection must be held.
+ */
+static unsigned int
+select_worker_queue_range(unsigned int avoid_index,
+                          unsigned int first_worker,
+                          unsigned int nb_worker,
+                          unsigned int *last)
 {
   #define NO_VALUE_CHOOSEN  1000000
   unsigned int worker_index = NO_VALUE_CHOOSEN;
@@ -812,28 +848,26 @@ nfs_core_select_worker_queue(unsigned int avoid_index)
   unsigned int cpt = 0;
 
   static unsigned int counter;
-  static unsigned int last;
   worker_available_rc rc_worker;
 
-  P(lock_worker_selection);
   counter++;
 
   /* Calculate the average queue length if counter is bigger than configured value. */
   if(counter > nfs_param.core_param.nb_call_before_queue_avg)
     {
-      for(i = 0; i < nfs_param.core_param.nb_worker; i++)
+      for(i = first_worker; i < first_worker + nb_worker; i++)
         {
           total_number_pending += workers_data[i].pending_request_len;
         }
-      avg_number_pending = total_number_pending / nfs_param.core_param.nb_worker;
+      avg_number_pending = total_number_pending / nb_worker;
       /* Reset counter. */
       counter = 0;
     }
 
   /* Choose the queue whose length is smaller than average. */
-  for(i = (last + 1) % nfs_param.core_param.nb_worker, cpt = 0;
-      cpt < nfs_param.core_param.nb_worker;
-      cpt++, i = (i + 1) % nfs_param.core_param.nb_worker)
+  for(i = first_worker + (*last + 1 - first_worker) % nb_worker, cpt = 0;
+      cpt < nb_worker;
+      cpt++, i = first_worker + (i + 1 - first_worker) % nb_worker)
     {
       /* Avoid worker at avoid_index (provided to permit a worker thread to avoid
        * dispatching work to itself). */
@@ -859,16 +893,55 @@ nfs_core_select_worker_queue(unsigned int avoid_index)
     } /* for */
 
   if(worker_index == NO_VALUE_CHOOSEN)
-    worker_index = (last + 1) % nfs_param.core_param.nb_worker;
-
-  last = worker_index;
+    worker_index = first_worker + (*last + 1 - first_worker) % nb_worker;
 
-  V(lock_worker_selection);
+  *last = worker_index;
 
   return worker_index;
+} /* select_worker_queue_range */
 
+unsigned int
+nfs_core_select_worker_queue(unsigned int avoid_index)
+{
+  return nfs_core_select_worker_queue_node(avoid_index, NFS_NUMA_NODE_ANY,
+                                           NFS_REQ_CLASS_FAST);
 } /* nfs_core_select_worker_queue */
 
+/**
+ * Same as nfs_core_select_worker_queue, restricted to the workers of
+ * one NUMA node (NFS_NUMA_NODE_ANY stands for the node of the calling
+ * thread) and to those serving req_class: slow requests go to the
+ * slow workers of the node, when it has any, everything else to the
+ * other workers.
+ */
+unsigned int
+nfs_core_select_worker_queue_node(unsigned int avoid_index,
+                                  unsigned int numa_node,
+                                  nfs_req_class_t req_class)
+{
+  nfs_numa_node_t *node;
+  unsigned int nb_fast, worker_index;
+
+  if(numa_node == NFS_NUMA_NODE_ANY)
+    numa_node = nfs_numa_thread_node();
+
+  node = nfs_numa_get_node(numa_node);
+  nb_fast = node->nb_worker - node->nb_slow_worker;
+
+  P(lock_worker_selection);
+  if(req_class == NFS_REQ_CLASS_SLOW && node->nb_slow_worker != 0)
+    worker_index = select_worker_queue_range(avoid_index,
+                                             node->first_worker + nb_fast,
+                                             node->nb_slow_worker,
+                                             &node->last_slow_worker);
+  else
+    worker_index = select_worker_queue_range(avoid_index, node->first_worker,
+                                             nb_fast, &node->last_worker);
+  V(lock_worker_selection);
+
+  return worker_index;
+} /* nfs_core_select_worker_queue_node */
+
 /**
  * nfs_rpc_get_nfsreq: get a request frame (call or svc request)
  */
@@ -884,7 +957,8 @@ nfs_rpc_get_nfsreq(nfs_worker_data_t *worker, uint32_t flags)
 
 process_status_t
 dispatch_rpc_subrequest(nfs_worker_data_t *mydata,
-                        request_data_t *onfsreq)
+                        request_data_t *onfsreq,
+                        nfs_req_class_t req_class)
 {
   char *cred_area;
   struct rpc_msg *msg;
@@ -893,8 +967,10 @@ dispatch_rpc_subrequest(nfs_worker_data_t *mydata,
   unsigned int worker_index;
   process_status_t rc = PROCESS_DONE;
 
-  /* choose a worker who is not us */
-  worker_index = nfs_core_select_worker_queue(mydata->worker_index);
+  /* choose a worker who is not us, on our own node */
+  worker_index = nfs_core_select_worker_queue_node(mydata->worker_index,
+                                                   mydata->numa_node,
+                                                   req_class);
 
   LogDebug(COMPONENT_DISPATCH,
            "Use request from Worker Thread #%u's pool, xprt->xp_fd=%d, "
@@ -962,6 +1038,7 @@ process_status_t dispatch_rpc_request(SVCXPRT *xprt)
   request_data_t *nfsreq = NULL;
   unsigned int worker_index;
   process_status_t rc = PROCESS_DONE;
+  gsh_xprt_private_t *xu = (gsh_xprt_private_t *) xprt->xp_u1;
 
   /* A few thread manage only mount protocol, check for this */
 
@@ -976,8 +1053,12 @@ process_status_t dispatch_rpc_request(SVCXPRT *xprt)
   else
 #endif
     {
-       /* choose a worker depending on its queue length */
-       worker_index = nfs_core_select_worker_queue( WORKER_INDEX_ANY );
+       /* choose a worker depending on its queue length, on the node
+        * serving this xprt if any.  The request is not decoded yet, the
+        * slow workers are left alone */
+       worker_index = nfs_core_select_worker_queue_node(WORKER_INDEX_ANY,
+                                                        xu->numa_node,
+                                                        NFS_REQ_CLASS_FAST);
     }
 
   LogFullDebug(COMPONENT_DISPATCH,
@@ -1153,17 +1234,22 @@ int print_pending_request(LRU_data_t data, char *str)
  *
  * Thread used to service an (epoll, etc) event channel.
  *
- * @param arg, points to the id of the associated event channel
+ * @param arg, points to the associated event channel
  *
  * @return Pointer to the result (but this function will mostly loop forever).
  *
  */
 void *rpc_dispatcher_thread(void *arg)
 {
-    int32_t chan_id = *((int32_t *) arg);
+    struct rpc_evchan *evchan = (struct rpc_evchan *) arg;
+    int32_t chan_id = evchan->chan_id;
     
     SetNameFunction("dispatch_thr");
 
+    /* TCP channels serve the workers of one NUMA node, run there */
+    if (evchan->numa_node != NFS_NUMA_NODE_ANY)
+        (void) nfs_numa_bind_thread(evchan->numa_node);
+
     /* Calling dispatcher main loop */
     LogInfo(COMPONENT_DISPATCH,
             "Entering nfs/rpc dispatcher");
@@ -47,10 +47,18 @@
 #include <assert.h>
 #include <sys/stat.h>
 #include <time.h>
+#include <inttypes.h>
 #include "nfs_core.h"
 #include "nfs_stat.h"
 #include "nfs_exports.h"
 #include "log.h"
+#include "slab_pool.h"
+#include "nfs_xdr_reply.h"
+#include "cache_inode_inflight.h"
+#include "cache_inode_negative.h"
+#include "cache_inode_refresh.h"
+#include "cache_inode_lru.h"
+#include "fsal_up.h"
 
 extern hash_table_t *ht_ip_stats[NB_MAX_WORKER_THREAD];
 
@@ -391,6 +399,19 @@ void *stats_thread(void *UnusedArg)
   char strbootdate[1024];
   unsigned int j = 0;
   int reopen_stats = FALSE;
+  uint64_t xdr_reply_count, xdr_reply_bytes;
+  uint64_t splice_sent, splice_bytes, splice_fetched;
+  uint64_t ra_sequential, ra_hits, ra_hints, ra_hinted_bytes;
+  uint64_t commits_requested, commits_fsal;
+  uint64_t get_lead, get_coalesced, lookup_lead, lookup_coalesced;
+  uint64_t neg_hits, neg_misses, neg_inserts, neg_invalidations;
+  uint64_t ref_queued, ref_refused, ref_refreshed, ref_batches, ref_stale;
+  struct cache_inode_lru_stats lru_stats;
+#ifdef _USE_FSAL_UP
+  struct fsal_up_process_stats up_stats;
+#endif
+  size_t entry_size, embedded_size;
+  uint64_t files_cold, dirs;
 
   ganesha_stats_t        ganesha_stats;
   nfs_worker_stat_t      *global_worker_stat = &ganesha_stats.global_worker_stat;
@@ -513,6 +534,97 @@ void *stats_thread(void *UnusedArg)
               cache_inode_stat->max_rbt_num_node,
               cache_inode_stat->average_rbt_num_node);
 
+      /* Printing the cache misses sent to the FSAL, and those that
+         waited for another thread's call instead */
+      cache_inode_inflight_get_stats(&get_lead, &get_coalesced,
+                                     &lookup_lead, &lookup_coalesced);
+      fprintf(stats_file,
+              "CACHE_INODE_MISSES,%s;%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+              strdate, get_lead, get_coalesced, lookup_lead,
+              lookup_coalesced);
+
+      /* Printing the use of the negative lookup cache */
+      cache_inode_negative_get_stats(&neg_hits, &neg_misses,
+                                     &neg_inserts, &neg_invalidations);
+      fprintf(stats_file,
+              "CACHE_INODE_NEGATIVE,%s;%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+              strdate, neg_hits, neg_misses, neg_inserts,
+              neg_invalidations);
+
+      /* Printing the work of the background attribute refresh */
+      cache_inode_refresh_get_stats(&ref_queued, &ref_refused,
+                                    &ref_refreshed, &ref_batches,
+                                    &ref_stale);
+      fprintf(stats_file,
+              "CACHE_INODE_REFRESH,%s;%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+              strdate, ref_queued, ref_refused, ref_refreshed,
+              ref_batches, ref_stale);
+
+      /* Printing the hit rate of the cache and the work of its
+         adaptive replacement */
+      cache_inode_lru_get_stats(&lru_stats);
+      fprintf(stats_file,
+              "CACHE_INODE_LRU,%s;%"PRIu64",%"PRIu64"|%"PRIu64"|%"PRIu64",%"PRIu64"|%"PRIu64",%"PRIu64"|%"PRIu64"\n",
+              strdate, lru_stats.hits, lru_stats.misses,
+              lru_stats.promotions,
+              lru_stats.evictions_l1, lru_stats.evictions_l2,
+              lru_stats.ghost_hits_l1, lru_stats.ghost_hits_l2,
+              lru_stats.target_l1);
+
+      /* Printing the memory used by cache entries, against what it
+         would be with the cold parts of every entry inside it */
+      cache_inode_memory_get_stats(&entry_size, &embedded_size,
+                                   &files_cold, &dirs);
+      fprintf(stats_file,
+              "CACHE_INODE_MEMORY,%s;%zu,%zu|%"PRIu64",%zu|%"PRIu64",%zu|%"PRIu64",%"PRIu64"\n",
+              strdate, entry_size, embedded_size,
+              files_cold, sizeof(cache_inode_file_cold_t),
+              dirs, sizeof(cache_inode_dir_tree_t),
+              (uint64_t) cache_inode_stat->entries * entry_size +
+              files_cold * sizeof(cache_inode_file_cold_t) +
+              dirs * sizeof(cache_inode_dir_tree_t),
+              (uint64_t) cache_inode_stat->entries * embedded_size);
+
+#ifdef _USE_FSAL_UP
+      /* Printing the FSAL UP events processed, coalesced, and how far
+         behind their processing is */
+      fsal_up_process_get_stats(&up_stats);
+      fprintf(stats_file,
+              "FSAL_UP,%s;%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"|%u,%u|%"PRIu64",%"PRIu64"\n",
+              strdate, up_stats.queued, up_stats.coalesced,
+              up_stats.processed, up_stats.batches,
+              up_stats.depth, up_stats.max_depth,
+              up_stats.lag, up_stats.max_lag);
+#endif
+
+      /* Printing the slab pools usage */
+      pool_slab_dump_stats(stats_file, strdate);
+
+      /* Printing the replies kept for retransmission, by wire size */
+      nfs_xdr_reply_get_stats(&xdr_reply_count, &xdr_reply_bytes);
+      fprintf(stats_file, "CACHED_REPLIES,%s;%"PRIu64",%"PRIu64"\n",
+              strdate, xdr_reply_count, xdr_reply_bytes);
+
+      /* Printing the sequential READs, those the readahead was ahead
+         of, and the hints given to the FSAL with their bytes */
+      cache_inode_readahead_get_stats(&ra_sequential, &ra_hits, &ra_hints,
+                                      &ra_hinted_bytes);
+      fprintf(stats_file,
+              "READAHEAD,%s;%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64"\n",
+              strdate, ra_sequential, ra_hits, ra_hints, ra_hinted_bytes);
+
+      /* Printing the COMMITs and stable writes, and the FSAL_commits
+         they shared */
+      cache_inode_commit_get_stats(&commits_requested, &commits_fsal);
+      fprintf(stats_file, "COMMITS,%s;%"PRIu64",%"PRIu64"\n",
+              strdate, commits_requested, commits_fsal);
+
+      /* Printing the READ replies sent from a pipe, their bytes, and
+         those whose data had to be fetched into a buffer */
+      nfs_read_splice_get_stats(&splice_sent, &splice_bytes, &splice_fetched);
+      fprintf(stats_file, "READ_SPLICE,%s;%"PRIu64",%"PRIu64",%"PRIu64"\n",
+              strdate, splice_sent, splice_bytes, splice_fetched);
+
       fprintf(stats_file, "NFS/MOUNT STATISTICS,%s;%u,%u,%u|%u,%u,%u,%u,%u|%u,%u,%u,%u\n",
               strdate,
               global_worker_stat->nb_total_req,
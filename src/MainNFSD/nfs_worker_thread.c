@@ -223,7 +223,7 @@ const nfs_function_desc_t nfs4_func_desc[] = {
    (xdrproc_t) xdr_void, "nfs_Null",
    NOTHING_SPECIAL},
   {nfs4_Compound, nfs4_Compound_Free, (xdrproc_t) xdr_COMPOUND4args,
-   (xdrproc_t) xdr_COMPOUND4res, "nfs4_Compound", NEEDS_CRED}
+   (xdrproc_t) xdr_COMPOUND4res_extended, "nfs4_Compound", NEEDS_CRED}
 };
 
 const nfs_function_desc_t mnt1_func_desc[] = {
@@ -746,6 +746,135 @@ int nfs_rpc_get_args(nfs_request_data_t *preqnfs, const nfs_function_desc_t *pfu
   return TRUE;
 }
 
+static inline nfs_req_class_t
+nfs_rpc_class_by_size(u_int size, unsigned int threshold)
+{
+  return size >= threshold ? NFS_REQ_CLASS_SLOW : NFS_REQ_CLASS_FAST;
+}
+
+/*
+ * A COMPOUND is as slow as its slowest operation.  Only a COMPOUND
+ * made of a single RENEW or SEQUENCE maintains a lease.
+ */
+static nfs_req_class_t
+nfs4_classify_compound(COMPOUND4args *parg)
+{
+  const nfs_core_parameter_t *pcore = &nfs_param.core_param;
+  nfs_argop4 *op;
+  u_int i;
+
+  if(parg->argarray.argarray_len == 1 &&
+     (parg->argarray.argarray_val[0].argop == NFS4_OP_RENEW ||
+      parg->argarray.argarray_val[0].argop == NFS4_OP_SEQUENCE))
+    return NFS_REQ_CLASS_LEASE;
+
+  for(i = 0; i < parg->argarray.argarray_len; i++)
+    {
+      op = &parg->argarray.argarray_val[i];
+      switch(op->argop)
+        {
+        case NFS4_OP_COMMIT:
+          return NFS_REQ_CLASS_SLOW;
+
+        case NFS4_OP_WRITE:
+          if(op->nfs_argop4_u.opwrite.stable != UNSTABLE4 ||
+             op->nfs_argop4_u.opwrite.data.data_len >= pcore->slow_io_size)
+            return NFS_REQ_CLASS_SLOW;
+          break;
+
+        case NFS4_OP_READ:
+          if(op->nfs_argop4_u.opread.count >= pcore->slow_io_size)
+            return NFS_REQ_CLASS_SLOW;
+          break;
+
+        case NFS4_OP_READDIR:
+          if(op->nfs_argop4_u.opreaddir.maxcount >=
+             pcore->slow_readdir_size)
+            return NFS_REQ_CLASS_SLOW;
+          break;
+
+        default:
+          break;
+        }
+    }
+
+  return NFS_REQ_CLASS_FAST;
+}
+
+/**
+ * @brief Estimate the cost of a decoded request
+ *
+ * Commits, synchronous or large writes, large reads and large
+ * directory listings are slow: when slow workers are configured
+ * (Nb_Slow_Worker) they are handed over to them, so that they do not
+ * hold up the cheap requests queued behind them.  The NULL procedures
+ * and the NFSv4 COMPOUNDs only made of RENEW or SEQUENCE keep a
+ * client's lease alive and are always run at once.
+ *
+ * @param[in] preqnfs The request, its arguments already decoded
+ *
+ * @return The class of the request.
+ */
+nfs_req_class_t
+nfs_rpc_classify_request(nfs_request_data_t *preqnfs)
+{
+  const nfs_core_parameter_t *pcore = &nfs_param.core_param;
+  struct svc_req *req = &preqnfs->req;
+  nfs_arg_t *parg = &preqnfs->arg_nfs;
+
+  /* NULL is procedure 0 of every program */
+  if(req->rq_proc == 0)
+    return NFS_REQ_CLASS_LEASE;
+
+  if(req->rq_prog != pcore->program[P_NFS])
+    return NFS_REQ_CLASS_FAST;
+
+  switch(req->rq_vers)
+    {
+    case NFS_V2:
+      switch(req->rq_proc)
+        {
+        case NFSPROC_WRITE:
+          /* Always synchronous */
+          return NFS_REQ_CLASS_SLOW;
+        case NFSPROC_READ:
+          return nfs_rpc_class_by_size(parg->arg_read2.count,
+                                       pcore->slow_io_size);
+        case NFSPROC_READDIR:
+          return nfs_rpc_class_by_size(parg->arg_readdir2.count,
+                                       pcore->slow_readdir_size);
+        }
+      break;
+
+    case NFS_V3:
+      switch(req->rq_proc)
+        {
+        case NFSPROC3_COMMIT:
+          return NFS_REQ_CLASS_SLOW;
+        case NFSPROC3_WRITE:
+          if(parg->arg_write3.stable != UNSTABLE)
+            return NFS_REQ_CLASS_SLOW;
+          return nfs_rpc_class_by_size(parg->arg_write3.count,
+                                       pcore->slow_io_size);
+        case NFSPROC3_READ:
+          return nfs_rpc_class_by_size(parg->arg_read3.count,
+                                       pcore->slow_io_size);
+        case NFSPROC3_READDIR:
+          return nfs_rpc_class_by_size(parg->arg_readdir3.count,
+                                       pcore->slow_readdir_size);
+        case NFSPROC3_READDIRPLUS:
+          return nfs_rpc_class_by_size(parg->arg_readdirplus3.maxcount,
+                                       pcore->slow_readdir_size);
+        }
+      break;
+
+    case NFS_V4:
+      return nfs4_classify_compound(&parg->arg_compound4);
+    }
+
+  return NFS_REQ_CLASS_FAST;
+}
+
 /**
  * nfs_rpc_execute: main rpc dispatcher routine
  *
@@ -762,6 +891,7 @@ static void nfs_rpc_execute(request_data_t *preq,
   nfs_request_data_t *preqnfs = preq->r_u.nfs;
   nfs_arg_t *parg_nfs = &preqnfs->arg_nfs;
   nfs_res_t res_nfs;
+  nfs_xdr_reply_t *reply = NULL;
   short exportid;
   LRU_list_t *lru_dupreq = NULL;
   struct svc_req *req = &preqnfs->req;
@@ -771,6 +901,7 @@ static void nfs_rpc_execute(request_data_t *preq,
   int port;
   int rc;
   int do_dupreq_cache;
+  int splice_rc;
   dupreq_status_t dpq_status;
   exportlist_client_entry_t related_client;
   struct user_cred user_credentials;
@@ -830,7 +961,7 @@ static void nfs_rpc_execute(request_data_t *preq,
 
   do_dupreq_cache = pworker_data->pfuncdesc->dispatch_behaviour & CAN_BE_DUP;
   LogFullDebug(COMPONENT_DISPATCH, "do_dupreq_cache = %d", do_dupreq_cache);
-  dpq_status = nfs_dupreq_add_not_finished(req, &res_nfs);
+  dpq_status = nfs_dupreq_add_not_finished(req, &reply);
   switch(dpq_status)
     {
       /* a new request, continue processing it */
@@ -852,10 +983,11 @@ static void nfs_rpc_execute(request_data_t *preq,
                        "Before svc_sendreply on socket %d (dup req)",
                        xprt->xp_fd);
 
+          /* The cached reply is sent as it was encoded */
           svc_dplx_lock_x(xprt, &pworker_data->sigmask);
           if(svc_sendreply2
-             (xprt, req, pworker_data->pfuncdesc->xdr_encode_func,
-              (caddr_t) &res_nfs) == FALSE)
+             (xprt, req, (xdrproc_t) xdr_nfs_xdr_reply,
+              (caddr_t) reply) == FALSE)
             {
               LogDebug(COMPONENT_DISPATCH,
                        "NFS DISPATCHER: FAILURE: Error while calling "
@@ -863,6 +995,7 @@ static void nfs_rpc_execute(request_data_t *preq,
               svcerr_systemerr2(xprt, req);
             }
           svc_dplx_unlock_x(xprt, &pworker_data->sigmask);
+          nfs_xdr_reply_unref(reply);
 
           LogFullDebug(COMPONENT_DISPATCH,
                        "After svc_sendreply on socket %d (dup req)",
@@ -1371,6 +1504,9 @@ static void nfs_rpc_execute(request_data_t *preq,
 
       pfsal_op_ctx =  &pworker_data->thread_fsal_context ;
 
+      nfs_read_splice_allow(&pworker_data->read_splice, xprt, req,
+                            do_dupreq_cache);
+
       rc = pworker_data->pfuncdesc->service_function(parg_nfs,
                                                      pexport,
                                                      pfsal_op_ctx,
@@ -1379,6 +1515,13 @@ static void nfs_rpc_execute(request_data_t *preq,
                                                      &res_nfs);
     }
 
+  /* READ data to be spliced are read into the reply, unless the reply
+   * can be sent through the pipe */
+  if(rc == NFS_REQ_OK && pworker_data->read_splice.pending &&
+     !nfs_read_splice_is_tail(&pworker_data->read_splice, req, &res_nfs) &&
+     !nfs_read_splice_fetch(&pworker_data->read_splice))
+    rc = NFS_REQ_DROP;
+
   /* Perform statistics here */
   gettimeofday(&timer_end, NULL);
 
@@ -1487,11 +1630,42 @@ static void nfs_rpc_execute(request_data_t *preq,
                    "Before svc_sendreply on socket %d",
                    xprt->xp_fd);
 
+      /* A reply to be cached is encoded once: the same bytes are sent
+       * now and kept for a retransmission.  If that fails, the reply is
+       * sent as usual and the request is not cached. */
+      if(do_dupreq_cache)
+        {
+          reply = nfs_xdr_reply_encode(pworker_data->pfuncdesc->xdr_encode_func,
+                                       (caddr_t) &res_nfs);
+          if(reply == NULL)
+            do_dupreq_cache = FALSE;
+        }
+
       svc_dplx_lock_x(xprt, &pworker_data->sigmask);
 
+      /* A READ reply whose data are to be spliced is written through
+       * the pipe.  Failing that before anything was written, the data
+       * are read into it and the reply goes the usual way. */
+      splice_rc = 1;
+      if(pworker_data->read_splice.pending)
+        {
+          splice_rc = nfs_read_splice_send(&pworker_data->read_splice,
+                                           xprt, req,
+                                           pworker_data->pfuncdesc->xdr_encode_func,
+                                           (caddr_t) &res_nfs);
+          if(splice_rc < 0)
+            LogDebug(COMPONENT_DISPATCH,
+                     "NFS DISPATCHER: FAILURE: Unable to send a READ reply "
+                     "from its pipe");
+        }
+
       /* encoding the result on xdr output */
-      if(svc_sendreply2(xprt, req, pworker_data->pfuncdesc->xdr_encode_func,
-                        (caddr_t) &res_nfs) == FALSE)
+      if(splice_rc > 0 &&
+         ((reply != NULL) ?
+          svc_sendreply2(xprt, req, (xdrproc_t) xdr_nfs_xdr_reply,
+                         (caddr_t) reply) :
+          svc_sendreply2(xprt, req, pworker_data->pfuncdesc->xdr_encode_func,
+                         (caddr_t) &res_nfs)) == FALSE)
         {
           LogDebug(COMPONENT_DISPATCH,
                    "NFS DISPATCHER: FAILURE: Error while calling svc_sendreply");
@@ -1504,6 +1678,7 @@ static void nfs_rpc_execute(request_data_t *preq,
                       __LINE__);
             }
           svc_dplx_unlock_x(xprt, &pworker_data->sigmask);
+          nfs_xdr_reply_unref(reply);
           return;
         }
 
@@ -1515,7 +1690,8 @@ static void nfs_rpc_execute(request_data_t *preq,
       LogFullDebug(COMPONENT_DUPREQ, "YES?: %d", do_dupreq_cache);
       if(do_dupreq_cache)
         {
-          dpq_status = nfs_dupreq_finish(req, &res_nfs, lru_dupreq);
+          dpq_status = nfs_dupreq_finish(req, reply, lru_dupreq);
+          nfs_xdr_reply_unref(reply);
         }
     } /* rc == NFS_REQ_DROP */
 
@@ -1534,10 +1710,10 @@ static void nfs_rpc_execute(request_data_t *preq,
 
   /* XXX we must hold xprt lock across SVC_FREEARGS */
   svc_dplx_unlock_x(xprt, &pworker_data->sigmask);
+
+  nfs_read_splice_done(&pworker_data->read_splice);
     
-  /* Free the reply.
-   * This should not be done if the request is dupreq cached because this will
-   * mark the dupreq cached info eligible for being reuse by other requests */
+  /* Requests that are not cached leave the dupreq cache */
   if(!do_dupreq_cache)
     {
       if (nfs_dupreq_delete(req) != DUPREQ_SUCCESS)
@@ -1546,12 +1722,13 @@ static void nfs_rpc_execute(request_data_t *preq,
                   "Attempt to delete duplicate request failed on line %d",
                   __LINE__);
         }
-      /* Free only the non dropped requests */
-      if(rc == NFS_REQ_OK) {
-          pworker_data->pfuncdesc->free_function(&res_nfs);
-      }
     }
 
+  /* Free the reply, a cached one lives on in its encoded form.  Free
+   * only the non dropped requests. */
+  if(rc == NFS_REQ_OK)
+    pworker_data->pfuncdesc->free_function(&res_nfs);
+
   /* By now the dupreq cache entry should have been completed w/ a request
    * that is reusable or the dupreq cache entry should have been removed. */
   return;
@@ -1597,6 +1774,7 @@ int nfs_Init_worker_data(nfs_worker_data_t * pdata)
 
   pdata->passcounter = 0;
   pdata->wcb.tcb_ready = FALSE;
+  nfs_read_splice_init(&pdata->read_splice);
   pdata->gc_in_progress = FALSE;
   pdata->pfuncdesc = INVALID_FUNCDESC;
 
@@ -1738,13 +1916,31 @@ cond_multi_dispatch(nfs_worker_data_t *pmydata, request_data_t *nfsreq,
     enum xprt_stat stat;
     bool_t try_multi = FALSE, dispatched = FALSE;
     SVCXPRT *xprt = nfsreq->r_u.nfs->xprt;
+    nfs_req_class_t req_class;
 
     stat = SVC_STAT(xprt);
     svc_dplx_unlock_x(xprt, &pmydata->sigmask);
     *locked = FALSE;
 
-    if (stat == XPRT_MOREREQS)
-        try_multi = TRUE;
+    req_class = nfs_rpc_classify_request(nfsreq->r_u.nfs);
+
+    switch (req_class) {
+    case NFS_REQ_CLASS_LEASE:
+        /* Cheap, and must not wait behind anything: run it here */
+        break;
+    case NFS_REQ_CLASS_SLOW:
+        /* Hand it to a slow worker even if nothing else is waiting on
+         * this xprt, the next requests must not wait for it.  Without
+         * slow workers it is treated like any other request. */
+        if (stat == XPRT_MOREREQS ||
+            nfs_numa_get_node(pmydata->numa_node)->nb_slow_worker != 0)
+            try_multi = TRUE;
+        break;
+    case NFS_REQ_CLASS_FAST:
+        if (stat == XPRT_MOREREQS)
+            try_multi = TRUE;
+        break;
+    }
 
 #if 0 /* XXX */
     try_multi = FALSE;
@@ -1757,16 +1953,19 @@ cond_multi_dispatch(nfs_worker_data_t *pmydata, request_data_t *nfsreq,
         xu = (gsh_xprt_private_t *) xprt->xp_u1;
 
         LogDebug(COMPONENT_DISPATCH, "xprt=%p try_multi=TRUE multi_cnt=%u "
-                "refcnt=%u",
+                "refcnt=%u class=%d",
                 xprt,
                 xu->multi_cnt,
-                xu->refcnt);
+                xu->refcnt,
+                req_class);
 
-        /* we need an atomic total-outstanding counter, check against hiwat */
+        /* we need an atomic total-outstanding counter, check against hiwat.
+         * Slow requests count against it too, or a client could queue
+         * any number of them; past the limit they run here. */
         if (xu->multi_cnt < nfs_param.core_param.dispatch_multi_xprt_max) {
             ++(xu->multi_cnt);
             /* dispatch it */
-            rc_multi = dispatch_rpc_subrequest(pmydata, nfsreq);
+            rc_multi = dispatch_rpc_subrequest(pmydata, nfsreq, req_class);
             dispatched = TRUE;
         }
         pthread_rwlock_unlock(&xprt->lock);
@@ -1981,6 +2180,9 @@ void *worker_thread(void *IndexArg)
   snprintf(thr_name, sizeof(thr_name), "Worker Thread #%lu", worker_index);
   SetNameFunction(thr_name);
 
+  /* Run on the NUMA node whose event channels feed this worker */
+  (void) nfs_numa_bind_thread(pmydata->numa_node);
+
   /* save current signal mask */
   rc = pthread_sigmask(SIG_SETMASK, (sigset_t *) 0, &pmydata->sigmask);
   if (rc) {
@@ -144,6 +144,7 @@ int _9p_attach( _9p_request_data_t * preq9p,
 
   /* Get the related pentry */
   fsdata.fh_desc.start = (char *)pexport->proot_handle ;
+  fsdata.hash = 0;
   FSAL_ExpandHandle(pfid->fsal_op_context.export_context, FSAL_DIGEST_SIZEOF, &fsdata.fh_desc);
 
   /* refcount */
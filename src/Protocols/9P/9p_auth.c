@@ -144,6 +144,7 @@ int _9p_auth( _9p_request_data_t * preq9p,
 
   /* Get the related pentry */
   fsdata.fh_desc.start = (char *)pexport->proot_handle ;
+  fsdata.hash = 0;
   fsdata.fh_desc.len = sizeof( fsal_handle_t ) ;
 
   pfid->pentry = cache_inode_get( &fsdata,
@@ -127,6 +127,7 @@ int _9p_write( _9p_request_data_t * preq9p,
                           &eof_met,
                           &pfid->fsal_op_context,
                           stable_flag,
+                          0,
                           &cache_status ) != CACHE_INODE_SUCCESS )
         return _9p_rerror( preq9p, msgtag, _9p_tools_errno( cache_status), plenout, preply ) ;
 
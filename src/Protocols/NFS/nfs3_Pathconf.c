@@ -109,6 +109,7 @@ int nfs3_Pathconf(nfs_arg_t *parg,
       rc = NFS_REQ_DROP;
       goto out;
     }
+  (void) cache_inode_fsal_data_hash(&fsal_data);
 
   /* Get the entry in the cache_inode */
   if((pentry = cache_inode_get(&fsal_data,
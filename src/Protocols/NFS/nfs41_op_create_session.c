@@ -175,13 +175,13 @@ int nfs41_op_create_session(struct nfs_argop4 *op,
          && (pfound->cid_create_session_slot.cache_used == TRUE))
         {
           data->use_drc = TRUE;
-          data->pcached_res = &pfound->cid_create_session_slot.cached_result;
+          data->pcached_slot = &pfound->cid_create_session_slot;
 
           res_CREATE_SESSION4.csr_status = NFS4_OK;
 
           dec_client_id_ref(pfound);
 
-          LogDebug(component, "CREATE_SESSION replay=%p special case", data->pcached_res);
+          LogDebug(component, "CREATE_SESSION replay=%p special case", data->pcached_slot);
 
           goto out;
         }
@@ -324,10 +324,10 @@ int nfs41_op_create_session(struct nfs_argop4 *op,
          NFS4_SESSIONID_SIZE);
 
   /* Create Session replay cache */
-  data->pcached_res = &pfound->cid_create_session_slot.cached_result;
+  data->pcached_slot = &pfound->cid_create_session_slot;
   pfound->cid_create_session_slot.cache_used = TRUE;
 
-  LogDebug(component, "CREATE_SESSION replay=%p", data->pcached_res);
+  LogDebug(component, "CREATE_SESSION replay=%p", data->pcached_slot);
 
   if(!nfs41_Session_Set(nfs41_session->session_id, nfs41_session))
     {
@@ -128,18 +128,20 @@ int nfs41_op_sequence(struct nfs_argop4 *op,
             {
               /* Replay operation through the DRC */
               data->use_drc = TRUE;
-              data->pcached_res = &psession->slots[arg_SEQUENCE4.sa_slotid].cached_result;
+              data->pcached_slot = &psession->slots[arg_SEQUENCE4.sa_slotid];
 
               LogFullDebug(COMPONENT_SESSIONS,
                            "Use sesson slot %"PRIu32"=%p for DRC",
-                           arg_SEQUENCE4.sa_slotid, data->pcached_res);
+                           arg_SEQUENCE4.sa_slotid, data->pcached_slot);
 
+              V(psession->slots[arg_SEQUENCE4.sa_slotid].lock);
               res_SEQUENCE4.sr_status = NFS4_OK;
               return res_SEQUENCE4.sr_status;
             }
           else
             {
               /* Illegal replay */
+              V(psession->slots[arg_SEQUENCE4.sa_slotid].lock);
               res_SEQUENCE4.sr_status = NFS4ERR_RETRY_UNCACHED_REP;
               return res_SEQUENCE4.sr_status;
             }
@@ -166,16 +168,16 @@ int nfs41_op_sequence(struct nfs_argop4 *op,
 
   if(arg_SEQUENCE4.sa_cachethis == TRUE)
     {
-      data->pcached_res = &psession->slots[arg_SEQUENCE4.sa_slotid].cached_result;
+      data->pcached_slot = &psession->slots[arg_SEQUENCE4.sa_slotid];
       psession->slots[arg_SEQUENCE4.sa_slotid].cache_used = TRUE;
 
       LogFullDebug(COMPONENT_SESSIONS,
                    "Use sesson slot %"PRIu32"=%p for DRC",
-                   arg_SEQUENCE4.sa_slotid, data->pcached_res);
+                   arg_SEQUENCE4.sa_slotid, data->pcached_slot);
     }
   else
     {
-      data->pcached_res = NULL;
+      data->pcached_slot = NULL;
       psession->slots[arg_SEQUENCE4.sa_slotid].cache_used = FALSE;
 
       LogFullDebug(COMPONENT_SESSIONS,
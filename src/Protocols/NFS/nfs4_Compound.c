@@ -217,6 +217,9 @@ int nfs4_Compound(nfs_arg_t *parg,
   char __attribute__ ((__unused__)) funcname[] = "nfs4_Compound";
   compound_data_t data;
   int opindex;
+#ifdef _USE_NFS4_1
+  nfs_xdr_reply_t *reply = NULL, *old_reply = NULL;
+#endif
   #define TAGLEN 64
   char tagstr[TAGLEN + 1 + 5];
 
@@ -293,21 +296,44 @@ int nfs4_Compound(nfs_arg_t *parg,
   if(nfs_rpc_req2client_cred(preq, &(data.credential)) == -1)
     return NFS_REQ_DROP;        /* Malformed credential */
 
-  /* Keeping the same tag as in the arguments */
-  memcpy(&(pres->res_compound4.tag), &(parg->arg_compound4.tag),
-         sizeof(parg->arg_compound4.tag));
-
-  if(utf8dup(&(pres->res_compound4.tag), &(parg->arg_compound4.tag)) == -1)
+  /* The results of the operations are allocated from an arena that
+   * the reply keeps until it is freed, see nfs4_Compound_Free */
+  if((data.arena = nfs_arena_new()) == NULL)
     {
-      LogCrit(COMPONENT_NFS_V4, "Unable to duplicate tag into response");
+      LogCrit(COMPONENT_NFS_V4, "Unable to allocate the reply arena");
       return NFS_REQ_DROP;
     }
+  pres->res_compound4_extended.res_arena = data.arena;
+
+  /* Keeping the same tag as in the arguments */
+  pres->res_compound4.tag.utf8string_len =
+    parg->arg_compound4.tag.utf8string_len;
+  pres->res_compound4.tag.utf8string_val = NULL;
+  if(parg->arg_compound4.tag.utf8string_len != 0)
+    {
+      pres->res_compound4.tag.utf8string_val =
+        nfs_arena_alloc(data.arena, parg->arg_compound4.tag.utf8string_len);
+      if(pres->res_compound4.tag.utf8string_val == NULL)
+        {
+          LogCrit(COMPONENT_NFS_V4, "Unable to duplicate tag into response");
+          nfs_arena_free(data.arena);
+          pres->res_compound4_extended.res_arena = NULL;
+          return NFS_REQ_DROP;
+        }
+      memcpy(pres->res_compound4.tag.utf8string_val,
+             parg->arg_compound4.tag.utf8string_val,
+             parg->arg_compound4.tag.utf8string_len);
+    }
 
   /* Allocating the reply nfs_resop4 */
   if((pres->res_compound4.resarray.resarray_val =
-      gsh_calloc((COMPOUND4_ARRAY.argarray_len),
-                 sizeof(struct nfs_resop4))) == NULL)
+      nfs_arena_calloc(data.arena, COMPOUND4_ARRAY.argarray_len,
+                       sizeof(struct nfs_resop4))) == NULL)
     {
+      nfs_arena_free(data.arena);
+      pres->res_compound4_extended.res_arena = NULL;
+      pres->res_compound4.tag.utf8string_len = 0;
+      pres->res_compound4.tag.utf8string_val = NULL;
       return NFS_REQ_DROP;
     }
 
@@ -434,14 +460,36 @@ int nfs4_Compound(nfs_arg_t *parg,
            */
           LogFullDebug(COMPONENT_SESSIONS,
                        "Use session replay cache %p",
-                       data.pcached_res);
+                       data.pcached_slot);
+
+          /* Take a reference on the reply, the slot may be reused
+           * while it is sent again */
+          P(data.pcached_slot->lock);
+          reply = data.pcached_slot->cached_reply;
+          if(reply != NULL)
+            nfs_xdr_reply_ref(reply);
+          V(data.pcached_slot->lock);
 
-          /* Free the reply allocated above */
-          gsh_free(pres->res_compound4.resarray.resarray_val);
+          if(reply == NULL)
+            {
+              /* The reply could not be kept */
+              status = NFS4ERR_RETRY_UNCACHED_REP;
+              pres->res_compound4.resarray.resarray_val[i].nfs_resop4_u.opaccess.
+                  status = status;
+              pres->res_compound4.resarray.resarray_len = i + 1;
+              break;
+            }
 
-          /* Copy the reply from the cache */
-          pres->res_compound4_extended = *data.pcached_res;
-          status = ((COMPOUND4res *) data.pcached_res)->status;
+          /* The encoded reply is sent as is, drop the one being built */
+          nfs_arena_free(data.arena);
+          data.arena = NULL;
+          pres->res_compound4_extended.res_arena = NULL;
+          pres->res_compound4.tag.utf8string_len = 0;
+          pres->res_compound4.tag.utf8string_val = NULL;
+          pres->res_compound4.resarray.resarray_len = 0;
+          pres->res_compound4.resarray.resarray_val = NULL;
+          pres->res_compound4_extended.res_reply = reply;
+          status = NFS4_OK;
           break;    /* Exit the for loop */
         }
 #endif
@@ -454,28 +502,36 @@ int nfs4_Compound(nfs_arg_t *parg,
   /* Manage session's DRC: keep NFS4.1 replay for later use, but don't save a
    * replayed result again.
    */
-  if(data.pcached_res != NULL && !data.use_drc)
+  if(data.pcached_slot != NULL && !data.use_drc)
     {
       /* Pointer has been set by nfs41_op_sequence and points to slot to cache
-       * result in.
+       * result in.  The reply is encoded once, here: the worker sends
+       * these bytes and the slot keeps them for a retransmission.
        */
-      LogFullDebug(COMPONENT_SESSIONS,
-                   "Save result in session replay cache %p sizeof nfs_res_t=%d",
-                   data.pcached_res,
-                   (int) sizeof(nfs_res_t));
-
-      /* Indicate to nfs4_Compound_Free that this reply is cached. */
-      pres->res_compound4_extended.res_cached = TRUE;
+      /* The slot keeps the bytes, the data of a READ among them */
+      if(data.pworker != NULL)
+        nfs_read_splice_fetch(&data.pworker->read_splice);
 
-      /* If the cache is already in use, free it. */
-      if(data.pcached_res->res_cached)
-        {
-          data.pcached_res->res_cached = FALSE;
-          nfs4_Compound_Free((nfs_res_t *)data.pcached_res);
-        }
+      reply = nfs_xdr_reply_encode((xdrproc_t) xdr_COMPOUND4res,
+                                   (caddr_t) &pres->res_compound4);
 
-      /* Save the result in the cache. */
-      *data.pcached_res = pres->res_compound4_extended;
+      LogFullDebug(COMPONENT_SESSIONS,
+                   "Save result in session replay cache %p len=%u",
+                   data.pcached_slot,
+                   reply != NULL ? reply->len : 0);
+
+      if(reply != NULL)
+        nfs_xdr_reply_ref(reply);
+
+      P(data.pcached_slot->lock);
+      old_reply = data.pcached_slot->cached_reply;
+      data.pcached_slot->cached_reply = reply;
+      if(reply == NULL)
+        data.pcached_slot->cache_used = FALSE;
+      V(data.pcached_slot->lock);
+
+      nfs_xdr_reply_unref(old_reply);
+      pres->res_compound4_extended.res_reply = reply;
     }
 
   /* If we have reserved a lease, update it and release it */
@@ -735,13 +791,10 @@ void nfs4_Compound_Free(nfs_res_t *pres)
   if(isFullDebug(COMPONENT_SESSIONS))
     component = COMPONENT_SESSIONS;
 
-  if(pres->res_compound4_extended.res_cached)
-    {
-      LogFullDebug(component,
-                   "Skipping free of NFS4 result %p",
-                   pres);
-      return;
-    }
+  /* Release the encoded reply, if any: a session slot holds its own
+   * reference on it */
+  nfs_xdr_reply_unref(pres->res_compound4_extended.res_reply);
+  pres->res_compound4_extended.res_reply = NULL;
 
   LogFullDebug(component,
                "nfs4_Compound_Free %p (resarraylen=%i)",
@@ -757,12 +810,32 @@ void nfs4_Compound_Free(nfs_res_t *pres)
       }
   }
 
-  gsh_free(pres->res_compound4.resarray.resarray_val);
-  free_utf8(&pres->res_compound4.tag);
+  /* The reply array, the tag and most of the results live there */
+  nfs_arena_free(pres->res_compound4_extended.res_arena);
+  pres->res_compound4_extended.res_arena = NULL;
 
   return;
 }                               /* nfs4_Compound_Free */
 
+/**
+ * @brief Encode the result of NFS4PROC_COMPOUND
+ *
+ * When the reply was already encoded for a session slot, its bytes
+ * are sent instead of encoding the results again.
+ *
+ * @param[in] xdrs The XDR stream
+ * @param[in] objp The result
+ *
+ * @return TRUE on success, FALSE otherwise.
+ */
+bool_t xdr_COMPOUND4res_extended(XDR * xdrs, COMPOUND4res_extended * objp)
+{
+  if(objp->res_reply != NULL)
+    return xdr_nfs_xdr_reply(xdrs, objp->res_reply);
+
+  return xdr_COMPOUND4res(xdrs, &objp->res_compound4);
+}                               /* xdr_COMPOUND4res_extended */
+
 /**
  *
  * compound_data_Free: Frees the compound data structure.
@@ -802,151 +875,6 @@ void compound_data_Free(compound_data_t * data)
 
 }                               /* compound_data_Free */
 
-/**
- *
- * nfs4_Compound_CopyResOne: Copy the result for one NFS4_OP
- *
- */
-void nfs4_Compound_CopyResOne(nfs_resop4 * pres_dst, nfs_resop4 * pres_src)
-{
-  /* Copy base data structure */
-  memcpy(pres_dst, pres_src, sizeof(*pres_dst));
-
-  /* Do deep copy where necessary */
-  switch (pres_src->resop)
-    {
-      case NFS4_OP_ACCESS:
-        break;
-
-      case NFS4_OP_CLOSE:
-        nfs4_op_close_CopyRes(&(pres_dst->nfs_resop4_u.opclose),
-                              &(pres_src->nfs_resop4_u.opclose));
-        return;
-
-      case NFS4_OP_COMMIT:
-      case NFS4_OP_CREATE:
-      case NFS4_OP_DELEGPURGE:
-      case NFS4_OP_DELEGRETURN:
-      case NFS4_OP_GETATTR:
-      case NFS4_OP_GETFH:
-      case NFS4_OP_LINK:
-        break;
-
-      case NFS4_OP_LOCK:
-        nfs4_op_lock_CopyRes(&(pres_dst->nfs_resop4_u.oplock),
-                             &(pres_src->nfs_resop4_u.oplock));
-        return;
-
-      case NFS4_OP_LOCKT:
-        break;
-
-      case NFS4_OP_LOCKU:
-        nfs4_op_locku_CopyRes(&(pres_dst->nfs_resop4_u.oplocku),
-                              &(pres_src->nfs_resop4_u.oplocku));
-        return;
-
-      case NFS4_OP_LOOKUP:
-      case NFS4_OP_LOOKUPP:
-      case NFS4_OP_NVERIFY:
-        break;
-
-      case NFS4_OP_OPEN:
-        nfs4_op_open_CopyRes(&(pres_dst->nfs_resop4_u.opopen),
-                             &(pres_src->nfs_resop4_u.opopen));
-        return;
-
-      case NFS4_OP_OPENATTR:
-        break;
-
-      case NFS4_OP_OPEN_CONFIRM:
-        nfs4_op_open_confirm_CopyRes(&(pres_dst->nfs_resop4_u.opopen_confirm),
-                                     &(pres_src->nfs_resop4_u.opopen_confirm));
-        return;
-
-      case NFS4_OP_OPEN_DOWNGRADE:
-        nfs4_op_open_downgrade_CopyRes(&(pres_dst->nfs_resop4_u.opopen_downgrade),
-                                       &(pres_src->nfs_resop4_u.opopen_downgrade));
-        return;
-
-      case NFS4_OP_PUTFH:
-      case NFS4_OP_PUTPUBFH:
-      case NFS4_OP_PUTROOTFH:
-      case NFS4_OP_READ:
-      case NFS4_OP_READDIR:
-      case NFS4_OP_READLINK:
-      case NFS4_OP_REMOVE:
-      case NFS4_OP_RENAME:
-      case NFS4_OP_RENEW:
-      case NFS4_OP_RESTOREFH:
-      case NFS4_OP_SAVEFH:
-      case NFS4_OP_SECINFO:
-      case NFS4_OP_SETATTR:
-      case NFS4_OP_SETCLIENTID:
-      case NFS4_OP_SETCLIENTID_CONFIRM:
-      case NFS4_OP_VERIFY:
-      case NFS4_OP_WRITE:
-      case NFS4_OP_RELEASE_LOCKOWNER:
-        break;
-
-#ifdef _USE_NFS4_1
-      case NFS4_OP_EXCHANGE_ID:
-      case NFS4_OP_CREATE_SESSION:
-      case NFS4_OP_SEQUENCE:
-      case NFS4_OP_GETDEVICEINFO:
-      case NFS4_OP_GETDEVICELIST:
-      case NFS4_OP_BACKCHANNEL_CTL:
-      case NFS4_OP_BIND_CONN_TO_SESSION:
-      case NFS4_OP_DESTROY_SESSION:
-      case NFS4_OP_FREE_STATEID:
-      case NFS4_OP_GET_DIR_DELEGATION:
-      case NFS4_OP_LAYOUTCOMMIT:
-      case NFS4_OP_LAYOUTGET:
-      case NFS4_OP_LAYOUTRETURN:
-      case NFS4_OP_SECINFO_NO_NAME:
-      case NFS4_OP_SET_SSV:
-      case NFS4_OP_TEST_STATEID:
-      case NFS4_OP_WANT_DELEGATION:
-      case NFS4_OP_DESTROY_CLIENTID:
-      case NFS4_OP_RECLAIM_COMPLETE:
-        break;
-#endif
-
-      case NFS4_OP_ILLEGAL:
-        break;
-    }                       /* switch */
-
-  LogFatal(COMPONENT_NFS_V4,
-           "nfs4_Compound_CopyResOne not implemented for %d",
-           pres_src->resop);
-}
-
-/**
- *
- * nfs4_Compound_CopyRes: Copy the result for NFS4PROC_COMPOUND
- *
- * Copy the result for NFS4PROC_COMPOUND.
- *
- * @param resp pointer to be freed
- *
- * @return nothing (void function).
- *
- * @see nfs4_op_getfh
- *
- */
-void nfs4_Compound_CopyRes(nfs_res_t * pres_dst, nfs_res_t * pres_src)
-{
-  unsigned int i = 0;
-
-  LogFullDebug(COMPONENT_NFS_V4,
-               "nfs4_Compound_CopyRes of %p to %p (resarraylen : %i)",
-               pres_src, pres_dst,
-               pres_src->res_compound4.resarray.resarray_len);
-
-  for(i = 0; i < pres_src->res_compound4.resarray.resarray_len; i++)
-    nfs4_Compound_CopyResOne(&pres_dst->res_compound4.resarray.resarray_val[i],
-                             &pres_src->res_compound4.resarray.resarray_val[i]);
-}
-
 /**
  *
  *  nfs4_op_stat_update: updates the NFSv4 operations specific statistics for a COMPOUND4 requests (either v4.0 or v4.1).
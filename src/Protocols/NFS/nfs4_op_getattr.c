@@ -172,7 +172,6 @@ int nfs4_op_getattr(struct nfs_argop4 *op,
  */
 void nfs4_op_getattr_Free(GETATTR4res * resp)
 {
-  if(resp->status == NFS4_OK)
-    nfs4_Fattr_Free(&resp->GETATTR4res_u.resok4.obj_attributes);
+  /* The attributes live in the arena of the COMPOUND */
   return;
 }                               /* nfs4_op_getattr_Free */
@@ -626,10 +626,3 @@ void nfs4_op_lock_Free(LOCK4res * resp)
   if(resp->status == NFS4ERR_DENIED)
     Release_nfs4_denied(&resp->LOCK4res_u.denied);
 }                               /* nfs4_op_lock_Free */
-
-void nfs4_op_lock_CopyRes(LOCK4res * resp_dst, LOCK4res * resp_src)
-{
-  if(resp_src->status == NFS4ERR_DENIED)
-    Copy_nfs4_denied(&resp_dst->LOCK4res_u.denied,
-                     &resp_src->LOCK4res_u.denied);
-}
@@ -225,9 +225,3 @@ void nfs4_op_locku_Free(LOCKU4res * resp)
 {
   return;
 }                               /* nfs4_op_locku_Free */
-
-void nfs4_op_locku_CopyRes(LOCKU4res * resp_dst, LOCKU4res * resp_src)
-{
-  /* Nothing to deep copy */
-  return;
-}
@@ -215,11 +215,11 @@ int nfs4_op_lookup(struct nfs_argop4 *op, compound_data_t * data, struct nfs_res
           LogFullDebug(COMPONENT_NFS_V4,
                        "----> FSAL handle parent and children in nfs4_op_lookup");
           print_buff(COMPONENT_NFS_V4,
-                     (char *)&file_pentry->handle,
-                     sizeof(fsal_handle_t));
+                     (char *)file_pentry->fsdata.fh_desc.start,
+                     file_pentry->fsdata.fh_desc.len);
           print_buff(COMPONENT_NFS_V4,
-                     (char *)&dir_pentry->handle,
-                     sizeof(fsal_handle_t));
+                     (char *)dir_pentry->fsdata.fh_desc.start,
+                     dir_pentry->fsdata.fh_desc.len);
         }
       LogHandleNFS4("NFS4 LOOKUP CURRENT FH: ", &data->currentFH);
 
@@ -1088,19 +1088,6 @@ void nfs4_op_open_Free(OPEN4res * resp)
   resp->OPEN4res_u.resok4.attrset.bitmap4_len = 0;
 }                               /* nfs4_op_open_Free */
 
-void nfs4_op_open_CopyRes(OPEN4res * resp_dst, OPEN4res * resp_src)
-{
-  if(resp_src->OPEN4res_u.resok4.attrset.bitmap4_val != NULL)
-    {
-      if((resp_dst->OPEN4res_u.resok4.attrset.bitmap4_val =
-          gsh_calloc(resp_dst->OPEN4res_u.resok4.attrset.bitmap4_len,
-                     sizeof(uint32_t))) == NULL)
-        {
-          resp_dst->OPEN4res_u.resok4.attrset.bitmap4_len = 0;
-        }
-    }
-}
-
 static nfsstat4
 nfs4_chk_shrdny(struct nfs_argop4 *op, compound_data_t *data,
     cache_entry_t *pentry, fsal_accessflags_t rd_acc,
@@ -167,9 +167,3 @@ void nfs4_op_open_confirm_Free(OPEN_CONFIRM4res * resp)
   /* Nothing to be done */
   return;
 }                               /* nfs4_op_open_confirm_Free */
-
-void nfs4_op_open_confirm_CopyRes(OPEN_CONFIRM4res * resp_dst, OPEN_CONFIRM4res * resp_src)
-{
-  /* Nothing to be done */
-  return;
-}
@@ -204,12 +204,6 @@ void nfs4_op_open_downgrade_Free(OPEN_DOWNGRADE4res * resp)
   return;
 }                               /* nfs4_op_open_downgrade_Free */
 
-void nfs4_op_open_downgrade_CopyRes(OPEN_DOWNGRADE4res * resp_dst, OPEN_DOWNGRADE4res * resp_src)
-{
-  /* Nothing to be done */
-  return;
-}
-
 static nfsstat4 nfs4_do_open_downgrade(struct nfs_argop4  * op,
                                        compound_data_t    * data,
                                        cache_entry_t      * pentry_file,
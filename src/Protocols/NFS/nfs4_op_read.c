@@ -90,6 +90,7 @@ int nfs4_op_read(struct nfs_argop4 *op, compound_data_t * data, struct nfs_resop
   fsal_off_t               offset = 0;
   fsal_boolean_t           eof_met = FALSE;
   caddr_t                  bufferdata = NULL;
+  int                    * file_fd;
   cache_inode_status_t     cache_status = CACHE_INODE_SUCCESS;
   state_t                * pstate_found = NULL;
   state_t                * pstate_open = NULL;
@@ -319,6 +320,43 @@ int nfs4_op_read(struct nfs_argop4 *op, compound_data_t * data, struct nfs_resop
       return res_READ4.status;
     }
 
+  /* The data of one READ of the COMPOUND may go to the socket through
+   * the pipe of the worker, see nfs_read_splice.h */
+  if(data->pworker != NULL &&
+     (file_fd = nfs_read_splice_start(&data->pworker->read_splice,
+                                      offset, size)) != NULL)
+    {
+      if((cache_inode_rdwr(pentry,
+                          CACHE_INODE_READ_PIPE,
+                          offset,
+                          size,
+                          &read_size,
+                          file_fd,
+                          &eof_met,
+                          data->pcontext,
+                          CACHE_INODE_SAFE_WRITE_TO_FS,
+                          data->pexport->MaxReadahead,
+                          &cache_status) == CACHE_INODE_SUCCESS) &&
+         ((cache_inode_getattr(pentry, &attr, data->pcontext,
+                               &cache_status)) == CACHE_INODE_SUCCESS))
+        {
+          nfs_read_splice_pending(&data->pworker->read_splice, read_size,
+                                  &res_READ4.READ4res_u.resok4.data.data_val,
+                                  &res_READ4.READ4res_u.resok4.data.data_len);
+          goto done;
+        }
+      nfs_read_splice_pending(&data->pworker->read_splice, 0, NULL, NULL);
+      if(cache_status != CACHE_INODE_NOT_SUPPORTED)
+        {
+          res_READ4.status = nfs4_Errno(cache_status);
+          if (anonymous)
+            {
+              pthread_rwlock_unlock(&pentry->state_lock);
+            }
+          return res_READ4.status;
+        }
+    }
+
   /* Some work is to be done */
   if((bufferdata = gsh_malloc_aligned(4096, size)) == NULL)
     {
@@ -341,6 +379,7 @@ int nfs4_op_read(struct nfs_argop4 *op, compound_data_t * data, struct nfs_resop
                       &eof_met,
                       data->pcontext,
                       CACHE_INODE_SAFE_WRITE_TO_FS,
+                      data->pexport->MaxReadahead,
                       &cache_status) != CACHE_INODE_SUCCESS) ||
      ((cache_inode_getattr(pentry, &attr, data->pcontext,
                            &cache_status)) != CACHE_INODE_SUCCESS))
@@ -357,6 +396,7 @@ int nfs4_op_read(struct nfs_argop4 *op, compound_data_t * data, struct nfs_resop
   res_READ4.READ4res_u.resok4.data.data_len = read_size;
   res_READ4.READ4res_u.resok4.data.data_val = bufferdata;
 
+ done:
   LogFullDebug(COMPONENT_NFS_V4,
                "NFS4_OP_READ: offset = %"PRIu64" read length = %zu eof=%u",
                offset, read_size, eof_met);
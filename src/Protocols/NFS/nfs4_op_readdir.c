@@ -55,7 +55,6 @@ static bool_t nfs4_readdir_callback(void* opaque,
                                     fsal_handle_t *handle,
                                     fsal_attrib_list_t *attrs,
                                     uint64_t cookie);
-static void free_entries(entry4 *entries);
 
 static const bitmap4 RdAttrErrorBitmap = {1, (uint32_t *) "\0\0\0\b"};
 static const attrlist4 RdAttrErrorVals = {0, NULL};
@@ -203,8 +202,14 @@ nfs4_op_readdir(struct nfs_argop4 *op,
 
      /* Prepare to read the entries */
 
-     entries = gsh_calloc(estimated_num_entries,
-                          sizeof(entry4));
+     /* The entries, their names and attributes are allocated from the
+        arena of the COMPOUND and are released with the reply. */
+     entries = nfs_arena_calloc(data->arena, estimated_num_entries,
+                                sizeof(entry4));
+     if (entries == NULL) {
+          res_READDIR4.status = NFS4ERR_SERVERFAULT;
+          goto out;
+     }
      cb_data.entries = entries;
      cb_data.mem_left = maxcount - sizeof(READDIR4resok);
      cb_data.count = 0;
@@ -233,9 +238,7 @@ nfs4_op_readdir(struct nfs_argop4 *op,
           /* Put the entry's list in the READDIR reply if there were any. */
           res_READDIR4.READDIR4res_u.resok4.reply.entries = entries;
      } else {
-          gsh_free(entries);
-          res_READDIR4.READDIR4res_u.resok4.reply.entries
-               = entries = NULL;
+          res_READDIR4.READDIR4res_u.resok4.reply.entries = NULL;
      }
 
      res_READDIR4.READDIR4res_u.resok4.reply.eof = eod_met;
@@ -248,12 +251,6 @@ nfs4_op_readdir(struct nfs_argop4 *op,
      res_READDIR4.status = NFS4_OK;
 
 out:
-     if (res_READDIR4.status != NFS4_OK) {
-          if (entries) {
-               free_entries(entries);
-          }
-     }
-
   return res_READDIR4.status;
 }                               /* nfs4_op_readdir */
 
@@ -269,7 +266,8 @@ out:
  */
 void nfs4_op_readdir_Free(READDIR4res *resp)
 {
-     free_entries(resp->READDIR4res_u.resok4.reply.entries);
+     /* The entries live in the arena of the COMPOUND */
+     return;
 } /* nfs4_op_readdir_Free */
 
 /**
@@ -277,7 +275,7 @@ void nfs4_op_readdir_Free(READDIR4res *resp)
  *
  * This function is a callback passed to cache_inode_readdir.  It
  * fills in a pre-allocated array of entry4 structures and allocates
- * space for the name and attributes.  This space must be freed.
+ * space for the name and attributes from the arena of the COMPOUND.
  *
  * @param opaque [in] Pointer to a struct nfs4_readdir_cb_data that is
  *                    gives the location of the array and other
@@ -333,7 +331,11 @@ nfs4_readdir_callback(void* opaque,
      tracker->mem_left -= (namelen + 1);
      tracker->entries[tracker->count].name.utf8string_len = namelen;
      tracker->entries[tracker->count].name.utf8string_val
-          = gsh_malloc(namelen + 1);
+          = nfs_arena_alloc(tracker->data->arena, namelen + 1);
+     if (tracker->entries[tracker->count].name.utf8string_val == NULL) {
+          tracker->error = NFS4ERR_SERVERFAULT;
+          return FALSE;
+     }
      strcpy(tracker->entries[tracker->count].name.utf8string_val,
             name);
 
@@ -341,7 +343,6 @@ nfs4_readdir_callback(void* opaque,
          (tracker->req_attr.bitmap4_val[0] & FATTR4_FILEHANDLE)) {
           if (!nfs4_FSALToFhandle(&entryFH, handle, tracker->data)) {
                tracker->error = NFS4ERR_SERVERFAULT;
-               gsh_free(tracker->entries[tracker->count].name.utf8string_val);
                return FALSE;
           }
      }
@@ -365,11 +366,6 @@ nfs4_readdir_callback(void* opaque,
            sizeof(uint32_t)) +
           (tracker->entries[tracker->count]
            .attrs.attr_vals.attrlist4_len))) {
-          gsh_free(tracker->entries[tracker->count]
-                   .attrs.attrmask.bitmap4_val);
-          gsh_free(tracker->entries[tracker->count]
-                   .attrs.attr_vals.attrlist4_val);
-          gsh_free(tracker->entries[tracker->count].name.utf8string_val);
           if (tracker->count == 0) {
                tracker->error = NFS4ERR_TOOSMALL;
           }
@@ -389,26 +385,3 @@ nfs4_readdir_callback(void* opaque,
      ++(tracker->count);
      return TRUE;
 }
-
-static void
-free_entries(entry4 *entries)
-{
-     entry4 *entry = NULL;
-
-     for (entry = entries;
-          entry != NULL;
-          entry = entry->nextentry) {
-          if (entry->attrs.attrmask.bitmap4_val !=
-              RdAttrErrorBitmap.bitmap4_val) {
-               gsh_free(entry->attrs.attrmask.bitmap4_val);
-          }
-          if (entry->attrs.attr_vals.attrlist4_val !=
-              RdAttrErrorVals.attrlist4_val) {
-               gsh_free(entry->attrs.attr_vals.attrlist4_val);
-          }
-          gsh_free(entry->name.utf8string_val);
-     }
-     gsh_free(entries);
-
-     return;
-} /* free_entries */
@@ -327,6 +327,7 @@ int nfs4_op_write(struct nfs_argop4 *op, compound_data_t * data, struct nfs_reso
                       &eof_met,
                       data->pcontext,
                       stability,
+                      0,
                       &cache_status) != CACHE_INODE_SUCCESS)
     {
       LogDebug(COMPONENT_NFS_V4,
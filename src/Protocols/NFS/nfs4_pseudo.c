@@ -1204,7 +1204,8 @@ int nfs4_PseudoToFattr(pseudofs_entry_t * psfsp,
                "Fattr (pseudo) At the end LastOffset = %u, i=%d, j=%d",
                LastOffset, i, j);
 
-  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer);
+  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer,
+                         data->arena);
 }                               /* nfs4_PseudoToFattr */
 
 /**
@@ -1568,6 +1569,7 @@ int nfs4_op_lookup_pseudo(struct nfs_argop4 *op,
 
       /* Add the entry to the cache as a root (BUGAZOMEU: make it a junction entry when junction is available) */
       fsdata.fh_desc.start = (caddr_t)&fsal_handle;
+      fsdata.hash = 0;
       fsdata.fh_desc.len = 0;
       FSAL_ExpandHandle(data->pcontext->export_context,
                         FSAL_DIGEST_SIZEOF,
@@ -1840,6 +1842,7 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
 
       /* Add the entry to the cache as a root (BUGAZOMEU: make it a junction entry when junction is available) */
       fsdata.fh_desc.start = (caddr_t) &fsal_handle;
+      fsdata.hash = 0;
       fsdata.fh_desc.len = 0;
       FSAL_ExpandHandle(data->pcontext->export_context,
                         FSAL_DIGEST_SIZEOF,
@@ -1879,9 +1882,10 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
       return nfs4_op_readdir(op, data, resp);
     }
 
-  /* Allocation of the entries array */
+  /* Allocation of the entries array, released with the reply */
   if((entry_nfs_array =
-      gsh_calloc(estimated_num_entries, sizeof(entry4))) == NULL)
+      nfs_arena_calloc(data->arena, estimated_num_entries,
+                       sizeof(entry4))) == NULL)
     {
       LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
       res_READDIR4.status = NFS4ERR_SERVERFAULT;
@@ -1900,7 +1904,6 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
           if(memcmp(cookie_verifier, arg_READDIR4.cookieverf, NFS4_VERIFIER_SIZE) != 0)
             {
               res_READDIR4.status = NFS4ERR_BAD_COOKIE;
-              gsh_free(entry_nfs_array);
               return res_READDIR4.status;
             }
         }
@@ -1932,7 +1935,8 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
 
       namelen = strlen(iter->name);
       entry_nfs_array[i].name.utf8string_len = namelen;
-      if ((entry_nfs_array[i].name.utf8string_val = gsh_malloc(namelen + 1)) == NULL) 
+      if ((entry_nfs_array[i].name.utf8string_val =
+           nfs_arena_alloc(data->arena, namelen + 1)) == NULL)
         {
             LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
             res_READDIR4.status = NFS4ERR_SERVERFAULT;
@@ -1960,7 +1964,6 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
           if(!nfs4_PseudoToFhandle(&entryFH, iter))
             {
               res_READDIR4.status = NFS4ERR_SERVERFAULT;
-              gsh_free(entry_nfs_array);
               return res_READDIR4.status;
             }
 
@@ -2029,6 +2032,7 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
             }
           /* Add the entry to the cache as a root. There has to be a better way. */
           fsdata.fh_desc.start = (caddr_t) &fsal_handle;
+          fsdata.hash = 0;
           fsdata.fh_desc.len = 0;
           FSAL_ExpandHandle(data->pcontext->export_context,
                             FSAL_DIGEST_SIZEOF,
@@ -2077,19 +2081,6 @@ int nfs4_op_readdir_pseudo(struct nfs_argop4 *op,
         break;
     }
 
-  /* Resize entry_nfs_array */
-  /* @todo : Is this reallocation actually needed ? */
-#ifdef BUGAZOMEU
-  if(i < estimated_num_entries)
-    if((entry_nfs_array = gsh_realloc(entry_nfs_array, i *
-                                      sizeof(entry4))) == NULL)
-      {
-        LogError(COMPONENT_NFS_V4_PSEUDO, ERR_SYS, ERR_MALLOC, errno);
-        res_READDIR4.status = NFS4ERR_SERVERFAULT;
-        gsh_free(entry_nfs_array);
-        return res_READDIR4.status;
-      }
-#endif
   /* Build the reply */
   memcpy(res_READDIR4.READDIR4res_u.resok4.cookieverf, cookie_verifier,
          NFS4_VERIFIER_SIZE);
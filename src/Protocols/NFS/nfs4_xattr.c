@@ -945,7 +945,8 @@ int nfs4_XattrToFattr(fattr4 * Fattr,
                "Fattr (pseudo) At the end LastOffset = %u, i=%d, j=%d",
                LastOffset, i, j);
 
-  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer);
+  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer,
+                         data->arena);
 }                               /* nfs4_XattrToFattr */
 
 /** 
@@ -1287,7 +1288,6 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
           if(memcmp(cookie_verifier, arg_READDIR4.cookieverf, NFS4_VERIFIER_SIZE) != 0)
             {
               res_READDIR4.status = NFS4ERR_BAD_COOKIE;
-              gsh_free(entry_nfs_array);
               return res_READDIR4.status;
             }
         }
@@ -1331,9 +1331,10 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
     }
   else
     {
-      /* Allocation of reply structures */
+      /* Allocation of reply structures, released with the reply */
       if((entry_name_array =
-          gsh_calloc(estimated_num_entries, (FSAL_MAX_NAME_LEN + 1))) == NULL)
+          nfs_arena_calloc(data->arena, estimated_num_entries,
+                           FSAL_MAX_NAME_LEN + 1)) == NULL)
         {
           LogError(COMPONENT_NFS_V4_XATTR, ERR_SYS, ERR_MALLOC, errno);
           res_READDIR4.status = NFS4ERR_SERVERFAULT;
@@ -1341,7 +1342,8 @@ int nfs4_op_readdir_xattr(struct nfs_argop4 *op,
         }
 
       if((entry_nfs_array =
-          gsh_calloc(estimated_num_entries, sizeof(entry4))) == NULL)
+          nfs_arena_calloc(data->arena, estimated_num_entries,
+                           sizeof(entry4))) == NULL)
         {
           LogError(COMPONENT_NFS_V4_XATTR, ERR_SYS, ERR_MALLOC, errno);
           res_READDIR4.status = NFS4ERR_SERVERFAULT;
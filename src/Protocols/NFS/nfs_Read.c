@@ -136,6 +136,7 @@ int nfs_Read(nfs_arg_t *parg,
   void *data = NULL;
   cache_inode_file_type_t filetype;
   fsal_boolean_t eof_met=FALSE;
+  int *file_fd;
   int rc = NFS_REQ_OK;
 
   if(isDebug(COMPONENT_NFSPROTO))
@@ -356,8 +357,41 @@ int nfs_Read(nfs_arg_t *parg,
       rc = NFS_REQ_OK;
       goto out;
     }
-  else
+  else if((file_fd = nfs_read_splice_start(&pworker->read_splice,
+                                           offset, size)) != NULL)
     {
+      /* The data go from the file to the socket through the pipe of
+       * the worker when the reply is sent, see nfs_read_splice.h */
+      if((cache_inode_rdwr(pentry,
+                           CACHE_INODE_READ_PIPE,
+                           offset,
+                           size,
+                           &read_size,
+                           file_fd,
+                           &eof_met,
+                           pcontext,
+                           CACHE_INODE_SAFE_WRITE_TO_FS,
+                           pexport->MaxReadahead,
+                           &cache_status) == CACHE_INODE_SUCCESS) &&
+         (cache_inode_getattr(pentry, &attr, pcontext,
+                              &cache_status)) == CACHE_INODE_SUCCESS)
+        {
+          nfs_read_ok(pexport, preq, pres, NULL, read_size, &attr,
+                      ((offset + read_size) >= attr.filesize));
+          nfs_read_splice_pending(&pworker->read_splice, read_size,
+                                  &pres->res_read3.READ3res_u.resok.data.data_val,
+                                  &pres->res_read3.READ3res_u.resok.data.data_len);
+          rc = NFS_REQ_OK;
+          goto out;
+        }
+      nfs_read_splice_pending(&pworker->read_splice, 0, NULL, NULL);
+      if(cache_status != CACHE_INODE_NOT_SUPPORTED)
+        goto failed;
+    }
+
+  if(size != 0)
+    {
+      /* No splicing, or the FSAL cannot splice: copy the data */
       data = gsh_malloc(size);
       if(data == NULL)
         {
@@ -374,6 +408,7 @@ int nfs_Read(nfs_arg_t *parg,
                            &eof_met,
                            pcontext,
                            CACHE_INODE_SAFE_WRITE_TO_FS,
+                           pexport->MaxReadahead,
                            &cache_status) == CACHE_INODE_SUCCESS) &&
          (cache_inode_getattr(pentry, &attr, pcontext,
                               &cache_status)) == CACHE_INODE_SUCCESS)
@@ -387,6 +422,7 @@ int nfs_Read(nfs_arg_t *parg,
       gsh_free(data);
     }
 
+ failed:
   /* If we are here, there was an error */
   if(nfs_RetryableError(cache_status))
     {
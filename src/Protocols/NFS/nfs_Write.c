@@ -448,6 +448,7 @@ int nfs_Write(nfs_arg_t *parg,
                            &eof_met,
                            pcontext,
                            stability,
+                           0,
                            &cache_status) == CACHE_INODE_SUCCESS) &&
          (cache_inode_getattr(pentry, &attr, pcontext,
                               &cache_status) == CACHE_INODE_SUCCESS)) {
@@ -246,6 +246,9 @@ cache_entry_t *nfs_FhandleToCache(u_long rq_vers,
       break;
     }
 
+  /* Hash the handle now, for every lookup of it in the cache */
+  (void) cache_inode_fsal_data_hash(&fsal_data);
+
   print_buff(COMPONENT_FILEHANDLE,
              fsal_data.fh_desc.start,
              fsal_data.fh_desc.len);
@@ -873,12 +876,23 @@ int nfs4_supported_attrs_to_fattr(char *attrvalsBuffer)
   return LastOffset;
 }
 
+/*
+ * The bitmap and values are allocated from arena when one is given
+ * (the result then goes away with the COMPOUND), from the heap
+ * otherwise, to be released with nfs4_Fattr_Free.
+ */
 int nfs4_Fattr_Fill(fattr4 *Fattr, int cnt, uint32_t *attrvalslist,
-                    int LastOffset, char *attrvalsBuffer)
+                    int LastOffset, char *attrvalsBuffer,
+                    nfs_arena_t *arena)
 {
   /* Set the bitmap for result */
   memset(Fattr, 0, sizeof(*Fattr));
-  if((Fattr->attrmask.bitmap4_val = gsh_calloc(3, sizeof(uint32_t))) == NULL)
+  if(arena != NULL)
+    Fattr->attrmask.bitmap4_val = nfs_arena_calloc(arena, 3,
+                                                   sizeof(uint32_t));
+  else
+    Fattr->attrmask.bitmap4_val = gsh_calloc(3, sizeof(uint32_t));
+  if(Fattr->attrmask.bitmap4_val == NULL)
     return -1;
   Fattr->attrmask.bitmap4_len = 3;
   nfs4_list_to_bitmap4(&(Fattr->attrmask), cnt, attrvalslist);
@@ -888,10 +902,14 @@ int nfs4_Fattr_Fill(fattr4 *Fattr, int cnt, uint32_t *attrvalslist,
   Fattr->attr_vals.attrlist4_len = LastOffset;
   if(LastOffset != 0)           /* No need to allocate an empty buffer */
     {
-      Fattr->attr_vals.attrlist4_val = gsh_malloc(LastOffset);
+      if(arena != NULL)
+        Fattr->attr_vals.attrlist4_val = nfs_arena_alloc(arena, LastOffset);
+      else
+        Fattr->attr_vals.attrlist4_val = gsh_malloc(LastOffset);
       if(Fattr->attr_vals.attrlist4_val == NULL)
         {
-          gsh_free(Fattr->attrmask.bitmap4_val);
+          if(arena == NULL)
+            gsh_free(Fattr->attrmask.bitmap4_val);
           return -1;
         }
       memcpy(Fattr->attr_vals.attrlist4_val, attrvalsBuffer,
@@ -908,9 +926,10 @@ int nfs4_Fattr_Fill(fattr4 *Fattr, int cnt, uint32_t *attrvalslist,
  * @param pexport [IN]  the related export entry.
  * @param pattr   [IN]  pointer to FSAL attributes.
  * @param Fattr   [OUT] NFSv4 Fattr buffer
- *		  Memory for bitmap_val and attr_val is dynamically allocated,
+ *		  Memory for bitmap_val and attr_val is allocated from
+ *		  the arena of data if any, otherwise dynamically and
  *		  caller is responsible for freeing it.
- * @param data    [IN]  NFSv4 compoud request's data.
+ * @param data    [IN]  NFSv4 compoud request's data, may be NULL.
  * @param objFH   [IN]  The NFSv4 filehandle of the object whose
  *                      attributes are requested
  * @param Bitmap  [IN]  Bitmap of attributes being requested
@@ -1764,7 +1783,8 @@ int nfs4_FSALattr_To_Fattr(exportlist_t *pexport,
 
     }                           /* for i */
 
-  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer);
+  return nfs4_Fattr_Fill(Fattr, j, attrvalslist, LastOffset, attrvalsBuffer,
+                         data != NULL ? data->arena : NULL);
 }                               /* nfs4_FSALattr_To_Fattr */
 
 /**
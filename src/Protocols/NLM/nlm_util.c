@@ -288,6 +288,7 @@ int nlm_process_parameters(struct svc_req        * preq,
       /* handle is not valid */
       return NLM4_STALE_FH;
     }
+  (void) cache_inode_fsal_data_hash(&fsal_data);
 
   /* Now get the cached inode attributes */
   *ppentry = cache_inode_get(&fsal_data,
@@ -438,6 +439,7 @@ int nlm_process_share_parms(struct svc_req        * preq,
       /* handle is not valid */
       return NLM4_STALE_FH;
     }
+  (void) cache_inode_fsal_data_hash(&fsal_data);
 
   /* Now get the cached inode attributes */
   *ppentry = cache_inode_get(&fsal_data,
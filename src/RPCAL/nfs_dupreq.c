@@ -68,18 +68,6 @@
 #include "nfs_file_handle.h"
 #include "nfs_dupreq.h"
 
-extern nfs_function_desc_t nfs2_func_desc[];
-extern nfs_function_desc_t nfs3_func_desc[];
-extern nfs_function_desc_t nfs4_func_desc[];
-extern nfs_function_desc_t mnt1_func_desc[];
-extern nfs_function_desc_t mnt3_func_desc[];
-#ifdef _USE_NLM
-extern nfs_function_desc_t nlm4_func_desc[];
-#endif                          /* _USE_NLM */
-#ifdef _USE_RQUOTA
-extern nfs_function_desc_t rquota1_func_desc[];
-extern nfs_function_desc_t rquota2_func_desc[];
-#endif                          /* _USE_QUOTA */
 /* Structure used for duplicated request cache */
 hash_table_t *ht_dupreq_udp;
 hash_table_t *ht_dupreq_tcp;
@@ -131,10 +119,9 @@ int print_entry_dupreq(LRU_data_t data, char *str)
 }
 
 static int _remove_dupreq(hash_table_t *ht_dupreq, hash_buffer_t *buffkey,
-                          dupreq_entry_t *pdupreq, int nfs_req_status)
+                          dupreq_entry_t *pdupreq)
 {
   int rc;
-  nfs_function_desc_t funcdesc = nfs2_func_desc[0];
   hash_buffer_t usedbuffkey;
 
   rc = HashTable_Del(ht_dupreq, buffkey, &usedbuffkey, NULL);
@@ -145,89 +132,9 @@ static int _remove_dupreq(hash_table_t *ht_dupreq, hash_buffer_t *buffkey,
   else if(rc == HASHTABLE_ERROR_NO_SUCH_KEY)
     return 0;                   /* don't free the dupreq twice */
 
-  /* Locate the function descriptor associated with this cached request */
-  if(pdupreq->rq_prog == nfs_param.core_param.program[P_NFS])
-    {
-      switch (pdupreq->rq_vers)
-        {
-        case NFS_V2:
-          funcdesc = nfs2_func_desc[pdupreq->rq_proc];
-          break;
-
-        case NFS_V3:
-          funcdesc = nfs3_func_desc[pdupreq->rq_proc];
-          break;
-
-        case NFS_V4:
-          funcdesc = nfs4_func_desc[pdupreq->rq_proc];
-          break;
-
-        default:
-          /* We should never go there (this situation is filtered in nfs_rpc_getreq) */
-          LogMajor(COMPONENT_DUPREQ,
-                   "NFS Protocol version %d unknown in dupreq_gc",
-                   (int)pdupreq->rq_vers);
-        }
-    }
-  else if(pdupreq->rq_prog == nfs_param.core_param.program[P_MNT])
-    {
-      switch (pdupreq->rq_vers)
-        {
-        case MOUNT_V1:
-          funcdesc = mnt1_func_desc[pdupreq->rq_proc];
-          break;
-
-        case MOUNT_V3:
-          funcdesc = mnt3_func_desc[pdupreq->rq_proc];
-          break;
-
-        default:
-          /* We should never go there (this situation is filtered in nfs_rpc_getreq) */
-          LogMajor(COMPONENT_DUPREQ,
-                   "MOUNT Protocol version %d unknown in dupreq_gc",
-                   (int)pdupreq->rq_vers);
-          break;
-        }                       /* switch( pdupreq->vers ) */
-    }
-#ifdef _USE_NLM
-  else if(pdupreq->rq_prog == nfs_param.core_param.program[P_NLM])
-    {
-
-      switch (pdupreq->rq_vers)
-        {
-        case NLM4_VERS:
-          funcdesc = nlm4_func_desc[pdupreq->rq_proc];
-          break;
-        }                       /* switch( pdupreq->vers ) */
-    }
-#endif                          /* _USE_NLM */
-#ifdef _USE_RQUOTA
-  else if(pdupreq->rq_prog == nfs_param.core_param.program[P_RQUOTA])
-    {
-
-      switch (pdupreq->rq_vers)
-        {
-        case RQUOTAVERS:
-          funcdesc = rquota1_func_desc[pdupreq->rq_proc];
-          break;
-
-        case EXT_RQUOTAVERS:
-          funcdesc = rquota2_func_desc[pdupreq->rq_proc];
-          break;
-        }                       /* switch( pdupreq->vers ) */
-    }
-#endif
-  else
-    {
-      /* We should never go there (this situation is filtered in nfs_rpc_getreq) */
-      LogMajor(COMPONENT_DUPREQ,
-               "protocol %d is not managed",
-               (int)pdupreq->rq_prog);
-    }
-
-  /* Call the free function */
-  if (nfs_req_status == NFS_REQ_OK)
-    funcdesc.free_function(&(pdupreq->res_nfs));
+  /* Release the cached reply, a retransmission in progress may still
+   * hold it */
+  nfs_xdr_reply_unref(pdupreq->reply);
 
   /* Send the entry back to the pool */
   pool_free(dupreq_pool, pdupreq);
@@ -276,7 +183,7 @@ int nfs_dupreq_delete(struct svc_req *req)
 
   LogDupReq("REMOVING", &pdupreq->addr, pdupreq->xid, pdupreq->rq_prog);
 
-  status = _remove_dupreq( ht_dupreq, &buffkey, pdupreq, !NFS_REQ_OK);
+  status = _remove_dupreq(ht_dupreq, &buffkey, pdupreq);
   return status;
 }
 
@@ -317,7 +224,7 @@ int clean_entry_dupreq(LRU_entry_t *pentry, void *addparam)
 
   LogDupReq("Garbage collection on", &pdupreq->addr, pdupreq->xid, pdupreq->rq_prog);
 
-  return _remove_dupreq(ht_dupreq, &buffkey, pdupreq, NFS_REQ_OK);
+  return _remove_dupreq(ht_dupreq, &buffkey, pdupreq);
 }                               /* clean_entry_dupreq */
 
 /**
@@ -488,16 +395,18 @@ int nfs_Init_dupreq(nfs_rpc_dupreq_parameter_t param)
  *
  * Adds an entry in the duplicate requests cache.
  *
- * @param xid [IN] the transfer id to be used as key
- * @param pnfsreq [IN] the request pointer to cache
+ * @param req [IN] the request to be cached
+ * @param preply [OUT] the reply previously sent, if the request is
+ *                     already known.  The caller gets a reference.
  *
  * @return DUPREQ_SUCCESS if successfull\n.
+ * @return DUPREQ_ALREADY_EXISTS if the reply is to be sent again.
  * @return DUPREQ_INSERT_MALLOC_ERROR if an error occured during the insertion process.
  *
  */
 
 int nfs_dupreq_add_not_finished(struct svc_req *req,
-                                nfs_res_t *res_nfs)
+                                nfs_xdr_reply_t **preply)
 {
   hash_buffer_t buffkey;
   hash_buffer_t buffval;
@@ -553,6 +462,7 @@ int nfs_dupreq_add_not_finished(struct svc_req *req,
   pdupreq->rq_proc = req->rq_proc;
   pdupreq->timestamp = time(NULL);
   pdupreq->processing = 1;
+  pdupreq->reply = NULL;
   pdupreq->ipproto = get_ipproto_by_xprt(req->rq_xprt) ;
   buffdata.pdata = (caddr_t) pdupreq;
   buffdata.len = sizeof(dupreq_entry_t);
@@ -573,7 +483,8 @@ int nfs_dupreq_add_not_finished(struct svc_req *req,
             }
           else
             {
-              *res_nfs = ((dupreq_entry_t *) buffval.pdata)->res_nfs;
+              *preply = ((dupreq_entry_t *) buffval.pdata)->reply;
+              nfs_xdr_reply_ref(*preply);
               status = DUPREQ_ALREADY_EXISTS;
             }
           V(((dupreq_entry_t *)buffval.pdata)->dupreq_mutex);
@@ -601,15 +512,16 @@ int nfs_dupreq_add_not_finished(struct svc_req *req,
  * to the buffval. Used after the duplicate request has already been added to
  * the dupreq cache but has not been fully processed yet.
  *
- * @param xid [IN] the transfer id to be used as key
- * @param pnfsreq [IN] the request pointer to cache
+ * @param req [IN] the request being cached
+ * @param reply [IN] the encoded reply, the cache takes its own reference
+ * @param lru_dupreq [IN] the LRU of the worker
  *
  * @return DUPREQ_SUCCESS if successfull\n.
  * @return DUPREQ_INSERT_MALLOC_ERROR if an error occured during the insertion process.
  *
  */
 
-int nfs_dupreq_finish(struct svc_req *req, nfs_res_t *p_res_nfs,
+int nfs_dupreq_finish(struct svc_req *req, nfs_xdr_reply_t *reply,
                       LRU_list_t *lru_dupreq)
 {
   hash_buffer_t buffkey;
@@ -644,7 +556,8 @@ int nfs_dupreq_finish(struct svc_req *req, nfs_res_t *p_res_nfs,
 
   P(pdupreq->dupreq_mutex);
 
-  pdupreq->res_nfs = *p_res_nfs;
+  nfs_xdr_reply_ref(reply);
+  pdupreq->reply = reply;
   pdupreq->timestamp = time(NULL);
   pdupreq->processing = 0;
 
@@ -669,28 +582,26 @@ int nfs_dupreq_finish(struct svc_req *req, nfs_res_t *p_res_nfs,
  * @param xprt [IN] xprt the related xprt (but we could use req->rq_xprt) XXX
  * @param pstatus [OUT] the pointer to the status for the operation
  *
- * @return the result previously set if *pstatus == DUPREQ_SUCCESS
+ * @return the reply previously sent if *pstatus == DUPREQ_SUCCESS, the
+ *         caller gets a reference (NULL if still being processed).
  *
  */
-nfs_res_t nfs_dupreq_get(struct svc_req *req, int *pstatus)
+nfs_xdr_reply_t *nfs_dupreq_get(struct svc_req *req, int *pstatus)
 {
   hash_buffer_t buffkey;
   hash_buffer_t buffval;
-  nfs_res_t res_nfs;
+  nfs_xdr_reply_t *reply = NULL;
   dupreq_key_t dupkey;
   hash_table_t * ht_dupreq = NULL ;
 
   /* Get correct HT depending on proto used */
   ht_dupreq = get_ht_by_xprt(req->rq_xprt) ;
  
-
-  memset(&res_nfs, 0, sizeof(res_nfs));
-
   /* Get the socket address for the key */
   if(copy_xprt_addr(&dupkey.addr, req->rq_xprt) == 0)
     {
       *pstatus = DUPREQ_NOT_FOUND;
-      return res_nfs;
+      return NULL;
     }
 
   dupkey.xid = req->rq_xid;
@@ -707,7 +618,11 @@ nfs_res_t nfs_dupreq_get(struct svc_req *req, int *pstatus)
       pdupreq->timestamp = time(NULL);
 
       *pstatus = DUPREQ_SUCCESS;
-      res_nfs = pdupreq->res_nfs;
+      P(pdupreq->dupreq_mutex);
+      reply = pdupreq->reply;
+      if(reply != NULL)
+        nfs_xdr_reply_ref(reply);
+      V(pdupreq->dupreq_mutex);
       LogDupReq(" dupreq_get: Hit in the dupreq cache for", &pdupreq->addr,
 		pdupreq->xid, pdupreq->rq_prog);
     }
@@ -716,7 +631,7 @@ nfs_res_t nfs_dupreq_get(struct svc_req *req, int *pstatus)
       LogDupReq("Failed to get dupreq entry", &dupkey.addr, dupkey.xid, req->rq_prog);
       *pstatus = DUPREQ_NOT_FOUND;
     }
-  return res_nfs;
+  return reply;
 }                               /* nfs_dupreq_get */
 
 /**
@@ -0,0 +1,616 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_read_splice.c
+ * @brief  READ replies sent from a pipe
+ *
+ * The reply is written as one record: its marker, the reply encoded
+ * with an empty opaque, whose length is then patched, the data from
+ * the pipe and the padding of the opaque.  This only works for a reply
+ * whose data are the last thing encoded, which is the case of READ3res
+ * and of a COMPOUND4res ending with a READ.
+ *
+ * The pipe holds references to the pages of the page cache, not a copy
+ * of the data, so it is only filled from the file when the reply is
+ * about to be sent.  Should the file have shrunk since the READ, the
+ * data are read into a buffer instead and the reply shortened, before
+ * anything is written; should that read fail, the READ fails with an
+ * I/O error.
+ *
+ * Taking the data from the file happens outside TakeTokenFSCall and
+ * after the FSAL returned the attributes of the file.  A write landing
+ * in between shows in the data but not in the post-op attributes of a
+ * v3 reply, which may thus be older than the data they come with.
+ *
+ * The worker holds the duplex lock of the transport while writing, as
+ * it does around svc_sendreply2, so the record is not interleaved with
+ * another.  Should the write fail after the first byte went out, the
+ * stream is out of step with the client: the connection is shut down,
+ * and the client retransmits on a new one.  This is also what happens
+ * if the file is truncated while its pages go from the pipe to the
+ * socket.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "nfs_core.h"
+#include "nfs23.h"
+#include "nfs4.h"
+#include "nfs_proto_functions.h"
+#include "nfs_read_splice.h"
+
+/* Small replies are encoded on the stack */
+#define READ_SPLICE_HDR_SIZE 512
+
+/* How long a full socket may hold up a reply, in milliseconds */
+#define READ_SPLICE_SEND_TIMEOUT 120000
+
+static uint64_t splice_sent;
+static uint64_t splice_bytes;
+static uint64_t splice_fetched;
+
+/**
+ * @brief Initialize the splice state of a worker
+ *
+ * @param[out] rs The state
+ */
+
+void
+nfs_read_splice_init(nfs_read_splice_t *rs)
+{
+  memset(rs, 0, sizeof(*rs));
+  rs->pipefd[0] = -1;
+  rs->pipefd[1] = -1;
+  rs->file_fd = -1;
+}
+
+static void
+read_splice_close(nfs_read_splice_t *rs)
+{
+  if(rs->pipefd[0] >= 0)
+    {
+      close(rs->pipefd[0]);
+      close(rs->pipefd[1]);
+    }
+  rs->pipefd[0] = -1;
+  rs->pipefd[1] = -1;
+  rs->pipe_size = 0;
+}
+
+/**
+ * @brief Decide whether a request may send its READ data from the pipe
+ *
+ * Called before the request is processed.
+ *
+ * @param[in,out] rs     The state of the worker
+ * @param[in]     xprt   The transport of the request
+ * @param[in]     req    The request
+ * @param[in]     cached TRUE if the reply goes to the duplicate
+ *                       request cache
+ */
+
+void
+nfs_read_splice_allow(nfs_read_splice_t *rs, SVCXPRT *xprt,
+                      struct svc_req *req, bool_t cached)
+{
+  gsh_xprt_private_t *xu = (gsh_xprt_private_t *) xprt->xp_u1;
+
+  /* In case the previous request did not get that far */
+  nfs_read_splice_done(rs);
+
+  if(!nfs_param.core_param.read_splice || cached || xu == NULL ||
+     !(xu->flags & XPRT_PRIVATE_FLAG_STREAM))
+    return;
+
+  /* RPCSEC_GSS integrity and privacy need the bytes */
+  if(req->rq_cred.oa_flavor != AUTH_NONE &&
+     req->rq_cred.oa_flavor != AUTH_UNIX)
+    return;
+
+  if(req->rq_prog != nfs_param.core_param.program[P_NFS])
+    return;
+
+  rs->allowed = (req->rq_vers == NFS_V3 && req->rq_proc == NFSPROC3_READ) ||
+                (req->rq_vers == NFS_V4 && req->rq_proc == NFSPROC4_COMPOUND);
+  rs->vers = req->rq_vers;
+}
+
+/**
+ * @brief Get ready to splice the data of a READ
+ *
+ * @param[in,out] rs     The state of the worker
+ * @param[in]     offset Where the READ starts
+ * @param[in]     size   Bytes to read
+ *
+ * @return Where the FSAL puts a descriptor of the file, or NULL if the
+ *         READ is to be done into a buffer.  Only one READ of a request
+ *         gets the pipe.
+ */
+
+int *
+nfs_read_splice_start(nfs_read_splice_t *rs, uint64_t offset, size_t size)
+{
+  size_t need;
+  int rc;
+
+  if(!rs->allowed || rs->armed)
+    return NULL;
+
+  if(rs->pipefd[0] < 0)
+    {
+      if(pipe2(rs->pipefd, O_NONBLOCK | O_CLOEXEC) != 0)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "Unable to create the READ pipe: %s", strerror(errno));
+          rs->pipefd[0] = -1;
+          rs->pipefd[1] = -1;
+          return NULL;
+        }
+      rc = fcntl(rs->pipefd[0], F_GETPIPE_SZ);
+      rs->pipe_size = rc > 0 ? rc : 0;
+    }
+
+  /* An unaligned READ spans one more page than its size */
+  need = size + getpagesize();
+  if(rs->pipe_size < need)
+    {
+      rc = fcntl(rs->pipefd[0], F_SETPIPE_SZ, need);
+      if(rc < 0)
+        {
+          LogFullDebug(COMPONENT_DISPATCH,
+                       "Unable to grow the READ pipe to %zu: %s",
+                       need, strerror(errno));
+          return NULL;
+        }
+      rs->pipe_size = rc;
+    }
+
+  rs->armed = TRUE;
+  rs->offset = offset;
+  return &rs->file_fd;
+}
+
+/**
+ * @brief Record that the data of a READ reply are to be spliced
+ *
+ * @param[in,out] rs       The state of the worker
+ * @param[in]     len      Bytes the READ found, 0 if it failed or
+ *                         found nothing
+ * @param[out]    data_val The opaque of the reply, set to NULL until
+ *                         the data are fetched.  May be NULL with a
+ *                         zero len.
+ * @param[out]    data_len Its length, set to len
+ */
+
+void
+nfs_read_splice_pending(nfs_read_splice_t *rs, size_t len,
+                        char **data_val, u_int *data_len)
+{
+  if(len == 0)
+    {
+      if(rs->file_fd >= 0)
+        close(rs->file_fd);
+      rs->file_fd = -1;
+      rs->armed = FALSE;
+      if(data_val != NULL)
+        {
+          *data_val = NULL;
+          *data_len = 0;
+        }
+      return;
+    }
+
+  *data_val = NULL;
+  *data_len = len;
+
+  rs->pending = TRUE;
+  rs->len = len;
+  rs->data_val = data_val;
+  rs->data_len = data_len;
+}
+
+/* The file ended before the data the READ found: the reply carries
+   what is left and says so */
+static void
+read_splice_shorten(nfs_read_splice_t *rs, size_t len)
+{
+  READ3resok *resok3;
+  READ4resok *resok4;
+
+  *rs->data_len = len;
+  if(rs->vers == NFS_V3)
+    {
+      resok3 = (READ3resok *) ((char *) rs->data_val -
+                               offsetof(READ3resok, data.data_val));
+      resok3->count = len;
+      resok3->eof = TRUE;
+    }
+  else
+    {
+      resok4 = (READ4resok *) ((char *) rs->data_val -
+                               offsetof(READ4resok, data.data_val));
+      resok4->eof = TRUE;
+    }
+}
+
+/**
+ * @brief Read the data of a READ reply from the file into a buffer
+ *
+ * After this, the reply is an ordinary one.  Nothing is done if no
+ * data are pending.
+ *
+ * @param[in,out] rs The state of the worker
+ *
+ * @return TRUE on success.  On failure the opaque is left empty.
+ */
+
+bool_t
+nfs_read_splice_fetch(nfs_read_splice_t *rs)
+{
+  char *buf;
+  size_t done = 0;
+  ssize_t n;
+
+  if(!rs->pending)
+    return TRUE;
+
+  rs->pending = FALSE;
+
+  buf = gsh_malloc(rs->len);
+  if(buf == NULL)
+    goto fail;
+
+  while(done < rs->len)
+    {
+      n = pread(rs->file_fd, buf + done, rs->len - done, rs->offset + done);
+      if(n < 0 && errno == EINTR)
+        continue;
+      if(n < 0)
+        {
+          LogCrit(COMPONENT_DISPATCH,
+                  "Unable to read %zu bytes of a READ reply: %s",
+                  rs->len - done, strerror(errno));
+          gsh_free(buf);
+          goto fail;
+        }
+      if(n == 0)
+        break;
+      done += n;
+    }
+
+  if(done < rs->len)
+    read_splice_shorten(rs, done);
+
+  *rs->data_val = buf;
+  rs->armed = FALSE;
+  atomic_inc_uint64_t(&splice_fetched);
+  return TRUE;
+
+fail:
+  *rs->data_val = NULL;
+  *rs->data_len = 0;
+  return FALSE;
+}
+
+/**
+ * @brief Tell whether the pending data end the reply
+ *
+ * @param[in] rs  The state of the worker
+ * @param[in] req The request
+ * @param[in] res Its result, a nfs_res_t
+ *
+ * @return TRUE if the reply can be sent with nfs_read_splice_send.
+ */
+
+bool_t
+nfs_read_splice_is_tail(nfs_read_splice_t *rs, struct svc_req *req,
+                        void *res)
+{
+  nfs_res_t *pres = res;
+  COMPOUND4res *cres;
+  nfs_resop4 *last;
+
+  if(!rs->pending)
+    return FALSE;
+
+  if(req->rq_vers == NFS_V3)
+    return pres->res_read3.status == NFS3_OK &&
+      rs->data_val == &pres->res_read3.READ3res_u.resok.data.data_val;
+
+  cres = &pres->res_compound4_extended.res_compound4;
+  if(pres->res_compound4_extended.res_reply != NULL ||
+     cres->status != NFS4_OK || cres->resarray.resarray_len == 0)
+    return FALSE;
+
+  last = &cres->resarray.resarray_val[cres->resarray.resarray_len - 1];
+  return last->resop == NFS4_OP_READ &&
+    last->nfs_resop4_u.opread.status == NFS4_OK &&
+    rs->data_val ==
+    &last->nfs_resop4_u.opread.READ4res_u.resok4.data.data_val;
+}
+
+/* The data could not be read at all: the READ, last of the reply,
+   fails instead */
+static void
+read_splice_io_error(struct svc_req *req, caddr_t res)
+{
+  nfs_res_t *pres = (nfs_res_t *) res;
+  COMPOUND4res *cres;
+
+  if(req->rq_vers == NFS_V3)
+    {
+      /* The post-op attributes start both arms of the union */
+      pres->res_read3.status = NFS3ERR_IO;
+      return;
+    }
+
+  cres = &pres->res_compound4_extended.res_compound4;
+  cres->resarray.resarray_val[cres->resarray.resarray_len - 1].
+    nfs_resop4_u.opread.status = NFS4ERR_IO;
+  cres->status = NFS4ERR_IO;
+}
+
+/* Wait for room in the socket */
+static bool_t
+read_splice_wait(int fd)
+{
+  struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+  int rc;
+
+  do
+    rc = poll(&pfd, 1, READ_SPLICE_SEND_TIMEOUT);
+  while(rc < 0 && errno == EINTR);
+
+  return rc > 0 && !(pfd.revents & (POLLERR | POLLHUP | POLLNVAL));
+}
+
+static bool_t
+read_splice_write(int fd, const char *buf, size_t len, int flags)
+{
+  ssize_t n;
+
+  while(len != 0)
+    {
+      n = send(fd, buf, len, flags | MSG_NOSIGNAL);
+      if(n < 0)
+        {
+          if(errno == EINTR)
+            continue;
+          if(errno == EAGAIN && read_splice_wait(fd))
+            continue;
+          return FALSE;
+        }
+      buf += n;
+      len -= n;
+    }
+
+  return TRUE;
+}
+
+/* Fill the pipe from the file, as far as it goes */
+static size_t
+read_splice_fill(nfs_read_splice_t *rs)
+{
+  loff_t offset = rs->offset;
+  size_t got = 0;
+  ssize_t n;
+
+  while(got < rs->len)
+    {
+      n = splice(rs->file_fd, &offset, rs->pipefd[1], NULL, rs->len - got,
+                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if(n < 0 && errno == EINTR)
+        continue;
+      if(n <= 0)
+        break;
+      got += n;
+    }
+
+  return got;
+}
+
+/**
+ * @brief Send a reply whose data are to be spliced
+ *
+ * The data are spliced from the file into the pipe, then written from
+ * the pipe after the encoded reply.  Called with the duplex lock of
+ * the transport held.
+ *
+ * @param[in,out] rs   The state of the worker
+ * @param[in]     xprt The transport
+ * @param[in]     req  The request
+ * @param[in]     proc The XDR function of the result
+ * @param[in]     res  The result
+ *
+ * @retval 0  The reply was sent.
+ * @retval 1  Nothing was sent, the data were read into the reply, or
+ *            it was turned into an I/O error, to send it as usual.
+ * @retval -1 The reply could not be sent, the connection is shut down.
+ */
+
+int
+nfs_read_splice_send(nfs_read_splice_t *rs, SVCXPRT *xprt,
+                     struct svc_req *req, xdrproc_t proc, caddr_t res)
+{
+  char stack_buf[READ_SPLICE_HDR_SIZE];
+  char *buf = stack_buf;
+  struct rpc_msg msg;
+  unsigned long hdr_len;
+  u_int pos;
+  uint32_t mark, len, pad, zero = 0;
+  size_t left;
+  ssize_t n;
+  XDR xdrs;
+  int fd = xprt->xp_fd;
+
+  if(!rs->pending)
+    return 1;
+
+  /* Take the data from the file only now, the pipe does not keep a
+   * copy of them.  They may be newer than the attributes in the reply. */
+  if(read_splice_fill(rs) != rs->len)
+    goto fallback;
+
+  memset(&msg, 0, sizeof(msg));
+  msg.rm_xid = req->rq_xid;
+  msg.rm_direction = REPLY;
+  msg.rm_reply.rp_stat = MSG_ACCEPTED;
+  msg.acpted_rply.ar_verf = _null_auth;
+  msg.acpted_rply.ar_stat = SUCCESS;
+  msg.acpted_rply.ar_results.where = res;
+  msg.acpted_rply.ar_results.proc = proc;
+
+  /* Encode with an empty opaque, then give it its length */
+  len = rs->len;
+  *rs->data_len = 0;
+  hdr_len = xdr_sizeof((xdrproc_t) xdr_replymsg, &msg);
+  if(hdr_len + sizeof(mark) > sizeof(stack_buf))
+    buf = gsh_malloc(hdr_len + sizeof(mark));
+  if(buf == NULL || hdr_len == 0)
+    goto fallback;
+
+  xdrmem_create(&xdrs, buf + sizeof(mark), hdr_len, XDR_ENCODE);
+  if(!xdr_replymsg(&xdrs, &msg))
+    {
+      xdr_destroy(&xdrs);
+      goto fallback;
+    }
+  pos = xdr_getpos(&xdrs);
+  xdr_destroy(&xdrs);
+  *rs->data_len = len;
+
+  len = htonl(len);
+  memcpy(buf + sizeof(mark) + pos - sizeof(len), &len, sizeof(len));
+  len = rs->len;
+  pad = (4 - (len & 3)) & 3;
+  mark = htonl(0x80000000u | (pos + len + pad));
+  memcpy(buf, &mark, sizeof(mark));
+
+  if(!read_splice_write(fd, buf, sizeof(mark) + pos, MSG_MORE))
+    goto broken;
+
+  for(left = len; left != 0; left -= n)
+    {
+      n = splice(rs->pipefd[0], NULL, fd, NULL, left,
+                 SPLICE_F_MOVE | (pad != 0 ? SPLICE_F_MORE : 0));
+      if(n < 0)
+        {
+          if(errno == EINTR || (errno == EAGAIN && read_splice_wait(fd)))
+            {
+              n = 0;
+              continue;
+            }
+          goto broken;
+        }
+      if(n == 0)
+        goto broken;
+    }
+
+  if(pad != 0 && !read_splice_write(fd, (char *) &zero, pad, 0))
+    goto broken;
+
+  if(buf != stack_buf)
+    gsh_free(buf);
+
+  rs->pending = FALSE;
+  rs->armed = FALSE;
+  atomic_inc_uint64_t(&splice_sent);
+  atomic_add_uint64_t(&splice_bytes, len);
+  return 0;
+
+fallback:
+  *rs->data_len = rs->len;
+  if(buf != stack_buf)
+    gsh_free(buf);
+  /* Whatever went into the pipe is left there */
+  read_splice_close(rs);
+  if(!nfs_read_splice_fetch(rs))
+    read_splice_io_error(req, res);
+  return 1;
+
+broken:
+  LogEvent(COMPONENT_DISPATCH,
+           "Sending a READ reply from its pipe on socket %d failed: %s, "
+           "shutting the connection down", fd, strerror(errno));
+  shutdown(fd, SHUT_RDWR);
+  if(buf != stack_buf)
+    gsh_free(buf);
+  rs->pending = FALSE;
+  return -1;
+}
+
+/**
+ * @brief Finish with the pipe for the request
+ *
+ * A pipe that may still hold data is closed, a new one is made for
+ * the next READ.  The descriptor of the file is closed.
+ *
+ * @param[in,out] rs The state of the worker
+ */
+
+void
+nfs_read_splice_done(nfs_read_splice_t *rs)
+{
+  if(rs->armed)
+    read_splice_close(rs);
+  if(rs->file_fd >= 0)
+    close(rs->file_fd);
+  rs->file_fd = -1;
+
+  rs->allowed = FALSE;
+  rs->armed = FALSE;
+  rs->pending = FALSE;
+  rs->data_val = NULL;
+  rs->data_len = NULL;
+}
+
+/**
+ * @brief Get the counts of the READ replies sent from pipes
+ *
+ * @param[out] sent    Replies sent from a pipe
+ * @param[out] bytes   Data bytes they carried
+ * @param[out] fetched Replies whose data were read into a buffer
+ */
+
+void
+nfs_read_splice_get_stats(uint64_t *sent, uint64_t *bytes,
+                          uint64_t *fetched)
+{
+  *sent = atomic_fetch_uint64_t(&splice_sent);
+  *bytes = atomic_fetch_uint64_t(&splice_bytes);
+  *fetched = atomic_fetch_uint64_t(&splice_fetched);
+}
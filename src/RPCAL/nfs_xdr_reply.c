@@ -0,0 +1,166 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_xdr_reply.c
+ * @brief  Encoded replies kept for retransmission
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "abstract_atomic.h"
+#include "nfs_xdr_reply.h"
+
+/* Replies currently held, and their size on the wire */
+static uint64_t xdr_reply_count;
+static uint64_t xdr_reply_bytes;
+
+/**
+ * @brief Encode a reply into a new buffer
+ *
+ * @param[in] proc The XDR function of the result
+ * @param[in] res  The result to encode
+ *
+ * @return The encoded reply, with one reference held by the caller,
+ *         or NULL on failure.
+ */
+
+nfs_xdr_reply_t *
+nfs_xdr_reply_encode(xdrproc_t proc, caddr_t res)
+{
+  nfs_xdr_reply_t *reply;
+  unsigned long len;
+  XDR xdrs;
+
+  len = xdr_sizeof(proc, res);
+  if(len == 0 || len > UINT32_MAX)
+    {
+      LogCrit(COMPONENT_DUPREQ,
+              "Unable to size a reply for caching");
+      return NULL;
+    }
+
+  reply = gsh_malloc(sizeof(nfs_xdr_reply_t) + len);
+  if(reply == NULL)
+    return NULL;
+
+  xdrmem_create(&xdrs, reply->data, len, XDR_ENCODE);
+  if(!(*proc) (&xdrs, res))
+    {
+      LogCrit(COMPONENT_DUPREQ,
+              "Unable to encode a reply for caching");
+      xdr_destroy(&xdrs);
+      gsh_free(reply);
+      return NULL;
+    }
+
+  reply->len = xdr_getpos(&xdrs);
+  reply->refcount = 1;
+  xdr_destroy(&xdrs);
+
+  atomic_inc_uint64_t(&xdr_reply_count);
+  atomic_add_uint64_t(&xdr_reply_bytes, reply->len);
+
+  return reply;
+}
+
+/**
+ * @brief Take a reference on a reply
+ *
+ * @param[in] reply The reply
+ */
+
+void
+nfs_xdr_reply_ref(nfs_xdr_reply_t *reply)
+{
+  atomic_inc_uint64_t(&reply->refcount);
+}
+
+/**
+ * @brief Release a reference on a reply
+ *
+ * The reply is freed with its last reference.
+ *
+ * @param[in] reply The reply, may be NULL
+ */
+
+void
+nfs_xdr_reply_unref(nfs_xdr_reply_t *reply)
+{
+  if(reply == NULL)
+    return;
+
+  if(atomic_dec_uint64_t(&reply->refcount) != 0)
+    return;
+
+  atomic_dec_uint64_t(&xdr_reply_count);
+  atomic_sub_uint64_t(&xdr_reply_bytes, reply->len);
+  gsh_free(reply);
+}
+
+/**
+ * @brief XDR function sending an encoded reply
+ *
+ * To be given to svc_sendreply2 in place of the XDR function of the
+ * result: the bytes are written as they were encoded.
+ *
+ * @param[in] xdrs  The XDR stream
+ * @param[in] reply The reply
+ *
+ * @return TRUE on success, FALSE otherwise.
+ */
+
+bool_t
+xdr_nfs_xdr_reply(XDR *xdrs, nfs_xdr_reply_t *reply)
+{
+  switch(xdrs->x_op)
+    {
+    case XDR_ENCODE:
+      return XDR_PUTBYTES(xdrs, reply->data, reply->len);
+
+    case XDR_FREE:
+      /* The reply belongs to whoever holds a reference */
+      return TRUE;
+
+    default:
+      return FALSE;
+    }
+}
+
+/**
+ * @brief Get the number and size of the replies held
+ *
+ * @param[out] count Number of replies
+ * @param[out] bytes Their total size on the wire
+ */
+
+void
+nfs_xdr_reply_get_stats(uint64_t *count, uint64_t *bytes)
+{
+  *count = atomic_fetch_uint64_t(&xdr_reply_count);
+  *bytes = atomic_fetch_uint64_t(&xdr_reply_bytes);
+}
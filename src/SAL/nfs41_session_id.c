@@ -290,10 +290,15 @@ int nfs41_Session_Del(char sessionid[NFS4_SESSIONID_SIZE])
   if(HashTable_Del(ht_session_id, &buffkey, &old_key, &old_value) == HASHTABLE_SUCCESS)
     {
       nfs41_session_t * psession = (nfs41_session_t *) old_value.pdata;
+      int i;
 
       /* free the key that was stored in hash table */
       gsh_free(old_key.pdata);
 
+      /* Release the replies cached in the slots */
+      for(i = 0; i < NFS41_NB_SLOTS; i++)
+        nfs_xdr_reply_unref(psession->slots[i].cached_reply);
+
       /* Decrement our reference to the clientid record */
       dec_client_id_ref(psession->pclientid_record);
 
@@ -144,6 +144,11 @@ void free_client_id(nfs_client_id_t *pclientid)
   if(pclientid->cid_client_record != NULL)
     dec_client_record_ref(pclientid->cid_client_record);
 
+#ifdef _USE_NFS4_1
+  /* Release the reply cached for CREATE_SESSION */
+  nfs_xdr_reply_unref(pclientid->cid_create_session_slot.cached_reply);
+#endif
+
   if(pthread_mutex_destroy(&pclientid->cid_mutex) != 0)
     LogDebug(COMPONENT_CLIENTID,
              "pthread_mutex_destroy returned errno %d (%s)",
@@ -609,6 +609,13 @@ static void remove_from_locklist(state_lock_entry_t   * lock_entry)
   lock_entry_dec_ref(lock_entry);
 }
 
+/* A file that was never locked has no lock list at all */
+static bool_t lock_list_empty(cache_entry_t * pentry)
+{
+  return pentry->object.file.cold == NULL ||
+         glist_empty(&pentry->object.file.cold->lock_list);
+}
+
 static state_lock_entry_t *get_overlapping_entry(cache_entry_t     * pentry,
                                                  fsal_op_context_t * pcontext,
                                                  state_owner_t     * powner,
@@ -618,7 +625,10 @@ static state_lock_entry_t *get_overlapping_entry(cache_entry_t     * pentry,
   state_lock_entry_t *found_entry = NULL;
   uint64_t found_entry_end, plock_end = lock_end(plock);
 
-  glist_for_each(glist, &pentry->object.file.lock_list)
+  if(lock_list_empty(pentry))
+    return NULL;
+
+  glist_for_each(glist, &pentry->object.file.cold->lock_list)
     {
       found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -669,7 +679,7 @@ static void merge_lock_entry(cache_entry_t        * pentry,
 
   /* lock_entry might be STATE_NON_BLOCKING or STATE_GRANTING */
 
-  glist_for_each_safe(glist, glistn, &pentry->object.file.lock_list)
+  glist_for_each_safe(glist, glistn, &pentry->object.file.cold->lock_list)
     {
       check_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -716,7 +726,7 @@ static void merge_lock_entry(cache_entry_t        * pentry,
                            "Memory allocation failure during lock upgrade/downgrade");
                   continue;
                 }
-              glist_add_tail(&pentry->object.file.lock_list, &(check_entry_right->sle_list));
+              glist_add_tail(&pentry->object.file.cold->lock_list, &(check_entry_right->sle_list));
             }
           else
             {
@@ -1430,7 +1440,7 @@ void state_complete_grant(fsal_op_context_t     * pcontext,
   free_cookie(cookie_entry, TRUE);
 
   /* In case all locks have wound up free, we must release the pin reference. */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
       cache_inode_dec_pin_ref(pentry);
 
   pthread_rwlock_unlock(&pentry->state_lock);
@@ -1492,7 +1502,7 @@ void process_blocked_lock_upcall(state_block_data_t   * block_data)
   try_to_grant_lock(lock_entry);
 
   /* In case all locks have wound up free, we must release the pin reference. */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
       cache_inode_dec_pin_ref(pentry);
 
   pthread_rwlock_unlock(&pentry->state_lock);
@@ -1506,10 +1516,10 @@ static void grant_blocked_locks(cache_entry_t        * pentry,
   fsal_staticfsinfo_t  * pstatic = pcontext->export_context->fe_static_fs_info;
 
   /* If FSAL supports async blocking locks, allow it to grant blocked locks. */
-  if(pstatic->lock_support_async_block)
+  if(pstatic->lock_support_async_block || lock_list_empty(pentry))
     return;
 
-  glist_for_each_safe(glist, glistn, &pentry->object.file.lock_list)
+  glist_for_each_safe(glist, glistn, &pentry->object.file.cold->lock_list)
     {
       found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -1630,7 +1640,7 @@ void cancel_blocked_locks_range(cache_entry_t        * pentry,
   state_lock_entry_t * found_entry = NULL;
   uint64_t             found_entry_end, plock_end = lock_end(plock);
 
-  glist_for_each_safe(glist, glistn, &pentry->object.file.lock_list)
+  glist_for_each_safe(glist, glistn, &pentry->object.file.cold->lock_list)
     {
       found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -1725,7 +1735,7 @@ state_status_t state_release_grant(fsal_op_context_t     * pcontext,
   grant_blocked_locks(pentry, pcontext);
 
   /* In case all locks have wound up free, we must release the pin reference. */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
       cache_inode_dec_pin_ref(pentry);
 
   pthread_rwlock_unlock(&pentry->state_lock);
@@ -1804,7 +1814,7 @@ state_status_t do_unlock_no_owner(cache_entry_t        * pentry,
   if(subtract_list_from_list(pentry,
                              pcontext,
                              &fsal_unlock_list,
-                             &pentry->object.file.lock_list,
+                             &pentry->object.file.cold->lock_list,
                              &status) != STATE_SUCCESS)
     {
       /* We ran out of memory while trying to build the unlock list.
@@ -2041,8 +2051,9 @@ state_status_t state_test(cache_entry_t        * pentry,
                 pentry, pcontext, *holder, conflict);
     }
 
-  if(isFullDebug(COMPONENT_STATE) && isFullDebug(COMPONENT_MEMLEAKS))
-    LogList("Lock List", pentry, &pentry->object.file.lock_list);
+  if(isFullDebug(COMPONENT_STATE) && isFullDebug(COMPONENT_MEMLEAKS) &&
+     !lock_list_empty(pentry))
+    LogList("Lock List", pentry, &pentry->object.file.cold->lock_list);
 
   pthread_rwlock_unlock(&pentry->state_lock);
 
@@ -2098,6 +2109,14 @@ state_status_t state_lock(cache_entry_t         * pentry,
       return *pstatus;
     }
 
+  /* The lock list lives with the rest of the locking state of the file */
+  if(cache_inode_file_cold_get(pentry) == NULL)
+    {
+      cache_inode_dec_pin_ref(pentry);
+      *pstatus = STATE_MALLOC_ERROR;
+      return *pstatus;
+    }
+
   pthread_rwlock_wrlock(&pentry->state_lock);
 
 #ifdef _USE_BLOCKING_LOCKS
@@ -2109,7 +2128,7 @@ state_status_t state_lock(cache_entry_t         * pentry,
        * request and keep sending us new lock request again and again. So if
        * we have a mapping blocked request return that
        */
-      glist_for_each(glist, &pentry->object.file.lock_list)
+      glist_for_each(glist, &pentry->object.file.cold->lock_list)
         {
           found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -2157,7 +2176,7 @@ state_status_t state_lock(cache_entry_t         * pentry,
     }
 #endif
 
-  glist_for_each(glist, &pentry->object.file.lock_list)
+  glist_for_each(glist, &pentry->object.file.cold->lock_list)
     {
       found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -2202,7 +2221,7 @@ state_status_t state_lock(cache_entry_t         * pentry,
                * Also indicate overlap hint.
                */
               LogEntry("Conflicts with", found_entry);
-              LogList("Locks", pentry, &pentry->object.file.lock_list);
+              LogList("Locks", pentry, &pentry->object.file.cold->lock_list);
               copy_conflict(found_entry, holder, conflict);
               allow   = FALSE;
               overlap = TRUE;
@@ -2382,10 +2401,10 @@ state_status_t state_lock(cache_entry_t         * pentry,
       /* if the list is empty to start with; increment the pin ref count
        * before adding it to the list
        */
-      if(glist_empty(&pentry->object.file.lock_list))
+      if(lock_list_empty(pentry))
           cache_inode_inc_pin_ref(pentry);
 
-      glist_add_tail(&pentry->object.file.lock_list, &found_entry->sle_list);
+      glist_add_tail(&pentry->object.file.cold->lock_list, &found_entry->sle_list);
 
 #ifdef _USE_BLOCKING_LOCKS
       /* A lock downgrade could unblock blocked locks */
@@ -2414,10 +2433,10 @@ state_status_t state_lock(cache_entry_t         * pentry,
       /* if the list is empty to start with; increment the pin ref count
        * before adding it to the list
        */
-      if(glist_empty(&pentry->object.file.lock_list))
+      if(lock_list_empty(pentry))
           cache_inode_inc_pin_ref(pentry);
 
-      glist_add_tail(&pentry->object.file.lock_list, &found_entry->sle_list);
+      glist_add_tail(&pentry->object.file.cold->lock_list, &found_entry->sle_list);
 
       pthread_rwlock_unlock(&pentry->state_lock);
 
@@ -2491,7 +2510,7 @@ state_status_t state_unlock(cache_entry_t        * pentry,
   pthread_rwlock_wrlock(&pentry->state_lock);
 
   /* If lock list is empty, there really isn't any work for us to do. */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
     {
       pthread_rwlock_unlock(&pentry->state_lock);
 
@@ -2527,7 +2546,7 @@ state_status_t state_unlock(cache_entry_t        * pentry,
                           pstate,
                           plock,
                           pstatus,
-                          &pentry->object.file.lock_list);
+                          &pentry->object.file.cold->lock_list);
 
   if(*pstatus != STATE_SUCCESS)
     {
@@ -2544,7 +2563,7 @@ state_status_t state_unlock(cache_entry_t        * pentry,
     }
 
   /* If the lock list has become zero; decrement the pin ref count pt placed */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
       cache_inode_dec_pin_ref(pentry);
 
 
@@ -2577,7 +2596,7 @@ state_status_t state_unlock(cache_entry_t        * pentry,
   if(isFullDebug(COMPONENT_STATE) &&
      isFullDebug(COMPONENT_MEMLEAKS) &&
      plock->lock_start == 0 && plock->lock_length == 0)
-    empty = LogList("Lock List", pentry, &pentry->object.file.lock_list);
+    empty = LogList("Lock List", pentry, &pentry->object.file.cold->lock_list);
 
 #ifdef _USE_BLOCKING_LOCKS
   grant_blocked_locks(pentry, pcontext);
@@ -2638,7 +2657,7 @@ state_status_t state_cancel(cache_entry_t        * pentry,
   pthread_rwlock_wrlock(&pentry->state_lock);
 
   /* If lock list is empty, there really isn't any work for us to do. */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
     {
       pthread_rwlock_unlock(&pentry->state_lock);
 
@@ -2650,7 +2669,7 @@ state_status_t state_cancel(cache_entry_t        * pentry,
       return *pstatus;
     }
 
-  glist_for_each(glist, &pentry->object.file.lock_list)
+  glist_for_each(glist, &pentry->object.file.cold->lock_list)
     {
       found_entry = glist_entry(glist, state_lock_entry_t, sle_list);
 
@@ -2674,7 +2693,7 @@ state_status_t state_cancel(cache_entry_t        * pentry,
     }
 
   /* If the lock list has become zero; decrement the pin ref count pt placed */
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
       cache_inode_dec_pin_ref(pentry);
 
   pthread_rwlock_unlock(&pentry->state_lock);
@@ -3044,11 +3063,12 @@ void find_blocked_lock_upcall(cache_entry_t        * pentry,
   V(blocked_locks_mutex);
 
   if(isFullDebug(COMPONENT_STATE) &&
-     isFullDebug(COMPONENT_MEMLEAKS))
+     isFullDebug(COMPONENT_MEMLEAKS) &&
+     pentry->object.file.cold != NULL)
     {
       pthread_rwlock_rdlock(&pentry->state_lock);
 
-      LogList("File Lock List", pentry, &pentry->object.file.lock_list);
+      LogList("File Lock List", pentry, &pentry->object.file.cold->lock_list);
 
       pthread_rwlock_unlock(&pentry->state_lock);
     }
@@ -3093,10 +3113,10 @@ void available_blocked_lock_upcall(cache_entry_t        * pentry,
 
 void state_lock_wipe(cache_entry_t        * pentry)
 {
-  if(glist_empty(&pentry->object.file.lock_list))
+  if(lock_list_empty(pentry))
     return;
 
-  free_list(&pentry->object.file.lock_list);
+  free_list(&pentry->object.file.cold->lock_list);
 
   cache_inode_dec_pin_ref(pentry);
 }
@@ -121,6 +121,13 @@ state_status_t state_share_add(cache_entry_t         * pentry,
   unsigned int            new_share_deny = 0;
   fsal_share_param_t      share_param;
 
+  /* The counters live with the rest of the locking state of the file */
+  if(cache_inode_file_cold_get(pentry) == NULL)
+    {
+      *pstatus = STATE_MALLOC_ERROR;
+      return *pstatus;
+    }
+
   /* Check if new share state has conflicts. */
   status = state_share_check_conflict(pentry,
                                       pstate->state_data.share.share_access,
@@ -483,30 +490,40 @@ state_status_t state_share_check_conflict(cache_entry_t  * pentry,
                                           state_status_t * pstatus)
 {
   char * cause = "";
+  cache_inode_share_t * share_state;
+
+  /* A file that was never shared has nothing to conflict with */
+  if(pentry->object.file.cold == NULL)
+    {
+      *pstatus = STATE_SUCCESS;
+      return *pstatus;
+    }
+
+  share_state = &pentry->object.file.cold->share_state;
 
   if((share_acccess & OPEN4_SHARE_ACCESS_READ) != 0 &&
-     pentry->object.file.share_state.share_deny_read > 0)
+     share_state->share_deny_read > 0)
     {
       cause = "access read denied by existing deny read";
       goto out_conflict;
     }
 
   if((share_acccess & OPEN4_SHARE_ACCESS_WRITE) != 0 &&
-     pentry->object.file.share_state.share_deny_write > 0)
+     share_state->share_deny_write > 0)
     {
       cause = "access write denied by existing deny write";
       goto out_conflict;
     }
 
   if((share_deny & OPEN4_SHARE_DENY_READ) != 0 &&
-     pentry->object.file.share_state.share_access_read > 0)
+     share_state->share_access_read > 0)
     {
       cause = "deny read denied by existing access read";
       goto out_conflict;
     }
 
   if((share_deny & OPEN4_SHARE_DENY_WRITE) != 0 &&
-     pentry->object.file.share_state.share_access_write > 0)
+     share_state->share_access_write > 0)
     {
       cause = "deny write denied by existing access write";
       goto out_conflict;
@@ -536,34 +553,41 @@ static void state_share_update_counter(cache_entry_t * pentry,
   int access_write_inc = ((new_access & OPEN4_SHARE_ACCESS_WRITE) != 0) - ((old_access & OPEN4_SHARE_ACCESS_WRITE) != 0);
   int deny_read_inc    = ((new_deny   & OPEN4_SHARE_ACCESS_READ) != 0) - ((old_deny   & OPEN4_SHARE_ACCESS_READ) != 0);
   int deny_write_inc   = ((new_deny   & OPEN4_SHARE_ACCESS_WRITE) != 0) - ((old_deny   & OPEN4_SHARE_ACCESS_WRITE) != 0);
+  cache_inode_share_t * share_state = &pentry->object.file.cold->share_state;
 
-  pentry->object.file.share_state.share_access_read  += access_read_inc;
-  pentry->object.file.share_state.share_access_write += access_write_inc;
-  pentry->object.file.share_state.share_deny_read    += deny_read_inc;
-  pentry->object.file.share_state.share_deny_write   += deny_write_inc;
+  share_state->share_access_read  += access_read_inc;
+  share_state->share_access_write += access_write_inc;
+  share_state->share_deny_read    += deny_read_inc;
+  share_state->share_deny_write   += deny_write_inc;
   if(v4)
-    pentry->object.file.share_state.share_deny_write_v4 += deny_write_inc;
+    share_state->share_deny_write_v4 += deny_write_inc;
 
   LogFullDebug(COMPONENT_STATE, "pentry %p: share counter: "
                "access_read %u, access_write %u, "
                "deny_read %u, deny_write %u, deny_write_v4 %u",
                pentry,
-               pentry->object.file.share_state.share_access_read,
-               pentry->object.file.share_state.share_access_write,
-               pentry->object.file.share_state.share_deny_read,
-               pentry->object.file.share_state.share_deny_write,
-               pentry->object.file.share_state.share_deny_write_v4);
+               share_state->share_access_read,
+               share_state->share_access_write,
+               share_state->share_deny_read,
+               share_state->share_deny_write,
+               share_state->share_deny_write_v4);
 }
 
 /* Utility function to calculate the union of share access of given file. */
 static unsigned int state_share_get_share_access(cache_entry_t * pentry)
 {
   unsigned int share_access = 0;
+  cache_inode_share_t * share_state;
+
+  if(pentry->object.file.cold == NULL)
+    return share_access;
+
+  share_state = &pentry->object.file.cold->share_state;
 
-  if(pentry->object.file.share_state.share_access_read > 0)
+  if(share_state->share_access_read > 0)
     share_access |= OPEN4_SHARE_ACCESS_READ;
 
-  if(pentry->object.file.share_state.share_access_write > 0)
+  if(share_state->share_access_write > 0)
     share_access |= OPEN4_SHARE_ACCESS_WRITE;
 
   LogFullDebug(COMPONENT_STATE, "pentry %p: union share access = %u",
@@ -576,11 +600,17 @@ static unsigned int state_share_get_share_access(cache_entry_t * pentry)
 static unsigned int state_share_get_share_deny(cache_entry_t * pentry)
 {
   unsigned int share_deny = 0;
+  cache_inode_share_t * share_state;
+
+  if(pentry->object.file.cold == NULL)
+    return share_deny;
+
+  share_state = &pentry->object.file.cold->share_state;
 
-  if(pentry->object.file.share_state.share_deny_read > 0)
+  if(share_state->share_deny_read > 0)
     share_deny |= OPEN4_SHARE_DENY_READ;
 
-  if(pentry->object.file.share_state.share_deny_write > 0)
+  if(share_state->share_deny_write > 0)
     share_deny |= OPEN4_SHARE_DENY_WRITE;
 
   LogFullDebug(COMPONENT_STATE, "pentry %p: union share deny = %u",
@@ -595,10 +625,12 @@ state_status_t state_share_anonymous_io_start(cache_entry_t  * pentry,
 {
   pthread_rwlock_wrlock(&pentry->state_lock);
 
-  if(state_share_check_conflict(pentry,
-                                share_access,
-                                0,
-                                pstatus) == STATE_SUCCESS)
+  if(cache_inode_file_cold_get(pentry) == NULL)
+    *pstatus = STATE_MALLOC_ERROR;
+  else if(state_share_check_conflict(pentry,
+                                     share_access,
+                                     0,
+                                     pstatus) == STATE_SUCCESS)
     {
       /* Temporarily bump the access counters, v4 mode doesn't matter
        * since there is no deny mode associated with anonymous I/O.
@@ -694,6 +726,18 @@ state_status_t state_nlm_share(cache_entry_t        * pentry,
       return *pstatus;
     }
 
+  /* The share list lives with the rest of the locking state of the file */
+  if(cache_inode_file_cold_get(pentry) == NULL)
+    {
+      pthread_rwlock_unlock(&pentry->state_lock);
+
+      cache_inode_dec_pin_ref(pentry);
+
+      *pstatus = STATE_MALLOC_ERROR;
+
+      return *pstatus;
+    }
+
   /* Create a new NLM Share object */
   nlm_share = gsh_calloc(1, sizeof(state_nlm_share_t));
 
@@ -736,10 +780,10 @@ state_status_t state_nlm_share(cache_entry_t        * pentry,
   /* Add share to list for file, if list was empty take a pin ref to keep this
    * file pinned in the inode cache.
    */
-  if(glist_empty(&pentry->object.file.nlm_share_list))
+  if(glist_empty(&pentry->object.file.cold->nlm_share_list))
     cache_inode_inc_pin_ref(pentry);
 
-  glist_add_tail(&pentry->object.file.nlm_share_list, &nlm_share->sns_share_per_file);
+  glist_add_tail(&pentry->object.file.cold->nlm_share_list, &nlm_share->sns_share_per_file);
 
   /* Get the current union of share states of this file. */
   old_pentry_share_access = state_share_get_share_access(pentry);
@@ -784,7 +828,7 @@ state_status_t state_nlm_share(cache_entry_t        * pentry,
            */
           glist_del(&nlm_share->sns_share_per_file);
 
-          if(glist_empty(&pentry->object.file.nlm_share_list))
+          if(glist_empty(&pentry->object.file.cold->nlm_share_list))
             cache_inode_dec_pin_ref(pentry);
 
           /* Remove the share from the NSM Client list */
@@ -857,7 +901,19 @@ state_status_t state_nlm_unshare(cache_entry_t        * pentry,
 
   pthread_rwlock_wrlock(&pentry->state_lock);
 
-  glist_for_each_safe(glist, glistn, &pentry->object.file.nlm_share_list)
+  /* A file that was never shared has no share list */
+  if(pentry->object.file.cold == NULL)
+    {
+      pthread_rwlock_unlock(&pentry->state_lock);
+
+      cache_inode_dec_pin_ref(pentry);
+
+      *pstatus = STATE_SUCCESS;
+
+      return *pstatus;
+    }
+
+  glist_for_each_safe(glist, glistn, &pentry->object.file.cold->nlm_share_list)
     {
       nlm_share = glist_entry(glist, state_nlm_share_t, sns_share_per_file);
 
@@ -934,7 +990,7 @@ state_status_t state_nlm_unshare(cache_entry_t        * pentry,
        */
       glist_del(&nlm_share->sns_share_per_file);
 
-      if(glist_empty(&pentry->object.file.nlm_share_list))
+      if(glist_empty(&pentry->object.file.cold->nlm_share_list))
         cache_inode_dec_pin_ref(pentry);
 
       /* Remove the share from the NSM Client list */
@@ -0,0 +1,143 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * ---------------------------------------
+ */
+
+/**
+ * \file    fsal_types.h
+ * \brief   File System Abstraction Layer types and constants.
+ *
+ * FSAL_MEM keeps the whole filesystem in the memory of the server: it
+ * costs next to nothing, for measuring the layers above the FSAL, and
+ * it starts empty, for scratch exports.
+ */
+
+#ifndef _FSAL_TYPES_SPECIFIC_H
+#define _FSAL_TYPES_SPECIFIC_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+/*
+ * FS relative includes
+ */
+
+#include "config_parsing.h"
+#include "err_fsal.h"
+
+#include <sys/types.h>
+#include <sys/param.h>
+#include <stdint.h>
+
+/*
+ * labels in the config file
+ */
+
+#define CONF_LABEL_FS_SPECIFIC   "MEM"
+
+#include "fsal_glue_const.h"
+
+#define fsal_handle_t memfsal_handle_t
+#define fsal_op_context_t memfsal_op_context_t
+#define fsal_file_t memfsal_file_t
+#define fsal_dir_t memfsal_dir_t
+#define fsal_export_context_t memfsal_export_context_t
+#define fsal_lockdesc_t memfsal_lockdesc_t
+#define fsal_cookie_t memfsal_cookie_t
+#define fs_specific_initinfo_t memfs_specific_initinfo_t
+#define fsal_cred_t memfsal_cred_t
+
+typedef union
+{
+  struct
+  {
+    uint64_t id;                /* inode number, never reused */
+    uint32_t generation;        /* start time of the server */
+    uint32_t type;              /* fsal_nodetype_t of the object */
+  } data;
+  char pad[FSAL_HANDLE_T_SIZE];
+} memfsal_handle_t;  /**< FS object handle */
+
+typedef struct
+{
+  fsal_staticfsinfo_t * fe_static_fs_info;     /* Must be the first entry in this structure */
+
+  memfsal_handle_t root_handle;
+} memfsal_export_context_t;
+
+#define FSAL_EXPORT_CONTEXT_SPECIFIC( pexport_context ) (uint64_t)((pexport_context)->root_handle.data.id)
+
+typedef struct
+{
+  memfsal_export_context_t *export_context;     /* Must be the first entry in this structure */
+  struct user_credentials credential;
+} memfsal_op_context_t;
+
+#define FSAL_OP_CONTEXT_TO_UID( pcontext ) ( pcontext->credential.user )
+#define FSAL_OP_CONTEXT_TO_GID( pcontext ) ( pcontext->credential.group )
+
+typedef struct
+{
+  unsigned int metadata_latency;  /* Microseconds added to metadata operations */
+  unsigned int read_latency;      /* ... to reads */
+  unsigned int write_latency;     /* ... to writes */
+  unsigned int commit_latency;    /* ... to commits */
+  fsal_u64_t max_size;            /* Bytes of file data, 0 for no limit */
+  fsal_u64_t max_files;           /* Objects, 0 for no limit */
+} memfs_specific_initinfo_t;
+
+/**< directory cookie */
+typedef union
+{
+  struct
+  {
+    uint64_t cookie;
+  } data;
+  char pad[FSAL_COOKIE_T_SIZE];
+} memfsal_cookie_t;
+
+#define FSAL_SET_PCOOKIE_BY_OFFSET( __pfsal_cookie, __cookie )           \
+do                                                                       \
+{                                                                        \
+   ((memfsal_cookie_t *)__pfsal_cookie)->data.cookie = (uint64_t)__cookie ; \
+} while( 0 )
+
+#define FSAL_SET_OFFSET_BY_PCOOKIE( __pfsal_cookie, __cookie )           \
+do                                                                       \
+{                                                                        \
+   __cookie =  ((memfsal_cookie_t *)__pfsal_cookie)->data.cookie ;       \
+} while( 0 )
+
+struct mem_inode;
+
+/* Directory stream descriptor. */
+
+typedef struct
+{
+  struct mem_inode *inode;      /* referenced while the directory is open */
+  memfsal_op_context_t context; /* credential for accessing the directory */
+  memfsal_handle_t handle;
+} memfsal_dir_t;
+
+typedef struct
+{
+  struct mem_inode *inode;      /* referenced while the file is open */
+  unsigned int openflags;
+  uint64_t current_offset;      /* for reads and writes without a seek */
+} memfsal_file_t;
+
+#endif                          /* _FSAL_TYPES_SPECIFIC_H */
@@ -29,7 +29,9 @@
  * @brief Header for hash functionality
  *
  * This file defines the functions and data structures for use with
- * the Ganesha red-black tree based, concurrent hash store.
+ * the Ganesha red-black tree based, concurrent hash store.  A table
+ * created with HT_FLAG_OPEN_ADDR uses open addressing partitions
+ * instead, behind the same interface.
  */
 
 #ifndef _HASHTABLE_H
@@ -74,6 +76,9 @@ typedef int (*key_display_function_t)(struct hash_buff *,
                                        char *);
 typedef int (*val_display_function_t)(struct hash_buff*,
                                        char *);
+typedef size_t (*key_flatten_function_t)(struct hash_buff *,
+                                         char *,
+                                         size_t);
 
 
 /**
@@ -83,6 +88,8 @@ typedef int (*val_display_function_t)(struct hash_buff*,
 
 #define HT_FLAG_NONE 0x0000
 #define HT_FLAG_CACHE 0x0001
+#define HT_FLAG_OPEN_ADDR 0x0002 /*< Open addressing partitions instead
+                                     of red-black trees */
 
 struct hash_param
 {
@@ -117,6 +124,16 @@ struct hash_param
                                             to a string. */
      val_display_function_t val_to_str; /*< Function to convert a
                                             value to a string. */
+     key_flatten_function_t key_flatten; /*< Writes the bytes that
+                                             identify a key, equal for
+                                             two keys if and only if
+                                             compare_key says so, and
+                                             returns their number, 0
+                                             if they do not fit.  May
+                                             be NULL if the key is
+                                             already flat, that is
+                                             pdata holds len such
+                                             bytes. */
      char *ht_name; /*< Name of this hash table. */
      log_components_t ht_log_component; /*< Log component to use for this
                                             hash table */
@@ -133,6 +150,49 @@ typedef struct hash_stat
                                        of nodes) of the rbt used. */
 } hash_stat_t;
 
+/**
+ * @brief Bytes of a key copied into its slot
+ *
+ * Lockless lookups only ever compare against this copy, never
+ * against the key the slot points to, whose memory belongs to the
+ * caller.  Lookups of longer keys take the partition lock.
+ */
+#define HASH_OA_KEY_INLINE 48
+
+/**
+ * @brief Flat copy of the key of a slot
+ *
+ * As written by the key_flatten function of the table, or the bytes
+ * of the key itself if it has none.  A length of 0 means no copy.
+ */
+
+struct hash_oa_key
+{
+     uint32_t len; /*< Number of bytes, 0 if the key did not fit */
+     char bytes[HASH_OA_KEY_INLINE]; /*< The flat key */
+};
+
+/**
+ * @brief Slots of an open addressing partition
+ *
+ * The hashes are kept apart from the keys and values so that a probe
+ * sequence only walks a few cache lines of hashes.
+ */
+
+struct hash_oa_slots
+{
+     uint32_t size; /*< Number of slots, a power of 2 */
+     uint32_t shift; /*< 64 - log2(size), maps a hash to its slot */
+     struct hash_oa_slots *retired; /*< The smaller slots this replaced,
+                                        kept while lockless readers
+                                        may be walking them */
+     uint64_t retired_epoch; /*< Reader epoch at which these slots
+                                 replaced the last of retired */
+     uint64_t *hashes; /*< Hash of each slot, 0 when empty */
+     struct hash_data *data; /*< Key and value of each slot */
+     struct hash_oa_key *keys; /*< Flat copy of each short key */
+};
+
 /**
  * @brief Represents an individual partition
  *
@@ -146,6 +206,8 @@ struct hash_partition
      struct rbt_head rbt; /*< The red-black tree */
      pthread_rwlock_t lock; /*< Lock for this partition */
      struct rbt_node** cache; /*< expected entry cache */
+     struct hash_oa_slots *oa; /*< Slots, for HT_FLAG_OPEN_ADDR tables */
+     uint32_t oa_seq; /*< Odd while the slots are being modified */
 };
 
 typedef struct hash_table
@@ -162,6 +224,8 @@ struct hash_latch {
      uint32_t index; /*< Saved partition index */
      uint64_t rbt_hash; /*< Saved red-black hash */
      struct rbt_node *locator; /*< Saved location in the tree */
+     uint32_t slot; /*< Saved slot, open addressing tables */
+     int found; /*< Whether the key is in that slot */
 };
 
 typedef enum hash_set_how {
@@ -54,6 +54,8 @@
 
 /*
  * Increment/decrement
+ *
+ * All of these return the new value, whichever builtins are used.
  */
 
 /**
@@ -75,7 +77,7 @@ atomic_add_int64_t(int64_t *augend, uint64_t addend)
 static inline int64_t
 atomic_add_int64_t(int64_t *augend, uint64_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -112,7 +114,7 @@ atomic_sub_int64_t(int64_t *minuend, uint64_t subtrahend)
 static inline int64_t
 atomic_sub_int64_t(int64_t *minuend, uint64_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -149,7 +151,7 @@ atomic_add_uint64_t(uint64_t *augend, uint64_t addend)
 static inline uint64_t
 atomic_add_uint64_t(uint64_t *augend, uint64_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -186,7 +188,7 @@ atomic_sub_uint64_t(uint64_t *minuend, uint64_t subtrahend)
 static inline uint64_t
 atomic_sub_uint64_t(uint64_t *minuend, uint64_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -223,7 +225,7 @@ atomic_add_int32_t(int32_t *augend, uint32_t addend)
 static inline int32_t
 atomic_add_int32_t(int32_t *augend, uint32_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -260,7 +262,7 @@ atomic_sub_int32_t(int32_t *minuend, uint32_t subtrahend)
 static inline int32_t
 atomic_sub_int32_t(int32_t *minuend, uint32_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -297,7 +299,7 @@ atomic_add_uint32_t(uint32_t *augend, uint32_t addend)
 static inline uint32_t
 atomic_add_uint32_t(uint32_t *augend, uint32_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -333,7 +335,7 @@ atomic_sub_uint32_t(uint32_t *var, uint32_t sub)
 static inline uint32_t
 atomic_sub_uint32_t(uint32_t *var, uint32_t sub)
 {
-     return __sync_fetch_and_sub(var, sub);
+     return __sync_sub_and_fetch(var, sub);
 }
 #endif
 
@@ -370,7 +372,7 @@ atomic_add_int16_t(int16_t *augend, uint16_t addend)
 static inline int16_t
 atomic_add_int16_t(int16_t *augend, uint16_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -407,7 +409,7 @@ atomic_sub_int16_t(int16_t *minuend, uint16_t subtrahend)
 static inline int16_t
 atomic_sub_int16_t(int16_t *minuend, uint16_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -444,7 +446,7 @@ atomic_add_uint16_t(uint16_t *augend, uint16_t addend)
 static inline uint16_t
 atomic_add_uint16_t(uint16_t *augend, uint16_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -481,7 +483,7 @@ atomic_sub_uint16_t(uint16_t *minuend, uint16_t subtrahend)
 static inline uint16_t
 atomic_sub_uint16_t(uint16_t *minuend, uint16_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -518,7 +520,7 @@ atomic_add_int8_t(int8_t *augend, uint8_t addend)
 static inline int8_t
 atomic_add_int8_t(int8_t *augend, uint8_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -555,7 +557,7 @@ atomic_sub_int8_t(int8_t *minuend, uint8_t subtrahend)
 static inline int8_t
 atomic_sub_int8_t(int8_t *minuend, uint8_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -592,7 +594,7 @@ atomic_add_uint8_t(uint8_t *augend, uint8_t addend)
 static inline uint8_t
 atomic_add_uint8_t(uint8_t *augend, uint8_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -629,7 +631,7 @@ atomic_sub_uint8_t(uint8_t *minuend, uint8_t subtrahend)
 static inline uint8_t
 atomic_sub_uint8_t(uint8_t *minuend, uint8_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -666,7 +668,7 @@ atomic_add_size_t(size_t *augend, size_t addend)
 static inline size_t
 atomic_add_size_t(size_t *augend, size_t addend)
 {
-     return __sync_fetch_and_add(augend, addend);
+     return __sync_add_and_fetch(augend, addend);
 }
 #endif
 
@@ -703,7 +705,7 @@ atomic_sub_size_t(size_t *minuend, size_t subtrahend)
 static inline size_t
 atomic_sub_size_t(size_t *minuend, size_t subtrahend)
 {
-     return __sync_fetch_and_sub(minuend, subtrahend);
+     return __sync_sub_and_fetch(minuend, subtrahend);
 }
 #endif
 
@@ -732,6 +734,8 @@ atomic_dec_size_t(size_t *var)
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to clear
+ *
+ * @return The value after the bits are cleared.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -746,17 +750,19 @@ static inline uint64_t
 atomic_clear_uint64_t_bits(uint64_t *var,
                            uint64_t bits)
 {
-     return __sync_fetch_and_and(var, ~bits);
+     return __sync_and_and_fetch(var, ~bits);
 }
 #endif
 
 /**
  * @brief Atomically set bits in a uint64_t
  *
- * This function atomic clears the bits indicated.
+ * This function atomically sets the bits indicated.
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to set
+ *
+ * @return The value after the bits are set.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -771,7 +777,7 @@ static inline uint64_t
 atomic_set_uint64_t_bits(uint64_t *var,
                          uint64_t bits)
 {
-     return __sync_fetch_and_or(var, bits);
+     return __sync_or_and_fetch(var, bits);
 }
 #endif
 
@@ -782,6 +788,8 @@ atomic_set_uint64_t_bits(uint64_t *var,
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to clear
+ *
+ * @return The value after the bits are cleared.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -796,17 +804,19 @@ static inline uint32_t
 atomic_clear_uint32_t_bits(uint32_t *var,
                            uint32_t bits)
 {
-     return __sync_fetch_and_and(var, ~bits);
+     return __sync_and_and_fetch(var, ~bits);
 }
 #endif
 
 /**
  * @brief Atomically set bits in a uint32_t
  *
- * This function atomic clears the bits indicated.
+ * This function atomically sets the bits indicated.
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to set
+ *
+ * @return The value after the bits are set.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -821,7 +831,7 @@ static inline uint32_t
 atomic_set_uint32_t_bits(uint32_t *var,
                          uint32_t bits)
 {
-     return __sync_fetch_and_or(var, bits);
+     return __sync_or_and_fetch(var, bits);
 }
 #endif
 
@@ -832,6 +842,8 @@ atomic_set_uint32_t_bits(uint32_t *var,
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to clear
+ *
+ * @return The value after the bits are cleared.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -846,17 +858,19 @@ static inline uint16_t
 atomic_clear_uint16_t_bits(uint16_t *var,
                            uint16_t bits)
 {
-     return __sync_fetch_and_and(var, ~bits);
+     return __sync_and_and_fetch(var, ~bits);
 }
 #endif
 
 /**
  * @brief Atomically set bits in a uint16_t
  *
- * This function atomic clears the bits indicated.
+ * This function atomically sets the bits indicated.
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to set
+ *
+ * @return The value after the bits are set.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -871,7 +885,7 @@ static inline uint16_t
 atomic_set_uint16_t_bits(uint16_t *var,
                          uint16_t bits)
 {
-     return __sync_fetch_and_or(var, bits);
+     return __sync_or_and_fetch(var, bits);
 }
 #endif
 
@@ -882,6 +896,8 @@ atomic_set_uint16_t_bits(uint16_t *var,
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to clear
+ *
+ * @return The value after the bits are cleared.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -896,17 +912,19 @@ static inline uint8_t
 atomic_clear_uint8_t_bits(uint8_t *var,
                           uint8_t bits)
 {
-     return __sync_fetch_and_and(var, ~bits);
+     return __sync_and_and_fetch(var, ~bits);
 }
 #endif
 
 /**
  * @brief Atomically set bits in a uint8_t
  *
- * This function atomic clears the bits indicated.
+ * This function atomically sets the bits indicated.
  *
  * @param[in,out] var  Pointer to the value to modify
  * @param[in]     bits Bits to set
+ *
+ * @return The value after the bits are set.
  */
 
 #ifdef GCC_ATOMIC_FUNCTIONS
@@ -921,7 +939,7 @@ static inline uint8_t
 atomic_set_uint8_t_bits(uint8_t *var,
                         uint8_t bits)
 {
-     return __sync_fetch_and_or(var, bits);
+     return __sync_or_and_fetch(var, bits);
 }
 #endif
 
@@ -111,8 +111,9 @@ typedef struct cache_inode_lru__
                            portion of the logical LRU. */
   pthread_mutex_t mtx; /*< Mutex protecting this entry with regard to
                            LRU operations. */
-  int64_t refcount; /*< Reference count.  This is signed to make
-                        mistakes easy to see. */
+  int64_t refcount; /*< Reference count, only changed atomically
+                        and without the mutex.  This is signed to
+                        make mistakes easy to see. */
   uint32_t pin_refcnt; /*< Unpin it only if this goes down to zero */
   uint32_t flags; /*< Flags for details of this entry's status, such
                       as whether it is pinned and whetehr it's in L1
@@ -120,6 +121,9 @@ typedef struct cache_inode_lru__
   uint32_t lane; /*< The lane in which an entry currently resides, so
                      we can lock the deque and decrement the correct
                      counter when moving or deleting the entry. */
+  uint32_t referenced; /*< Set, atomically and without any lock, when
+                           the entry is used.  Cleared by the reclaim
+                           as it passes the entry. */
 } cache_inode_lru_t;
 
 /**
@@ -143,6 +147,20 @@ typedef struct cache_inode_parameter__
   time_t grace_period_attr; /*< Cached attributes grace period */
   time_t grace_period_link; /*< Cached link grace period */
   time_t grace_period_dirent; /*< Cached dirent grace period */
+  time_t grace_period_negative; /*< How long a name found not to exist
+                                    is remembered, 0 for never */
+  uint32_t negative_cache_size; /*< Names remembered per directory */
+  time_t attr_refresh_ahead; /*< Attributes used this close to
+                                 expiry are refreshed in the
+                                 background, 0 for never */
+  time_t attr_stale_bound; /*< Attributes expired by less than this
+                               are used while refreshed in the
+                               background, 0 for never */
+  uint32_t attr_refresh_threads; /*< Threads doing background
+                                     refreshes */
+  uint32_t attr_refresh_batch; /*< Entries a thread takes from the
+                                   queue at once */
+  uint32_t attr_refresh_queue_size; /*< Entries queued at most */
   bool_t getattr_dir_invalidation; /*< Use getattr as for directory
                                        invalidation */
   bool_t use_test_access; /*< Is FSAL_test_access to be used? */
@@ -162,6 +180,47 @@ typedef struct cache_inode_opened_file__
                                   open for reading, writing, or both. */
 } cache_inode_opened_file_t;
 
+/**
+ * Sequential read detection for a file, see cache_inode_rdwr.c.  The
+ * fields are only hints, updated with atomics by the READs of the
+ * file: a READ that starts where the last one ended and swaps next
+ * with its own end takes care of ahead and window.
+ */
+
+typedef struct cache_inode_readahead__
+{
+  uint64_t next; /*< Where the last READ ended */
+  uint64_t ahead; /*< End of the range last hinted to the FSAL */
+  uint64_t window; /*< Bytes hinted ahead of the READs, 0 until the
+                       reads are sequential */
+} cache_inode_readahead_t;
+
+/**
+ * The open modes of the descriptors a file may keep besides open_fd,
+ * so that readers, unstable writers and stable writers of one file do
+ * not close each other's descriptor.
+ */
+
+typedef enum cache_inode_io_fd_mode__
+{
+  CACHE_INODE_IO_FD_READ = 0, /*< FSAL_O_RDONLY */
+  CACHE_INODE_IO_FD_WRITE = 1, /*< FSAL_O_WRONLY */
+  CACHE_INODE_IO_FD_SYNC_WRITE = 2, /*< FSAL_O_WRONLY | FSAL_O_SYNC */
+  CACHE_INODE_IO_FD_MODES = 3
+} cache_inode_io_fd_mode_t;
+
+/**
+ * A descriptor of the set, see cache_inode_io_fd_get.
+ */
+
+typedef struct cache_inode_io_fd__
+{
+  cache_inode_opened_file_t file; /*< The descriptor, FSAL_O_CLOSED if
+                                      not open */
+  uint32_t refcount; /*< I/Os in progress on it */
+  bool_t closing; /*< Closed by the last of them */
+} cache_inode_io_fd_t;
+
 /**
  * Enumeration of all cache_entry types known by cache_inode.
  */
@@ -188,7 +247,9 @@ typedef enum cache_inode_file_type__
 typedef enum io_direction__
 {
   CACHE_INODE_READ = 1, /*< Reading */
-  CACHE_INODE_WRITE = 2 /*< Writing */
+  CACHE_INODE_WRITE = 2, /*< Writing */
+  CACHE_INODE_READ_PIPE = 3 /*< Reading to splice later, the buffer is an
+                                int receiving a descriptor of the file */
 } cache_inode_io_direction_t;
 
 /**
@@ -203,12 +264,6 @@ typedef enum cache_inode_dirent_op__
   CACHE_INODE_DIRENT_OP_RENAME = 3 /*< Rename node */
 } cache_inode_dirent_op_t;
 
-typedef enum cache_inode_avl_which__
-{ CACHE_INODE_AVL_NAMES = 1,
-  CACHE_INODE_AVL_COOKIES = 2,
-  CACHE_INODE_AVL_BOTH = 3
-} cache_inode_avl_which_t;
-
 /* Flags set on cache_entry_t::flags*/
 
 static const uint32_t CACHE_INODE_TRUST_ATTRS
@@ -219,6 +274,9 @@ static const uint32_t CACHE_INODE_TRUST_CONTENT
 static const uint32_t CACHE_INODE_DIR_POPULATED
   = 0x00000004; /*< The directory has been populated (negative lookups
                   are meaningful) */
+static const uint32_t CACHE_INODE_REFRESH_QUEUED
+  = 0x00000008; /*< Queued for a background refresh of its
+                    attributes */
 
 /**
  * Structure storing cached symlink content.
@@ -264,6 +322,53 @@ typedef struct cache_inode_share__
   unsigned int share_deny_write_v4; /**< Count of v4 share deny write */
 } cache_inode_share_t;
 
+/**
+ * The parts of a REGULAR_FILE that most files never use: they are
+ * only allocated, by cache_inode_file_cold_get, when the file is
+ * first locked, shared, written to the unstable buffer, used in two
+ * open modes at once or waited on by a second committer.
+ */
+
+typedef struct cache_inode_file_cold__
+{
+  struct glist_head lock_list; /*< Pointers for lock list */
+#ifdef _USE_NLM
+  struct glist_head nlm_share_list; /**< Pointers for NLM share list */
+#endif
+  cache_inode_unstable_data_t
+    unstable_data; /*< Unstable data, for use with WRITE/COMMIT */
+  cache_inode_share_t share_state; /*< Share reservation state for
+                                       this file. */
+  pthread_mutex_t io_fds_mtx; /*< Protects io_fds */
+  cache_inode_io_fd_t io_fds[CACHE_INODE_IO_FD_MODES]; /*< Descriptors
+                                                           in the modes
+                                                           open_fd is
+                                                           not in */
+  uint32_t io_fds_open; /*< How many of them are open */
+  pthread_mutex_t commit_mtx; /*< Waiters on a running FSAL_commit */
+  pthread_cond_t commit_cond; /*< Signalled when an FSAL_commit ends */
+} cache_inode_file_cold_t;
+
+/**
+ * The dirent tree of a DIRECTORY, allocated along with the entry so
+ * that other types of entries do not carry it.  See
+ * cache_inode_dirtree.h.
+ */
+
+typedef struct cache_inode_dir_tree__
+{
+  struct cache_inode_dirtree_node *root; /**< B+-tree of the dirents,
+                                              by cookie */
+  struct cache_inode_dirtree_name *names; /**< Active dirents, by
+                                               cookie */
+  uint32_t names_bits; /**< log2 of the size of names */
+  uint32_t names_count; /**< Dirents in names */
+  struct glist_head deleted; /**< Deleted dirents, oldest first */
+  uint32_t ndeleted; /**< Length of deleted */
+  uint32_t version; /**< Bumped whenever dirents move in the tree */
+  uint32_t collisions; /**< Heuristic. Expect 0. */
+} cache_inode_dir_tree_t;
+
 /**
  * \brief Represents a cached directory entry
  *
@@ -276,7 +381,8 @@ typedef struct cache_inode_share__
 
 typedef struct cache_inode_dir_entry__
 {
-  struct avltree_node node_hk; /*< AVL node in tree */
+  struct glist_head deleted; /*< Link in the deleted dirents, while
+                                 DIR_ENTRY_FLAG_DELETED is set */
   struct {
     uint64_t k; /*< Integer cookie */
     uint32_t p; /*< Number of probes, an efficiency metric */
@@ -287,6 +393,22 @@ typedef struct cache_inode_dir_entry__
   uint32_t flags; /*< Flags */
 } cache_inode_dir_entry_t;
 
+/**
+ * Data to be used as the key into the cache_entry hash table.
+ *
+ * The hash is 0 until computed by cache_inode_fsal_data_hash, which
+ * the NFS and NLM requests do as soon as they have decoded the file
+ * handle.  Anyone else building a key must zero it, and zero it again
+ * should the descriptor change.
+ */
+
+typedef struct cache_inode_fsal_data__
+{
+  struct fsal_handle_desc fh_desc;              /**< FSAL handle descriptor  */
+  uint64_t hash; /**< Partition index and red-black tree hash of the
+                      handle, 0 if not computed */
+} cache_inode_fsal_data_t;
+
 /**
  * @brief Represents a cached inode
  *
@@ -315,7 +437,9 @@ typedef struct cache_inode_dir_entry__
  *
  * (5) state_lock must be held for WRITE when modifying state_list or
  *     lock_list.  It must be held for READ when traversing or
- *     examining the state_list or lock_list.  Operations like LRU
+ *     examining the state_list or lock_list.  The object.file.cold
+ *     pointer is set once, atomically, and stays until the entry is
+ *     cleaned, so holding state_lock is enough to read it.  Operations like LRU
  *     pinning must hold the state lock for read through the operation
  *     of moving the entry from one queue to another.
  *
@@ -335,15 +459,18 @@ typedef struct cache_inode_dir_entry__
 
 struct cache_entry_t
 {
-  fsal_handle_t handle; /*< The FSAL Handle */
-  struct fsal_handle_desc fh_desc; /*< Points to handle.  Adds size,
-                                       len for hash table etc. */
+  cache_inode_fsal_data_t fsdata; /*< Points to handle.  Adds size,
+                                      len and hash for hash table
+                                      etc.  The key of the entry in
+                                      the hash table. */
   gweakref_t weakref; /*< A weakref for this entry (pointer and generation
                           number.)  The generation number is the only
                           interesting part, but this way the weakref
                           can be easily stashed somewhere. */
   cache_inode_file_type_t type; /*< The type of the entry */
   uint32_t flags; /*< Flags for this entry */
+  uint32_t handle_size; /*< Bytes allocated to handle, one of
+                            cache_inode_handle_sizes */
   time_t change_time; /*< The time of the last operation ganesha knows
                           about.  We can ue this for change_info4, but
                           atomic MUST BE SET TO FALSE.  Don't use it
@@ -373,14 +500,13 @@ struct cache_entry_t
     {
       cache_inode_opened_file_t open_fd;/*< Cached fsal_file_t for
                                             optimized access */
-      struct glist_head lock_list; /*< Pointers for lock list */
-#ifdef _USE_NLM
-      struct glist_head nlm_share_list; /**< Pointers for NLM share list */
-#endif
-      cache_inode_unstable_data_t
-        unstable_data; /*< Unstable data, for use with WRITE/COMMIT */
-      cache_inode_share_t share_state; /*< Share reservation state for
-                                           this file. */
+      cache_inode_file_cold_t *cold; /*< Locks, shares and unstable
+                                         data, NULL until first used */
+      cache_inode_readahead_t readahead; /*< Sequential read detection */
+      uint64_t write_seq; /*< Writes done, atomic, see
+                              cache_inode_group_commit */
+      uint64_t synced_seq; /*< Writes known to be committed, atomic */
+      uint32_t commit_running; /*< An FSAL_commit is running, atomic */
     } file; /*< REGULAR_FILE data */
 
     struct cache_inode_symlink__ *symlink; /*< SYMLINK data */
@@ -393,15 +519,18 @@ struct cache_entry_t
                           'referral string' */
       gweakref_t parent; /*< The parent of this directory
                              ('..') */
-      struct {
-          struct avltree t;                     /**< Children */
-          struct avltree c;                     /**< Persist cookies */
-          uint32_t collisions;                  /**< Heuristic. Expect 0. */
-      } avl;
+      cache_inode_dir_tree_t *tree; /*< Cached dirents */
+      struct cache_inode_negative *negative; /*< Names known not to
+                                                 exist, NULL until the
+                                                 first one */
+      uint32_t negative_gen; /*< Bumped whenever names may have
+                                 appeared */
     } dir; /*< DIRECTORY data */
   } object; /*< Filetype specific data, discriminated by the type
                 field.  Note that data for special files is in
                 attributes.rawdev */
+  fsal_handle_t handle; /*< The FSAL Handle.  Must stay last: only
+                            handle_size bytes of it are allocated. */
 };
 
 typedef struct cache_inode_file__ cache_inode_file_t;
@@ -409,21 +538,27 @@ typedef struct cache_inode_symlink__ cache_inode_symlink_t;
 typedef union cache_inode_fsobj__ cache_inode_fsobj_t;
 
 /**
- * Data to be used as the key into the cache_entry hash table.
+ * @brief Room given to the handle of an entry
+ *
+ * When the FSAL reads no byte of a handle past its length
+ * (FSAL_HandleExactLen), an entry comes from the pool of the smallest
+ * of these sizes holding its handle, otherwise from that of a whole
+ * fsal_handle_t, the last size.
  */
+#define CACHE_INODE_HANDLE_SIZES 3
 
-typedef struct cache_inode_fsal_data__
-{
-  struct fsal_handle_desc fh_desc;              /**< FSAL handle descriptor  */
-} cache_inode_fsal_data_t;
+extern const size_t cache_inode_handle_sizes[CACHE_INODE_HANDLE_SIZES];
 
 /**
  * Global memory pools for cached data
  */
 
-extern pool_t *cache_inode_entry_pool; /*< Cache entries pool */
+extern pool_t *cache_inode_entry_pools[CACHE_INODE_HANDLE_SIZES];
+                                /*< Cache entries pools, by handle size */
 extern pool_t *cache_inode_symlink_pool; /*< Pool for SYMLINK data */
 extern pool_t *cache_inode_dir_entry_pool; /*< Cached dir entry pool */
+extern pool_t *cache_inode_file_cold_pool; /*< Pool for locked files */
+extern pool_t *cache_inode_dir_tree_pool; /*< Pool for dirent trees */
 
 /**
  * Configuration parameters for garbage collection/LRU policy
@@ -605,6 +740,13 @@ const char *cache_inode_err_str(cache_inode_status_t err);
 void cache_inode_clean_entry(cache_entry_t *entry);
 int cache_inode_compare_key_fsal(hash_buffer_t *buff1, hash_buffer_t *buff2);
 void cache_inode_release_symlink(cache_entry_t *entry);
+cache_inode_file_cold_t *cache_inode_file_cold_get(cache_entry_t *entry);
+void cache_inode_release_file_cold(cache_entry_t *entry);
+void cache_inode_release_dir_tree(cache_entry_t *entry);
+void cache_inode_memory_get_stats(size_t *entry_size,
+                                  size_t *embedded_size,
+                                  uint64_t *files_cold,
+                                  uint64_t *dirs);
 
 hash_table_t *cache_inode_init(cache_inode_parameter_t param,
                                cache_inode_status_t * status);
@@ -644,6 +786,13 @@ cache_inode_status_t cache_inode_open(cache_entry_t *entry,
 cache_inode_status_t cache_inode_close(cache_entry_t *entry,
                                        uint32_t flags,
                                        cache_inode_status_t *status);
+cache_inode_status_t cache_inode_io_fd_get(cache_entry_t *entry,
+                                           fsal_openflags_t openflags,
+                                           fsal_op_context_t *context,
+                                           fsal_file_t **fd,
+                                           cache_inode_status_t *status);
+void cache_inode_io_fd_put(cache_entry_t *entry, fsal_file_t *fd);
+void cache_inode_close_io_fds(cache_entry_t *entry);
 
 cache_entry_t *cache_inode_create(cache_entry_t *entry_parent,
                                   fsal_name_t *name,
@@ -772,7 +921,12 @@ cache_inode_status_t cache_inode_rdwr(cache_entry_t *entry,
                                       bool_t *eof,
                                       fsal_op_context_t *context,
                                       cache_inode_stability_t stable,
+                                      size_t readahead,
                                       cache_inode_status_t *status);
+void cache_inode_readahead_get_stats(uint64_t *sequential,
+                                     uint64_t *hits,
+                                     uint64_t *hints,
+                                     uint64_t *hinted_bytes);
 
 static inline cache_inode_status_t
 cache_inode_read(cache_entry_t *entry,
@@ -787,7 +941,7 @@ cache_inode_read(cache_entry_t *entry,
 {
   return cache_inode_rdwr(entry, CACHE_INODE_READ, offset, io_size,
                           bytes_moved, buffer, eof, context,
-                          stable, status);
+                          stable, 0, status);
 }
 
 static inline cache_inode_status_t
@@ -803,9 +957,12 @@ cache_inode_write(cache_entry_t *entry,
 {
   return cache_inode_rdwr(entry, CACHE_INODE_WRITE, offset, io_size,
                           bytes_moved, buffer, eof, context,
-                          stable, status);
+                          stable, 0, status);
 }
 
+fsal_status_t cache_inode_group_commit(cache_entry_t *entry,
+                                       fsal_file_t *fd);
+void cache_inode_commit_get_stats(uint64_t *requested, uint64_t *fsal);
 cache_inode_status_t cache_inode_commit(cache_entry_t *entry,
                                         uint64_t offset,
                                         size_t count,
@@ -838,6 +995,9 @@ cache_entry_t *cache_inode_make_root(cache_inode_fsal_data_t *fsdata,
 
 cache_inode_status_t cache_inode_check_trust(cache_entry_t *entry,
                                              fsal_op_context_t *context);
+cache_inode_status_t cache_inode_revalidate(cache_entry_t *entry,
+                                            fsal_op_context_t *context,
+                                            time_t period);
 
 cache_inode_file_type_t cache_inode_fsal_type_convert(fsal_nodetype_t type);
 
@@ -858,8 +1018,7 @@ cache_inode_status_t cache_inode_invalidate_all_cached_dirent(
      cache_entry_t *entry,
      cache_inode_status_t *status);
 
-void cache_inode_release_dirents(cache_entry_t *entry,
-                                 cache_inode_avl_which_t which);
+void cache_inode_release_dirents(cache_entry_t *entry);
 
 void cache_inode_kill_entry(cache_entry_t *entry);
 
@@ -901,6 +1060,10 @@ int cache_inode_fsal_rbt_both(hash_parameter_t *p_hparam,
                               hash_buffer_t *buffclef,
                               uint32_t *phashval,
                               uint64_t *prbtval);
+int cache_inode_fsal_data_hash(cache_inode_fsal_data_t *fsdata);
+unsigned int cache_inode_handle_class(size_t len);
+size_t cache_inode_fsal_flatten(hash_buffer_t *buffclef,
+                                char *flat, size_t size);
 int display_key(hash_buffer_t *pbuff, char *str);
 int display_not_implemented(hash_buffer_t *pbuff,
                             char *str);
@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2012, The Linux Box Corporation
+ * All Rights Reserved
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ *
+ * \file cache_inode_dirtree.h
+ * \brief Definitions supporting the B+-tree dirent representation
+ *
+ * \section DESCRIPTION
+ *
+ * The dirents of a directory are kept in a B+-tree ordered by cookie.
+ * The cookie of a name is a collision-resistent hash of it
+ * (currently, Murmur3), quadratic probing being used on the rare
+ * collisions to emulate perfect hashing.  Leaves pack many cookies
+ * and dirent pointers contiguously and are chained in cookie order,
+ * so that a readdir walks them sequentially.
+ *
+ * Removed names stay in the tree, marked deleted, so that a readdir
+ * resuming from their cookie goes on from the next name; the oldest
+ * of them are dropped past a bound.  Active dirents are also found by
+ * cookie in an open addressing hash table, so that a lookup by name
+ * costs a hash and a probe or two rather than a descent of the tree.
+ *
+ * Dirents are allocated one by one and never move, so that a dirent
+ * pointer stays valid for as long as the directory content lock is
+ * held and the dirent is not removed.
+ *
+ */
+
+#ifndef _CACHE_INODE_DIRTREE_H
+#define _CACHE_INODE_DIRTREE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+
+#ifdef _SOLARIS
+#include "solaris_port.h"
+#endif                          /* _SOLARIS */
+
+#include "log.h"
+#include "cache_inode.h"
+
+/**
+ * @brief Position of a readdir in the tree
+ *
+ * A cursor is only valid while the directory content lock is held.
+ * It survives insertions and removals made meanwhile (by a lookup
+ * under the same lock, for instance): it then finds its place again
+ * by cookie.
+ */
+
+typedef struct cache_inode_dir_cursor__
+{
+    struct cache_inode_dirtree_node *leaf; /*< Current leaf */
+    uint32_t pos; /*< Position in the leaf */
+    uint32_t version; /*< Version of the tree leaf and pos refer to */
+    uint64_t cookie; /*< Cookie of the last dirent returned */
+} cache_inode_dir_cursor_t;
+
+void cache_inode_dirtree_init(cache_entry_t *entry);
+int cache_inode_dirtree_insert(cache_entry_t *entry,
+                               cache_inode_dir_entry_t *v,
+                               cache_inode_dir_entry_t **dirent);
+cache_inode_dir_entry_t *cache_inode_dirtree_lookup_name(
+    cache_entry_t *entry,
+    fsal_name_t *name);
+void cache_inode_dirtree_set_deleted(cache_entry_t *entry,
+                                     cache_inode_dir_entry_t *v);
+void cache_inode_dirtree_release(cache_entry_t *entry);
+
+#define CACHE_INODE_FLAG_NEXT_ACTIVE     0x0001
+
+cache_inode_dir_entry_t *cache_inode_dirtree_first(
+    cache_entry_t *entry,
+    cache_inode_dir_cursor_t *cursor);
+cache_inode_dir_entry_t *cache_inode_dirtree_seek(
+    cache_entry_t *entry,
+    uint64_t k,
+    uint32_t flags,
+    cache_inode_dir_cursor_t *cursor);
+cache_inode_dir_entry_t *cache_inode_dirtree_next(
+    cache_entry_t *entry,
+    cache_inode_dir_cursor_t *cursor);
+
+#endif /* _CACHE_INODE_DIRTREE_H */
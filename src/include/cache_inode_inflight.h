@@ -0,0 +1,71 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_inflight.h
+ * @brief  Coalescing of concurrent cache misses
+ *
+ * When many threads miss on the same object at once, only the first
+ * one should go to the FSAL.  A thread missing in the cache registers
+ * the object it is about to fetch, identified by its handle for
+ * cache_inode_get or by its parent and name for a lookup.  If another
+ * thread already registered the same object, the caller waits for it
+ * to finish instead, then finds the entry in the cache.
+ *
+ * Failures are passed on to the waiters only when they do not depend
+ * on the credentials of the thread that did the work (a stale handle,
+ * a name that does not exist).  Otherwise the waiters do their own
+ * call.
+ */
+
+#ifndef _CACHE_INODE_INFLIGHT_H
+#define _CACHE_INODE_INFLIGHT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cache_inode.h"
+
+typedef struct cache_inode_inflight cache_inode_inflight_t;
+
+typedef enum cache_inode_inflight_role
+{
+  CACHE_INODE_INFLIGHT_LEAD, /*< Do the work, then call
+                                 cache_inode_inflight_end */
+  CACHE_INODE_INFLIGHT_WAITED, /*< Another thread did it, the status
+                                   is its result */
+  CACHE_INODE_INFLIGHT_ALONE /*< Do the work, nothing to report */
+} cache_inode_inflight_role_t;
+
+void cache_inode_inflight_init(void);
+cache_inode_inflight_role_t
+cache_inode_inflight_begin(cache_entry_t *parent,
+                           const void *key, size_t len,
+                           cache_inode_inflight_t **inflight,
+                           cache_inode_status_t *status);
+void cache_inode_inflight_end(cache_inode_inflight_t *inflight,
+                              cache_inode_status_t status);
+void cache_inode_inflight_get_stats(uint64_t *get_lead,
+                                    uint64_t *get_coalesced,
+                                    uint64_t *lookup_lead,
+                                    uint64_t *lookup_coalesced);
+
+#endif /* _CACHE_INODE_INFLIGHT_H */
@@ -64,6 +64,16 @@
  * under ordinary circumstances, so are kept on a separate lru_pinned
  * list to retain constant time.
  *
+ * Replacement is adaptive, after CAR [Bansal and Modha 2004], itself
+ * a clock version of ARC [Megiddo and Modha 2003].  New entries go to
+ * L1, entries used again to L2.  A use only sets a bit in the entry;
+ * the reclaim examines the cold end of a queue, moves an entry whose
+ * bit is set to the warm end of L2, and evicts one whose bit is clear.
+ * It evicts from L1 while L1 is above a target size, which the
+ * entries evicted lately and coming back move up or down.  A scan
+ * touching many entries once fills L1 only, and the entries used
+ * repeatedly survive it in L2.
+ *
  */
 
 struct lru_state
@@ -101,7 +111,7 @@ static const uint32_t LRU_FLAG_NONE = 0x0000;
 static const uint32_t LRU_ENTRY_PINNED = 0x0001;
 
 /**
- * Set on LRU entries in the L2 (scanned and colder) queue.
+ * Set on LRU entries in the L2 (used more than once) queue.
  */
 static const uint32_t LRU_ENTRY_L2 = 0x0002;
 
@@ -158,11 +168,13 @@ static const uint32_t LRU_NO_LANE = ~0;
 
 extern void cache_inode_lru_pkginit(void);
 extern void cache_inode_lru_pkgshutdown(void);
+extern void cache_inode_lru_invalidate_all(void);
 
 extern size_t open_fd_count;
 
 extern struct cache_entry_t *cache_inode_lru_get(cache_inode_status_t *status,
-                                                 uint32_t flags);
+                                                 uint32_t flags,
+                                                 size_t handle_len);
 extern cache_inode_status_t cache_inode_lru_ref(
      cache_entry_t *entry,
      uint32_t flags) __attribute__((warn_unused_result));
@@ -173,6 +185,25 @@ extern void lru_wake_thread(uint32_t flags);
 extern cache_inode_status_t cache_inode_inc_pin_ref(cache_entry_t *entry);
 extern void cache_inode_unpinnable(cache_entry_t *entry);
 extern cache_inode_status_t cache_inode_dec_pin_ref(cache_entry_t *entry);
+extern void cache_inode_lru_admit(cache_entry_t *entry);
+
+/**
+ * Use and replacement counts of the LRU
+ */
+
+struct cache_inode_lru_stats
+{
+     uint64_t hits; /*< Initial references to cached entries */
+     uint64_t misses; /*< Entries admitted into the cache */
+     uint64_t promotions; /*< Entries moved from L1 to L2 */
+     uint64_t evictions_l1; /*< Entries evicted from L1 */
+     uint64_t evictions_l2; /*< Entries evicted from L2 */
+     uint64_t ghost_hits_l1; /*< Admitted entries evicted lately from L1 */
+     uint64_t ghost_hits_l2; /*< Admitted entries evicted lately from L2 */
+     uint64_t target_l1; /*< Current target size of L1 */
+};
+
+extern void cache_inode_lru_get_stats(struct cache_inode_lru_stats *stats);
 
 /**
  * Return TRUE if there are FDs available to serve open requests,
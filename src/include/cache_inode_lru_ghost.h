@@ -0,0 +1,77 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_lru_ghost.h
+ * @brief  Entries recently evicted from the cache inode LRU
+ *
+ * The LRU keeps entries used once since they were cached in L1, and
+ * entries used again in L2.  It remembers the entries it evicted
+ * lately from either queue by the hash of their handle.  An entry
+ * coming back while still remembered shows which queue was given too
+ * little room, and the target size of L1 is moved accordingly, as in
+ * ARC [Megiddo and Modha 2003].
+ *
+ * Only hashes are kept, in a set-associative table where the oldest
+ * slot of a set makes room, so that the memory used is bounded and
+ * nothing refers to the evicted entries.  The table does not depend
+ * on cache entries, so that test/test_lru_sim runs the same code as
+ * the server.
+ */
+
+#ifndef _CACHE_INODE_LRU_GHOST_H
+#define _CACHE_INODE_LRU_GHOST_H
+
+#include <stdint.h>
+
+/* Queue an entry was evicted from */
+#define LRU_GHOST_NONE 0
+#define LRU_GHOST_L1   1
+#define LRU_GHOST_L2   2
+
+typedef struct lru_ghost lru_ghost_t;
+
+lru_ghost_t *lru_ghost_create(uint64_t capacity);
+void lru_ghost_destroy(lru_ghost_t *ghost);
+void lru_ghost_add(lru_ghost_t *ghost, uint64_t hash, uint32_t queue);
+uint32_t lru_ghost_take(lru_ghost_t *ghost, uint64_t hash);
+uint64_t lru_ghost_adapt(lru_ghost_t *ghost, uint32_t queue,
+                         uint64_t target, uint64_t capacity);
+void lru_ghost_sizes(lru_ghost_t *ghost, uint64_t *l1, uint64_t *l2);
+
+/**
+ * @brief Tell which queue to evict from
+ *
+ * @param[in] l1     Entries in L1
+ * @param[in] l2     Entries in L2
+ * @param[in] target Target size of L1
+ *
+ * @return Non-zero to evict from L1, zero to evict from L2.
+ */
+
+static inline int
+lru_ghost_evict_l1(uint64_t l1, uint64_t l2, uint64_t target)
+{
+     return (l1 > 0) && ((l1 > target) || (l2 == 0));
+}
+
+#endif /* _CACHE_INODE_LRU_GHOST_H */
@@ -0,0 +1,60 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_negative.h
+ * @brief  Names known not to exist in a directory
+ *
+ * A directory whose content is not fully cached can only answer a
+ * lookup for a missing name by asking the FSAL.  Each directory
+ * therefore remembers, for Negative_Expiration_Time seconds, the
+ * hashes of the last Negative_Cache_Size names the FSAL said did not
+ * exist.
+ *
+ * A name is forgotten when it is created, linked or renamed to
+ * locally.  Everything is forgotten whenever the directory content is
+ * invalidated, as on an FSAL_UP event.  A generation count on the
+ * directory keeps a lookup racing one of these from remembering a
+ * name that has just appeared.
+ */
+
+#ifndef _CACHE_INODE_NEGATIVE_H
+#define _CACHE_INODE_NEGATIVE_H
+
+#include <stdint.h>
+#include "cache_inode.h"
+
+uint32_t cache_inode_negative_gen(cache_entry_t *directory);
+bool_t cache_inode_negative_lookup(cache_entry_t *directory,
+                                   fsal_name_t *name);
+void cache_inode_negative_insert(cache_entry_t *directory,
+                                 fsal_name_t *name,
+                                 uint32_t gen);
+void cache_inode_negative_remove(cache_entry_t *directory,
+                                 fsal_name_t *name);
+void cache_inode_negative_flush(cache_entry_t *directory);
+void cache_inode_negative_release(cache_entry_t *directory);
+void cache_inode_negative_get_stats(uint64_t *hits, uint64_t *misses,
+                                    uint64_t *inserts,
+                                    uint64_t *invalidations);
+
+#endif /* _CACHE_INODE_NEGATIVE_H */
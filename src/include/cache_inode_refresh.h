@@ -0,0 +1,58 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   cache_inode_refresh.h
+ * @brief  Background refresh of cached attributes
+ *
+ * An entry whose attributes are used within Attr_Refresh_Ahead
+ * seconds of their expiration is queued, and a pool of threads
+ * refreshes the queue in batches, so that the entry is seldom found
+ * expired on the request path.  An entry found expired by less than
+ * Attr_Stale_Bound seconds is served as it is while it is queued
+ * likewise, rather than refreshed by the request that found it.
+ *
+ * Every queued entry holds a reference and the FSAL credentials of
+ * the request that queued it, which are those the refresh is done
+ * with.  An entry is queued at most once at a time.
+ */
+
+#ifndef _CACHE_INODE_REFRESH_H
+#define _CACHE_INODE_REFRESH_H
+
+#include <stdint.h>
+#include "cache_inode.h"
+
+void cache_inode_refresh_pkginit(void);
+void cache_inode_refresh_pkgshutdown(void);
+bool_t cache_inode_refresh_queue(cache_entry_t *entry,
+                                 fsal_op_context_t *context);
+void cache_inode_refresh_hint(cache_entry_t *entry,
+                              fsal_op_context_t *context);
+void cache_inode_refresh_note_stale(void);
+void cache_inode_refresh_get_stats(uint64_t *queued,
+                                   uint64_t *refused,
+                                   uint64_t *refreshed,
+                                   uint64_t *batches,
+                                   uint64_t *stale_served);
+
+#endif /* _CACHE_INODE_REFRESH_H */
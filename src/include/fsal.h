@@ -652,6 +652,19 @@ fsal_status_t FSAL_read(fsal_file_t * file_descriptor,  /*  IN  */
                         fsal_boolean_t * end_of_file    /* OUT  */
     );
 
+fsal_status_t FSAL_read_splice(fsal_file_t * file_descriptor,   /*  IN  */
+                               fsal_seek_t * seek_descriptor,   /* [IN] */
+                               fsal_size_t read_size,   /*  IN  */
+                               int * file_fd,   /* OUT  */
+                               fsal_size_t * read_amount,       /* OUT  */
+                               fsal_boolean_t * end_of_file     /* OUT  */
+    );
+
+fsal_status_t FSAL_read_hint(fsal_file_t * file_descriptor,     /*  IN  */
+                             fsal_off_t offset, /*  IN  */
+                             fsal_size_t length /*  IN  */
+    );
+
 fsal_status_t FSAL_write(fsal_file_t * file_descriptor, /* IN */
                          fsal_op_context_t * p_context,  /* IN */
                          fsal_seek_t * seek_descriptor, /* IN */
@@ -758,6 +771,8 @@ fsal_status_t FSAL_UP_GetEvents(struct glist_head * pevent_head,           /* OU
                                 fsal_count_t * peventfound,                /* OUT */
                                 struct fsal_up_event_bus_context_t_ * pupebcontext /* IN */
                                 );
+fsal_status_t FSAL_UP_Shutdown(struct fsal_up_event_bus_context_t_ * pupebcontext /* INOUT */
+                               );
 #endif /* _USE_FSAL_UP */
 
 /* To be called before exiting */
@@ -1463,6 +1478,7 @@ typedef struct fsal_functions__
                                   fsal_time_t timeout,                       /* IN */
                                     fsal_count_t * peventfound,                 /* OUT */
                                   struct fsal_up_event_bus_context_t_ * pupebcontext /* IN */ );
+  fsal_status_t(*fsal_up_shutdown)(struct fsal_up_event_bus_context_t_ * pupebcontext /* INOUT */ );
 #endif /* _USE_FSAL_UP */
 
   fsal_status_t (*fsal_share_op)( fsal_file_t            * p_file_descriptor,   /* IN */
@@ -1470,6 +1486,20 @@ typedef struct fsal_functions__
                                   fsal_op_context_t      * p_context,           /* IN */
                                   void                   * p_owner,             /* IN (opaque to FSAL) */
                                   fsal_share_param_t       request_share        /* IN */ );
+
+  /* FSAL_read_splice, optional: size a read and give a descriptor of the
+     file, for the caller to splice the data itself */
+  fsal_status_t(*fsal_read_splice) (fsal_file_t * p_file_descriptor,    /* IN */
+                                    fsal_seek_t * p_seek_descriptor,    /* [IN] */
+                                    fsal_size_t read_size,      /* IN */
+                                    int * p_file_fd,    /* OUT */
+                                    fsal_size_t * p_read_amount,        /* OUT */
+                                    fsal_boolean_t * p_end_of_file /* OUT */ );
+
+  /* FSAL_read_hint, optional: tell that a range will be read soon */
+  fsal_status_t(*fsal_read_hint) (fsal_file_t * p_file_descriptor,      /* IN */
+                                  fsal_off_t offset,    /* IN */
+                                  fsal_size_t length /* IN */ );
 } fsal_functions_t;
 
 /* Structure allow assignement, char[<n>] do not */
@@ -1483,15 +1513,20 @@ typedef struct fsal_const__
   unsigned int fsal_cred_t_size;
   unsigned int fs_specific_initinfo_t_size;
   unsigned int fsal_dir_t_size;
+  unsigned int fsal_handle_exact_len;   /* The FSAL reads no byte of a handle
+                                         * past the length FSAL_ExpandHandle
+                                         * gives it */
 } fsal_const_t;
 
 int FSAL_LoadLibrary(char *path);
 
 fsal_functions_t FSAL_GetFunctions(void);
 void FSAL_LoadFunctions(void);
+void FSAL_StackFunctions(fsal_functions_t (*layer) (fsal_functions_t lower));
 
 fsal_const_t FSAL_GetConsts(void);
 void FSAL_LoadConsts(void);
+fsal_boolean_t FSAL_HandleExactLen(void);
 
 #endif                          /* ! _USE_SWIG */
 
@@ -0,0 +1,113 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+#ifndef _FSAL_FAULT_SHIM_H
+#define _FSAL_FAULT_SHIM_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+
+#include "fsal.h"
+
+/**
+ *
+ * \file fsal_fault_shim.h
+ * \brief Latency and fault injection layer over the FSAL
+ *
+ * \section DESCRIPTION
+ *
+ * The shim stacks over the loaded FSAL functions and, for each of the
+ * operations it intercepts, can delay the call by a latency drawn from a
+ * distribution, hold it in a stall until released, or fail it with a
+ * given FSAL error at a given rate.  It is driven live over DBus, at
+ * /org/ganesha/nfsd/FSALShim, so that a lab can make one backend slow or
+ * flaky under load and watch the worker pool and timeouts cope.
+ *
+ * Nothing is injected until a rule is set: an idle shim costs one test
+ * per call.
+ *
+ */
+
+typedef enum fsal_shim_op__
+{
+  FSAL_SHIM_LOOKUP = 0,
+  FSAL_SHIM_GETATTRS,
+  FSAL_SHIM_SETATTRS,
+  FSAL_SHIM_ACCESS,
+  FSAL_SHIM_CREATE,
+  FSAL_SHIM_MKDIR,
+  FSAL_SHIM_LINK,
+  FSAL_SHIM_RENAME,
+  FSAL_SHIM_UNLINK,
+  FSAL_SHIM_SYMLINK,
+  FSAL_SHIM_READLINK,
+  FSAL_SHIM_OPENDIR,
+  FSAL_SHIM_READDIR,
+  FSAL_SHIM_CLOSEDIR,
+  FSAL_SHIM_OPEN,
+  FSAL_SHIM_READ,
+  FSAL_SHIM_WRITE,
+  FSAL_SHIM_COMMIT,
+  FSAL_SHIM_CLOSE,
+  FSAL_SHIM_TRUNCATE,
+  FSAL_SHIM_LOCK_OP,
+  FSAL_SHIM_NB_OP
+} fsal_shim_op_t;
+
+/* Rule setters take an fsal_shim_op_t, or this for every operation */
+#define FSAL_SHIM_ALL_OPS -1
+
+typedef enum fsal_shim_latency__
+{
+  FSAL_SHIM_LATENCY_NONE = 0,
+  FSAL_SHIM_LATENCY_FIXED,      /* always param1 usec */
+  FSAL_SHIM_LATENCY_LOGNORMAL,  /* median param1 usec, sigma param2 */
+  FSAL_SHIM_LATENCY_PARETO      /* at least param1 usec, shape param2 */
+} fsal_shim_latency_t;
+
+/* No injected delay lasts longer than this, however heavy the tail */
+#define FSAL_SHIM_MAX_DELAY_USEC 60000000ULL
+
+typedef struct fsal_shim_stats__
+{
+  uint64_t calls;
+  uint64_t errors;              /* failures injected */
+  uint64_t delayed_usec;        /* latency injected */
+  uint64_t stalls;              /* calls that waited in a stall */
+} fsal_shim_stats_t;
+
+void fsal_shim_pkginit(void);
+#ifdef USE_DBUS
+void fsal_shim_dbus_pkginit(void);
+#endif
+
+const char *fsal_shim_op_name(fsal_shim_op_t op);
+int fsal_shim_op_by_name(const char *name);
+
+int fsal_shim_set_latency(int op, fsal_shim_latency_t dist,
+                          double param1, double param2);
+int fsal_shim_set_errors(int op, uint32_t per_million, fsal_errors_t error);
+int fsal_shim_stall(int op, uint32_t msec);
+int fsal_shim_release(int op);
+int fsal_shim_clear(int op);
+void fsal_shim_get_stats(fsal_shim_op_t op, fsal_shim_stats_t * p_stats);
+
+#endif                          /* _FSAL_FAULT_SHIM_H */
@@ -137,7 +137,7 @@ typedef struct fsal_staticfsinfo_t fsal_staticfsinfo_t;
 #define INDEX_FSAL_UP_init              55
 #define INDEX_FSAL_UP_addfilter         56
 #define INDEX_FSAL_UP_getevents         57
-#define INDEX_FSAL_unused_58            58
+#define INDEX_FSAL_UP_shutdown          58
 #define INDEX_FSAL_layoutget            59
 #define INDEX_FSAL_layoutreturn         60
 #define INDEX_FSAL_layoutcommit         61
@@ -295,6 +295,8 @@ static const fsal_name_t FSAL_DOT_DOT = { "..", 2 };
 #include "FSAL/FSAL_ZFS/fsal_types.h"
 #elif defined ( _USE_CEPH )
 #include "FSAL/FSAL_CEPH/fsal_types.h"
+#elif defined ( _USE_MEM )
+#include "FSAL/FSAL_MEM/fsal_types.h"
 #elif defined ( _USE_TEMPLATE ) /* <- place here your own define */
 #include "FSAL/FSAL_TEMPLATE/fsal_types.h"
 #else                           /* no _USE_<filesystem> flag ! */
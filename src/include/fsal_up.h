@@ -46,6 +46,7 @@
 #define FSAL_UP_EVENT_SETATTR    11
 #define FSAL_UP_EVENT_UPDATE     12
 #define FSAL_UP_EVENT_INVALIDATE 13
+#define FSAL_UP_EVENT_INVALIDATE_ALL 14 /* Changes were lost: no handle */
 
 /* Defines for the flags in callback_arg, keep up to date with CXIUP_xxx */
 #define FSAL_UP_NLINK        0x00000001   /* update nlink */
@@ -74,6 +75,7 @@ typedef struct fsal_up_event_bus_context_t_
   fsal_export_context_t FS_export_context;
   pool_t *event_pool;
   pthread_mutex_t *event_pool_lock;
+  void *fsal_data; /* Private to the FSAL, set by FSAL_UP_Init */
 } fsal_up_event_bus_context_t;
 
 typedef struct fsal_up_event_data_context_t_
@@ -170,6 +172,10 @@ typedef struct fsal_up_event_t_
   fsal_up_event_process_func_t   * event_process_func;
   unsigned int event_type;
   fsal_up_event_data_t event_data;
+  /* Set when queued for processing */
+  uint32_t event_hash;             /* Of the file handle, picks the queue */
+  struct glist_head event_pending; /* Among queued events of same hash */
+  uint64_t event_queued;           /* Time queued, in msec */
 } fsal_up_event_t;
 
 typedef struct fsal_up_event_functions__
@@ -187,10 +193,25 @@ typedef struct fsal_up_event_functions__
   fsal_status_t (*fsal_up_setattr) (fsal_up_event_data_t * pevdata );
   fsal_status_t (*fsal_up_update) (fsal_up_event_data_t * pevdata );
   fsal_status_t (*fsal_up_invalidate) (fsal_up_event_data_t * pevdata );
+  fsal_status_t (*fsal_up_invalidate_all) (fsal_up_event_data_t * pevdata );
 } fsal_up_event_functions_t;
 
 #define FSAL_UP_DUMB_TYPE "DUMB"
 fsal_up_event_functions_t *get_fsal_up_dumb_functions();
 
+struct fsal_up_process_stats
+{
+  uint64_t queued;     /* Events queued for processing */
+  uint64_t coalesced;  /* Events dropped, repeating a queued one */
+  uint64_t processed;  /* Events processed */
+  uint64_t batches;    /* Batches they were processed in */
+  uint32_t depth;      /* Events queued now */
+  uint32_t max_depth;  /* Longest any queue has been */
+  uint64_t lag;        /* Time the oldest queued event waited, msec */
+  uint64_t max_lag;    /* Longest time any event waited, msec */
+};
+
+void fsal_up_process_get_stats(struct fsal_up_process_stats *stats);
+
 #endif /* _USE_FSAL_UP */
 #endif /* _FSAL_UP_H */
@@ -19,6 +19,7 @@
 #include  <rpc/svc_dplx.h>
 
 #include "HashTable.h"
+#include "nfs_numa.h"
 
 void socket_setoptions(int socketFd);
 
@@ -99,12 +100,14 @@ const char *str_gc_proc(rpc_gss_proc_t gc_proc);
 #define XPRT_PRIVATE_FLAG_DESTROYED  0x0001 /* forward destroy */
 #define XPRT_PRIVATE_FLAG_LOCKED     0x0002
 #define XPRT_PRIVATE_FLAG_REF        0x0004
+#define XPRT_PRIVATE_FLAG_STREAM     0x0008 /* connected TCP stream */
 
 typedef struct gsh_xprt_private
 {
     uint32_t flags;
     uint32_t refcnt;
     uint32_t multi_cnt; /* multi-dispatch counter */
+    uint32_t numa_node; /* NUMA node index serving this xprt */
 } gsh_xprt_private_t;
 
 static inline gsh_xprt_private_t *
@@ -114,6 +117,7 @@ alloc_gsh_xprt_private(uint32_t flags)
 
     xu->flags = 0;
     xu->multi_cnt = 0;
+    xu->numa_node = NFS_NUMA_NODE_ANY;
 
     if (flags & XPRT_PRIVATE_FLAG_REF)
         xu->refcnt = 1;
@@ -38,6 +38,10 @@
  * reference counting guarantees, eviction safety, and access restrictions
  * using ordinary object addresses.
  *
+ * A weak reference names the slot of the object in the table and the
+ * generation of the slot when the object was inserted; it is found in
+ * constant time and stops matching once the object is deleted.
+ *
  */
 
 #ifndef _GENERIC_WEAKREF_H
@@ -47,16 +51,17 @@
 typedef struct gweakref_
 {
     void *ptr;
-    uint64_t gen;
+    uint64_t gen; /*< Generation of the slot, 0 for no object */
+    uint32_t slot; /*< Slot of the object in the table */
 } gweakref_t;
 
 typedef struct gweakref_table_ gweakref_table_t;
 
-gweakref_table_t *gweakref_init(uint32_t npart, uint32_t cache_sz);
+gweakref_table_t *gweakref_init(uint32_t npart);
 gweakref_t gweakref_insert(gweakref_table_t *wt, void *obj);
 void *gweakref_lookup(gweakref_table_t *wt, gweakref_t *ref);
-void *gweakref_lookupex(gweakref_table_t *wt, gweakref_t *ref,
-                        pthread_rwlock_t **lock);
+void *gweakref_lookupex(gweakref_table_t *wt, gweakref_t *ref);
+void gweakref_release(gweakref_table_t *wt, gweakref_t *ref);
 void gweakref_delete(gweakref_table_t *wt, gweakref_t *ref);
 void gweakref_destroy(gweakref_table_t *wt);
 
@@ -0,0 +1,74 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_arena.h
+ * @brief  Per-request bump allocator
+ *
+ * An arena hands out memory by bumping a pointer in fixed-size
+ * chunks taken from a slab pool.  Nothing is ever freed individually:
+ * everything allocated from an arena is released at once by
+ * nfs_arena_free.  Requests larger than a chunk get a dedicated heap
+ * block, released along with the rest.
+ *
+ * The NFSv4 COMPOUND gives each request an arena (see
+ * compound_data_t) from which the results of the operations are
+ * allocated.  The arena is stored in the result and released with
+ * it, so results kept by the duplicate request cache or by a session
+ * slot keep their memory until they are discarded.
+ */
+
+#ifndef _NFS_ARENA_H
+#define _NFS_ARENA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef struct nfs_arena nfs_arena_t;
+
+/* Size of the chunks of an arena, the first one holds the arena */
+#define NFS_ARENA_CHUNK_SIZE 8192
+
+void nfs_arena_pkginit(void);
+nfs_arena_t *nfs_arena_new(void);
+void *nfs_arena_alloc(nfs_arena_t *arena, size_t size);
+void nfs_arena_free(nfs_arena_t *arena);
+
+/* Counts given by clients may come here, the product is checked as
+   calloc would */
+static inline void *
+nfs_arena_calloc(nfs_arena_t *arena, size_t nmemb, size_t size)
+{
+  void *ptr;
+
+  if(nmemb != 0 && size > SIZE_MAX / nmemb)
+    return NULL;
+
+  ptr = nfs_arena_alloc(arena, nmemb * size);
+
+  if(ptr != NULL)
+    memset(ptr, 0, nmemb * size);
+  return ptr;
+}
+
+#endif /* _NFS_ARENA_H */
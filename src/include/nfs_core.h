@@ -49,12 +49,14 @@
 #include "cache_inode.h"
 #include "nfs_stat.h"
 #include "external_tools.h"
+#include "nfs_numa.h"
 
 #include "nfs23.h"
 #include "nfs4.h"
 #include "mount.h"
 #include "nfs_proto_functions.h"
 #include "nfs_dupreq.h"
+#include "nfs_read_splice.h"
 #include "err_LRU_List.h"
 #include "err_HashTable.h"
 
@@ -77,7 +79,12 @@
 #define NB_WORKER_THREAD_DEFAULT  16
 #define NB_FLUSHER_THREAD_DEFAULT 16
 #define NB_REQUEST_BEFORE_QUEUE_AVG  1000
+#define NB_SLOW_WORKER_DEFAULT 0
+#define SLOW_IO_SIZE_DEFAULT (256 * 1024)
+#define SLOW_READDIR_SIZE_DEFAULT (32 * 1024)
 #define NB_MAX_CONCURRENT_GC 3
+#define NB_FSAL_UP_PROCESS_DEFAULT 4
+#define FSAL_UP_PROCESS_BATCH_DEFAULT 64
 #define NB_MAX_PENDING_REQUEST 30
 #define NB_REQUEST_BEFORE_GC 50
 #define PRIME_DUPREQ 17         /* has to be a prime number */
@@ -206,6 +213,9 @@ typedef struct nfs_core_param__
   unsigned int program[P_COUNT];
   unsigned int nb_worker;
   unsigned int nb_call_before_queue_avg;
+  unsigned int nb_slow_worker; /* Workers reserved for slow requests */
+  unsigned int slow_io_size; /* READ/WRITE sizes that make a request slow */
+  unsigned int slow_readdir_size; /* Same for READDIR reply sizes */
   unsigned int nb_max_concurrent_gc;
   long core_dump_size;
   int nb_max_fd;
@@ -230,6 +240,14 @@ typedef struct nfs_core_param__
   bool_t nsm_use_caller_name;
 #endif
   bool_t clustered;
+#ifdef _USE_FSAL_UP
+  unsigned int nb_fsal_up_process; /* Threads processing FSAL UP events */
+  unsigned int fsal_up_process_batch; /* Events they take at once */
+#endif
+  bool_t numa_aware; /* Partition workers and pools per NUMA node */
+  bool_t read_splice; /* Send READ data from a pipe, see nfs_read_splice.h */
+  unsigned int numa_nb_ifaces;
+  nfs_numa_iface_t numa_ifaces[NFS_NUMA_MAX_IFACES];
 } nfs_core_parameter_t;
 
 typedef struct nfs_ip_name_param__
@@ -532,6 +550,7 @@ extern pool_t *ip_stats_pool;
 struct nfs_worker_data__
 {
   unsigned int worker_index;
+  unsigned int numa_node; /* NUMA node index this worker runs on */
   int  pending_request_len;
   struct glist_head pending_request;
   LRU_list_t *duplicate_request;
@@ -549,6 +568,7 @@ struct nfs_worker_data__
   /* Description of current or most recent function processed and start time (or 0) */
   const nfs_function_desc_t *pfuncdesc;
   struct timeval timer_start;
+  nfs_read_splice_t read_splice; /* Pipe for the READ data of the reply */
 };
 
 /* flush thread data */
@@ -608,6 +628,16 @@ typedef enum process_status
   PROCESS_DONE
 } process_status_t;
 
+/**
+ * Cost class of a decoded request, see nfs_rpc_classify_request.
+ */
+typedef enum nfs_req_class
+{
+  NFS_REQ_CLASS_LEASE, /* Keeps a lease or session alive, never queued */
+  NFS_REQ_CLASS_FAST,
+  NFS_REQ_CLASS_SLOW /* Run by the slow workers, if any */
+} nfs_req_class_t;
+
 typedef enum pause_reason
 {
   PAUSE_RELOAD_EXPORTS,
@@ -659,7 +689,8 @@ request_data_t *nfs_rpc_get_nfsreq(nfs_worker_data_t *worker, uint32_t flags);
 process_status_t process_rpc_request(SVCXPRT *xprt);
 
 process_status_t dispatch_rpc_subrequest(nfs_worker_data_t *mydata,
-                                         request_data_t *onfsreq);
+                                         request_data_t *onfsreq,
+                                         nfs_req_class_t req_class);
 int stats_snmp(void);
 /*
  * Thread entry functions
@@ -703,6 +734,7 @@ void constructor_request_data_t(void *ptr, void *parameters);
 /* Config parsing routines */
 int get_stat_exporter_conf(config_file_t in_config, external_tools_parameter_t * out_parameter);
 int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam);
+void nfs_read_open_addr_conf(hash_parameter_t * hparam, char *key_value);
 int nfs_read_worker_conf(config_file_t in_config, nfs_worker_parameter_t * pparam);
 int nfs_read_dupreq_hash_conf(config_file_t in_config,
                               nfs_rpc_dupreq_parameter_t * pparam);
@@ -832,6 +864,9 @@ int fridgethr_init() ;
 
 #define WORKER_INDEX_ANY INT_MAX
 unsigned int nfs_core_select_worker_queue(unsigned int avoid_index) ;
+unsigned int nfs_core_select_worker_queue_node(unsigned int avoid_index,
+                                               unsigned int numa_node,
+                                               nfs_req_class_t req_class);
 
 int nfs_Init_ip_name(nfs_ip_name_parameter_t param);
 hash_table_t *nfs_Init_ip_stats(nfs_ip_stats_parameter_t param);
@@ -840,9 +875,11 @@ int nfs_Init_dupreq(nfs_rpc_dupreq_parameter_t param);
 extern const nfs_function_desc_t *INVALID_FUNCDESC;
 const nfs_function_desc_t *nfs_rpc_get_funcdesc(nfs_request_data_t * preqnfs);
 int nfs_rpc_get_args(nfs_request_data_t * preqnfs, const nfs_function_desc_t *pfuncdesc);
+nfs_req_class_t nfs_rpc_classify_request(nfs_request_data_t *preqnfs);
 
 #ifdef _USE_FSAL_UP
-void *fsal_up_process_thread( void * UnUsedArg );
+void *fsal_up_process_thread( void * Arg );
+void create_fsal_up_process_threads();
 void create_fsal_up_threads();
 void nfs_Init_FSAL_UP();
 #endif /* _USE_FSAL_UP */
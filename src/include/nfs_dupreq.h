@@ -50,6 +50,7 @@ typedef unsigned long u_long;
 #include "nfs4.h"
 #include "fsal.h"
 #include "nfs_tools.h"
+#include "nfs_xdr_reply.h"
 
 typedef struct dupreq_key__
 {
@@ -80,7 +81,7 @@ typedef struct dupreq_entry__
   pthread_mutex_t dupreq_mutex;
   int processing; /* if currently being processed, this should be = 1 */
 
-  nfs_res_t res_nfs;
+  nfs_xdr_reply_t *reply;      /* encoded reply, NULL while processing */
   u_long rq_prog;               /* service program number        */
   u_long rq_vers;               /* service protocol version      */
   u_long rq_proc;
@@ -92,11 +93,12 @@ int print_entry_dupreq(LRU_data_t data, char *str);
 int clean_entry_dupreq(LRU_entry_t *pentry, void *addparam);
 int nfs_dupreq_gc_function(LRU_entry_t *pentry, void *addparam);
 
-nfs_res_t nfs_dupreq_get(struct svc_req *req, int *pstatus);
+nfs_xdr_reply_t *nfs_dupreq_get(struct svc_req *req, int *pstatus);
 int nfs_dupreq_delete(struct svc_req *req);
-int nfs_dupreq_add_not_finished(struct svc_req *req, nfs_res_t *res_nfs);
+int nfs_dupreq_add_not_finished(struct svc_req *req,
+                                nfs_xdr_reply_t **preply);
 
-int nfs_dupreq_finish(struct svc_req *req, nfs_res_t *p_res_nfs,
+int nfs_dupreq_finish(struct svc_req *req, nfs_xdr_reply_t *reply,
                       LRU_list_t *lru_dupreq);
 
 uint32_t dupreq_value_hash_func(hash_parameter_t *p_hparam,
@@ -58,6 +58,7 @@
 #include "cache_inode.h"
 #include "nfs_ip_stats.h"
 #include "nlm_list.h"
+#include "nfs_arena.h"
 
 /*
  * Export List structure 
@@ -195,6 +196,7 @@ typedef struct exportlist__
   fsal_off_t MaxOffsetWrite;    /* Maximum Offset allowed for write                  */
   fsal_off_t MaxOffsetRead;     /* Maximum Offset allowed for read                   */
   fsal_off_t MaxCacheSize;      /* Maximum Cache Size allowed                        */
+  fsal_size_t MaxReadahead;     /* Most bytes read ahead of sequential READs, 0: none */
   unsigned int UseCookieVerifier;       /* Is Cookie verifier to be used ?                   */
   exportlist_client_t clients;  /* allowed clients                                   */
   struct exportlist__ *next;    /* next entry                                        */
@@ -264,6 +266,9 @@ typedef struct exportlist__
 #define EXPORT_OPTION_USE_PNFS        0x20000000        /* Using pNFS or not using pNFS ?   */
 #define EXPORT_OPTION_USE_UQUOTA      0x40000000        /* Using user quota for this export */
 
+/* Default of MaxReadahead, see cache_inode_rdwr */
+#define EXPORT_DEFAULT_MAX_READAHEAD  (1024 * 1024)
+
 /* nfs_export_check_access() return values */
 #define EXPORT_PERMISSION_GRANTED            0x00000001
 #define EXPORT_MDONLY_GRANTED                0x00000002
@@ -330,6 +335,7 @@ typedef struct nfs_worker_data__ nfs_worker_data_t;
  */
 /* Forward references to SAL types */
 typedef struct nfs41_session__ nfs41_session_t;
+typedef struct nfs41_session_slot__ nfs41_session_slot_t;
 typedef struct nfs_client_id_t nfs_client_id_t;
 typedef struct COMPOUND4res_extended COMPOUND4res_extended;
 
@@ -365,9 +371,11 @@ typedef struct compoud_data
   nfs_client_cred_t credential; /*< Raw RPC credentials */
   nfs_client_id_t *preserved_clientid; /*< clientid that has lease
                                            reserved, if any */
+  nfs_arena_t *arena; /*< Allocator for the results of the operations,
+                          owned by the COMPOUND result */
 #ifdef _USE_NFS4_1
-  COMPOUND4res_extended *pcached_res; /*< NFv41: pointer to cached RPC res in
-                                          a session's slot */
+  nfs41_session_slot_t *pcached_slot; /*< NFSv41: session slot the reply
+                                          is cached in, or replayed from */
   bool_t use_drc; /*< Set to TRUE if session DRC is to be used */
   uint32_t oppos; /*< Position of the operation within the request
                       processed  */
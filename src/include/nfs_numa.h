@@ -0,0 +1,128 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_numa.h
+ * @brief  NUMA topology, thread placement and node-local object pools
+ *
+ * When NUMA awareness is enabled (NUMA_Aware in NFS_Core_Param), the
+ * workers are partitioned into one group per NUMA node, each group
+ * fed by TCP event channels whose dispatcher threads run on the same
+ * node.  Requests arriving on a connection are only ever queued to
+ * workers of the connection's node.
+ *
+ * The topology is read from sysfs so that no extra library is
+ * needed.  When the feature is disabled, or the machine has a single
+ * node, everything collapses to one node (index 0) and the callers
+ * behave exactly as before.
+ */
+
+#ifndef _NFS_NUMA_H
+#define _NFS_NUMA_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <sched.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "abstract_mem.h"
+
+#define NFS_NUMA_MAX_NODES 64
+#define NFS_NUMA_MAX_IFACES 32
+
+/* Returned by nfs_numa_addr_node when no binding matches */
+#define NFS_NUMA_NODE_ANY UINT32_MAX
+
+/**
+ * @brief One NUMA node as seen by the server
+ */
+
+typedef struct nfs_numa_node
+{
+  unsigned int node_id; /*< Kernel node number (nodeN in sysfs) */
+  cpu_set_t cpus; /*< CPUs belonging to this node */
+  unsigned int first_worker; /*< Index of the first worker of the group */
+  unsigned int nb_worker; /*< Number of workers in the group */
+  unsigned int nb_slow_worker; /*< Last workers of the group, reserved
+                                   for slow requests */
+  unsigned int last_worker; /*< Round-robin cursor for worker selection */
+  unsigned int last_slow_worker; /*< Same, among the slow workers */
+  uint32_t next_chan; /*< Round-robin cursor for TCP event channels */
+} nfs_numa_node_t;
+
+/**
+ * @brief Binding of a local interface address to a NUMA node
+ */
+
+typedef struct nfs_numa_iface
+{
+  struct in_addr addr; /*< Local address the connection was accepted on */
+  unsigned int node_id; /*< Kernel node number to bind it to */
+} nfs_numa_iface_t;
+
+int nfs_numa_init(int enable, unsigned int nb_worker,
+                  unsigned int nb_slow_worker,
+                  const nfs_numa_iface_t *ifaces,
+                  unsigned int nb_ifaces);
+int nfs_numa_enabled(void);
+unsigned int nfs_numa_nb_nodes(void);
+nfs_numa_node_t *nfs_numa_get_node(unsigned int idx);
+unsigned int nfs_numa_worker_node(unsigned int worker_index);
+unsigned int nfs_numa_addr_node(const struct sockaddr_storage *addr);
+unsigned int nfs_numa_fd_node(int fd);
+int nfs_numa_bind_thread(unsigned int idx);
+unsigned int nfs_numa_thread_node(void);
+int nfs_numa_parse_iface(const char *str, nfs_numa_iface_t *iface);
+
+/**
+ * @page NumaPoolSubstrate The NUMA Pool Substrate
+ *
+ * This substrate keeps one free list per NUMA node.  Objects are
+ * allocated by (and therefore first touched on) the node of the
+ * calling thread and are always recycled onto the free list of the
+ * node they were allocated on, so a hot object never migrates to a
+ * remote node.  Each object carries a small hidden header recording
+ * its home node.
+ *
+ * When NUMA awareness is disabled, the free lists are not used and
+ * the substrate degrades to plain gsh_malloc/gsh_free.
+ */
+
+/**
+ * @brief Parameters for the NUMA pool substrate
+ */
+
+struct pool_numa_params
+{
+  unsigned int max_cached; /*< Maximum objects kept on each node's
+                               free list */
+};
+
+#define POOL_NUMA_DEFAULT_CACHED 1024
+
+extern const struct pool_substrate_vector pool_numa_substrate[];
+
+#endif /* _NFS_NUMA_H */
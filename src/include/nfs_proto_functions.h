@@ -55,6 +55,7 @@
 #include "nfs_exports.h"
 #include "nfs_creds.h"
 #include "nfs_file_handle.h"
+#include "nfs_xdr_reply.h"
 
 #include "err_LRU_List.h"
 #include "err_HashTable.h"
@@ -132,7 +133,9 @@ typedef union nfs_arg__
 struct COMPOUND4res_extended
 {
   COMPOUND4res res_compound4;
-  bool_t       res_cached;
+  nfs_arena_t *res_arena; /*< Holds the results, freed with them */
+  nfs_xdr_reply_t *res_reply; /*< If set, the encoded reply to send in
+                                  place of res_compound4 */
 };
 
 typedef union nfs_res__
@@ -1280,8 +1283,7 @@ void nfs3_Read_Free(nfs_res_t * resp);
 void nfs2_Readlink_Free(nfs_res_t * resp);
 void nfs4_Compound_FreeOne(nfs_resop4 * pres);
 void nfs4_Compound_Free(nfs_res_t * pres);
-void nfs4_Compound_CopyResOne(nfs_resop4 * pres_dst, nfs_resop4 * pres_src);
-void nfs4_Compound_CopyRes(nfs_res_t * pres_dst, nfs_res_t * pres_src);
+bool_t xdr_COMPOUND4res_extended(XDR * xdrs, COMPOUND4res_extended * objp);
 
 void nfs4_op_access_Free(ACCESS4res * resp);
 void nfs4_op_close_Free(CLOSE4res * resp);
@@ -1323,13 +1325,6 @@ void nfs4_op_setclientid_confirm_Free(SETCLIENTID_CONFIRM4res * resp);
 void nfs4_op_verify_Free(VERIFY4res * resp);
 void nfs4_op_write_Free(WRITE4res * resp);
 
-void nfs4_op_close_CopyRes(CLOSE4res * resp_dst, CLOSE4res * resp_src);
-void nfs4_op_lock_CopyRes(LOCK4res * resp_dst, LOCK4res * resp_src);
-void nfs4_op_locku_CopyRes(LOCKU4res * resp_dst, LOCKU4res * resp_src);
-void nfs4_op_open_CopyRes(OPEN4res * resp_dst, OPEN4res * resp_src);
-void nfs4_op_open_confirm_CopyRes(OPEN_CONFIRM4res * resp_dst, OPEN_CONFIRM4res * resp_src);
-void nfs4_op_open_downgrade_CopyRes(OPEN_DOWNGRADE4res * resp_dst, OPEN_DOWNGRADE4res * resp_src);
-
 #ifdef _USE_NFS4_1
 void nfs41_op_exchange_id_Free(EXCHANGE_ID4res * resp);
 void nfs41_op_close_Free(CLOSE4res * resp);
@@ -1347,13 +1342,6 @@ void nfs41_op_set_ssv_Free(SET_SSV4res * resp);
 void nfs41_op_test_stateid_Free(TEST_STATEID4res * resp);
 void nfs41_op_write_Free(WRITE4res * resp);
 void nfs41_op_reclaim_complete_Free(RECLAIM_COMPLETE4res * resp);
-
-void nfs41_op_close_CopyRes(CLOSE4res * resp_dst, CLOSE4res * resp_src);
-void nfs41_op_lock_CopyRes(LOCK4res * resp_dst, LOCK4res * resp_src);
-void nfs41_op_locku_CopyRes(LOCKU4res * resp_dst, LOCKU4res * resp_src);
-void nfs41_op_open_CopyRes(OPEN4res * resp_dst, OPEN4res * resp_src);
-void nfs41_op_open_confirm_CopyRes(OPEN_CONFIRM4res * resp_dst, OPEN_CONFIRM4res * resp_src);
-void nfs41_op_open_downgrade_CopyRes(OPEN_DOWNGRADE4res * resp_dst, OPEN_DOWNGRADE4res * resp_src);
 #endif                          /* _USE_NFS4_1 */
 
 void compound_data_Free(compound_data_t * data);
@@ -1504,7 +1492,7 @@ int nfs4_Fattr_To_FSAL_attr(fsal_attrib_list_t * pFSAL_attr,    /* Out: File att
 int nfs4_attrmap_to_FSAL_attrmask(bitmap4 attrmap, fsal_attrib_mask_t* attrmask);
 
 int nfs4_Fattr_Fill(fattr4 *Fattr, int attrcnt, uint32_t *attrlist,
-                    int valsiz, char *attrvals);
+                    int valsiz, char *attrvals, nfs_arena_t *arena);
 int nfs4_supported_attrs_to_fattr(char *outbuf);
 int nfs4_FSALattr_To_Fattr(exportlist_t *pexport,
                            fsal_attrib_list_t *pattr,
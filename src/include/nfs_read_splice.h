@@ -0,0 +1,83 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_read_splice.h
+ * @brief  READ replies sent from a pipe
+ *
+ * With Read_Splice set, a READ over TCP with AUTH_NONE or AUTH_SYS
+ * credentials does not copy the file data into a buffer: the FSAL
+ * only finds how much there is to read and hands back a descriptor of
+ * the file.  When the reply is sent, the worker splices the data into
+ * its pipe and writes the RPC record to the socket itself, the encoded
+ * reply up to the data from a small buffer and the data straight from
+ * the pipe.  The pages move from the page cache to the socket without
+ * being copied to user space.
+ *
+ * A pipe holds references to pages, not a copy of the data, so the
+ * data are those of the file when the reply is sent, not when the
+ * READ ran: a WRITE in between shows in the reply, as it would had the
+ * READ come a little later.  Whenever the reply has to be encoded
+ * whole (the duplicate request cache, a session slot keeping it, a
+ * COMPOUND that does not end with the READ), or the file shrank in
+ * between, the data are read into a buffer and the reply goes the
+ * usual way.
+ */
+
+#ifndef _NFS_READ_SPLICE_H
+#define _NFS_READ_SPLICE_H
+
+#include <stdint.h>
+#include "ganesha_rpc.h"
+
+typedef struct nfs_read_splice
+{
+  int pipefd[2]; /*< The pipe, -1 until first used */
+  size_t pipe_size; /*< Its capacity */
+  bool_t allowed; /*< The request in progress may use it */
+  bool_t armed; /*< A READ of the request took it, it may hold data */
+  bool_t pending; /*< The data of the reply are to be spliced */
+  u_int vers; /*< NFS version of the request */
+  int file_fd; /*< Descriptor of the file read, -1 if none */
+  uint64_t offset; /*< Where the data start in the file */
+  size_t len; /*< Bytes of data */
+  char **data_val; /*< The opaque of the reply the data belong to */
+  u_int *data_len;
+} nfs_read_splice_t;
+
+void nfs_read_splice_init(nfs_read_splice_t *rs);
+void nfs_read_splice_allow(nfs_read_splice_t *rs, SVCXPRT *xprt,
+                           struct svc_req *req, bool_t cached);
+int *nfs_read_splice_start(nfs_read_splice_t *rs, uint64_t offset,
+                           size_t size);
+void nfs_read_splice_pending(nfs_read_splice_t *rs, size_t len,
+                             char **data_val, u_int *data_len);
+bool_t nfs_read_splice_fetch(nfs_read_splice_t *rs);
+bool_t nfs_read_splice_is_tail(nfs_read_splice_t *rs, struct svc_req *req,
+                               void *res);
+int nfs_read_splice_send(nfs_read_splice_t *rs, SVCXPRT *xprt,
+                         struct svc_req *req, xdrproc_t proc, caddr_t res);
+void nfs_read_splice_done(nfs_read_splice_t *rs);
+void nfs_read_splice_get_stats(uint64_t *sent, uint64_t *bytes,
+                               uint64_t *fetched);
+
+#endif /* _NFS_READ_SPLICE_H */
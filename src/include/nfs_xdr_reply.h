@@ -0,0 +1,56 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_xdr_reply.h
+ * @brief  Encoded replies kept for retransmission
+ *
+ * The duplicate request cache and the NFSv4.1 session slots keep the
+ * replies they may have to send again as the bytes that went on the
+ * wire rather than as decoded result structures.  A reply is encoded
+ * once, sent from its buffer and then retransmitted as is, with no
+ * further encoding and no copy of the results.
+ *
+ * The buffers are reference counted, so that a retransmission holds
+ * the reply while the cache is free to drop it.
+ */
+
+#ifndef _NFS_XDR_REPLY_H
+#define _NFS_XDR_REPLY_H
+
+#include <stdint.h>
+#include "ganesha_rpc.h"
+
+typedef struct nfs_xdr_reply
+{
+  uint64_t refcount; /*< References held on the reply */
+  u_int len; /*< Length of the encoded reply */
+  char data[]; /*< The reply, as encoded by its XDR function */
+} nfs_xdr_reply_t;
+
+nfs_xdr_reply_t *nfs_xdr_reply_encode(xdrproc_t proc, caddr_t res);
+void nfs_xdr_reply_ref(nfs_xdr_reply_t *reply);
+void nfs_xdr_reply_unref(nfs_xdr_reply_t *reply);
+bool_t xdr_nfs_xdr_reply(XDR *xdrs, nfs_xdr_reply_t *reply);
+void nfs_xdr_reply_get_stats(uint64_t *count, uint64_t *bytes);
+
+#endif /* _NFS_XDR_REPLY_H */
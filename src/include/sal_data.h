@@ -108,13 +108,13 @@ typedef struct state_layout_segment_t state_layout_segment_t;
 #define NFS41_NB_SLOTS           3
 #define NFS41_DRC_SIZE          32768
 
-typedef struct nfs41_session_slot__
+struct nfs41_session_slot__
 {
   sequenceid4            sequence;
   pthread_mutex_t        lock;
-  COMPOUND4res_extended  cached_result;
+  nfs_xdr_reply_t      * cached_reply; /*< Encoded reply, under lock */
   unsigned int           cache_used;
-} nfs41_session_slot_t;
+};
 
 struct nfs41_session__
 {
@@ -0,0 +1,123 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   slab_pool.h
+ * @brief  Slab pool substrate with per-thread magazines
+ */
+
+#ifndef _SLAB_POOL_H
+#define _SLAB_POOL_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "abstract_mem.h"
+
+/**
+ * @page SlabPoolSubstrate The Slab Pool Substrate
+ *
+ * This substrate carves fixed-size objects out of large, aligned
+ * slabs obtained directly from the kernel.  It is layered as
+ * described by Bonwick:
+ *
+ * - Every thread has, for every slab pool it touches, two magazines
+ *   (small stacks of object pointers).  Allocation and free are
+ *   served from them without taking any lock.
+ * - Each NUMA node has a depot of full and empty magazines, protected
+ *   by a mutex, that threads exchange magazines with.
+ * - Underneath, each node has a list of partially used and of empty
+ *   slabs.  The free objects of a slab are tracked by an index stack
+ *   in the slab header, so the object memory itself is never written
+ *   by the allocator.
+ *
+ * Since the allocator never touches object memory, a cached
+ * constructor may be given in the parameters: it is run once per
+ * object when a slab is created and the cached destructor is run
+ * when the slab is released.  Objects must be returned to the pool
+ * in their constructed state.  This is distinct from the constructor
+ * passed to pool_init, which is run on every pool_alloc.  As with
+ * the basic substrate, pools with neither constructor hand out
+ * zeroed objects, unless created with POOL_SLAB_NO_ZERO.
+ *
+ * Objects freed by a thread of another NUMA node go straight back to
+ * their slab rather than into the thread's magazine, so memory never
+ * drifts away from the node that first touched it.
+ *
+ * The memory of empty slabs beyond max_empty per node is given back
+ * to the system as soon as they become empty; pool_slab_reap releases
+ * every empty slab and the magazines cached in the depots.  Released
+ * slabs are unmapped; with _DEBUG_MEMLEAKS their range is left
+ * inaccessible instead, so that a stale pointer into one faults.
+ */
+
+/**
+ * @brief Parameters for the slab pool substrate
+ *
+ * A NULL parameter pointer selects the defaults.
+ */
+
+struct pool_slab_params
+{
+  unsigned int mag_size; /*< Objects per magazine, 0 for a size
+                             dependent default */
+  unsigned int max_empty; /*< Empty slabs kept per node before memory
+                              is returned to the system */
+  pool_constructor_t ctor; /*< Cached constructor, run once per object
+                               when its slab is created */
+  pool_destructor_t dtor; /*< Cached destructor, run when the slab is
+                              released */
+  void *ctor_arg; /*< Argument given to the cached constructor */
+  uint32_t flags; /*< POOL_SLAB_ flags below */
+};
+
+#define POOL_SLAB_DEFAULT_MAX_EMPTY 4
+
+/* Objects are handed out as they were last freed, never zeroed */
+#define POOL_SLAB_NO_ZERO 0x01
+
+/**
+ * @brief Statistics of one slab pool
+ *
+ * The per-thread counters are folded in whenever a thread exchanges
+ * a magazine with the depot, so live and high_water may lag by a
+ * couple of magazines per thread.
+ */
+
+struct pool_slab_stats
+{
+  uint64_t allocs; /*< Objects handed out since creation */
+  uint64_t frees; /*< Objects returned since creation */
+  uint64_t live; /*< Objects currently held by callers */
+  uint64_t high_water; /*< Highest value of live seen */
+  uint64_t slabs; /*< Slabs in use or kept empty, released ones
+                      not counted */
+  uint64_t bytes; /*< Memory held by those slabs */
+};
+
+extern const struct pool_substrate_vector pool_slab_substrate[];
+
+int pool_slab_get_stats(pool_t *pool, struct pool_slab_stats *stats);
+size_t pool_slab_reap(pool_t *pool);
+size_t pool_slab_reap_all(void);
+void pool_slab_dump_stats(FILE *out, const char *strdate);
+
+#endif /* _SLAB_POOL_H */
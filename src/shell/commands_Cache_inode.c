@@ -384,6 +384,7 @@ int cache_solvepath(char *io_global_path, int size_global_path, /* global path *
 
       /* Get the corresponding pentry */
       fsdata.fh_desc.len = 0;
+      fsdata.hash = 0;
       (void) FSAL_ExpandHandle(NULL,
 			       FSAL_DIGEST_SIZEOF,
 			       &fsdata.fh_desc);
@@ -566,6 +567,7 @@ int cacheinode_init(char *filename, int flag_v, FILE * output)
   cache_param.hparam.hash_func_rbt = cache_inode_fsal_rbt_func;
   cache_param.hparam.hash_func_both = NULL ; /* BUGAZOMEU */
   cache_param.hparam.compare_key = cache_inode_compare_key_fsal;
+  cache_param.hparam.key_flatten = cache_inode_fsal_flatten;
   cache_param.hparam.key_to_str = NULL;
   cache_param.hparam.val_to_str = NULL;
   cache_param.hparam.ht_name = "Cache Inode";
@@ -760,6 +762,7 @@ if(FSAL_IS_ERROR(status = FSAL_str2path("/xfs", FSAL_MAX_PATH_LEN, &pathroot)))
 
   fsdata.fh_desc.len = 0;
   fsdata.fh_desc.start = (caddr_t) &root_handle;
+  fsdata.hash = 0;
   (void) FSAL_ExpandHandle(&context->exp_context,
 			   FSAL_DIGEST_SIZEOF,
 			   &fsdata.fh_desc);
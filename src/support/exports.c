@@ -104,6 +104,7 @@
 #define CONF_EXPORT_MAX_OFF_WRITE      "MaxOffsetWrite"
 #define CONF_EXPORT_MAX_OFF_READ       "MaxOffsetRead"
 #define CONF_EXPORT_MAX_CACHE_SIZE     "MaxCacheSize"
+#define CONF_EXPORT_MAX_READAHEAD      "MaxReadahead"
 #define CONF_EXPORT_REFERRAL           "Referral"
 #define CONF_EXPORT_PNFS               "Use_pNFS"
 #define CONF_EXPORT_UQUOTA             "User_Quota"
@@ -122,6 +123,7 @@
 #define FLAG_EXPORT_PATH          0x000000002
 
 #define FLAG_EXPORT_ROOT_OR_ACCESS 0x000000004
+#define FLAG_EXPORT_MAX_READAHEAD  0x000000008
 
 #define FLAG_EXPORT_PSEUDO          0x000000010
 #define FLAG_EXPORT_ACCESSTYPE      0x000000020
@@ -663,6 +665,7 @@ static int BuildExportEntry(config_item_t block, exportlist_t ** pp_export)
   p_entry->use_commit = TRUE;
   p_entry->use_ganesha_write_buffer = FALSE;
   p_entry->UseCookieVerifier = TRUE;
+  p_entry->MaxReadahead = EXPORT_DEFAULT_MAX_READAHEAD;
 
   /* Defaults for FSAL_UP. It is ok to leave the filter list NULL
    * even if we enable the FSAL_UP. */
@@ -1930,6 +1933,44 @@ static int BuildExportEntry(config_item_t block, exportlist_t ** pp_export)
           set_options |= FLAG_EXPORT_MAX_OFF_READ;
 
         }
+      else if(!STRCMP(var_name, CONF_EXPORT_MAX_READAHEAD))
+        {
+          long long int size;
+          char *end_ptr;
+
+          /* check if it has not already been set */
+          if((set_options & FLAG_EXPORT_MAX_READAHEAD) ==
+             FLAG_EXPORT_MAX_READAHEAD)
+            {
+              DEFINED_TWICE_WARNING(CONF_EXPORT_MAX_READAHEAD);
+              continue;
+            }
+
+          errno = 0;
+          size = strtoll(var_value, &end_ptr, 10);
+
+          if(end_ptr == NULL || *end_ptr != '\0' || errno != 0)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "NFS READ_EXPORT: ERROR: Invalid MaxReadahead: \"%s\"",
+                      var_value);
+              err_flag = TRUE;
+              continue;
+            }
+
+          if(size < 0)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "NFS READ_EXPORT: ERROR: MaxReadahead out of range: %lld",
+                      size);
+              err_flag = TRUE;
+              continue;
+            }
+
+          p_entry->MaxReadahead = (fsal_size_t) size;
+
+          set_options |= FLAG_EXPORT_MAX_READAHEAD;
+        }
       else if(!STRCMP(var_name, CONF_EXPORT_USE_COMMIT))
         {
           switch (StrToBoolean(var_value))
@@ -2170,6 +2211,7 @@ exportlist_t *BuildDefaultExport()
   p_entry->PrefWrite = (fsal_size_t) 16384;
   p_entry->PrefRead = (fsal_size_t) 16384;
   p_entry->PrefReaddir = (fsal_size_t) 16384;
+  p_entry->MaxReadahead = EXPORT_DEFAULT_MAX_READAHEAD;
 
   strcpy(p_entry->FS_specific, "");
   strcpy(p_entry->FS_tag, "ganesha");
@@ -3037,6 +3079,7 @@ int nfs_export_create_root_entry(exportlist_t * pexportlist)
              
           /* Add this entry to the Cache Inode as a "root" entry */
           fsdata.fh_desc.start = (caddr_t) &fsal_handle;
+          fsdata.hash = 0;
           fsdata.fh_desc.len = 0;
 	  (void) FSAL_ExpandHandle(
 #ifdef _USE_SHARED_FSAL
@@ -42,11 +42,13 @@
 #include <pthread.h>
 #include <assert.h>
 #include <stdint.h>
+#include <sched.h>
 #include "nlm_list.h"
 #include "fsal.h"
 #include "nfs_core.h"
 #include "log.h"
 #include "cache_inode.h"
+#include "abstract_atomic.h"
 #include "generic_weakref.h"
 
 /**
@@ -61,24 +63,61 @@
  * reference counting guarantees, eviction safety, and access restrictions
  * using ordinary object addresses.
  *
+ * Objects are kept in an array of slots, grown by chunks and never
+ * shrunk, and a weak reference names a slot and the generation of
+ * its occupant.  Each time a slot is filled or emptied its
+ * generation is bumped, so a lookup is a single array access and a
+ * generation compare, with no lock and no search.
+ *
+ * A lookup that found its object keeps the slot held (a count of
+ * readers in the slot) until gweakref_release, so that the caller
+ * can take a reference on the object.  Deletion bumps the generation
+ * first, so no new reader gets in, then waits for the readers already
+ * in to leave: once gweakref_delete returns, nobody can reach the
+ * object through the table.
+ *
+ * Free slots are kept on per-partition free lists, so that inserts
+ * and deletes, which happen once per object lifetime, do not all
+ * contend on one lock.
  */
 
+/* Slots per chunk, and most chunks of a table */
+#define GWR_CHUNK_SLOTS 4096
+#define GWR_MAX_CHUNKS 16384
+
+/* End of a free list */
+#define GWR_NO_SLOT UINT32_MAX
+
 #define CACHE_LINE_SIZE 64
 #define CACHE_PAD(_n) char __pad ## _n [CACHE_LINE_SIZE]
 
+/**
+ * @brief A slot of the table
+ *
+ * The generation is odd while the slot holds an object and even
+ * while it is free, so that a weak reference never matches a free
+ * slot.
+ */
+
+typedef struct gweakref_slot_
+{
+    void *obj; /*< The object, valid while gen is odd */
+    uint64_t gen; /*< Generation of the slot */
+    uint32_t readers; /*< Lookups holding the slot */
+    uint32_t next; /*< Next free slot, while on a free list */
+} __attribute__((aligned(32))) gweakref_slot_t;
+
 /**
  * @brief The table partition
  *
- * Each tree is independent, having its own lock and generation
- * number, thus reducing thread contention.
+ * Each partition has its own free slots and lock, thus reducing
+ * thread contention on insert and delete.
  */
 
 typedef struct gweakref_partition_
 {
-    pthread_rwlock_t lock;
-    struct avltree t;
-    uint64_t genctr;
-    struct avltree_node **cache;
+    pthread_mutex_t mtx;
+    uint32_t free; /*< First free slot */
     CACHE_PAD(0);
 } gweakref_partition_t;
 
@@ -91,87 +130,47 @@ typedef struct gweakref_partition_
 struct gweakref_table_
 {
     CACHE_PAD(0);
+    gweakref_slot_t **chunks; /*< GWR_MAX_CHUNKS chunks, NULL until
+                                  allocated */
+    uint32_t nchunks; /*< Chunks allocated */
     gweakref_partition_t *partition;
-    CACHE_PAD(1);
     uint32_t npart;
-    uint32_t cache_sz;
+    CACHE_PAD(1);
 };
 
 /**
  * @brief Find the correct partition for a pointer
  *
- * To lower thread contention, the table is composed of multiple
- * trees, with the tree that receives a pointer determined by a
- * modulus.  This macro yields an expression that yields a pointer to
- * the correct partition.
+ * To lower thread contention, the free slots are spread over
+ * multiple partitions, with the partition that gives a slot to a
+ * pointer determined by a modulus.  This macro yields an expression
+ * that yields a pointer to the correct partition.
  */
 
 #define gwt_partition_of_addr_k(xt, k) \
     (((xt)->partition)+(((uint64_t)k)%(xt)->npart))
 
 /**
- * @brief Element within the AVL tree implementing weak references
- *
- * In this implementation, weak references are stored in an AVL tree
- * of (pointer, generation) pairs.  The pointer acts as the key in the
- * tree, and a lookup is successful only if the generation number
- * matches that stored in the found node.  The same pointer that
- * serves as the key serves as the value.
- */
-
-typedef struct gweakref_priv_
-{
-    struct avltree_node node_k; /*< The link to the rest of the tree */
-    gweakref_t k; /*< The (pointer, generation) pair */
-} gweakref_priv_t;
-
-/**
- * @brief Comparison function for weak references
- *
- * This is the comparison function for weak references necessary to
- * arrange them in an AVL tree.  It treats the stashed pointers as
- * integers and compares them numerically.
+ * @brief Find the slot of a weak reference
  *
- * @param lhs [in] First node
- * @param rhs [in] Second node
+ * @param wt [in] The table
+ * @param ref [in] The weak reference
  *
- * @retval -1: lhs compares as less than rhs
- * @retval 0: lhs and rhs compare equal
- * @retval 1: lhs is greater than rhs
+ * @return The slot, or NULL if the reference names no allocated slot.
  */
 
-static inline int wk_cmpf(const struct avltree_node *lhs,
-                          const struct avltree_node *rhs)
+static inline gweakref_slot_t *
+gwt_slot_of_ref(gweakref_table_t *wt, gweakref_t *ref)
 {
-    gweakref_priv_t *lk, *rk;
-
-    lk = avltree_container_of(lhs, gweakref_priv_t, node_k);
-    rk = avltree_container_of(rhs, gweakref_priv_t, node_k);
+    uint32_t chunk = ref->slot / GWR_CHUNK_SLOTS;
 
-    if (lk->k.ptr < rk->k.ptr)
-        return (-1);
+    /* gen 0 is never given, it denotes an empty reference */
+    if ((ref->gen == 0) ||
+        (chunk >= atomic_fetch_uint32_t(&wt->nchunks)) ||
+        (wt->chunks[chunk] == NULL))
+        return (NULL);
 
-    if (lk->k.ptr == rk->k.ptr)
-        return (0);
-
-    return (1);
-}
-
-/**
- * @brief Compute cache slot for an entry
- *
- * This function computes a hash slot, taking an address modulo the
- * number of cache slotes (which should be prime).
- *
- * @param wt [in] The table
- * @param ptr [in] Entry address
- *
- * @return The computed offset.
- */
-static inline int
-cache_offsetof(gweakref_table_t *wt, void *ptr)
-{
-    return ((uintptr_t) ptr % wt->cache_sz);
+    return (&wt->chunks[chunk][ref->slot % GWR_CHUNK_SLOTS]);
 }
 
 /**
@@ -186,10 +185,9 @@ cache_offsetof(gweakref_table_t *wt, void *ptr)
  * @return The address of the newly created table, NULL on failure.
  */
 
-gweakref_table_t *gweakref_init(uint32_t npart, uint32_t cache_sz)
+gweakref_table_t *gweakref_init(uint32_t npart)
 {
     int ix = 0;
-    pthread_rwlockattr_t rwlock_attr;
     gweakref_partition_t *wp = NULL;
     gweakref_table_t *wt = NULL;
 
@@ -197,41 +195,76 @@ gweakref_table_t *gweakref_init(uint32_t npart, uint32_t cache_sz)
     if (!wt)
         goto out;
 
-    /* prior versions of Linux tirpc are subject to default prefer-reader
-     * behavior (so have potential for writer starvation) */
-    pthread_rwlockattr_init(&rwlock_attr);
-#ifdef GLIBC
-    pthread_rwlockattr_setkind_np(
-        &rwlock_attr,
-        PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
-#endif
+    wt->chunks = gsh_calloc(GWR_MAX_CHUNKS, sizeof(gweakref_slot_t *));
+    wt->partition = gsh_calloc(npart, sizeof(gweakref_partition_t));
+    if (!wt->chunks || !wt->partition) {
+        gsh_free(wt->chunks);
+        gsh_free(wt->partition);
+        gsh_free(wt);
+        wt = NULL;
+        goto out;
+    }
 
     /* npart should be a small integer */
     wt->npart = npart;
-    wt->partition = gsh_calloc(npart, sizeof(gweakref_partition_t));
     for (ix = 0; ix < npart; ++ix) {
         wp = &wt->partition[ix];
-        pthread_rwlock_init(&wp->lock, &rwlock_attr);
-        avltree_init(&wp->t, wk_cmpf, 0 /* must be 0 */);
-        if (cache_sz > 0) {
-            wt->cache_sz = cache_sz;
-            wp->cache = gsh_calloc(cache_sz, sizeof(struct avltree_node *));
-        }
-        wp->genctr = 0;
+        pthread_mutex_init(&wp->mtx, NULL);
+        wp->free = GWR_NO_SLOT;
     }
 
 out:
     return (wt);
 }
 
+/**
+ * @brief Give a partition a new chunk of free slots
+ *
+ * @param wt [in] The table
+ * @param wp [in] The partition, locked
+ *
+ * @return 0 on success, -1 if the table cannot grow.
+ */
+
+static int gweakref_grow(gweakref_table_t *wt, gweakref_partition_t *wp)
+{
+    gweakref_slot_t *chunk;
+    uint32_t ix, base;
+
+    chunk = gsh_calloc(GWR_CHUNK_SLOTS, sizeof(gweakref_slot_t));
+    if (!chunk)
+        return (-1);
+
+    /* Other partitions may grow at the same time */
+    ix = atomic_inc_uint32_t(&wt->nchunks) - 1;
+    if (ix >= GWR_MAX_CHUNKS) {
+        atomic_dec_uint32_t(&wt->nchunks);
+        gsh_free(chunk);
+        return (-1);
+    }
+
+    /* Lookups check nchunks before reading chunks, but can only hold
+     * references to slots given out below, once the chunk is there. */
+    wt->chunks[ix] = chunk;
+    __sync_synchronize();
+
+    base = ix * GWR_CHUNK_SLOTS;
+    for (ix = 0; ix < GWR_CHUNK_SLOTS - 1; ++ix)
+        chunk[ix].next = base + ix + 1;
+    chunk[GWR_CHUNK_SLOTS - 1].next = wp->free;
+    wp->free = base;
+
+    return (0);
+}
+
 /**
  * @brief Insert a pointer into the weakref table
  *
  * This function inserts a pointer into the weak reference table and
- * returns a weak reference, consisting of a poitner and generation
- * number.  If the given pointer already exists within the table, a
- * weak reference consisting of the address NULL and the generation
- * number 0 is returned.
+ * returns a weak reference, consisting of a pointer, slot and
+ * generation number.  If the table cannot grow, a weak reference
+ * consisting of the address NULL and the generation number 0 is
+ * returned.
  *
  * @param wt [in] The table in which to add the pointer
  * @param obj [in] The address to insert
@@ -241,33 +274,29 @@ out:
 
 gweakref_t gweakref_insert(gweakref_table_t *wt, void *obj)
 {
-    gweakref_t ret;
-    gweakref_priv_t *ref;
+    gweakref_t ret = {NULL, 0, 0};
     gweakref_partition_t *wp;
-    struct avltree_node *node;
-
-    ref = gsh_calloc(1, sizeof(gweakref_priv_t));
-    ref->k.ptr = obj;
-
-    wp = (gweakref_partition_t *) gwt_partition_of_addr_k(wt, ref->k.ptr);
+    gweakref_slot_t *slot;
 
-    /* XXX initially wt had a single atomic counter, but for any address,
-     * partition is fixed, and we must take the partition lock exclusive
-     * in any case */
-    pthread_rwlock_wrlock(&wp->lock);
+    wp = gwt_partition_of_addr_k(wt, obj);
 
-    ref->k.gen = ++(wp->genctr);
-
-    node = avltree_insert(&ref->node_k, &wp->t);
-    if (! node) {
-        /* success */
-        ret = ref->k;
-    } else {
-        /* matching key existed */
-        ret.ptr = NULL;
-        ret.gen = 0;
+    pthread_mutex_lock(&wp->mtx);
+    if ((wp->free == GWR_NO_SLOT) && (gweakref_grow(wt, wp) != 0)) {
+        pthread_mutex_unlock(&wp->mtx);
+        LogCrit(COMPONENT_CACHE_INODE,
+                "gweakref_insert: unable to grow the weakref table");
+        return (ret);
     }
-    pthread_rwlock_unlock(&wp->lock);
+    ret.slot = wp->free;
+    slot = &wt->chunks[ret.slot / GWR_CHUNK_SLOTS][ret.slot % GWR_CHUNK_SLOTS];
+    wp->free = slot->next;
+    pthread_mutex_unlock(&wp->mtx);
+
+    /* The object must be visible before the generation saying it
+     * is there. */
+    slot->obj = obj;
+    ret.ptr = obj;
+    ret.gen = atomic_inc_uint64_t(&slot->gen);
 
     return (ret);
 }
@@ -275,64 +304,57 @@ gweakref_t gweakref_insert(gweakref_table_t *wt, void *obj)
 /**
  * @brief Search the table for an entry
  *
- * This function searches the weakref table for the supplied entry.
- * If the entry is found, it is returned and the partition tree is
- * held read-locked, to be unlocked by the caller.  Otherwise NULL is
- * returned and the partition tree is unlocked.
+ * This function looks up the slot of the supplied reference.  If the
+ * object is still there, it is returned and the slot is held, to be
+ * released by the caller with gweakref_release: the object cannot be
+ * deleted from the table meanwhile.  Otherwise NULL is returned and
+ * nothing is held.
  *
  * @param wt [in] The table to search
  * @param ref [in] The reference to search for
- * @param lock [out] if the object is found, the lock for the tree.
  *
  * @return The found object, otherwise NULL.
  */
 
-void *gweakref_lookupex(gweakref_table_t *wt, gweakref_t *ref,
-                        pthread_rwlock_t **lock)
+void *gweakref_lookupex(gweakref_table_t *wt, gweakref_t *ref)
 {
-    struct avltree_node *node = NULL;
-    gweakref_priv_t refk, *tref;
-    gweakref_partition_t *wp;
-    void *ret = NULL;
-
-    /* look up ref.ptr--return !NULL iff ref.ptr is found and
-     * ref.gen == found.gen */
-
-    refk.k = *ref;
-    wp = gwt_partition_of_addr_k(wt, refk.k.ptr);
-    pthread_rwlock_rdlock(&wp->lock);
-
-    /* check cache */
-    if (wp->cache)
-        node = wp->cache[cache_offsetof(wt, refk.k.ptr)];
-
-    if (! node)
-        node = avltree_lookup(&refk.node_k, &wp->t);
-
-    if (node) {
-        /* found it, maybe */
-        tref = avltree_container_of(node, gweakref_priv_t, node_k);
-        if (tref->k.gen == ref->gen) {
-            ret = ref->ptr;
-            if (wp->cache)
-                wp->cache[cache_offsetof(wt, refk.k.ptr)] = node;
-        }
+    gweakref_slot_t *slot = gwt_slot_of_ref(wt, ref);
+
+    if (!slot)
+        return (NULL);
+
+    /* Enter the slot, then check it still holds the object: a
+     * concurrent delete either bumped the generation before, and we
+     * see it, or will see us and wait. */
+    atomic_inc_uint32_t(&slot->readers);
+    if (atomic_fetch_uint64_t(&slot->gen) != ref->gen) {
+        atomic_dec_uint32_t(&slot->readers);
+        return (NULL);
     }
 
-    if (ret) {
-        *lock = &wp->lock;
-    } else {
-        pthread_rwlock_unlock(&wp->lock);
-    }
+    return (slot->obj);
+}
 
-    return (ret);
+/**
+ * @brief Release a slot held by gweakref_lookupex
+ *
+ * @param wt [in] The table
+ * @param ref [in] The reference that was found
+ */
+
+void gweakref_release(gweakref_table_t *wt, gweakref_t *ref)
+{
+    gweakref_slot_t *slot = gwt_slot_of_ref(wt, ref);
+
+    assert(slot);
+    atomic_dec_uint32_t(&slot->readers);
 }
 
 /**
  * @brief Wrapper around gweakref_lookupex
  *
- * This function is a wrapper around gweakref_lookupex that frees the
- * tree lock after the call.
+ * This function is a wrapper around gweakref_lookupex that releases
+ * the slot after the call.
  *
  * @param wt [in] The table to search
  * @param ref [in] The reference to search for
@@ -342,117 +364,71 @@ void *gweakref_lookupex(gweakref_table_t *wt, gweakref_t *ref,
 
 void *gweakref_lookup(gweakref_table_t *wt, gweakref_t *ref)
 {
-    pthread_rwlock_t *treelock = NULL;
     void *result = NULL;
 
-    result = gweakref_lookupex(wt, ref, &treelock);
+    result = gweakref_lookupex(wt, ref);
 
     if (result) {
-        pthread_rwlock_unlock(treelock);
+        gweakref_release(wt, ref);
     }
 
     return result;
 }
 
-
-#define GWR_FLAG_NONE    0x0000
-#define GWR_FLAG_WLOCKED  0x0001
-
 /**
- * @brief Implements deletion functionality
+ * @brief Delete an entry from the table
  *
- * This function deletes and frees the given entry from the weakref
- * table.  Nothing is done if the entry cannot be found.
+ * This function deletes the given entry from the weakref table and
+ * frees its slot.  Nothing is done if the entry cannot be found.
+ * Lookups holding the slot are waited for.
  *
  * @param wt [in,out] The table from which to delete the entry
  * @param ref [in] The entry to delete
- * @param flags [in] Flags controlling behaviour:
- *                        GWR_FLAG_NONE: Null flag
- *                        GWR_FLAG_WLOCKED: Write lock already held
  */
 
-static inline void gweakref_delete_impl(gweakref_table_t *wt, gweakref_t *ref,
-                                        uint32_t flags)
+void gweakref_delete(gweakref_table_t *wt, gweakref_t *ref)
 {
-    struct avltree_node *node;
-    gweakref_priv_t refk, *tref;
+    gweakref_slot_t *slot = gwt_slot_of_ref(wt, ref);
     gweakref_partition_t *wp;
 
-    /* lookup up ref.ptr, delete iff ref.ptr is found and
-     * ref.gen == found.gen */
-
-    refk.k = *ref;
-    wp = gwt_partition_of_addr_k(wt, refk.k.ptr);
-    if (!(flags & GWR_FLAG_WLOCKED))
-        pthread_rwlock_wrlock(&wp->lock);
-    node = avltree_lookup(&refk.node_k, &wp->t);
-    if (node) {
-        /* found it, maybe */
-        tref = avltree_container_of(node, gweakref_priv_t, node_k);
-        /* XXX generation mismatch would be in error, we think */
-        if (tref->k.gen == ref->gen) {
-            /* unhook it */
-            avltree_remove(node, &wp->t);
-            gsh_free(tref);
-            if (wp->cache)
-                wp->cache[cache_offsetof(wt, refk.k.ptr)] = NULL;
-        }
-    }
-    if (!(flags & GWR_FLAG_WLOCKED))
-        pthread_rwlock_unlock(&wp->lock);
-}
+    /* XXX generation mismatch would be in error, we think */
+    if (!slot ||
+        !__sync_bool_compare_and_swap(&slot->gen, ref->gen, ref->gen + 1))
+        return;
 
-/**
- * @brief Delete an entry from the table
- *
- * This function deletes and frees the given entry from the weakref
- * table.
- *
- * @param wt [in,out] The table from which to delete the entry
- * @param ref [in] The entry to delete
- */
+    /* Holders are only taking a reference on the object */
+    while (atomic_fetch_uint32_t(&slot->readers) != 0)
+        sched_yield();
 
-void gweakref_delete(gweakref_table_t *wt, gweakref_t *ref)
-{
-    gweakref_delete_impl(wt, ref, GWR_FLAG_NONE);
+    slot->obj = NULL;
+
+    wp = gwt_partition_of_addr_k(wt, ref->ptr);
+    pthread_mutex_lock(&wp->mtx);
+    slot->next = wp->free;
+    wp->free = ref->slot;
+    pthread_mutex_unlock(&wp->mtx);
 }
 
 /**
  * @brief Destroy a weakref table
  *
- * This function frees all entries in a weakref table, then all
- * partition subtrees.
+ * This function frees all slots in a weakref table, then the
+ * partitions.
  *
  * @param wt [in,out] The table to be freed
  */
 
 void gweakref_destroy(gweakref_table_t *wt)
 {
-    struct avltree_node *node, *onode;
-    gweakref_partition_t *wp;
-    gweakref_priv_t *tref;
     int ix;
 
     /* quiesce the server, then... */
 
-    for (ix = 0; ix < wt->npart; ++ix) {
-        wp = &wt->partition[ix];
-        onode = NULL;
-        node = avltree_first(&wp->t);
-        do {
-            if (onode) {
-                tref = avltree_container_of(onode, gweakref_priv_t, node_k);
-                gsh_free(tref);
-            }
-        } while ((onode = node) && (node = avltree_next(node)));
-        if (onode) {
-            tref = avltree_container_of(onode, gweakref_priv_t, node_k);
-            gsh_free(tref);
-        }
-        avltree_init(&wp->t, wk_cmpf, 0 /* must be 0 */);
-        if (wp->cache)
-            gsh_free(wp->cache);
-    }
+    for (ix = 0; ix < wt->nchunks; ++ix)
+        gsh_free(wt->chunks[ix]);
+    for (ix = 0; ix < wt->npart; ++ix)
+        pthread_mutex_destroy(&wt->partition[ix].mtx);
+    gsh_free(wt->chunks);
     gsh_free(wt->partition);
     gsh_free(wt);
 }
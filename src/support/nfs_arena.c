@@ -0,0 +1,205 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_arena.c
+ * @brief  Per-request bump allocator
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include "log.h"
+#include "abstract_mem.h"
+#include "slab_pool.h"
+#include "nfs_arena.h"
+
+/* Alignment of every allocation, that of malloc */
+#define NFS_ARENA_ALIGN 16
+#define NFS_ARENA_ROUND(n) (((n) + NFS_ARENA_ALIGN - 1) & \
+                            ~((size_t) NFS_ARENA_ALIGN - 1))
+
+/* Header of a chunk, padded to keep the payload aligned */
+typedef union nfs_arena_chunk
+{
+  union nfs_arena_chunk *next; /*< Next chunk of the same arena */
+  char pad[NFS_ARENA_ALIGN];
+} nfs_arena_chunk_t;
+
+struct nfs_arena
+{
+  char *cur; /*< Next free byte of the current chunk */
+  char *end; /*< End of the current chunk */
+  nfs_arena_chunk_t *chunks; /*< Pooled chunks, this one excepted */
+  nfs_arena_chunk_t *large; /*< Heap blocks for oversized requests */
+};
+
+/* Largest request served from a chunk */
+#define NFS_ARENA_MAX_INLINE (NFS_ARENA_CHUNK_SIZE - \
+                              sizeof(nfs_arena_chunk_t))
+
+static pool_t *nfs_arena_chunk_pool;
+
+/**
+ * @brief Create the pool of arena chunks
+ *
+ * Arena memory is not zeroed, neither are the chunks.
+ */
+
+void
+nfs_arena_pkginit(void)
+{
+  struct pool_slab_params params = {
+    .mag_size = 0,
+    .max_empty = POOL_SLAB_DEFAULT_MAX_EMPTY,
+    .ctor = NULL,
+    .dtor = NULL,
+    .ctor_arg = NULL,
+    .flags = POOL_SLAB_NO_ZERO
+  };
+
+  nfs_arena_chunk_pool = pool_init("NFS Arena Chunk Pool",
+                                   NFS_ARENA_CHUNK_SIZE,
+                                   pool_slab_substrate,
+                                   &params, NULL, NULL);
+  if(nfs_arena_chunk_pool == NULL)
+    LogFatal(COMPONENT_INIT,
+             "Error while allocating arena chunk pool");
+}
+
+/**
+ * @brief Create an arena
+ *
+ * The arena lives at the start of its first chunk, so an arena whose
+ * allocations fit in one chunk costs a single pool allocation.
+ *
+ * @return The arena, or NULL on failure.
+ */
+
+nfs_arena_t *
+nfs_arena_new(void)
+{
+  nfs_arena_chunk_t *chunk;
+  nfs_arena_t *arena;
+
+  chunk = pool_alloc(nfs_arena_chunk_pool, NULL);
+  if(chunk == NULL)
+    return NULL;
+
+  chunk->next = NULL;
+  arena = (nfs_arena_t *) (chunk + 1);
+  arena->cur = (char *) arena + NFS_ARENA_ROUND(sizeof(nfs_arena_t));
+  arena->end = (char *) chunk + NFS_ARENA_CHUNK_SIZE;
+  arena->chunks = NULL;
+  arena->large = NULL;
+
+  return arena;
+}
+
+/**
+ * @brief Allocate memory from an arena
+ *
+ * The memory is aligned as by malloc and is not zeroed.  It must not
+ * be freed, it goes away with the arena.
+ *
+ * @param[in] arena The arena
+ * @param[in] size  Number of bytes wanted
+ *
+ * @return The memory, or NULL on failure.
+ */
+
+void *
+nfs_arena_alloc(nfs_arena_t *arena, size_t size)
+{
+  nfs_arena_chunk_t *chunk;
+  void *ptr;
+
+  /* Neither the rounding nor the chunk header may wrap around */
+  if(size > SIZE_MAX - sizeof(nfs_arena_chunk_t) - NFS_ARENA_ALIGN)
+    return NULL;
+
+  size = NFS_ARENA_ROUND(size);
+  if(size == 0)
+    size = NFS_ARENA_ALIGN;
+
+  if(size <= (size_t) (arena->end - arena->cur))
+    {
+      ptr = arena->cur;
+      arena->cur += size;
+      return ptr;
+    }
+
+  if(size > NFS_ARENA_MAX_INLINE / 2)
+    {
+      /* Not worth wasting the rest of the current chunk */
+      chunk = gsh_malloc(sizeof(nfs_arena_chunk_t) + size);
+      if(chunk == NULL)
+        return NULL;
+      chunk->next = arena->large;
+      arena->large = chunk;
+      return chunk + 1;
+    }
+
+  chunk = pool_alloc(nfs_arena_chunk_pool, NULL);
+  if(chunk == NULL)
+    return NULL;
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+
+  ptr = chunk + 1;
+  arena->cur = (char *) ptr + size;
+  arena->end = (char *) chunk + NFS_ARENA_CHUNK_SIZE;
+
+  return ptr;
+}
+
+/**
+ * @brief Release an arena and everything allocated from it
+ *
+ * @param[in] arena The arena, may be NULL
+ */
+
+void
+nfs_arena_free(nfs_arena_t *arena)
+{
+  nfs_arena_chunk_t *chunk, *next;
+
+  if(arena == NULL)
+    return;
+
+  for(chunk = arena->large; chunk != NULL; chunk = next)
+    {
+      next = chunk->next;
+      gsh_free(chunk);
+    }
+
+  for(chunk = arena->chunks; chunk != NULL; chunk = next)
+    {
+      next = chunk->next;
+      pool_free(nfs_arena_chunk_pool, chunk);
+    }
+
+  /* The arena itself lives in its first chunk */
+  pool_free(nfs_arena_chunk_pool, ((nfs_arena_chunk_t *) arena) - 1);
+}
@@ -317,8 +317,6 @@ int nfs3_FSALToFhandle(nfs_fh3 *pfh3,
   file_handle_v3_t *file_handle;
   struct fsal_handle_desc fh_desc;
 
-  print_buff(COMPONENT_FILEHANDLE, (char *)pfsalhandle, sizeof(fsal_handle_t));
-
   /* reset the buffer to be used as handle */
   pfh3->data.data_len = sizeof(struct alloc_file_handle_v3);
   memset(pfh3->data.data_val, 0, pfh3->data.data_len);
@@ -366,8 +364,6 @@ int nfs2_FSALToFhandle(fhandle2 * pfh2, fsal_handle_t * pfsalhandle,
   file_handle_v2_t *file_handle;
   struct fsal_handle_desc fh_desc;
 
-  print_buff(COMPONENT_FILEHANDLE, (char *)pfsalhandle, sizeof(fsal_handle_t));
-
   /* zero-ification of the buffer to be used as handle */
   memset(pfh2, 0, sizeof(struct alloc_file_handle_v2));
   file_handle = (file_handle_v2_t *)pfh2;
@@ -0,0 +1,571 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_numa.c
+ * @brief  NUMA topology discovery, thread binding and NUMA pool substrate
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <sys/param.h>
+#include <arpa/inet.h>
+#include "log.h"
+#include "nfs_numa.h"
+
+#define NUMA_SYSFS_ROOT "/sys/devices/system/node"
+
+static int numa_enabled = 0;
+static unsigned int numa_nb_nodes = 1;
+static nfs_numa_node_t numa_nodes[NFS_NUMA_MAX_NODES];
+static int numa_cpu_to_node[CPU_SETSIZE];
+static nfs_numa_iface_t numa_ifaces[NFS_NUMA_MAX_IFACES];
+static unsigned int numa_nb_ifaces = 0;
+
+/* Node index of a thread that has been bound with nfs_numa_bind_thread */
+static __thread int numa_thread_idx = -1;
+
+/**
+ * @brief Parse a kernel cpu/node list ("0-3,8,10-11")
+ *
+ * @param[in]  str  The list, as found in sysfs
+ * @param[out] set  Members of the list
+ *
+ * @return 0 on success, -1 on malformed input.
+ */
+
+static int
+numa_parse_list(const char *str, cpu_set_t *set)
+{
+  const char *p = str;
+  char *end;
+  long lo, hi;
+
+  CPU_ZERO(set);
+
+  while(*p != '\0' && *p != '\n')
+    {
+      lo = strtol(p, &end, 10);
+      if(end == p || lo < 0)
+        return -1;
+      hi = lo;
+      p = end;
+      if(*p == '-')
+        {
+          hi = strtol(p + 1, &end, 10);
+          if(end == p + 1 || hi < lo)
+            return -1;
+          p = end;
+        }
+      for(; lo <= hi && lo < CPU_SETSIZE; lo++)
+        CPU_SET(lo, set);
+      if(*p == ',')
+        p++;
+    }
+
+  return 0;
+}
+
+/**
+ * @brief Read a sysfs list file into a cpu_set_t
+ */
+
+static int
+numa_read_list(const char *path, cpu_set_t *set)
+{
+  char buf[4096];
+  FILE *f;
+  int rc = -1;
+
+  if((f = fopen(path, "r")) == NULL)
+    return -1;
+
+  if(fgets(buf, sizeof(buf), f) != NULL)
+    rc = numa_parse_list(buf, set);
+
+  fclose(f);
+  return rc;
+}
+
+/**
+ * @brief Discover the topology and partition the workers
+ *
+ * Must be called once, before the workers, the event channels and
+ * any pool using the NUMA substrate are created.
+ *
+ * @param[in] enable    Whether NUMA awareness was requested
+ * @param[in] nb_worker Total number of worker threads
+ * @param[in] nb_slow_worker Number of them reserved for slow requests
+ * @param[in] ifaces    Interface to node bindings from the config
+ * @param[in] nb_ifaces Number of bindings
+ *
+ * @return 0 on success (including fallback to a single node).
+ */
+
+int
+nfs_numa_init(int enable, unsigned int nb_worker,
+              unsigned int nb_slow_worker,
+              const nfs_numa_iface_t *ifaces,
+              unsigned int nb_ifaces)
+{
+  cpu_set_t online;
+  char path[MAXPATHLEN];
+  unsigned int i, cpu, node;
+
+  memset(numa_nodes, 0, sizeof(numa_nodes));
+  for(cpu = 0; cpu < CPU_SETSIZE; cpu++)
+    numa_cpu_to_node[cpu] = 0;
+  numa_nb_nodes = 1;
+  numa_enabled = 0;
+
+  if(enable &&
+     numa_read_list(NUMA_SYSFS_ROOT "/online", &online) == 0)
+    {
+      numa_nb_nodes = 0;
+      for(node = 0; node < CPU_SETSIZE; node++)
+        {
+          nfs_numa_node_t *n;
+
+          if(!CPU_ISSET(node, &online))
+            continue;
+          if(numa_nb_nodes == NFS_NUMA_MAX_NODES)
+            {
+              LogWarn(COMPONENT_INIT,
+                      "NUMA: more than %d nodes, ignoring the others",
+                      NFS_NUMA_MAX_NODES);
+              break;
+            }
+          /* A node needs at least one worker to be useful */
+          if(numa_nb_nodes == nb_worker)
+            break;
+
+          n = &numa_nodes[numa_nb_nodes];
+          n->node_id = node;
+          snprintf(path, sizeof(path), NUMA_SYSFS_ROOT "/node%u/cpulist",
+                   node);
+          if(numa_read_list(path, &n->cpus) != 0 ||
+             CPU_COUNT(&n->cpus) == 0)
+            {
+              /* Memory-only node, nothing can run there */
+              continue;
+            }
+          for(cpu = 0; cpu < CPU_SETSIZE; cpu++)
+            if(CPU_ISSET(cpu, &n->cpus))
+              numa_cpu_to_node[cpu] = numa_nb_nodes;
+          numa_nb_nodes++;
+        }
+
+      if(numa_nb_nodes > 1)
+        numa_enabled = 1;
+      else
+        numa_nb_nodes = 1;
+    }
+  else if(enable)
+    {
+      LogWarn(COMPONENT_INIT,
+              "NUMA: cannot read %s/online, NUMA awareness disabled",
+              NUMA_SYSFS_ROOT);
+    }
+
+  if(!numa_enabled)
+    {
+      /* One node spanning every CPU */
+      numa_nodes[0].node_id = 0;
+      CPU_ZERO(&numa_nodes[0].cpus);
+      for(cpu = 0; cpu < CPU_SETSIZE; cpu++)
+        CPU_SET(cpu, &numa_nodes[0].cpus);
+    }
+
+  /* Partition the workers in contiguous groups, one per node.  The
+   * slow workers are spread the same way and come last in each group,
+   * which always keeps at least one fast worker. */
+  for(i = 0; i < numa_nb_nodes; i++)
+    {
+      unsigned int first = (i * nb_worker) / numa_nb_nodes;
+      unsigned int next = ((i + 1) * nb_worker) / numa_nb_nodes;
+      unsigned int slow = ((i + 1) * nb_slow_worker) / numa_nb_nodes -
+                          (i * nb_slow_worker) / numa_nb_nodes;
+
+      if(slow >= next - first)
+        slow = next - first - 1;
+
+      numa_nodes[i].first_worker = first;
+      numa_nodes[i].nb_worker = next - first;
+      numa_nodes[i].nb_slow_worker = slow;
+      numa_nodes[i].last_worker = first;
+      numa_nodes[i].last_slow_worker = next - slow;
+      numa_nodes[i].next_chan = 0;
+    }
+
+  numa_nb_ifaces = 0;
+  for(i = 0; numa_enabled && i < nb_ifaces && i < NFS_NUMA_MAX_IFACES; i++)
+    numa_ifaces[numa_nb_ifaces++] = ifaces[i];
+
+  if(numa_enabled)
+    for(i = 0; i < numa_nb_nodes; i++)
+      LogInfo(COMPONENT_INIT,
+              "NUMA: node %u has %d cpus and workers #%u to #%u, "
+              "%u of them slow",
+              numa_nodes[i].node_id, CPU_COUNT(&numa_nodes[i].cpus),
+              numa_nodes[i].first_worker,
+              numa_nodes[i].first_worker + numa_nodes[i].nb_worker - 1,
+              numa_nodes[i].nb_slow_worker);
+  else
+    LogDebug(COMPONENT_INIT, "NUMA awareness is disabled");
+
+  return 0;
+}
+
+int
+nfs_numa_enabled(void)
+{
+  return numa_enabled;
+}
+
+unsigned int
+nfs_numa_nb_nodes(void)
+{
+  return numa_nb_nodes;
+}
+
+nfs_numa_node_t *
+nfs_numa_get_node(unsigned int idx)
+{
+  return &numa_nodes[idx < numa_nb_nodes ? idx : 0];
+}
+
+/**
+ * @brief Return the node index a worker belongs to
+ */
+
+unsigned int
+nfs_numa_worker_node(unsigned int worker_index)
+{
+  unsigned int i;
+
+  for(i = 0; i < numa_nb_nodes; i++)
+    if(worker_index < numa_nodes[i].first_worker + numa_nodes[i].nb_worker)
+      return i;
+
+  return 0;
+}
+
+/**
+ * @brief Map a local address to a node index using the bindings
+ *
+ * @return The node index or NFS_NUMA_NODE_ANY if not bound.
+ */
+
+unsigned int
+nfs_numa_addr_node(const struct sockaddr_storage *addr)
+{
+  const struct sockaddr_in *sin = (const struct sockaddr_in *) addr;
+  unsigned int i, j;
+
+  if(!numa_enabled || addr->ss_family != AF_INET)
+    return NFS_NUMA_NODE_ANY;
+
+  for(i = 0; i < numa_nb_ifaces; i++)
+    {
+      if(numa_ifaces[i].addr.s_addr != sin->sin_addr.s_addr)
+        continue;
+      for(j = 0; j < numa_nb_nodes; j++)
+        if(numa_nodes[j].node_id == numa_ifaces[i].node_id)
+          return j;
+    }
+
+  return NFS_NUMA_NODE_ANY;
+}
+
+/**
+ * @brief Map the local end of a connected socket to a node index
+ */
+
+unsigned int
+nfs_numa_fd_node(int fd)
+{
+  struct sockaddr_storage ss;
+  socklen_t len = sizeof(ss);
+
+  if(!numa_enabled || numa_nb_ifaces == 0)
+    return NFS_NUMA_NODE_ANY;
+
+  if(getsockname(fd, (struct sockaddr *) &ss, &len) != 0)
+    return NFS_NUMA_NODE_ANY;
+
+  return nfs_numa_addr_node(&ss);
+}
+
+/**
+ * @brief Pin the calling thread to the CPUs of a node
+ *
+ * The node is also remembered so that pools using the NUMA substrate
+ * allocate from it without asking the kernel.
+ *
+ * @param[in] idx Node index
+ *
+ * @return 0 on success, an errno otherwise.
+ */
+
+int
+nfs_numa_bind_thread(unsigned int idx)
+{
+  int rc;
+
+  if(!numa_enabled)
+    return 0;
+
+  if(idx >= numa_nb_nodes)
+    return EINVAL;
+
+  rc = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                              &numa_nodes[idx].cpus);
+  if(rc != 0)
+    {
+      LogWarn(COMPONENT_THREAD,
+              "NUMA: could not bind thread to node %u, error %d (%s)",
+              numa_nodes[idx].node_id, rc, strerror(rc));
+      return rc;
+    }
+
+  numa_thread_idx = idx;
+  return 0;
+}
+
+/**
+ * @brief Return the node index of the calling thread
+ */
+
+unsigned int
+nfs_numa_thread_node(void)
+{
+  int cpu;
+
+  if(!numa_enabled)
+    return 0;
+
+  if(numa_thread_idx >= 0)
+    return numa_thread_idx;
+
+  cpu = sched_getcpu();
+  if(cpu < 0 || cpu >= CPU_SETSIZE)
+    return 0;
+
+  return numa_cpu_to_node[cpu];
+}
+
+/**
+ * @brief Parse an "address:node" interface binding
+ *
+ * @param[in]  str   The string from the configuration file
+ * @param[out] iface The parsed binding
+ *
+ * @return 0 on success, -1 on a malformed binding.
+ */
+
+int
+nfs_numa_parse_iface(const char *str, nfs_numa_iface_t *iface)
+{
+  char buf[INET_ADDRSTRLEN + 16];
+  char *sep, *end;
+  long node;
+
+  if(strlen(str) >= sizeof(buf))
+    return -1;
+  strcpy(buf, str);
+
+  if((sep = strrchr(buf, ':')) == NULL)
+    return -1;
+  *sep = '\0';
+
+  node = strtol(sep + 1, &end, 10);
+  if(end == sep + 1 || *end != '\0' || node < 0)
+    return -1;
+
+  if(inet_pton(AF_INET, buf, &iface->addr) != 1)
+    return -1;
+
+  iface->node_id = node;
+  return 0;
+}
+
+/*
+ * NUMA pool substrate
+ */
+
+/* Hidden per-object header, kept at 16 bytes to preserve malloc
+   alignment of the object proper */
+typedef union numa_obj_hdr
+{
+  struct
+  {
+    union numa_obj_hdr *next;
+    uint32_t node;
+  } h;
+  char pad[16];
+} numa_obj_hdr_t;
+
+struct numa_pool_list
+{
+  pthread_mutex_t mtx;
+  numa_obj_hdr_t *head;
+  unsigned int count;
+};
+
+struct numa_pool_data
+{
+  unsigned int max_cached;
+  struct numa_pool_list list[];
+};
+
+static inline struct numa_pool_data *
+numa_pool_data(pool_t *pool)
+{
+  return (struct numa_pool_data *) pool->substrate_data;
+}
+
+static pool_t *
+pool_numa_initializer(size_t size __attribute__((unused)),
+                      void *param)
+{
+  struct pool_numa_params *params = param;
+  struct numa_pool_data *data;
+  pool_t *pool;
+  unsigned int i;
+
+  /* pool_t followed by one free list per node */
+  pool = gsh_malloc(sizeof(pool_t) + sizeof(struct numa_pool_data) +
+                    numa_nb_nodes * sizeof(struct numa_pool_list));
+  if(pool == NULL)
+    return NULL;
+
+  data = numa_pool_data(pool);
+  data->max_cached = 0;
+  if(numa_enabled)
+    data->max_cached = (params != NULL) ? params->max_cached
+                                        : POOL_NUMA_DEFAULT_CACHED;
+
+  for(i = 0; i < numa_nb_nodes; i++)
+    {
+      pthread_mutex_init(&data->list[i].mtx, NULL);
+      data->list[i].head = NULL;
+      data->list[i].count = 0;
+    }
+
+  return pool;
+}
+
+static void
+pool_numa_destroy(pool_t *pool)
+{
+  struct numa_pool_data *data = numa_pool_data(pool);
+  numa_obj_hdr_t *hdr;
+  unsigned int i;
+
+  for(i = 0; i < numa_nb_nodes; i++)
+    {
+      while((hdr = data->list[i].head) != NULL)
+        {
+          data->list[i].head = hdr->h.next;
+          gsh_free(hdr);
+        }
+      pthread_mutex_destroy(&data->list[i].mtx);
+    }
+
+  gsh_free(pool->name);
+  gsh_free(pool);
+}
+
+static void *
+pool_numa_alloc(pool_t *pool)
+{
+  struct numa_pool_data *data = numa_pool_data(pool);
+  numa_obj_hdr_t *hdr = NULL;
+  unsigned int node = nfs_numa_thread_node();
+
+  if(data->max_cached != 0)
+    {
+      struct numa_pool_list *list = &data->list[node];
+
+      pthread_mutex_lock(&list->mtx);
+      if((hdr = list->head) != NULL)
+        {
+          list->head = hdr->h.next;
+          list->count--;
+        }
+      pthread_mutex_unlock(&list->mtx);
+    }
+
+  if(hdr == NULL)
+    {
+      /* Fresh memory is first touched here, on the caller's node */
+      hdr = gsh_malloc(sizeof(numa_obj_hdr_t) + pool->object_size);
+      if(hdr == NULL)
+        return NULL;
+      hdr->h.node = node;
+    }
+
+  /* Same contract as the basic substrate: objects without a
+     constructor come back zeroed */
+  if(pool->constructor == NULL)
+    memset(hdr + 1, 0, pool->object_size);
+
+  return hdr + 1;
+}
+
+static void
+pool_numa_free(pool_t *pool, void *object)
+{
+  struct numa_pool_data *data = numa_pool_data(pool);
+  numa_obj_hdr_t *hdr = ((numa_obj_hdr_t *) object) - 1;
+  struct numa_pool_list *list = &data->list[hdr->h.node];
+
+  if(data->max_cached != 0)
+    {
+      pthread_mutex_lock(&list->mtx);
+      if(list->count < data->max_cached)
+        {
+          hdr->h.next = list->head;
+          list->head = hdr;
+          list->count++;
+          hdr = NULL;
+        }
+      pthread_mutex_unlock(&list->mtx);
+    }
+
+  if(hdr != NULL)
+    gsh_free(hdr);
+}
+
+const struct pool_substrate_vector pool_numa_substrate[] = {
+     {.initializer = pool_numa_initializer,
+      .destroyer = pool_numa_destroy,
+      .allocator = pool_numa_alloc,
+      .freer = pool_numa_free}
+};
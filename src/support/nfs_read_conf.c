@@ -243,6 +243,18 @@ int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam)
         {
           pparam->nb_call_before_queue_avg = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Nb_Slow_Worker"))
+        {
+          pparam->nb_slow_worker = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Slow_IO_Size"))
+        {
+          pparam->slow_io_size = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "Slow_Readdir_Size"))
+        {
+          pparam->slow_readdir_size = atoi(key_value);
+        }
       else if(!strcasecmp(key_name, "Nb_MaxConcurrentGC"))
         {
           pparam->nb_max_concurrent_gc = atoi(key_value);
@@ -447,6 +459,45 @@ int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam)
         {
           pparam->clustered = StrToBoolean(key_value);
         }
+#ifdef _USE_FSAL_UP
+      else if(!strcasecmp(key_name, "Nb_FSAL_UP_Process"))
+        {
+          pparam->nb_fsal_up_process = atoi(key_value);
+        }
+      else if(!strcasecmp(key_name, "FSAL_UP_Process_Batch"))
+        {
+          pparam->fsal_up_process_batch = atoi(key_value);
+        }
+#endif
+      else if(!strcasecmp(key_name, "NUMA_Aware"))
+        {
+          pparam->numa_aware = StrToBoolean(key_value);
+        }
+      else if(!strcasecmp(key_name, "Read_Splice"))
+        {
+          pparam->read_splice = StrToBoolean(key_value);
+        }
+      else if(!strcasecmp(key_name, "NUMA_Interface_Node"))
+        {
+          /* "address:node", may be given several times */
+          if(pparam->numa_nb_ifaces == NFS_NUMA_MAX_IFACES)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "Too many NUMA_Interface_Node entries (max %d)",
+                      NFS_NUMA_MAX_IFACES);
+              return -1;
+            }
+          if(nfs_numa_parse_iface(key_value,
+                                  &pparam->numa_ifaces[pparam->numa_nb_ifaces])
+             != 0)
+            {
+              LogCrit(COMPONENT_CONFIG,
+                      "Invalid NUMA_Interface_Node \"%s\", expected "
+                      "\"address:node\"", key_value);
+              return -1;
+            }
+          pparam->numa_nb_ifaces++;
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -460,6 +511,25 @@ int nfs_read_core_conf(config_file_t in_config, nfs_core_parameter_t * pparam)
   return 0;
 }                               /* nfs_read_core_conf */
 
+/**
+ *
+ * nfs_read_open_addr_conf: reads the Open_Addressing key of a hash table block.
+ *
+ * Sets or clears HT_FLAG_OPEN_ADDR in the hash parameters, shared by
+ * every block that configures a hash table.
+ *
+ * @param hparam [OUT] hash parameters to update
+ * @param key_value [IN] value of the key
+ *
+ */
+void nfs_read_open_addr_conf(hash_parameter_t * hparam, char *key_value)
+{
+  if(StrToBoolean(key_value) == 1)
+    hparam->flags |= HT_FLAG_OPEN_ADDR;
+  else
+    hparam->flags &= ~HT_FLAG_OPEN_ADDR;
+}                               /* nfs_read_open_addr_conf */
+
 /**
  *
  * nfs_read_dupreq_hash_conf: reads the configuration for the hash in Duplicate Request layer.
@@ -528,6 +598,10 @@ int nfs_read_dupreq_hash_conf(config_file_t in_config,
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -605,6 +679,10 @@ int nfs_read_ip_name_conf(config_file_t in_config, nfs_ip_name_parameter_t * ppa
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else if(!strcasecmp(key_name, "Expiration_Time"))
         {
           pparam->expiration_time = atoi(key_value);
@@ -687,6 +765,14 @@ int nfs_read_client_id_conf(config_file_t in_config, nfs_client_id_parameter_t *
           pparam->cid_confirmed_hash_param.alphabet_length = atoi(key_value);
           pparam->cr_hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->cid_unconfirmed_hash_param,
+                                  key_value);
+          nfs_read_open_addr_conf(&pparam->cid_confirmed_hash_param,
+                                  key_value);
+          nfs_read_open_addr_conf(&pparam->cr_hash_param, key_value);
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -757,6 +843,10 @@ int nfs_read_state_id_conf(config_file_t in_config, nfs_state_id_parameter_t * p
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -816,6 +906,10 @@ int nfs_read_session_id_conf(config_file_t in_config, nfs_session_id_parameter_t
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else
         {
           LogCrit(COMPONENT_CONFIG,
@@ -897,6 +991,10 @@ int nfs_read_uidmap_conf(config_file_t in_config, nfs_idmap_cache_parameter_t *
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else if(!strcasecmp(key_name, "Map"))
         {
           strncpy(pparam->mapfile, key_value, MAXPATHLEN);
@@ -980,6 +1078,10 @@ int nfs_read_gidmap_conf(config_file_t in_config, nfs_idmap_cache_parameter_t *
         {
           pparam->hash_param.alphabet_length = atoi(key_value);
         }
+      else if(!strcasecmp(key_name, "Open_Addressing"))
+        {
+          nfs_read_open_addr_conf(&pparam->hash_param, key_value);
+        }
       else if(!strcasecmp(key_name, "Map"))
         {
           strncpy(pparam->mapfile, key_value, MAXPATHLEN);
@@ -1211,6 +1313,9 @@ void Print_param_in_log()
   LogInfo(COMPONENT_INIT,
           "NFS PARAM : core_param.nb_worker = %d",
           nfs_param.core_param.nb_worker);
+  LogInfo(COMPONENT_INIT,
+          "NFS PARAM : core_param.nb_slow_worker = %u",
+          nfs_param.core_param.nb_slow_worker);
   Print_param_worker_in_log(&nfs_param.worker_param);
 }                               /* Print_param_in_log */
 
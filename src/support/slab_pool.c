@@ -0,0 +1,1054 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   slab_pool.c
+ * @brief  Slab pool substrate with per-thread magazines
+ *
+ * See @ref SlabPoolSubstrate for the design.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "log.h"
+#include "abstract_atomic.h"
+#include "nlm_list.h"
+#include "nfs_numa.h"
+#include "slab_pool.h"
+
+/* Smallest slab, slabs are always a power of two in size */
+#define SLAB_MIN_SIZE (64 * 1024)
+/* Slabs are grown until they hold at least this many objects */
+#define SLAB_MIN_OBJECTS 8
+/* Alignment of every object, that of malloc */
+#define SLAB_ALIGN 16
+/* Number of pools that can have per-thread magazines */
+#define SLAB_MAX_CACHED_POOLS 1024
+#define SLAB_NO_CACHE UINT32_MAX
+/* Full and empty magazines kept in each node's depot */
+#define SLAB_DEPOT_MAX_MAGS 16
+
+struct slab_magazine
+{
+  struct slab_magazine *next; /*< Next magazine in the depot */
+  unsigned int rounds; /*< Number of objects held */
+  void *round[]; /*< The objects */
+};
+
+/**
+ * @brief Header at the start of every slab
+ *
+ * A slab is in its node's partial list when some of its objects are
+ * free, in the empty list when all are, and on no list at all when
+ * none are.
+ */
+
+struct slab
+{
+  struct glist_head link; /*< Partial or empty list of the node */
+  char *base; /*< First object */
+  uint32_t node; /*< Node index the slab was allocated on */
+  uint32_t nfree; /*< Free objects, top of the free stack */
+  uint32_t free[]; /*< Stack of free object indices */
+};
+
+struct slab_node
+{
+  pthread_mutex_t mtx; /*< Protects everything below */
+  struct glist_head partial; /*< Slabs with some free objects */
+  struct glist_head empty; /*< Slabs with only free objects */
+  unsigned int nb_empty; /*< Length of the empty list */
+  struct slab_magazine *full_mags; /*< Depot of full magazines */
+  unsigned int nb_full_mags;
+  struct slab_magazine *empty_mags; /*< Depot of empty magazines */
+  unsigned int nb_empty_mags;
+};
+
+/**
+ * @brief Per-thread, per-pool cache
+ */
+
+struct slab_tcache
+{
+  struct glist_head link; /*< In the pool's list of caches */
+  struct slab_tcache **slot; /*< Thread-local slot pointing here */
+  unsigned int node; /*< Node of the owning thread */
+  struct slab_magazine *loaded; /*< Magazine allocated from first */
+  struct slab_magazine *previous; /*< Spare magazine */
+  uint64_t allocs; /*< Allocations not yet folded in the stats */
+  uint64_t frees; /*< Frees not yet folded in the stats */
+};
+
+struct slab_pool_data
+{
+  struct glist_head all; /*< In slab_pools */
+  pool_t *pool; /*< The pool we belong to */
+  uint32_t id; /*< Index of our thread-local slot */
+  size_t obj_size; /*< Object size rounded to SLAB_ALIGN */
+  size_t slab_size; /*< Size and alignment of a slab */
+  size_t base_off; /*< Offset of the first object in a slab */
+  uint32_t nobj; /*< Objects per slab */
+  unsigned int mag_size; /*< Objects per magazine */
+  unsigned int max_empty; /*< Empty slabs kept per node */
+  pool_constructor_t ctor; /*< Cached constructor */
+  pool_destructor_t dtor; /*< Cached destructor */
+  void *ctor_arg; /*< Argument to the cached constructor */
+  uint32_t flags; /*< POOL_SLAB_ flags */
+  struct glist_head caches; /*< Thread caches, under slab_mtx */
+  pthread_mutex_t stats_mtx; /*< Protects the counters in stats */
+  struct pool_slab_stats stats; /*< slabs and bytes are atomic */
+  unsigned int nb_nodes; /*< Number of entries in node */
+  struct slab_node node[];
+};
+
+/* Protects slab_pools, slab_next_id and the caches of every pool */
+static pthread_mutex_t slab_mtx = PTHREAD_MUTEX_INITIALIZER;
+static GLIST_HEAD(slab_pools);
+static uint32_t slab_next_id = 0;
+
+static pthread_once_t slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t slab_key;
+static __thread int slab_key_set = 0;
+static __thread struct slab_tcache *slab_tcaches[SLAB_MAX_CACHED_POOLS];
+
+static inline struct slab_pool_data *
+slab_data(pool_t *pool)
+{
+  return (struct slab_pool_data *) pool->substrate_data;
+}
+
+static inline struct slab *
+slab_of(struct slab_pool_data *d, void *object)
+{
+  return (struct slab *) ((uintptr_t) object & ~(d->slab_size - 1));
+}
+
+static inline unsigned int
+slab_node_index(struct slab_pool_data *d)
+{
+  unsigned int node = nfs_numa_thread_node();
+
+  /* Pools created before the topology was known have one node */
+  return (node < d->nb_nodes) ? node : 0;
+}
+
+static void
+slab_account(struct slab_pool_data *d, uint64_t allocs, uint64_t frees)
+{
+  pthread_mutex_lock(&d->stats_mtx);
+  d->stats.allocs += allocs;
+  d->stats.frees += frees;
+  /* Frees may be folded before the matching allocations */
+  d->stats.live = (d->stats.allocs > d->stats.frees)
+    ? d->stats.allocs - d->stats.frees : 0;
+  if(d->stats.live > d->stats.high_water)
+    d->stats.high_water = d->stats.live;
+  pthread_mutex_unlock(&d->stats_mtx);
+}
+
+static inline void
+slab_fold(struct slab_pool_data *d, struct slab_tcache *tc)
+{
+  if(tc->allocs == 0 && tc->frees == 0)
+    return;
+  slab_account(d, tc->allocs, tc->frees);
+  tc->allocs = 0;
+  tc->frees = 0;
+}
+
+/*
+ * Slab layer
+ */
+
+/**
+ * @brief Map an aligned slab
+ *
+ * Slabs come straight from the kernel so that releasing one really
+ * gives the memory back.  Alignment on the slab size lets us find
+ * the slab of any object by masking its address.
+ */
+
+static char *
+slab_map(size_t size)
+{
+  char *mem, *aligned;
+  size_t len = 2 * size;
+
+  mem = mmap(NULL, len, PROT_READ | PROT_WRITE,
+             MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if(mem == MAP_FAILED)
+    return NULL;
+
+  aligned = (char *) (((uintptr_t) mem + size - 1) & ~(size - 1));
+  if(aligned > mem)
+    munmap(mem, aligned - mem);
+  if(mem + len > aligned + size)
+    munmap(aligned + size, (mem + len) - (aligned + size));
+
+  return aligned;
+}
+
+/**
+ * @brief Create a slab on a node, constructing its objects
+ *
+ * Called without any lock held.  The memory is first touched here,
+ * by a thread of the node the slab is for.
+ */
+
+static struct slab *
+slab_create(struct slab_pool_data *d, unsigned int node)
+{
+  struct slab *s;
+  uint32_t i;
+
+  s = (struct slab *) slab_map(d->slab_size);
+  if(s == NULL)
+    {
+      LogMajor(COMPONENT_MEMALLOC,
+               "Unable to map a %zu byte slab: %s",
+               d->slab_size, strerror(errno));
+      return NULL;
+    }
+
+  s->base = (char *) s + d->base_off;
+  s->node = node;
+  s->nfree = d->nobj;
+  /* Hand objects out in address order */
+  for(i = 0; i < d->nobj; i++)
+    s->free[i] = d->nobj - 1 - i;
+
+  if(d->ctor != NULL)
+    for(i = 0; i < d->nobj; i++)
+      d->ctor(s->base + (size_t) i * d->obj_size, d->ctor_arg);
+
+  atomic_inc_uint64_t(&d->stats.slabs);
+  atomic_add_uint64_t(&d->stats.bytes, d->slab_size);
+
+  return s;
+}
+
+/**
+ * @brief Give the memory of a slab back to the system
+ *
+ * With _DEBUG_MEMLEAKS the range stays reserved but inaccessible, so
+ * that an object pointer kept past its pool_free faults, rather than
+ * reaching into a slab mapped later at the same address.
+ */
+
+static void
+slab_unmap(struct slab_pool_data *d, struct slab *s)
+{
+#ifdef _DEBUG_MEMLEAKS
+  if(mprotect(s, d->slab_size, PROT_NONE) == 0)
+    return;
+#endif
+  munmap(s, d->slab_size);
+}
+
+/**
+ * @brief Destroy every slab on a detached list and unmap it
+ *
+ * Called without the node lock held.
+ *
+ * @return The number of bytes released.
+ */
+
+static size_t
+slab_release_list(struct slab_pool_data *d, struct glist_head *list)
+{
+  struct glist_head *glist, *glistn;
+  size_t released = 0;
+  uint32_t i;
+
+  glist_for_each_safe(glist, glistn, list)
+    {
+      struct slab *s = glist_entry(glist, struct slab, link);
+
+      glist_del(&s->link);
+      if(d->dtor != NULL)
+        for(i = 0; i < d->nobj; i++)
+          d->dtor(s->base + (size_t) i * d->obj_size);
+      atomic_dec_uint64_t(&d->stats.slabs);
+      atomic_sub_uint64_t(&d->stats.bytes, d->slab_size);
+      released += d->slab_size;
+      slab_unmap(d, s);
+    }
+
+  return released;
+}
+
+/**
+ * @brief Take up to count objects from the slabs of a node
+ *
+ * The node lock must be held.
+ *
+ * @return The number of objects taken.
+ */
+
+static unsigned int
+slab_take(struct slab_pool_data *d, struct slab_node *n,
+          void **objs, unsigned int count)
+{
+  unsigned int got = 0;
+  struct slab *s;
+
+  while(got < count)
+    {
+      s = glist_first_entry(&n->partial, struct slab, link);
+      if(s == NULL)
+        {
+          s = glist_first_entry(&n->empty, struct slab, link);
+          if(s == NULL)
+            break;
+          glist_del(&s->link);
+          n->nb_empty--;
+          glist_add(&n->partial, &s->link);
+        }
+      while(got < count && s->nfree > 0)
+        {
+          s->nfree--;
+          objs[got++] = s->base + (size_t) s->free[s->nfree] * d->obj_size;
+        }
+      if(s->nfree == 0)
+        glist_del(&s->link);
+    }
+
+  return got;
+}
+
+/**
+ * @brief Return objects to their slabs
+ *
+ * The lock of the node the objects belong to must be held.  Slabs
+ * that become empty beyond the max_empty limit are moved to release,
+ * to be released once the lock is dropped.
+ */
+
+static void
+slab_put(struct slab_pool_data *d, struct slab_node *n,
+         void **objs, unsigned int count, struct glist_head *release)
+{
+  unsigned int i;
+  struct slab *s;
+
+  for(i = 0; i < count; i++)
+    {
+      s = slab_of(d, objs[i]);
+      s->free[s->nfree++] = ((char *) objs[i] - s->base) / d->obj_size;
+      if(s->nfree == 1)
+        glist_add(&n->partial, &s->link);
+      if(s->nfree == d->nobj)
+        {
+          glist_del(&s->link);
+          if(n->nb_empty < d->max_empty)
+            {
+              glist_add(&n->empty, &s->link);
+              n->nb_empty++;
+            }
+          else
+            glist_add(release, &s->link);
+        }
+    }
+}
+
+/**
+ * @brief Take objects from a node, growing it if needed
+ *
+ * Called without the node lock held.
+ */
+
+static unsigned int
+slab_take_grow(struct slab_pool_data *d, unsigned int node,
+               void **objs, unsigned int count)
+{
+  struct slab_node *n = &d->node[node];
+  unsigned int got;
+  struct slab *s;
+
+  pthread_mutex_lock(&n->mtx);
+  got = slab_take(d, n, objs, count);
+  pthread_mutex_unlock(&n->mtx);
+  if(got != 0)
+    return got;
+
+  if((s = slab_create(d, node)) == NULL)
+    return 0;
+
+  pthread_mutex_lock(&n->mtx);
+  glist_add(&n->empty, &s->link);
+  n->nb_empty++;
+  got = slab_take(d, n, objs, count);
+  pthread_mutex_unlock(&n->mtx);
+
+  return got;
+}
+
+/*
+ * Magazine layer
+ */
+
+static struct slab_magazine *
+slab_mag_new(struct slab_pool_data *d)
+{
+  struct slab_magazine *mag;
+
+  mag = gsh_malloc(sizeof(struct slab_magazine) +
+                   d->mag_size * sizeof(void *));
+  if(mag != NULL)
+    {
+      mag->next = NULL;
+      mag->rounds = 0;
+    }
+  return mag;
+}
+
+/**
+ * @brief Return every object of the depot to the slabs
+ *
+ * The node lock must be held.  The magazines themselves are put on
+ * the spare list for the caller to free.
+ */
+
+static void
+slab_depot_drain(struct slab_pool_data *d, struct slab_node *n,
+                 struct slab_magazine **spare, struct glist_head *release)
+{
+  struct slab_magazine *mag;
+
+  while((mag = n->full_mags) != NULL)
+    {
+      n->full_mags = mag->next;
+      slab_put(d, n, mag->round, mag->rounds, release);
+      mag->next = *spare;
+      *spare = mag;
+    }
+  n->nb_full_mags = 0;
+
+  while((mag = n->empty_mags) != NULL)
+    {
+      n->empty_mags = mag->next;
+      mag->next = *spare;
+      *spare = mag;
+    }
+  n->nb_empty_mags = 0;
+}
+
+static void
+slab_mag_free_list(struct slab_magazine *mag)
+{
+  struct slab_magazine *next;
+
+  for(; mag != NULL; mag = next)
+    {
+      next = mag->next;
+      gsh_free(mag);
+    }
+}
+
+/**
+ * @brief Return a thread cache's objects to the slabs and free it
+ *
+ * slab_mtx must be held.
+ */
+
+static void
+slab_tcache_release(struct slab_pool_data *d, struct slab_tcache *tc)
+{
+  struct slab_node *n = &d->node[tc->node];
+  GLIST_HEAD(release);
+
+  pthread_mutex_lock(&n->mtx);
+  slab_put(d, n, tc->loaded->round, tc->loaded->rounds, &release);
+  slab_put(d, n, tc->previous->round, tc->previous->rounds, &release);
+  pthread_mutex_unlock(&n->mtx);
+  slab_release_list(d, &release);
+
+  slab_fold(d, tc);
+  glist_del(&tc->link);
+  *tc->slot = NULL;
+  gsh_free(tc->loaded);
+  gsh_free(tc->previous);
+  gsh_free(tc);
+}
+
+/**
+ * @brief Thread exit hook, give the thread's magazines back
+ */
+
+static void
+slab_thread_exit(void *arg)
+{
+  struct slab_tcache **caches = arg;
+  struct slab_pool_data *d;
+  struct glist_head *glist;
+
+  pthread_mutex_lock(&slab_mtx);
+  glist_for_each(glist, &slab_pools)
+    {
+      d = glist_entry(glist, struct slab_pool_data, all);
+      if(d->id != SLAB_NO_CACHE && caches[d->id] != NULL)
+        slab_tcache_release(d, caches[d->id]);
+    }
+  pthread_mutex_unlock(&slab_mtx);
+}
+
+static void
+slab_key_create(void)
+{
+  if(pthread_key_create(&slab_key, slab_thread_exit) != 0)
+    LogFatal(COMPONENT_MEMALLOC,
+             "Unable to create the slab pool thread key");
+}
+
+static struct slab_tcache *
+slab_tcache_create(struct slab_pool_data *d)
+{
+  struct slab_tcache *tc;
+
+  pthread_once(&slab_once, slab_key_create);
+
+  if((tc = gsh_calloc(1, sizeof(struct slab_tcache))) == NULL)
+    return NULL;
+  tc->loaded = slab_mag_new(d);
+  tc->previous = slab_mag_new(d);
+  if(tc->loaded == NULL || tc->previous == NULL)
+    {
+      gsh_free(tc->loaded);
+      gsh_free(tc->previous);
+      gsh_free(tc);
+      return NULL;
+    }
+  tc->node = slab_node_index(d);
+  tc->slot = &slab_tcaches[d->id];
+
+  pthread_mutex_lock(&slab_mtx);
+  glist_add(&d->caches, &tc->link);
+  pthread_mutex_unlock(&slab_mtx);
+
+  if(!slab_key_set)
+    {
+      pthread_setspecific(slab_key, slab_tcaches);
+      slab_key_set = 1;
+    }
+
+  slab_tcaches[d->id] = tc;
+  return tc;
+}
+
+static inline struct slab_tcache *
+slab_tcache_get(struct slab_pool_data *d)
+{
+  struct slab_tcache *tc;
+
+  if(d->id == SLAB_NO_CACHE)
+    return NULL;
+  if((tc = slab_tcaches[d->id]) != NULL)
+    return tc;
+  return slab_tcache_create(d);
+}
+
+/**
+ * @brief Refill an empty thread cache
+ *
+ * Both magazines are empty.  Swap the loaded one for a full magazine
+ * from the depot or, failing that, fill it from the slabs.
+ *
+ * @return The number of objects now in the loaded magazine.
+ */
+
+static unsigned int
+slab_reload(struct slab_pool_data *d, struct slab_tcache *tc)
+{
+  struct slab_node *n = &d->node[tc->node];
+  struct slab_magazine *full, *spare = NULL;
+
+  pthread_mutex_lock(&n->mtx);
+  if((full = n->full_mags) != NULL)
+    {
+      n->full_mags = full->next;
+      n->nb_full_mags--;
+      if(n->nb_empty_mags < SLAB_DEPOT_MAX_MAGS)
+        {
+          tc->loaded->next = n->empty_mags;
+          n->empty_mags = tc->loaded;
+          n->nb_empty_mags++;
+        }
+      else
+        spare = tc->loaded;
+      tc->loaded = full;
+    }
+  pthread_mutex_unlock(&n->mtx);
+
+  gsh_free(spare);
+  slab_fold(d, tc);
+
+  if(full == NULL)
+    tc->loaded->rounds = slab_take_grow(d, tc->node, tc->loaded->round,
+                                        d->mag_size);
+
+  return tc->loaded->rounds;
+}
+
+/**
+ * @brief Make room in a full thread cache
+ *
+ * Both magazines are full.  Trade the previous one for an empty
+ * magazine of the depot or, failing that, empty it into the slabs,
+ * then swap it in.
+ */
+
+static void
+slab_unload(struct slab_pool_data *d, struct slab_tcache *tc)
+{
+  struct slab_node *n = &d->node[tc->node];
+  struct slab_magazine *empty = NULL, *mag;
+  int need_empty;
+  GLIST_HEAD(release);
+
+  /* Allocated outside the lock, a magazine more or less in the depot
+     is harmless */
+  pthread_mutex_lock(&n->mtx);
+  need_empty = (n->empty_mags == NULL);
+  pthread_mutex_unlock(&n->mtx);
+  if(need_empty)
+    empty = slab_mag_new(d);
+
+  pthread_mutex_lock(&n->mtx);
+  if(n->nb_full_mags < SLAB_DEPOT_MAX_MAGS &&
+     (n->empty_mags != NULL || empty != NULL))
+    {
+      if(n->empty_mags != NULL)
+        {
+          mag = n->empty_mags;
+          n->empty_mags = mag->next;
+          n->nb_empty_mags--;
+        }
+      else
+        {
+          mag = empty;
+          empty = NULL;
+        }
+      tc->previous->next = n->full_mags;
+      n->full_mags = tc->previous;
+      n->nb_full_mags++;
+      tc->previous = mag;
+    }
+  else
+    {
+      slab_put(d, n, tc->previous->round, tc->previous->rounds, &release);
+      tc->previous->rounds = 0;
+    }
+  if(empty != NULL && n->nb_empty_mags < SLAB_DEPOT_MAX_MAGS)
+    {
+      empty->next = n->empty_mags;
+      n->empty_mags = empty;
+      n->nb_empty_mags++;
+      empty = NULL;
+    }
+  pthread_mutex_unlock(&n->mtx);
+
+  gsh_free(empty);
+  slab_release_list(d, &release);
+  slab_fold(d, tc);
+
+  mag = tc->loaded;
+  tc->loaded = tc->previous;
+  tc->previous = mag;
+}
+
+/*
+ * Substrate vector
+ */
+
+static pool_t *
+pool_slab_initializer(size_t size, void *param)
+{
+  struct pool_slab_params *params = param;
+  struct slab_pool_data *d;
+  unsigned int nb_nodes = nfs_numa_nb_nodes();
+  unsigned int i;
+  size_t hdr;
+  pool_t *pool;
+
+  pool = gsh_calloc(1, sizeof(pool_t) + sizeof(struct slab_pool_data) +
+                    nb_nodes * sizeof(struct slab_node));
+  if(pool == NULL)
+    return NULL;
+
+  d = slab_data(pool);
+  d->pool = pool;
+  d->nb_nodes = nb_nodes;
+  d->obj_size = (size + SLAB_ALIGN - 1) & ~((size_t) SLAB_ALIGN - 1);
+  if(d->obj_size == 0)
+    d->obj_size = SLAB_ALIGN;
+
+  /* Header, free stack and objects, with slack to align the first
+     object */
+  d->slab_size = SLAB_MIN_SIZE;
+  while((d->slab_size - sizeof(struct slab) - SLAB_ALIGN) /
+        (d->obj_size + sizeof(uint32_t)) < SLAB_MIN_OBJECTS)
+    d->slab_size <<= 1;
+  d->nobj = (d->slab_size - sizeof(struct slab) - SLAB_ALIGN) /
+    (d->obj_size + sizeof(uint32_t));
+  hdr = sizeof(struct slab) + d->nobj * sizeof(uint32_t);
+  d->base_off = (hdr + SLAB_ALIGN - 1) & ~((size_t) SLAB_ALIGN - 1);
+
+  d->max_empty = POOL_SLAB_DEFAULT_MAX_EMPTY;
+  if(params != NULL)
+    {
+      d->mag_size = params->mag_size;
+      d->max_empty = params->max_empty;
+      d->ctor = params->ctor;
+      d->dtor = params->dtor;
+      d->ctor_arg = params->ctor_arg;
+      d->flags = params->flags;
+    }
+  if(d->mag_size == 0)
+    {
+      if(d->obj_size <= 256)
+        d->mag_size = 64;
+      else if(d->obj_size <= 1024)
+        d->mag_size = 32;
+      else if(d->obj_size <= 4096)
+        d->mag_size = 16;
+      else
+        d->mag_size = 8;
+    }
+
+  init_glist(&d->caches);
+  pthread_mutex_init(&d->stats_mtx, NULL);
+  for(i = 0; i < nb_nodes; i++)
+    {
+      pthread_mutex_init(&d->node[i].mtx, NULL);
+      init_glist(&d->node[i].partial);
+      init_glist(&d->node[i].empty);
+    }
+
+  pthread_mutex_lock(&slab_mtx);
+  if(slab_next_id < SLAB_MAX_CACHED_POOLS)
+    d->id = slab_next_id++;
+  else
+    d->id = SLAB_NO_CACHE;
+  glist_add_tail(&slab_pools, &d->all);
+  pthread_mutex_unlock(&slab_mtx);
+
+  if(d->id == SLAB_NO_CACHE)
+    LogInfo(COMPONENT_MEMALLOC,
+            "More than %d slab pools, new pools will not use per-thread "
+            "magazines", SLAB_MAX_CACHED_POOLS);
+
+  return pool;
+}
+
+static void
+pool_slab_destroy(pool_t *pool)
+{
+  struct slab_pool_data *d = slab_data(pool);
+  struct slab_magazine *spare = NULL;
+  struct glist_head *glist, *glistn;
+  unsigned int i;
+  GLIST_HEAD(release);
+
+  pthread_mutex_lock(&slab_mtx);
+  glist_del(&d->all);
+  glist_for_each_safe(glist, glistn, &d->caches)
+    slab_tcache_release(d, glist_entry(glist, struct slab_tcache, link));
+  pthread_mutex_unlock(&slab_mtx);
+
+  for(i = 0; i < d->nb_nodes; i++)
+    {
+      struct slab_node *n = &d->node[i];
+
+      slab_depot_drain(d, n, &spare, &release);
+      /* Anything still partial was leaked by the caller */
+      glist_add_list_tail(&release, &n->empty);
+      glist_add_list_tail(&release, &n->partial);
+      slab_release_list(d, &release);
+      pthread_mutex_destroy(&n->mtx);
+    }
+  slab_mag_free_list(spare);
+
+  pthread_mutex_destroy(&d->stats_mtx);
+  gsh_free(pool->name);
+  gsh_free(pool);
+}
+
+static void *
+pool_slab_alloc(pool_t *pool)
+{
+  struct slab_pool_data *d = slab_data(pool);
+  struct slab_tcache *tc = slab_tcache_get(d);
+  void *object = NULL;
+  struct slab_magazine *mag;
+
+  if(tc != NULL)
+    {
+      if(tc->loaded->rounds == 0)
+        {
+          if(tc->previous->rounds != 0)
+            {
+              mag = tc->loaded;
+              tc->loaded = tc->previous;
+              tc->previous = mag;
+            }
+          else if(slab_reload(d, tc) == 0)
+            return NULL;
+        }
+      object = tc->loaded->round[--tc->loaded->rounds];
+      tc->allocs++;
+    }
+  else
+    {
+      if(slab_take_grow(d, slab_node_index(d), &object, 1) == 0)
+        return NULL;
+      slab_account(d, 1, 0);
+    }
+
+  /* Same contract as the basic substrate */
+  if(pool->constructor == NULL && d->ctor == NULL &&
+     !(d->flags & POOL_SLAB_NO_ZERO))
+    memset(object, 0, pool->object_size);
+
+  return object;
+}
+
+static void
+pool_slab_free(pool_t *pool, void *object)
+{
+  struct slab_pool_data *d = slab_data(pool);
+  struct slab_tcache *tc = slab_tcache_get(d);
+  struct slab *s = slab_of(d, object);
+  struct slab_magazine *mag;
+
+  if(tc == NULL || s->node != tc->node)
+    {
+      /* No cache, or a remote object: straight back to its slab */
+      struct slab_node *n = &d->node[s->node];
+      GLIST_HEAD(release);
+
+      pthread_mutex_lock(&n->mtx);
+      slab_put(d, n, &object, 1, &release);
+      pthread_mutex_unlock(&n->mtx);
+      slab_release_list(d, &release);
+      if(tc != NULL)
+        tc->frees++;
+      else
+        slab_account(d, 0, 1);
+      return;
+    }
+
+  if(tc->loaded->rounds == d->mag_size)
+    {
+      if(tc->previous->rounds == 0)
+        {
+          mag = tc->loaded;
+          tc->loaded = tc->previous;
+          tc->previous = mag;
+        }
+      else
+        slab_unload(d, tc);
+    }
+  tc->loaded->round[tc->loaded->rounds++] = object;
+  tc->frees++;
+}
+
+const struct pool_substrate_vector pool_slab_substrate[] = {
+     {.initializer = pool_slab_initializer,
+      .destroyer = pool_slab_destroy,
+      .allocator = pool_slab_alloc,
+      .freer = pool_slab_free}
+};
+
+/*
+ * Statistics and reclaim
+ */
+
+/* slab_mtx must be held */
+static void
+slab_get_stats(struct slab_pool_data *d, struct pool_slab_stats *stats)
+{
+  struct glist_head *glist;
+
+  pthread_mutex_lock(&d->stats_mtx);
+  *stats = d->stats;
+  pthread_mutex_unlock(&d->stats_mtx);
+
+  /* Unfolded counts are read racily, this is only a report */
+  glist_for_each(glist, &d->caches)
+    {
+      struct slab_tcache *tc = glist_entry(glist, struct slab_tcache, link);
+
+      stats->allocs += tc->allocs;
+      stats->frees += tc->frees;
+    }
+  stats->live = (stats->allocs > stats->frees)
+    ? stats->allocs - stats->frees : 0;
+  if(stats->live > stats->high_water)
+    stats->high_water = stats->live;
+  stats->slabs = atomic_fetch_uint64_t(&d->stats.slabs);
+  stats->bytes = atomic_fetch_uint64_t(&d->stats.bytes);
+}
+
+/**
+ * @brief Get the statistics of a slab pool
+ *
+ * @param[in]  pool  A pool created on the slab substrate
+ * @param[out] stats Its statistics
+ *
+ * @return 0 on success, -1 if the pool is not a slab pool.
+ */
+
+int
+pool_slab_get_stats(pool_t *pool, struct pool_slab_stats *stats)
+{
+  if(pool->substrate_vector != pool_slab_substrate)
+    return -1;
+
+  pthread_mutex_lock(&slab_mtx);
+  slab_get_stats(slab_data(pool), stats);
+  pthread_mutex_unlock(&slab_mtx);
+
+  return 0;
+}
+
+/* slab_mtx must be held */
+static size_t
+slab_reap(struct slab_pool_data *d)
+{
+  struct slab_magazine *spare = NULL;
+  size_t released = 0;
+  unsigned int i;
+  GLIST_HEAD(release);
+
+  for(i = 0; i < d->nb_nodes; i++)
+    {
+      struct slab_node *n = &d->node[i];
+
+      pthread_mutex_lock(&n->mtx);
+      slab_depot_drain(d, n, &spare, &release);
+      glist_add_list_tail(&release, &n->empty);
+      init_glist(&n->empty);
+      n->nb_empty = 0;
+      pthread_mutex_unlock(&n->mtx);
+
+      released += slab_release_list(d, &release);
+    }
+  slab_mag_free_list(spare);
+
+  return released;
+}
+
+/**
+ * @brief Give the free memory of a slab pool back to the system
+ *
+ * Every object cached in the depots is returned to its slab and the
+ * memory of every empty slab is released.  Objects in the per-thread
+ * magazines are left alone.
+ *
+ * @param[in] pool A pool created on the slab substrate
+ *
+ * @return The number of bytes released.
+ */
+
+size_t
+pool_slab_reap(pool_t *pool)
+{
+  size_t released;
+
+  if(pool->substrate_vector != pool_slab_substrate)
+    return 0;
+
+  pthread_mutex_lock(&slab_mtx);
+  released = slab_reap(slab_data(pool));
+  pthread_mutex_unlock(&slab_mtx);
+
+  if(released != 0)
+    LogDebug(COMPONENT_MEMALLOC,
+             "Released %zu bytes from pool %s",
+             released, pool->name ? pool->name : "(unnamed)");
+
+  return released;
+}
+
+/**
+ * @brief Reap every slab pool
+ *
+ * @return The number of bytes released.
+ */
+
+size_t
+pool_slab_reap_all(void)
+{
+  struct glist_head *glist;
+  size_t released = 0;
+
+  pthread_mutex_lock(&slab_mtx);
+  glist_for_each(glist, &slab_pools)
+    released += slab_reap(glist_entry(glist, struct slab_pool_data, all));
+  pthread_mutex_unlock(&slab_mtx);
+
+  if(released != 0)
+    LogDebug(COMPONENT_MEMALLOC,
+             "Released %zu bytes from slab pools", released);
+
+  return released;
+}
+
+/**
+ * @brief Print one line of statistics per slab pool
+ *
+ * The format matches that of the other lines of the stats file.
+ *
+ * @param[in] out     Where to print
+ * @param[in] strdate Date prefix of the stats file lines
+ */
+
+void
+pool_slab_dump_stats(FILE *out, const char *strdate)
+{
+  struct pool_slab_stats stats;
+  struct slab_pool_data *d;
+  struct glist_head *glist;
+
+  pthread_mutex_lock(&slab_mtx);
+  glist_for_each(glist, &slab_pools)
+    {
+      d = glist_entry(glist, struct slab_pool_data, all);
+      slab_get_stats(d, &stats);
+      fprintf(out,
+              "SLAB_POOL,%s;%s,%zu,%"PRIu64",%"PRIu64",%"PRIu64",%"PRIu64
+              ",%"PRIu64",%"PRIu64"\n",
+              strdate, d->pool->name ? d->pool->name : "(unnamed)",
+              d->pool->object_size, stats.allocs, stats.frees, stats.live,
+              stats.high_water, stats.slabs, stats.bytes);
+    }
+  pthread_mutex_unlock(&slab_mtx);
+}
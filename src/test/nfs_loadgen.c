@@ -0,0 +1,1362 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_loadgen.c
+ * @brief  Loopback NFS load generator and regression benchmark
+ *
+ * Drives a running server, ganesha on a local FSAL_VFS export over
+ * tmpfs or an FSAL_MEM export for instance, with many NFS clients
+ * spread over a few TCP connections, and prints what each operation
+ * took as latency histograms, one key=value record per line:
+ *
+ *   run name=... workload=... version=... iter_per_sec=... errors=...
+ *   op name=... op=... count=... mean_us=... p50_us=... p99_us=...
+ *   hist name=... op=... le_us=... count=...
+ *
+ * A workload mix is a comma separated list of workloads, each with an
+ * optional weight: every iteration of a client is one workload picked
+ * at random by weight.
+ *
+ *   metadata  LOOKUP then GETATTR of one of the client's files
+ *   create    create, write 4 KiB, commit, close and remove a file
+ *   seqwrite  write the next chunk of the client's large file
+ *   seqread   read the next chunk of the client's large file
+ *   readdir   read all of a directory shared by the clients
+ *   lock      lock and unlock the byte range every client wants
+ *
+ * Their parameters, given as key=value:
+ *
+ *   files     files of each client for metadata (1000)
+ *   filesize  size of the large files (16 MiB)
+ *   iosize    size of a READ or WRITE (64 KiB)
+ *   entries   entries of the readdir directory (10000)
+ *   remove    whether create removes what it makes (1)
+ *   keep      whether to leave the run directory in place (0)
+ *
+ * Usage:
+ *   nfs_loadgen -s server [-p port] [-e export] [-v 3|4.0|4.1]
+ *               [-n clients] [-m connections] [-d seconds]
+ *               [-w workload[:weight],...] [-o key=value]... [-N name]
+ *   nfs_loadgen -s server [-p port] [-e export] -f suite
+ *   nfs_loadgen -c baseline [-t throughput%] [-l latency%] results
+ *
+ * A suite has one run per line: name, workload mix, version, clients,
+ * connections, seconds, then parameters.  Compare mode reads two sets
+ * of results and exits 1 if a run failed, had more errors than in the
+ * baseline, or lost more than the given share of its throughput, or
+ * if the 99th percentile of one of its operations grew by more than
+ * the other share.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "nfs_loadgen.h"
+#include "nfs23.h"
+#ifdef _USE_NLM
+#include "nlm4.h"
+#endif
+
+#define LG_MAX_CLIENTS 1024
+#define LG_MAX_LINE 1024
+#define LG_NAME_LEN 64
+
+/* latency records below this many calls are too noisy to compare */
+#define LG_COMPARE_MIN_COUNT 100
+
+typedef enum lg_workload_id {
+     LG_WL_METADATA = 0,
+     LG_WL_CREATE,
+     LG_WL_SEQWRITE,
+     LG_WL_SEQREAD,
+     LG_WL_READDIR,
+     LG_WL_LOCK,
+     LG_NB_WL
+} lg_workload_id_t;
+
+typedef struct lg_params {
+     unsigned int files;
+     uint64_t filesize;
+     uint32_t iosize;
+     unsigned int entries;
+     int remove;
+     int keep;
+} lg_params_t;
+
+typedef struct lg_run {
+     char name[LG_NAME_LEN];
+     char mix[LG_NAME_LEN];
+     const lg_proto_t *proto;
+     unsigned int clients;
+     unsigned int conns;
+     unsigned int seconds;
+     unsigned int weights[LG_NB_WL];
+     unsigned int total_weight;
+     lg_params_t params;
+} lg_run_t;
+
+/* A client, with what its workloads hold from one iteration to the next */
+typedef struct lg_worker {
+     lg_client_t cl;
+     const lg_run_t *run;
+     unsigned int seed;
+     lg_fh_t bigdir;
+     lg_file_t big;
+     int big_open;
+     uint64_t rd_offset;
+     uint64_t wr_offset;
+     lg_file_t lockfile;
+     int lockfile_open;
+     uint64_t created;
+} lg_worker_t;
+
+typedef struct lg_workload {
+     const char *name;
+     /* done by the first client, for all */
+     int (*setup_shared) (lg_worker_t *w);
+     void (*cleanup_shared) (lg_worker_t *w);
+     /* done by every client */
+     int (*setup) (lg_worker_t *w);
+     int (*iterate) (lg_worker_t *w);
+     void (*cleanup) (lg_worker_t *w);
+} lg_workload_t;
+
+static const char *lg_op_names[LG_NB_OP] = {
+     "lookup", "getattr", "create", "open", "close", "read", "write",
+     "commit", "remove", "readdir", "lock", "unlock"
+};
+
+const char *lg_server;
+struct timeval lg_timeout = { 25, 0 };
+
+static unsigned short lg_port;
+static const char *lg_export = "/";
+static unsigned int lg_run_index;
+
+static pthread_barrier_t lg_clients_barrier;
+static pthread_barrier_t lg_all_barrier;
+static volatile int lg_stop;
+static volatile int lg_failed;
+static unsigned int lg_rpc_failures;
+
+static uint64_t lg_now_ns(void)
+{
+     struct timespec ts;
+
+     clock_gettime(CLOCK_MONOTONIC, &ts);
+     return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* Four buckets per power of two, exact below four microseconds */
+static unsigned int lg_bucket(uint64_t us)
+{
+     unsigned int e, idx;
+
+     if (us < 4)
+          return us;
+
+     e = 63 - __builtin_clzll(us);
+     idx = 4 + (e - 2) * 4 + ((us >> (e - 2)) & 3);
+
+     return idx < LG_HIST_BUCKETS ? idx : LG_HIST_BUCKETS - 1;
+}
+
+/* The largest value a bucket holds */
+static uint64_t lg_bucket_le(unsigned int idx)
+{
+     unsigned int e, m;
+
+     if (idx < 4)
+          return idx;
+
+     e = (idx - 4) / 4 + 2;
+     m = (idx - 4) % 4;
+
+     return ((uint64_t) (5 + m) << (e - 2)) - 1;
+}
+
+static void lg_record(lg_client_t *cl, lg_op_t op, uint64_t start, int rc)
+{
+     lg_hist_t *hist = &cl->hist[op];
+     uint64_t us;
+
+     if (cl->in_setup)
+          return;
+
+     if (rc == LG_ERROR) {
+          hist->errors++;
+          return;
+     }
+     if (rc == LG_DENIED)
+          hist->denied++;
+
+     us = (lg_now_ns() - start) / 1000;
+     hist->count++;
+     hist->sum_us += us;
+     if (us > hist->max_us)
+          hist->max_us = us;
+     hist->buckets[lg_bucket(us)]++;
+}
+
+#define LG_TIMED(_rc_, _cl_, _op_, _call_) do {                    \
+          uint64_t _start = lg_now_ns();                            \
+          (_rc_) = (_call_);                                        \
+          lg_record((_cl_), (_op_), _start, (_rc_));                \
+     } while (0)
+
+int lg_call(lg_conn_t *conn, rpcproc_t proc, xdrproc_t xargs, void *args,
+            xdrproc_t xres, void *res)
+{
+     enum clnt_stat st;
+
+     pthread_mutex_lock(&conn->lock);
+     st = clnt_call(conn->clnt, proc, xargs, (caddr_t) args, xres,
+                    (caddr_t) res, lg_timeout);
+     pthread_mutex_unlock(&conn->lock);
+
+     if (st == RPC_SUCCESS)
+          return LG_OK;
+
+     /* a dead server fails every call, a few of them say why */
+     if (__sync_fetch_and_add(&lg_rpc_failures, 1) < 10)
+          fprintf(stderr, "procedure %u: %s\n", (unsigned int) proc,
+                  clnt_sperrno(st));
+
+     return LG_ERROR;
+}
+
+void lg_grace_wait(lg_client_t *cl, const char *what)
+{
+     if (cl->id == 0)
+          fprintf(stderr, "%s: server in its grace period, waiting\n",
+                  what);
+     sleep(1);
+}
+
+static int lg_connect(lg_conn_t *conn, rpcprog_t prog, rpcvers_t vers,
+                      unsigned short port)
+{
+     struct addrinfo hints, *ai;
+     struct sockaddr_in addr;
+     int sock = RPC_ANYSOCK;
+
+     if (port == 0) {
+          conn->clnt = clnt_create(lg_server, prog, vers, "tcp");
+     } else {
+          memset(&hints, 0, sizeof(hints));
+          hints.ai_family = AF_INET;
+          hints.ai_socktype = SOCK_STREAM;
+          if (getaddrinfo(lg_server, NULL, &hints, &ai) != 0) {
+               fprintf(stderr, "cannot resolve %s\n", lg_server);
+               return LG_ERROR;
+          }
+          memcpy(&addr, ai->ai_addr, sizeof(addr));
+          freeaddrinfo(ai);
+          addr.sin_port = htons(port);
+          conn->clnt = clnttcp_create(&addr, prog, vers, &sock, 0, 0);
+     }
+
+     if (conn->clnt == NULL) {
+          fprintf(stderr, "%s\n", clnt_spcreateerror(lg_server));
+          return LG_ERROR;
+     }
+     conn->clnt->cl_auth = authunix_create_default();
+     pthread_mutex_init(&conn->lock, NULL);
+
+     return LG_OK;
+}
+
+static void lg_disconnect(lg_conn_t *conn)
+{
+     if (conn->clnt == NULL)
+          return;
+     auth_destroy(conn->clnt->cl_auth);
+     clnt_destroy(conn->clnt);
+     pthread_mutex_destroy(&conn->lock);
+     conn->clnt = NULL;
+}
+
+/* Workloads */
+
+static int lg_make_file(lg_worker_t *w, lg_fh_t *dir, const char *name)
+{
+     lg_client_t *cl = &w->cl;
+     lg_file_t file;
+
+     if (cl->proto->create(cl, dir, name, &file) != LG_OK)
+          return LG_ERROR;
+     return cl->proto->close(cl, &file);
+}
+
+static int metadata_setup(lg_worker_t *w)
+{
+     char name[LG_NAME_LEN];
+     unsigned int i;
+
+     for (i = 0; i < w->run->params.files; i++) {
+          snprintf(name, sizeof(name), "m%u", i);
+          if (lg_make_file(w, &w->cl.dir, name) != LG_OK)
+               return LG_ERROR;
+     }
+     return LG_OK;
+}
+
+static int metadata_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     char name[LG_NAME_LEN];
+     lg_fh_t fh;
+     int rc;
+
+     snprintf(name, sizeof(name), "m%u",
+              rand_r(&w->seed) % w->run->params.files);
+
+     LG_TIMED(rc, cl, LG_OP_LOOKUP, cl->proto->lookup(cl, &cl->dir, name,
+                                                       &fh));
+     if (rc != LG_OK)
+          return rc;
+     LG_TIMED(rc, cl, LG_OP_GETATTR, cl->proto->getattr(cl, &fh));
+     return rc;
+}
+
+static void metadata_cleanup(lg_worker_t *w)
+{
+     char name[LG_NAME_LEN];
+     unsigned int i;
+
+     for (i = 0; i < w->run->params.files; i++) {
+          snprintf(name, sizeof(name), "m%u", i);
+          (void) w->cl.proto->remove(&w->cl, &w->cl.dir, name, FALSE);
+     }
+}
+
+static int create_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     char name[LG_NAME_LEN];
+     lg_file_t file;
+     int rc, rc2;
+
+     snprintf(name, sizeof(name), "n%llu", (unsigned long long) w->created++);
+
+     LG_TIMED(rc, cl, LG_OP_CREATE, cl->proto->create(cl, &cl->dir, name,
+                                                       &file));
+     if (rc != LG_OK)
+          return rc;
+     LG_TIMED(rc, cl, LG_OP_WRITE, cl->proto->write(cl, &file, 0, 4096));
+     if (rc == LG_OK)
+          LG_TIMED(rc, cl, LG_OP_COMMIT, cl->proto->commit(cl, &file));
+     LG_TIMED(rc2, cl, LG_OP_CLOSE, cl->proto->close(cl, &file));
+     if (rc == LG_OK)
+          rc = rc2;
+     if (rc == LG_OK && w->run->params.remove)
+          LG_TIMED(rc, cl, LG_OP_REMOVE, cl->proto->remove(cl, &cl->dir,
+                                                            name, FALSE));
+     return rc;
+}
+
+static void create_cleanup(lg_worker_t *w)
+{
+     char name[LG_NAME_LEN];
+     uint64_t i;
+
+     if (w->run->params.remove)
+          return;
+
+     for (i = 0; i < w->created; i++) {
+          snprintf(name, sizeof(name), "n%llu", (unsigned long long) i);
+          (void) w->cl.proto->remove(&w->cl, &w->cl.dir, name, FALSE);
+     }
+}
+
+/* seqwrite and seqread share the client's large file */
+static int big_setup(lg_worker_t *w, int fill)
+{
+     lg_client_t *cl = &w->cl;
+     uint64_t offset;
+
+     if (!w->big_open) {
+          if (cl->proto->create(cl, &cl->dir, "big", &w->big) != LG_OK)
+               return LG_ERROR;
+          w->big_open = TRUE;
+     }
+     if (!fill)
+          return LG_OK;
+
+     for (offset = 0; offset < w->run->params.filesize;
+          offset += w->run->params.iosize)
+          if (cl->proto->write(cl, &w->big, offset,
+                               w->run->params.iosize) != LG_OK)
+               return LG_ERROR;
+
+     return cl->proto->commit(cl, &w->big);
+}
+
+static int seqwrite_setup(lg_worker_t *w)
+{
+     return big_setup(w, FALSE);
+}
+
+static int seqread_setup(lg_worker_t *w)
+{
+     return big_setup(w, TRUE);
+}
+
+static int seqwrite_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     int rc;
+
+     LG_TIMED(rc, cl, LG_OP_WRITE, cl->proto->write(cl, &w->big,
+                                                     w->wr_offset,
+                                                     w->run->params.iosize));
+     w->wr_offset += w->run->params.iosize;
+
+     /* the whole file written, it is made stable before the next pass */
+     if (w->wr_offset >= w->run->params.filesize) {
+          w->wr_offset = 0;
+          if (rc == LG_OK)
+               LG_TIMED(rc, cl, LG_OP_COMMIT, cl->proto->commit(cl,
+                                                                 &w->big));
+     }
+     return rc;
+}
+
+static int seqread_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     int rc, eof = FALSE;
+
+     LG_TIMED(rc, cl, LG_OP_READ, cl->proto->read(cl, &w->big, w->rd_offset,
+                                                   w->run->params.iosize,
+                                                   &eof));
+     w->rd_offset += w->run->params.iosize;
+     if (eof || w->rd_offset >= w->run->params.filesize)
+          w->rd_offset = 0;
+
+     return rc;
+}
+
+static void big_cleanup(lg_worker_t *w)
+{
+     if (!w->big_open)
+          return;
+     (void) w->cl.proto->close(&w->cl, &w->big);
+     (void) w->cl.proto->remove(&w->cl, &w->cl.dir, "big", FALSE);
+     w->big_open = FALSE;
+}
+
+/* The clients of a run fill the directory together, entry i by client
+ * i modulo their number */
+static int readdir_setup_shared(lg_worker_t *w)
+{
+     return w->cl.proto->mkdir(&w->cl, &w->cl.run_dir, "bigdir", &w->bigdir);
+}
+
+static int readdir_setup(lg_worker_t *w)
+{
+     char name[LG_NAME_LEN];
+     unsigned int i;
+
+     if (w->cl.proto->lookup(&w->cl, &w->cl.run_dir, "bigdir",
+                             &w->bigdir) != LG_OK)
+          return LG_ERROR;
+
+     for (i = w->cl.id; i < w->run->params.entries; i += w->run->clients) {
+          snprintf(name, sizeof(name), "e%u", i);
+          if (lg_make_file(w, &w->bigdir, name) != LG_OK)
+               return LG_ERROR;
+     }
+     return LG_OK;
+}
+
+static int readdir_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     char verf[NFS4_VERIFIER_SIZE];
+     uint64_t cookie = 0;
+     unsigned int entries = 0;
+     int rc;
+
+     memset(verf, 0, sizeof(verf));
+     do {
+          LG_TIMED(rc, cl, LG_OP_READDIR, cl->proto->readdir(cl, &w->bigdir,
+                                                              &cookie, verf,
+                                                              &entries));
+     } while (rc == LG_OK && cookie != 0 && !lg_stop);
+
+     return rc;
+}
+
+static void readdir_cleanup(lg_worker_t *w)
+{
+     char name[LG_NAME_LEN];
+     unsigned int i;
+
+     for (i = w->cl.id; i < w->run->params.entries; i += w->run->clients) {
+          snprintf(name, sizeof(name), "e%u", i);
+          (void) w->cl.proto->remove(&w->cl, &w->bigdir, name, FALSE);
+     }
+}
+
+static void readdir_cleanup_shared(lg_worker_t *w)
+{
+     (void) w->cl.proto->remove(&w->cl, &w->cl.run_dir, "bigdir", TRUE);
+}
+
+/* Every client wants the first byte of the same file */
+static int lock_setup_shared(lg_worker_t *w)
+{
+     return lg_make_file(w, &w->cl.run_dir, "lockfile");
+}
+
+static int lock_setup(lg_worker_t *w)
+{
+     if (w->cl.proto->open(&w->cl, &w->cl.run_dir, "lockfile",
+                           &w->lockfile) != LG_OK)
+          return LG_ERROR;
+     w->lockfile_open = TRUE;
+     return LG_OK;
+}
+
+static int lock_iterate(lg_worker_t *w)
+{
+     lg_client_t *cl = &w->cl;
+     int rc;
+
+     LG_TIMED(rc, cl, LG_OP_LOCK, cl->proto->lock(cl, &w->lockfile, 0, 1));
+     if (rc != LG_OK)
+          return rc;
+     LG_TIMED(rc, cl, LG_OP_UNLOCK, cl->proto->unlock(cl, &w->lockfile, 0,
+                                                       1));
+     return rc;
+}
+
+static void lock_cleanup(lg_worker_t *w)
+{
+     if (!w->lockfile_open)
+          return;
+     (void) w->cl.proto->close(&w->cl, &w->lockfile);
+     w->lockfile_open = FALSE;
+}
+
+static void lock_cleanup_shared(lg_worker_t *w)
+{
+     (void) w->cl.proto->remove(&w->cl, &w->cl.run_dir, "lockfile", FALSE);
+}
+
+static const lg_workload_t lg_workloads[LG_NB_WL] = {
+     [LG_WL_METADATA] = {
+          .name = "metadata",
+          .setup = metadata_setup,
+          .iterate = metadata_iterate,
+          .cleanup = metadata_cleanup
+     },
+     [LG_WL_CREATE] = {
+          .name = "create",
+          .iterate = create_iterate,
+          .cleanup = create_cleanup
+     },
+     [LG_WL_SEQWRITE] = {
+          .name = "seqwrite",
+          .setup = seqwrite_setup,
+          .iterate = seqwrite_iterate,
+          .cleanup = big_cleanup
+     },
+     [LG_WL_SEQREAD] = {
+          .name = "seqread",
+          .setup = seqread_setup,
+          .iterate = seqread_iterate,
+          .cleanup = big_cleanup
+     },
+     [LG_WL_READDIR] = {
+          .name = "readdir",
+          .setup_shared = readdir_setup_shared,
+          .cleanup_shared = readdir_cleanup_shared,
+          .setup = readdir_setup,
+          .iterate = readdir_iterate,
+          .cleanup = readdir_cleanup
+     },
+     [LG_WL_LOCK] = {
+          .name = "lock",
+          .setup_shared = lock_setup_shared,
+          .cleanup_shared = lock_cleanup_shared,
+          .setup = lock_setup,
+          .iterate = lock_iterate,
+          .cleanup = lock_cleanup
+     }
+};
+
+static lg_workload_id_t lg_pick(lg_worker_t *w)
+{
+     unsigned int i, r = rand_r(&w->seed) % w->run->total_weight;
+
+     for (i = 0; i < LG_NB_WL; i++) {
+          if (r < w->run->weights[i])
+               return i;
+          r -= w->run->weights[i];
+     }
+     return LG_NB_WL - 1;
+}
+
+/* Client threads */
+
+static void lg_fail(lg_worker_t *w, const char *what)
+{
+     fprintf(stderr, "client %u: %s failed\n", w->cl.id, what);
+     lg_failed = TRUE;
+}
+
+static void *lg_client_thread(void *arg)
+{
+     lg_worker_t *w = arg;
+     lg_client_t *cl = &w->cl;
+     const lg_run_t *run = w->run;
+     char name[LG_NAME_LEN];
+     int i;
+
+     cl->in_setup = TRUE;
+     if (cl->proto->setup(cl, lg_export) != LG_OK)
+          lg_fail(w, "setup");
+     pthread_barrier_wait(&lg_clients_barrier);
+
+     snprintf(name, sizeof(name), "loadgen.%d.%u", (int) getpid(),
+              lg_run_index);
+     if (cl->id == 0 && !lg_failed) {
+          if (cl->proto->mkdir(cl, &cl->root, name, &cl->run_dir) != LG_OK)
+               lg_fail(w, "run directory");
+          for (i = 0; i < LG_NB_WL && !lg_failed; i++)
+               if (run->weights[i] && lg_workloads[i].setup_shared &&
+                   lg_workloads[i].setup_shared(w) != LG_OK)
+                    lg_fail(w, lg_workloads[i].name);
+     }
+     pthread_barrier_wait(&lg_clients_barrier);
+
+     if (!lg_failed) {
+          if (cl->id != 0 &&
+              cl->proto->lookup(cl, &cl->root, name, &cl->run_dir) != LG_OK)
+               lg_fail(w, "run directory");
+          snprintf(name, sizeof(name), "c%u", cl->id);
+          if (!lg_failed &&
+              cl->proto->mkdir(cl, &cl->run_dir, name, &cl->dir) != LG_OK)
+               lg_fail(w, "client directory");
+          for (i = 0; i < LG_NB_WL && !lg_failed; i++)
+               if (run->weights[i] && lg_workloads[i].setup &&
+                   lg_workloads[i].setup(w) != LG_OK)
+                    lg_fail(w, lg_workloads[i].name);
+     }
+
+     /* measured from here to the stop */
+     cl->in_setup = FALSE;
+     pthread_barrier_wait(&lg_all_barrier);
+
+     /* errors are counted with the operation that met them */
+     while (!lg_stop && !lg_failed) {
+          (void) lg_workloads[lg_pick(w)].iterate(w);
+          if (!lg_stop)
+               cl->iterations++;
+     }
+
+     pthread_barrier_wait(&lg_all_barrier);
+     cl->in_setup = TRUE;
+
+     if (!run->params.keep) {
+          for (i = 0; i < LG_NB_WL; i++)
+               if (run->weights[i] && lg_workloads[i].cleanup)
+                    lg_workloads[i].cleanup(w);
+          snprintf(name, sizeof(name), "c%u", cl->id);
+          (void) cl->proto->remove(cl, &cl->run_dir, name, TRUE);
+     } else {
+          lock_cleanup(w);
+          if (w->big_open)
+               (void) cl->proto->close(cl, &w->big);
+     }
+     pthread_barrier_wait(&lg_clients_barrier);
+
+     if (cl->id == 0 && !run->params.keep) {
+          for (i = 0; i < LG_NB_WL; i++)
+               if (run->weights[i] && lg_workloads[i].cleanup_shared)
+                    lg_workloads[i].cleanup_shared(w);
+          snprintf(name, sizeof(name), "loadgen.%d.%u", (int) getpid(),
+                   lg_run_index);
+          (void) cl->proto->remove(cl, &cl->root, name, TRUE);
+     }
+     cl->proto->teardown(cl);
+
+     return NULL;
+}
+
+/* Results */
+
+static uint64_t lg_percentile(const lg_hist_t *hist, double p)
+{
+     uint64_t target, seen = 0;
+     unsigned int i;
+
+     if (hist->count == 0)
+          return 0;
+
+     target = (uint64_t) (p * hist->count);
+     if (target < p * hist->count || target == 0)
+          target++;
+
+     for (i = 0; i < LG_HIST_BUCKETS; i++) {
+          seen += hist->buckets[i];
+          if (seen >= target)
+               break;
+     }
+
+     return lg_bucket_le(i) < hist->max_us ? lg_bucket_le(i) : hist->max_us;
+}
+
+static void lg_report(const lg_run_t *run, lg_worker_t *workers,
+                      double seconds)
+{
+     lg_hist_t total[LG_NB_OP];
+     uint64_t iterations = 0, errors = 0, denied = 0;
+     unsigned int c, op, i;
+
+     memset(total, 0, sizeof(total));
+     for (c = 0; c < run->clients; c++) {
+          iterations += workers[c].cl.iterations;
+          for (op = 0; op < LG_NB_OP; op++) {
+               lg_hist_t *h = &workers[c].cl.hist[op];
+
+               total[op].count += h->count;
+               total[op].errors += h->errors;
+               total[op].denied += h->denied;
+               total[op].sum_us += h->sum_us;
+               if (h->max_us > total[op].max_us)
+                    total[op].max_us = h->max_us;
+               for (i = 0; i < LG_HIST_BUCKETS; i++)
+                    total[op].buckets[i] += h->buckets[i];
+          }
+     }
+     for (op = 0; op < LG_NB_OP; op++) {
+          errors += total[op].errors;
+          denied += total[op].denied;
+     }
+
+     printf("run name=%s workload=%s version=%s clients=%u conns=%u "
+            "seconds=%.3f iterations=%llu iter_per_sec=%.1f errors=%llu "
+            "denied=%llu status=%s\n", run->name, run->mix, run->proto->name,
+            run->clients, run->conns, seconds,
+            (unsigned long long) iterations,
+            seconds > 0 ? iterations / seconds : 0.0,
+            (unsigned long long) errors, (unsigned long long) denied,
+            lg_failed ? "failed" : "ok");
+
+     for (op = 0; op < LG_NB_OP; op++) {
+          lg_hist_t *h = &total[op];
+
+          if (h->count == 0 && h->errors == 0)
+               continue;
+
+          printf("op name=%s op=%s count=%llu errors=%llu denied=%llu "
+                 "mean_us=%.1f p50_us=%llu p90_us=%llu p99_us=%llu "
+                 "p999_us=%llu max_us=%llu\n", run->name, lg_op_names[op],
+                 (unsigned long long) h->count,
+                 (unsigned long long) h->errors,
+                 (unsigned long long) h->denied,
+                 h->count ? (double) h->sum_us / h->count : 0.0,
+                 (unsigned long long) lg_percentile(h, 0.50),
+                 (unsigned long long) lg_percentile(h, 0.90),
+                 (unsigned long long) lg_percentile(h, 0.99),
+                 (unsigned long long) lg_percentile(h, 0.999),
+                 (unsigned long long) h->max_us);
+
+          for (i = 0; i < LG_HIST_BUCKETS; i++)
+               if (h->buckets[i])
+                    printf("hist name=%s op=%s le_us=%llu count=%llu\n",
+                           run->name, lg_op_names[op],
+                           (unsigned long long) lg_bucket_le(i),
+                           (unsigned long long) h->buckets[i]);
+     }
+     fflush(stdout);
+}
+
+/* A run */
+
+static int lg_run(const lg_run_t *run)
+{
+     lg_worker_t *workers;
+     lg_conn_t *conns, *nlm_conns = NULL;
+     pthread_t *threads;
+     char host[LG_NAME_LEN];
+     uint64_t start = 0, end = 0;
+     rpcvers_t vers = run->proto == &lg_proto_v3 ? NFS_V3 : NFS_V4;
+     unsigned int i;
+     int rc = LG_ERROR;
+
+     lg_stop = FALSE;
+     lg_failed = FALSE;
+     lg_rpc_failures = 0;
+
+     workers = calloc(run->clients, sizeof(*workers));
+     threads = calloc(run->clients, sizeof(*threads));
+     conns = calloc(run->conns, sizeof(*conns));
+     if (workers == NULL || threads == NULL || conns == NULL) {
+          fprintf(stderr, "%s: out of memory\n", run->name);
+          goto out;
+     }
+
+     for (i = 0; i < run->conns; i++)
+          if (lg_connect(&conns[i], NFS_PROGRAM, vers, lg_port) != LG_OK)
+               goto out;
+
+#ifdef _USE_NLM
+     if (run->proto == &lg_proto_v3 && run->weights[LG_WL_LOCK]) {
+          nlm_conns = calloc(run->conns, sizeof(*nlm_conns));
+          if (nlm_conns == NULL)
+               goto out;
+          for (i = 0; i < run->conns; i++)
+               if (lg_connect(&nlm_conns[i], NLMPROG, NLM4_VERS, 0) != LG_OK)
+                    goto out;
+     }
+#endif
+
+     if (gethostname(host, sizeof(host)) != 0)
+          strcpy(host, "localhost");
+     host[sizeof(host) - 1] = '\0';
+
+     for (i = 0; i < run->clients; i++) {
+          lg_worker_t *w = &workers[i];
+
+          w->run = run;
+          w->cl.id = i;
+          w->cl.proto = run->proto;
+          w->cl.conn = &conns[i % run->conns];
+          if (nlm_conns != NULL)
+               w->cl.nlm_conn = &nlm_conns[i % run->conns];
+          snprintf(w->cl.owner, sizeof(w->cl.owner), "loadgen.%d.%u.%u@%s",
+                   (int) getpid(), lg_run_index, i, host);
+          w->seed = getpid() * 7919 + i;
+          w->cl.buf = malloc(run->params.iosize > 4096 ?
+                             run->params.iosize : 4096);
+          if (w->cl.buf == NULL) {
+               fprintf(stderr, "%s: out of memory\n", run->name);
+               goto out;
+          }
+          memset(w->cl.buf, 'a' + i % 26, run->params.iosize > 4096 ?
+                 run->params.iosize : 4096);
+     }
+
+     pthread_barrier_init(&lg_clients_barrier, NULL, run->clients);
+     pthread_barrier_init(&lg_all_barrier, NULL, run->clients + 1);
+
+     for (i = 0; i < run->clients; i++)
+          if (pthread_create(&threads[i], NULL, lg_client_thread,
+                             &workers[i]) != 0) {
+               /* the barriers count on every client, none can go on */
+               fprintf(stderr, "%s: cannot start client %u\n", run->name, i);
+               exit(1);
+          }
+
+     pthread_barrier_wait(&lg_all_barrier);
+     start = lg_now_ns();
+     if (!lg_failed)
+          sleep(run->seconds);
+     lg_stop = TRUE;
+     end = lg_now_ns();
+     pthread_barrier_wait(&lg_all_barrier);
+
+     for (i = 0; i < run->clients; i++)
+          pthread_join(threads[i], NULL);
+
+     pthread_barrier_destroy(&lg_clients_barrier);
+     pthread_barrier_destroy(&lg_all_barrier);
+
+     lg_report(run, workers, (end - start) / 1e9);
+     if (!lg_failed)
+          rc = LG_OK;
+
+ out:
+     if (rc != LG_OK && end == 0)
+          printf("run name=%s workload=%s version=%s status=failed\n",
+                 run->name, run->mix, run->proto->name);
+     for (i = 0; conns != NULL && i < run->conns; i++)
+          lg_disconnect(&conns[i]);
+     for (i = 0; nlm_conns != NULL && i < run->conns; i++)
+          lg_disconnect(&nlm_conns[i]);
+     for (i = 0; workers != NULL && i < run->clients; i++)
+          free(workers[i].cl.buf);
+     free(nlm_conns);
+     free(conns);
+     free(threads);
+     free(workers);
+     lg_run_index++;
+
+     return rc;
+}
+
+/* Run descriptions */
+
+static const lg_proto_t *lg_parse_version(const char *version)
+{
+     if (!strcmp(version, "3"))
+          return &lg_proto_v3;
+     if (!strcmp(version, "4") || !strcmp(version, "4.0"))
+          return &lg_proto_v40;
+#ifdef _USE_NFS4_1
+     if (!strcmp(version, "4.1"))
+          return &lg_proto_v41;
+#endif
+     fprintf(stderr, "unknown NFS version %s\n", version);
+     return NULL;
+}
+
+static int lg_parse_mix(lg_run_t *run, const char *mix)
+{
+     char buf[LG_NAME_LEN], *item, *next, *colon;
+     unsigned int i, weight;
+
+     if (strlen(mix) >= sizeof(buf)) {
+          fprintf(stderr, "workload mix %s is too long\n", mix);
+          return LG_ERROR;
+     }
+     strcpy(run->mix, mix);
+     strcpy(buf, mix);
+     memset(run->weights, 0, sizeof(run->weights));
+     run->total_weight = 0;
+
+     for (item = strtok_r(buf, ",", &next); item != NULL;
+          item = strtok_r(NULL, ",", &next)) {
+          weight = 1;
+          colon = strchr(item, ':');
+          if (colon != NULL) {
+               *colon = '\0';
+               weight = strtoul(colon + 1, NULL, 10);
+          }
+          for (i = 0; i < LG_NB_WL; i++)
+               if (!strcmp(item, lg_workloads[i].name))
+                    break;
+          if (i == LG_NB_WL || weight == 0) {
+               fprintf(stderr, "bad workload %s\n", item);
+               return LG_ERROR;
+          }
+          run->weights[i] += weight;
+          run->total_weight += weight;
+     }
+
+     if (run->total_weight == 0) {
+          fprintf(stderr, "empty workload mix\n");
+          return LG_ERROR;
+     }
+     return LG_OK;
+}
+
+static int lg_parse_param(lg_params_t *params, const char *param)
+{
+     const char *value = strchr(param, '=');
+     unsigned long long v;
+     char *end;
+
+     if (value == NULL) {
+          fprintf(stderr, "parameter %s is not key=value\n", param);
+          return LG_ERROR;
+     }
+     v = strtoull(value + 1, &end, 0);
+     if (*end != '\0' || end == value + 1) {
+          fprintf(stderr, "bad value in %s\n", param);
+          return LG_ERROR;
+     }
+
+#define LG_PARAM(_name_, _field_)                                  \
+     if (!strncmp(param, _name_ "=", sizeof(_name_))) {             \
+          params->_field_ = v;                                      \
+          return LG_OK;                                             \
+     }
+     LG_PARAM("files", files);
+     LG_PARAM("filesize", filesize);
+     LG_PARAM("iosize", iosize);
+     LG_PARAM("entries", entries);
+     LG_PARAM("remove", remove);
+     LG_PARAM("keep", keep);
+#undef LG_PARAM
+
+     fprintf(stderr, "unknown parameter %s\n", param);
+     return LG_ERROR;
+}
+
+static void lg_default_run(lg_run_t *run)
+{
+     memset(run, 0, sizeof(*run));
+     run->proto = &lg_proto_v3;
+     run->clients = 1;
+     run->conns = 1;
+     run->seconds = 10;
+     run->params.files = 1000;
+     run->params.filesize = 16 * 1024 * 1024;
+     run->params.iosize = 64 * 1024;
+     run->params.entries = 10000;
+     run->params.remove = TRUE;
+     run->params.keep = FALSE;
+}
+
+static int lg_check_run(lg_run_t *run)
+{
+     if (run->clients == 0 || run->clients > LG_MAX_CLIENTS ||
+         run->conns == 0 || run->seconds == 0) {
+          fprintf(stderr, "%s: clients, connections and seconds must be "
+                  "positive, clients at most %u\n", run->name,
+                  LG_MAX_CLIENTS);
+          return LG_ERROR;
+     }
+     if (run->conns > run->clients)
+          run->conns = run->clients;
+     if (run->params.files == 0 || run->params.iosize == 0 ||
+         run->params.filesize < run->params.iosize) {
+          fprintf(stderr, "%s: files and iosize must be positive, filesize "
+                  "at least iosize\n", run->name);
+          return LG_ERROR;
+     }
+     if (run->name[0] == '\0')
+          snprintf(run->name, sizeof(run->name), "%s-v%s", run->mix,
+                   run->proto->name);
+     return LG_OK;
+}
+
+static int lg_suite(const char *path)
+{
+     FILE *suite;
+     char line[LG_MAX_LINE], *fields[32], *next, *f;
+     unsigned int nb, i, lineno = 0;
+     lg_run_t run;
+     int rc = 0;
+
+     suite = fopen(path, "r");
+     if (suite == NULL) {
+          perror(path);
+          return 2;
+     }
+
+     while (fgets(line, sizeof(line), suite) != NULL) {
+          lineno++;
+          if (strchr(line, '#') != NULL)
+               *strchr(line, '#') = '\0';
+          nb = 0;
+          for (f = strtok_r(line, " \t\n", &next); f != NULL && nb < 32;
+               f = strtok_r(NULL, " \t\n", &next))
+               fields[nb++] = f;
+          if (nb == 0)
+               continue;
+
+          lg_default_run(&run);
+          if (nb < 6 || strlen(fields[0]) >= sizeof(run.name)) {
+               fprintf(stderr, "%s:%u: name, workload mix, version, "
+                       "clients, connections and seconds expected\n",
+                       path, lineno);
+               rc = 2;
+               break;
+          }
+          strcpy(run.name, fields[0]);
+          run.proto = lg_parse_version(fields[2]);
+          run.clients = strtoul(fields[3], NULL, 10);
+          run.conns = strtoul(fields[4], NULL, 10);
+          run.seconds = strtoul(fields[5], NULL, 10);
+          if (run.proto == NULL || lg_parse_mix(&run, fields[1]) != LG_OK) {
+               rc = 2;
+               break;
+          }
+          for (i = 6; i < nb; i++)
+               if (lg_parse_param(&run.params, fields[i]) != LG_OK)
+                    break;
+          if (i < nb || lg_check_run(&run) != LG_OK) {
+               fprintf(stderr, "%s:%u: bad run\n", path, lineno);
+               rc = 2;
+               break;
+          }
+
+          if (lg_run(&run) != LG_OK)
+               rc = 1;
+     }
+
+     fclose(suite);
+     return rc;
+}
+
+/* Compare mode */
+
+typedef struct lg_result {
+     char name[LG_NAME_LEN];
+     char op[LG_NAME_LEN];       /* empty for a run record */
+     int failed;
+     double iter_per_sec;
+     uint64_t errors;
+     uint64_t count;
+     uint64_t p99_us;
+} lg_result_t;
+
+typedef struct lg_results {
+     lg_result_t *res;
+     unsigned int nb;
+     unsigned int size;
+} lg_results_t;
+
+/* The value of key in a key=value record, NULL if it has none */
+static const char *lg_value(char **fields, unsigned int nb, const char *key)
+{
+     size_t len = strlen(key);
+     unsigned int i;
+
+     for (i = 1; i < nb; i++)
+          if (!strncmp(fields[i], key, len) && fields[i][len] == '=')
+               return fields[i] + len + 1;
+     return NULL;
+}
+
+static int lg_load(const char *path, lg_results_t *results)
+{
+     FILE *file;
+     char line[LG_MAX_LINE], *fields[32], *next, *f;
+     const char *name, *op, *v;
+     unsigned int nb;
+     lg_result_t *r;
+
+     file = fopen(path, "r");
+     if (file == NULL) {
+          perror(path);
+          return LG_ERROR;
+     }
+
+     while (fgets(line, sizeof(line), file) != NULL) {
+          nb = 0;
+          for (f = strtok_r(line, " \n", &next); f != NULL && nb < 32;
+               f = strtok_r(NULL, " \n", &next))
+               fields[nb++] = f;
+          if (nb == 0 || (strcmp(fields[0], "run") && strcmp(fields[0], "op")))
+               continue;
+
+          name = lg_value(fields, nb, "name");
+          op = lg_value(fields, nb, "op");
+          if (name == NULL || strlen(name) >= LG_NAME_LEN ||
+              (op != NULL && strlen(op) >= LG_NAME_LEN))
+               continue;
+
+          if (results->nb == results->size) {
+               results->size = results->size ? 2 * results->size : 64;
+               results->res = realloc(results->res,
+                                      results->size * sizeof(lg_result_t));
+               if (results->res == NULL) {
+                    fprintf(stderr, "out of memory\n");
+                    exit(2);
+               }
+          }
+          r = &results->res[results->nb++];
+          memset(r, 0, sizeof(*r));
+          strcpy(r->name, name);
+          if (!strcmp(fields[0], "op") && op != NULL)
+               strcpy(r->op, op);
+
+          v = lg_value(fields, nb, "status");
+          r->failed = v != NULL && strcmp(v, "ok");
+          if ((v = lg_value(fields, nb, "iter_per_sec")) != NULL)
+               r->iter_per_sec = strtod(v, NULL);
+          if ((v = lg_value(fields, nb, "errors")) != NULL)
+               r->errors = strtoull(v, NULL, 10);
+          if ((v = lg_value(fields, nb, "count")) != NULL)
+               r->count = strtoull(v, NULL, 10);
+          if ((v = lg_value(fields, nb, "p99_us")) != NULL)
+               r->p99_us = strtoull(v, NULL, 10);
+     }
+
+     fclose(file);
+     return LG_OK;
+}
+
+static lg_result_t *lg_find(lg_results_t *results, const char *name,
+                            const char *op)
+{
+     unsigned int i;
+
+     for (i = 0; i < results->nb; i++)
+          if (!strcmp(results->res[i].name, name) &&
+              !strcmp(results->res[i].op, op))
+               return &results->res[i];
+     return NULL;
+}
+
+static int lg_compare(const char *baseline_path, const char *results_path,
+                      double tput_tol, double lat_tol)
+{
+     lg_results_t baseline, results;
+     lg_result_t *b, *r;
+     unsigned int i, runs = 0, regressions = 0;
+
+     memset(&baseline, 0, sizeof(baseline));
+     memset(&results, 0, sizeof(results));
+     if (lg_load(baseline_path, &baseline) != LG_OK ||
+         lg_load(results_path, &results) != LG_OK)
+          return 2;
+
+     for (i = 0; i < baseline.nb; i++) {
+          b = &baseline.res[i];
+          if (b->failed)
+               continue;
+          r = lg_find(&results, b->name, b->op);
+
+          if (b->op[0] == '\0') {
+               runs++;
+               if (r == NULL || r->failed) {
+                    printf("regression name=%s metric=status result=%s\n",
+                           b->name, r == NULL ? "missing" : "failed");
+                    regressions++;
+               } else if (r->errors > b->errors) {
+                    /* A server failing faster is no faster */
+                    printf("regression name=%s metric=errors "
+                           "baseline=%llu result=%llu\n", b->name,
+                           (unsigned long long) b->errors,
+                           (unsigned long long) r->errors);
+                    regressions++;
+               } else if (r->iter_per_sec <
+                          b->iter_per_sec * (1 - tput_tol / 100)) {
+                    printf("regression name=%s metric=iter_per_sec "
+                           "baseline=%.1f result=%.1f change=%.1f%%\n",
+                           b->name, b->iter_per_sec, r->iter_per_sec,
+                           100 * (r->iter_per_sec / b->iter_per_sec - 1));
+                    regressions++;
+               }
+               continue;
+          }
+
+          if (r == NULL || b->count < LG_COMPARE_MIN_COUNT ||
+              r->count < LG_COMPARE_MIN_COUNT || b->p99_us == 0)
+               continue;
+          if (r->p99_us > b->p99_us * (1 + lat_tol / 100)) {
+               printf("regression name=%s op=%s metric=p99_us "
+                      "baseline=%llu result=%llu change=%.1f%%\n",
+                      b->name, b->op, (unsigned long long) b->p99_us,
+                      (unsigned long long) r->p99_us,
+                      100 * ((double) r->p99_us / b->p99_us - 1));
+               regressions++;
+          }
+     }
+
+     printf("compare runs=%u regressions=%u\n", runs, regressions);
+
+     free(baseline.res);
+     free(results.res);
+     return regressions ? 1 : 0;
+}
+
+static void usage(const char *prog)
+{
+     fprintf(stderr,
+             "Usage: %s -s server [-p port] [-e export] [-v 3|4.0|4.1]\n"
+             "          [-n clients] [-m connections] [-d seconds]\n"
+             "          [-w workload[:weight],...] [-o key=value]... "
+             "[-N name]\n"
+             "       %s -s server [-p port] [-e export] -f suite\n"
+             "       %s -c baseline [-t throughput%%] [-l latency%%] "
+             "results\n", prog, prog, prog);
+     exit(2);
+}
+
+int main(int argc, char **argv)
+{
+     lg_run_t run;
+     const char *suite = NULL, *baseline = NULL;
+     double tput_tol = 10, lat_tol = 25;
+     int c;
+
+     lg_default_run(&run);
+     if (lg_parse_mix(&run, "metadata") != LG_OK)
+          return 2;
+
+     while ((c = getopt(argc, argv, "s:p:e:v:n:m:d:w:o:N:f:c:t:l:h")) != -1) {
+          switch (c) {
+          case 's':
+               lg_server = optarg;
+               break;
+          case 'p':
+               lg_port = atoi(optarg);
+               break;
+          case 'e':
+               lg_export = optarg;
+               break;
+          case 'v':
+               if ((run.proto = lg_parse_version(optarg)) == NULL)
+                    return 2;
+               break;
+          case 'n':
+               run.clients = strtoul(optarg, NULL, 10);
+               break;
+          case 'm':
+               run.conns = strtoul(optarg, NULL, 10);
+               break;
+          case 'd':
+               run.seconds = strtoul(optarg, NULL, 10);
+               break;
+          case 'w':
+               if (lg_parse_mix(&run, optarg) != LG_OK)
+                    return 2;
+               break;
+          case 'o':
+               if (lg_parse_param(&run.params, optarg) != LG_OK)
+                    return 2;
+               break;
+          case 'N':
+               if (strlen(optarg) >= sizeof(run.name))
+                    usage(argv[0]);
+               strcpy(run.name, optarg);
+               break;
+          case 'f':
+               suite = optarg;
+               break;
+          case 'c':
+               baseline = optarg;
+               break;
+          case 't':
+               tput_tol = strtod(optarg, NULL);
+               break;
+          case 'l':
+               lat_tol = strtod(optarg, NULL);
+               break;
+          default:
+               usage(argv[0]);
+          }
+     }
+
+     if (baseline != NULL) {
+          if (optind != argc - 1)
+               usage(argv[0]);
+          return lg_compare(baseline, argv[optind], tput_tol, lat_tol);
+     }
+
+     if (lg_server == NULL || optind != argc)
+          usage(argv[0]);
+
+     if (suite != NULL)
+          return lg_suite(suite);
+
+     if (lg_check_run(&run) != LG_OK)
+          return 2;
+     return lg_run(&run) == LG_OK ? 0 : 1;
+}
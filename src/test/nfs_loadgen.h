@@ -0,0 +1,158 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_loadgen.h
+ * @brief  Loopback NFS load generator
+ *
+ * Types shared by the driver and the protocol backends of nfs_loadgen.
+ * A backend speaks one protocol version over TI-RPC and offers the few
+ * operations the workloads are made of; every call returns LG_OK,
+ * LG_DENIED (a lock held by someone else) or LG_ERROR.
+ */
+
+#ifndef NFS_LOADGEN_H
+#define NFS_LOADGEN_H
+
+#include <stdint.h>
+#include <pthread.h>
+#include "nfs4.h"
+
+#define LG_OK      0
+#define LG_DENIED  1
+#define LG_ERROR  -1
+
+/* log-linear buckets, four per power of two of microseconds */
+#define LG_HIST_BUCKETS 160
+
+typedef enum lg_op {
+     LG_OP_LOOKUP = 0,
+     LG_OP_GETATTR,
+     LG_OP_CREATE,
+     LG_OP_OPEN,
+     LG_OP_CLOSE,
+     LG_OP_READ,
+     LG_OP_WRITE,
+     LG_OP_COMMIT,
+     LG_OP_REMOVE,
+     LG_OP_READDIR,
+     LG_OP_LOCK,
+     LG_OP_UNLOCK,
+     LG_NB_OP
+} lg_op_t;
+
+typedef struct lg_hist {
+     uint64_t count;
+     uint64_t errors;
+     uint64_t denied;
+     uint64_t sum_us;
+     uint64_t max_us;
+     uint64_t buckets[LG_HIST_BUCKETS];
+} lg_hist_t;
+
+typedef struct lg_fh {
+     unsigned int len;
+     char val[NFS4_FHSIZE];
+} lg_fh_t;
+
+/* A file as a workload holds it: its handle, and for NFSv4 its state */
+typedef struct lg_file {
+     lg_fh_t fh;
+     stateid4 open_stateid;
+     stateid4 lock_stateid;
+     int has_lock_stateid;
+} lg_file_t;
+
+/* One RPC connection, shared by the clients given to it */
+typedef struct lg_conn {
+     CLIENT *clnt;
+     pthread_mutex_t lock;
+} lg_conn_t;
+
+struct lg_proto;
+
+typedef struct lg_client {
+     unsigned int id;
+     const struct lg_proto *proto;
+     lg_conn_t *conn;
+     lg_conn_t *nlm_conn;        /* NFSv3 locks go through NLM */
+     int in_setup;               /* retry through the grace period */
+     lg_fh_t root;               /* the export */
+     lg_fh_t run_dir;            /* shared by the clients of a run */
+     lg_fh_t dir;                /* this client's own directory */
+     char owner[64];
+     /* NFSv4 client state */
+     clientid4 clientid;
+     sessionid4 sessionid;
+     sequenceid4 slot_seqid;
+     seqid4 open_seqid;
+     seqid4 lock_seqid;
+     uint64_t seq;               /* NLM cookies, NFSv4 lock owners */
+     char *buf;                  /* READ and WRITE data */
+     /* measures, taken while in_setup is not set */
+     uint64_t iterations;
+     lg_hist_t hist[LG_NB_OP];
+} lg_client_t;
+
+typedef struct lg_proto {
+     const char *name;
+     int (*setup) (lg_client_t *cl, const char *export);
+     void (*teardown) (lg_client_t *cl);
+     int (*lookup) (lg_client_t *cl, lg_fh_t *dir, const char *name,
+                    lg_fh_t *fh);
+     int (*getattr) (lg_client_t *cl, lg_fh_t *fh);
+     int (*mkdir) (lg_client_t *cl, lg_fh_t *dir, const char *name,
+                   lg_fh_t *fh);
+     /* create and open for writing */
+     int (*create) (lg_client_t *cl, lg_fh_t *dir, const char *name,
+                    lg_file_t *file);
+     int (*open) (lg_client_t *cl, lg_fh_t *dir, const char *name,
+                  lg_file_t *file);
+     int (*close) (lg_client_t *cl, lg_file_t *file);
+     int (*read) (lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                  uint32_t count, int *p_eof);
+     int (*write) (lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint32_t count);
+     int (*commit) (lg_client_t *cl, lg_file_t *file);
+     int (*remove) (lg_client_t *cl, lg_fh_t *dir, const char *name,
+                    int is_dir);
+     /* one READDIR call from cookie, *p_cookie set to the next one or 0 */
+     int (*readdir) (lg_client_t *cl, lg_fh_t *dir, uint64_t *p_cookie,
+                     char *verf, unsigned int *p_entries);
+     int (*lock) (lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                  uint64_t length);
+     int (*unlock) (lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                    uint64_t length);
+} lg_proto_t;
+
+extern const lg_proto_t lg_proto_v3;
+extern const lg_proto_t lg_proto_v40;
+#ifdef _USE_NFS4_1
+extern const lg_proto_t lg_proto_v41;
+#endif
+
+extern const char *lg_server;
+extern struct timeval lg_timeout;
+
+int lg_call(lg_conn_t *conn, rpcproc_t proc, xdrproc_t xargs, void *args,
+            xdrproc_t xres, void *res);
+void lg_grace_wait(lg_client_t *cl, const char *what);
+
+#endif /* NFS_LOADGEN_H */
@@ -0,0 +1,445 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_loadgen_v3.c
+ * @brief  NFSv3 backend of the load generator
+ *
+ * The export root comes from MOUNT, byte range locks go through NLM.
+ * READ data is decoded into the client's own buffer, so that the
+ * generator does not time its own allocations.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "nfs_loadgen.h"
+#include "nfs23.h"
+#include "mount.h"
+#ifdef _USE_NLM
+#include "nlm4.h"
+#endif
+
+static void v3_fh(nfs_fh3 *fh3, lg_fh_t *fh)
+{
+     fh3->data.data_len = fh->len;
+     fh3->data.data_val = fh->val;
+}
+
+static int v3_keep_fh(lg_fh_t *fh, u_int len, char *val)
+{
+     if (len > sizeof(fh->val))
+          return LG_ERROR;
+     fh->len = len;
+     memcpy(fh->val, val, len);
+     return LG_OK;
+}
+
+static int v3_setup(lg_client_t *cl, const char *export)
+{
+     CLIENT *clnt;
+     mountres3 res;
+     dirpath path = (dirpath) export;
+     enum clnt_stat st;
+     int rc = LG_ERROR;
+
+     clnt = clnt_create(lg_server, MOUNTPROG, MOUNT_V3, "tcp");
+     if (clnt == NULL) {
+          fprintf(stderr, "client %u: no MOUNT service on %s\n", cl->id,
+                  lg_server);
+          return LG_ERROR;
+     }
+     clnt->cl_auth = authunix_create_default();
+
+     memset(&res, 0, sizeof(res));
+     st = clnt_call(clnt, MOUNTPROC3_MNT, (xdrproc_t) xdr_dirpath,
+                    (caddr_t) &path, (xdrproc_t) xdr_mountres3,
+                    (caddr_t) &res, lg_timeout);
+     if (st != RPC_SUCCESS)
+          fprintf(stderr, "client %u: MOUNT %s: %s\n", cl->id, export,
+                  clnt_sperrno(st));
+     else if (res.fhs_status != MNT3_OK)
+          fprintf(stderr, "client %u: MOUNT %s: status %d\n", cl->id,
+                  export, res.fhs_status);
+     else
+          rc = v3_keep_fh(&cl->root,
+                          res.mountres3_u.mountinfo.fhandle.fhandle3_len,
+                          res.mountres3_u.mountinfo.fhandle.fhandle3_val);
+
+     if (st == RPC_SUCCESS)
+          clnt_freeres(clnt, (xdrproc_t) xdr_mountres3, (caddr_t) &res);
+     auth_destroy(clnt->cl_auth);
+     clnt_destroy(clnt);
+
+     return rc;
+}
+
+static void v3_teardown(lg_client_t *cl)
+{
+}
+
+static int v3_lookup(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     lg_fh_t *fh)
+{
+     LOOKUP3args args;
+     LOOKUP3res res;
+     int rc;
+
+     v3_fh(&args.what.dir, dir);
+     args.what.name = (filename3) name;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_LOOKUP, (xdrproc_t) xdr_LOOKUP3args,
+                 &args, (xdrproc_t) xdr_LOOKUP3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     if (res.status == NFS3_OK)
+          rc = v3_keep_fh(fh, res.LOOKUP3res_u.resok.object.data.data_len,
+                          res.LOOKUP3res_u.resok.object.data.data_val);
+     else
+          rc = LG_ERROR;
+
+     clnt_freeres(cl->conn->clnt, (xdrproc_t) xdr_LOOKUP3res, (caddr_t) &res);
+     return rc;
+}
+
+static int v3_getattr(lg_client_t *cl, lg_fh_t *fh)
+{
+     GETATTR3args args;
+     GETATTR3res res;
+
+     v3_fh(&args.object, fh);
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_GETATTR, (xdrproc_t) xdr_GETATTR3args,
+                 &args, (xdrproc_t) xdr_GETATTR3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     return res.status == NFS3_OK ? LG_OK : LG_ERROR;
+}
+
+static int v3_mkdir(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                    lg_fh_t *fh)
+{
+     MKDIR3args args;
+     MKDIR3res res;
+     post_op_fh3 *obj;
+     int rc = LG_ERROR;
+
+     memset(&args, 0, sizeof(args));
+     v3_fh(&args.where.dir, dir);
+     args.where.name = (filename3) name;
+     args.attributes.mode.set_it = TRUE;
+     args.attributes.mode.set_mode3_u.mode = 0755;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_MKDIR, (xdrproc_t) xdr_MKDIR3args,
+                 &args, (xdrproc_t) xdr_MKDIR3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     obj = &res.MKDIR3res_u.resok.obj;
+     if (res.status == NFS3_OK && obj->handle_follows)
+          rc = v3_keep_fh(fh, obj->post_op_fh3_u.handle.data.data_len,
+                          obj->post_op_fh3_u.handle.data.data_val);
+     else if (res.status == NFS3ERR_EXIST)
+          rc = v3_lookup(cl, dir, name, fh);
+
+     clnt_freeres(cl->conn->clnt, (xdrproc_t) xdr_MKDIR3res, (caddr_t) &res);
+     return rc;
+}
+
+static int v3_create(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     lg_file_t *file)
+{
+     CREATE3args args;
+     CREATE3res res;
+     post_op_fh3 *obj;
+     int rc = LG_ERROR;
+
+     memset(&args, 0, sizeof(args));
+     v3_fh(&args.where.dir, dir);
+     args.where.name = (filename3) name;
+     args.how.mode = UNCHECKED;
+     args.how.createhow3_u.obj_attributes.mode.set_it = TRUE;
+     args.how.createhow3_u.obj_attributes.mode.set_mode3_u.mode = 0644;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_CREATE, (xdrproc_t) xdr_CREATE3args,
+                 &args, (xdrproc_t) xdr_CREATE3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     obj = &res.CREATE3res_u.resok.obj;
+     if (res.status == NFS3_OK && obj->handle_follows)
+          rc = v3_keep_fh(&file->fh, obj->post_op_fh3_u.handle.data.data_len,
+                          obj->post_op_fh3_u.handle.data.data_val);
+     else if (res.status == NFS3_OK)
+          rc = v3_lookup(cl, dir, name, &file->fh);
+
+     clnt_freeres(cl->conn->clnt, (xdrproc_t) xdr_CREATE3res, (caddr_t) &res);
+     return rc;
+}
+
+/* NFSv3 has no open: the file is looked up */
+static int v3_open(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                   lg_file_t *file)
+{
+     return v3_lookup(cl, dir, name, &file->fh);
+}
+
+static int v3_close(lg_client_t *cl, lg_file_t *file)
+{
+     return LG_OK;
+}
+
+static int v3_read(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint32_t count, int *p_eof)
+{
+     READ3args args;
+     READ3res res;
+
+     v3_fh(&args.file, &file->fh);
+     args.offset = offset;
+     args.count = count;
+     memset(&res, 0, sizeof(res));
+     res.READ3res_u.resok.data.data_val = cl->buf;
+
+     if (lg_call(cl->conn, NFSPROC3_READ, (xdrproc_t) xdr_READ3args,
+                 &args, (xdrproc_t) xdr_READ3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     /* nothing but the data, which is ours, was decoded into memory */
+     if (res.status != NFS3_OK)
+          return LG_ERROR;
+
+     *p_eof = res.READ3res_u.resok.eof;
+     return LG_OK;
+}
+
+static int v3_write(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                    uint32_t count)
+{
+     WRITE3args args;
+     WRITE3res res;
+
+     v3_fh(&args.file, &file->fh);
+     args.offset = offset;
+     args.count = count;
+     args.stable = UNSTABLE;
+     args.data.data_len = count;
+     args.data.data_val = cl->buf;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_WRITE, (xdrproc_t) xdr_WRITE3args,
+                 &args, (xdrproc_t) xdr_WRITE3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     if (res.status != NFS3_OK ||
+         res.WRITE3res_u.resok.count != count)
+          return LG_ERROR;
+
+     return LG_OK;
+}
+
+static int v3_commit(lg_client_t *cl, lg_file_t *file)
+{
+     COMMIT3args args;
+     COMMIT3res res;
+
+     v3_fh(&args.file, &file->fh);
+     args.offset = 0;
+     args.count = 0;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_COMMIT, (xdrproc_t) xdr_COMMIT3args,
+                 &args, (xdrproc_t) xdr_COMMIT3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     return res.status == NFS3_OK ? LG_OK : LG_ERROR;
+}
+
+static int v3_remove(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     int is_dir)
+{
+     REMOVE3args args;
+     REMOVE3res res;
+
+     /* RMDIR3args has the same shape */
+     v3_fh(&args.object.dir, dir);
+     args.object.name = (filename3) name;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, is_dir ? NFSPROC3_RMDIR : NFSPROC3_REMOVE,
+                 (xdrproc_t) xdr_REMOVE3args, &args,
+                 (xdrproc_t) xdr_REMOVE3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     return res.status == NFS3_OK ? LG_OK : LG_ERROR;
+}
+
+static int v3_readdir(lg_client_t *cl, lg_fh_t *dir, uint64_t *p_cookie,
+                      char *verf, unsigned int *p_entries)
+{
+     READDIR3args args;
+     READDIR3res res;
+     entry3 *entry;
+     int rc = LG_ERROR;
+
+     v3_fh(&args.dir, dir);
+     args.cookie = *p_cookie;
+     memcpy(args.cookieverf, verf, NFS3_COOKIEVERFSIZE);
+     args.count = 32768;
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->conn, NFSPROC3_READDIR, (xdrproc_t) xdr_READDIR3args,
+                 &args, (xdrproc_t) xdr_READDIR3res, &res) != LG_OK)
+          return LG_ERROR;
+
+     if (res.status == NFS3_OK) {
+          memcpy(verf, res.READDIR3res_u.resok.cookieverf,
+                 NFS3_COOKIEVERFSIZE);
+          for (entry = res.READDIR3res_u.resok.reply.entries; entry != NULL;
+               entry = entry->nextentry) {
+               (*p_entries)++;
+               *p_cookie = entry->cookie;
+          }
+          if (res.READDIR3res_u.resok.reply.eof)
+               *p_cookie = 0;
+          rc = LG_OK;
+     }
+
+     clnt_freeres(cl->conn->clnt, (xdrproc_t) xdr_READDIR3res,
+                  (caddr_t) &res);
+     return rc;
+}
+
+#ifdef _USE_NLM
+
+static void v3_nlm_lock(lg_client_t *cl, nlm4_lock *alock, lg_file_t *file,
+                        uint64_t offset, uint64_t length)
+{
+     alock->caller_name = cl->owner;
+     alock->fh.n_len = file->fh.len;
+     alock->fh.n_bytes = file->fh.val;
+     alock->oh.n_len = strlen(cl->owner);
+     alock->oh.n_bytes = cl->owner;
+     alock->svid = cl->id + 1;
+     alock->l_offset = offset;
+     alock->l_len = length;
+}
+
+static int v3_lock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint64_t length)
+{
+     nlm4_lockargs args;
+     nlm4_res res;
+
+     memset(&args, 0, sizeof(args));
+     args.cookie.n_len = sizeof(cl->seq);
+     args.cookie.n_bytes = (char *) &cl->seq;
+     args.block = FALSE;
+     args.exclusive = TRUE;
+     v3_nlm_lock(cl, &args.alock, file, offset, length);
+
+     for (;;) {
+          memset(&res, 0, sizeof(res));
+          if (lg_call(cl->nlm_conn, NLMPROC4_LOCK,
+                      (xdrproc_t) xdr_nlm4_lockargs, &args,
+                      (xdrproc_t) xdr_nlm4_res, &res) != LG_OK)
+               return LG_ERROR;
+          clnt_freeres(cl->nlm_conn->clnt, (xdrproc_t) xdr_nlm4_res,
+                       (caddr_t) &res);
+
+          if (res.stat.stat != NLM4_DENIED_GRACE_PERIOD || !cl->in_setup)
+               break;
+          lg_grace_wait(cl, "NLM4_LOCK");
+     }
+
+     switch (res.stat.stat) {
+     case NLM4_GRANTED:
+          return LG_OK;
+     case NLM4_DENIED:
+     case NLM4_BLOCKED:
+          return LG_DENIED;
+     default:
+          return LG_ERROR;
+     }
+}
+
+static int v3_unlock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                     uint64_t length)
+{
+     nlm4_unlockargs args;
+     nlm4_res res;
+
+     memset(&args, 0, sizeof(args));
+     args.cookie.n_len = sizeof(cl->seq);
+     args.cookie.n_bytes = (char *) &cl->seq;
+     v3_nlm_lock(cl, &args.alock, file, offset, length);
+     memset(&res, 0, sizeof(res));
+
+     if (lg_call(cl->nlm_conn, NLMPROC4_UNLOCK,
+                 (xdrproc_t) xdr_nlm4_unlockargs, &args,
+                 (xdrproc_t) xdr_nlm4_res, &res) != LG_OK)
+          return LG_ERROR;
+     clnt_freeres(cl->nlm_conn->clnt, (xdrproc_t) xdr_nlm4_res,
+                  (caddr_t) &res);
+
+     return res.stat.stat == NLM4_GRANTED ? LG_OK : LG_ERROR;
+}
+
+#else
+
+static int v3_lock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint64_t length)
+{
+     return LG_ERROR;
+}
+
+static int v3_unlock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                     uint64_t length)
+{
+     return LG_ERROR;
+}
+
+#endif /* _USE_NLM */
+
+const lg_proto_t lg_proto_v3 = {
+     .name = "3",
+     .setup = v3_setup,
+     .teardown = v3_teardown,
+     .lookup = v3_lookup,
+     .getattr = v3_getattr,
+     .mkdir = v3_mkdir,
+     .create = v3_create,
+     .open = v3_open,
+     .close = v3_close,
+     .read = v3_read,
+     .write = v3_write,
+     .commit = v3_commit,
+     .remove = v3_remove,
+     .readdir = v3_readdir,
+     .lock = v3_lock,
+     .unlock = v3_unlock
+};
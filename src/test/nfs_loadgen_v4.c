@@ -0,0 +1,842 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   nfs_loadgen_v4.c
+ * @brief  NFSv4.0 and NFSv4.1 backends of the load generator
+ *
+ * Each generator client is an NFSv4 client of its own: a client id
+ * confirmed through SETCLIENTID (4.0) or EXCHANGE_ID and a session of
+ * one slot (4.1), one open owner, and one lock owner.  Every operation
+ * is a single COMPOUND, led by SEQUENCE in 4.1.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/param.h>
+#include <arpa/inet.h>
+#include "nfs_loadgen.h"
+
+#define V4_MAX_OPS 16
+
+typedef struct v4_compound {
+     COMPOUND4args args;
+     COMPOUND4res res;
+     nfs_argop4 ops[V4_MAX_OPS];
+     int decoded;
+} v4_compound_t;
+
+#define V4_ARG(_c_, _i_) (&(_c_)->ops[_i_].nfs_argop4_u)
+#define V4_RES(_c_, _i_) (&(_c_)->res.resarray.resarray_val[_i_].nfs_resop4_u)
+
+static int v4_minor(lg_client_t *cl)
+{
+#ifdef _USE_NFS4_1
+     return cl->proto == &lg_proto_v41;
+#else
+     return 0;
+#endif
+}
+
+/* Open and lock owner sequence ids count in NFSv4.0 only */
+static seqid4 v4_seqid(lg_client_t *cl, seqid4 seqid)
+{
+     return v4_minor(cl) ? 0 : seqid;
+}
+
+/* Whether an owner's sequence id moved on with this status (RFC 3530) */
+static int v4_seqid_bumps(nfsstat4 status)
+{
+     switch (status) {
+     case NFS4ERR_STALE_CLIENTID:
+     case NFS4ERR_STALE_STATEID:
+     case NFS4ERR_BAD_STATEID:
+     case NFS4ERR_BAD_SEQID:
+     case NFS4ERR_BADXDR:
+     case NFS4ERR_RESOURCE:
+     case NFS4ERR_NOFILEHANDLE:
+          return 0;
+     default:
+          return 1;
+     }
+}
+
+static int v4_op(v4_compound_t *c, nfs_opnum4 op)
+{
+     int i = c->args.argarray.argarray_len++;
+
+     memset(&c->ops[i], 0, sizeof(c->ops[i]));
+     c->ops[i].argop = op;
+
+     return i;
+}
+
+static void v4_begin(lg_client_t *cl, v4_compound_t *c, int sequence)
+{
+     SEQUENCE4args *seq;
+
+     memset(&c->args, 0, sizeof(c->args));
+     c->args.minorversion = v4_minor(cl);
+     c->args.argarray.argarray_val = c->ops;
+     c->decoded = FALSE;
+
+     if (!sequence || !v4_minor(cl))
+          return;
+
+     seq = &V4_ARG(c, v4_op(c, NFS4_OP_SEQUENCE))->opsequence;
+     memcpy(seq->sa_sessionid, cl->sessionid, NFS4_SESSIONID_SIZE);
+     seq->sa_sequenceid = cl->slot_seqid;
+     seq->sa_slotid = 0;
+     seq->sa_highest_slotid = 0;
+     seq->sa_cachethis = FALSE;
+}
+
+static void v4_putfh(v4_compound_t *c, lg_fh_t *fh)
+{
+     PUTFH4args *putfh = &V4_ARG(c, v4_op(c, NFS4_OP_PUTFH))->opputfh;
+
+     putfh->object.nfs_fh4_len = fh->len;
+     putfh->object.nfs_fh4_val = fh->val;
+}
+
+static void v4_name(component4 *comp, const char *name)
+{
+     comp->utf8string_len = strlen(name);
+     comp->utf8string_val = (char *) name;
+}
+
+static void v4_done(lg_client_t *cl, v4_compound_t *c)
+{
+     if (c->decoded)
+          clnt_freeres(cl->conn->clnt, (xdrproc_t) xdr_COMPOUND4res,
+                       (caddr_t) &c->res);
+     c->decoded = FALSE;
+}
+
+/**
+ * Send a COMPOUND, the status of the last operation done is returned,
+ * or -1 if the call did not go through.
+ */
+static int v4_call(lg_client_t *cl, v4_compound_t *c)
+{
+     memset(&c->res, 0, sizeof(c->res));
+
+     if (lg_call(cl->conn, NFSPROC4_COMPOUND,
+                 (xdrproc_t) xdr_COMPOUND4args, &c->args,
+                 (xdrproc_t) xdr_COMPOUND4res, &c->res) != LG_OK)
+          return -1;
+     c->decoded = TRUE;
+
+#ifdef _USE_NFS4_1
+     if (c->args.argarray.argarray_len > 0 &&
+         c->ops[0].argop == NFS4_OP_SEQUENCE &&
+         c->res.resarray.resarray_len > 0 &&
+         V4_RES(c, 0)->opsequence.sr_status == NFS4_OK)
+          cl->slot_seqid++;
+#endif
+
+     return c->res.status;
+}
+
+/* Whether to send again, after the grace period, a call that met it */
+static int v4_retry(lg_client_t *cl, v4_compound_t *c, int status,
+                    const char *what)
+{
+     if (!cl->in_setup ||
+         (status != NFS4ERR_GRACE && status != NFS4ERR_DELAY))
+          return FALSE;
+
+     v4_done(cl, c);
+     lg_grace_wait(cl, what);
+     return TRUE;
+}
+
+static int v4_getfh(v4_compound_t *c, int i, lg_fh_t *fh)
+{
+     nfs_fh4 *object = &V4_RES(c, i)->opgetfh.GETFH4res_u.resok4.object;
+
+     if (object->nfs_fh4_len > sizeof(fh->val))
+          return LG_ERROR;
+     fh->len = object->nfs_fh4_len;
+     memcpy(fh->val, object->nfs_fh4_val, fh->len);
+     return LG_OK;
+}
+
+/* One mode attribute, as CREATE and OPEN take them */
+static void v4_mode_attr(fattr4 *attrs, uint32_t *mask, uint32_t *val,
+                         uint32_t mode)
+{
+     mask[0] = 0;
+     mask[1] = 1 << (FATTR4_MODE - 32);
+     *val = htonl(mode);
+     attrs->attrmask.bitmap4_len = 2;
+     attrs->attrmask.bitmap4_val = mask;
+     attrs->attr_vals.attrlist4_len = sizeof(*val);
+     attrs->attr_vals.attrlist4_val = (char *) val;
+}
+
+static int v4_root(lg_client_t *cl, const char *export)
+{
+     v4_compound_t c;
+     char path[MAXPATHLEN];
+     char *comp, *next;
+     int status, getfh, rc = LG_ERROR;
+
+     if (strlen(export) >= sizeof(path))
+          return LG_ERROR;
+     strcpy(path, export);
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          v4_op(&c, NFS4_OP_PUTROOTFH);
+          for (comp = strtok_r(path, "/", &next); comp != NULL;
+               comp = strtok_r(NULL, "/", &next)) {
+               if (c.args.argarray.argarray_len >= V4_MAX_OPS - 1) {
+                    fprintf(stderr, "client %u: export path %s is too deep\n",
+                            cl->id, export);
+                    return LG_ERROR;
+               }
+               v4_name(&V4_ARG(&c, v4_op(&c, NFS4_OP_LOOKUP))->oplookup.objname,
+                       comp);
+          }
+          getfh = v4_op(&c, NFS4_OP_GETFH);
+          status = v4_call(cl, &c);
+          /* strtok_r cut the path up, it is taken again for a retry */
+          strcpy(path, export);
+     } while (v4_retry(cl, &c, status, "LOOKUP"));
+
+     if (status == NFS4_OK)
+          rc = v4_getfh(&c, getfh, &cl->root);
+     else
+          fprintf(stderr, "client %u: cannot look %s up: status %d\n",
+                  cl->id, export, status);
+
+     v4_done(cl, &c);
+     return rc;
+}
+
+static void v4_verifier(lg_client_t *cl, char *verf)
+{
+     uint32_t v[2];
+
+     v[0] = getpid();
+     v[1] = cl->id;
+     memcpy(verf, v, NFS4_VERIFIER_SIZE);
+}
+
+static int v40_setup(lg_client_t *cl, const char *export)
+{
+     v4_compound_t c;
+     SETCLIENTID4args *scid;
+     SETCLIENTID_CONFIRM4args *confirm;
+     SETCLIENTID4resok *resok;
+     int i, status;
+
+     v4_begin(cl, &c, FALSE);
+     i = v4_op(&c, NFS4_OP_SETCLIENTID);
+     scid = &V4_ARG(&c, i)->opsetclientid;
+     v4_verifier(cl, scid->client.verifier);
+     scid->client.id.id_len = strlen(cl->owner);
+     scid->client.id.id_val = cl->owner;
+     /* no callback, the generator never takes delegations */
+     scid->callback.cb_program = 0;
+     scid->callback.cb_location.r_netid = "tcp";
+     scid->callback.cb_location.r_addr = "0.0.0.0.0.0";
+     scid->callback_ident = 0;
+
+     status = v4_call(cl, &c);
+     if (status != NFS4_OK) {
+          fprintf(stderr, "client %u: SETCLIENTID: status %d\n", cl->id,
+                  status);
+          v4_done(cl, &c);
+          return LG_ERROR;
+     }
+     resok = &V4_RES(&c, i)->opsetclientid.SETCLIENTID4res_u.resok4;
+     cl->clientid = resok->clientid;
+
+     v4_begin(cl, &c, FALSE);
+     confirm = &V4_ARG(&c, v4_op(&c, NFS4_OP_SETCLIENTID_CONFIRM))
+          ->opsetclientid_confirm;
+     confirm->clientid = cl->clientid;
+     memcpy(confirm->setclientid_confirm, resok->setclientid_confirm,
+            NFS4_VERIFIER_SIZE);
+     v4_done(cl, &c);
+
+     status = v4_call(cl, &c);
+     v4_done(cl, &c);
+     if (status != NFS4_OK) {
+          fprintf(stderr, "client %u: SETCLIENTID_CONFIRM: status %d\n",
+                  cl->id, status);
+          return LG_ERROR;
+     }
+
+     cl->open_seqid = 0;
+     return v4_root(cl, export);
+}
+
+static void v40_teardown(lg_client_t *cl)
+{
+     /* the state goes with the lease */
+}
+
+#ifdef _USE_NFS4_1
+
+static int v41_setup(lg_client_t *cl, const char *export)
+{
+     v4_compound_t c;
+     EXCHANGE_ID4args *exid;
+     CREATE_SESSION4args *cs;
+     callback_sec_parms4 sec_parms;
+     sequenceid4 sequence;
+     int i, status;
+
+     v4_begin(cl, &c, FALSE);
+     i = v4_op(&c, NFS4_OP_EXCHANGE_ID);
+     exid = &V4_ARG(&c, i)->opexchange_id;
+     v4_verifier(cl, exid->eia_clientowner.co_verifier);
+     exid->eia_clientowner.co_ownerid.co_ownerid_len = strlen(cl->owner);
+     exid->eia_clientowner.co_ownerid.co_ownerid_val = cl->owner;
+     exid->eia_flags = EXCHGID4_FLAG_USE_NON_PNFS;
+     exid->eia_state_protect.spa_how = SP4_NONE;
+
+     status = v4_call(cl, &c);
+     if (status != NFS4_OK) {
+          fprintf(stderr, "client %u: EXCHANGE_ID: status %d\n", cl->id,
+                  status);
+          v4_done(cl, &c);
+          return LG_ERROR;
+     }
+     cl->clientid = V4_RES(&c, i)->opexchange_id.EXCHANGE_ID4res_u
+          .eir_resok4.eir_clientid;
+     sequence = V4_RES(&c, i)->opexchange_id.EXCHANGE_ID4res_u
+          .eir_resok4.eir_sequenceid;
+     v4_done(cl, &c);
+
+     v4_begin(cl, &c, FALSE);
+     i = v4_op(&c, NFS4_OP_CREATE_SESSION);
+     cs = &V4_ARG(&c, i)->opcreate_session;
+     cs->csa_clientid = cl->clientid;
+     cs->csa_sequence = sequence;
+     cs->csa_flags = 0;
+     /* one slot, large enough for the largest READ or WRITE */
+     cs->csa_fore_chan_attrs.ca_maxrequestsize = 2 * 1024 * 1024;
+     cs->csa_fore_chan_attrs.ca_maxresponsesize = 2 * 1024 * 1024;
+     cs->csa_fore_chan_attrs.ca_maxresponsesize_cached = 4096;
+     cs->csa_fore_chan_attrs.ca_maxoperations = V4_MAX_OPS;
+     cs->csa_fore_chan_attrs.ca_maxrequests = 1;
+     cs->csa_back_chan_attrs.ca_maxrequestsize = 4096;
+     cs->csa_back_chan_attrs.ca_maxresponsesize = 4096;
+     cs->csa_back_chan_attrs.ca_maxresponsesize_cached = 0;
+     cs->csa_back_chan_attrs.ca_maxoperations = 2;
+     cs->csa_back_chan_attrs.ca_maxrequests = 1;
+     cs->csa_cb_program = 0x40000000;
+     memset(&sec_parms, 0, sizeof(sec_parms));
+     sec_parms.cb_secflavor = AUTH_NONE;
+     cs->csa_sec_parms.csa_sec_parms_len = 1;
+     cs->csa_sec_parms.csa_sec_parms_val = &sec_parms;
+
+     status = v4_call(cl, &c);
+     if (status != NFS4_OK) {
+          fprintf(stderr, "client %u: CREATE_SESSION: status %d\n", cl->id,
+                  status);
+          v4_done(cl, &c);
+          return LG_ERROR;
+     }
+     memcpy(cl->sessionid, V4_RES(&c, i)->opcreate_session
+            .CREATE_SESSION4res_u.csr_resok4.csr_sessionid,
+            NFS4_SESSIONID_SIZE);
+     v4_done(cl, &c);
+     cl->slot_seqid = 1;
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          V4_ARG(&c, v4_op(&c, NFS4_OP_RECLAIM_COMPLETE))
+               ->opreclaim_complete.rca_one_fs = FALSE;
+          status = v4_call(cl, &c);
+     } while (v4_retry(cl, &c, status, "RECLAIM_COMPLETE"));
+     v4_done(cl, &c);
+
+     /* done already, if another client of the same server sent it */
+     if (status != NFS4_OK && status != NFS4ERR_COMPLETE_ALREADY) {
+          fprintf(stderr, "client %u: RECLAIM_COMPLETE: status %d\n",
+                  cl->id, status);
+          return LG_ERROR;
+     }
+
+     return v4_root(cl, export);
+}
+
+static void v41_teardown(lg_client_t *cl)
+{
+     v4_compound_t c;
+
+     v4_begin(cl, &c, FALSE);
+     memcpy(V4_ARG(&c, v4_op(&c, NFS4_OP_DESTROY_SESSION))
+            ->opdestroy_session.dsa_sessionid, cl->sessionid,
+            NFS4_SESSIONID_SIZE);
+     (void) v4_call(cl, &c);
+     v4_done(cl, &c);
+
+     v4_begin(cl, &c, FALSE);
+     V4_ARG(&c, v4_op(&c, NFS4_OP_DESTROY_CLIENTID))
+          ->opdestroy_clientid.dca_clientid = cl->clientid;
+     (void) v4_call(cl, &c);
+     v4_done(cl, &c);
+}
+
+#endif /* _USE_NFS4_1 */
+
+static int v4_lookup(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     lg_fh_t *fh)
+{
+     v4_compound_t c;
+     int getfh, status, rc = LG_ERROR;
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          v4_putfh(&c, dir);
+          v4_name(&V4_ARG(&c, v4_op(&c, NFS4_OP_LOOKUP))->oplookup.objname,
+                  name);
+          getfh = v4_op(&c, NFS4_OP_GETFH);
+          status = v4_call(cl, &c);
+     } while (v4_retry(cl, &c, status, "LOOKUP"));
+
+     if (status == NFS4_OK)
+          rc = v4_getfh(&c, getfh, fh);
+
+     v4_done(cl, &c);
+     return rc;
+}
+
+static int v4_getattr(lg_client_t *cl, lg_fh_t *fh)
+{
+     v4_compound_t c;
+     GETATTR4args *getattr;
+     uint32_t mask = (1 << FATTR4_TYPE) | (1 << FATTR4_CHANGE) |
+          (1 << FATTR4_SIZE);
+     int status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, fh);
+     getattr = &V4_ARG(&c, v4_op(&c, NFS4_OP_GETATTR))->opgetattr;
+     getattr->attr_request.bitmap4_len = 1;
+     getattr->attr_request.bitmap4_val = &mask;
+     status = v4_call(cl, &c);
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_mkdir(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                    lg_fh_t *fh)
+{
+     v4_compound_t c;
+     CREATE4args *create;
+     uint32_t mask[2], mode;
+     int getfh, status, rc = LG_ERROR;
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          v4_putfh(&c, dir);
+          create = &V4_ARG(&c, v4_op(&c, NFS4_OP_CREATE))->opcreate;
+          create->objtype.type = NF4DIR;
+          v4_name(&create->objname, name);
+          v4_mode_attr(&create->createattrs, mask, &mode, 0755);
+          getfh = v4_op(&c, NFS4_OP_GETFH);
+          status = v4_call(cl, &c);
+     } while (v4_retry(cl, &c, status, "CREATE"));
+
+     if (status == NFS4_OK)
+          rc = v4_getfh(&c, getfh, fh);
+     v4_done(cl, &c);
+
+     if (status == NFS4ERR_EXIST)
+          rc = v4_lookup(cl, dir, name, fh);
+
+     return rc;
+}
+
+static int v40_open_confirm(lg_client_t *cl, lg_file_t *file)
+{
+     v4_compound_t c;
+     OPEN_CONFIRM4args *confirm;
+     int i, status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     i = v4_op(&c, NFS4_OP_OPEN_CONFIRM);
+     confirm = &V4_ARG(&c, i)->opopen_confirm;
+     confirm->open_stateid = file->open_stateid;
+     confirm->seqid = cl->open_seqid;
+     status = v4_call(cl, &c);
+     if (status >= 0 && v4_seqid_bumps(status))
+          cl->open_seqid++;
+
+     if (status == NFS4_OK)
+          file->open_stateid = V4_RES(&c, i)->opopen_confirm
+               .OPEN_CONFIRM4res_u.resok4.open_stateid;
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_open_common(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                          int create, lg_file_t *file)
+{
+     v4_compound_t c;
+     OPEN4args *open;
+     OPEN4resok *resok;
+     uint32_t mask[2], mode;
+     int i, getfh, status, rc = LG_ERROR;
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          v4_putfh(&c, dir);
+          i = v4_op(&c, NFS4_OP_OPEN);
+          open = &V4_ARG(&c, i)->opopen;
+          open->seqid = v4_seqid(cl, cl->open_seqid);
+          open->share_access = OPEN4_SHARE_ACCESS_BOTH;
+          open->share_deny = OPEN4_SHARE_DENY_NONE;
+          open->owner.clientid = cl->clientid;
+          open->owner.owner.owner_len = strlen(cl->owner);
+          open->owner.owner.owner_val = cl->owner;
+          if (create) {
+               open->openhow.opentype = OPEN4_CREATE;
+               open->openhow.openflag4_u.how.mode = UNCHECKED4;
+               v4_mode_attr(&open->openhow.openflag4_u.how.createhow4_u
+                            .createattrs, mask, &mode, 0644);
+          } else {
+               open->openhow.opentype = OPEN4_NOCREATE;
+          }
+          open->claim.claim = CLAIM_NULL;
+          v4_name(&open->claim.open_claim4_u.file, name);
+          getfh = v4_op(&c, NFS4_OP_GETFH);
+          status = v4_call(cl, &c);
+          if (!v4_minor(cl) && status >= 0 &&
+              c.res.resarray.resarray_len > i &&
+              v4_seqid_bumps(V4_RES(&c, i)->opopen.status))
+               cl->open_seqid++;
+     } while (v4_retry(cl, &c, status, "OPEN"));
+
+     if (status == NFS4_OK) {
+          resok = &V4_RES(&c, i)->opopen.OPEN4res_u.resok4;
+          file->open_stateid = resok->stateid;
+          file->has_lock_stateid = FALSE;
+          rc = v4_getfh(&c, getfh, &file->fh);
+          if (rc == LG_OK && !v4_minor(cl) &&
+              (resok->rflags & OPEN4_RESULT_CONFIRM))
+               rc = v40_open_confirm(cl, file);
+     }
+
+     v4_done(cl, &c);
+     return rc;
+}
+
+static int v4_create(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     lg_file_t *file)
+{
+     return v4_open_common(cl, dir, name, TRUE, file);
+}
+
+static int v4_open(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                   lg_file_t *file)
+{
+     return v4_open_common(cl, dir, name, FALSE, file);
+}
+
+static int v4_close(lg_client_t *cl, lg_file_t *file)
+{
+     v4_compound_t c;
+     CLOSE4args *close;
+     int i, status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     i = v4_op(&c, NFS4_OP_CLOSE);
+     close = &V4_ARG(&c, i)->opclose;
+     close->seqid = v4_seqid(cl, cl->open_seqid);
+     close->open_stateid = file->open_stateid;
+     status = v4_call(cl, &c);
+     if (!v4_minor(cl) && status >= 0 && c.res.resarray.resarray_len > i &&
+         v4_seqid_bumps(V4_RES(&c, i)->opclose.status))
+          cl->open_seqid++;
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_read(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint32_t count, int *p_eof)
+{
+     v4_compound_t c;
+     READ4args *read;
+     int i, status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     i = v4_op(&c, NFS4_OP_READ);
+     read = &V4_ARG(&c, i)->opread;
+     read->stateid = file->open_stateid;
+     read->offset = offset;
+     read->count = count;
+     status = v4_call(cl, &c);
+     if (status == NFS4_OK)
+          *p_eof = V4_RES(&c, i)->opread.READ4res_u.resok4.eof;
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_write(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                    uint32_t count)
+{
+     v4_compound_t c;
+     WRITE4args *write;
+     int i, status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     i = v4_op(&c, NFS4_OP_WRITE);
+     write = &V4_ARG(&c, i)->opwrite;
+     write->stateid = file->open_stateid;
+     write->offset = offset;
+     write->stable = UNSTABLE4;
+     write->data.data_len = count;
+     write->data.data_val = cl->buf;
+     status = v4_call(cl, &c);
+     if (status == NFS4_OK &&
+         V4_RES(&c, i)->opwrite.WRITE4res_u.resok4.count != count)
+          status = NFS4ERR_IO;
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_commit(lg_client_t *cl, lg_file_t *file)
+{
+     v4_compound_t c;
+     int status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     v4_op(&c, NFS4_OP_COMMIT);
+     status = v4_call(cl, &c);
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_remove(lg_client_t *cl, lg_fh_t *dir, const char *name,
+                     int is_dir)
+{
+     v4_compound_t c;
+     int status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, dir);
+     v4_name(&V4_ARG(&c, v4_op(&c, NFS4_OP_REMOVE))->opremove.target, name);
+     status = v4_call(cl, &c);
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_readdir(lg_client_t *cl, lg_fh_t *dir, uint64_t *p_cookie,
+                      char *verf, unsigned int *p_entries)
+{
+     v4_compound_t c;
+     READDIR4args *readdir;
+     READDIR4resok *resok;
+     entry4 *entry;
+     uint32_t mask = 1 << FATTR4_FILEID;
+     int i, status;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, dir);
+     i = v4_op(&c, NFS4_OP_READDIR);
+     readdir = &V4_ARG(&c, i)->opreaddir;
+     readdir->cookie = *p_cookie;
+     memcpy(readdir->cookieverf, verf, NFS4_VERIFIER_SIZE);
+     readdir->dircount = 8192;
+     readdir->maxcount = 32768;
+     readdir->attr_request.bitmap4_len = 1;
+     readdir->attr_request.bitmap4_val = &mask;
+     status = v4_call(cl, &c);
+
+     if (status == NFS4_OK) {
+          resok = &V4_RES(&c, i)->opreaddir.READDIR4res_u.resok4;
+          memcpy(verf, resok->cookieverf, NFS4_VERIFIER_SIZE);
+          for (entry = resok->reply.entries; entry != NULL;
+               entry = entry->nextentry) {
+               (*p_entries)++;
+               *p_cookie = entry->cookie;
+          }
+          if (resok->reply.eof)
+               *p_cookie = 0;
+     }
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+static int v4_lock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                   uint64_t length)
+{
+     v4_compound_t c;
+     LOCK4args *lock;
+     open_to_lock_owner4 *open_owner;
+     char owner[sizeof(cl->owner) + 24];
+     int i, status;
+
+     do {
+          v4_begin(cl, &c, TRUE);
+          v4_putfh(&c, &file->fh);
+          i = v4_op(&c, NFS4_OP_LOCK);
+          lock = &V4_ARG(&c, i)->oplock;
+          lock->locktype = WRITE_LT;
+          lock->reclaim = FALSE;
+          lock->offset = offset;
+          lock->length = length;
+          if (file->has_lock_stateid) {
+               lock->locker.new_lock_owner = FALSE;
+               lock->locker.locker4_u.lock_owner.lock_stateid =
+                    file->lock_stateid;
+               lock->locker.locker4_u.lock_owner.lock_seqid =
+                    v4_seqid(cl, cl->lock_seqid);
+          } else {
+               /* a lock owner the server may have half made on a denial
+                * is not taken again: each attempt is a new one */
+               snprintf(owner, sizeof(owner), "%s.lock%llu", cl->owner,
+                        (unsigned long long) cl->seq++);
+               lock->locker.new_lock_owner = TRUE;
+               open_owner = &lock->locker.locker4_u.open_owner;
+               open_owner->open_seqid = v4_seqid(cl, cl->open_seqid);
+               open_owner->open_stateid = file->open_stateid;
+               open_owner->lock_seqid = 0;
+               open_owner->lock_owner.clientid = cl->clientid;
+               open_owner->lock_owner.owner.owner_len = strlen(owner);
+               open_owner->lock_owner.owner.owner_val = owner;
+          }
+          status = v4_call(cl, &c);
+          if (!v4_minor(cl) && status >= 0 &&
+              c.res.resarray.resarray_len > i &&
+              v4_seqid_bumps(V4_RES(&c, i)->oplock.status)) {
+               if (file->has_lock_stateid)
+                    cl->lock_seqid++;
+               else
+                    cl->open_seqid++;
+          }
+     } while (v4_retry(cl, &c, status, "LOCK"));
+
+     if (status == NFS4_OK) {
+          if (!file->has_lock_stateid)
+               cl->lock_seqid = 1;
+          file->lock_stateid = V4_RES(&c, i)->oplock.LOCK4res_u.resok4
+               .lock_stateid;
+          file->has_lock_stateid = TRUE;
+     }
+     v4_done(cl, &c);
+
+     switch (status) {
+     case NFS4_OK:
+          return LG_OK;
+     case NFS4ERR_DENIED:
+          return LG_DENIED;
+     default:
+          return LG_ERROR;
+     }
+}
+
+static int v4_unlock(lg_client_t *cl, lg_file_t *file, uint64_t offset,
+                     uint64_t length)
+{
+     v4_compound_t c;
+     LOCKU4args *locku;
+     int i, status;
+
+     if (!file->has_lock_stateid)
+          return LG_ERROR;
+
+     v4_begin(cl, &c, TRUE);
+     v4_putfh(&c, &file->fh);
+     i = v4_op(&c, NFS4_OP_LOCKU);
+     locku = &V4_ARG(&c, i)->oplocku;
+     locku->locktype = WRITE_LT;
+     locku->seqid = v4_seqid(cl, cl->lock_seqid);
+     locku->lock_stateid = file->lock_stateid;
+     locku->offset = offset;
+     locku->length = length;
+     status = v4_call(cl, &c);
+     if (!v4_minor(cl) && status >= 0 && c.res.resarray.resarray_len > i &&
+         v4_seqid_bumps(V4_RES(&c, i)->oplocku.status))
+          cl->lock_seqid++;
+     if (status == NFS4_OK)
+          file->lock_stateid = V4_RES(&c, i)->oplocku.LOCKU4res_u
+               .lock_stateid;
+     v4_done(cl, &c);
+
+     return status == NFS4_OK ? LG_OK : LG_ERROR;
+}
+
+const lg_proto_t lg_proto_v40 = {
+     .name = "4.0",
+     .setup = v40_setup,
+     .teardown = v40_teardown,
+     .lookup = v4_lookup,
+     .getattr = v4_getattr,
+     .mkdir = v4_mkdir,
+     .create = v4_create,
+     .open = v4_open,
+     .close = v4_close,
+     .read = v4_read,
+     .write = v4_write,
+     .commit = v4_commit,
+     .remove = v4_remove,
+     .readdir = v4_readdir,
+     .lock = v4_lock,
+     .unlock = v4_unlock
+};
+
+#ifdef _USE_NFS4_1
+const lg_proto_t lg_proto_v41 = {
+     .name = "4.1",
+     .setup = v41_setup,
+     .teardown = v41_teardown,
+     .lookup = v4_lookup,
+     .getattr = v4_getattr,
+     .mkdir = v4_mkdir,
+     .create = v4_create,
+     .open = v4_open,
+     .close = v4_close,
+     .read = v4_read,
+     .write = v4_write,
+     .commit = v4_commit,
+     .remove = v4_remove,
+     .readdir = v4_readdir,
+     .lock = v4_lock,
+     .unlock = v4_unlock
+};
+#endif /* _USE_NFS4_1 */
@@ -0,0 +1,221 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_cache_inode_commit.c
+ * @brief  Concurrent committers of one file share FSAL_commits
+ *
+ * The FSAL_commit is replaced by a slow one that counts its calls.
+ * Threads that have all written before any of them commits must be
+ * covered by a single FSAL_commit.  A commit with no write since the
+ * last one must not reach the FSAL, and a write done while an
+ * FSAL_commit runs must get one of its own.  A lone committer must
+ * not need the cold part of the file.
+ *
+ * Usage: test_cache_inode_commit
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "log.h"
+#include "fsal.h"
+#include "HashTable.h"
+#include "cache_inode.h"
+#include "abstract_atomic.h"
+
+#define TEST_THREADS     8
+#define TEST_COMMIT_USEC 100000
+
+static uint64_t fsal_commits;
+static uint32_t commit_started;
+static cache_entry_t *entry;
+static pthread_barrier_t barrier;
+
+static fsal_status_t
+test_commit(fsal_file_t *p_file_descriptor, fsal_off_t offset,
+            fsal_size_t length)
+{
+     fsal_status_t status = {ERR_FSAL_NO_ERROR, 0};
+
+     atomic_inc_uint64_t(&fsal_commits);
+     atomic_store_uint32_t(&commit_started, 1);
+     usleep(TEST_COMMIT_USEC);
+     return status;
+}
+
+static fsal_functions_t
+test_stack(fsal_functions_t lower)
+{
+     lower.fsal_commit = test_commit;
+     return lower;
+}
+
+static int
+test_display(hash_buffer_t *buff, char *str)
+{
+     return sprintf(str, "%p", buff->pdata);
+}
+
+/* As cache_inode_rdwr does after an FSAL_write */
+static void
+test_write(void)
+{
+     atomic_inc_uint64_t(&entry->object.file.write_seq);
+}
+
+static void
+test_commit_check(const char *label)
+{
+     fsal_status_t status;
+
+     status = cache_inode_group_commit(entry, NULL);
+     if (FSAL_IS_ERROR(status)) {
+          printf("%s: commit failed: %d\n", label, status.major);
+          exit(1);
+     }
+}
+
+static void
+test_expect(const char *label, uint64_t expected)
+{
+     uint64_t got = atomic_fetch_uint64_t(&fsal_commits);
+
+     if (got != expected) {
+          printf("%s: %llu FSAL_commits, expected %llu\n", label,
+                 (unsigned long long) got, (unsigned long long) expected);
+          exit(1);
+     }
+     printf("%s: ok\n", label);
+}
+
+static void
+test_new_entry(void)
+{
+     if (entry != NULL) {
+          cache_inode_release_file_cold(entry);
+          free(entry);
+     }
+     entry = calloc(1, sizeof(cache_entry_t));
+     if (entry == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+     /* As cache_inode_new_entry sets up a REGULAR_FILE */
+     entry->type = REGULAR_FILE;
+     entry->object.file.cold = NULL;
+     entry->object.file.write_seq = 1;
+     entry->object.file.synced_seq = 0;
+     entry->object.file.commit_running = FALSE;
+     atomic_store_uint64_t(&fsal_commits, 0);
+}
+
+static void *
+test_writer(void *arg)
+{
+     test_write();
+     pthread_barrier_wait(&barrier);
+     test_commit_check("writers");
+     return NULL;
+}
+
+static void *
+test_early(void *arg)
+{
+     test_write();
+     test_commit_check("early writer");
+     return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+     cache_inode_parameter_t params;
+     cache_inode_status_t status;
+     pthread_t threads[TEST_THREADS];
+     int i;
+
+     SetDefaultLogging("TEST");
+
+     FSAL_LoadFunctions();
+     FSAL_LoadConsts();
+     FSAL_StackFunctions(test_stack);
+
+     memset(&params, 0, sizeof(params));
+     params.hparam.index_size = 17;
+     params.hparam.alphabet_length = 10;
+     params.hparam.hash_func_both = cache_inode_fsal_rbt_both;
+     params.hparam.compare_key = cache_inode_compare_key_fsal;
+     params.hparam.key_to_str = test_display;
+     params.hparam.val_to_str = test_display;
+     params.hparam.ht_name = "Cache Inode";
+     params.hparam.ht_log_component = COMPONENT_HASHTABLE;
+     if (cache_inode_init(params, &status) == NULL) {
+          printf("Unable to initialise the cache inode: %d\n", status);
+          exit(1);
+     }
+
+     /* A lone committer needs no cold part */
+     test_new_entry();
+     test_write();
+     test_commit_check("lone committer");
+     if (entry->object.file.cold != NULL) {
+          printf("lone committer: the cold part was allocated\n");
+          exit(1);
+     }
+     test_expect("lone committer", 1);
+
+     /* Nothing written since, nothing to commit */
+     test_commit_check("no new write");
+     test_expect("no new write", 1);
+
+     /* Every write is done before any commit: one covers them all */
+     test_new_entry();
+     pthread_barrier_init(&barrier, NULL, TEST_THREADS);
+     for (i = 0; i < TEST_THREADS; i++)
+          if (pthread_create(&threads[i], NULL, test_writer, NULL) != 0) {
+               printf("Unable to start a writer\n");
+               exit(1);
+          }
+     for (i = 0; i < TEST_THREADS; i++)
+          pthread_join(threads[i], NULL);
+     pthread_barrier_destroy(&barrier);
+     test_expect("concurrent committers", 1);
+
+     /* A write done while an FSAL_commit runs needs another */
+     test_new_entry();
+     atomic_store_uint32_t(&commit_started, 0);
+     if (pthread_create(&threads[0], NULL, test_early, NULL) != 0) {
+          printf("Unable to start a writer\n");
+          exit(1);
+     }
+     while (!atomic_fetch_uint32_t(&commit_started))
+          usleep(1000);
+     test_write();
+     test_commit_check("late writer");
+     pthread_join(threads[0], NULL);
+     test_expect("write during a commit", 2);
+
+     cache_inode_release_file_cold(entry);
+     free(entry);
+
+     return 0;
+}
@@ -0,0 +1,300 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_cache_inode_io_fds.c
+ * @brief  The descriptors a file keeps besides open_fd
+ *
+ * FSAL_open and FSAL_close are replaced by ones that count the
+ * descriptors open.  With open_fd read-only, writes of both kinds
+ * get descriptors of their own, and a read gets open_fd.  A
+ * descriptor still in use when the file is closed is closed by its
+ * last user.  Threads then open the file read-only and read/write,
+ * read and write through it at once, and now and then close it; once
+ * it is closed for good, neither open_fd_count nor the FSAL may have
+ * a descriptor left open.
+ *
+ * Usage: test_cache_inode_io_fds
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sched.h>
+#include <pthread.h>
+#include "log.h"
+#include "fsal.h"
+#include "HashTable.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+#include "abstract_atomic.h"
+
+#define TEST_THREADS 8
+#define TEST_IOS     20000
+
+static int64_t fsal_fds;
+static uint32_t fsal_overclosed;
+static cache_entry_t *entry;
+static fsal_op_context_t context;
+
+static const fsal_openflags_t io_flags[] = {
+     FSAL_O_RDONLY,
+     FSAL_O_WRONLY,
+     FSAL_O_WRONLY | FSAL_O_SYNC
+};
+
+static fsal_status_t
+test_open(fsal_handle_t *p_filehandle, fsal_op_context_t *p_context,
+          fsal_openflags_t openflags, fsal_file_t *p_file_descriptor,
+          fsal_attrib_list_t *p_file_attributes)
+{
+     fsal_status_t status = {ERR_FSAL_NO_ERROR, 0};
+
+     atomic_inc_int64_t(&fsal_fds);
+     return status;
+}
+
+static fsal_status_t
+test_close(fsal_file_t *p_file_descriptor)
+{
+     fsal_status_t status = {ERR_FSAL_NO_ERROR, 0};
+
+     if (atomic_dec_int64_t(&fsal_fds) < 0)
+          atomic_store_uint32_t(&fsal_overclosed, 1);
+     return status;
+}
+
+static fsal_functions_t
+test_stack(fsal_functions_t lower)
+{
+     lower.fsal_open = test_open;
+     lower.fsal_close = test_close;
+     return lower;
+}
+
+static int
+test_display(hash_buffer_t *buff, char *str)
+{
+     return sprintf(str, "%p", buff->pdata);
+}
+
+static void
+test_open_check(fsal_openflags_t openflags, const char *label)
+{
+     cache_inode_status_t status;
+
+     if (cache_inode_open(entry, openflags, &context, 0, &status) !=
+         CACHE_INODE_SUCCESS) {
+          printf("%s: open failed: %d\n", label, status);
+          exit(1);
+     }
+}
+
+static void
+test_close_check(const char *label)
+{
+     cache_inode_status_t status;
+
+     if (cache_inode_close(entry, CACHE_INODE_FLAG_REALLYCLOSE, &status) !=
+         CACHE_INODE_SUCCESS) {
+          printf("%s: close failed: %d\n", label, status);
+          exit(1);
+     }
+}
+
+/* With the content lock held */
+static fsal_file_t *
+test_get(fsal_openflags_t openflags, const char *label)
+{
+     cache_inode_status_t status;
+     fsal_file_t *fd;
+
+     if (cache_inode_io_fd_get(entry, openflags, &context, &fd, &status) !=
+         CACHE_INODE_SUCCESS) {
+          printf("%s: no descriptor for %d: %d\n", label, openflags,
+                 status);
+          exit(1);
+     }
+     return fd;
+}
+
+static void
+test_expect(const char *label, size_t expected)
+{
+     int64_t fds = atomic_fetch_int64_t(&fsal_fds);
+     size_t counted = atomic_fetch_size_t(&open_fd_count);
+
+     if (counted != expected || fds != (int64_t) expected ||
+         atomic_fetch_uint32_t(&fsal_overclosed)) {
+          printf("%s: open_fd_count %zu, %lld FSAL descriptors open%s, "
+                 "expected %zu\n", label, counted, (long long) fds,
+                 fsal_overclosed ? " (one closed twice)" : "", expected);
+          exit(1);
+     }
+     if (expected == 0 && entry->object.file.cold != NULL &&
+         entry->object.file.cold->io_fds_open != 0) {
+          printf("%s: %u descriptors of the set left open\n", label,
+                 entry->object.file.cold->io_fds_open);
+          exit(1);
+     }
+     printf("%s: ok\n", label);
+}
+
+static void
+test_modes(void)
+{
+     fsal_file_t *fds[3];
+     int i;
+
+     test_open_check(FSAL_O_RDONLY, "modes");
+
+     pthread_rwlock_rdlock(&entry->content_lock);
+     for (i = 0; i < 3; i++)
+          fds[i] = test_get(io_flags[i], "modes");
+     if (fds[0] != &entry->object.file.open_fd.fd ||
+         fds[1] == fds[0] || fds[2] == fds[0] || fds[2] == fds[1]) {
+          printf("modes: the descriptors are not those expected\n");
+          exit(1);
+     }
+     /* The same mode shares the descriptor */
+     if (test_get(FSAL_O_WRONLY, "modes") != fds[1]) {
+          printf("modes: two writers got two descriptors\n");
+          exit(1);
+     }
+     cache_inode_io_fd_put(entry, fds[1]);
+     for (i = 0; i < 3; i++)
+          cache_inode_io_fd_put(entry, fds[i]);
+     pthread_rwlock_unlock(&entry->content_lock);
+     test_expect("read, write and stable write", 3);
+
+     /* Closed under the feet of a writer, its descriptor stays open
+        until it is done with it */
+     pthread_rwlock_rdlock(&entry->content_lock);
+     fds[1] = test_get(FSAL_O_WRONLY, "closing");
+     pthread_rwlock_unlock(&entry->content_lock);
+     test_close_check("closing");
+     test_expect("in use when closed", 1);
+     cache_inode_io_fd_put(entry, fds[1]);
+     test_expect("closed by its last user", 0);
+}
+
+static void *
+test_ios(void *arg)
+{
+     unsigned int seed = (unsigned int) (uintptr_t) arg;
+     cache_inode_status_t status;
+     fsal_openflags_t openflags;
+     fsal_file_t *fd;
+     int i;
+
+     for (i = 0; i < TEST_IOS; i++) {
+          switch (rand_r(&seed) % 8) {
+          case 0:
+               test_open_check(FSAL_O_RDONLY, "concurrent");
+               break;
+          case 1:
+               test_open_check(FSAL_O_RDWR, "concurrent");
+               break;
+          case 2:
+               if (i % 16 == 0)
+                    test_close_check("concurrent");
+               break;
+          default:
+               openflags = io_flags[rand_r(&seed) % 3];
+               pthread_rwlock_rdlock(&entry->content_lock);
+               /* Another thread may just have closed the file */
+               if (cache_inode_io_fd_get(entry, openflags, &context, &fd,
+                                         &status) == CACHE_INODE_SUCCESS) {
+                    sched_yield();
+                    cache_inode_io_fd_put(entry, fd);
+               } else if (status != CACHE_INODE_INVALID_ARGUMENT) {
+                    printf("concurrent: no descriptor for %d: %d\n",
+                           openflags, status);
+                    exit(1);
+               }
+               pthread_rwlock_unlock(&entry->content_lock);
+          }
+     }
+
+     return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+     cache_inode_parameter_t params;
+     cache_inode_status_t status;
+     pthread_t threads[TEST_THREADS];
+     uintptr_t i;
+
+     SetDefaultLogging("TEST");
+
+     FSAL_LoadFunctions();
+     FSAL_LoadConsts();
+     FSAL_StackFunctions(test_stack);
+
+     memset(&params, 0, sizeof(params));
+     params.hparam.index_size = 17;
+     params.hparam.alphabet_length = 10;
+     params.hparam.hash_func_both = cache_inode_fsal_rbt_both;
+     params.hparam.compare_key = cache_inode_compare_key_fsal;
+     params.hparam.key_to_str = test_display;
+     params.hparam.val_to_str = test_display;
+     params.hparam.ht_name = "Cache Inode";
+     params.hparam.ht_log_component = COMPONENT_HASHTABLE;
+     if (cache_inode_init(params, &status) == NULL) {
+          printf("Unable to initialise the cache inode: %d\n", status);
+          exit(1);
+     }
+     lru_state.fds_hard_limit = UINT32_MAX;
+     lru_state.fds_hiwat = UINT32_MAX;
+     lru_state.caching_fds = TRUE;
+
+     entry = calloc(1, sizeof(cache_entry_t));
+     if (entry == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+     /* As cache_inode_new_entry sets up a REGULAR_FILE */
+     entry->type = REGULAR_FILE;
+     pthread_rwlock_init(&entry->content_lock, NULL);
+     init_glist(&entry->state_list);
+     entry->object.file.open_fd.openflags = FSAL_O_CLOSED;
+     entry->object.file.cold = NULL;
+     entry->object.file.write_seq = 1;
+
+     test_modes();
+
+     for (i = 0; i < TEST_THREADS; i++)
+          if (pthread_create(&threads[i], NULL, test_ios,
+                             (void *) (i + 1)) != 0) {
+               printf("Unable to start a thread\n");
+               exit(1);
+          }
+     for (i = 0; i < TEST_THREADS; i++)
+          pthread_join(threads[i], NULL);
+     test_close_check("concurrent");
+     test_expect("concurrent opens, I/Os and closes", 0);
+
+     cache_inode_release_file_cold(entry);
+     pthread_rwlock_destroy(&entry->content_lock);
+     free(entry);
+
+     return 0;
+}
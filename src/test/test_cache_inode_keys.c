@@ -0,0 +1,201 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_cache_inode_keys.c
+ * @brief  Cache inode keys in an open addressing hash table
+ *
+ * Two handles of the same length, differing in their last byte, are
+ * inserted into an open addressing table set up as the cache inode
+ * sets up its own, first with their own hashes, then with the same
+ * hash so that a lookup of the second must probe past the first.
+ * Each is looked up through a key of its own, pointing at a copy of
+ * the handle, and must find its own value; the flat keys the lockless
+ * lookups compare must tell the handles apart and match the copies.
+ *
+ * Usage: test_cache_inode_keys
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "HashTable.h"
+#include "cache_inode.h"
+
+#define TEST_HANDLE_LEN 28
+
+static char handles[2][TEST_HANDLE_LEN];
+static char copies[2][TEST_HANDLE_LEN];
+static int values[2];
+
+static int
+test_display(hash_buffer_t *buff, char *str)
+{
+     return sprintf(str, "%p", buff->pdata);
+}
+
+static int
+test_free(hash_buffer_t key, hash_buffer_t val)
+{
+     return 1;
+}
+
+static void
+test_key(cache_inode_fsal_data_t *fsdata, char *handle, uint64_t hash)
+{
+     fsdata->fh_desc.start = (caddr_t) handle;
+     fsdata->fh_desc.len = TEST_HANDLE_LEN;
+     fsdata->hash = hash;
+     if (hash == 0 && !cache_inode_fsal_data_hash(fsdata)) {
+          printf("Unable to hash a handle\n");
+          exit(1);
+     }
+}
+
+static void
+test_flat(cache_inode_fsal_data_t *stored, cache_inode_fsal_data_t *lookup)
+{
+     hash_buffer_t key;
+     char flat1[HASH_OA_KEY_INLINE], flat2[HASH_OA_KEY_INLINE];
+     size_t len1, len2;
+
+     key.pdata = stored;
+     key.len = sizeof(*stored);
+     len1 = cache_inode_fsal_flatten(&key, flat1, sizeof(flat1));
+     key.pdata = lookup;
+     key.len = sizeof(*lookup);
+     len2 = cache_inode_fsal_flatten(&key, flat2, sizeof(flat2));
+
+     if (len1 != TEST_HANDLE_LEN || len2 != len1 ||
+         memcmp(flat1, flat2, len1) != 0) {
+          printf("Flat keys of the same handle differ (%zu, %zu)\n",
+                 len1, len2);
+          exit(1);
+     }
+}
+
+static void
+test_run(const char *label, int same_hash)
+{
+     hash_parameter_t param;
+     hash_table_t *ht;
+     cache_inode_fsal_data_t stored[2], lookup[2];
+     hash_buffer_t key, val;
+     char flat1[HASH_OA_KEY_INLINE], flat2[HASH_OA_KEY_INLINE];
+     int i;
+
+     memset(&param, 0, sizeof(param));
+     param.flags = HT_FLAG_OPEN_ADDR;
+     param.index_size = 17;
+     param.alphabet_length = 10;
+     param.hash_func_both = cache_inode_fsal_rbt_both;
+     param.compare_key = cache_inode_compare_key_fsal;
+     param.key_flatten = cache_inode_fsal_flatten;
+     param.key_to_str = test_display;
+     param.val_to_str = test_display;
+     param.ht_name = (char *) label;
+     param.ht_log_component = COMPONENT_HASHTABLE;
+     cache_inode_params.hparam = param;
+     cache_inode_params.use_fsal_hash = FALSE;
+
+     ht = HashTable_Init(&param);
+     if (ht == NULL) {
+          printf("Unable to create the %s table\n", label);
+          exit(1);
+     }
+
+     for (i = 0; i < 2; i++) {
+          test_key(&stored[i], handles[i], same_hash ? 42 : 0);
+          test_key(&lookup[i], copies[i], same_hash ? 42 : 0);
+          test_flat(&stored[i], &lookup[i]);
+
+          key.pdata = &stored[i];
+          key.len = sizeof(stored[i]);
+          val.pdata = &values[i];
+          val.len = sizeof(values[i]);
+          if (HashTable_Set(ht, &key, &val) != HASHTABLE_SUCCESS) {
+               printf("%s: unable to insert handle %d\n", label, i);
+               exit(1);
+          }
+     }
+
+     /* The flat keys of the two handles differ */
+     key.pdata = &stored[0];
+     key.len = sizeof(stored[0]);
+     (void) cache_inode_fsal_flatten(&key, flat1, sizeof(flat1));
+     key.pdata = &stored[1];
+     (void) cache_inode_fsal_flatten(&key, flat2, sizeof(flat2));
+     if (memcmp(flat1, flat2, TEST_HANDLE_LEN) == 0) {
+          printf("%s: the flat keys of two handles are equal\n", label);
+          exit(1);
+     }
+
+     for (i = 0; i < 2; i++) {
+          key.pdata = &lookup[i];
+          key.len = sizeof(lookup[i]);
+          if (HashTable_Get(ht, &key, &val) != HASHTABLE_SUCCESS) {
+               printf("%s: handle %d not found\n", label, i);
+               exit(1);
+          }
+          if (val.pdata != &values[i]) {
+               printf("%s: handle %d found the value of another\n",
+                      label, i);
+               exit(1);
+          }
+     }
+
+     /* Once the first is gone, the second is still found */
+     key.pdata = &lookup[0];
+     key.len = sizeof(lookup[0]);
+     if (HashTable_Del(ht, &key, NULL, NULL) != HASHTABLE_SUCCESS ||
+         HashTable_Get(ht, &key, &val) != HASHTABLE_ERROR_NO_SUCH_KEY) {
+          printf("%s: unable to delete handle 0\n", label);
+          exit(1);
+     }
+     key.pdata = &lookup[1];
+     if (HashTable_Get(ht, &key, &val) != HASHTABLE_SUCCESS ||
+         val.pdata != &values[1]) {
+          printf("%s: handle 1 lost with handle 0\n", label);
+          exit(1);
+     }
+
+     HashTable_Destroy(ht, test_free);
+     printf("%s: ok\n", label);
+}
+
+int main(int argc, char *argv[])
+{
+     int i, j;
+
+     SetDefaultLogging("TEST");
+
+     for (i = 0; i < 2; i++) {
+          for (j = 0; j < TEST_HANDLE_LEN; j++)
+               handles[i][j] = (char) (j * 13);
+          handles[i][TEST_HANDLE_LEN - 1] = (char) i;
+     }
+     memcpy(copies, handles, sizeof(handles));
+
+     test_run("own hashes", FALSE);
+     test_run("same hash", TRUE);
+
+     return 0;
+}
@@ -0,0 +1,319 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_dirtree_bench.c
+ * @brief  Dirent tree of a very large directory
+ *
+ * A directory of the given number of names (a million by default) is
+ * filled through cache_inode_dirtree_insert, then every name is looked
+ * up, the whole directory is read in one pass, then again in chunks
+ * of a hundred resumed from the last cookie, as NFS clients do.  Half
+ * the names are then removed and the directory read again, deleted
+ * cookies included.  The same is done against an AVL tree of dirents
+ * ordered by cookie, as directories were cached before the B+-tree,
+ * for comparison.  Every step checks what it finds.
+ *
+ * Usage: test_dirtree_bench [names]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/time.h>
+#include "log.h"
+#include "cache_inode.h"
+#include "cache_inode_dirtree.h"
+#include "avltree.h"
+#include "murmur3.h"
+
+#define BENCH_CHUNK 100
+
+static unsigned int nb_names = 1000000;
+static struct timeval start;
+
+static void
+bench_name(fsal_name_t *name, unsigned int i)
+{
+     memset(name, 0, sizeof(fsal_name_t));
+     name->len = snprintf(name->name, FSAL_MAX_NAME_LEN, "file.%08u", i);
+}
+
+static void
+bench_start(void)
+{
+     gettimeofday(&start, NULL);
+}
+
+static void
+bench_stop(const char *label, unsigned int count)
+{
+     struct timeval end;
+     double secs;
+
+     gettimeofday(&end, NULL);
+     secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+     printf("%-28s %8u in %.3f s, %.0f ns each\n", label, count, secs,
+            count ? secs * 1e9 / count : 0.0);
+}
+
+static void
+bench_fail(const char *what, unsigned int i)
+{
+     printf("%s failed at %u\n", what, i);
+     exit(1);
+}
+
+/* The dirent tree */
+
+static void
+bench_dirtree(void)
+{
+     cache_entry_t *dir;
+     cache_inode_dir_entry_t *v, *dirent;
+     cache_inode_dir_cursor_t cursor;
+     fsal_name_t name;
+     unsigned int i, n;
+     uint64_t last;
+
+     dir = gsh_calloc(1, sizeof(cache_entry_t));
+     dir->type = DIRECTORY;
+     dir->object.dir.tree = gsh_calloc(1, sizeof(cache_inode_dir_tree_t));
+     cache_inode_dirtree_init(dir);
+
+     bench_start();
+     for (i = 0; i < nb_names; i++) {
+          v = pool_alloc(cache_inode_dir_entry_pool, NULL);
+          bench_name(&v->name, i);
+          v->flags = DIR_ENTRY_FLAG_NONE;
+          v->entry.ptr = (void *) (uintptr_t) (i + 1);
+          v->entry.gen = 1;
+          if (cache_inode_dirtree_insert(dir, v, &dirent) != 0)
+               bench_fail("dirtree insert", i);
+     }
+     bench_stop("dirtree insert", nb_names);
+
+     bench_start();
+     for (i = 0; i < nb_names; i++) {
+          bench_name(&name, i);
+          dirent = cache_inode_dirtree_lookup_name(dir, &name);
+          if (dirent == NULL ||
+              dirent->entry.ptr != (void *) (uintptr_t) (i + 1))
+               bench_fail("dirtree lookup", i);
+     }
+     bench_stop("dirtree lookup", nb_names);
+
+     bench_start();
+     n = 0;
+     last = 0;
+     for (dirent = cache_inode_dirtree_first(dir, &cursor); dirent != NULL;
+          dirent = cache_inode_dirtree_next(dir, &cursor)) {
+          if (dirent->hk.k <= last)
+               bench_fail("dirtree readdir order", n);
+          last = dirent->hk.k;
+          n++;
+     }
+     if (n != nb_names)
+          bench_fail("dirtree readdir count", n);
+     bench_stop("dirtree readdir", n);
+
+     bench_start();
+     n = 0;
+     dirent = cache_inode_dirtree_first(dir, &cursor);
+     while (dirent != NULL) {
+          for (i = 0; dirent != NULL && i < BENCH_CHUNK; i++) {
+               last = dirent->hk.k;
+               dirent = cache_inode_dirtree_next(dir, &cursor);
+               n++;
+          }
+          if (dirent != NULL)
+               dirent = cache_inode_dirtree_seek(dir, last,
+                                                 CACHE_INODE_FLAG_NEXT_ACTIVE,
+                                                 &cursor);
+     }
+     if (n != nb_names)
+          bench_fail("dirtree resumed readdir count", n);
+     bench_stop("dirtree resumed readdir", n);
+
+     bench_start();
+     for (i = 0; i < nb_names; i += 2) {
+          bench_name(&name, i);
+          dirent = cache_inode_dirtree_lookup_name(dir, &name);
+          if (dirent == NULL)
+               bench_fail("dirtree remove", i);
+          cache_inode_dirtree_set_deleted(dir, dirent);
+     }
+     bench_stop("dirtree remove", (nb_names + 1) / 2);
+
+     bench_start();
+     n = 0;
+     for (dirent = cache_inode_dirtree_first(dir, &cursor); dirent != NULL;
+          dirent = cache_inode_dirtree_next(dir, &cursor))
+          n++;
+     if (n != nb_names / 2)
+          bench_fail("dirtree readdir after remove", n);
+     bench_stop("dirtree readdir after remove", n);
+
+     cache_inode_dirtree_release(dir);
+     gsh_free(dir->object.dir.tree);
+     gsh_free(dir);
+}
+
+/* The AVL tree it replaced */
+
+struct bench_avl_dirent
+{
+     struct avltree_node node_hk;
+     uint64_t k;
+     fsal_name_t name;
+};
+
+static int
+bench_avl_cmpf(const struct avltree_node *lhs,
+               const struct avltree_node *rhs)
+{
+     struct bench_avl_dirent *lk, *rk;
+
+     lk = avltree_container_of(lhs, struct bench_avl_dirent, node_hk);
+     rk = avltree_container_of(rhs, struct bench_avl_dirent, node_hk);
+
+     if (lk->k < rk->k)
+          return -1;
+     if (lk->k == rk->k)
+          return 0;
+     return 1;
+}
+
+static uint64_t
+bench_avl_hash(fsal_name_t *name)
+{
+     uint32_t hk[4];
+     uint64_t k;
+
+     MurmurHash3_x64_128(name->name, name->len, 67, hk);
+     memcpy(&k, hk, 8);
+     return k;
+}
+
+static struct bench_avl_dirent *
+bench_avl_lookup(struct avltree *t, fsal_name_t *name)
+{
+     struct bench_avl_dirent key;
+     struct avltree_node *node;
+
+     key.k = bench_avl_hash(name);
+     node = avltree_lookup(&key.node_hk, t);
+     return node ? avltree_container_of(node, struct bench_avl_dirent,
+                                        node_hk)
+                 : NULL;
+}
+
+static void
+bench_avl(void)
+{
+     struct avltree t;
+     struct bench_avl_dirent *v, key;
+     struct avltree_node *node;
+     fsal_name_t name;
+     unsigned int i, n;
+
+     avltree_init(&t, bench_avl_cmpf, 0);
+
+     bench_start();
+     for (i = 0; i < nb_names; i++) {
+          v = gsh_calloc(1, sizeof(struct bench_avl_dirent));
+          bench_name(&v->name, i);
+          v->k = bench_avl_hash(&v->name);
+          if (avltree_insert(&v->node_hk, &t) != NULL)
+               bench_fail("avl insert", i);
+     }
+     bench_stop("avl insert", nb_names);
+
+     bench_start();
+     for (i = 0; i < nb_names; i++) {
+          bench_name(&name, i);
+          v = bench_avl_lookup(&t, &name);
+          if (v == NULL || FSAL_namecmp(&name, &v->name))
+               bench_fail("avl lookup", i);
+     }
+     bench_stop("avl lookup", nb_names);
+
+     bench_start();
+     n = 0;
+     for (node = avltree_first(&t); node != NULL; node = avltree_next(node))
+          n++;
+     if (n != nb_names)
+          bench_fail("avl readdir count", n);
+     bench_stop("avl readdir", n);
+
+     bench_start();
+     n = 0;
+     node = avltree_first(&t);
+     while (node != NULL) {
+          for (i = 0; node != NULL && i < BENCH_CHUNK; i++) {
+               key.k = avltree_container_of(node, struct bench_avl_dirent,
+                                            node_hk)->k;
+               node = avltree_next(node);
+               n++;
+          }
+          if (node != NULL)
+               node = avltree_next(avltree_lookup(&key.node_hk, &t));
+     }
+     if (n != nb_names)
+          bench_fail("avl resumed readdir count", n);
+     bench_stop("avl resumed readdir", n);
+
+     node = avltree_first(&t);
+     while (node != NULL) {
+          v = avltree_container_of(node, struct bench_avl_dirent, node_hk);
+          node = avltree_next(node);
+          avltree_remove(&v->node_hk, &t);
+          gsh_free(v);
+     }
+}
+
+int main(int argc, char *argv[])
+{
+     if (argc > 1)
+          nb_names = atoi(argv[1]);
+     if (nb_names == 0) {
+          printf("Usage: %s [names]\n", argv[0]);
+          return 1;
+     }
+
+     SetDefaultLogging("TEST");
+
+     cache_inode_dir_entry_pool = pool_init("Directory entry pool",
+                                            sizeof(cache_inode_dir_entry_t),
+                                            pool_basic_substrate,
+                                            NULL, NULL, NULL);
+     if (cache_inode_dir_entry_pool == NULL) {
+          printf("Can't init Directory entry pool\n");
+          return 1;
+     }
+
+     bench_dirtree();
+     bench_avl();
+
+     return 0;
+}
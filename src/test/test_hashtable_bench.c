@@ -0,0 +1,223 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_hashtable_bench.c
+ * @brief  Compare the red-black tree and open addressing hash tables
+ *
+ * Every thread runs a mix of lookups (HashTable_Get), latched lookups
+ * (HashTable_GetRef, as the cache inode does), inserts and deletes
+ * over a fixed key space, half of which is loaded beforehand.  The
+ * same run is made against a table of each kind, for 1, 2, 4 ... up
+ * to the given number of threads.  Every lookup checks that the value
+ * found belongs to its key.
+ *
+ * Usage: test_hashtable_bench [max threads] [operations per thread]
+ *                             [write percentage]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "HashTable.h"
+
+#define BENCH_KEYS (1 << 20)
+#define BENCH_PARTITIONS 37
+
+static uint64_t keys[BENCH_KEYS];
+static unsigned int nb_ops = 1000000;
+static unsigned int write_pct = 10;
+static unsigned long errors;
+
+static int
+bench_hash_both(hash_parameter_t *param, hash_buffer_t *key,
+                uint32_t *index, uint64_t *rbt_hash)
+{
+     uint64_t h = *(uint64_t *) key->pdata;
+
+     /* Same kind of mixing as the hashes of the server's tables */
+     h ^= h >> 33;
+     h *= 0xff51afd7ed558ccdULL;
+     h ^= h >> 33;
+
+     *index = h % param->index_size;
+     *rbt_hash = h;
+
+     return 1;
+}
+
+static int
+bench_compare(hash_buffer_t *key1, hash_buffer_t *key2)
+{
+     return *(uint64_t *) key1->pdata != *(uint64_t *) key2->pdata;
+}
+
+static int
+bench_display(hash_buffer_t *buff, char *str)
+{
+     return sprintf(str, "%llu",
+                    (unsigned long long) *(uint64_t *) buff->pdata);
+}
+
+static int
+bench_free(hash_buffer_t key, hash_buffer_t val)
+{
+     return 1;
+}
+
+static void
+bench_get_ref(hash_buffer_t *val)
+{
+}
+
+static void *
+bench_worker(void *arg)
+{
+     hash_table_t *ht = arg;
+     hash_buffer_t key, val;
+     unsigned int seed = (unsigned int) (uintptr_t) pthread_self();
+     unsigned int i, k, op;
+     hash_error_t rc;
+
+     for (i = 0; i < nb_ops; i++) {
+          k = rand_r(&seed) % BENCH_KEYS;
+          op = rand_r(&seed) % 100;
+          key.pdata = &keys[k];
+          key.len = sizeof(uint64_t);
+
+          if (op < write_pct / 2) {
+               val = key;
+               (void) HashTable_Test_And_Set(
+                    ht, &key, &val, HASHTABLE_SET_HOW_SET_NO_OVERWRITE);
+          } else if (op < write_pct) {
+               (void) HashTable_Del(ht, &key, NULL, NULL);
+          } else {
+               if (op % 2)
+                    rc = HashTable_Get(ht, &key, &val);
+               else
+                    rc = HashTable_GetRef(ht, &key, &val, bench_get_ref);
+               if (rc == HASHTABLE_SUCCESS && val.pdata != &keys[k])
+                    __sync_fetch_and_add(&errors, 1);
+          }
+     }
+
+     return NULL;
+}
+
+static double
+bench_run(const char *label, uint32_t flags, unsigned int nb_threads)
+{
+     hash_parameter_t param;
+     hash_table_t *ht;
+     hash_buffer_t key, val;
+     pthread_t *threads;
+     struct timeval start, end;
+     unsigned int i;
+     double secs;
+
+     memset(&param, 0, sizeof(param));
+     param.flags = flags;
+     param.index_size = BENCH_PARTITIONS;
+     param.alphabet_length = 10;
+     param.hash_func_both = bench_hash_both;
+     param.compare_key = bench_compare;
+     param.key_to_str = bench_display;
+     param.val_to_str = bench_display;
+     param.ht_name = (char *) label;
+     param.ht_log_component = COMPONENT_HASHTABLE;
+
+     ht = HashTable_Init(&param);
+     threads = calloc(nb_threads, sizeof(pthread_t));
+     if (ht == NULL || threads == NULL) {
+          printf("Unable to create the %s table\n", label);
+          exit(1);
+     }
+
+     for (i = 0; i < BENCH_KEYS; i += 2) {
+          key.pdata = val.pdata = &keys[i];
+          key.len = val.len = sizeof(uint64_t);
+          if (HashTable_Set(ht, &key, &val) != HASHTABLE_SUCCESS) {
+               printf("Unable to load the %s table\n", label);
+               exit(1);
+          }
+     }
+
+     gettimeofday(&start, NULL);
+     for (i = 0; i < nb_threads; i++)
+          if (pthread_create(&threads[i], NULL, bench_worker, ht) != 0) {
+               printf("Unable to create thread %u\n", i);
+               exit(1);
+          }
+     for (i = 0; i < nb_threads; i++)
+          pthread_join(threads[i], NULL);
+     gettimeofday(&end, NULL);
+
+     secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+     printf("%-5s %2u threads: %.3f s, %.0f ops/s, %zu entries\n", label,
+            nb_threads, secs, (double) nb_threads * nb_ops / secs,
+            HashTable_GetSize(ht));
+
+     HashTable_Destroy(ht, bench_free);
+     free(threads);
+
+     return secs;
+}
+
+int main(int argc, char *argv[])
+{
+     unsigned int max_threads = 64;
+     unsigned int nb_threads, i;
+     double rbt, oa;
+
+     if (argc > 1)
+          max_threads = atoi(argv[1]);
+     if (argc > 2)
+          nb_ops = atoi(argv[2]);
+     if (argc > 3)
+          write_pct = atoi(argv[3]);
+     if (max_threads == 0 || nb_ops == 0 || write_pct > 100) {
+          printf("Usage: %s [max threads] [operations per thread] "
+                 "[write percentage]\n", argv[0]);
+          return 1;
+     }
+
+     for (i = 0; i < BENCH_KEYS; i++)
+          keys[i] = i;
+
+     for (nb_threads = 1; nb_threads <= max_threads; nb_threads *= 2) {
+          rbt = bench_run("rbt", HT_FLAG_NONE, nb_threads);
+          oa = bench_run("oa", HT_FLAG_OPEN_ADDR, nb_threads);
+          printf("oa/rbt speedup at %u threads: %.2f\n", nb_threads,
+                 rbt / oa);
+     }
+
+     if (errors != 0) {
+          printf("%lu lookups returned the value of another key\n",
+                 errors);
+          return 1;
+     }
+
+     return 0;
+}
@@ -0,0 +1,176 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_lru_ref_bench.c
+ * @brief  Reference storm on a single cache entry
+ *
+ * Every thread takes an initial reference on the same entry and
+ * releases it, as each GETATTR on a hot object (the export root...)
+ * does at least once.  The references are taken and released by
+ * cache_inode_lru_ref and cache_inode_lru_unref themselves, first
+ * with the entry mutex taken around each call, as they used to take
+ * it, then as they are.  Both are run for 1, 2, 4 ... up to the given
+ * number of threads, and the reference count is checked to be back
+ * to the sentinel afterwards.
+ *
+ * Usage: test_lru_ref_bench [max threads] [references per thread]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "log.h"
+#include "cache_inode.h"
+#include "cache_inode_lru.h"
+
+static cache_entry_t *entry;
+static unsigned int nb_ops = 1000000;
+static unsigned long dead;
+
+static void *
+bench_worker_locked(void *arg)
+{
+     unsigned int i;
+
+     for (i = 0; i < nb_ops; i++) {
+          pthread_mutex_lock(&entry->lru.mtx);
+          if (cache_inode_lru_ref(entry, LRU_REQ_INITIAL)
+              != CACHE_INODE_SUCCESS) {
+               pthread_mutex_unlock(&entry->lru.mtx);
+               __sync_fetch_and_add(&dead, 1);
+               continue;
+          }
+          pthread_mutex_unlock(&entry->lru.mtx);
+          pthread_mutex_lock(&entry->lru.mtx);
+          /* Unlocks the entry */
+          cache_inode_lru_unref(entry, LRU_FLAG_LOCKED);
+     }
+
+     return NULL;
+}
+
+static void *
+bench_worker_atomic(void *arg)
+{
+     unsigned int i;
+
+     for (i = 0; i < nb_ops; i++) {
+          if (cache_inode_lru_ref(entry, LRU_REQ_INITIAL)
+              != CACHE_INODE_SUCCESS) {
+               __sync_fetch_and_add(&dead, 1);
+               continue;
+          }
+          cache_inode_lru_unref(entry, LRU_FLAG_NONE);
+     }
+
+     return NULL;
+}
+
+static double
+bench_run(const char *label, void *(*worker)(void *),
+          unsigned int nb_threads)
+{
+     pthread_t *threads;
+     struct timeval start, end;
+     unsigned int i;
+     double secs;
+
+     threads = calloc(nb_threads, sizeof(pthread_t));
+     if (threads == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+
+     /* The sentinel reference keeps the entry from ever being freed */
+     memset(entry, 0, sizeof(*entry));
+     pthread_mutex_init(&entry->lru.mtx, NULL);
+     entry->lru.refcount = LRU_SENTINEL_REFCOUNT;
+
+     gettimeofday(&start, NULL);
+     for (i = 0; i < nb_threads; i++)
+          if (pthread_create(&threads[i], NULL, worker, NULL) != 0) {
+               printf("Unable to create thread %u\n", i);
+               exit(1);
+          }
+     for (i = 0; i < nb_threads; i++)
+          pthread_join(threads[i], NULL);
+     gettimeofday(&end, NULL);
+
+     secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+     printf("%-6s %2u threads: %.3f s, %.0f refs/s\n", label,
+            nb_threads, secs, (double) nb_threads * nb_ops / secs);
+
+     if (entry->lru.refcount != LRU_SENTINEL_REFCOUNT) {
+          printf("%s: reference count %lld, expected %d\n", label,
+                 (long long) entry->lru.refcount, LRU_SENTINEL_REFCOUNT);
+          exit(1);
+     }
+
+     pthread_mutex_destroy(&entry->lru.mtx);
+     free(threads);
+
+     return secs;
+}
+
+int main(int argc, char *argv[])
+{
+     unsigned int max_threads = 64;
+     unsigned int nb_threads;
+     double locked, atomic;
+
+     if (argc > 1)
+          max_threads = atoi(argv[1]);
+     if (argc > 2)
+          nb_ops = atoi(argv[2]);
+     if (max_threads == 0 || nb_ops == 0) {
+          printf("Usage: %s [max threads] [references per thread]\n",
+                 argv[0]);
+          return 1;
+     }
+
+     SetDefaultLogging("TEST");
+
+     entry = malloc(sizeof(cache_entry_t));
+     if (entry == NULL) {
+          printf("Out of memory\n");
+          return 1;
+     }
+
+     for (nb_threads = 1; nb_threads <= max_threads; nb_threads *= 2) {
+          locked = bench_run("mutex", bench_worker_locked, nb_threads);
+          atomic = bench_run("atomic", bench_worker_atomic, nb_threads);
+          printf("atomic/mutex speedup at %u threads: %.2f\n",
+                 nb_threads, locked / atomic);
+     }
+
+     if (dead != 0) {
+          printf("%lu references refused on a live entry\n", dead);
+          return 1;
+     }
+
+     free(entry);
+     return 0;
+}
@@ -0,0 +1,330 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_lru_sim.c
+ * @brief  Trace driven simulator of the cache inode replacement
+ *
+ * Replays a trace of object accesses against a cache of the given
+ * size, once with plain LRU and once with the adaptive replacement of
+ * Cache_inode/cache_inode_lru.c: new objects enter L1, a use sets a
+ * bit, the cold end of L1 (while above its target size) or of L2 is
+ * swept, referenced objects move to L2 and the others are evicted
+ * and remembered in the same ghost table as the server's.  The hit
+ * rate, evictions and final target size of L1 are printed, to tune
+ * the cache size against a real workload.
+ *
+ * A trace has one object per line, any string identifying it (a
+ * handle in hex, a path...).  Without a trace, a workload is made up:
+ * random accesses to a working set of half the cache, interrupted by
+ * scans of twice the cache size of objects never seen again.
+ *
+ * Usage: test_lru_sim <cache size> [trace file]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include "nlm_list.h"
+#include "cache_inode_lru_ghost.h"
+
+#define SIM_BUCKETS (1 << 20)
+
+/* Length of a scan, and accesses between scans, of the made up
+   workload */
+#define SIM_SCAN_FACTOR 2
+#define SIM_ACCESSES 2000000
+#define SIM_SCAN_EVERY 200000
+
+struct sim_entry
+{
+     struct glist_head q; /*< Link in L1 or L2 */
+     struct sim_entry *next; /*< Link in the hash bucket */
+     uint64_t key;
+     int referenced;
+     uint32_t queue; /*< LRU_GHOST_L1 or LRU_GHOST_L2 */
+};
+
+struct sim_cache
+{
+     const char *name;
+     int adaptive;
+     uint64_t capacity;
+     uint64_t count;
+     struct glist_head l1; /*< Cold end at the head, as in the server */
+     struct glist_head l2;
+     uint64_t size[3];
+     uint64_t target;
+     lru_ghost_t *ghost;
+     struct sim_entry *buckets[SIM_BUCKETS];
+     uint64_t hits;
+     uint64_t misses;
+     uint64_t evictions[3];
+     uint64_t ghost_hits[3];
+};
+
+static uint64_t
+sim_hash(const char *str, size_t len)
+{
+     uint64_t h = 14695981039346656037ULL;
+     size_t i;
+
+     /* FNV-1a */
+     for (i = 0; i < len; i++) {
+          h ^= (unsigned char) str[i];
+          h *= 1099511628211ULL;
+     }
+
+     /* 0 means no hash to the ghost table */
+     return h ? h : 1;
+}
+
+static struct sim_entry **
+sim_bucket(struct sim_cache *cache, uint64_t key)
+{
+     return &cache->buckets[(key ^ (key >> 32)) % SIM_BUCKETS];
+}
+
+static struct glist_head *
+sim_queue(struct sim_cache *cache, uint32_t queue)
+{
+     return (queue == LRU_GHOST_L2) ? &cache->l2 : &cache->l1;
+}
+
+static void
+sim_move(struct sim_cache *cache, struct sim_entry *entry, uint32_t queue)
+{
+     glist_del(&entry->q);
+     cache->size[entry->queue]--;
+     glist_add_tail(sim_queue(cache, queue), &entry->q);
+     cache->size[queue]++;
+     entry->queue = queue;
+}
+
+static void
+sim_evict(struct sim_cache *cache, struct sim_entry *entry)
+{
+     struct sim_entry **prev = sim_bucket(cache, entry->key);
+
+     while (*prev != entry)
+          prev = &(*prev)->next;
+     *prev = entry->next;
+
+     glist_del(&entry->q);
+     cache->size[entry->queue]--;
+     cache->count--;
+     cache->evictions[entry->queue]++;
+     if (cache->ghost)
+          lru_ghost_add(cache->ghost, entry->key, entry->queue);
+     free(entry);
+}
+
+/* Sweep the cold end of a queue as lru_try_reap_entry does */
+static int
+sim_sweep(struct sim_cache *cache, uint32_t queue)
+{
+     struct glist_head *q = sim_queue(cache, queue);
+     struct sim_entry *entry;
+     uint64_t n = cache->size[queue];
+
+     while (n-- > 0) {
+          entry = glist_first_entry(q, struct sim_entry, q);
+          if (!entry->referenced) {
+               sim_evict(cache, entry);
+               return 1;
+          }
+          entry->referenced = 0;
+          sim_move(cache, entry, LRU_GHOST_L2);
+     }
+
+     return 0;
+}
+
+static void
+sim_reclaim(struct sim_cache *cache)
+{
+     uint32_t queue = LRU_GHOST_L1;
+
+     if (!cache->adaptive) {
+          sim_evict(cache, glist_first_entry(&cache->l1, struct sim_entry,
+                                             q));
+          return;
+     }
+
+     if (!lru_ghost_evict_l1(cache->size[LRU_GHOST_L1],
+                             cache->size[LRU_GHOST_L2], cache->target))
+          queue = LRU_GHOST_L2;
+
+     if (!sim_sweep(cache, queue))
+          (void) sim_sweep(cache, queue == LRU_GHOST_L1 ?
+                           LRU_GHOST_L2 : LRU_GHOST_L1);
+}
+
+static void
+sim_access(struct sim_cache *cache, uint64_t key)
+{
+     struct sim_entry *entry;
+     uint32_t from = LRU_GHOST_NONE;
+
+     for (entry = *sim_bucket(cache, key); entry; entry = entry->next)
+          if (entry->key == key)
+               break;
+
+     if (entry) {
+          cache->hits++;
+          if (cache->adaptive)
+               entry->referenced = 1;
+          else
+               sim_move(cache, entry, LRU_GHOST_L1);
+          return;
+     }
+
+     cache->misses++;
+     if (cache->count >= cache->capacity)
+          sim_reclaim(cache);
+
+     entry = calloc(1, sizeof(struct sim_entry));
+     if (entry == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+     entry->key = key;
+     entry->next = *sim_bucket(cache, key);
+     *sim_bucket(cache, key) = entry;
+     cache->count++;
+
+     /* As cache_inode_lru_admit */
+     if (cache->adaptive)
+          from = lru_ghost_take(cache->ghost, key);
+     if (from != LRU_GHOST_NONE) {
+          cache->ghost_hits[from]++;
+          cache->target = lru_ghost_adapt(cache->ghost, from,
+                                          cache->target,
+                                          cache->capacity);
+     }
+     entry->queue = (from == LRU_GHOST_NONE) ? LRU_GHOST_L1 : LRU_GHOST_L2;
+     glist_add_tail(sim_queue(cache, entry->queue), &entry->q);
+     cache->size[entry->queue]++;
+}
+
+static struct sim_cache *
+sim_create(const char *name, int adaptive, uint64_t capacity)
+{
+     struct sim_cache *cache = calloc(1, sizeof(struct sim_cache));
+
+     if (cache == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+     cache->name = name;
+     cache->adaptive = adaptive;
+     cache->capacity = capacity;
+     init_glist(&cache->l1);
+     init_glist(&cache->l2);
+     if (adaptive) {
+          cache->ghost = lru_ghost_create(capacity);
+          if (cache->ghost == NULL) {
+               printf("Out of memory\n");
+               exit(1);
+          }
+     }
+
+     return cache;
+}
+
+static void
+sim_report(struct sim_cache *cache)
+{
+     printf("%-8s hits %"PRIu64" misses %"PRIu64" hit rate %.2f%%\n",
+            cache->name, cache->hits, cache->misses,
+            100.0 * cache->hits / (cache->hits + cache->misses));
+     if (cache->adaptive)
+          printf("%-8s evictions L1 %"PRIu64" L2 %"PRIu64
+                 ", ghost hits L1 %"PRIu64" L2 %"PRIu64
+                 ", L1 %"PRIu64" L2 %"PRIu64" target %"PRIu64"\n",
+                 "", cache->evictions[LRU_GHOST_L1],
+                 cache->evictions[LRU_GHOST_L2],
+                 cache->ghost_hits[LRU_GHOST_L1],
+                 cache->ghost_hits[LRU_GHOST_L2],
+                 cache->size[LRU_GHOST_L1], cache->size[LRU_GHOST_L2],
+                 cache->target);
+}
+
+int main(int argc, char *argv[])
+{
+     struct sim_cache *lru, *adaptive;
+     uint64_t capacity, key, next_scan = 0, i, j;
+     unsigned int seed = 1;
+     char line[4096];
+     size_t len;
+     FILE *trace;
+
+     if (argc < 2 || (capacity = strtoull(argv[1], NULL, 10)) == 0) {
+          printf("Usage: %s <cache size> [trace file]\n", argv[0]);
+          return 1;
+     }
+
+     lru = sim_create("lru", 0, capacity);
+     adaptive = sim_create("adaptive", 1, capacity);
+
+     if (argc > 2) {
+          trace = fopen(argv[2], "r");
+          if (trace == NULL) {
+               printf("Unable to open %s\n", argv[2]);
+               return 1;
+          }
+          while (fgets(line, sizeof(line), trace) != NULL) {
+               len = strcspn(line, "\r\n");
+               if (len == 0)
+                    continue;
+               key = sim_hash(line, len);
+               sim_access(lru, key);
+               sim_access(adaptive, key);
+          }
+          fclose(trace);
+     } else {
+          for (i = 0; i < SIM_ACCESSES; i++) {
+               if (i % SIM_SCAN_EVERY == SIM_SCAN_EVERY - 1) {
+                    /* Objects of a scan are never seen again */
+                    for (j = 0; j < SIM_SCAN_FACTOR * capacity; j++) {
+                         key = sim_hash((char *) &next_scan,
+                                        sizeof(next_scan)) | 1;
+                         next_scan++;
+                         sim_access(lru, key);
+                         sim_access(adaptive, key);
+                    }
+               }
+               /* Even keys for the working set, odd ones for scans */
+               j = rand_r(&seed) % (capacity / 2 + 1);
+               key = (sim_hash((char *) &j, sizeof(j)) & ~1ULL) | 2;
+               sim_access(lru, key);
+               sim_access(adaptive, key);
+          }
+     }
+
+     sim_report(lru);
+     sim_report(adaptive);
+
+     return 0;
+}
@@ -0,0 +1,260 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_memfsal.c
+ * @brief  Smoke test of FSAL_MEM
+ *
+ * A file is created in the root of an in-memory export, written
+ * across a page boundary and read back, renamed, then unlinked, each
+ * step checking what the next lookup finds.  Another user is then
+ * refused a read-write open of a file they may only read.
+ *
+ * Usage: test_memfsal
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log.h"
+#include "fsal.h"
+
+#define TEST_UID   1000
+#define TEST_SIZE  10000
+
+static fsal_export_context_t export_context;
+static fsal_op_context_t root_context;
+static fsal_op_context_t user_context;
+static fsal_handle_t root_handle;
+
+#define CHECK(_what, _status)                                           \
+     do {                                                               \
+          fsal_status_t __st = (_status);                               \
+          if (FSAL_IS_ERROR(__st)) {                                    \
+               printf("%s failed: %s (%d)\n", _what,                    \
+                      label_fsal_err(__st.major), __st.minor);          \
+               exit(1);                                                 \
+          }                                                             \
+     } while (0)
+
+#define EXPECT(_what, _status, _major)                                  \
+     do {                                                               \
+          fsal_status_t __st = (_status);                               \
+          if (__st.major != (_major)) {                                 \
+               printf("%s: got %s, expected %s\n", _what,               \
+                      label_fsal_err(__st.major),                       \
+                      label_fsal_err(_major));                          \
+               exit(1);                                                 \
+          }                                                             \
+     } while (0)
+
+static void
+test_name(fsal_name_t *name, const char *str)
+{
+     CHECK("str2name", FSAL_str2name(str, FSAL_MAX_NAME_LEN, name));
+}
+
+static void
+test_init(void)
+{
+     fsal_parameter_t param;
+     fsal_path_t path;
+
+     memset(&param, 0, sizeof(param));
+     FSAL_LoadFunctions();
+     FSAL_LoadConsts();
+     CHECK("FSAL defaults", FSAL_SetDefault_FSAL_parameter(&param));
+     CHECK("FS common defaults", FSAL_SetDefault_FS_common_parameter(&param));
+     CHECK("FS specific defaults",
+           FSAL_SetDefault_FS_specific_parameter(&param));
+     CHECK("FSAL_Init", FSAL_Init(&param));
+
+     CHECK("str2path", FSAL_str2path("/", FSAL_MAX_PATH_LEN, &path));
+     CHECK("BuildExportContext",
+           FSAL_BuildExportContext(&export_context, &path, NULL));
+
+     CHECK("InitClientContext", FSAL_InitClientContext(&root_context));
+     CHECK("GetClientContext",
+           FSAL_GetClientContext(&root_context, &export_context, 0, 0,
+                                 NULL, 0));
+     CHECK("InitClientContext", FSAL_InitClientContext(&user_context));
+     CHECK("GetClientContext",
+           FSAL_GetClientContext(&user_context, &export_context,
+                                 TEST_UID, TEST_UID, NULL, 0));
+
+     CHECK("lookup root",
+           FSAL_lookup(NULL, NULL, &root_context, &root_handle, NULL));
+}
+
+static void
+test_file(void)
+{
+     fsal_name_t name, new_name;
+     fsal_handle_t handle, found;
+     fsal_attrib_list_t attrs;
+     fsal_file_t file;
+     fsal_seek_t seek;
+     fsal_size_t amount;
+     fsal_boolean_t eof;
+     fsal_status_t status;
+     char *wbuf, *rbuf;
+     unsigned int i;
+
+     wbuf = malloc(TEST_SIZE);
+     rbuf = malloc(TEST_SIZE);
+     if (wbuf == NULL || rbuf == NULL) {
+          printf("Out of memory\n");
+          exit(1);
+     }
+     for (i = 0; i < TEST_SIZE; i++)
+          wbuf[i] = (char)(i * 7);
+
+     test_name(&name, "file");
+     test_name(&new_name, "renamed");
+
+     memset(&attrs, 0, sizeof(attrs));
+     attrs.asked_attributes = FSAL_ATTRS_POSIX;
+     CHECK("create",
+           FSAL_create(&root_handle, &name, &root_context,
+                       FSAL_MODE_RUSR | FSAL_MODE_WUSR, &handle, &attrs));
+     if (attrs.filesize != 0) {
+          printf("New file has size %llu\n",
+                 (unsigned long long)attrs.filesize);
+          exit(1);
+     }
+     EXPECT("create again",
+            FSAL_create(&root_handle, &name, &root_context,
+                        FSAL_MODE_RUSR | FSAL_MODE_WUSR, &found, NULL),
+            ERR_FSAL_EXIST);
+
+     /* Write across a page boundary, then read it back */
+     CHECK("open for write",
+           FSAL_open(&handle, &root_context, FSAL_O_RDWR, &file, NULL));
+     seek.whence = FSAL_SEEK_SET;
+     seek.offset = 100;
+     CHECK("write",
+           FSAL_write(&file, &root_context, &seek, TEST_SIZE, wbuf,
+                      &amount));
+     if (amount != TEST_SIZE) {
+          printf("Wrote %llu bytes of %u\n", (unsigned long long)amount,
+                 TEST_SIZE);
+          exit(1);
+     }
+     CHECK("close", FSAL_close(&file));
+
+     CHECK("open for read",
+           FSAL_open(&handle, &root_context, FSAL_O_RDONLY, &file, NULL));
+     seek.offset = 100;
+     eof = FALSE;
+     CHECK("read",
+           FSAL_read(&file, &seek, TEST_SIZE, rbuf, &amount, &eof));
+     if (amount != TEST_SIZE || !eof || memcmp(wbuf, rbuf, TEST_SIZE)) {
+          printf("Read %llu bytes, eof %d, not what was written\n",
+                 (unsigned long long)amount, eof);
+          exit(1);
+     }
+     /* The hole before the data reads as zeroes */
+     seek.offset = 0;
+     CHECK("read hole", FSAL_read(&file, &seek, 100, rbuf, &amount, &eof));
+     for (i = 0; i < 100; i++)
+          if (rbuf[i] != 0) {
+               printf("Hole byte %u is %d\n", i, rbuf[i]);
+               exit(1);
+          }
+     CHECK("close", FSAL_close(&file));
+
+     memset(&attrs, 0, sizeof(attrs));
+     attrs.asked_attributes = FSAL_ATTRS_POSIX;
+     CHECK("getattrs", FSAL_getattrs(&handle, &root_context, &attrs));
+     if (attrs.filesize != 100 + TEST_SIZE) {
+          printf("File size %llu, expected %u\n",
+                 (unsigned long long)attrs.filesize, 100 + TEST_SIZE);
+          exit(1);
+     }
+
+     /* Rename: the old name is gone, the new one is the same file */
+     CHECK("rename",
+           FSAL_rename(&root_handle, &name, &root_handle, &new_name,
+                       &root_context, NULL, NULL));
+     EXPECT("lookup old name",
+            FSAL_lookup(&root_handle, &name, &root_context, &found, NULL),
+            ERR_FSAL_NOENT);
+     CHECK("lookup new name",
+           FSAL_lookup(&root_handle, &new_name, &root_context, &found,
+                       NULL));
+     if (FSAL_handlecmp(&handle, &found, &status) != 0) {
+          printf("Renamed file has another handle\n");
+          exit(1);
+     }
+
+     /* Unlink: the name is gone */
+     CHECK("unlink",
+           FSAL_unlink(&root_handle, &new_name, &root_context, NULL));
+     EXPECT("lookup unlinked",
+            FSAL_lookup(&root_handle, &new_name, &root_context, &found,
+                        NULL),
+            ERR_FSAL_NOENT);
+     EXPECT("unlink again",
+            FSAL_unlink(&root_handle, &new_name, &root_context, NULL),
+            ERR_FSAL_NOENT);
+
+     free(wbuf);
+     free(rbuf);
+     printf("create, write, read, rename, unlink: ok\n");
+}
+
+static void
+test_open_access(void)
+{
+     fsal_name_t name;
+     fsal_handle_t handle;
+     fsal_file_t file;
+
+     test_name(&name, "readonly");
+     CHECK("create",
+           FSAL_create(&root_handle, &name, &root_context,
+                       FSAL_MODE_RUSR | FSAL_MODE_WUSR | FSAL_MODE_RGRP |
+                       FSAL_MODE_ROTH, &handle, NULL));
+
+     /* Another user may read it, not write it */
+     CHECK("open read-only by another user",
+           FSAL_open(&handle, &user_context, FSAL_O_RDONLY, &file, NULL));
+     CHECK("close", FSAL_close(&file));
+     EXPECT("open read-write by another user",
+            FSAL_open(&handle, &user_context, FSAL_O_RDWR, &file, NULL),
+            ERR_FSAL_ACCESS);
+     EXPECT("open write-only by another user",
+            FSAL_open(&handle, &user_context, FSAL_O_WRONLY, &file, NULL),
+            ERR_FSAL_ACCESS);
+
+     CHECK("unlink", FSAL_unlink(&root_handle, &name, &root_context, NULL));
+     printf("open access: ok\n");
+}
+
+int main(int argc, char *argv[])
+{
+     SetDefaultLogging("TEST");
+
+     test_init();
+     test_file();
+     test_open_access();
+
+     return 0;
+}
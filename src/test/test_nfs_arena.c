@@ -0,0 +1,192 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_nfs_arena.c
+ * @brief  Per-request arenas, allocated, freed and reused
+ *
+ * An arena is filled with allocations of every size from nothing to
+ * past a chunk, each aligned as by malloc and stamped with a pattern
+ * checked once they are all made, so that no two overlap.  Freeing
+ * the arena ends the request; the next request on the thread gets
+ * the same chunk back, not zeroed, while nfs_arena_calloc still hands
+ * out zeroes from it.  Threads then run many requests each at once,
+ * checking that no arena hands out memory another one is using.
+ *
+ * Usage: test_nfs_arena
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "log.h"
+#include "nfs_arena.h"
+
+#define TEST_ALLOCS    300
+#define TEST_THREADS   8
+#define TEST_REQUESTS  20000
+
+struct test_alloc
+{
+     unsigned char *ptr;
+     size_t size;
+};
+
+static size_t
+test_size(unsigned int i)
+{
+     /* From nothing to past a chunk, small sizes most often */
+     if (i % 50 == 49)
+          return NFS_ARENA_CHUNK_SIZE + i;
+     return (i * 37) % 700;
+}
+
+static void
+test_fill(nfs_arena_t *arena, struct test_alloc *allocs, unsigned int n,
+          unsigned char tag, const char *label)
+{
+     unsigned int i;
+
+     for (i = 0; i < n; i++) {
+          allocs[i].size = test_size(i);
+          allocs[i].ptr = nfs_arena_alloc(arena, allocs[i].size);
+          if (allocs[i].ptr == NULL) {
+               printf("%s: allocation %u of %zu bytes failed\n", label,
+                      i, allocs[i].size);
+               exit(1);
+          }
+          if (((uintptr_t) allocs[i].ptr & 15) != 0) {
+               printf("%s: allocation %u is misaligned\n", label, i);
+               exit(1);
+          }
+          memset(allocs[i].ptr, (unsigned char) (tag + i),
+                 allocs[i].size);
+     }
+}
+
+static void
+test_check(struct test_alloc *allocs, unsigned int n, unsigned char tag,
+           const char *label)
+{
+     unsigned int i;
+     size_t j;
+
+     for (i = 0; i < n; i++)
+          for (j = 0; j < allocs[i].size; j++)
+               if (allocs[i].ptr[j] != (unsigned char) (tag + i)) {
+                    printf("%s: allocation %u overwritten at %zu\n",
+                           label, i, j);
+                    exit(1);
+               }
+}
+
+static void
+test_lifetimes(void)
+{
+     struct test_alloc allocs[TEST_ALLOCS];
+     nfs_arena_t *arena, *again;
+     unsigned char *first, *zeroes;
+     unsigned int i;
+
+     arena = nfs_arena_new();
+     if (arena == NULL) {
+          printf("Unable to create an arena\n");
+          exit(1);
+     }
+     test_fill(arena, allocs, TEST_ALLOCS, 1, "allocation");
+     test_check(allocs, TEST_ALLOCS, 1, "allocation");
+     printf("allocation: ok\n");
+
+     /* The end of the request, the next one on the thread reuses the
+        first chunk as it was left */
+     first = allocs[1].ptr;
+     nfs_arena_free(arena);
+     again = nfs_arena_new();
+     if (again != arena) {
+          printf("reuse: the first chunk was not reused\n");
+          exit(1);
+     }
+     if (first[0] != (unsigned char) 2) {
+          printf("reuse: the chunk was zeroed\n");
+          exit(1);
+     }
+     zeroes = nfs_arena_calloc(again, 10, 100);
+     if (zeroes == NULL) {
+          printf("reuse: calloc failed\n");
+          exit(1);
+     }
+     for (i = 0; i < 1000; i++)
+          if (zeroes[i] != 0) {
+               printf("reuse: calloc byte %u is %d\n", i, zeroes[i]);
+               exit(1);
+          }
+     nfs_arena_free(again);
+     nfs_arena_free(NULL);
+     printf("reuse: ok\n");
+}
+
+static void *
+test_requests(void *arg)
+{
+     struct test_alloc allocs[TEST_ALLOCS / 10];
+     unsigned char tag = (unsigned char) (uintptr_t) arg * 31;
+     nfs_arena_t *arena;
+     unsigned int r;
+
+     for (r = 0; r < TEST_REQUESTS; r++) {
+          arena = nfs_arena_new();
+          if (arena == NULL) {
+               printf("Unable to create an arena\n");
+               exit(1);
+          }
+          test_fill(arena, allocs, TEST_ALLOCS / 10 - r % 7,
+                    tag + r, "requests");
+          test_check(allocs, TEST_ALLOCS / 10 - r % 7, tag + r,
+                     "requests");
+          nfs_arena_free(arena);
+     }
+
+     return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+     pthread_t threads[TEST_THREADS];
+     uintptr_t i;
+
+     SetDefaultLogging("TEST");
+     nfs_arena_pkginit();
+
+     test_lifetimes();
+
+     for (i = 0; i < TEST_THREADS; i++)
+          if (pthread_create(&threads[i], NULL, test_requests,
+                             (void *) i) != 0) {
+               printf("Unable to start a thread\n");
+               exit(1);
+          }
+     for (i = 0; i < TEST_THREADS; i++)
+          pthread_join(threads[i], NULL);
+     printf("concurrent requests: ok\n");
+
+     return 0;
+}
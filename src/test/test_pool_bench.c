@@ -0,0 +1,231 @@
+/*
+ * vim:expandtab:shiftwidth=8:tabstop=8:
+ *
+ * Copyright (C) 2012, The Linux Box Corporation
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 3 of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * -------------
+ */
+
+/**
+ * @file   test_pool_bench.c
+ * @brief  Compare the slab and basic pool substrates
+ *
+ * Every thread plays a worker: for each simulated request it
+ * allocates the objects a typical request creates (hash table nodes
+ * and data, a directory entry, now and then a cache entry) and keeps
+ * them in a working set where they replace older objects picked at
+ * random.  Each handoff_every request, the thread frees its oldest
+ * object through a shared mailbox instead, so that objects are also
+ * released by threads other than the one that allocated them.
+ *
+ * Usage: test_pool_bench [threads] [requests per thread]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include "abstract_mem.h"
+#include "slab_pool.h"
+
+#define BENCH_CLASSES 4
+#define BENCH_WORKING_SET 4096
+
+static struct bench_class
+{
+  const char *name;
+  size_t size;
+  unsigned int per_request; /*< Allocations per 8 requests */
+  pool_t *pool;
+} classes[BENCH_CLASSES] = {
+  {"rbt node", 48, 16, NULL},
+  {"hash data", 32, 16, NULL},
+  {"dir entry", 320, 8, NULL},
+  {"cache entry", 1024, 1, NULL}
+};
+
+static unsigned int nb_requests = 200000;
+static const unsigned int handoff_every = 8;
+
+/* Objects given away to be freed by the next thread that comes by */
+static pthread_mutex_t mailbox_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct
+{
+  void *obj;
+  unsigned int class;
+} mailbox[64];
+static unsigned int mailbox_count;
+
+static void
+mailbox_exchange(void *obj, unsigned int class)
+{
+  void *other = NULL;
+  unsigned int other_class = 0;
+
+  pthread_mutex_lock(&mailbox_mtx);
+  if(mailbox_count == sizeof(mailbox) / sizeof(mailbox[0]))
+    {
+      mailbox_count--;
+      other = mailbox[mailbox_count].obj;
+      other_class = mailbox[mailbox_count].class;
+    }
+  mailbox[mailbox_count].obj = obj;
+  mailbox[mailbox_count].class = class;
+  mailbox_count++;
+  pthread_mutex_unlock(&mailbox_mtx);
+
+  if(other != NULL)
+    pool_free(classes[other_class].pool, other);
+}
+
+static void *
+bench_worker(void *arg)
+{
+  struct
+  {
+    void *obj;
+    unsigned int class;
+  } *set;
+  unsigned int seed = (unsigned int) (uintptr_t) arg;
+  unsigned int r, c, k, slot, oldest = 0;
+
+  set = calloc(BENCH_WORKING_SET, sizeof(*set));
+  if(set == NULL)
+    return NULL;
+
+  for(r = 0; r < nb_requests; r++)
+    {
+      for(c = 0; c < BENCH_CLASSES; c++)
+        for(k = (classes[c].per_request * r) / 8;
+            k < (classes[c].per_request * (r + 1)) / 8; k++)
+          {
+            slot = rand_r(&seed) % BENCH_WORKING_SET;
+            if(set[slot].obj != NULL)
+              pool_free(classes[set[slot].class].pool, set[slot].obj);
+            set[slot].obj = pool_alloc(classes[c].pool, NULL);
+            set[slot].class = c;
+            /* Touch it, as a real user would */
+            memset(set[slot].obj, 0xa5, 16);
+          }
+
+      if(r % handoff_every == 0)
+        {
+          oldest = (oldest + 1) % BENCH_WORKING_SET;
+          if(set[oldest].obj != NULL)
+            {
+              mailbox_exchange(set[oldest].obj, set[oldest].class);
+              set[oldest].obj = NULL;
+            }
+        }
+    }
+
+  for(slot = 0; slot < BENCH_WORKING_SET; slot++)
+    if(set[slot].obj != NULL)
+      pool_free(classes[set[slot].class].pool, set[slot].obj);
+  free(set);
+
+  return NULL;
+}
+
+static double
+bench_run(const char *label,
+          const struct pool_substrate_vector *substrate,
+          unsigned int nb_threads)
+{
+  pthread_t *threads;
+  struct timeval start, end;
+  unsigned int i, c;
+  double secs;
+
+  threads = calloc(nb_threads, sizeof(pthread_t));
+  if(threads == NULL)
+    exit(1);
+
+  for(c = 0; c < BENCH_CLASSES; c++)
+    {
+      classes[c].pool = pool_init(classes[c].name, classes[c].size,
+                                  substrate, NULL, NULL, NULL);
+      if(classes[c].pool == NULL)
+        {
+          printf("Unable to create pool %s\n", classes[c].name);
+          exit(1);
+        }
+    }
+  mailbox_count = 0;
+
+  gettimeofday(&start, NULL);
+  for(i = 0; i < nb_threads; i++)
+    if(pthread_create(&threads[i], NULL, bench_worker,
+                      (void *) (uintptr_t) (i + 1)) != 0)
+      {
+        printf("Unable to create thread %u\n", i);
+        exit(1);
+      }
+  for(i = 0; i < nb_threads; i++)
+    pthread_join(threads[i], NULL);
+  gettimeofday(&end, NULL);
+
+  secs = (end.tv_sec - start.tv_sec) + (end.tv_usec - start.tv_usec) / 1e6;
+  printf("%-6s %u threads: %.3f s, %.0f requests/s\n", label, nb_threads,
+         secs, (double) nb_threads * nb_requests / secs);
+
+  for(i = 0; i < mailbox_count; i++)
+    pool_free(classes[mailbox[i].class].pool, mailbox[i].obj);
+
+  for(c = 0; c < BENCH_CLASSES; c++)
+    {
+      struct pool_slab_stats stats;
+
+      if(pool_slab_get_stats(classes[c].pool, &stats) == 0)
+        printf("       %-12s allocs %llu high water %llu live %llu "
+               "slabs %llu bytes %llu\n", classes[c].name,
+               (unsigned long long) stats.allocs,
+               (unsigned long long) stats.high_water,
+               (unsigned long long) stats.live,
+               (unsigned long long) stats.slabs,
+               (unsigned long long) stats.bytes);
+      pool_destroy(classes[c].pool);
+    }
+
+  free(threads);
+  return secs;
+}
+
+int main(int argc, char *argv[])
+{
+  unsigned int nb_threads = 16;
+  double basic, slab;
+
+  if(argc > 1)
+    nb_threads = atoi(argv[1]);
+  if(argc > 2)
+    nb_requests = atoi(argv[2]);
+  if(nb_threads == 0 || nb_requests == 0)
+    {
+      printf("Usage: %s [threads] [requests per thread]\n", argv[0]);
+      return 1;
+    }
+
+  basic = bench_run("basic", pool_basic_substrate, nb_threads);
+  slab = bench_run("slab", pool_slab_substrate, nb_threads);
+
+  printf("slab/basic speedup: %.2f\n", basic / slab);
+
+  return 0;
+}